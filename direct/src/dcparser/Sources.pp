@@ -30,6 +30,7 @@
      dcPackData.h dcPackData.I \
      dcPacker.h dcPacker.I \
      dcPackerCatalog.h dcPackerCatalog.I \
+     dcPackPlan.h dcPackPlan.I \
      dcPackerInterface.h dcPackerInterface.I \
      dcParameter.h dcClassParameter.h dcArrayParameter.h \
      dcSimpleParameter.h dcSwitchParameter.h \
@@ -49,6 +50,7 @@
      dcPackData.cxx \
      dcPacker.cxx \
      dcPackerCatalog.cxx \
+     dcPackPlan.cxx \
      dcPackerInterface.cxx \
      dcParameter.cxx dcClassParameter.cxx dcArrayParameter.cxx \
      dcSimpleParameter.cxx dcSwitchParameter.cxx \
@@ -62,3 +64,13 @@
 
   #define IGATESCAN all
 #end lib_target
+
+#begin test_bin_target
+  #define TARGET test_dc_pack_plan
+  #define LOCAL_LIBS p3dcparser
+  #define OTHER_LIBS $[OTHER_LIBS] p3pystub
+
+  #define SOURCES \
+    test_dc_pack_plan.cxx
+
+#end test_bin_target
@@ -283,6 +283,7 @@ add_element(DCParameter *element) {
     _has_default_value = element->has_default_value();
   }
   _default_value_stale = true;
+  clear_pack_plan();
 }
 
 ////////////////////////////////////////////////////////////////////
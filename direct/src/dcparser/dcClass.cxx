@@ -496,9 +496,7 @@ receive_update(PyObject *distobj, DatagramIterator &di) const {
   PStatTimer timer(((DCClass *)this)->_class_update_pcollector);
 #endif
     DCPacker packer;
-    const char *data = (const char *)di.get_datagram().get_data();
-    packer.set_unpack_data(data + di.get_current_index(),
-                           di.get_remaining_size(), false);
+    packer.set_unpack_data(di);
 
     int field_id = packer.raw_unpack_uint16();
     DCField *field = get_field_by_index(field_id);
@@ -535,9 +533,7 @@ receive_update_broadcast_required(PyObject *distobj, DatagramIterator &di) const
   PStatTimer timer(((DCClass *)this)->_class_update_pcollector);
 #endif
   DCPacker packer;
-  const char *data = (const char *)di.get_datagram().get_data();
-  packer.set_unpack_data(data + di.get_current_index(),
-                         di.get_remaining_size(), false);
+  packer.set_unpack_data(di);
 
   int num_fields = get_num_inherited_fields();
   for (int i = 0; i < num_fields && !PyErr_Occurred(); ++i) {
@@ -573,9 +569,7 @@ receive_update_broadcast_required_owner(PyObject *distobj,
   PStatTimer timer(((DCClass *)this)->_class_update_pcollector);
 #endif
   DCPacker packer;
-  const char *data = (const char *)di.get_datagram().get_data();
-  packer.set_unpack_data(data + di.get_current_index(),
-                         di.get_remaining_size(), false);
+  packer.set_unpack_data(di);
 
   int num_fields = get_num_inherited_fields();
   for (int i = 0; i < num_fields && !PyErr_Occurred(); ++i) {
@@ -609,9 +603,7 @@ receive_update_all_required(PyObject *distobj, DatagramIterator &di) const {
   PStatTimer timer(((DCClass *)this)->_class_update_pcollector);
 #endif
   DCPacker packer;
-  const char *data = (const char *)di.get_datagram().get_data();
-  packer.set_unpack_data(data + di.get_current_index(),
-                         di.get_remaining_size(), false);
+  packer.set_unpack_data(di);
 
   int num_fields = get_num_inherited_fields();
   for (int i = 0; i < num_fields && !PyErr_Occurred(); ++i) {
@@ -122,6 +122,7 @@ add_atomic(DCAtomicField *atomic) {
     _has_default_value = atomic->has_default_value();
   }
   _default_value_stale = true;
+  clear_pack_plan();
 }
 
 ////////////////////////////////////////////////////////////////////
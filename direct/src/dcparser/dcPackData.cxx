@@ -17,25 +17,21 @@
 static const size_t extra_size = 50;
 
 ////////////////////////////////////////////////////////////////////
-//     Function: DCPackData::set_used_length
+//     Function: DCPackData::grow_buffer
 //       Access: Private
-//  Description: Ensures that the buffer has at least size bytes, and
-//               sets the _used_length to the indicated value; grows
-//               the buffer if it does not.
+//  Description: Reallocates the buffer so that it has room for at
+//               least size bytes, preserving the bytes already in
+//               use.
 ////////////////////////////////////////////////////////////////////
 void DCPackData::
-set_used_length(size_t size) {
-  if (size > _allocated_size) {
-    _allocated_size = size + size + extra_size;
-    char *new_buf = new char[_allocated_size];
-    if (_used_length > 0) {
-      memcpy(new_buf, _buffer, _used_length);
-    }
-    if (_buffer != NULL) {
-      delete[] _buffer;
-    }
-    _buffer = new_buf;
+grow_buffer(size_t size) {
+  _allocated_size = size + size + extra_size;
+  char *new_buf = new char[_allocated_size];
+  if (_used_length > 0) {
+    memcpy(new_buf, _buffer, _used_length);
   }
-
-  _used_length = size;
+  if (_buffer != NULL) {
+    delete[] _buffer;
+  }
+  _buffer = new_buf;
 }
@@ -44,7 +44,8 @@ public:
   INLINE char *take_data();
 
 private:
-  void set_used_length(size_t size);
+  INLINE void set_used_length(size_t size);
+  void grow_buffer(size_t size);
 
 private:
   char *_buffer;
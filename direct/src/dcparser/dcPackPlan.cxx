@@ -0,0 +1,120 @@
+// Filename: dcPackPlan.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "dcPackPlan.h"
+#include "dcPackerInterface.h"
+#include "dcSwitchParameter.h"
+
+// Fixed-size arrays with more elements than this are walked
+// dynamically rather than laid out element by element in the plan.
+static const int max_expanded_nested_fields = 64;
+
+////////////////////////////////////////////////////////////////////
+//     Function: DCPackPlan::Constructor
+//       Access: Private
+//  Description: The plan is created only by
+//               DCPackerInterface::get_pack_plan().
+////////////////////////////////////////////////////////////////////
+DCPackPlan::
+DCPackPlan(const DCPackerInterface *root) {
+  // The root field sits at the top level, where the packer begins
+  // with no parent and no nested fields.
+  r_add_field(root, NULL, -1, 0, 0);
+
+  // After the root field comes the end of the top level.  It has no
+  // following step, so advancing past it leaves it in place.
+  Step end;
+  end._field = NULL;
+  end._parent = NULL;
+  end._field_index = 1;
+  end._num_nested_fields = 0;
+  end._parent_step = -1;
+  end._next = (int)_steps.size();
+  end._expanded = false;
+  _steps.push_back(end);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DCPackPlan::Destructor
+//       Access: Private
+//  Description: The plan is destroyed only by
+//               ~DCPackerInterface().
+////////////////////////////////////////////////////////////////////
+DCPackPlan::
+~DCPackPlan() {
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DCPackPlan::r_add_field
+//       Access: Private
+//  Description: Adds the step for the indicated field, and
+//               recursively for all of its nested fields, if they
+//               have a fixed structure.
+////////////////////////////////////////////////////////////////////
+void DCPackPlan::
+r_add_field(const DCPackerInterface *field,
+            const DCPackerInterface *parent, int parent_step,
+            int field_index, int num_nested_fields) {
+  int n = (int)_steps.size();
+
+  Step step;
+  step._field = field;
+  step._parent = parent;
+  step._field_index = field_index;
+  step._num_nested_fields = num_nested_fields;
+  step._parent_step = parent_step;
+  step._next = -1;
+  step._expanded = can_expand(field);
+  _steps.push_back(step);
+
+  if (step._expanded) {
+    int num_fields = field->get_num_nested_fields();
+    for (int i = 0; i < num_fields; ++i) {
+      r_add_field(field->get_nested_field(i), field, n, i, num_fields);
+    }
+
+    // The end of the nested fields, where the packer expects a
+    // pop().  The pop() takes the packer back to the parent's step,
+    // and on to the parent's _next.
+    Step end;
+    end._field = NULL;
+    end._parent = field;
+    end._field_index = num_fields;
+    end._num_nested_fields = num_fields;
+    end._parent_step = n;
+    end._next = (int)_steps.size();
+    end._expanded = false;
+    _steps.push_back(end);
+  }
+
+  _steps[n]._next = (int)_steps.size();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DCPackPlan::can_expand
+//       Access: Private, Static
+//  Description: Returns true if the nested fields of the indicated
+//               field are always the same, so that they may be laid
+//               out in the plan, or false if they must be walked
+//               dynamically.
+////////////////////////////////////////////////////////////////////
+bool DCPackPlan::
+can_expand(const DCPackerInterface *field) {
+  return (field->has_nested_fields() &&
+          field->has_fixed_structure() &&
+          field->get_num_length_bytes() == 0 &&
+          field->get_num_nested_fields() >= 0 &&
+          field->get_num_nested_fields() <= max_expanded_nested_fields &&
+          field->as_switch_parameter() == (DCSwitchParameter *)NULL);
+}
@@ -0,0 +1,88 @@
+// Filename: dcPackPlan.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef DCPACKPLAN_H
+#define DCPACKPLAN_H
+
+#include "dcbase.h"
+
+class DCPackerInterface;
+
+////////////////////////////////////////////////////////////////////
+//       Class : DCPackPlan
+// Description : This object lists, in order, every position the
+//               DCPacker passes through while it packs or unpacks a
+//               particular field, so that the packer can step from
+//               one nested field to the next without asking each
+//               parent for its children, counting them, or checking
+//               for switches.
+//
+//               Only the parts of the field with a fixed structure
+//               are laid out in the plan.  A nested field with a
+//               variable structure (a variable-length array, a
+//               string, or a switch) appears as a single step; when
+//               the packer pushes into it, it walks the nested fields
+//               dynamically as before, and returns to the plan when
+//               it pops back out.
+//
+//               Like the DCPackerCatalog, the plan is created on
+//               demand when it is first requested from a field; its
+//               ownership is retained by the field so it must not be
+//               deleted.
+////////////////////////////////////////////////////////////////////
+class EXPCL_DIRECT DCPackPlan {
+private:
+  DCPackPlan(const DCPackerInterface *root);
+  ~DCPackPlan();
+
+public:
+  // Each Step records the packer's state at one position.  A step
+  // with a NULL _field marks the end of its parent's nested fields,
+  // where the packer expects a pop().
+  class Step {
+  public:
+    const DCPackerInterface *_field;
+    const DCPackerInterface *_parent;
+    int _field_index;
+    int _num_nested_fields;
+
+    // The step of the parent field, or -1 at the top level.
+    int _parent_step;
+
+    // The step that follows this field and all of its nested fields.
+    int _next;
+
+    // True if the nested fields of this field are laid out in the
+    // steps immediately following this one.
+    bool _expanded;
+  };
+
+  INLINE int get_num_steps() const;
+  INLINE const Step &get_step(int n) const;
+
+private:
+  void r_add_field(const DCPackerInterface *field,
+                   const DCPackerInterface *parent, int parent_step,
+                   int field_index, int num_nested_fields);
+  static bool can_expand(const DCPackerInterface *field);
+
+  typedef pvector<Step> Steps;
+  Steps _steps;
+
+  friend class DCPackerInterface;
+};
+
+#include "dcPackPlan.I"
+
+#endif
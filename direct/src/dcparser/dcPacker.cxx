@@ -20,6 +20,16 @@
 #include "dcSwitchParameter.h"
 #include "dcClass.h"
 
+#ifdef WITHIN_PANDA
+ConfigVariableBool dc_pack_plans
+("dc-pack-plans", true,
+ PRC_DESC("Set this true to have the DCPacker walk the nested fields of "
+          "each field it packs or unpacks according to a plan laid out "
+          "the first time the field is used, rather than discovering "
+          "them one at a time from each field's parent.  This should "
+          "make no difference other than speed."));
+#endif  // WITHIN_PANDA
+
 DCPacker::StackElement *DCPacker::StackElement::_deleted_chain = NULL;
 int DCPacker::StackElement::_num_ever_allocated = 0;
 
@@ -40,6 +50,8 @@ DCPacker() {
   _pack_error = false;
   _range_error = false;
   _stack = NULL;
+  _plan = NULL;
+  _plan_index = 0;
   
   clear();
 }
@@ -85,6 +97,11 @@ begin_pack(const DCPackerInterface *root) {
   _current_parent = NULL;
   _current_field_index = 0;
   _num_nested_fields = 0;
+
+  if (dc_pack_plans) {
+    _plan = root->get_pack_plan();
+    _plan_index = 0;
+  }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -178,6 +195,11 @@ begin_unpack(const DCPackerInterface *root) {
   _current_parent = NULL;
   _current_field_index = 0;
   _num_nested_fields = 0;
+
+  if (dc_pack_plans) {
+    _plan = root->get_pack_plan();
+    _plan_index = 0;
+  }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -343,8 +365,9 @@ seek(int seek_index) {
     const DCPackerCatalog::Entry &entry = _live_catalog->get_entry(seek_index);
 
     // If we are seeking, we don't need to remember our current stack
-    // position.
+    // position.  We walk onward from the seeked field dynamically.
     clear_stack();
+    _plan = NULL;
     _current_field = entry._field;
     _current_parent = entry._parent;
     _current_field_index = entry._field_index;
@@ -445,16 +468,30 @@ push() {
   if (!has_nested_fields()) {
     _pack_error = true;
 
+  } else if (_plan != (DCPackPlan *)NULL &&
+             _plan->get_step(_plan_index)._expanded) {
+    // The plan lays out the nested fields that follow, so we can
+    // step right into them.  They have a fixed structure, so there is
+    // no length prefix to deal with, and the plan will find its own
+    // way back out in pop().
+    set_plan_step(_plan_index + 1);
+
   } else {
     StackElement *element = new StackElement;
     element->_current_parent = _current_parent;
     element->_current_field_index = _current_field_index;
     element->_push_marker = _push_marker;
     element->_pop_marker = _pop_marker;
+    element->_plan = _plan;
+    element->_plan_index = _plan_index;
     element->_next = _stack;
     _stack = element;
     _current_parent = _current_field;
 
+    // If we were following a plan, we walk these nested fields
+    // dynamically, and pick up the plan again when we pop back out.
+    _plan = NULL;
+
 
     // Now deal with the length prefix that might or might not be
     // before a sequence of nested fields.
@@ -541,7 +578,19 @@ pop() {
     _pack_error = true;
   }
 
-  if (_stack == NULL) {
+  if (_plan != (DCPackPlan *)NULL) {
+    // The nested fields were laid out by the plan, so we already know
+    // we have the right number of them, and there is no length
+    // prefix to fill in.  We just go back to the parent's step.
+    int parent_step = _plan->get_step(_plan_index)._parent_step;
+    if (parent_step < 0) {
+      // Unbalanced pop().
+      _pack_error = true;
+    } else {
+      _plan_index = parent_step;
+    }
+
+  } else if (_stack == NULL) {
     // Unbalanced pop().
     _pack_error = true;
 
@@ -573,6 +622,8 @@ pop() {
     _push_marker = _stack->_push_marker;
     _pop_marker = _stack->_pop_marker;
     _num_nested_fields = (_current_parent == NULL) ? 0 : _current_parent->get_num_nested_fields();
+    _plan = _stack->_plan;
+    _plan_index = _stack->_plan_index;
 
     StackElement *next = _stack->_next;
     delete _stack;
@@ -1263,6 +1314,8 @@ clear() {
   _push_marker = 0;
   _pop_marker = 0;
   _last_switch = NULL;
+  _plan = NULL;
+  _plan_index = 0;
 
   if (_live_catalog != (DCPackerCatalog::LiveCatalog *)NULL) {
     _catalog->release_live_catalog(_live_catalog);
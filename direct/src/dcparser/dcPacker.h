@@ -20,8 +20,21 @@
 #include "dcSubatomicType.h"
 #include "dcPackData.h"
 #include "dcPackerCatalog.h"
+#include "dcPackPlan.h"
 #include "dcPython.h"
 
+#ifdef WITHIN_PANDA
+#include "configVariableBool.h"
+#include "datagramIterator.h"
+
+extern ConfigVariableBool dc_pack_plans;
+
+#else  // WITHIN_PANDA
+
+static const bool dc_pack_plans = true;
+
+#endif  // WITHIN_PANDA
+
 class DCClass;
 class DCSwitchParameter;
 
@@ -49,6 +62,9 @@ PUBLISHED:
 public:
   void set_unpack_data(const char *unpack_data, size_t unpack_length, 
                        bool owns_unpack_data);
+#ifdef WITHIN_PANDA
+  INLINE void set_unpack_data(const DatagramIterator &di);
+#endif
 
 PUBLISHED:
   void begin_unpack(const DCPackerInterface *root);
@@ -188,6 +204,7 @@ public:
 
 private:
   INLINE void advance();
+  INLINE void set_plan_step(int n);
   void handle_switch(const DCSwitchParameter *switch_parameter);
   void clear();
   void clear_stack();
@@ -231,6 +248,8 @@ private:
     int _current_field_index;
     size_t _push_marker;
     size_t _pop_marker;
+    const DCPackPlan *_plan;
+    int _plan_index;
     StackElement *_next;
 
     static StackElement *_deleted_chain;
@@ -254,6 +273,13 @@ private:
   int _num_nested_fields;
   const DCSwitchParameter *_last_switch;
 
+  // _plan is the DCPackPlan of the root field, while the packer is
+  // walking a part of the field that the plan lays out, or NULL while
+  // it is walking the nested fields dynamically.  _plan_index is the
+  // step of the plan that describes the current position.
+  const DCPackPlan *_plan;
+  int _plan_index;
+
   bool _parse_error;
   bool _pack_error;
   bool _range_error;
@@ -14,6 +14,7 @@
 
 #include "dcPackerInterface.h"
 #include "dcPackerCatalog.h"
+#include "dcPackPlan.h"
 #include "dcField.h"
 #include "dcParserDefs.h"
 #include "dcLexerDefs.h"
@@ -36,6 +37,7 @@ DCPackerInterface(const string &name) :
   _num_nested_fields = -1;
   _pack_type = PT_invalid;
   _catalog = NULL;
+  _pack_plan = NULL;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -56,6 +58,7 @@ DCPackerInterface(const DCPackerInterface &copy) :
   _pack_type(copy._pack_type)
 {
   _catalog = NULL;
+  _pack_plan = NULL;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -68,6 +71,7 @@ DCPackerInterface::
   if (_catalog != (DCPackerCatalog *)NULL) {
     delete _catalog;
   }
+  clear_pack_plan();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -462,6 +466,38 @@ get_catalog() const {
   return _catalog;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: DCPackerInterface::get_pack_plan
+//       Access: Public
+//  Description: Returns the DCPackPlan associated with this field,
+//               which lays out the sequence of nested fields the
+//               DCPacker will walk through when it packs or unpacks
+//               it.
+////////////////////////////////////////////////////////////////////
+const DCPackPlan *DCPackerInterface::
+get_pack_plan() const {
+  if (_pack_plan == (DCPackPlan *)NULL) {
+    ((DCPackerInterface *)this)->make_pack_plan();
+  }
+  return _pack_plan;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DCPackerInterface::clear_pack_plan
+//       Access: Protected
+//  Description: Discards the DCPackPlan, if one has been created.
+//               This must be called when the nested fields of this
+//               field change, so that the next packer to walk them
+//               will lay out a new plan.
+////////////////////////////////////////////////////////////////////
+void DCPackerInterface::
+clear_pack_plan() {
+  if (_pack_plan != (DCPackPlan *)NULL) {
+    delete _pack_plan;
+    _pack_plan = NULL;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: DCPackerInterface::do_check_match_simple_parameter
 //       Access: Protected, Virtual
@@ -541,3 +577,14 @@ make_catalog() {
 
   _catalog->r_fill_catalog("", this, NULL, 0);
 }
+
+////////////////////////////////////////////////////////////////////
+//     Function: DCPackerInterface::make_pack_plan
+//       Access: Private
+//  Description: Called internally to create a new DCPackPlan object.
+////////////////////////////////////////////////////////////////////
+void DCPackerInterface::
+make_pack_plan() {
+  nassertv(_pack_plan == (DCPackPlan *)NULL);
+  _pack_plan = new DCPackPlan(this);
+}
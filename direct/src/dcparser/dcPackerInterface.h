@@ -28,6 +28,7 @@ class DCAtomicField;
 class DCMolecularField;
 class DCPackData;
 class DCPackerCatalog;
+class DCPackPlan;
 
 BEGIN_PUBLISH
 // This enumerated type is returned by get_pack_type() and represents
@@ -169,6 +170,7 @@ public:
                                             bool &range_error);
 
   const DCPackerCatalog *get_catalog() const;
+  const DCPackPlan *get_pack_plan() const;
 
 protected:
   virtual bool do_check_match(const DCPackerInterface *other) const=0;
@@ -184,8 +186,12 @@ public:
   virtual bool do_check_match_atomic_field(const DCAtomicField *other) const;
   virtual bool do_check_match_molecular_field(const DCMolecularField *other) const;
 
+protected:
+  void clear_pack_plan();
+
 private:
   void make_catalog();
+  void make_pack_plan();
 
 protected:
   string _name;
@@ -200,6 +206,7 @@ protected:
 
 private:
   DCPackerCatalog *_catalog;
+  DCPackPlan *_pack_plan;
 };
 
 #include "dcPackerInterface.I"
@@ -602,6 +602,7 @@ set_range(const DCDoubleRange &range) {
     return false;
   }
 
+  clear_pack_plan();
   return !range_error;
 }
 
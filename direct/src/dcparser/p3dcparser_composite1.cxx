@@ -9,6 +9,7 @@
 #include "dcPackData.cxx"
 #include "dcPacker.cxx"
 #include "dcPackerCatalog.cxx"
+#include "dcPackPlan.cxx"
 #include "dcPackerInterface.cxx"
 #include "dcindent.cxx"
 
@@ -0,0 +1,246 @@
+// Filename: test_dc_pack_plan.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "dcbase.h"
+#include "dcFile.h"
+#include "dcClass.h"
+#include "dcField.h"
+#include "dcPacker.h"
+#include "dcPackerInterface.h"
+#include "load_prc_file.h"
+#include "trueClock.h"
+#include "pset.h"
+#include "pvector.h"
+
+// This unpacks and repacks every field of every class in a dc file
+// (direct.dc by default), value by value, the way DCField::unpack_args()
+// and pack_args() walk a field, first with pack plans disabled and then
+// with them enabled (see dc-pack-plans).  Each field is packed with its
+// default value, and then with a value in which every number is
+// nonzero and every variable-length array has a few elements.  The
+// repacked data is checked against the original.
+//
+// Usage: test_dc_pack_plan [file.dc [count]]
+//
+// The default count is 20000 passes over the fields.  The best of
+// five rounds is reported.
+
+static int num_errors = 0;
+
+// Walks the current field of the unpacker, and packs each value it
+// reads into the packer.
+static void
+transcode(DCPacker &unpacker, DCPacker &packer) {
+  switch (unpacker.get_pack_type()) {
+  case PT_double:
+    packer.pack_double(unpacker.unpack_double());
+    break;
+
+  case PT_int:
+    packer.pack_int(unpacker.unpack_int());
+    break;
+
+  case PT_uint:
+    packer.pack_uint(unpacker.unpack_uint());
+    break;
+
+  case PT_int64:
+    packer.pack_int64(unpacker.unpack_int64());
+    break;
+
+  case PT_uint64:
+    packer.pack_uint64(unpacker.unpack_uint64());
+    break;
+
+  case PT_string:
+  case PT_blob:
+    packer.pack_string(unpacker.unpack_string());
+    break;
+
+  default:
+    unpacker.push();
+    packer.push();
+    while (unpacker.more_nested_fields() && packer.more_nested_fields()) {
+      transcode(unpacker, packer);
+    }
+    unpacker.pop();
+    packer.pop();
+  }
+}
+
+// Walks the current field of the packer, packing a nonzero value for
+// each number, and three elements for each variable-length array.
+static void
+pack_sample(DCPacker &packer, int seed) {
+  switch (packer.get_pack_type()) {
+  case PT_double:
+    packer.pack_double(seed % 100 + 0.5);
+    break;
+
+  case PT_int:
+  case PT_int64:
+    packer.pack_int(seed % 100 + 1);
+    break;
+
+  case PT_uint:
+  case PT_uint64:
+    packer.pack_uint(seed % 100 + 1);
+    break;
+
+  case PT_string:
+  case PT_blob:
+    packer.pack_string("sample");
+    break;
+
+  default:
+    {
+      packer.push();
+      bool variable = (packer.get_num_nested_fields() < 0);
+      int count = 0;
+      while (packer.more_nested_fields() && (!variable || count < 3)) {
+        pack_sample(packer, seed + count);
+        ++count;
+      }
+      packer.pop();
+    }
+  }
+}
+
+class Sample {
+public:
+  const DCField *_field;
+  string _data;
+};
+typedef pvector<Sample> Samples;
+
+static void
+add_sample(Samples &samples, const DCField *field, const string &data) {
+  // Make sure we can read the data back before we time it.
+  DCPacker packer;
+  packer.set_unpack_data(data);
+  packer.begin_unpack(field);
+  packer.unpack_skip();
+  if (packer.end_unpack()) {
+    Sample sample;
+    sample._field = field;
+    sample._data = data;
+    samples.push_back(sample);
+  }
+}
+
+// Returns the time taken to unpack (and, if repack is true, to repack)
+// all of the samples, count times over.
+static double
+run_test(const Samples &samples, int count, bool use_plans, bool repack) {
+  load_prc_file_data("", use_plans ? "dc-pack-plans 1" : "dc-pack-plans 0");
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+
+  DCPacker unpacker, packer;
+  for (int i = 0; i < count; ++i) {
+    Samples::const_iterator si;
+    for (si = samples.begin(); si != samples.end(); ++si) {
+      const Sample &sample = (*si);
+      unpacker.set_unpack_data(sample._data.data(), sample._data.length(), false);
+      unpacker.begin_unpack(sample._field);
+      if (!repack) {
+        unpacker.unpack_validate();
+        unpacker.end_unpack();
+
+      } else {
+        packer.clear_data();
+        packer.begin_pack(sample._field);
+        transcode(unpacker, packer);
+        bool unpack_ok = unpacker.end_unpack();
+        bool pack_ok = packer.end_pack();
+        if (i == 0 && (!unpack_ok || !pack_ok ||
+                       packer.get_length() != sample._data.length() ||
+                       memcmp(packer.get_data(), sample._data.data(), sample._data.length()) != 0)) {
+          nout << "Mismatch on " << sample._field->get_name() << "\n";
+          ++num_errors;
+        }
+      }
+    }
+  }
+
+  return clock->get_short_time() - start;
+}
+
+int
+main(int argc, char *argv[]) {
+  string filename = "direct.dc";
+  int count = 20000;
+  if (argc > 1) {
+    filename = argv[1];
+  }
+  if (argc > 2) {
+    count = atoi(argv[2]);
+  }
+
+  DCFile file;
+  if (!file.read(filename)) {
+    nout << "Unable to read " << filename << "\n";
+    return (1);
+  }
+
+  // Collect each field once, along with two packed values for it.
+  pset<const DCField *> fields;
+  Samples samples;
+  for (int ci = 0; ci < file.get_num_classes(); ++ci) {
+    DCClass *dclass = file.get_class(ci);
+    for (int fi = 0; fi < dclass->get_num_inherited_fields(); ++fi) {
+      DCField *field = dclass->get_inherited_field(fi);
+      if (field->is_bogus_field() || !fields.insert(field).second) {
+        continue;
+      }
+      add_sample(samples, field, field->get_default_value());
+
+      DCPacker packer;
+      packer.begin_pack(field);
+      pack_sample(packer, fi);
+      if (packer.end_pack()) {
+        add_sample(samples, field, packer.get_string());
+      }
+    }
+  }
+  nout << samples.size() << " samples of " << fields.size()
+       << " fields in " << filename << "\n";
+
+  // Take the best of several rounds, alternating between the two
+  // modes, to reduce the noise from other processes.
+  double best[2][2] = { { 1.0e30, 1.0e30 }, { 1.0e30, 1.0e30 } };
+  for (int round = 0; round < 5; ++round) {
+    for (int use_plans = 0; use_plans < 2; ++use_plans) {
+      for (int repack = 0; repack < 2; ++repack) {
+        double time = run_test(samples, count, use_plans != 0, repack != 0);
+        best[use_plans][repack] = min(best[use_plans][repack], time);
+      }
+    }
+  }
+
+  double num_ops = (double)count * samples.size();
+  for (int use_plans = 0; use_plans < 2; ++use_plans) {
+    nout << (use_plans ? "with plans:    " : "without plans: ")
+         << (int)(num_ops / best[use_plans][0]) << " fields/sec unpacked, "
+         << (int)(num_ops / best[use_plans][1])
+         << " fields/sec unpacked and repacked\n";
+  }
+
+  if (num_errors != 0) {
+    nout << num_errors << " fields repacked incorrectly!\n";
+    return (1);
+  }
+  return (0);
+}
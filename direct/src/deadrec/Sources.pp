@@ -13,16 +13,35 @@
 
   #define SOURCES \
     config_deadrec.h \
-    smoothMover.h smoothMover.I
+    smoothMover.h smoothMover.I \
+    smoothMoverSet.h smoothMoverSet.I
   
   #define INCLUDED_SOURCES \  
     config_deadrec.cxx \
-    smoothMover.cxx
+    smoothMover.cxx \
+    smoothMoverSet.cxx
 
   #define INSTALL_HEADERS \
     config_deadrec.h \
-    smoothMover.h smoothMover.I
+    smoothMover.h smoothMover.I \
+    smoothMoverSet.h smoothMoverSet.I
 
   #define IGATESCAN \
     all
 #end lib_target
+
+#begin test_bin_target
+  #define TARGET test_smooth_mover_set
+  #define LOCAL_LIBS \
+    p3deadrec p3directbase
+  #define OTHER_LIBS \
+    panda:m p3express:c pandaexpress:m \
+    p3interrogatedb:c p3dconfig:c p3dtoolconfig:m \
+    p3dtoolutil:c p3dtoolbase:c p3dtool:m \
+    p3prc:c p3pandabase:c p3linmath:c p3putil:c \
+    p3pipeline:c
+
+  #define SOURCES \
+    test_smooth_mover_set.cxx
+
+#end test_bin_target
@@ -28,6 +28,14 @@ ConfigVariableBool accept_clock_skew
  PRC_DESC("This controls the default value of "
           "SmoothMover::get_accept_clock_skew()."));
 
+ConfigVariableInt smooth_mover_threads
+("smooth-mover-threads", 0,
+ PRC_DESC("Specifies the default number of threads among which a "
+          "SmoothMoverSet divides its movers when it computes their "
+          "smoothed positions.  This requires a Panda built with true "
+          "threading support.  Set this to 0 or 1 to do all of the work "
+          "on the calling thread."));
+
 
 ////////////////////////////////////////////////////////////////////
 //     Function: init_libdeadrec
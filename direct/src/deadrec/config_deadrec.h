@@ -18,10 +18,12 @@
 #include "directbase.h"
 #include "notifyCategoryProxy.h"
 #include "configVariableBool.h"
+#include "configVariableInt.h"
 
 NotifyCategoryDecl(deadrec, EXPCL_DIRECT, EXPTP_DIRECT);
 
 extern ConfigVariableBool accept_clock_skew;
+extern ConfigVariableInt smooth_mover_threads;
 
 extern EXPCL_DIRECT void init_libdeadrec();
 
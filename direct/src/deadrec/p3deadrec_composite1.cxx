@@ -1,3 +1,4 @@
 #include "config_deadrec.cxx"
 #include "smoothMover.cxx"
+#include "smoothMoverSet.cxx"
 
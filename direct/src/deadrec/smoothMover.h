@@ -66,6 +66,16 @@ PUBLISHED:
   INLINE bool set_p(PN_stdfloat p);
   INLINE bool set_r(PN_stdfloat r);
 
+  // These are used for the delta-encoded updates, in which the
+  // position is given relative to the previous update, and the
+  // heading is quantized.
+  INLINE bool add_x(PN_stdfloat dx);
+  INLINE bool add_y(PN_stdfloat dy);
+  INLINE bool add_z(PN_stdfloat dz);
+  INLINE bool set_quantized_h(int qh);
+  INLINE static int quantize_h(PN_stdfloat h);
+  INLINE static PN_stdfloat dequantize_h(int qh);
+
   INLINE bool set_pos_hpr(const LVecBase3 &pos, const LVecBase3 &hpr);
   INLINE bool set_pos_hpr(PN_stdfloat x, PN_stdfloat y, PN_stdfloat z, PN_stdfloat h, PN_stdfloat p, PN_stdfloat r);
 
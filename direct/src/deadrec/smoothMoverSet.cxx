@@ -0,0 +1,663 @@
+// Filename: smoothMoverSet.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "smoothMoverSet.h"
+#include "config_deadrec.h"
+#include "compose_matrix.h"
+#include "genericThread.h"
+#include "mutexHolder.h"
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::Constructor
+//       Access: Published
+//  Description:
+////////////////////////////////////////////////////////////////////
+SmoothMoverSet::
+SmoothMoverSet() :
+  _job_cvar(_job_lock),
+  _done_cvar(_job_lock)
+{
+  _num_movers = 0;
+
+  _smooth_mode = SmoothMover::SM_off;
+  _prediction_mode = SmoothMover::PM_off;
+  _delay = 0.2;
+  _max_position_age = 0.25;
+  _expected_broadcast_period = 0.2;
+  _reset_velocity_age = 0.3;
+  _directional_velocity = true;
+  _default_to_standing_still = true;
+  _num_threads = smooth_mover_threads;
+
+  _threads_num_threads = 1;
+  _job_timestamp = 0.0;
+  _job_num_movers = 0;
+  _next_mover = 0;
+  _num_blocks_left = 0;
+  _job_seq = 0;
+  _shutdown = false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::Destructor
+//       Access: Published
+//  Description:
+////////////////////////////////////////////////////////////////////
+SmoothMoverSet::
+~SmoothMoverSet() {
+  stop_threads();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::add_mover
+//       Access: Published
+//  Description: Adds a new mover to the set, and returns the index by
+//               which it is identified in subsequent calls.  The
+//               index of a removed mover may be reused.
+////////////////////////////////////////////////////////////////////
+int SmoothMoverSet::
+add_mover() {
+  int n;
+  if (!_free_movers.empty()) {
+    n = _free_movers.back();
+    _free_movers.pop_back();
+
+  } else {
+    n = (int)_in_use.size();
+    int size = n + 1;
+    _times.resize(size * max_position_reports, 0.0);
+    int c;
+    for (c = 0; c < num_components; ++c) {
+      _samples[c].resize(size * max_position_reports, 0.0f);
+      _smooth[c].resize(size, 0.0f);
+    }
+    for (c = 0; c < num_velocity_components; ++c) {
+      _velocity[c].resize(size, 0.0f);
+    }
+    _first.resize(size, 0);
+    _count.resize(size, 0);
+    _smooth_time.resize(size, 0.0);
+    _known.resize(size, 0);
+    _changed.resize(size, 0);
+    _in_use.resize(size, 0);
+    _node_paths.resize(size);
+  }
+
+  _in_use[n] = 1;
+  ++_num_movers;
+  return n;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::remove_mover
+//       Access: Published
+//  Description: Removes the indicated mover from the set.  Its index
+//               may be returned by a later call to add_mover().
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+remove_mover(int n) {
+  nassertv(has_mover(n));
+
+  int c;
+  for (c = 0; c < num_components; ++c) {
+    _smooth[c][n] = 0.0f;
+  }
+  for (c = 0; c < num_velocity_components; ++c) {
+    _velocity[c][n] = 0.0f;
+  }
+  _first[n] = 0;
+  _count[n] = 0;
+  _smooth_time[n] = 0.0;
+  _known[n] = 0;
+  _changed[n] = 0;
+  _in_use[n] = 0;
+  _node_paths[n] = NodePath();
+
+  _free_movers.push_back(n);
+  --_num_movers;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::add_position
+//       Access: Published
+//  Description: Records a position report for the indicated mover,
+//               as SmoothMover::mark_position() does.  With
+//               smoothing disabled, only the most recent report is
+//               kept, and the mover jumps to it at the next call to
+//               compute_smooth_positions().
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+add_position(int n, const LPoint3 &pos, const LVecBase3 &hpr,
+             double timestamp) {
+  nassertv(has_mover(n));
+
+  int count = _count[n];
+  if (_smooth_mode == SmoothMover::SM_off) {
+    count = 0;
+
+  } else if (count != 0) {
+    double last = _times[get_slot(n, count - 1)];
+    if (last > timestamp) {
+      if (deadrec_cat.is_debug()) {
+        deadrec_cat.debug()
+          << "*** timestamp out of order " << last << " "
+          << timestamp << "\n";
+      }
+
+      // If we get a timestamp out of order, one of us must have just
+      // reset our clock.  Flush the sequence and start again.
+      count = 0;
+
+    } else if (last == timestamp) {
+      // The new report simply replaces the previous one.
+      --count;
+
+    } else if (count >= max_position_reports) {
+      // Throw away the oldest report.
+      _first[n] = (_first[n] + 1) % max_position_reports;
+      --count;
+    }
+  }
+
+  int slot = get_slot(n, count);
+  _times[slot] = timestamp;
+  _samples[C_x][slot] = pos[0];
+  _samples[C_y][slot] = pos[1];
+  _samples[C_z][slot] = pos[2];
+  _samples[C_h][slot] = hpr[0];
+  _samples[C_p][slot] = hpr[1];
+  _samples[C_r][slot] = hpr[2];
+  _count[n] = count + 1;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::clear_positions
+//       Access: Published
+//  Description: Erases all the position reports of the indicated
+//               mover, as SmoothMover::clear_positions() does.  If
+//               reset_velocity is true, its velocity is also reset
+//               to 0.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+clear_positions(int n, bool reset_velocity) {
+  nassertv(has_mover(n));
+
+  _first[n] = 0;
+  _count[n] = 0;
+  _known[n] = 0;
+
+  if (reset_velocity) {
+    for (int c = 0; c < num_velocity_components; ++c) {
+      _velocity[c][n] = 0.0f;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::compute_smooth_positions
+//       Access: Published
+//  Description: Computes the smoothed position (and orientation) of
+//               every mover at the indicated point in time, based on
+//               its position reports.  After this call has been
+//               made, get_smooth_pos() etc. may be called to retrieve
+//               the smoothed positions.
+//
+//               The movers are divided into blocks, which are handed
+//               out to the calling thread and to get_num_threads() - 1
+//               worker threads.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+compute_smooth_positions(double timestamp) {
+  if (_num_threads != _threads_num_threads) {
+    // The number of threads has changed since the workers were
+    // started.
+    stop_threads();
+    if (_num_threads > 1 && Thread::is_threading_supported()) {
+      start_threads(_num_threads - 1);
+    }
+    _threads_num_threads = _num_threads;
+  }
+
+  int num_movers = (int)_in_use.size();
+  {
+    MutexHolder holder(_job_lock);
+    _job_timestamp = timestamp;
+    _job_num_movers = num_movers;
+    _next_mover = 0;
+    _num_blocks_left = (num_movers + block_size - 1) / block_size;
+    if (!_threads.empty() && _num_blocks_left > 1) {
+      ++_job_seq;
+      _job_cvar.notify_all();
+    }
+  }
+
+  // This thread takes its share of the work too.
+  Scratch scratch;
+  compute_blocks(scratch);
+
+  MutexHolder holder(_job_lock);
+  while (_num_blocks_left > 0) {
+    _done_cvar.wait();
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::apply_smooth_positions
+//       Access: Published
+//  Description: Applies the smoothed position of each mover whose
+//               position changed in the last call to
+//               compute_smooth_positions() to the node specified by
+//               set_node_path(), if any.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+apply_smooth_positions() {
+  int num_movers = (int)_in_use.size();
+  for (int n = 0; n < num_movers; ++n) {
+    if (_changed[n] && !_node_paths[n].is_empty()) {
+      _node_paths[n].set_pos_hpr(get_smooth_pos(n), get_smooth_hpr(n));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::get_smooth_forward_velocity
+//       Access: Published
+//  Description: Returns the speed at which the indicated mover is
+//               moving, in feet per second, along its own forward
+//               axis, as of the last call to
+//               compute_smooth_positions().  If directional velocity
+//               is disabled, this is simply its speed.
+////////////////////////////////////////////////////////////////////
+PN_stdfloat SmoothMoverSet::
+get_smooth_forward_velocity(int n) const {
+  nassertr(has_mover(n), 0.0f);
+  LVector3 velocity(_velocity[C_x][n], _velocity[C_y][n], _velocity[C_z][n]);
+
+  if (!_directional_velocity) {
+    return velocity.length();
+  }
+
+  LMatrix3 rot_mat;
+  compose_matrix(rot_mat, LVecBase3(1.0, 1.0, 1.0), get_smooth_hpr(n));
+  LVector3 forward_axis = LVector3(0.0, 1.0, 0.0) * rot_mat;
+  return velocity.dot(forward_axis);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::get_smooth_lateral_velocity
+//       Access: Published
+//  Description: Returns the speed at which the indicated mover is
+//               moving, in feet per second, to its right, as of the
+//               last call to compute_smooth_positions().  If
+//               directional velocity is disabled, this is 0.
+////////////////////////////////////////////////////////////////////
+PN_stdfloat SmoothMoverSet::
+get_smooth_lateral_velocity(int n) const {
+  nassertr(has_mover(n), 0.0f);
+  if (!_directional_velocity) {
+    return 0.0f;
+  }
+
+  LVector3 velocity(_velocity[C_x][n], _velocity[C_y][n], _velocity[C_z][n]);
+  LMatrix3 rot_mat;
+  compose_matrix(rot_mat, LVecBase3(1.0, 1.0, 1.0), get_smooth_hpr(n));
+  LVector3 forward_axis = LVector3(0.0, 1.0, 0.0) * rot_mat;
+  LVector3 lateral_axis = forward_axis.cross(LVector3(0.0, 0.0, 1.0));
+  return velocity.dot(lateral_axis);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::output
+//       Access: Published
+//  Description:
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+output(ostream &out) const {
+  out << "SmoothMoverSet, " << _num_movers << " movers.";
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::compute_block
+//       Access: Private
+//  Description: Computes the smoothed positions of the movers in the
+//               range [begin, end), which must be no more than
+//               block_size movers.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+compute_block(Scratch &scratch, int begin, int end, double timestamp) {
+  nassertv(end - begin <= block_size);
+  find_brackets(scratch, begin, end, timestamp);
+  interpolate(scratch, begin, end);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::find_brackets
+//       Access: Private
+//  Description: The first step of compute_block(): for each mover in
+//               the range, finds the position reports that bracket
+//               the indicated time, following the rules of
+//               SmoothMover::compute_smooth_position(), and records
+//               them in the scratch block.  Position reports that
+//               will not be needed again are discarded.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+find_brackets(Scratch &scratch, int begin, int end, double timestamp) {
+  double delayed = timestamp - _delay;
+
+  for (int n = begin; n < end; ++n) {
+    int j = n - begin;
+    int count = _count[n];
+
+    if (count == 0) {
+      // With no position reports available, the mover stays where it
+      // is, and its velocity is reset to zero after a period of
+      // time.
+      for (int c = 0; c < num_components; ++c) {
+        scratch._base[c][j] = _smooth[c][n];
+        scratch._delta[c][j] = 0.0f;
+      }
+      scratch._t[j] = 0.0f;
+      scratch._inv_age[j] = 0.0f;
+      if (!_known[n] || timestamp - _smooth_time[n] <= _reset_velocity_age) {
+        keep_velocity(scratch, j, n);
+      }
+      continue;
+    }
+
+    if (_smooth_mode == SmoothMover::SM_off) {
+      // With smoothing disabled, the mover jumps straight to its
+      // latest position report.  Its velocity is measured from where
+      // it was before.
+      int slot = get_slot(n, count - 1);
+      hold_still(scratch, j, slot);
+      if (_known[n]) {
+        double age = min(timestamp - _smooth_time[n], _max_position_age);
+        if (age != 0.0) {
+          for (int c = 0; c < num_velocity_components; ++c) {
+            scratch._delta[c][j] = _samples[c][slot] - _smooth[c][n];
+          }
+          scratch._inv_age[j] = (PN_stdfloat)(1.0 / age);
+        } else {
+          keep_velocity(scratch, j, n);
+        }
+      }
+      _smooth_time[n] = timestamp;
+      _known[n] = 1;
+      drop_positions(n, count);
+      continue;
+    }
+
+    // Find the newest report before the indicated time, and the
+    // oldest one after it.
+    int before = -1;
+    int i = 0;
+    while (i < count && _times[get_slot(n, i)] < delayed) {
+      before = i;
+      ++i;
+    }
+    int after = (i < count) ? i : -1;
+    int way_before = before - 1;
+
+    _known[n] = 1;
+    _smooth_time[n] = delayed;
+
+    if (before < 0) {
+      // If we only have an after point, we have to start there.
+      hold_still(scratch, j, get_slot(n, after));
+      continue;
+    }
+
+    double t = delayed;
+    int lo = before;
+    int hi = after;
+    if (after < 0 && _prediction_mode != SmoothMover::PM_off &&
+        way_before >= 0) {
+      // With prediction in effect, extend the line through the last
+      // two reports a little way into the future.
+      lo = way_before;
+      hi = before;
+      t = min(delayed, _times[get_slot(n, before)] + _max_position_age);
+    }
+
+    if (hi < 0) {
+      // We only have a before point, so we have to stop there.
+      double time_before = _times[get_slot(n, before)];
+      if (way_before >= 0) {
+        // Use the previous two points, if we've got 'em, so we can
+        // still reflect the mover's velocity.
+        int slot_wb = get_slot(n, way_before);
+        int slot_b = get_slot(n, before);
+        double age = time_before - _times[slot_wb];
+        set_bracket(scratch, j, slot_wb, slot_b, 1.0f,
+                    (PN_stdfloat)(1.0 / age));
+        _smooth_time[n] = time_before;
+      } else {
+        hold_still(scratch, j, get_slot(n, before));
+        keep_velocity(scratch, j, n);
+      }
+
+      if (delayed - time_before > _reset_velocity_age) {
+        scratch._inv_age[j] = 0.0f;
+      }
+
+    } else {
+      // We can linearly interpolate between two points.
+      int slot_lo = get_slot(n, lo);
+      int slot_hi = get_slot(n, hi);
+      double time_lo = _times[slot_lo];
+      double time_hi = _times[slot_hi];
+      double age = time_hi - time_lo;
+
+      if (_default_to_standing_still && age > _max_position_age &&
+          time_hi - _expected_broadcast_period > time_lo) {
+        // If the earlier point is too old, assume the mover was
+        // standing still there until one broadcast period before the
+        // later point.
+        double time_still = time_hi - _expected_broadcast_period;
+        if (t <= time_still) {
+          hold_still(scratch, j, slot_lo);
+          _smooth_time[n] = t;
+          drop_positions(n, _prediction_mode == SmoothMover::PM_off ?
+                         before : way_before);
+          continue;
+        }
+        time_lo = time_still;
+        age = _expected_broadcast_period;
+      }
+
+      set_bracket(scratch, j, slot_lo, slot_hi,
+                  (PN_stdfloat)((t - time_lo) / age),
+                  (PN_stdfloat)(1.0 / age));
+      _smooth_time[n] = t;
+    }
+
+    // Assume we'll never be asked for an older time than this, and
+    // discard the reports we won't need again.  Without prediction,
+    // only the newest report before the time is needed; with it, the
+    // one before that as well.
+    drop_positions(n, _prediction_mode == SmoothMover::PM_off ?
+                   before : way_before);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::interpolate
+//       Access: Private
+//  Description: The second step of compute_block(): computes the
+//               smoothed position and velocity of each mover in the
+//               range from the scratch block filled in by
+//               find_brackets(), and notes which ones have changed.
+//               Each of these loops is a straight run over
+//               contiguous arrays, which the compiler may vectorize.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+interpolate(const Scratch &scratch, int begin, int end) {
+  int num = end - begin;
+  const PN_stdfloat *t = scratch._t;
+  const PN_stdfloat *inv_age = scratch._inv_age;
+  unsigned char *changed = &_changed[begin];
+
+  int j;
+  for (j = 0; j < num; ++j) {
+    changed[j] = 0;
+  }
+
+  int c;
+  for (c = 0; c < num_components; ++c) {
+    const PN_stdfloat *base = scratch._base[c];
+    const PN_stdfloat *delta = scratch._delta[c];
+    PN_stdfloat *smooth = &_smooth[c][begin];
+    for (j = 0; j < num; ++j) {
+      PN_stdfloat value = base[j] + t[j] * delta[j];
+      changed[j] |= (unsigned char)(value != smooth[j]);
+      smooth[j] = value;
+    }
+  }
+
+  for (c = 0; c < num_velocity_components; ++c) {
+    const PN_stdfloat *delta = scratch._delta[c];
+    PN_stdfloat *velocity = &_velocity[c][begin];
+    for (j = 0; j < num; ++j) {
+      velocity[j] = delta[j] * inv_age[j];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::drop_positions
+//       Access: Private
+//  Description: Discards the indicated number of the oldest position
+//               reports of mover n.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+drop_positions(int n, int num_drop) {
+  if (num_drop > 0) {
+    nassertv(num_drop <= _count[n]);
+    _first[n] = (_first[n] + num_drop) % max_position_reports;
+    _count[n] -= num_drop;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::start_threads
+//       Access: Private
+//  Description: Starts the indicated number of worker threads, which
+//               wait for compute_smooth_positions() to wake them.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+start_threads(int num_threads) {
+  nassertv(_threads.empty());
+  _shutdown = false;
+
+  _threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    PT(Thread) thread =
+      new GenericThread("smooth-mover", "smooth-mover", &thread_main, this);
+    if (thread->start(TP_normal, true)) {
+      _threads.push_back(thread);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::stop_threads
+//       Access: Private
+//  Description: Tells the worker threads to exit, and waits for them
+//               to do so.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+stop_threads() {
+  if (_threads.empty()) {
+    return;
+  }
+
+  {
+    MutexHolder holder(_job_lock);
+    _shutdown = true;
+    _job_cvar.notify_all();
+  }
+
+  Threads::iterator ti;
+  for (ti = _threads.begin(); ti != _threads.end(); ++ti) {
+    (*ti)->join();
+  }
+  _threads.clear();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::compute_blocks
+//       Access: Private
+//  Description: Takes blocks of movers from the current
+//               compute_smooth_positions() call one at a time, and
+//               computes them, until there are none left.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+compute_blocks(Scratch &scratch) {
+  while (true) {
+    int begin, end;
+    {
+      MutexHolder holder(_job_lock);
+      if (_next_mover >= _job_num_movers) {
+        return;
+      }
+      begin = _next_mover;
+      end = min(begin + (int)block_size, _job_num_movers);
+      _next_mover = end;
+    }
+
+    compute_block(scratch, begin, end, _job_timestamp);
+
+    MutexHolder holder(_job_lock);
+    --_num_blocks_left;
+    if (_num_blocks_left == 0) {
+      _done_cvar.notify();
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SmoothMoverSet::thread_main
+//       Access: Private, Static
+//  Description: The body of each worker thread.  Waits for each call
+//               to compute_smooth_positions(), and takes its share of
+//               the blocks, until stop_threads() is called.
+////////////////////////////////////////////////////////////////////
+void SmoothMoverSet::
+thread_main(void *user_data) {
+  SmoothMoverSet *self = (SmoothMoverSet *)user_data;
+  Scratch scratch;
+
+  // A call that began before this thread got here is finished without
+  // it.
+  int seq;
+  {
+    MutexHolder holder(self->_job_lock);
+    seq = self->_job_seq;
+  }
+
+  while (true) {
+    {
+      MutexHolder holder(self->_job_lock);
+      while (self->_job_seq == seq && !self->_shutdown) {
+        self->_job_cvar.wait();
+      }
+      if (self->_shutdown) {
+        return;
+      }
+      seq = self->_job_seq;
+    }
+
+    self->compute_blocks(scratch);
+  }
+}
@@ -0,0 +1,219 @@
+// Filename: smoothMoverSet.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef SMOOTHMOVERSET_H
+#define SMOOTHMOVERSET_H
+
+#include "directbase.h"
+#include "smoothMover.h"
+#include "luse.h"
+#include "clockObject.h"
+#include "nodePath.h"
+#include "pmutex.h"
+#include "conditionVar.h"
+#include "conditionVarFull.h"
+#include "thread.h"
+#include "pvector.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : SmoothMoverSet
+// Description : This class does the work of many SmoothMovers at
+//               once, for instance, for all of the remote avatars in
+//               a crowded zone.  Each mover is identified by the
+//               index returned by add_mover(); its position reports
+//               are given to add_position(), and
+//               compute_smooth_positions() then computes the smoothed
+//               position of every mover in a single pass, which may
+//               be divided among several threads.  The threads are
+//               started when they are first needed and kept for the
+//               life of the SmoothMoverSet, waiting between calls.
+//
+//               The position reports of all the movers are stored
+//               together, component by component, and the smoothed
+//               positions are computed in two steps for each block of
+//               movers: first, the two position reports that bracket
+//               the current time are found for each mover, and then
+//               the positions of the whole block are interpolated in
+//               one straight loop.
+//
+//               The smoothing follows SmoothMover, with all of the
+//               movers sharing the same settings.  However, the
+//               timestamps given to add_position() are taken as
+//               given; there is no accounting for clock skew.
+////////////////////////////////////////////////////////////////////
+class EXPCL_DIRECT SmoothMoverSet {
+PUBLISHED:
+  SmoothMoverSet();
+  ~SmoothMoverSet();
+
+  int add_mover();
+  void remove_mover(int n);
+  INLINE bool has_mover(int n) const;
+  INLINE int get_num_movers() const;
+
+  INLINE void set_node_path(int n, const NodePath &node_path);
+  INLINE NodePath get_node_path(int n) const;
+
+  void add_position(int n, const LPoint3 &pos, const LVecBase3 &hpr,
+                    double timestamp);
+  void clear_positions(int n, bool reset_velocity);
+  INLINE int get_num_positions(int n) const;
+
+  INLINE void compute_smooth_positions();
+  void compute_smooth_positions(double timestamp);
+  void apply_smooth_positions();
+  INLINE void compute_and_apply_smooth_positions();
+
+  INLINE LPoint3 get_smooth_pos(int n) const;
+  INLINE LVecBase3 get_smooth_hpr(int n) const;
+  INLINE bool get_smooth_position_changed(int n) const;
+
+  PN_stdfloat get_smooth_forward_velocity(int n) const;
+  PN_stdfloat get_smooth_lateral_velocity(int n) const;
+  INLINE PN_stdfloat get_smooth_rotational_velocity(int n) const;
+
+  INLINE void set_smooth_mode(SmoothMover::SmoothMode mode);
+  INLINE SmoothMover::SmoothMode get_smooth_mode() const;
+
+  INLINE void set_prediction_mode(SmoothMover::PredictionMode mode);
+  INLINE SmoothMover::PredictionMode get_prediction_mode() const;
+
+  INLINE void set_delay(double delay);
+  INLINE double get_delay() const;
+
+  INLINE void set_max_position_age(double age);
+  INLINE double get_max_position_age() const;
+
+  INLINE void set_expected_broadcast_period(double period);
+  INLINE double get_expected_broadcast_period() const;
+
+  INLINE void set_reset_velocity_age(double age);
+  INLINE double get_reset_velocity_age() const;
+
+  INLINE void set_directional_velocity(bool flag);
+  INLINE bool get_directional_velocity() const;
+
+  INLINE void set_default_to_standing_still(bool flag);
+  INLINE bool get_default_to_standing_still() const;
+
+  INLINE void set_num_threads(int num_threads);
+  INLINE int get_num_threads() const;
+
+  void output(ostream &out) const;
+
+private:
+  // The six components of each position report, and of each
+  // smoothed position.
+  enum Component {
+    C_x, C_y, C_z, C_h, C_p, C_r,
+    num_components
+  };
+
+  // The velocity is kept, in world space, for these components only.
+  enum {
+    num_velocity_components = 4
+  };
+
+  // The movers are processed this many at a time.
+  enum {
+    block_size = 256
+  };
+
+  // The interpolation parameters for one block of movers, filled in
+  // by find_brackets() and consumed by interpolate().  Each mover's
+  // smoothed position is _base + _t * _delta, and its velocity is
+  // _delta * _inv_age.
+  class Scratch {
+  public:
+    PN_stdfloat _base[num_components][block_size];
+    PN_stdfloat _delta[num_components][block_size];
+    PN_stdfloat _t[block_size];
+    PN_stdfloat _inv_age[block_size];
+  };
+
+  void compute_block(Scratch &scratch, int begin, int end, double timestamp);
+  void find_brackets(Scratch &scratch, int begin, int end, double timestamp);
+  void interpolate(const Scratch &scratch, int begin, int end);
+
+  INLINE int get_slot(int n, int i) const;
+  INLINE void set_bracket(Scratch &scratch, int j, int slot_b, int slot_a,
+                          PN_stdfloat t, PN_stdfloat inv_age) const;
+  INLINE void hold_still(Scratch &scratch, int j, int slot) const;
+  INLINE void keep_velocity(Scratch &scratch, int j, int n) const;
+  void drop_positions(int n, int num_drop);
+
+  void start_threads(int num_threads);
+  void stop_threads();
+  void compute_blocks(Scratch &scratch);
+  static void thread_main(void *user_data);
+
+  // The position reports.  Mover n's reports are kept in a ring of
+  // max_position_reports slots, beginning at slot
+  // n * max_position_reports; _first[n] is the offset of the oldest
+  // within that ring, and _count[n] is the number of reports.
+  pvector<double> _times;
+  pvector<PN_stdfloat> _samples[num_components];
+  pvector<int> _first;
+  pvector<int> _count;
+
+  // The smoothed position of each mover, and its velocity per second.
+  pvector<PN_stdfloat> _smooth[num_components];
+  pvector<PN_stdfloat> _velocity[num_velocity_components];
+  pvector<double> _smooth_time;
+  pvector<unsigned char> _known;
+  pvector<unsigned char> _changed;
+
+  pvector<unsigned char> _in_use;
+  pvector<NodePath> _node_paths;
+  pvector<int> _free_movers;
+  int _num_movers;
+
+  SmoothMover::SmoothMode _smooth_mode;
+  SmoothMover::PredictionMode _prediction_mode;
+  double _delay;
+  double _max_position_age;
+  double _expected_broadcast_period;
+  double _reset_velocity_age;
+  bool _directional_velocity;
+  bool _default_to_standing_still;
+  int _num_threads;
+
+  // The worker threads, and the number of threads they were started
+  // for.  Each call to compute_smooth_positions() increments _job_seq
+  // to wake them, and hands out blocks of movers to them and to the
+  // calling thread; it returns when _num_blocks_left reaches 0.  The
+  // members below are protected by _job_lock.
+  typedef pvector< PT(Thread) > Threads;
+  Threads _threads;
+  int _threads_num_threads;
+
+  double _job_timestamp;
+  int _job_num_movers;
+  int _next_mover;
+  int _num_blocks_left;
+  int _job_seq;
+  bool _shutdown;
+  Mutex _job_lock;
+  ConditionVarFull _job_cvar;
+  ConditionVar _done_cvar;
+};
+
+INLINE ostream &operator << (ostream &out, const SmoothMoverSet &set) {
+  set.output(out);
+  return out;
+}
+
+#include "smoothMoverSet.I"
+
+#endif
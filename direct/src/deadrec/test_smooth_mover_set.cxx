@@ -0,0 +1,215 @@
+// Filename: test_smooth_mover_set.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "smoothMover.h"
+#include "smoothMoverSet.h"
+#include "trueClock.h"
+#include "compose_matrix.h"
+#include "randomizer.h"
+#include "pvector.h"
+#include <algorithm>
+
+// This feeds the same position reports, for a crowd of movers walking,
+// turning and stopping, into one SmoothMover per mover and into a
+// SmoothMoverSet, computes the smoothed positions at 60 frames per
+// second, and reports the time each takes per frame.  The
+// SmoothMoverSet is run both on one thread and on several, and its
+// positions are checked against those of the SmoothMovers every
+// frame.
+//
+// Usage: test_smooth_mover_set [num_movers [seconds [num_threads]]]
+
+static const double broadcast_period = 0.2;
+static const double frame_period = 1.0 / 60.0;
+
+class Report {
+public:
+  double _time;
+  int _mover;
+  LPoint3 _pos;
+  LVecBase3 _hpr;
+
+  bool operator < (const Report &other) const {
+    return _time < other._time;
+  }
+};
+typedef pvector<Report> Reports;
+
+////////////////////////////////////////////////////////////////////
+//     Function: make_reports
+//  Description: Synthesizes the position reports of num_movers movers
+//               over the indicated number of seconds, sorted by time.
+//               Each mover broadcasts every broadcast_period, give or
+//               take a little, and now and then stands still, when it
+//               stops broadcasting altogether.
+////////////////////////////////////////////////////////////////////
+static void
+make_reports(Reports &reports, int num_movers, double seconds) {
+  Randomizer random(1);
+
+  pvector<Reports> movers(num_movers);
+  for (int n = 0; n < num_movers; ++n) {
+    Report report;
+    report._mover = n;
+    report._pos.set(random.random_real(1000.0), random.random_real(1000.0), 0.0f);
+    report._hpr.set(random.random_real(360.0) - 180.0, 0.0f, 0.0f);
+    double speed = random.random_real(20.0);
+    double turn = random.random_real(90.0) - 45.0;
+
+    double time = random.random_real(broadcast_period);
+    while (time < seconds) {
+      report._time = time;
+      movers[n].push_back(report);
+
+      double dt;
+      if (random.random_int(20) == 0) {
+        // Stand still for a while.
+        dt = 0.5 + random.random_real(1.5);
+        speed = random.random_real(20.0);
+        turn = random.random_real(90.0) - 45.0;
+      } else {
+        dt = broadcast_period + random.random_real(0.04) - 0.02;
+        LMatrix3 rot_mat;
+        compose_matrix(rot_mat, LVecBase3(1.0, 1.0, 1.0), report._hpr);
+        report._pos += (LVector3(0.0, 1.0, 0.0) * rot_mat) * (PN_stdfloat)(speed * dt);
+        report._hpr[0] += (PN_stdfloat)(turn * dt);
+        if (report._hpr[0] > 180.0f) {
+          report._hpr[0] -= 360.0f;
+        } else if (report._hpr[0] < -180.0f) {
+          report._hpr[0] += 360.0f;
+        }
+      }
+      time += dt;
+    }
+  }
+
+  // Interleave the movers' reports in order of time.
+  for (int n = 0; n < num_movers; ++n) {
+    reports.insert(reports.end(), movers[n].begin(), movers[n].end());
+  }
+  sort(reports.begin(), reports.end());
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: angle_diff
+//  Description: Returns the difference between two angles, in
+//               degrees, the short way around.
+////////////////////////////////////////////////////////////////////
+static double
+angle_diff(double a, double b) {
+  double d = fmod(fabs(a - b), 360.0);
+  return min(d, 360.0 - d);
+}
+
+int
+main(int argc, char *argv[]) {
+  int num_movers = 10000;
+  double seconds = 10.0;
+  int num_threads = 4;
+  if (argc > 1) {
+    num_movers = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    seconds = atof(argv[2]);
+  }
+  if (argc > 3) {
+    num_threads = atoi(argv[3]);
+  }
+
+  Reports reports;
+  make_reports(reports, num_movers, seconds);
+  nout << num_movers << " movers, " << seconds << " seconds, "
+       << reports.size() << " position reports\n";
+
+  pvector<SmoothMover> movers(num_movers);
+  SmoothMoverSet single, threaded;
+  single.set_num_threads(1);
+  threaded.set_num_threads(num_threads);
+
+  SmoothMoverSet *sets[2] = { &single, &threaded };
+  int n;
+  for (n = 0; n < num_movers; ++n) {
+    movers[n].set_smooth_mode(SmoothMover::SM_on);
+    movers[n].set_prediction_mode(SmoothMover::PM_on);
+  }
+  for (int s = 0; s < 2; ++s) {
+    sets[s]->set_smooth_mode(SmoothMover::SM_on);
+    sets[s]->set_prediction_mode(SmoothMover::PM_on);
+    for (n = 0; n < num_movers; ++n) {
+      sets[s]->add_mover();
+    }
+  }
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double mover_time = 0.0;
+  double set_time[2] = { 0.0, 0.0 };
+  double max_pos_diff = 0.0;
+  double max_hpr_diff = 0.0;
+  int num_frames = 0;
+
+  size_t ri = 0;
+  for (double now = 0.0; now < seconds + 1.0; now += frame_period) {
+    while (ri < reports.size() && reports[ri]._time <= now) {
+      const Report &report = reports[ri];
+      SmoothMover &mover = movers[report._mover];
+      mover.set_pos_hpr(report._pos, report._hpr);
+      mover.set_timestamp(report._time);
+      mover.mark_position();
+      for (int s = 0; s < 2; ++s) {
+        sets[s]->add_position(report._mover, report._pos, report._hpr,
+                              report._time);
+      }
+      ++ri;
+    }
+
+    double start = clock->get_short_time();
+    for (n = 0; n < num_movers; ++n) {
+      movers[n].compute_smooth_position(now);
+    }
+    mover_time += clock->get_short_time() - start;
+
+    for (int s = 0; s < 2; ++s) {
+      start = clock->get_short_time();
+      sets[s]->compute_smooth_positions(now);
+      set_time[s] += clock->get_short_time() - start;
+
+      for (n = 0; n < num_movers; ++n) {
+        LVector3 pos_delta =
+          sets[s]->get_smooth_pos(n) - movers[n].get_smooth_pos();
+        max_pos_diff = max(max_pos_diff, (double)pos_delta.length());
+        LVecBase3 hpr = sets[s]->get_smooth_hpr(n);
+        const LVecBase3 &mover_hpr = movers[n].get_smooth_hpr();
+        for (int i = 0; i < 3; ++i) {
+          max_hpr_diff = max(max_hpr_diff, angle_diff(hpr[i], mover_hpr[i]));
+        }
+      }
+    }
+    ++num_frames;
+  }
+
+  nout << "SmoothMover:               "
+       << mover_time * 1000.0 / num_frames << " ms per frame\n"
+       << "SmoothMoverSet, 1 thread:  "
+       << set_time[0] * 1000.0 / num_frames << " ms per frame\n"
+       << "SmoothMoverSet, " << num_threads << " threads: "
+       << set_time[1] * 1000.0 / num_frames << " ms per frame\n"
+       << "largest difference: " << max_pos_diff << " in position, "
+       << max_hpr_diff << " degrees in orientation\n";
+
+  if (max_pos_diff > 0.01 || max_hpr_diff > 0.01) {
+    nout << "SmoothMoverSet does not match SmoothMover!\n";
+    return (1);
+  }
+  return (0);
+}
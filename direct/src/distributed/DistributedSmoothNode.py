@@ -275,6 +275,38 @@ class DistributedSmoothNode(DistributedNode.DistributedNode,
         self.setComponentR(r)
         self.setComponentTLive(timestamp)
 
+    # The delta-encoded versions of the above, which are sent instead
+    # when the sender has delta encoding enabled.  The position is
+    # given relative to the previous update.
+    def setSmQH(self, qh, timestamp=None):
+        self._checkResume(timestamp)
+        self.setComponentQH(qh)
+        self.setComponentTLive(timestamp)
+    def setSmDXY(self, dx, dy, timestamp=None):
+        self._checkResume(timestamp)
+        self.setComponentDX(dx)
+        self.setComponentDY(dy)
+        self.setComponentTLive(timestamp)
+    def setSmDXYQH(self, dx, dy, qh, timestamp=None):
+        self._checkResume(timestamp)
+        self.setComponentDX(dx)
+        self.setComponentDY(dy)
+        self.setComponentQH(qh)
+        self.setComponentTLive(timestamp)
+    def setSmDPos(self, dx, dy, dz, timestamp=None):
+        self._checkResume(timestamp)
+        self.setComponentDX(dx)
+        self.setComponentDY(dy)
+        self.setComponentDZ(dz)
+        self.setComponentTLive(timestamp)
+    def setSmDPosQH(self, dx, dy, dz, qh, timestamp=None):
+        self._checkResume(timestamp)
+        self.setComponentDX(dx)
+        self.setComponentDY(dy)
+        self.setComponentDZ(dz)
+        self.setComponentQH(qh)
+        self.setComponentTLive(timestamp)
+
     ### component set pos and hpr functions ###
 
     ### These are the component functions that are invoked
@@ -299,6 +331,23 @@ class DistributedSmoothNode(DistributedNode.DistributedNode,
     def setComponentR(self, r):
         self.smoother.setR(r)
     @report(types = ['args'], dConfigParam = 'smoothnode')
+    def setComponentDX(self, dx):
+        self.smoother.addX(dx)
+    @report(types = ['args'], dConfigParam = 'smoothnode')
+    def setComponentDY(self, dy):
+        self.smoother.addY(dy)
+    @report(types = ['args'], dConfigParam = 'smoothnode')
+    def setComponentDZ(self, dz):
+        self.smoother.addZ(dz)
+    @report(types = ['args'], dConfigParam = 'smoothnode')
+    def setComponentQH(self, qh):
+        self.smoother.setQuantizedH(qh)
+    @report(types = ['args'], dConfigParam = 'smoothnode')
+    def setComponentDT(self, timestamp):
+        # The delta components are never stored by the server, so
+        # this is always a live update.
+        self.setComponentTLive(timestamp)
+    @report(types = ['args'], dConfigParam = 'smoothnode')
     def setComponentL(self, l):
         if (l != self.zoneId):
             # only perform set location if location is different
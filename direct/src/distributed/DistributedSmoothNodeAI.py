@@ -1,3 +1,4 @@
+from pandac.PandaModules import SmoothMover
 import DistributedNodeAI
 import DistributedSmoothNodeBase
 
@@ -12,8 +13,15 @@ class DistributedSmoothNodeAI(DistributedNodeAI.DistributedNodeAI,
         DistributedNodeAI.DistributedNodeAI.generate(self)
         DistributedSmoothNodeBase.DistributedSmoothNodeBase.generate(self)
         self.cnode.setRepository(self.air, 1, self.air.ourChannel)
+        if config.GetBool('smooth-node-native-updates', 0):
+            # Apply the incoming setSm* and setComponent* updates to
+            # the node directly in C++, without calling the methods
+            # below.
+            self.cnode.initialize(self, self.dclass, self.doId)
+            self.cnode.startReceiveUpdates()
 
     def disable(self):
+        self.cnode.stopReceiveUpdates()
         DistributedSmoothNodeBase.DistributedSmoothNodeBase.disable(self)
         DistributedNodeAI.DistributedNodeAI.disable(self)
 
@@ -63,6 +71,25 @@ class DistributedSmoothNodeAI(DistributedNodeAI.DistributedNodeAI,
     def setSmPosHprL(self, l, x, y, z, h, p, r, t=None):
         self.setPosHpr(x, y, z, h, p, r)
 
+    def setSmQH(self, qh, t=None):
+        self.setComponentQH(qh)
+
+    def setSmDXY(self, dx, dy, t=None):
+        self.setComponentDX(dx)
+        self.setComponentDY(dy)
+
+    def setSmDXYQH(self, dx, dy, qh, t=None):
+        self.setComponentDX(dx)
+        self.setComponentDY(dy)
+        self.setComponentQH(qh)
+
+    def setSmDPos(self, dx, dy, dz, t=None):
+        self.setPos(self.getX() + dx, self.getY() + dy, self.getZ() + dz)
+
+    def setSmDPosQH(self, dx, dy, dz, qh, t=None):
+        self.setPos(self.getX() + dx, self.getY() + dy, self.getZ() + dz)
+        self.setComponentQH(qh)
+
     def clearSmoothing(self, bogus = None):
         pass
 
@@ -80,10 +107,20 @@ class DistributedSmoothNodeAI(DistributedNodeAI.DistributedNodeAI,
         self.setP(p)
     def setComponentR(self, r):
         self.setR(r)
+    def setComponentDX(self, dx):
+        self.setX(self.getX() + dx)
+    def setComponentDY(self, dy):
+        self.setY(self.getY() + dy)
+    def setComponentDZ(self, dz):
+        self.setZ(self.getZ() + dz)
+    def setComponentQH(self, qh):
+        self.setH(SmoothMover.dequantizeH(qh))
     def setComponentL(self, l):
         pass
     def setComponentT(self, t):
         pass
+    def setComponentDT(self, t):
+        pass
 
     def getComponentX(self):
         return self.getX()
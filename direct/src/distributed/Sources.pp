@@ -6,7 +6,7 @@
 
   #define TARGET p3distributed
   #define LOCAL_LIBS \
-    p3directbase p3dcparser
+    p3directbase p3dcparser p3deadrec
   #define OTHER_LIBS \
     p3event:c p3downloader:c panda:m p3express:c pandaexpress:m \
     p3interrogatedb:c p3dconfig:c p3dtoolconfig:m \
@@ -19,7 +19,65 @@
     cConnectionRepository.cxx cConnectionRepository.I \
     cConnectionRepository.h \
     cDistributedSmoothNodeBase.cxx cDistributedSmoothNodeBase.I \
-    cDistributedSmoothNodeBase.h
+    cDistributedSmoothNodeBase.h \
+    cDistributedUpdateHandler.cxx cDistributedUpdateHandler.h
 
   #define IGATESCAN all
 #end lib_target
+
+#begin test_bin_target
+  #define BUILD_TARGET $[HAVE_PYTHON]
+  #define USE_PACKAGES python openssl native_net net
+
+  #define TARGET test_smooth_node_bandwidth
+  #define LOCAL_LIBS \
+    p3distributed p3deadrec p3dcparser p3directbase
+  #define OTHER_LIBS \
+    p3event:c p3downloader:c panda:m p3express:c pandaexpress:m \
+    p3interrogatedb:c p3dconfig:c p3dtoolconfig:m \
+    p3dtoolutil:c p3dtoolbase:c p3dtool:m \
+    p3prc:c p3pstatclient:c p3pandabase:c p3linmath:c p3putil:c \
+    p3pipeline:c $[if $[HAVE_NET],p3net:c] $[if $[WANT_NATIVE_NET],p3nativenet:c]
+
+  #define SOURCES \
+    test_smooth_node_bandwidth.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define BUILD_TARGET $[HAVE_PYTHON]
+  #define USE_PACKAGES python openssl native_net net
+
+  #define TARGET test_native_update
+  #define LOCAL_LIBS \
+    p3distributed p3dcparser p3directbase
+  #define OTHER_LIBS \
+    p3event:c p3downloader:c panda:m p3express:c pandaexpress:m \
+    p3interrogatedb:c p3dconfig:c p3dtoolconfig:m \
+    p3dtoolutil:c p3dtoolbase:c p3dtool:m \
+    p3prc:c p3pstatclient:c p3pandabase:c p3linmath:c p3putil:c \
+    p3pipeline:c $[if $[HAVE_NET],p3net:c] $[if $[WANT_NATIVE_NET],p3nativenet:c]
+
+  #define SOURCES \
+    test_native_update.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define BUILD_TARGET $[HAVE_PYTHON]
+  #define USE_PACKAGES python openssl native_net net
+
+  #define TARGET test_coalesce_updates
+  #define LOCAL_LIBS \
+    p3distributed p3dcparser p3directbase
+  #define OTHER_LIBS \
+    p3event:c p3downloader:c panda:m p3express:c pandaexpress:m \
+    p3interrogatedb:c p3dconfig:c p3dtoolconfig:m \
+    p3dtoolutil:c p3dtoolbase:c p3dtool:m \
+    p3prc:c p3pstatclient:c p3pandabase:c p3linmath:c p3putil:c \
+    p3pipeline:c $[if $[HAVE_NET],p3net:c] $[if $[WANT_NATIVE_NET],p3nativenet:c]
+
+  #define SOURCES \
+    test_coalesce_updates.cxx
+
+#end test_bin_target
@@ -13,6 +13,7 @@
 ////////////////////////////////////////////////////////////////////
 
 #include "cConnectionRepository.h"
+#include "cDistributedUpdateHandler.h"
 #include "dcmsgtypes.h"
 #include "dcClass.h"
 #include "dcPacker.h"
@@ -74,7 +75,14 @@ CConnectionRepository(bool has_owner_view, bool threaded_net) :
   _handle_c_updates(true),
   _want_message_bundling(true),
   _bundling_msgs(0),
-  _in_quiet_zone(0)
+  _in_quiet_zone(0),
+  _coalesce_interval(coalesce_updates_interval),
+  _coalesce_max_bytes(max(coalesce_updates_max_bytes.get_value(), 0)),
+  _coalesced_bytes(0),
+  _coalesce_start(0.0),
+  _num_updates_queued(0),
+  _num_updates_coalesced(0),
+  _num_coalesce_flushes(0)
 {
 #if defined(HAVE_NET) && defined(SIMULATE_NETWORK_DELAY)
   if (min_lag != 0.0 || max_lag != 0.0) {
@@ -293,6 +301,8 @@ check_datagram() {
   if (_simulated_disconnect) {
     return false;
   }
+  consider_flush_coalesced_updates();
+
   #ifdef WANT_NATIVE_NET
   if(_native)
     _bdc.Flush();
@@ -342,9 +352,13 @@ check_datagram() {
     }
 
     switch (_msg_type) {
-#ifdef HAVE_PYTHON
     case CLIENT_OBJECT_SET_FIELD:
     case STATESERVER_OBJECT_SET_FIELD:
+      if (handle_native_update()) {
+        // A C++ handler has already taken care of this update.
+        break;
+      }
+#ifdef HAVE_PYTHON
       if (_handle_c_updates) {
         if (_has_owner_view) {
           if (!handle_update_field_owner()) {
@@ -360,6 +374,8 @@ check_datagram() {
         return true;
       }
       break;
+#else
+      return true;
 #endif  // HAVE_PYTHON
       
     default:
@@ -431,8 +447,9 @@ is_connected() {
 //       Access: Published
 //  Description: Queues the indicated datagram for sending to the
 //               server.  It may not get sent immediately if
-//               collect_tcp is in effect; call flush() to guarantee
-//               it is sent now.
+//               collect_tcp is in effect, or if it is a field update
+//               and set_coalesce_interval() is in effect; call
+//               flush() to guarantee it is sent now.
 ////////////////////////////////////////////////////////////////////
 bool CConnectionRepository::
 send_datagram(const Datagram &dg) {
@@ -453,6 +470,30 @@ send_datagram(const Datagram &dg) {
     return true;
   }
 
+  if (_coalesce_interval > 0.0 && coalesce_update(dg)) {
+    return true;
+  }
+
+  // Anything held for coalescing was sent before this datagram, so it
+  // must go out first.
+  flush_coalesced_updates();
+  return do_send_datagram(dg);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CConnectionRepository::do_send_datagram
+//       Access: Private
+//  Description: Sends the indicated datagram on whichever connection
+//               is open, without bundling or coalescing it.
+////////////////////////////////////////////////////////////////////
+bool CConnectionRepository::
+do_send_datagram(const Datagram &dg) {
+  if (_simulated_disconnect) {
+    distributed_cat.warning()
+      << "Unable to send datagram during simulated disconnect.\n";
+    return false;
+  }
+
 #ifdef WANT_NATIVE_NET
   if(_native)
     return _bdc.SendMessage(dg);
@@ -540,7 +581,13 @@ send_message_bundle(unsigned int channel, unsigned int sender_channel) {
       dg.add_string(*bmi);
     }
 
-    send_datagram(dg);
+    // The bundle is not a field update of its own, so it is never
+    // held for coalescing.
+    if (get_verbose()) {
+      describe_message(nout, "SEND", dg);
+    }
+    flush_coalesced_updates();
+    do_send_datagram(dg);
   }
 }
 
@@ -587,6 +634,8 @@ consider_flush() {
     return false;
   }
 
+  consider_flush_coalesced_updates();
+
 #ifdef WANT_NATIVE_NET
   if(_native)
     return true;  //Maybe we should just flush here for now?
@@ -621,6 +670,8 @@ flush() {
   if (_simulated_disconnect) {
     return false;
   }
+
+  flush_coalesced_updates();
   #ifdef WANT_NATIVE_NET
   if(_native)
     return _bdc.Flush();
@@ -650,6 +701,15 @@ void CConnectionRepository::
 disconnect() {
   ReMutexHolder holder(_lock);
 
+  // Send any updates we were holding while we still can.
+  if (!_simulated_disconnect) {
+    flush_coalesced_updates();
+  }
+  _coalesced_updates.clear();
+  _coalesced_index.clear();
+  _coalesce_barriers.clear();
+  _coalesced_bytes = 0;
+
   #ifdef WANT_NATIVE_NET
   if(_native) {
     _bdc.Reset();
@@ -690,6 +750,203 @@ shutdown() {
   #endif  // HAVE_NET
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: CConnectionRepository::coalesce_update
+//       Access: Private
+//  Description: If the indicated datagram is a field update, adds it
+//               to the updates being held for coalescing and returns
+//               true.  If it is an update to a ram field, any earlier
+//               update still being held for the same field of the
+//               same object, sent to the same channel, is superseded
+//               and will not be sent, unless some other update to
+//               that object that cannot be superseded is held between
+//               the two.  Returns false if the datagram is some other
+//               kind of message, which should be sent now.
+////////////////////////////////////////////////////////////////////
+bool CConnectionRepository::
+coalesce_update(const Datagram &dg) {
+  DatagramIterator di(dg);
+  CHANNEL_TYPE channel = 0;
+  int num_channels = 1;
+  int expected_msg_type = CLIENT_OBJECT_SET_FIELD;
+
+  if (!_client_datagram) {
+    if (di.get_remaining_size() < 1) {
+      return false;
+    }
+    num_channels = di.get_uint8();
+    if (di.get_remaining_size() < (size_t)(num_channels + 1) * 8) {
+      return false;
+    }
+    for (int i = 0; i < num_channels; ++i) {
+      CHANNEL_TYPE schan = di.get_uint64();
+      if (i == 0) {
+        channel = schan;
+      }
+    }
+    di.get_uint64();  // msg_sender
+    expected_msg_type = STATESERVER_OBJECT_SET_FIELD;
+  }
+
+  if (di.get_remaining_size() < 8) {
+    return false;
+  }
+  int msg_type = di.get_uint16();
+  if (msg_type != expected_msg_type) {
+    return false;
+  }
+  DOID_TYPE do_id = di.get_uint32();
+  int field_id = di.get_uint16();
+
+  if (_coalesced_updates.empty()) {
+    _coalesce_start = ClockObject::get_global_clock()->get_real_time();
+  }
+
+  // We can only tell whether the field is a ram field if field
+  // numbers are unique across the whole dc file.
+  const DCField *field = NULL;
+  if (dc_multiple_inheritance) {
+    field = _dc_file.get_field_by_index(field_id);
+  }
+
+  if (num_channels == 1 && field != (DCField *)NULL && field->is_ram()) {
+    CoalesceKey key;
+    key._channel = channel;
+    key._do_id = do_id;
+    key._field_id = field_id;
+
+    pair<CoalescedIndex::iterator, bool> result =
+      _coalesced_index.insert(CoalescedIndex::value_type(key, _coalesced_updates.size()));
+    if (!result.second) {
+      size_t prev_index = (*result.first).second;
+      CoalesceBarriers::const_iterator bi = _coalesce_barriers.find(do_id);
+      if (bi == _coalesce_barriers.end() || (*bi).second < prev_index) {
+        // The ram field will hold only the most recent value, so
+        // there is no point in sending the previous one.
+        CoalescedUpdate &prev = _coalesced_updates[prev_index];
+        prev._superseded = true;
+        _coalesced_bytes -= prev._dg.get_length();
+        prev._dg.clear();
+        ++_num_updates_coalesced;
+      }
+      // Otherwise, the receiver must see the previous value before
+      // the update that follows it, so both are sent.
+      (*result.first).second = _coalesced_updates.size();
+    }
+
+  } else {
+    // No later update may be moved ahead of this one by superseding
+    // an update held before it.
+    _coalesce_barriers[do_id] = _coalesced_updates.size();
+  }
+
+  _coalesced_updates.push_back(CoalescedUpdate());
+  CoalescedUpdate &update = _coalesced_updates.back();
+  update._dg = dg;
+  update._superseded = false;
+  _coalesced_bytes += dg.get_length();
+  ++_num_updates_queued;
+
+  if (_coalesced_bytes >= _coalesce_max_bytes) {
+    flush_coalesced_updates();
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CConnectionRepository::flush_coalesced_updates
+//       Access: Private
+//  Description: Sends all of the field updates being held for
+//               coalescing, except those that have been superseded,
+//               in the order they were originally sent.  Returns true
+//               on success, false if any could not be sent.
+////////////////////////////////////////////////////////////////////
+bool CConnectionRepository::
+flush_coalesced_updates() {
+  if (_coalesced_updates.empty()) {
+    return true;
+  }
+
+  ++_num_coalesce_flushes;
+  bool okflag = true;
+  CoalescedUpdates::const_iterator ui;
+  for (ui = _coalesced_updates.begin(); ui != _coalesced_updates.end(); ++ui) {
+    if (!(*ui)._superseded) {
+      if (!do_send_datagram((*ui)._dg)) {
+        okflag = false;
+      }
+    }
+  }
+
+  _coalesced_updates.clear();
+  _coalesced_index.clear();
+  _coalesce_barriers.clear();
+  _coalesced_bytes = 0;
+  return okflag;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CConnectionRepository::consider_flush_coalesced_updates
+//       Access: Private
+//  Description: Sends the field updates being held for coalescing if
+//               the oldest of them has been held for the coalesce
+//               interval.
+////////////////////////////////////////////////////////////////////
+void CConnectionRepository::
+consider_flush_coalesced_updates() {
+  if (!_coalesced_updates.empty()) {
+    double now = ClockObject::get_global_clock()->get_real_time();
+    if (now - _coalesce_start >= _coalesce_interval) {
+      flush_coalesced_updates();
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CConnectionRepository::add_update_handler
+//       Access: Public
+//  Description: Registers a C++ object to receive the field updates
+//               for the indicated doId directly, instead of passing
+//               them to the Python object.  The arguments of each
+//               update are unpacked in place from the received
+//               datagram and passed to the handler's handle_update()
+//               method; if the handler declines a particular field,
+//               the update goes to Python as usual.
+//
+//               The handler takes precedence over both the owner
+//               view and the visible view of the object.  Updates
+//               received while in the quiet zone are always passed
+//               to Python, which decides whether to drop them.
+//
+//               The handler is not owned by the repository; it must
+//               be removed with remove_update_handler() before it is
+//               destroyed.  Only one handler may be registered for a
+//               given doId; a new one replaces the old.
+////////////////////////////////////////////////////////////////////
+void CConnectionRepository::
+add_update_handler(DOID_TYPE do_id, DCClass *dclass,
+                   CDistributedUpdateHandler *handler) {
+  ReMutexHolder holder(_lock);
+  nassertv(dclass != (DCClass *)NULL && handler != (CDistributedUpdateHandler *)NULL);
+
+  UpdateHandlerDef &def = _update_handlers[do_id];
+  def._dclass = dclass;
+  def._handler = handler;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CConnectionRepository::remove_update_handler
+//       Access: Public
+//  Description: Removes the C++ handler previously registered for
+//               the indicated doId with add_update_handler(), if
+//               any.  Subsequent updates for the doId go to Python.
+////////////////////////////////////////////////////////////////////
+void CConnectionRepository::
+remove_update_handler(DOID_TYPE do_id) {
+  ReMutexHolder holder(_lock);
+  _update_handlers.erase(do_id);
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: CConnectionRepository::do_check_datagram
 //       Access: Private
@@ -725,6 +982,57 @@ do_check_datagram() {
   return false;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: CConnectionRepository::handle_native_update
+//       Access: Private
+//  Description: Offers the update message in _di to the C++ handler
+//               registered for its doId, if any.  The field is
+//               unpacked directly from the datagram buffer.  Returns
+//               true if the handler took the update, in which case
+//               _di is advanced past it, or false if it should be
+//               handled as usual, in which case _di is untouched.
+////////////////////////////////////////////////////////////////////
+bool CConnectionRepository::
+handle_native_update() {
+  if (_update_handlers.empty() || _in_quiet_zone) {
+    return false;
+  }
+
+  // Read the doId and field number without advancing _di, in case we
+  // end up passing the update along after all.
+  DCPacker packer;
+  packer.set_unpack_data(_di);
+  DOID_TYPE do_id = packer.raw_unpack_uint32();
+  UpdateHandlers::const_iterator hi = _update_handlers.find(do_id);
+  if (hi == _update_handlers.end()) {
+    return false;
+  }
+
+  int field_id = packer.raw_unpack_uint16();
+  if (packer.had_pack_error()) {
+    return false;
+  }
+  const DCField *field = (*hi).second._dclass->get_field_by_index(field_id);
+  if (field == (DCField *)NULL) {
+    return false;
+  }
+
+  PStatTimer timer(_update_pcollector);
+  packer.begin_unpack(field);
+  if (!(*hi).second._handler->handle_update(field, packer)) {
+    packer.end_unpack();
+    return false;
+  }
+
+  if (!packer.end_unpack()) {
+    distributed_cat.warning()
+      << "Error unpacking update for " << field->get_name()
+      << " on object " << do_id << "\n";
+  }
+  _di.skip_bytes(packer.get_num_unpacked_bytes());
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: CConnectionRepository::handle_update_field
 //       Access: Private
@@ -868,7 +1176,7 @@ handle_update_field_owner() {
 
       // check if we should forward this update to the owner view
       DCPacker packer;
-      packer.set_unpack_data(_di.get_remaining_bytes());
+      packer.set_unpack_data(_di);
       int field_id = packer.raw_unpack_uint16();
       DCField *field = dclass->get_field_by_index(field_id);
       if (field->is_ownrecv()) {
@@ -910,7 +1218,7 @@ handle_update_field_owner() {
 
       // check if we should forward this update to the owner view
       DCPacker packer;
-      packer.set_unpack_data(_di.get_remaining_bytes());
+      packer.set_unpack_data(_di);
       int field_id = packer.raw_unpack_uint16();
       DCField *field = dclass->get_field_by_index(field_id);
       if (true) {//field->is_broadcast()) {
@@ -952,7 +1260,7 @@ describe_message(ostream &out, const string &prefix,
                  const Datagram &dg) const {
   DCPacker packer;
   
-  packer.set_unpack_data(dg.get_message());
+  packer.set_unpack_data((const char *)dg.get_data(), dg.get_length(), false);
   CHANNEL_TYPE do_id;
   int msg_type;
   bool is_update = false;
@@ -1102,6 +1410,7 @@ bool CConnectionRepository::check_datagram_ai(PyObject *PycallBackFunction)
   PyObject *doId2do = NULL; 
   float startTime =0;
   float endTime = 0;
+  consider_flush_coalesced_updates();
   // this seems weird...here
   _bdc.Flush();
   while (_bdc.GetMessage(_dg))
@@ -1124,24 +1433,29 @@ bool CConnectionRepository::check_datagram_ai(PyObject *PycallBackFunction)
 
       if( _msg_type == STATESERVER_OBJECT_SET_FIELD)
       {
-          if(doId2do == NULL)
+          // A C++ handler may take care of this update; if not, it
+          // goes to the Python object.
+          if (!handle_native_update())
           {
-              // this is my attemp to take it out of the inner loop  RHH
-              doId2do =PyObject_GetAttrString(_python_repository, "doId2do");
-              nassertr(doId2do != NULL, false);
-          }
+              if(doId2do == NULL)
+              {
+                  // this is my attemp to take it out of the inner loop  RHH
+                  doId2do =PyObject_GetAttrString(_python_repository, "doId2do");
+                  nassertr(doId2do != NULL, false);
+              }
 
-          if (!handle_update_field_ai(doId2do)) 
-          {
-              Py_XDECREF(doId2do);
-              if (_time_warning > 0) {
-                endTime = ClockObject::get_global_clock()->get_real_time(); 
-                if ( _time_warning < (endTime - startTime)) {
-                  nout << "msg " << _msg_type <<" from " << _msg_sender << " took "<<  (endTime-startTime) << "secs to process\n";
-                  _dg.dump_hex(nout,2);
-                }
+              if (!handle_update_field_ai(doId2do)) 
+              {
+                  Py_XDECREF(doId2do);
+                  if (_time_warning > 0) {
+                    endTime = ClockObject::get_global_clock()->get_real_time(); 
+                    if ( _time_warning < (endTime - startTime)) {
+                      nout << "msg " << _msg_type <<" from " << _msg_sender << " took "<<  (endTime-startTime) << "secs to process\n";
+                      _dg.dump_hex(nout,2);
+                    }
+                  }
+                  return false; 
               }
-              return false; 
           }
       }
       else
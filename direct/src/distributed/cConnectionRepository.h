@@ -26,6 +26,7 @@
 #include "clockObject.h"
 #include "reMutex.h"
 #include "reMutexHolder.h"
+#include "pmap.h"
 
 #ifdef HAVE_NET
 #include "queuedConnectionManager.h"
@@ -42,6 +43,8 @@
 class URLSpec;
 class HTTPChannel;
 class SocketStream;
+class DCClass;
+class CDistributedUpdateHandler;
 
 ////////////////////////////////////////////////////////////////////
 //       Class : CConnectionRepository
@@ -150,6 +153,16 @@ PUBLISHED:
   BLOCKING void abandon_message_bundles();
   BLOCKING void bundle_msg(const Datagram &dg);
 
+  BLOCKING INLINE void set_coalesce_interval(double interval);
+  BLOCKING INLINE double get_coalesce_interval() const;
+  BLOCKING INLINE void set_coalesce_max_bytes(size_t max_bytes);
+  BLOCKING INLINE size_t get_coalesce_max_bytes() const;
+  BLOCKING INLINE int get_num_pending_updates() const;
+  BLOCKING INLINE int get_num_updates_queued() const;
+  BLOCKING INLINE int get_num_updates_coalesced() const;
+  BLOCKING INLINE int get_num_coalesce_flushes() const;
+  BLOCKING INLINE void reset_coalesce_counts();
+
   BLOCKING bool consider_flush();
   BLOCKING bool flush();
 
@@ -166,6 +179,11 @@ PUBLISHED:
   INLINE void set_time_warning(float time_warning);
   INLINE float get_time_warning() const;
 
+public:
+  void add_update_handler(DOID_TYPE do_id, DCClass *dclass,
+                          CDistributedUpdateHandler *handler);
+  void remove_update_handler(DOID_TYPE do_id);
+
 private:
 #ifdef HAVE_PYTHON
 #ifdef WANT_NATIVE_NET
@@ -174,7 +192,12 @@ private:
 #endif
 
 
+  bool do_send_datagram(const Datagram &dg);
+  bool coalesce_update(const Datagram &dg);
+  bool flush_coalesced_updates();
+  void consider_flush_coalesced_updates();
   bool do_check_datagram();
+  bool handle_native_update();
   bool handle_update_field();
   bool handle_update_field_owner();
 
@@ -230,6 +253,52 @@ private:
   typedef std::vector< string > BundledMsgVector;
   BundledMsgVector _bundle_msgs;
 
+  // The outgoing field updates held while coalesce_interval is in
+  // effect, in the order they were sent.  An update that has been
+  // superseded by a later one is left in place, but not sent.
+  class CoalescedUpdate {
+  public:
+    Datagram _dg;
+    bool _superseded;
+  };
+  typedef pvector<CoalescedUpdate> CoalescedUpdates;
+  CoalescedUpdates _coalesced_updates;
+
+  // The key that identifies the updates that supersede each other:
+  // the same field of the same object, sent to the same channel.
+  class CoalesceKey {
+  public:
+    INLINE bool operator < (const CoalesceKey &other) const;
+
+    CHANNEL_TYPE _channel;
+    DOID_TYPE _do_id;
+    int _field_id;
+  };
+  typedef pmap<CoalesceKey, size_t> CoalescedIndex;
+  CoalescedIndex _coalesced_index;
+
+  // For each doId, the index of the most recent update held for it
+  // that cannot be superseded, such as an update to a non-ram field.
+  // A ram update held before that one must still be sent before it.
+  typedef pmap<DOID_TYPE, size_t> CoalesceBarriers;
+  CoalesceBarriers _coalesce_barriers;
+
+  double _coalesce_interval;
+  size_t _coalesce_max_bytes;
+  size_t _coalesced_bytes;
+  double _coalesce_start;
+  int _num_updates_queued;
+  int _num_updates_coalesced;
+  int _num_coalesce_flushes;
+
+  class UpdateHandlerDef {
+  public:
+    DCClass *_dclass;
+    CDistributedUpdateHandler *_handler;
+  };
+  typedef pmap<DOID_TYPE, UpdateHandlerDef> UpdateHandlers;
+  UpdateHandlers _update_handlers;
+
   static PStatCollector _update_pcollector;
 };
 
@@ -16,8 +16,11 @@
 #include "cConnectionRepository.h"
 #include "dcField.h"
 #include "dcClass.h"
+#include "dcAtomicField.h"
+#include "dcMolecularField.h"
 #include "dcmsgtypes.h"
 #include "config_distributed.h"
+#include "smoothMover.h"
 
 static const PN_stdfloat smooth_node_epsilon = 0.01;
 static const double network_time_precision = 100.0;  // Matches ClockDelta.py
@@ -39,6 +42,15 @@ CDistributedSmoothNodeBase() {
 
   _currL[0] = 0;
   _currL[1] = 0;
+
+  _update_repository = NULL;
+  _update_do_id = 0;
+
+  _delta_encoding = smooth_node_delta_encoding;
+  _keyframe_needed = true;
+  _sent_pos[0] = _sent_pos[1] = _sent_pos[2] = 0;
+  _sent_h = 0.0f;
+  _num_deltas = 0;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -48,6 +60,7 @@ CDistributedSmoothNodeBase() {
 ////////////////////////////////////////////////////////////////////
 CDistributedSmoothNodeBase::
 ~CDistributedSmoothNodeBase() {
+  stop_receive_updates();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -70,6 +83,7 @@ initialize(const NodePath &node_path, DCClass *dclass, CHANNEL_TYPE do_id) {
   _store_xyz = _node_path.get_pos();
   _store_hpr = _node_path.get_hpr();
   _store_stop = false;
+  _keyframe_needed = true;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -82,6 +96,7 @@ send_everything() {
   _currL[0] = _currL[1];
   d_setSmPosHprL(_store_xyz[0], _store_xyz[1], _store_xyz[2], 
                  _store_hpr[0], _store_hpr[1], _store_hpr[2], _currL[0]);
+  reset_sent_state();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -93,6 +108,11 @@ send_everything() {
 ////////////////////////////////////////////////////////////////////
 void CDistributedSmoothNodeBase::
 broadcast_pos_hpr_full() {
+  if (_delta_encoding) {
+    broadcast_delta(F_new_x | F_new_y | F_new_z | F_new_h | F_new_p | F_new_r);
+    return;
+  }
+
   LPoint3 xyz = _node_path.get_pos();
   LVecBase3 hpr = _node_path.get_hpr();
 
@@ -200,6 +220,11 @@ broadcast_pos_hpr_full() {
 ////////////////////////////////////////////////////////////////////
 void CDistributedSmoothNodeBase::
 broadcast_pos_hpr_xyh() {
+  if (_delta_encoding) {
+    broadcast_delta(F_new_x | F_new_y | F_new_h);
+    return;
+  }
+
   LPoint3 xyz = _node_path.get_pos();
   LVecBase3 hpr = _node_path.get_hpr();
 
@@ -252,6 +277,11 @@ broadcast_pos_hpr_xyh() {
 ////////////////////////////////////////////////////////////////////
 void CDistributedSmoothNodeBase::
 broadcast_pos_hpr_xy() {
+  if (_delta_encoding) {
+    broadcast_delta(F_new_x | F_new_y);
+    return;
+  }
+
   LPoint3 xyz = _node_path.get_pos();
 
   int flags = 0;
@@ -280,6 +310,156 @@ broadcast_pos_hpr_xy() {
   }
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: CDistributedSmoothNodeBase::broadcast_delta
+//       Access: Private
+//  Description: The delta-encoded implementation of the
+//               broadcast_pos_hpr_*() methods.  Examines the
+//               components of the pos/hpr indicated by the bits of
+//               consider, and broadcasts the appropriate messages.
+//
+//               The change in X, Y, and Z since the last message is
+//               sent in tenths of a unit, and H is sent quantized, in
+//               one of the setSmD* or setSmQH messages.  A full
+//               setSmPosHpr is sent instead as a keyframe when a
+//               delta is too large to encode, when P or R changes,
+//               after smooth-node-keyframe-interval delta messages,
+//               and once the node stops moving, so that the ram
+//               fields are kept reasonably current for receivers
+//               that arrive later.
+////////////////////////////////////////////////////////////////////
+void CDistributedSmoothNodeBase::
+broadcast_delta(int consider) {
+  LPoint3 xyz = _node_path.get_pos();
+  LVecBase3 hpr = _node_path.get_hpr();
+
+  int flags = 0;
+  int delta[3];
+  bool in_range = true;
+  for (int i = 0; i < 3; ++i) {
+    delta[i] = 0;
+    if ((consider & (F_new_x << i)) != 0) {
+      _store_xyz[i] = xyz[i];
+      delta[i] = quantize_pos(xyz[i]) - _sent_pos[i];
+      if (delta[i] != 0) {
+        flags |= (F_new_x << i);
+        in_range = in_range && (delta[i] >= -128 && delta[i] <= 127);
+      }
+    }
+  }
+
+  int qh = 0;
+  if ((consider & F_new_h) != 0) {
+    // Send a new quantized heading once the heading has drifted more
+    // than half a step from the one the receivers have.
+    _store_hpr[0] = hpr[0];
+    qh = SmoothMover::quantize_h(hpr[0]);
+    PN_stdfloat diff = cabs(fmod(hpr[0] - _sent_h, (PN_stdfloat)360.0));
+    if (diff > (PN_stdfloat)180.0) {
+      diff = (PN_stdfloat)360.0 - diff;
+    }
+    if (diff > (PN_stdfloat)(180.0 / 256.0)) {
+      flags |= F_new_h;
+    }
+  }
+
+  for (int i = 1; i < 3; ++i) {
+    if ((consider & (F_new_h << i)) != 0 &&
+        !IS_THRESHOLD_EQUAL(_store_hpr[i], hpr[i], smooth_node_epsilon)) {
+      _store_hpr[i] = hpr[i];
+      flags |= (F_new_h << i);
+    }
+  }
+
+  if (_currL[0] != _currL[1]) {
+    // location (zoneId) has changed, send out all info
+    _currL[0] = _currL[1];
+    _store_stop = false;
+    d_setSmPosHprL(_store_xyz[0], _store_xyz[1], _store_xyz[2], 
+                   _store_hpr[0], _store_hpr[1], _store_hpr[2], _currL[0]);
+    reset_sent_state();
+
+  } else if (flags == 0) {
+    if (_num_deltas != 0 || _keyframe_needed) {
+      // Bring the ram fields up to date as we stop.  The keyframe
+      // serves as the stop message, since it repeats the position
+      // with a new timestamp.
+      _store_stop = true;
+      send_keyframe();
+
+    } else if (!_store_stop) {
+      // No change.  Send one and only one "stop" message.
+      _store_stop = true;
+      d_setSmStop();
+    }
+
+  } else if (_keyframe_needed || !in_range ||
+             (flags & (F_new_p | F_new_r)) != 0 ||
+             _num_deltas >= smooth_node_keyframe_interval) {
+    _store_stop = false;
+    send_keyframe();
+
+  } else {
+    _store_stop = false;
+    bool new_h = ((flags & F_new_h) != 0);
+    if (only_changed(flags, F_new_h)) {
+      d_setSmQH(qh);
+
+    } else if ((flags & F_new_z) == 0) {
+      if (new_h) {
+        d_setSmDXYQH(delta[0], delta[1], qh);
+      } else {
+        d_setSmDXY(delta[0], delta[1]);
+      }
+
+    } else {
+      if (new_h) {
+        d_setSmDPosQH(delta[0], delta[1], delta[2], qh);
+      } else {
+        d_setSmDPos(delta[0], delta[1], delta[2]);
+      }
+    }
+
+    for (int i = 0; i < 3; ++i) {
+      _sent_pos[i] += delta[i];
+    }
+    if (new_h) {
+      _sent_h = SmoothMover::dequantize_h(qh);
+    }
+    ++_num_deltas;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CDistributedSmoothNodeBase::send_keyframe
+//       Access: Private
+//  Description: Broadcasts the complete stored pos/hpr, from which
+//               subsequent delta-encoded messages are measured.
+////////////////////////////////////////////////////////////////////
+void CDistributedSmoothNodeBase::
+send_keyframe() {
+  d_setSmPosHpr(_store_xyz[0], _store_xyz[1], _store_xyz[2], 
+                _store_hpr[0], _store_hpr[1], _store_hpr[2]);
+  reset_sent_state();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CDistributedSmoothNodeBase::reset_sent_state
+//       Access: Private
+//  Description: Records that the complete stored pos/hpr has just
+//               been sent, as the base for subsequent delta-encoded
+//               messages.
+////////////////////////////////////////////////////////////////////
+void CDistributedSmoothNodeBase::
+reset_sent_state() {
+  for (int i = 0; i < 3; ++i) {
+    _sent_pos[i] = quantize_pos(_store_xyz[i]);
+  }
+  _sent_h = _store_hpr[0];
+  _num_deltas = 0;
+  _keyframe_needed = false;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: CDistributedSmoothNodeBase::begin_send_update
 //       Access: Private
@@ -394,3 +574,197 @@ print_curr_l() {
   cout << "printCurrL: sent l: " << _currL[1] << " last set l: " << _currL[0] << "\n";
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: CDistributedSmoothNodeBase::start_receive_updates
+//       Access: Published
+//  Description: Registers this object with the repository to receive
+//               the smooth position updates (setSmPos, setSmH, and so
+//               on, and the individual setComponent fields) for its
+//               doId directly.  Each update is unpacked in place from
+//               the received datagram and applied immediately to the
+//               node's pos and hpr, without calling the Python
+//               methods; the timestamp and location are ignored.
+//               This is appropriate for an AI object, whose node
+//               simply follows the updates, but not for a client
+//               object that smooths them.
+//
+//               Any other field updates still go to Python.  You
+//               must call initialize() and set_repository() first.
+////////////////////////////////////////////////////////////////////
+void CDistributedSmoothNodeBase::
+start_receive_updates() {
+  nassertv(_repository != (CConnectionRepository *)NULL &&
+           _dclass != (DCClass *)NULL);
+  stop_receive_updates();
+
+  _update_repository = _repository;
+  _update_do_id = (DOID_TYPE)_do_id;
+  _update_repository->add_update_handler(_update_do_id, _dclass, this);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CDistributedSmoothNodeBase::stop_receive_updates
+//       Access: Published
+//  Description: Undoes the effect of a previous call to
+//               start_receive_updates(), so that the smooth position
+//               updates go to Python again.
+////////////////////////////////////////////////////////////////////
+void CDistributedSmoothNodeBase::
+stop_receive_updates() {
+  if (_update_repository != (CConnectionRepository *)NULL) {
+    _update_repository->remove_update_handler(_update_do_id);
+    _update_repository = NULL;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CDistributedSmoothNodeBase::handle_update
+//       Access: Public, Virtual
+//  Description: Called by the repository when an update arrives for
+//               this object, after start_receive_updates().  If the
+//               field is one of the smooth position fields, unpacks
+//               its arguments and applies them to the node, and
+//               returns true; otherwise, returns false to let Python
+//               handle it.
+////////////////////////////////////////////////////////////////////
+bool CDistributedSmoothNodeBase::
+handle_update(const DCField *field, DCPacker &packer) {
+  const Components &components = get_components(field);
+  if (components.empty() || _node_path.is_empty()) {
+    return false;
+  }
+
+  LPoint3 xyz = _node_path.get_pos();
+  LVecBase3 hpr = _node_path.get_hpr();
+  bool new_pos = false;
+  bool new_hpr = false;
+
+  packer.push();
+  Components::const_iterator ci;
+  for (ci = components.begin(); ci != components.end(); ++ci) {
+    switch (*ci) {
+    case C_x:
+    case C_y:
+    case C_z:
+      xyz[(*ci) - C_x] = packer.unpack_double();
+      new_pos = true;
+      break;
+
+    case C_h:
+    case C_p:
+    case C_r:
+      hpr[(*ci) - C_h] = packer.unpack_double();
+      new_hpr = true;
+      break;
+
+    case C_l:
+    case C_t:
+    case C_dt:
+      packer.unpack_skip();
+      break;
+
+    case C_dx:
+    case C_dy:
+    case C_dz:
+      xyz[(*ci) - C_dx] += packer.unpack_double();
+      new_pos = true;
+      break;
+
+    case C_qh:
+      hpr[0] = SmoothMover::dequantize_h(packer.unpack_uint());
+      new_hpr = true;
+      break;
+    }
+  }
+  packer.pop();
+
+  if (packer.had_error()) {
+    // Leave the node alone if the update was malformed.
+    return true;
+  }
+
+  if (new_pos && new_hpr) {
+    _node_path.set_pos_hpr(xyz, hpr);
+  } else if (new_pos) {
+    _node_path.set_pos(xyz);
+  } else if (new_hpr) {
+    _node_path.set_hpr(hpr);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CDistributedSmoothNodeBase::get_components
+//       Access: Private
+//  Description: Returns the list of position components carried by
+//               the indicated field, in the order of its arguments,
+//               or an empty list if the field is not a smooth
+//               position field.  The result is computed the first
+//               time each field is seen, and cached thereafter.
+////////////////////////////////////////////////////////////////////
+const CDistributedSmoothNodeBase::Components &CDistributedSmoothNodeBase::
+get_components(const DCField *field) {
+  FieldComponents::iterator fi = _field_components.find(field->get_number());
+  if (fi != _field_components.end()) {
+    return (*fi).second;
+  }
+
+  Components &components = _field_components[field->get_number()];
+  bool ok = true;
+  const DCMolecularField *molecular = field->as_molecular_field();
+  if (molecular != (DCMolecularField *)NULL) {
+    int num_atomics = molecular->get_num_atomics();
+    for (int i = 0; i < num_atomics && ok; ++i) {
+      ok = add_component(components, molecular->get_atomic(i));
+    }
+  } else {
+    ok = add_component(components, field);
+  }
+
+  if (!ok) {
+    components.clear();
+  }
+  return components;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CDistributedSmoothNodeBase::add_component
+//       Access: Private, Static
+//  Description: Appends the position component set by the indicated
+//               atomic field, which should be one of the
+//               setComponent fields.  Returns true on success, or
+//               false if the field is something else.
+////////////////////////////////////////////////////////////////////
+bool CDistributedSmoothNodeBase::
+add_component(Components &components, const DCField *field) {
+  const DCAtomicField *atomic = field->as_atomic_field();
+  if (atomic == (DCAtomicField *)NULL || atomic->get_num_elements() != 1) {
+    return false;
+  }
+
+  static const char *const names[] = {
+    "setComponentX",
+    "setComponentY",
+    "setComponentZ",
+    "setComponentH",
+    "setComponentP",
+    "setComponentR",
+    "setComponentL",
+    "setComponentT",
+    "setComponentDX",
+    "setComponentDY",
+    "setComponentDZ",
+    "setComponentQH",
+    "setComponentDT",
+  };
+  static const int num_names = sizeof(names) / sizeof(names[0]);
+
+  const string &name = atomic->get_name();
+  for (int i = 0; i < num_names; ++i) {
+    if (name == names[i]) {
+      components.push_back((Component)(C_x + i));
+      return true;
+    }
+  }
+  return false;
+}
@@ -16,11 +16,14 @@
 #define CDISTRIBUTEDSMOOTHNODEBASE_H
 
 #include "directbase.h"
+#include "cDistributedUpdateHandler.h"
 #include "nodePath.h"
 #include "dcbase.h"
 #include "dcPacker.h"
 #include "dcPython.h"  // to pick up Python.h
 #include "clockObject.h"
+#include "pmap.h"
+#include "pvector.h"
 
 class DCClass;
 class CConnectionRepository;
@@ -30,8 +33,13 @@ class CConnectionRepository;
 // Description : This class defines some basic methods of
 //               DistributedSmoothNodeBase which have been moved into
 //               C++ as a performance optimization.
+//
+//               It may also receive the smooth position updates for
+//               its object directly from the repository, applying
+//               them to the node without calling into Python, the
+//               way DistributedSmoothNodeAI does.
 ////////////////////////////////////////////////////////////////////
-class EXPCL_DIRECT CDistributedSmoothNodeBase {
+class EXPCL_DIRECT CDistributedSmoothNodeBase : public CDistributedUpdateHandler {
 PUBLISHED:
   CDistributedSmoothNodeBase();
   ~CDistributedSmoothNodeBase();
@@ -57,6 +65,16 @@ PUBLISHED:
   void set_curr_l(PN_uint64 l);
   void print_curr_l();
 
+  INLINE void set_delta_encoding(bool delta_encoding);
+  INLINE bool get_delta_encoding() const;
+
+  void start_receive_updates();
+  void stop_receive_updates();
+  INLINE bool is_receiving_updates() const;
+
+public:
+  virtual bool handle_update(const DCField *field, DCPacker &packer);
+
 private:
   INLINE static bool only_changed(int flags, int compare);
 
@@ -72,9 +90,44 @@ private:
   INLINE void d_setSmPosHpr(PN_stdfloat x, PN_stdfloat y, PN_stdfloat z, PN_stdfloat h, PN_stdfloat p, PN_stdfloat r);
   INLINE void d_setSmPosHprL(PN_stdfloat x, PN_stdfloat y, PN_stdfloat z, PN_stdfloat h, PN_stdfloat p, PN_stdfloat r, PN_uint64 l);
 
+  INLINE static int quantize_pos(PN_stdfloat value);
+  void broadcast_delta(int consider);
+  void send_keyframe();
+  void reset_sent_state();
+
+  INLINE void d_setSmQH(int qh);
+  INLINE void d_setSmDXY(int dx, int dy);
+  INLINE void d_setSmDXYQH(int dx, int dy, int qh);
+  INLINE void d_setSmDPos(int dx, int dy, int dz);
+  INLINE void d_setSmDPosQH(int dx, int dy, int dz, int qh);
+
   void begin_send_update(DCPacker &packer, const string &field_name);
   void finish_send_update(DCPacker &packer);
 
+  // The position components that may be carried by an update, one
+  // per setComponent field, in the same order as the field names
+  // listed in add_component().
+  enum Component {
+    C_x,
+    C_y,
+    C_z,
+    C_h,
+    C_p,
+    C_r,
+    C_l,
+    C_t,
+    C_dx,
+    C_dy,
+    C_dz,
+    C_qh,
+    C_dt,
+  };
+  typedef pvector<Component> Components;
+  typedef pmap<int, Components> FieldComponents;
+
+  const Components &get_components(const DCField *field);
+  static bool add_component(Components &components, const DCField *field);
+
   enum Flags {
     F_new_x     = 0x01,
     F_new_y     = 0x02,
@@ -101,6 +154,21 @@ private:
   // contains most recently sent location info as
   // index 0, index 1 contains most recently set location info
   PN_uint64 _currL[2];
+
+  // The state last sent in delta-encoded mode, as the receivers have
+  // it: the position in tenths of a unit and the heading, which came
+  // either from a keyframe or from a quantized heading.
+  bool _delta_encoding;
+  bool _keyframe_needed;
+  int _sent_pos[3];
+  PN_stdfloat _sent_h;
+  int _num_deltas;
+
+  // The repository and doId with which we are registered to receive
+  // updates, if any, and the components of each field we have seen.
+  CConnectionRepository *_update_repository;
+  DOID_TYPE _update_do_id;
+  FieldComponents _field_components;
 };
 
 #include "cDistributedSmoothNodeBase.I"
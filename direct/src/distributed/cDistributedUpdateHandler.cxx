@@ -0,0 +1,24 @@
+// Filename: cDistributedUpdateHandler.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "cDistributedUpdateHandler.h"
+
+////////////////////////////////////////////////////////////////////
+//     Function: CDistributedUpdateHandler::Destructor
+//       Access: Public, Virtual
+//  Description: 
+////////////////////////////////////////////////////////////////////
+CDistributedUpdateHandler::
+~CDistributedUpdateHandler() {
+}
@@ -0,0 +1,51 @@
+// Filename: cDistributedUpdateHandler.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef CDISTRIBUTEDUPDATEHANDLER_H
+#define CDISTRIBUTEDUPDATEHANDLER_H
+
+#include "directbase.h"
+#include "dcbase.h"
+
+class DCField;
+class DCPacker;
+
+////////////////////////////////////////////////////////////////////
+//       Class : CDistributedUpdateHandler
+// Description : This is an abstract base class for a C++ object that
+//               receives field updates for a particular distributed
+//               object directly from the CConnectionRepository,
+//               without going through Python.
+//
+//               A handler is registered with
+//               CConnectionRepository::add_update_handler() for a
+//               particular doId.  When an update arrives for that
+//               doId, handle_update() is called with a DCPacker that
+//               is positioned at the start of the field's arguments;
+//               the arguments are unpacked in place from the
+//               received datagram.
+////////////////////////////////////////////////////////////////////
+class EXPCL_DIRECT CDistributedUpdateHandler {
+public:
+  virtual ~CDistributedUpdateHandler();
+
+  // Unpacks the field's arguments from the packer, which has already
+  // been set up with begin_unpack(field), and applies them.  The
+  // handler should not call end_unpack().  Returns true if the update
+  // was handled, or false if the update should be passed on to the
+  // Python object instead, as if no handler were registered.
+  virtual bool handle_update(const DCField *field, DCPacker &packer)=0;
+};
+
+#endif  // CDISTRIBUTEDUPDATEHANDLER_H
@@ -47,6 +47,36 @@ ConfigVariableBool handle_datagrams_internally
           "for performance reasons.  When it is false, all datagrams "
           "are handled by the Python implementation."));
 
+ConfigVariableDouble coalesce_updates_interval
+("coalesce-updates-interval", 0.0,
+ PRC_DESC("When this is nonzero, the cConnectionRepository holds outgoing "
+          "field updates for up to this many seconds before sending them, "
+          "so that an update to a ram field that is superseded by a later "
+          "update to the same field of the same object, sent to the same "
+          "channel, is never sent at all.  Other messages are not delayed, "
+          "and are never reordered with respect to the updates.  When it "
+          "is 0, each update is sent immediately."));
+
+ConfigVariableInt coalesce_updates_max_bytes
+("coalesce-updates-max-bytes", 16384,
+ PRC_DESC("The number of bytes of field updates the cConnectionRepository "
+          "may hold when coalesce-updates-interval is in effect.  When "
+          "more than this are waiting, they are all sent immediately."));
+
+ConfigVariableBool smooth_node_delta_encoding
+("smooth-node-delta-encoding", false,
+ PRC_DESC("Set this true to make the CDistributedSmoothNodeBase broadcast "
+          "its position with the delta-encoded setSmD* and setSmQH messages, "
+          "which are smaller than the absolute setSm* messages.  All of "
+          "the receivers must understand these messages."));
+
+ConfigVariableInt smooth_node_keyframe_interval
+("smooth-node-keyframe-interval", 10,
+ PRC_DESC("When smooth-node-delta-encoding is in effect, this is the "
+          "maximum number of delta-encoded messages sent in a row before "
+          "a complete setSmPosHpr is sent, to refresh the ram fields for "
+          "receivers that arrive later."));
+
 ////////////////////////////////////////////////////////////////////
 //     Function: init_libdistributed
 //  Description: Initializes the library.  This must be called at
@@ -28,6 +28,10 @@ extern ConfigVariableInt game_server_timeout_ms;
 extern ConfigVariableDouble min_lag;
 extern ConfigVariableDouble max_lag;
 extern ConfigVariableBool handle_datagrams_internally;
+extern ConfigVariableDouble coalesce_updates_interval;
+extern ConfigVariableInt coalesce_updates_max_bytes;
+extern ConfigVariableBool smooth_node_delta_encoding;
+extern ConfigVariableInt smooth_node_keyframe_interval;
 
 extern EXPCL_DIRECT void init_libdistributed();
 
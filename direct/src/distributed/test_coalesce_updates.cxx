@@ -0,0 +1,270 @@
+// Filename: test_coalesce_updates.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "cConnectionRepository.h"
+#include "dcFile.h"
+#include "dcClass.h"
+#include "dcField.h"
+#include "dcPacker.h"
+#include "dcmsgtypes.h"
+#include "queuedConnectionManager.h"
+#include "queuedConnectionListener.h"
+#include "queuedConnectionReader.h"
+#include "netDatagram.h"
+#include "datagramIterator.h"
+#include "urlSpec.h"
+#include "pvector.h"
+
+// This sends field updates through a CConnectionRepository with
+// set_coalesce_interval() in effect, and checks the updates that
+// arrive on the far side of a loopback connection: a ram update
+// supersedes an earlier one for the same field of the same object,
+// but not across an update to a non-ram field of that object, and
+// any other message sends the held updates ahead of it.
+//
+// Usage: test_coalesce_updates [port]
+
+static const char *dc_text =
+  "dclass DistributedTestObject {\n"
+  "  setA(int32) broadcast ram;\n"
+  "  setB(int32) broadcast ram;\n"
+  "  setN(int32) broadcast;\n"
+  "};\n";
+
+static const DOID_TYPE first_do_id = 1000;
+static const int sync_msg_type = 0xffff;
+
+static DCClass *dclass;
+
+// The server end of the connection.  It records each update it
+// receives in the form "doId:field=value".
+class Receiver {
+public:
+  Receiver(int port);
+  bool accept();
+  bool sync(string &received);
+
+  QueuedConnectionManager _qcm;
+  QueuedConnectionListener _listener;
+  QueuedConnectionReader _reader;
+  PT(Connection) _rendezvous;
+  PT(Connection) _connection;
+};
+
+Receiver::
+Receiver(int port) :
+  _listener(&_qcm, 0),
+  _reader(&_qcm, 0)
+{
+  _rendezvous = _qcm.open_TCP_server_rendezvous(port, 5);
+  if (_rendezvous != (Connection *)NULL) {
+    _listener.add_connection(_rendezvous);
+  }
+}
+
+bool Receiver::
+accept() {
+  for (int i = 0; i < 1000 && _connection == (Connection *)NULL; ++i) {
+    _listener.poll();
+    if (_listener.new_connection_available()) {
+      PT(Connection) rendezvous;
+      NetAddress address;
+      _listener.get_new_connection(rendezvous, address, _connection);
+    } else {
+      Thread::sleep(0.01);
+    }
+  }
+  if (_connection == (Connection *)NULL) {
+    return false;
+  }
+  _reader.add_connection(_connection);
+  return true;
+}
+
+// Reads messages until the next sync message, and returns the
+// updates received before it, separated by spaces.
+bool Receiver::
+sync(string &received) {
+  ostringstream strm;
+  for (int i = 0; i < 1000; ++i) {
+    _reader.poll();
+    while (_reader.data_available()) {
+      NetDatagram dg;
+      if (_reader.get_data(dg)) {
+        DatagramIterator di(dg);
+        int msg_type = di.get_uint16();
+        if (msg_type == sync_msg_type) {
+          received = strm.str();
+          return true;
+        }
+        nassertr(msg_type == CLIENT_OBJECT_SET_FIELD, false);
+        DOID_TYPE do_id = di.get_uint32();
+        int field_id = di.get_uint16();
+        strm << (strm.tellp() > 0 ? " " : "") << do_id << ":"
+             << dclass->get_field_by_index(field_id)->get_name() << "="
+             << (PN_int32)di.get_uint32();
+      }
+    }
+    Thread::sleep(0.01);
+  }
+  nout << "No sync message received.\n";
+  return false;
+}
+
+static void
+send_update(CConnectionRepository &repo, DOID_TYPE do_id,
+            const string &field_name, int value) {
+  Datagram dg;
+  dg.add_uint16(CLIENT_OBJECT_SET_FIELD);
+  dg.add_uint32(do_id);
+  dg.add_uint16(dclass->get_field_by_name(field_name)->get_number());
+  dg.add_int32(value);
+  repo.send_datagram(dg);
+}
+
+// Sends the sync message, which also sends the updates being held,
+// and checks the updates the receiver gets before it.
+static bool
+expect(CConnectionRepository &repo, Receiver &receiver,
+       const string &description, const string &expected) {
+  Datagram sync;
+  sync.add_uint16(sync_msg_type);
+  repo.send_datagram(sync);
+  repo.flush();
+
+  string received;
+  if (!receiver.sync(received)) {
+    return false;
+  }
+  if (received != expected) {
+    nout << description << ": received \"" << received
+         << "\", expected \"" << expected << "\"\n";
+    return false;
+  }
+  return true;
+}
+
+int
+main(int argc, char *argv[]) {
+  int port = 47194;
+  if (argc > 1) {
+    port = atoi(argv[1]);
+  }
+
+  CConnectionRepository repo;
+  istringstream dc_stream(dc_text);
+  if (!repo.get_dc_file().read(dc_stream, "test.dc")) {
+    nout << "Unable to read dc file\n";
+    return (1);
+  }
+  dclass = repo.get_dc_file().get_class_by_name("DistributedTestObject");
+  nassertr(dclass != (DCClass *)NULL, 1);
+
+  Receiver receiver(port);
+  URLSpec url;
+  url.set_scheme("http");
+  url.set_server("127.0.0.1");
+  url.set_port(port);
+  if (!repo.try_connect_net(url) || !receiver.accept()) {
+    nout << "Unable to connect on port " << port << "\n";
+    return (1);
+  }
+
+  // Long enough that nothing is sent on account of the interval.
+  repo.set_coalesce_interval(1000.0);
+  DOID_TYPE obj = first_do_id;
+  DOID_TYPE other = first_do_id + 1;
+
+  // Only the last value of each ram field is sent, in the position of
+  // the last update.
+  send_update(repo, obj, "setA", 1);
+  send_update(repo, obj, "setA", 2);
+  send_update(repo, obj, "setB", 3);
+  send_update(repo, obj, "setA", 4);
+  if (!expect(repo, receiver, "ram updates",
+              "1000:setB=3 1000:setA=4")) {
+    return (1);
+  }
+  if (repo.get_num_updates_queued() != 4 ||
+      repo.get_num_updates_coalesced() != 2) {
+    nout << repo.get_num_updates_queued() << " queued, "
+         << repo.get_num_updates_coalesced() << " coalesced\n";
+    return (1);
+  }
+
+  // Updates to non-ram fields are never superseded, and a ram update
+  // held before one is not superseded by a ram update after it.
+  send_update(repo, obj, "setA", 1);
+  send_update(repo, obj, "setN", 2);
+  send_update(repo, obj, "setN", 3);
+  send_update(repo, obj, "setA", 4);
+  if (!expect(repo, receiver, "non-ram update",
+              "1000:setA=1 1000:setN=2 1000:setN=3 1000:setA=4")) {
+    return (1);
+  }
+
+  // Superseding still applies on either side of the non-ram update.
+  send_update(repo, obj, "setA", 1);
+  send_update(repo, obj, "setA", 2);
+  send_update(repo, obj, "setN", 3);
+  send_update(repo, obj, "setA", 4);
+  send_update(repo, obj, "setA", 5);
+  if (!expect(repo, receiver, "either side of non-ram update",
+              "1000:setA=2 1000:setN=3 1000:setA=5")) {
+    return (1);
+  }
+
+  // A non-ram update to another object does not hold back the
+  // superseding.
+  send_update(repo, obj, "setA", 1);
+  send_update(repo, other, "setN", 2);
+  send_update(repo, obj, "setA", 3);
+  if (!expect(repo, receiver, "non-ram update to other object",
+              "1001:setN=2 1000:setA=3")) {
+    return (1);
+  }
+
+  // Nothing is superseded across a flush.
+  repo.reset_coalesce_counts();
+  send_update(repo, obj, "setA", 1);
+  repo.flush();
+  send_update(repo, obj, "setA", 2);
+  if (!expect(repo, receiver, "across flush",
+              "1000:setA=1 1000:setA=2") ||
+      repo.get_num_updates_coalesced() != 0 ||
+      repo.get_num_coalesce_flushes() != 2) {
+    return (1);
+  }
+
+  // The updates held are sent as soon as they reach the byte limit.
+  repo.reset_coalesce_counts();
+  repo.set_coalesce_max_bytes(20);
+  send_update(repo, obj, "setA", 1);
+  send_update(repo, obj, "setB", 2);
+  if (repo.get_num_pending_updates() != 0 ||
+      repo.get_num_coalesce_flushes() != 1) {
+    nout << "Byte limit did not flush: "
+         << repo.get_num_pending_updates() << " pending\n";
+    return (1);
+  }
+  send_update(repo, obj, "setA", 3);
+  if (!expect(repo, receiver, "byte limit",
+              "1000:setA=1 1000:setB=2 1000:setA=3")) {
+    return (1);
+  }
+
+  repo.disconnect();
+  nout << "coalesced updates ok\n";
+  return (0);
+}
@@ -0,0 +1,289 @@
+// Filename: test_native_update.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "cConnectionRepository.h"
+#include "cDistributedUpdateHandler.h"
+#include "dcFile.h"
+#include "dcClass.h"
+#include "dcField.h"
+#include "dcPacker.h"
+#include "dcmsgtypes.h"
+#include "queuedConnectionManager.h"
+#include "queuedConnectionListener.h"
+#include "connectionWriter.h"
+#include "datagramIterator.h"
+#include "urlSpec.h"
+
+// This sends SET_FIELD updates from a server socket to a
+// CConnectionRepository with a CDistributedUpdateHandler registered,
+// and checks which of them the handler receives in check_datagram()
+// and which are passed back up to the caller, as they would be to
+// Python: those the handler declines, those for other objects, those
+// received in the quiet zone, and those received after the handler is
+// removed.
+//
+// Usage: test_native_update [port]
+
+static const char *dc_text =
+  "dclass DistributedTestObject {\n"
+  "  setA(int32) broadcast ram;\n"
+  "  setB(string) broadcast;\n"
+  "};\n";
+
+static const DOID_TYPE handled_do_id = 1000;
+static const DOID_TYPE other_do_id = 1001;
+static const int sync_msg_type = 0xffff;
+
+// Applies setA, and declines everything else.
+class TestHandler : public CDistributedUpdateHandler {
+public:
+  TestHandler() : _num_updates(0), _a(0) { }
+
+  virtual bool handle_update(const DCField *field, DCPacker &packer) {
+    if (field->get_name() != "setA") {
+      return false;
+    }
+    packer.push();
+    _a = packer.unpack_int();
+    packer.pop();
+    ++_num_updates;
+    return true;
+  }
+
+  int _num_updates;
+  int _a;
+};
+
+// The server end of the connection.
+class Server {
+public:
+  Server(int port);
+  bool accept();
+  void send_set_field(DOID_TYPE do_id, const DCField *field,
+                      const string &formatted_args);
+  void send_sync();
+
+  QueuedConnectionManager _qcm;
+  QueuedConnectionListener _listener;
+  ConnectionWriter _writer;
+  PT(Connection) _rendezvous;
+  PT(Connection) _connection;
+};
+
+Server::
+Server(int port) :
+  _listener(&_qcm, 0),
+  _writer(&_qcm, 0)
+{
+  _rendezvous = _qcm.open_TCP_server_rendezvous(port, 5);
+  if (_rendezvous != (Connection *)NULL) {
+    _listener.add_connection(_rendezvous);
+  }
+}
+
+bool Server::
+accept() {
+  for (int i = 0; i < 1000 && _connection == (Connection *)NULL; ++i) {
+    _listener.poll();
+    if (_listener.new_connection_available()) {
+      PT(Connection) rendezvous;
+      NetAddress address;
+      _listener.get_new_connection(rendezvous, address, _connection);
+    } else {
+      Thread::sleep(0.01);
+    }
+  }
+  return (_connection != (Connection *)NULL);
+}
+
+// Sends a STATESERVER_OBJECT_SET_FIELD message, with the arguments
+// given in the format accepted by DCPacker::parse_and_pack().
+void Server::
+send_set_field(DOID_TYPE do_id, const DCField *field,
+               const string &formatted_args) {
+  DCPacker packer;
+  packer.raw_pack_uint8(1);
+  packer.raw_pack_uint64(do_id);
+  packer.raw_pack_uint64(0);
+  packer.raw_pack_uint16(STATESERVER_OBJECT_SET_FIELD);
+  packer.raw_pack_uint32(do_id);
+  packer.raw_pack_uint16(field->get_number());
+  packer.begin_pack(field);
+  packer.parse_and_pack(formatted_args);
+  nassertv(packer.end_pack());
+
+  Datagram dg(packer.get_data(), packer.get_length());
+  _writer.send(dg, _connection);
+}
+
+// Sends a message that check_datagram() always passes up to the
+// caller, to mark the end of a group of updates.
+void Server::
+send_sync() {
+  Datagram dg;
+  dg.add_uint8(1);
+  dg.add_uint64(handled_do_id);
+  dg.add_uint64(0);
+  dg.add_uint16(sync_msg_type);
+  _writer.send(dg, _connection);
+}
+
+// Waits for the next message that check_datagram() passes up to the
+// caller.  Returns false if none arrives.
+static bool
+wait_for_message(CConnectionRepository &repo) {
+  for (int i = 0; i < 1000; ++i) {
+    if (repo.check_datagram()) {
+      return true;
+    }
+    Thread::sleep(0.01);
+  }
+  nout << "No message received.\n";
+  return false;
+}
+
+// Waits for the next message, and checks that it is the indicated
+// SET_FIELD update, with the datagram iterator still positioned at
+// the doId, as it is for updates that go to Python.
+static bool
+expect_set_field(CConnectionRepository &repo, DOID_TYPE do_id,
+                 const DCField *field) {
+  if (!wait_for_message(repo)) {
+    return false;
+  }
+  DatagramIterator di;
+  repo.get_datagram_iterator(di);
+  if (repo.get_msg_type() != STATESERVER_OBJECT_SET_FIELD ||
+      di.get_uint32() != do_id ||
+      di.get_uint16() != field->get_number()) {
+    nout << "Expected " << field->get_name() << " on " << do_id
+         << ", got message type " << repo.get_msg_type() << "\n";
+    return false;
+  }
+  return true;
+}
+
+static bool
+expect_sync(CConnectionRepository &repo) {
+  if (!wait_for_message(repo)) {
+    return false;
+  }
+  if (repo.get_msg_type() != sync_msg_type) {
+    nout << "Expected sync, got message type " << repo.get_msg_type()
+         << "\n";
+    return false;
+  }
+  return true;
+}
+
+static bool
+expect_handled(const TestHandler &handler, int num_updates, int a) {
+  if (handler._num_updates != num_updates || handler._a != a) {
+    nout << "Handler has " << handler._num_updates << " updates, a = "
+         << handler._a << "; expected " << num_updates << ", "
+         << a << "\n";
+    return false;
+  }
+  return true;
+}
+
+int
+main(int argc, char *argv[]) {
+  int port = 47192;
+  if (argc > 1) {
+    port = atoi(argv[1]);
+  }
+
+  CConnectionRepository repo;
+  istringstream dc_stream(dc_text);
+  if (!repo.get_dc_file().read(dc_stream, "test.dc")) {
+    nout << "Unable to read dc file\n";
+    return (1);
+  }
+  DCClass *dclass = repo.get_dc_file().get_class_by_name("DistributedTestObject");
+  nassertr(dclass != (DCClass *)NULL, 1);
+  const DCField *set_a = dclass->get_field_by_name("setA");
+  const DCField *set_b = dclass->get_field_by_name("setB");
+  nassertr(set_a != (DCField *)NULL && set_b != (DCField *)NULL, 1);
+
+  // Server messages, which go back up to the caller unless a C++
+  // handler takes them.
+  repo.set_client_datagram(false);
+  repo.set_handle_c_updates(false);
+
+  Server server(port);
+  URLSpec url;
+  url.set_scheme("http");
+  url.set_server("127.0.0.1");
+  url.set_port(port);
+  if (!repo.try_connect_net(url) || !server.accept()) {
+    nout << "Unable to connect on port " << port << "\n";
+    return (1);
+  }
+
+  TestHandler handler;
+  repo.add_update_handler(handled_do_id, dclass, &handler);
+
+  // The handler takes setA, and check_datagram() goes on to the next
+  // message; it declines setB, which is passed up intact.
+  server.send_set_field(handled_do_id, set_a, "(5)");
+  server.send_set_field(handled_do_id, set_b, "(\"hello\")");
+  if (!expect_set_field(repo, handled_do_id, set_b) ||
+      !expect_handled(handler, 1, 5)) {
+    return (1);
+  }
+  DatagramIterator di;
+  repo.get_datagram_iterator(di);
+  di.skip_bytes(6);
+  if (di.get_string() != "hello" || di.get_remaining_size() != 0) {
+    nout << "setB arguments were disturbed\n";
+    return (1);
+  }
+
+  // Several handled updates in a row are all applied.
+  server.send_set_field(handled_do_id, set_a, "(6)");
+  server.send_set_field(handled_do_id, set_a, "(7)");
+  server.send_sync();
+  if (!expect_sync(repo) || !expect_handled(handler, 3, 7)) {
+    return (1);
+  }
+
+  // An update for another object goes to the caller.
+  server.send_set_field(other_do_id, set_a, "(8)");
+  if (!expect_set_field(repo, other_do_id, set_a) ||
+      !expect_handled(handler, 3, 7)) {
+    return (1);
+  }
+
+  // So does an update received in the quiet zone.
+  repo.set_in_quiet_zone(true);
+  server.send_set_field(handled_do_id, set_a, "(9)");
+  if (!expect_set_field(repo, handled_do_id, set_a) ||
+      !expect_handled(handler, 3, 7)) {
+    return (1);
+  }
+  repo.set_in_quiet_zone(false);
+
+  // And one received after the handler is removed.
+  repo.remove_update_handler(handled_do_id);
+  server.send_set_field(handled_do_id, set_a, "(10)");
+  if (!expect_set_field(repo, handled_do_id, set_a) ||
+      !expect_handled(handler, 3, 7)) {
+    return (1);
+  }
+
+  repo.disconnect();
+  nout << "native updates ok\n";
+  return (0);
+}
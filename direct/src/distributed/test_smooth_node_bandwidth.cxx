@@ -0,0 +1,478 @@
+// Filename: test_smooth_node_bandwidth.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "cConnectionRepository.h"
+#include "cDistributedSmoothNodeBase.h"
+#include "smoothMover.h"
+#include "dcFile.h"
+#include "dcClass.h"
+#include "dcField.h"
+#include "dcMolecularField.h"
+#include "dcAtomicField.h"
+#include "dcPacker.h"
+#include "dcmsgtypes.h"
+#include "queuedConnectionManager.h"
+#include "queuedConnectionListener.h"
+#include "queuedConnectionReader.h"
+#include "netDatagram.h"
+#include "urlSpec.h"
+#include "pandaNode.h"
+#include "nodePath.h"
+#include "randomizer.h"
+#include "load_prc_file.h"
+#include "pvector.h"
+
+// This replays avatar motion through a set of
+// CDistributedSmoothNodeBase objects, once with the usual absolute
+// broadcasts and once with smooth-node-delta-encoding, and reports the
+// number of bytes each avatar sends per second in each mode.  The
+// messages are sent over a loopback TCP connection and decoded on the
+// far side into a SmoothMover per avatar, the way
+// DistributedSmoothNode applies them, and the decoded position is
+// checked against the original after every broadcast.
+//
+// Usage: test_smooth_node_bandwidth [motion.txt [file.dc [port]]]
+//
+// The motion file lists one sample per line, in the form "avatar x y
+// z h p r", with the samples of each avatar in the order they were
+// recorded, one broadcast period (0.2 seconds) apart.  If it is
+// omitted or given as "-", 200 avatars walking, running, turning,
+// jumping and standing about for two minutes are synthesized instead.
+
+static const double broadcast_period = 0.2;
+
+class Sample {
+public:
+  LPoint3 _pos;
+  LVecBase3 _hpr;
+};
+typedef pvector<Sample> Track;
+typedef pvector<Track> Tracks;
+
+// Reads the recorded motion from the indicated file.
+static bool
+read_motion(Tracks &tracks, const string &filename) {
+  FILE *file = fopen(filename.c_str(), "r");
+  if (file == (FILE *)NULL) {
+    return false;
+  }
+
+  int avatar;
+  double x, y, z, h, p, r;
+  while (fscanf(file, "%d %lf %lf %lf %lf %lf %lf",
+                &avatar, &x, &y, &z, &h, &p, &r) == 7) {
+    if (avatar < 0) {
+      continue;
+    }
+    if (avatar >= (int)tracks.size()) {
+      tracks.resize(avatar + 1);
+    }
+    Sample sample;
+    sample._pos.set(x, y, z);
+    sample._hpr.set(h, p, r);
+    tracks[avatar].push_back(sample);
+  }
+  fclose(file);
+  return !tracks.empty();
+}
+
+// Synthesizes the motion of a crowd of avatars milling about: each
+// one alternates at random between standing still (sometimes turning
+// in place), walking and running along a gently curving path, and the
+// occasional jump.
+static void
+synthesize_motion(Tracks &tracks, int num_avatars, int num_samples) {
+  Randomizer random(1);
+  tracks.resize(num_avatars);
+  for (int av = 0; av < num_avatars; ++av) {
+    Track &track = tracks[av];
+    LPoint3 pos(random.random_real(400.0) - 200.0,
+                random.random_real(400.0) - 200.0, 0.0);
+    double h = random.random_real(360.0);
+    double speed = 0.0;
+    double turn = 0.0;
+    double vz = 0.0;
+    int remaining = 0;
+
+    for (int i = 0; i < num_samples; ++i) {
+      if (remaining <= 0) {
+        // Choose a new activity for the next few seconds.
+        remaining = 5 + random.random_int(40);
+        int activity = random.random_int(10);
+        if (activity < 3) {
+          speed = 0.0;
+          turn = (activity == 0) ? random.random_real(180.0) - 90.0 : 0.0;
+        } else if (activity < 8) {
+          speed = 6.0 + random.random_real(4.0);
+          turn = random.random_real(40.0) - 20.0;
+        } else {
+          speed = 16.0 + random.random_real(8.0);
+          turn = random.random_real(20.0) - 10.0;
+        }
+      }
+      --remaining;
+
+      if (speed != 0.0 && pos[2] == 0.0 && random.random_int(30) == 0) {
+        vz = 24.0;
+      }
+
+      h += turn * broadcast_period;
+      double rad = deg_2_rad(h);
+      pos[0] += -sin(rad) * speed * broadcast_period;
+      pos[1] += cos(rad) * speed * broadcast_period;
+      if (vz != 0.0 || pos[2] > 0.0) {
+        pos[2] += vz * broadcast_period;
+        vz -= 64.0 * broadcast_period;
+        if (pos[2] <= 0.0) {
+          pos[2] = 0.0;
+          vz = 0.0;
+        }
+      }
+
+      Sample sample;
+      sample._pos = pos;
+      sample._hpr.set(h, 0.0, 0.0);
+      track.push_back(sample);
+    }
+  }
+}
+
+// The far side of the connection: one SmoothMover per avatar.
+class Receiver {
+public:
+  Receiver(DCFile &dc_file, int num_avatars, int port);
+  bool accept();
+  void receive(const NetDatagram &dg);
+  void sync();
+
+  DCFile &_dc_file;
+  QueuedConnectionManager _qcm;
+  QueuedConnectionListener _listener;
+  QueuedConnectionReader _reader;
+  PT(Connection) _rendezvous;
+  PT(Connection) _connection;
+  pvector<SmoothMover> _movers;
+
+  int _num_messages;
+  int _num_bytes;
+  int _num_header_bytes;
+};
+
+static const int sync_msg_type = 0xffff;
+static const DOID_TYPE first_do_id = 1000;
+
+Receiver::
+Receiver(DCFile &dc_file, int num_avatars, int port) :
+  _dc_file(dc_file),
+  _listener(&_qcm, 0),
+  _reader(&_qcm, 0),
+  _movers(num_avatars),
+  _num_messages(0),
+  _num_bytes(0),
+  _num_header_bytes(0)
+{
+  _rendezvous = _qcm.open_TCP_server_rendezvous(port, 5);
+  if (_rendezvous != (Connection *)NULL) {
+    _listener.add_connection(_rendezvous);
+  }
+}
+
+bool Receiver::
+accept() {
+  for (int i = 0; i < 1000 && _connection == (Connection *)NULL; ++i) {
+    _listener.poll();
+    if (_listener.new_connection_available()) {
+      PT(Connection) rendezvous;
+      NetAddress address;
+      _listener.get_new_connection(rendezvous, address, _connection);
+    } else {
+      Thread::sleep(0.01);
+    }
+  }
+  if (_connection == (Connection *)NULL) {
+    return false;
+  }
+  _reader.add_connection(_connection);
+  return true;
+}
+
+// Applies one update message to the appropriate SmoothMover.
+void Receiver::
+receive(const NetDatagram &dg) {
+  DCPacker packer;
+  packer.set_unpack_data((const char *)dg.get_data(), dg.get_length(), false);
+  packer.raw_unpack_uint16();
+  DOID_TYPE do_id = packer.raw_unpack_uint32();
+  int field_id = packer.raw_unpack_uint16();
+  size_t header_length = packer.get_num_unpacked_bytes();
+
+  DCField *field = _dc_file.get_field_by_index(field_id);
+  DCMolecularField *molecular = field->as_molecular_field();
+  nassertv(molecular != (DCMolecularField *)NULL);
+  nassertv(do_id >= first_do_id && do_id < first_do_id + _movers.size());
+  SmoothMover &mover = _movers[do_id - first_do_id];
+
+  packer.begin_unpack(field);
+  packer.push();
+  for (int i = 0; i < molecular->get_num_atomics(); ++i) {
+    const string &name = molecular->get_atomic(i)->get_name();
+    if (name == "setComponentX") {
+      mover.set_x(packer.unpack_double());
+    } else if (name == "setComponentY") {
+      mover.set_y(packer.unpack_double());
+    } else if (name == "setComponentZ") {
+      mover.set_z(packer.unpack_double());
+    } else if (name == "setComponentH") {
+      mover.set_h(packer.unpack_double());
+    } else if (name == "setComponentP") {
+      mover.set_p(packer.unpack_double());
+    } else if (name == "setComponentR") {
+      mover.set_r(packer.unpack_double());
+    } else if (name == "setComponentDX") {
+      mover.add_x(packer.unpack_double());
+    } else if (name == "setComponentDY") {
+      mover.add_y(packer.unpack_double());
+    } else if (name == "setComponentDZ") {
+      mover.add_z(packer.unpack_double());
+    } else if (name == "setComponentQH") {
+      mover.set_quantized_h(packer.unpack_uint());
+    } else {
+      packer.unpack_skip();
+    }
+  }
+  packer.pop();
+  nassertv(packer.end_unpack());
+
+  // Each message is preceded by a two-byte length on the TCP stream.
+  ++_num_messages;
+  _num_bytes += dg.get_length() + 2;
+  _num_header_bytes += header_length + 2;
+}
+
+// Reads messages until the sync message that follows the current
+// round of broadcasts.
+void Receiver::
+sync() {
+  while (true) {
+    _reader.poll();
+    while (_reader.data_available()) {
+      NetDatagram dg;
+      if (_reader.get_data(dg)) {
+        DatagramIterator di(dg);
+        if (di.get_uint16() == sync_msg_type) {
+          return;
+        }
+        receive(dg);
+      }
+    }
+    Thread::force_yield();
+  }
+}
+
+// Returns the difference between two headings, in degrees.
+static double
+heading_error(double a, double b) {
+  double d = fmod(fabs(a - b), 360.0);
+  return min(d, 360.0 - d);
+}
+
+class Result {
+public:
+  int _num_messages;
+  int _num_bytes;
+  int _num_header_bytes;
+  double _max_pos_error;
+  double _max_h_error;
+};
+
+static bool
+run_test(Result &result, const Tracks &tracks, const string &dc_filename,
+         int port, bool delta_encoding) {
+  CConnectionRepository repo;
+  if (!repo.get_dc_file().read(dc_filename)) {
+    nout << "Unable to read " << dc_filename << "\n";
+    return false;
+  }
+  DCClass *dclass = repo.get_dc_file().get_class_by_name("DistributedSmoothNode");
+  if (dclass == (DCClass *)NULL) {
+    nout << "No DistributedSmoothNode in " << dc_filename << "\n";
+    return false;
+  }
+
+  Receiver receiver(repo.get_dc_file(), tracks.size(), port);
+  URLSpec url;
+  url.set_scheme("http");
+  url.set_server("127.0.0.1");
+  url.set_port(port);
+  if (!repo.try_connect_net(url) || !receiver.accept()) {
+    nout << "Unable to connect on port " << port << "\n";
+    return false;
+  }
+
+#ifdef HAVE_PYTHON
+  // finish_send_update() reads the delta from a ClockDelta object.
+  PyRun_SimpleString("class ClockDelta:\n  delta = 0.0\n"
+                     "smooth_node_clock_delta = ClockDelta()\n");
+  PyObject *clock_delta = PyObject_GetAttrString
+    (PyImport_AddModule("__main__"), "smooth_node_clock_delta");
+#endif
+
+  int num_avatars = tracks.size();
+  pvector<NodePath> nodes;
+  pvector<CDistributedSmoothNodeBase *> smooth_nodes;
+  for (int av = 0; av < num_avatars; ++av) {
+    NodePath node(new PandaNode("avatar"));
+    if (!tracks[av].empty()) {
+      node.set_pos_hpr(tracks[av][0]._pos, tracks[av][0]._hpr);
+    }
+    CDistributedSmoothNodeBase *smooth_node = new CDistributedSmoothNodeBase;
+    smooth_node->initialize(node, dclass, first_do_id + av);
+    smooth_node->set_repository(&repo, false, 0);
+#ifdef HAVE_PYTHON
+    smooth_node->set_clock_delta(clock_delta);
+#endif
+    smooth_node->set_delta_encoding(delta_encoding);
+    nodes.push_back(node);
+    smooth_nodes.push_back(smooth_node);
+  }
+
+  // Each avatar starts with a full update, as when it is generated;
+  // that is not counted against either mode.
+  for (int av = 0; av < num_avatars; ++av) {
+    smooth_nodes[av]->send_everything();
+  }
+
+  Datagram sync;
+  sync.add_uint16(sync_msg_type);
+  repo.send_datagram(sync);
+  repo.flush();
+  receiver.sync();
+  receiver._num_messages = 0;
+  receiver._num_bytes = 0;
+  receiver._num_header_bytes = 0;
+
+  result._max_pos_error = 0.0;
+  result._max_h_error = 0.0;
+
+  size_t num_samples = 0;
+  for (int av = 0; av < num_avatars; ++av) {
+    num_samples = max(num_samples, tracks[av].size());
+  }
+  for (size_t i = 1; i < num_samples; ++i) {
+    for (int av = 0; av < num_avatars; ++av) {
+      if (i < tracks[av].size()) {
+        nodes[av].set_pos_hpr(tracks[av][i]._pos, tracks[av][i]._hpr);
+      }
+      smooth_nodes[av]->broadcast_pos_hpr_full();
+    }
+    repo.send_datagram(sync);
+    repo.flush();
+    receiver.sync();
+
+    for (int av = 0; av < num_avatars; ++av) {
+      const Sample &sample = tracks[av][min(i, tracks[av].size() - 1)];
+      const SmoothMover &mover = receiver._movers[av];
+      LVector3 pos_error = mover.get_sample_pos() - sample._pos;
+      result._max_pos_error = max(result._max_pos_error,
+                                  (double)max(max(fabs(pos_error[0]), fabs(pos_error[1])), fabs(pos_error[2])));
+      result._max_h_error = max(result._max_h_error,
+                                heading_error(mover.get_sample_hpr()[0], sample._hpr[0]));
+    }
+  }
+
+  result._num_messages = receiver._num_messages;
+  result._num_bytes = receiver._num_bytes;
+  result._num_header_bytes = receiver._num_header_bytes;
+
+  for (int av = 0; av < num_avatars; ++av) {
+    delete smooth_nodes[av];
+  }
+#ifdef HAVE_PYTHON
+  Py_DECREF(clock_delta);
+#endif
+  repo.disconnect();
+  return true;
+}
+
+int
+main(int argc, char *argv[]) {
+  string motion_filename = "-";
+  string dc_filename = "direct.dc";
+  int port = 47190;
+  if (argc > 1) {
+    motion_filename = argv[1];
+  }
+  if (argc > 2) {
+    dc_filename = argv[2];
+  }
+  if (argc > 3) {
+    port = atoi(argv[3]);
+  }
+
+#ifdef HAVE_PYTHON
+  Py_Initialize();
+#endif
+
+  Tracks tracks;
+  if (motion_filename == "-") {
+    synthesize_motion(tracks, 200, (int)(120.0 / broadcast_period));
+  } else if (!read_motion(tracks, motion_filename)) {
+    nout << "Unable to read " << motion_filename << "\n";
+    return (1);
+  }
+
+  size_t num_samples = 0;
+  for (size_t av = 0; av < tracks.size(); ++av) {
+    num_samples = max(num_samples, tracks[av].size());
+  }
+  double seconds = (num_samples - 1) * broadcast_period;
+  nout << tracks.size() << " avatars, " << seconds << " seconds of motion\n";
+
+  Result results[2];
+  for (int delta = 0; delta < 2; ++delta) {
+    if (!run_test(results[delta], tracks, dc_filename, port + delta, delta != 0)) {
+      return (1);
+    }
+  }
+
+  double num_avatars = (double)tracks.size();
+  for (int delta = 0; delta < 2; ++delta) {
+    const Result &result = results[delta];
+    nout << (delta ? "delta:    " : "absolute: ")
+         << result._num_messages / num_avatars / seconds << " msgs/sec, "
+         << result._num_bytes / num_avatars / seconds
+         << " bytes/sec per avatar ("
+         << (result._num_bytes - result._num_header_bytes) / num_avatars / seconds
+         << " past the message headers); max error "
+         << result._max_pos_error << " ft, "
+         << result._max_h_error << " deg\n";
+  }
+  nout << "delta encoding sends "
+       << 100.0 * results[1]._num_bytes / results[0]._num_bytes
+       << "% of the bytes, and "
+       << 100.0 * (results[1]._num_bytes - results[1]._num_header_bytes) /
+    (results[0]._num_bytes - results[0]._num_header_bytes)
+       << "% of the bytes past the message headers\n";
+
+  // Both modes send positions to a tenth of a foot, although the
+  // absolute mode also ignores changes smaller than its epsilon.  The
+  // quantized heading has a resolution of 360/256 degrees, and is
+  // measured from a keyframe heading sent to a tenth of a degree.
+  if (results[0]._max_pos_error > 0.061 || results[1]._max_pos_error > 0.051 ||
+      results[1]._max_h_error > 180.0 / 256.0 + 0.051) {
+    nout << "Decoded position is out of tolerance!\n";
+    return (1);
+  }
+  return (0);
+}
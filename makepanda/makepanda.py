@@ -4515,6 +4515,7 @@ if (PkgSkip("DIRECT")==0):
   TargetAdd('p3distributed_config_distributed.obj', opts=OPTS, input='config_distributed.cxx')
   TargetAdd('p3distributed_cConnectionRepository.obj', opts=OPTS, input='cConnectionRepository.cxx')
   TargetAdd('p3distributed_cDistributedSmoothNodeBase.obj', opts=OPTS, input='cDistributedSmoothNodeBase.cxx')
+  TargetAdd('p3distributed_cDistributedUpdateHandler.obj', opts=OPTS, input='cDistributedUpdateHandler.cxx')
   IGATEFILES=GetDirectoryContents('direct/src/distributed', ["*.h", "*.cxx"])
   TargetAdd('libp3distributed.in', opts=OPTS, input=IGATEFILES)
   TargetAdd('libp3distributed.in', opts=['IMOD:panda3d.direct', 'ILIB:libp3distributed', 'SRCDIR:direct/src/distributed'])
@@ -4572,6 +4573,7 @@ if (PkgSkip("DIRECT")==0):
   TargetAdd('libp3direct.dll', input='p3distributed_config_distributed.obj')
   TargetAdd('libp3direct.dll', input='p3distributed_cConnectionRepository.obj')
   TargetAdd('libp3direct.dll', input='p3distributed_cDistributedSmoothNodeBase.obj')
+  TargetAdd('libp3direct.dll', input='p3distributed_cDistributedUpdateHandler.obj')
   TargetAdd('libp3direct.dll', input='libp3distributed_igate.obj')
   TargetAdd('libp3direct.dll', input=COMMON_PANDA_LIBS)
   TargetAdd('libp3direct.dll', opts=['ADVAPI',  'OPENSSL', 'WINUSER', 'WINGDI'])
@@ -4952,6 +4954,14 @@ if (PkgSkip("PANDATOOL")==0):
   TargetAdd('bam-info.exe', input=COMMON_PANDA_LIBS_PYSTUB)
   TargetAdd('bam-info.exe', opts=['ADVAPI', 'FFTW'])
 
+  TargetAdd('bam-lod_bamLod.obj', opts=OPTS, input='bamLod.cxx')
+  TargetAdd('bam-lod.exe', input='bam-lod_bamLod.obj')
+  TargetAdd('bam-lod.exe', input='libp3progbase.lib')
+  TargetAdd('bam-lod.exe', input='libp3pandatoolbase.lib')
+  TargetAdd('bam-lod.exe', input='libpandaegg.dll')
+  TargetAdd('bam-lod.exe', input=COMMON_PANDA_LIBS_PYSTUB)
+  TargetAdd('bam-lod.exe', opts=['ADVAPI', 'FFTW'])
+
   TargetAdd('bam2egg_bamToEgg.obj', opts=OPTS, input='bamToEgg.cxx')
   TargetAdd('bam2egg.exe', input='bam2egg_bamToEgg.obj')
   TargetAdd('bam2egg.exe', input=COMMON_EGG2X_LIBS_PYSTUB)
@@ -5294,6 +5304,16 @@ if (PkgSkip("PANDATOOL")==0):
   TargetAdd('image-resize.exe', input='libp3pystub.lib')
   TargetAdd('image-resize.exe', opts=['ADVAPI'])
 
+  TargetAdd('image-stream_imageStream.obj', opts=OPTS, input='imageStream.cxx')
+  TargetAdd('image-stream.exe', input='image-stream_imageStream.obj')
+  TargetAdd('image-stream.exe', input='libp3imagebase.lib')
+  TargetAdd('image-stream.exe', input='libp3progbase.lib')
+  TargetAdd('image-stream.exe', input='libp3pandatoolbase.lib')
+  TargetAdd('image-stream.exe', input='libpandaegg.dll')
+  TargetAdd('image-stream.exe', input=COMMON_PANDA_LIBS)
+  TargetAdd('image-stream.exe', input='libp3pystub.lib')
+  TargetAdd('image-stream.exe', opts=['ADVAPI'])
+
   TargetAdd('image-trans_imageTrans.obj', opts=OPTS, input='imageTrans.cxx')
   TargetAdd('image-trans.exe', input='image-trans_imageTrans.obj')
   TargetAdd('image-trans.exe', input='libp3imagebase.lib')
@@ -46,6 +46,8 @@
 #include "config_pgraph.h"
 #include "displayRegionCullCallbackData.h"
 #include "displayRegionDrawCallbackData.h"
+#include "virtualFileReadCache.h"
+#include "pStatCollectorForward.h"
 
 #if defined(WIN32)
   #define WINDOWS_LEAN_AND_MEAN
@@ -81,6 +83,8 @@ PStatCollector GraphicsEngine::_dirty_cyclers_pcollector("Dirty PipelineCyclers"
 PStatCollector GraphicsEngine::_delete_pcollector("App:Delete");
 
 
+PStatCollector GraphicsEngine::_vfs_read_cache_hit_pcollector("VFS read cache:Hits");
+PStatCollector GraphicsEngine::_vfs_read_cache_miss_pcollector("VFS read cache:Misses");
 PStatCollector GraphicsEngine::_sw_sprites_pcollector("SW Sprites");
 PStatCollector GraphicsEngine::_vertex_data_small_pcollector("Vertex Data:Small");
 PStatCollector GraphicsEngine::_vertex_data_independent_pcollector("Vertex Data:Independent");
@@ -151,6 +155,15 @@ GraphicsEngine(Pipeline *pipeline) :
 
   _singular_warning_last_frame = false;
   _singular_warning_this_frame = false;
+
+#ifdef DO_PSTATS
+  // The VirtualFileSystem can't see PStats directly, so we hand it
+  // forward references to the collectors that count its cache hits
+  // and misses.  We reset these each frame, below.
+  VirtualFileReadCache::set_collectors
+    (new PStatCollectorForward(_vfs_read_cache_hit_pcollector),
+     new PStatCollectorForward(_vfs_read_cache_miss_pcollector));
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -843,6 +856,8 @@ render_frame() {
     }
     
     _sw_sprites_pcollector.clear_level();
+    _vfs_read_cache_hit_pcollector.clear_level();
+    _vfs_read_cache_miss_pcollector.clear_level();
     
     _cnode_volume_pcollector.clear_level();
     _gnode_volume_pcollector.clear_level();
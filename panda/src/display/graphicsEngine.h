@@ -364,6 +364,8 @@ private:
   static PStatCollector _cyclers_pcollector;
   static PStatCollector _dirty_cyclers_pcollector;
   static PStatCollector _delete_pcollector;
+  static PStatCollector _vfs_read_cache_hit_pcollector;
+  static PStatCollector _vfs_read_cache_miss_pcollector;
 
   static PStatCollector _sw_sprites_pcollector;
   static PStatCollector _vertex_data_small_pcollector;
@@ -27,6 +27,7 @@
     httpCookie.I httpCookie.h \
     httpDate.I httpDate.h \
     httpDigestAuthorization.I httpDigestAuthorization.h \
+    httpDownloadQueue.I httpDownloadQueue.h \
     httpEntityTag.I httpEntityTag.h \
     httpEnum.h \
     identityStream.I identityStream.h \
@@ -59,6 +60,7 @@
     httpCookie.cxx \
     httpDate.cxx \
     httpDigestAuthorization.cxx \
+    httpDownloadQueue.cxx \
     httpEntityTag.cxx \
     httpEnum.cxx \
     identityStream.cxx identityStreamBuf.cxx \
@@ -89,6 +91,7 @@
     httpCookie.I httpCookie.h \
     httpDate.I httpDate.h \
     httpDigestAuthorization.I httpDigestAuthorization.h \
+    httpDownloadQueue.I httpDownloadQueue.h \
     httpEntityTag.I httpEntityTag.h \
     httpEnum.h \
     identityStream.I identityStream.h \
@@ -106,3 +109,15 @@
   #define IGATESCAN all
 
 #end lib_target
+
+#if $[HAVE_OPENSSL]
+#begin test_bin_target
+  #define TARGET test_http_download_queue
+  #define LOCAL_LIBS $[LOCAL_LIBS] p3downloader
+  #define OTHER_LIBS $[OTHER_LIBS] p3pystub
+
+  #define SOURCES \
+    test_http_download_queue.cxx
+
+#end test_bin_target
+#endif
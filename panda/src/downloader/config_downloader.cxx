@@ -106,6 +106,21 @@ ConfigVariableInt http_max_connect_count
           "prevent the code from attempting runaway connections; this limit "
           "should never be reached in practice."));
 
+ConfigVariableInt http_max_connections_per_host
+("http-max-connections-per-host", 4,
+ PRC_DESC("This is the maximum number of idle connections to any one "
+          "server that HTTPClient::recycle_channel() will keep open for "
+          "reuse, and the default number of connections an "
+          "HTTPDownloadQueue will open to download documents in "
+          "parallel."));
+
+ConfigVariableInt http_pipeline_depth
+("http-pipeline-depth", 4,
+ PRC_DESC("This is the default number of requests an HTTPDownloadQueue "
+          "will send on one connection before the first response has "
+          "been received, when the server supports it.  Set this to 1 "
+          "to disable HTTP pipelining."));
+
 ConfigVariableInt tcp_header_size
 ("tcp-header-size", 2,
  PRC_DESC("Specifies the number of bytes to use to specify the datagram "
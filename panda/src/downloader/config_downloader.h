@@ -44,6 +44,8 @@ extern ConfigVariableDouble http_timeout;
 extern ConfigVariableInt http_skip_body_size;
 extern ConfigVariableDouble http_idle_timeout;
 extern ConfigVariableInt http_max_connect_count;
+extern ConfigVariableInt http_max_connections_per_host;
+extern ConfigVariableInt http_pipeline_depth;
 
 extern EXPCL_PANDAEXPRESS ConfigVariableInt tcp_header_size;
 
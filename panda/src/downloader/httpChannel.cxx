@@ -315,6 +315,12 @@ run() {
       << "run().\n";
   }
 
+  if (!_pipeline_send.empty() && !_bio.is_null()) {
+    // Finish writing out any requests sent ahead by
+    // pipeline_get_document().
+    flush_pipeline();
+  }
+
   if (_state == _done_state || _state == S_failure) {
     clear_extra_headers();
     if (!reached_done_state()) {
@@ -839,6 +845,119 @@ get_connection() {
   return stream;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPChannel::pipeline_get_document
+//       Access: Published
+//  Description: Sends a GET request for the indicated document ahead
+//               of time, on the connection that is still delivering
+//               the response to the current request.  When the
+//               current response has been read, a subsequent
+//               begin_get_document() (or get_document()) of the same
+//               document takes up the server's answer without sending
+//               the request again, and without waiting for a round
+//               trip to the server.  Several documents may be
+//               requested ahead in this way; they must then be
+//               retrieved in the same order.
+//
+//               This is possible only once the final response to the
+//               current GET request has begun to arrive, from an
+//               HTTP/1.1 server that will keep the connection open,
+//               over a direct persistent connection to the same
+//               server as the indicated document.  Returns true if
+//               the request was sent, or false if it cannot be
+//               pipelined now, in which case the document must simply
+//               be requested in the usual way later.
+//
+//               Any extra headers given to send_extra_header() are
+//               not included in the request sent ahead.  If the next
+//               request made on this channel does not match the next
+//               request sent ahead, for any reason, the connection is
+//               dropped and a new one opened to send the new request.
+////////////////////////////////////////////////////////////////////
+bool HTTPChannel::
+pipeline_get_document(const DocumentSpec &url) {
+  if (_bio.is_null() || _source.is_null() || !get_persistent_connection() ||
+      !_proxy.empty() || _method != HTTPEnum::M_get ||
+      _client->get_http_version() < HTTPEnum::HV_11) {
+    return false;
+  }
+
+  // The server must have begun its final response to the current
+  // request; until then, it might still be redirected or asked for
+  // authorization, and resent on this connection.
+  bool final_response = 
+    (_done_state == S_read_header && _state == S_read_header) ||
+    (_done_state == S_read_trailer && _state >= S_read_header && 
+     _state != S_failure);
+  if (!final_response || get_http_version() < HTTPEnum::HV_11 ||
+      will_close_connection()) {
+    return false;
+  }
+
+  const URLSpec &old_url = _request.get_url();
+  const URLSpec &new_url = url.get_url();
+  if (new_url.get_scheme() != old_url.get_scheme() ||
+      new_url.get_server() != old_url.get_server() ||
+      new_url.get_port() != old_url.get_port()) {
+    return false;
+  }
+
+  // Build the request exactly as begin_get_document() will build it
+  // later, so that the two can be matched up.  This is done with the
+  // same member variables used for the current request, so they must
+  // be saved and restored around it.
+  DocumentSpec request = _request;
+  HTTPEnum::Method method = _method;
+  string body = _body;
+  size_t first_byte_requested = _first_byte_requested;
+  size_t last_byte_requested = _last_byte_requested;
+  string header = _header;
+  string request_text = _request_text;
+  string send_extra_headers = _send_extra_headers;
+  string proxy_realm = _proxy_realm;
+  string proxy_username = _proxy_username;
+  PT(HTTPAuthorization) proxy_auth = _proxy_auth;
+  string www_realm = _www_realm;
+  string www_username = _www_username;
+  PT(HTTPAuthorization) www_auth = _www_auth;
+
+  _request = url;
+  _method = HTTPEnum::M_get;
+  _body = string();
+  _first_byte_requested = 0;
+  _last_byte_requested = 0;
+  _send_extra_headers = string();
+  make_header();
+  make_request_text();
+  string pipelined_text = _request_text;
+
+  _request = request;
+  _method = method;
+  _body = body;
+  _first_byte_requested = first_byte_requested;
+  _last_byte_requested = last_byte_requested;
+  _header = header;
+  _request_text = request_text;
+  _send_extra_headers = send_extra_headers;
+  _proxy_realm = proxy_realm;
+  _proxy_username = proxy_username;
+  _proxy_auth = proxy_auth;
+  _www_realm = www_realm;
+  _www_username = www_username;
+  _www_auth = www_auth;
+
+  if (downloader_cat.is_debug()) {
+    downloader_cat.debug()
+      << _NOTIFY_HTTP_CHANNEL_ID 
+      << "pipelining GET " << url << "\n";
+  }
+
+  _pipelined_requests.push_back(pipelined_text);
+  _pipeline_send += pipelined_text;
+  flush_pipeline();
+  return !_pipelined_requests.empty();
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: HTTPChannel::downcase
 //       Access: Public, Static
@@ -1802,6 +1921,36 @@ run_ssl_handshake() {
 ////////////////////////////////////////////////////////////////////
 bool HTTPChannel::
 run_ready() {
+  // Any requests sent ahead must be on their way before this one.
+  if (!_pipeline_send.empty()) {
+    if (!flush_pipeline()) {
+      return true;
+    }
+  }
+
+  if (!_pipelined_requests.empty()) {
+    if (_pipelined_requests.front() == _request_text) {
+      // This request has already been sent by
+      // pipeline_get_document(); its response is next in line.
+      _pipelined_requests.pop_front();
+      _state = S_request_sent;
+      _sent_request_time = TrueClock::get_global_ptr()->get_short_time();
+      return false;
+    }
+
+    // The server will answer the requests sent ahead before this
+    // one.  Rather than skip past all of those responses, start over
+    // with a new connection.
+    if (downloader_cat.is_debug()) {
+      downloader_cat.debug()
+        << _NOTIFY_HTTP_CHANNEL_ID 
+        << "resetting to discard " << _pipelined_requests.size()
+        << " pipelined requests.\n";
+    }
+    reset_to_new();
+    return false;
+  }
+
   // If there's a request to be sent upstream, send it now.
   if (!_request_text.empty()) {
    if (!server_send(_request_text, false)) {
@@ -3114,6 +3263,54 @@ server_send(const string &str, bool secret) {
   return true;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPChannel::flush_pipeline
+//       Access: Private
+//  Description: Writes as much as possible of the requests sent ahead
+//               by pipeline_get_document() to the server.  Returns
+//               true if they have all been sent, or false if some
+//               remain (or the connection has been lost).
+//
+//               Unlike server_send(), this does not reset the
+//               connection if the write fails, since the response to
+//               the current request may still be in the middle of
+//               being read; the requests sent ahead are simply
+//               forgotten, and the loss of the connection will be
+//               noticed by the reading side.
+////////////////////////////////////////////////////////////////////
+bool HTTPChannel::
+flush_pipeline() {
+  nassertr(!_bio.is_null(), false);
+
+  while (!_pipeline_send.empty()) {
+    int write_count =
+      BIO_write(*_bio, _pipeline_send.data(), _pipeline_send.length());
+    if (write_count <= 0) {
+      if (BIO_should_retry(*_bio)) {
+        // The pipe is full.  Wait till later.
+        return false;
+      }
+      if (downloader_cat.is_debug()) {
+        downloader_cat.debug()
+          << _NOTIFY_HTTP_CHANNEL_ID 
+          << "Lost connection to server while pipelining requests.\n";
+      }
+      _pipelined_requests.clear();
+      _pipeline_send = string();
+      return false;
+    }
+
+#ifndef NDEBUG
+    if (downloader_cat.is_debug()) {
+      show_send(_pipeline_send.substr(0, write_count));
+    }
+#endif
+    _pipeline_send = _pipeline_send.substr(write_count);
+  }
+
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: HTTPChannel::parse_http_response
 //       Access: Private
@@ -4031,6 +4228,8 @@ close_connection() {
   _bio.clear();
   _working_get = string();
   _sent_so_far = 0;
+  _pipelined_requests.clear();
+  _pipeline_send = string();
   _read_index++;
 }
 
@@ -33,6 +33,7 @@
 #include "bioStreamPtr.h"
 #include "pmap.h"
 #include "pvector.h"
+#include "pdeque.h"
 #include "pointerTo.h"
 #include "config_downloader.h"
 #include "filename.h"
@@ -186,6 +187,9 @@ PUBLISHED:
   bool run();
   INLINE void begin_connect_to(const DocumentSpec &url);
 
+  bool pipeline_get_document(const DocumentSpec &url);
+  INLINE int get_num_pipelined_requests() const;
+
   ISocketStream *open_read_body();
   void close_read_body(istream *stream) const;
 
@@ -244,6 +248,7 @@ private:
   bool server_get(string &str, size_t num_bytes);
   bool server_get_failsafe(string &str, size_t num_bytes);
   bool server_send(const string &str, bool secret);
+  bool flush_pipeline();
   bool parse_http_response(const string &line);
   bool parse_http_header();
   bool parse_content_range(const string &content_range);
@@ -430,6 +435,13 @@ private:
   int _last_status_code;
   double _last_run_time;
 
+  // The text of each request sent ahead by pipeline_get_document(),
+  // in the order the server will answer them, and whatever part of
+  // them could not yet be written to the socket.
+  typedef pdeque<string> PipelinedRequests;
+  PipelinedRequests _pipelined_requests;
+  string _pipeline_send;
+
   // RAU we find that we may need a little more time for the
   // ssl handshake when the phase files are downloading
   double _extra_ssl_handshake_time;
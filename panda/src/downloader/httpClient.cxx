@@ -160,6 +160,7 @@ HTTPClient() {
   _http_version = HTTPEnum::HV_11;
   _verify_ssl = verify_ssl ? VS_normal : VS_no_verify;
   _ssl_ctx = (SSL_CTX *)NULL;
+  _max_connections_per_host = http_max_connections_per_host;
 
   set_proxy_spec(http_proxy);
   set_direct_host_spec(http_direct_hosts);
@@ -235,6 +236,7 @@ operator = (const HTTPClient &copy) {
   _verify_ssl = copy._verify_ssl;
   _usernames = copy._usernames;
   _cookies = copy._cookies;
+  _max_connections_per_host = copy._max_connections_per_host;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -1170,6 +1172,114 @@ make_channel(bool persistent_connection) {
   return doc;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPClient::get_pooled_channel
+//       Access: Published
+//  Description: Returns a persistent HTTPChannel suitable for
+//               retrieving documents from the server of the
+//               indicated URL.  If a channel that last spoke to the
+//               same server has been returned to recycle_channel(),
+//               and its connection is still open, that channel is
+//               returned, so that its connection may be reused;
+//               otherwise, a new channel is created.
+//
+//               When you are done with the channel, pass it to
+//               recycle_channel() so that its connection may be used
+//               again.
+////////////////////////////////////////////////////////////////////
+PT(HTTPChannel) HTTPClient::
+get_pooled_channel(const URLSpec &url) {
+  PT(HTTPChannel) channel;
+  _channel_pool_lock.acquire();
+
+  ChannelPool::iterator pi = _channel_pool.find(get_pool_key(url));
+  if (pi != _channel_pool.end()) {
+    Channels &channels = (*pi).second;
+    // Grab the one on the end; it was most recently returned, and
+    // therefore most likely to be still alive.
+    nassertd(!channels.empty()) { }
+    channel = channels.back();
+    channels.pop_back();
+    if (channels.empty()) {
+      _channel_pool.erase(pi);
+    }
+  }
+
+  _channel_pool_lock.release();
+
+  if (channel == (HTTPChannel *)NULL) {
+    channel = make_channel(true);
+  }
+  return channel;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPClient::recycle_channel
+//       Access: Published
+//  Description: Accepts an HTTPChannel, previously returned by
+//               get_pooled_channel(), that is no longer being used.
+//               If its connection is still open, the channel is kept
+//               to be returned by a future call to
+//               get_pooled_channel() for the same server, up to
+//               get_max_connections_per_host() channels per server;
+//               otherwise, it is simply released.
+////////////////////////////////////////////////////////////////////
+void HTTPClient::
+recycle_channel(HTTPChannel *channel) {
+  nassertv(channel != (HTTPChannel *)NULL && channel->_client == this);
+  if (channel->_bio.is_null() || !channel->get_persistent_connection() ||
+      channel->get_num_pipelined_requests() != 0) {
+    // There's no connection worth keeping.
+    return;
+  }
+
+  string key = get_pool_key(channel->_request.get_url());
+  _channel_pool_lock.acquire();
+
+  Channels &channels = _channel_pool[key];
+  if ((int)channels.size() < _max_connections_per_host) {
+    channels.push_back(channel);
+  }
+
+  _channel_pool_lock.release();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPClient::clear_channel_pool
+//       Access: Published
+//  Description: Releases all of the channels kept by
+//               recycle_channel(), closing their connections.
+////////////////////////////////////////////////////////////////////
+void HTTPClient::
+clear_channel_pool() {
+  ChannelPool channel_pool;
+  _channel_pool_lock.acquire();
+  _channel_pool.swap(channel_pool);
+  _channel_pool_lock.release();
+
+  // The channels are released here, outside of the lock.
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPClient::get_num_pooled_channels
+//       Access: Published
+//  Description: Returns the number of idle channels, to all servers,
+//               currently kept by recycle_channel().
+////////////////////////////////////////////////////////////////////
+int HTTPClient::
+get_num_pooled_channels() const {
+  int num_channels = 0;
+  _channel_pool_lock.acquire();
+
+  ChannelPool::const_iterator pi;
+  for (pi = _channel_pool.begin(); pi != _channel_pool.end(); ++pi) {
+    num_channels += (int)(*pi).second.size();
+  }
+
+  _channel_pool_lock.release();
+  return num_channels;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: HTTPClient::post_form
 //       Access: Published
@@ -1265,6 +1375,18 @@ get_ssl_ctx() {
   return _ssl_ctx;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPClient::get_pool_key
+//       Access: Private, Static
+//  Description: Returns the string by which channels connected to the
+//               server of the indicated URL are grouped in the
+//               channel pool.
+////////////////////////////////////////////////////////////////////
+string HTTPClient::
+get_pool_key(const URLSpec &url) {
+  return url.get_scheme() + "://" + url.get_server_and_port();
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: HTTPClient::check_preapproved_server_certificate
 //       Access: Private
@@ -35,6 +35,7 @@
 #include "pset.h"
 #include "referenceCount.h"
 #include "openSSLWrapper.h"
+#include "mutexImpl.h"
 
 class Filename;
 class HTTPChannel;
@@ -124,6 +125,15 @@ PUBLISHED:
   INLINE const string &get_cipher_list() const;
 
   PT(HTTPChannel) make_channel(bool persistent_connection);
+
+  PT(HTTPChannel) get_pooled_channel(const URLSpec &url);
+  void recycle_channel(HTTPChannel *channel);
+  void clear_channel_pool();
+  int get_num_pooled_channels() const;
+
+  INLINE void set_max_connections_per_host(int max_connections);
+  INLINE int get_max_connections_per_host() const;
+
   BLOCKING PT(HTTPChannel) post_form(const URLSpec &url, const string &body);
   BLOCKING PT(HTTPChannel) get_document(const URLSpec &url);
   BLOCKING PT(HTTPChannel) get_header(const URLSpec &url);
@@ -154,6 +164,8 @@ private:
 
   void unload_client_certificate();
 
+  static string get_pool_key(const URLSpec &url);
+
   static X509_NAME *parse_x509_name(const string &source);
   static bool x509_name_subset(X509_NAME *name_a, X509_NAME *name_b);
 
@@ -213,6 +225,13 @@ private:
   typedef pmap<string, PreapprovedServerCert> PreapprovedServerCerts;
   PreapprovedServerCerts _preapproved_server_certs;
 
+  // The idle persistent channels, by the server they last spoke to.
+  typedef pvector< PT(HTTPChannel) > Channels;
+  typedef pmap<string, Channels> ChannelPool;
+  ChannelPool _channel_pool;
+  int _max_connections_per_host;
+  mutable MutexImpl _channel_pool_lock;
+
   static PT(HTTPClient) _global_ptr;
 
   friend class HTTPChannel;
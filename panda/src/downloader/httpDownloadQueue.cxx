@@ -0,0 +1,326 @@
+// Filename: httpDownloadQueue.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "httpDownloadQueue.h"
+#include "config_downloader.h"
+#include "trueClock.h"
+
+#ifdef HAVE_OPENSSL
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::Constructor
+//       Access: Published
+//  Description:
+////////////////////////////////////////////////////////////////////
+HTTPDownloadQueue::
+HTTPDownloadQueue(HTTPClient *client) :
+  _client(client)
+{
+  _max_connections = max(_client->get_max_connections_per_host(), 1);
+  _pipeline_depth = max((int)http_pipeline_depth, 1);
+  _num_done = 0;
+  _num_failed = 0;
+  _num_pipelined = 0;
+  _bytes_downloaded = 0;
+  _start_time = -1.0;
+  _elapsed_time = 0.0;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::Destructor
+//       Access: Published
+//  Description: Any documents still downloading are abandoned, and
+//               their connections closed.
+////////////////////////////////////////////////////////////////////
+HTTPDownloadQueue::
+~HTTPDownloadQueue() {
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::add_request
+//       Access: Published
+//  Description: Adds the indicated document to the list of documents
+//               to download, into the indicated Ramfile.  The Ramfile
+//               must remain valid until the document has been
+//               downloaded.  Returns the index number of the request,
+//               for querying its status later.
+////////////////////////////////////////////////////////////////////
+int HTTPDownloadQueue::
+add_request(const DocumentSpec &url, Ramfile *ramfile) {
+  nassertr(ramfile != (Ramfile *)NULL, -1);
+  Request request;
+  request._url = url;
+  request._ramfile = ramfile;
+  request._done = false;
+  request._valid = false;
+  request._status_code = 0;
+
+  int n = (int)_requests.size();
+  _requests.push_back(request);
+  _pending.push_back(n);
+  return n;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::add_request
+//       Access: Published
+//  Description: Adds the indicated document to the list of documents
+//               to download, into the indicated file on disk.
+//               Returns the index number of the request, for querying
+//               its status later.
+////////////////////////////////////////////////////////////////////
+int HTTPDownloadQueue::
+add_request(const DocumentSpec &url, const Filename &filename) {
+  Request request;
+  request._url = url;
+  request._ramfile = (Ramfile *)NULL;
+  request._filename = filename;
+  request._done = false;
+  request._valid = false;
+  request._status_code = 0;
+
+  int n = (int)_requests.size();
+  _requests.push_back(request);
+  _pending.push_back(n);
+  return n;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::run
+//       Access: Published
+//  Description: This must be called from time to time to make
+//               progress on the downloads.  It opens connections as
+//               needed, up to get_max_connections(), runs each of
+//               them, and sends further requests ahead on each
+//               connection, up to get_pipeline_depth(), as the
+//               server allows.
+//
+//               The return value is true if there are still documents
+//               to download (and run() will need to be called again
+//               in the future), or false if all of the documents have
+//               been downloaded.
+////////////////////////////////////////////////////////////////////
+bool HTTPDownloadQueue::
+run() {
+  if (_slots.empty() && _pending.empty()) {
+    return false;
+  }
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  if (_start_time < 0.0) {
+    _start_time = clock->get_short_time();
+  }
+
+  // Open another connection for each document waiting, up to the
+  // limit.
+  while ((int)_slots.size() < _max_connections && !_pending.empty()) {
+    Slot slot;
+    slot._channel = _client->get_pooled_channel
+      (_requests[_pending.front()]._url.get_url());
+    slot._active = -1;
+    _slots.push_back(slot);
+    start_next(_slots.back());
+  }
+
+  Slots::iterator si = _slots.begin();
+  while (si != _slots.end()) {
+    Slot &slot = (*si);
+    bool busy = slot._channel->run();
+
+    // Send what we can ahead before starting the next document on
+    // this connection; once it has been started, the connection can't
+    // take more requests until its response begins to arrive.
+    fill_pipeline(slot, busy);
+
+    if (!busy) {
+      finish_request(slot);
+      if (!start_next(slot)) {
+        // Nothing more for this connection to do.
+        _client->recycle_channel(slot._channel);
+        si = _slots.erase(si);
+        continue;
+      }
+    }
+    ++si;
+  }
+
+  _elapsed_time = clock->get_short_time() - _start_time;
+  return !_slots.empty() || !_pending.empty();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::download_all
+//       Access: Published
+//  Description: Calls run() repeatedly until all of the documents
+//               have been downloaded.  Returns true if they were all
+//               downloaded successfully, false if any failed.
+////////////////////////////////////////////////////////////////////
+bool HTTPDownloadQueue::
+download_all() {
+  while (run()) {
+    thread_yield();
+  }
+  return (_num_failed == 0);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::get_bytes_per_second
+//       Access: Published
+//  Description: Returns the average rate, in bytes per second, at
+//               which the documents have been downloaded so far.
+////////////////////////////////////////////////////////////////////
+double HTTPDownloadQueue::
+get_bytes_per_second() const {
+  if (_elapsed_time <= 0.0) {
+    return 0.0;
+  }
+  return (double)_bytes_downloaded / _elapsed_time;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::get_documents_per_second
+//       Access: Published
+//  Description: Returns the average rate, in documents per second, at
+//               which the documents have been downloaded so far.
+////////////////////////////////////////////////////////////////////
+double HTTPDownloadQueue::
+get_documents_per_second() const {
+  if (_elapsed_time <= 0.0) {
+    return 0.0;
+  }
+  return (double)_num_done / _elapsed_time;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::start_next
+//       Access: Private
+//  Description: Begins downloading the next document on the
+//               indicated idle connection: the first one sent ahead
+//               on it, if any, or else the next one waiting.  Returns
+//               false if there is nothing more to download.
+////////////////////////////////////////////////////////////////////
+bool HTTPDownloadQueue::
+start_next(Slot &slot) {
+  nassertr(slot._active < 0, false);
+
+  int n;
+  if (!slot._pipelined.empty()) {
+    n = slot._pipelined.front();
+    slot._pipelined.pop_front();
+
+  } else if (!_pending.empty()) {
+    n = _pending.front();
+    _pending.pop_front();
+
+    const URLSpec &url = _requests[n]._url.get_url();
+    if (!slot._channel->get_url().empty() &&
+        !same_server(slot._channel->get_url(), url)) {
+      // This connection is to some other server; trade it for one to
+      // the right server.
+      _client->recycle_channel(slot._channel);
+      slot._channel = _client->get_pooled_channel(url);
+    }
+
+  } else {
+    return false;
+  }
+
+  slot._active = n;
+  Request &request = _requests[n];
+  slot._channel->begin_get_document(request._url);
+  if (request._ramfile != (Ramfile *)NULL) {
+    slot._channel->download_to_ram(request._ramfile);
+  } else {
+    slot._channel->download_to_file(request._filename);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::fill_pipeline
+//       Access: Private
+//  Description: Sends as many of the waiting requests ahead on the
+//               indicated connection as it will take, up to the
+//               pipeline depth, stopping at the first one for a
+//               different server.  busy should be true if the
+//               connection's current document is still downloading.
+////////////////////////////////////////////////////////////////////
+void HTTPDownloadQueue::
+fill_pipeline(Slot &slot, bool busy) {
+  if (_pipeline_depth <= 1 || slot._active < 0) {
+    return;
+  }
+
+  const URLSpec &url = _requests[slot._active]._url.get_url();
+  int outstanding = (int)slot._pipelined.size() + (busy ? 1 : 0);
+  while (outstanding < _pipeline_depth && !_pending.empty()) {
+    int n = _pending.front();
+    const DocumentSpec &next = _requests[n]._url;
+    if (!same_server(next.get_url(), url) ||
+        !slot._channel->pipeline_get_document(next)) {
+      return;
+    }
+    _pending.pop_front();
+    slot._pipelined.push_back(n);
+    ++_num_pipelined;
+    ++outstanding;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::finish_request
+//       Access: Private
+//  Description: Records the result of the document just downloaded
+//               on the indicated connection, and marks the
+//               connection idle.
+////////////////////////////////////////////////////////////////////
+void HTTPDownloadQueue::
+finish_request(Slot &slot) {
+  nassertv(slot._active >= 0);
+  HTTPChannel *channel = slot._channel;
+  Request &request = _requests[slot._active];
+
+  request._done = true;
+  request._valid = channel->is_download_complete() && channel->is_valid();
+  request._status_code = channel->get_status_code();
+  _bytes_downloaded += channel->get_bytes_downloaded();
+
+  ++_num_done;
+  if (!request._valid) {
+    ++_num_failed;
+    if (downloader_cat.is_debug()) {
+      downloader_cat.debug()
+        << "Unable to download " << request._url << ": "
+        << channel->get_status_code() << " "
+        << channel->get_status_string() << "\n";
+    }
+  }
+
+  slot._active = -1;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: HTTPDownloadQueue::same_server
+//       Access: Private, Static
+//  Description: Returns true if the two URL's name the same server,
+//               so that one connection may serve both.
+////////////////////////////////////////////////////////////////////
+bool HTTPDownloadQueue::
+same_server(const URLSpec &a, const URLSpec &b) {
+  return (a.get_scheme() == b.get_scheme() &&
+          a.get_server() == b.get_server() &&
+          a.get_port() == b.get_port());
+}
+
+#endif  // HAVE_OPENSSL
@@ -0,0 +1,130 @@
+// Filename: httpDownloadQueue.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef HTTPDOWNLOADQUEUE_H
+#define HTTPDOWNLOADQUEUE_H
+
+#include "pandabase.h"
+
+// This module requires OpenSSL to compile, even if you do not intend
+// to use this to establish https connections; this is because it uses
+// the OpenSSL library to portably handle all of the socket
+// communications.
+
+#ifdef HAVE_OPENSSL
+
+#include "httpClient.h"
+#include "httpChannel.h"
+#include "documentSpec.h"
+#include "filename.h"
+#include "ramfile.h"
+#include "referenceCount.h"
+#include "pointerTo.h"
+#include "pvector.h"
+#include "pdeque.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : HTTPDownloadQueue
+// Description : Downloads a list of documents, using several
+//               connections at once, and, where the server allows it,
+//               sending several requests ahead on each connection
+//               (HTTP pipelining), so that many small documents are
+//               not each held up by a round trip to the server.
+//
+//               Add the documents with add_request(), then either
+//               call download_all(), or call run() from time to time
+//               until it returns false.  The documents are requested
+//               in the order they were added.  The connections are
+//               taken from, and returned to, the HTTPClient's channel
+//               pool; see HTTPClient::get_pooled_channel().
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS HTTPDownloadQueue : public ReferenceCount {
+PUBLISHED:
+  HTTPDownloadQueue(HTTPClient *client = HTTPClient::get_global_ptr());
+  ~HTTPDownloadQueue();
+
+  INLINE void set_max_connections(int max_connections);
+  INLINE int get_max_connections() const;
+  INLINE void set_pipeline_depth(int pipeline_depth);
+  INLINE int get_pipeline_depth() const;
+
+  int add_request(const DocumentSpec &url, Ramfile *ramfile);
+  int add_request(const DocumentSpec &url, const Filename &filename);
+  INLINE int get_num_requests() const;
+  INLINE const DocumentSpec &get_request(int n) const;
+
+  bool run();
+  BLOCKING bool download_all();
+
+  INLINE bool is_request_done(int n) const;
+  INLINE bool is_request_valid(int n) const;
+  INLINE int get_request_status_code(int n) const;
+  INLINE int get_num_done() const;
+  INLINE int get_num_failed() const;
+
+  INLINE size_t get_bytes_downloaded() const;
+  INLINE double get_elapsed_time() const;
+  double get_bytes_per_second() const;
+  double get_documents_per_second() const;
+  INLINE int get_num_pipelined() const;
+
+private:
+  class Request {
+  public:
+    DocumentSpec _url;
+    Ramfile *_ramfile;
+    Filename _filename;
+    bool _done;
+    bool _valid;
+    int _status_code;
+  };
+  typedef pvector<Request> Requests;
+  typedef pdeque<int> Pending;
+
+  // One connection, with the request it is downloading now and those
+  // it has sent ahead.
+  class Slot {
+  public:
+    PT(HTTPChannel) _channel;
+    int _active;
+    Pending _pipelined;
+  };
+  typedef pvector<Slot> Slots;
+
+  bool start_next(Slot &slot);
+  void fill_pipeline(Slot &slot, bool busy);
+  void finish_request(Slot &slot);
+  static bool same_server(const URLSpec &a, const URLSpec &b);
+
+  PT(HTTPClient) _client;
+  int _max_connections;
+  int _pipeline_depth;
+
+  Requests _requests;
+  Pending _pending;
+  Slots _slots;
+
+  int _num_done;
+  int _num_failed;
+  int _num_pipelined;
+  size_t _bytes_downloaded;
+  double _start_time;
+  double _elapsed_time;
+};
+
+#include "httpDownloadQueue.I"
+
+#endif  // HAVE_OPENSSL
+
+#endif
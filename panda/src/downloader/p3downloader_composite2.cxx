@@ -5,6 +5,7 @@
 #include "httpCookie.cxx"
 #include "httpDate.cxx"
 #include "httpDigestAuthorization.cxx"
+#include "httpDownloadQueue.cxx"
 #include "httpEntityTag.cxx"
 #include "httpEnum.cxx"
 #include "identityStream.cxx"
@@ -0,0 +1,126 @@
+// Filename: test_http_download_queue.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "httpClient.h"
+#include "httpDownloadQueue.h"
+#include "ramfile.h"
+#include "pvector.h"
+
+// This downloads a number of small documents from fake_http_server
+// (in panda/src/net), which must already be running, first one at a
+// time over one connection, then over several connections in
+// parallel, then over several connections with pipelining, and
+// reports the rate of each.  The documents are checked against what
+// fake_http_server is known to send.
+//
+// Usage: test_http_download_queue [server:port [num_files [size]]]
+//
+// Start the server with a delay (e.g. fake_http_server 8080 20) to
+// see the effect of a distant server.
+
+////////////////////////////////////////////////////////////////////
+//     Function: expected_body
+//  Description: Returns the document that fake_http_server sends for
+//               the indicated path: the path, repeated to fill the
+//               size given by its first component.
+////////////////////////////////////////////////////////////////////
+static string
+expected_body(const string &path, size_t size) {
+  string body;
+  while (body.size() < size) {
+    body += path;
+  }
+  return body.substr(0, size);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: run_test
+//  Description: Downloads the documents with the indicated settings
+//               and reports the result.  Returns true if all of them
+//               arrived intact.
+////////////////////////////////////////////////////////////////////
+static bool
+run_test(const string &name, HTTPClient *client, const string &server,
+         int num_files, size_t size, int max_connections,
+         int pipeline_depth) {
+  // Start each test with no connections open.
+  client->clear_channel_pool();
+
+  PT(HTTPDownloadQueue) queue = new HTTPDownloadQueue(client);
+  queue->set_max_connections(max_connections);
+  queue->set_pipeline_depth(pipeline_depth);
+
+  pvector<Ramfile> ramfiles(num_files);
+  pvector<string> paths(num_files);
+  int n;
+  for (n = 0; n < num_files; ++n) {
+    ostringstream strm;
+    strm << "/" << size << "/file" << n << ".txt";
+    paths[n] = strm.str();
+    queue->add_request(DocumentSpec(URLSpec("http://" + server + paths[n])),
+                       &ramfiles[n]);
+  }
+
+  queue->download_all();
+
+  int num_bad = 0;
+  for (n = 0; n < num_files; ++n) {
+    if (!queue->is_request_valid(n) ||
+        ramfiles[n]._data != expected_body(paths[n], size)) {
+      ++num_bad;
+    }
+  }
+
+  nout << name << ": " << queue->get_num_done() << " documents in "
+       << queue->get_elapsed_time() * 1000.0 << " ms, "
+       << queue->get_documents_per_second() << " documents/s, "
+       << queue->get_bytes_per_second() / 1024.0 << " KB/s, "
+       << queue->get_num_pipelined() << " pipelined";
+  if (num_bad != 0) {
+    nout << ", " << num_bad << " failed or incorrect";
+  }
+  nout << "\n";
+
+  client->clear_channel_pool();
+  return (num_bad == 0);
+}
+
+int
+main(int argc, char *argv[]) {
+  string server = "localhost:8080";
+  int num_files = 100;
+  size_t size = 2048;
+  if (argc > 1) {
+    server = argv[1];
+  }
+  if (argc > 2) {
+    num_files = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    size = atoi(argv[3]);
+  }
+
+  PT(HTTPClient) client = new HTTPClient;
+  int max_connections = client->get_max_connections_per_host();
+
+  bool ok = true;
+  ok = run_test("sequential", client, server, num_files, size, 1, 1) && ok;
+  ok = run_test("parallel  ", client, server, num_files, size,
+                max_connections, 1) && ok;
+  ok = run_test("pipelined ", client, server, num_files, size,
+                max_connections, 4) && ok;
+
+  return ok ? 0 : 1;
+}
@@ -275,39 +275,25 @@ output(ostream &out) const {
 //       Access: Public
 //  Description: Returns an HTTPChannel object suitable for use for
 //               extracting a document from the current URL root.
+//               This is taken from the HTTPClient's channel pool, so
+//               that connections are shared with other users of the
+//               same client.
 ////////////////////////////////////////////////////////////////////
 PT(HTTPChannel) VirtualFileMountHTTP::
 get_channel() {
-  PT(HTTPChannel) channel;
-  _channels_lock.acquire();
-
-  if (!_channels.empty()) {
-    // If we have some channels sitting around, grab one.  Grab the
-    // one on the end; it was most recently pushed, and therefore most
-    // likely to be still alive.
-    channel = _channels.back();
-    _channels.pop_back();
-  } else {
-    // If we don't have any channels standing by, make a new one.
-    channel = _http->make_channel(true);
-  }
-
-  _channels_lock.release();
-  return channel;
+  return _http->get_pooled_channel(_root);
 }
 
 ////////////////////////////////////////////////////////////////////
 //     Function: VirtualFileMountHTTP::recycle_channel
 //       Access: Public
 //  Description: Accepts an HTTPChannel that is no longer being used,
-//               and restores it to standby duty, so that it will be
+//               and restores it to standby duty, so that it may be
 //               returned by a future call to get_channel().
 ////////////////////////////////////////////////////////////////////
 void VirtualFileMountHTTP::
 recycle_channel(HTTPChannel *channel) {
-  _channels_lock.acquire();
-  _channels.push_back(channel);
-  _channels_lock.release();
+  _http->recycle_channel(channel);
 }
 
 #endif  // HAVE_OPENSSL
@@ -24,7 +24,6 @@
 #include "httpChannel.h"
 #include "urlSpec.h"
 #include "pointerTo.h"
-#include "mutexImpl.h"
 
 ////////////////////////////////////////////////////////////////////
 //       Class : VirtualFileMountHTTP
@@ -68,10 +67,6 @@ private:
   PT(HTTPClient) _http;
   URLSpec _root;
 
-  MutexImpl _channels_lock;
-  typedef pvector< PT(HTTPChannel) > Channels;
-  Channels _channels;
-
 public:
   virtual TypeHandle get_type() const {
     return get_class_type();
@@ -49,7 +49,19 @@ help() {
     "        input files appear to be multifiles.\n\n"
 
     "    -f footprint_length\n"
-    "        Specify the footprint length for the patching algorithm.\n\n";
+    "        Specify the footprint length for the patching algorithm.\n\n"
+
+    "    -r\n"
+    "        Use the rolling-hash algorithm, which is much faster and needs much\n"
+    "        less memory on large files, but may produce a slightly larger patch.\n"
+    "        The patch is applied the same way.\n\n"
+
+    "    -b block_length\n"
+    "        Specify the block length for the rolling-hash algorithm.\n\n"
+
+    "    -j threads\n"
+    "        Search for matches on the indicated number of threads, when the\n"
+    "        rolling-hash algorithm is used.  The patch is the same regardless.\n\n";
 }
 
 int
@@ -60,10 +72,13 @@ main(int argc, char **argv) {
   Filename patch_file;
   bool complete_file = false;
   int footprint_length = 0;
+  bool rolling_hash = false;
+  int block_length = 0;
+  int build_threads = 0;
 
   //  extern char *optarg;
   extern int optind;
-  static const char *optflags = "o:cf:h";
+  static const char *optflags = "o:cf:rb:j:h";
   preprocess_argv(argc, argv);
   int flag = getopt(argc, argv, optflags);
   Filename rel_path;
@@ -81,6 +96,18 @@ main(int argc, char **argv) {
       footprint_length = atoi(optarg);
       break;
 
+    case 'r':
+      rolling_hash = true;
+      break;
+
+    case 'b':
+      block_length = atoi(optarg);
+      break;
+
+    case 'j':
+      build_threads = atoi(optarg);
+      break;
+
     case 'h':
       help();
       return 1;
@@ -117,6 +144,16 @@ main(int argc, char **argv) {
     cerr << "Footprint length is " << footprint_length << "\n";
     pfile.set_footprint_length(footprint_length);
   }
+  if (rolling_hash) {
+    pfile.set_build_mode(Patchfile::BM_rolling_hash);
+  }
+  if (block_length != 0) {
+    cerr << "Block length is " << block_length << "\n";
+    pfile.set_block_length(block_length);
+  }
+  if (build_threads != 0) {
+    pfile.set_build_threads(build_threads);
+  }
 
   cerr << "Building patch file to convert " << src_file << " to "
        << dest_file << endl;
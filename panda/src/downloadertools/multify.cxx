@@ -17,9 +17,11 @@
 #include "panda_getopt.h"
 #include "preprocess_argv.h"
 #include "multifile.h"
+#include "compressionCodec.h"
 #include "pointerTo.h"
 #include "filename.h"
 #include "pset.h"
+#include "pmap.h"
 #include "vector_string.h"
 #include <stdio.h>
 #include <time.h>
@@ -34,6 +36,9 @@ bool kill_cmd = false;         // -k
 bool verbose = false;          // -v
 bool compress_flag = false;    // -z
 int default_compression_level = 6;
+int compression_threads = 0;   // -j
+bool deduplicate = false;      // -D
+CompressionCodec compression_codec = CC_zlib;  // -A
 Filename multifile_name;       // -f
 bool got_multifile_name = false;
 bool to_stdout = false;        // -O
@@ -46,12 +51,16 @@ Filename chdir_to;             // -C
 bool got_chdir_to = false;
 size_t scale_factor = 0;       // -F
 pset<string> dont_compress;    // -Z
+pmap<string, int> ext_compression_levels;  // -L
 pset<string> text_ext;         // -X
 vector_string sign_params;     // -S
 
 // Default extensions not to compress.  May be overridden with -Z.
 string dont_compress_str = "jpg,png,mp3,ogg";
 
+// Per-extension compression levels, as given with -L.
+string ext_compression_levels_str;
+
 // Default text extensions.  May be overridden with -X.
 string text_ext_str = "txt";
 
@@ -212,6 +221,12 @@ help() {
     "      files that are not to be compressed.  The default if this is omitted is\n"
     "      \"" << dont_compress_str << "\".  Specify -Z \"\" (be sure to include the space) to allow\n"
     "      all files to be compressed.\n\n"
+    "  -L <extension:level_list>\n"
+    "      Specify a comma-separated list of filename extensions, each followed\n"
+    "      by a colon and the compression level to use for files with that\n"
+    "      extension when -z is in effect, for instance \"egg:9,wav:1\".  Files\n"
+    "      with extensions not named here use the level given by -1 .. -9.\n"
+    "      Extensions named by -Z are still not compressed.\n\n"
     "  -X <extension_list>\n"
     "      Specify a comma-separated list of filename extensions that represent\n"
     "      text files.  These files are opened and read in text mode, and added to\n"
@@ -227,11 +242,28 @@ help() {
     "      bitwise comparison between multifiles to determine whether their\n"
     "      contents are equivalent.\n\n"
 
+    "  -A <codec>\n"
+    "      Specify the codec used to compress subfiles when -z is in effect.\n"
+    "      This may be \"zlib\", the default, or \"lz\", which does not compress\n"
+    "      as well but decompresses several times faster.  Multifiles that\n"
+    "      use \"lz\" can only be read by a version of Panda that supports it.\n\n"
+
     "  -1 .. -9\n"
     "      Specify the compression level when -z is in effect.  Larger numbers\n"
     "      generate slightly smaller files, but compression takes longer.  The\n"
     "      default is -" << default_compression_level << ".\n\n"
 
+    "  -j <threads>\n"
+    "      Compress and encrypt the new subfiles on the indicated number of\n"
+    "      threads when writing the multifile.  The resulting multifile is the\n"
+    "      same regardless of this setting.  The default is taken from the\n"
+    "      multifile-compression-threads config variable.\n\n"
+
+    "  -D\n"
+    "      Store only one copy of the data for subfiles whose contents are\n"
+    "      identical.  The duplicate subfiles still appear in the multifile\n"
+    "      under their own names.  This requires OpenSSL.\n\n"
+
     "  -S file.crt[,chain.crt[,file.key[,\"password\"]]]\n"
     "      Sign the multifile.  The signing certificate should be in PEM form in\n"
     "      file.crt, with its private key in PEM form in file.key.  If the key\n"
@@ -308,6 +340,12 @@ get_compression_level(const Filename &subfile_name) {
     return 0;
   }
 
+  pmap<string, int>::const_iterator li = ext_compression_levels.find(ext);
+  if (li != ext_compression_levels.end()) {
+    // This extension has its own compression level on the -L list.
+    return (*li).second;
+  }
+
   // Go ahead and compress this file.
   return default_compression_level;
 }
@@ -406,6 +444,16 @@ add_files(const vector_string &params) {
     multifile->set_header_prefix(header_prefix);
   }
 
+  if (compression_threads != 0) {
+    multifile->set_compression_threads(compression_threads);
+  }
+
+  multifile->set_compression_codec(compression_codec);
+
+  if (deduplicate) {
+    multifile->set_deduplicate(true);
+  }
+
   if (scale_factor != 0 && scale_factor != multifile->get_scale_factor()) {
     cerr << "Setting scale factor to " << scale_factor << "\n";
     multifile->set_scale_factor(scale_factor);
@@ -754,6 +802,32 @@ tokenize_extensions(const string &str, pset<string> &extensions) {
   extensions.insert(string());
 }
 
+bool
+tokenize_compression_levels(const string &str,
+                            pmap<string, int> &levels) {
+  // Parses the -L parameter, a list of extension:level pairs.
+  pset<string> pairs;
+  tokenize_extensions(str, pairs);
+
+  pset<string>::const_iterator pi;
+  for (pi = pairs.begin(); pi != pairs.end(); ++pi) {
+    const string &pair = (*pi);
+    if (pair.empty()) {
+      continue;
+    }
+    size_t colon = pair.rfind(':');
+    int level;
+    if (colon == string::npos ||
+        !string_to_int(pair.substr(colon + 1), level) ||
+        level < 0 || level > 9) {
+      cerr << "Invalid extension:level pair: " << pair << "\n";
+      return false;
+    }
+    levels[pair.substr(0, colon)] = level;
+  }
+  return true;
+}
+
 int
 main(int argc, char **argv) {
   // A call to pystub() to force libpystub.so to be linked in.
@@ -778,7 +852,7 @@ main(int argc, char **argv) {
 
   extern char *optarg;
   extern int optind;
-  static const char *optflags = "crutxkvz123456789Z:T:X:S:f:OC:ep:P:F:h";
+  static const char *optflags = "crutxkvz123456789Z:T:X:S:f:OC:ep:P:F:L:j:DA:h";
   int flag = getopt(argc, argv, optflags);
   Filename rel_path;
   while (flag != EOF) {
@@ -849,6 +923,28 @@ main(int argc, char **argv) {
     case 'X':
       text_ext_str = optarg;
       break;
+    case 'L':
+      ext_compression_levels_str = optarg;
+      break;
+    case 'A':
+      compression_codec = parse_compression_codec_string(optarg);
+      if (compression_codec == CC_invalid) {
+        cerr << "Invalid compression codec: " << optarg << "\n";
+        usage();
+        return 1;
+      }
+      break;
+    case 'j':
+      if (!string_to_int(optarg, compression_threads) ||
+          compression_threads < 1) {
+        cerr << "Invalid number of threads: " << optarg << "\n";
+        usage();
+        return 1;
+      }
+      break;
+    case 'D':
+      deduplicate = true;
+      break;
     case 'S':
       sign_params.push_back(optarg);
       break;
@@ -938,6 +1034,13 @@ main(int argc, char **argv) {
   // Ditto for -X.
   tokenize_extensions(text_ext_str, text_ext);
 
+  // And -L.
+  if (!tokenize_compression_levels(ext_compression_levels_str,
+                                   ext_compression_levels)) {
+    usage();
+    return 1;
+  }
+
   // Build a list of remaining parameters.
   vector_string params;
   params.reserve(argc - 1);
@@ -154,3 +154,13 @@
 
 #end test_bin_target
 
+#begin test_bin_target
+  #define TARGET test_mesher
+  #define LOCAL_LIBS \
+    p3egg p3putil p3mathutil
+
+  #define SOURCES \
+    test_mesher.cxx
+
+#end test_bin_target
+
@@ -78,6 +78,15 @@ ConfigVariableBool egg_mesh
           "loaded or converted to bam.  Set this false just to triangulate "
           "everything into independent triangles."));
 
+ConfigVariableBool egg_mesh_vertex_cache
+("egg-mesh-vertex-cache", false,
+ PRC_DESC("Set this true, along with egg-mesh, to mesh polygons into "
+          "independent triangles that have been sorted for the best use "
+          "of the post-transform vertex cache, instead of into triangle "
+          "strips and fans.  This takes roughly linear time, and is much "
+          "faster than the strip mesher on very large meshes; it is also "
+          "usually at least as fast to render on modern hardware."));
+
 ConfigVariableBool egg_retesselate_coplanar
 ("egg-retesselate-coplanar", false,
  PRC_DESC("If this is true, the egg loader may reverse the "
@@ -28,6 +28,7 @@ NotifyCategoryDecl(egg, EXPCL_PANDAEGG, EXPTP_PANDAEGG);
 extern ConfigVariableBool egg_support_old_anims;
 
 extern EXPCL_PANDAEGG ConfigVariableBool egg_mesh;
+extern EXPCL_PANDAEGG ConfigVariableBool egg_mesh_vertex_cache;
 extern EXPCL_PANDAEGG ConfigVariableBool egg_retesselate_coplanar;
 extern EXPCL_PANDAEGG ConfigVariableBool egg_unroll_fans;
 extern EXPCL_PANDAEGG ConfigVariableBool egg_show_tstrips;
@@ -857,6 +857,32 @@ mesh_triangles(int flags) {
   }
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: EggGroupNode::optimize_vertex_cache
+//       Access: Published
+//  Description: An alternative to mesh_triangles(): breaks the
+//               polygons at this group into independent triangles,
+//               and sorts them into an order that makes good use of
+//               the post-transform vertex cache.  If T_recurse is
+//               included in flags, this is done at all groups below
+//               as well.
+////////////////////////////////////////////////////////////////////
+void EggGroupNode::
+optimize_vertex_cache(int flags) {
+  EggMesher mesher;
+  mesher.order_triangles(this);
+
+  if ((flags & T_recurse) != 0) {
+    EggGroupNode::iterator ci;
+    for (ci = begin(); ci != end(); ++ci) {
+      if ((*ci)->is_of_type(EggGroupNode::get_class_type())) {
+        EggGroupNode *group_child = DCAST(EggGroupNode, *ci);
+        group_child->optimize_vertex_cache(flags);
+      }
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: EggGroupNode::make_point_primitives
 //       Access: Published
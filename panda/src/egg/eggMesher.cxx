@@ -23,6 +23,8 @@
 #include "eggGroupNode.h"
 #include "dcast.h"
 #include "thread.h"
+#include "vertexCacheOptimizer.h"
+#include "vector_int.h"
 
 #include <stdlib.h>
 
@@ -120,6 +122,89 @@ mesh(EggGroupNode *group, bool flat_shaded) {
   clear();
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: EggMesher::order_triangles
+//       Access: Public
+//  Description: This is an alternative to mesh().  Rather than
+//               building triangle strips, it triangulates the
+//               polygons within the group, and reorders the resulting
+//               triangles so that they make good use of the
+//               post-transform vertex cache when they are rendered
+//               as an indexed triangle list.  Other children of the
+//               group are left unchanged.
+//
+//               Unlike mesh(), this runs in roughly linear time in
+//               the number of triangles.
+////////////////////////////////////////////////////////////////////
+void EggMesher::
+order_triangles(EggGroupNode *group) {
+  group->triangulate_polygons(EggGroupNode::T_polygon | EggGroupNode::T_convex);
+
+  // Only triangles that share a common vertex pool will end up in the
+  // same GeomPrimitive, so each vertex pool is ordered separately.
+  typedef pvector< PT(EggPolygon) > Triangles;
+  typedef pvector<EggVertexPool *> VertexPools;
+  typedef pmap<EggVertexPool *, Triangles> PoolTriangles;
+  VertexPools vertex_pools;
+  PoolTriangles pool_triangles;
+
+  PT(EggGroupNode) output_children = new EggGroupNode;
+  while (!group->empty()) {
+    PT(EggNode) child = group->get_first_child();
+    group->remove_child(child);
+
+    if (child->is_of_type(EggPolygon::get_class_type()) &&
+        DCAST(EggPolygon, child)->size() == 3) {
+      EggPolygon *poly = DCAST(EggPolygon, child);
+      EggVertexPool *vertex_pool = poly->get_pool();
+      PoolTriangles::iterator pi = pool_triangles.find(vertex_pool);
+      if (pi == pool_triangles.end()) {
+        vertex_pools.push_back(vertex_pool);
+        pi = pool_triangles.insert(PoolTriangles::value_type(vertex_pool, Triangles())).first;
+      }
+      (*pi).second.push_back(poly);
+
+    } else {
+      // If it's not a triangle, just output it unchanged.
+      output_children->add_child(child);
+    }
+  }
+
+  VertexCacheOptimizer optimizer;
+  VertexPools::const_iterator vpi;
+  for (vpi = vertex_pools.begin(); vpi != vertex_pools.end(); ++vpi) {
+    const Triangles &triangles = pool_triangles[*vpi];
+
+    // The optimizer sizes its tables by the highest index it is
+    // given, but the vertex pool may be shared by many groups, so we
+    // renumber just the vertices these triangles use from 0.
+    typedef pmap<int, int> DenseIndices;
+    DenseIndices dense_indices;
+    vector_int indices;
+    indices.reserve(triangles.size() * 3);
+    Triangles::const_iterator ti;
+    for (ti = triangles.begin(); ti != triangles.end(); ++ti) {
+      EggPolygon *poly = (*ti);
+      for (int k = 0; k < 3; ++k) {
+        int index = poly->get_vertex(k)->get_index();
+        DenseIndices::const_iterator di = dense_indices.insert
+          (DenseIndices::value_type(index, (int)dense_indices.size())).first;
+        indices.push_back((*di).second);
+      }
+    }
+
+    vector_int triangle_order;
+    optimizer.compute_triangle_order(indices, triangle_order);
+
+    vector_int::const_iterator oi;
+    for (oi = triangle_order.begin(); oi != triangle_order.end(); ++oi) {
+      output_children->add_child(triangles[*oi]);
+    }
+  }
+
+  group->steal_children(*output_children);
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: EggMesher::write
 //       Access: Public
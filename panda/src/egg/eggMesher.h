@@ -37,6 +37,7 @@ public:
   EggMesher();
 
   void mesh(EggGroupNode *group, bool flat_shaded);
+  void order_triangles(EggGroupNode *group);
 
   void write(ostream &out) const;
 
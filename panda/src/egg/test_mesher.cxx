@@ -0,0 +1,144 @@
+// Filename: test_mesher.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "eggGroup.h"
+#include "eggVertexPool.h"
+#include "eggVertex.h"
+#include "eggPolygon.h"
+#include "eggTriangleStrip.h"
+#include "eggTriangleFan.h"
+#include "vertexCacheOptimizer.h"
+#include "trueClock.h"
+#include "randomizer.h"
+#include "pnotify.h"
+#include "dcast.h"
+
+// This program builds a large grid of quads, in random order (as a
+// scanned or decimated mesh would be), and compares the time taken
+// and the resulting vertex cache efficiency of the triangle-strip
+// mesher and of the vertex cache ordering.
+
+static PT(EggGroup)
+make_grid(int size, PT(EggVertexPool) &vpool) {
+  vpool = new EggVertexPool("grid");
+  int x, y;
+  for (y = 0; y <= size; ++y) {
+    for (x = 0; x <= size; ++x) {
+      EggVertex vertex;
+      vertex.set_pos(LPoint3d(x, y, 0.0));
+      vpool->add_vertex(new EggVertex(vertex), y * (size + 1) + x);
+    }
+  }
+
+  typedef pvector< PT(EggPolygon) > Quads;
+  Quads quads;
+  for (y = 0; y < size; ++y) {
+    for (x = 0; x < size; ++x) {
+      PT(EggPolygon) quad = new EggPolygon;
+      quad->add_vertex(vpool->get_vertex(y * (size + 1) + x));
+      quad->add_vertex(vpool->get_vertex(y * (size + 1) + x + 1));
+      quad->add_vertex(vpool->get_vertex((y + 1) * (size + 1) + x + 1));
+      quad->add_vertex(vpool->get_vertex((y + 1) * (size + 1) + x));
+      quads.push_back(quad);
+    }
+  }
+
+  // Shuffle the quads, with a fixed seed so that each run sees the
+  // same input.
+  Randomizer random(1);
+  for (int i = (int)quads.size() - 1; i > 0; --i) {
+    swap(quads[i], quads[random.random_int(i + 1)]);
+  }
+
+  PT(EggGroup) group = new EggGroup("grid");
+  Quads::const_iterator qi;
+  for (qi = quads.begin(); qi != quads.end(); ++qi) {
+    group->add_child(*qi);
+  }
+  return group;
+}
+
+static void
+report(const string &name, EggGroupNode *group, double elapsed) {
+  // Expand all of the primitives into a single triangle list, which
+  // is the order in which the vertices would reach the cache.
+  vector_int indices;
+  int num_prims = 0;
+  EggGroupNode::const_iterator ci;
+  for (ci = group->begin(); ci != group->end(); ++ci) {
+    if (!(*ci)->is_of_type(EggPrimitive::get_class_type())) {
+      continue;
+    }
+    EggPrimitive *prim = DCAST(EggPrimitive, *ci);
+    ++num_prims;
+    int num_vertices = (int)prim->size();
+
+    if (prim->is_of_type(EggTriangleFan::get_class_type())) {
+      for (int i = 1; i + 1 < num_vertices; ++i) {
+        indices.push_back(prim->get_vertex(0)->get_index());
+        indices.push_back(prim->get_vertex(i)->get_index());
+        indices.push_back(prim->get_vertex(i + 1)->get_index());
+      }
+    } else {
+      // A triangle strip, or a single triangle.
+      for (int i = 0; i + 2 < num_vertices; ++i) {
+        indices.push_back(prim->get_vertex(i)->get_index());
+        indices.push_back(prim->get_vertex(i + 1)->get_index());
+        indices.push_back(prim->get_vertex(i + 2)->get_index());
+      }
+    }
+  }
+
+  nout << name << ": " << elapsed << " s, "
+       << num_prims << " primitives, "
+       << indices.size() / 3 << " triangles, ACMR "
+       << VertexCacheOptimizer::calc_acmr(indices, 16) << " (16), "
+       << VertexCacheOptimizer::calc_acmr(indices, 32) << " (32)\n";
+}
+
+int
+main(int argc, char *argv[]) {
+  int size = 300;
+  if (argc >= 2) {
+    size = atoi(argv[1]);
+  }
+  if (argc > 2 || size <= 0) {
+    nout << "test_mesher [grid-size]\n\n"
+         << "Builds a grid-size x grid-size grid of quads, in random order,\n"
+         << "and meshes it both into triangle strips and into a vertex\n"
+         << "cache-ordered triangle list.\n";
+    exit(1);
+  }
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  PT(EggVertexPool) vpool;
+
+  PT(EggGroup) group = make_grid(size, vpool);
+  group->triangulate_polygons(EggGroupNode::T_polygon | EggGroupNode::T_convex);
+  report("unsorted", group, 0.0);
+
+  group = NULL;
+  group = make_grid(size, vpool);
+  double start = clock->get_short_time();
+  group->mesh_triangles(0);
+  report("triangle strips", group, clock->get_short_time() - start);
+
+  group = NULL;
+  group = make_grid(size, vpool);
+  start = clock->get_short_time();
+  group->optimize_vertex_cache(0);
+  report("vertex cache", group, clock->get_short_time() - start);
+
+  return (0);
+}
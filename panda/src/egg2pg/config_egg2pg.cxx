@@ -154,6 +154,15 @@ ConfigVariableInt egg_max_indices
  PRC_DESC("Specifies the maximum number of vertex indices that will be "
           "added to any one GeomPrimitive by the egg loader."));
 
+ConfigVariableInt egg_load_threads
+("egg-load-threads", 0,
+ PRC_DESC("Specifies the number of threads the egg loader will use to "
+          "mesh and triangulate the polysets of a model before it builds "
+          "the Geoms.  This only helps for models with many separate "
+          "polysets, and requires a Panda built with true threading "
+          "support.  Set this to 0 or 1 to do all of the work on the "
+          "loading thread."));
+
 ConfigVariableBool egg_emulate_bface
 ("egg-emulate-bface", true,
  PRC_DESC("When this is true, the bface flag applied to a polygon will "
@@ -94,6 +94,8 @@
 #include "sparseArray.h"
 #include "bitArray.h"
 #include "thread.h"
+#include "genericThread.h"
+#include "mutexHolder.h"
 #include "uvScrollNode.h"
 #include "textureStagePool.h"
 #include "cmath.h"
@@ -211,6 +213,9 @@ build_graph() {
 
   //  ((EggGroupNode *)_data)->write(cerr, 0);
 
+  // Mesh the polysets up front, possibly on several threads at once.
+  prepare_polysets();
+
   // Now build up the scene graph.
   _root = new ModelRoot(_data->get_egg_filename(), _data->get_egg_timestamp());
 
@@ -223,6 +228,7 @@ build_graph() {
   start_sequences();
 
   apply_deferred_nodes(_root, DeferredNodeProperty());
+  _prepared_polysets.clear();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -325,15 +331,8 @@ make_polyset(EggBin *egg_bin, PandaNode *parent, const LMatrix4d *transform,
     return;
   }
 
-  // We know that all of the primitives in the bin have the same
-  // render state, so we can get that information from the first
-  // primitive.
-  EggGroupNode::const_iterator ci = egg_bin->begin();
-  nassertv(ci != egg_bin->end());
-  CPT(EggPrimitive) first_prim = DCAST(EggPrimitive, (*ci));
-  nassertv(first_prim != (EggPrimitive *)NULL);
-  const EggRenderState *render_state;
-  DCAST_INTO_V(render_state, first_prim->get_user_data(EggRenderState::get_class_type()));
+  const EggRenderState *render_state = get_polyset_render_state(egg_bin);
+  nassertv(render_state != (EggRenderState *)NULL);
 
   if (render_state->_hidden && egg_suppress_hidden) {
     // Eat this polyset.
@@ -343,26 +342,19 @@ make_polyset(EggBin *egg_bin, PandaNode *parent, const LMatrix4d *transform,
   // Generate an optimal vertex pool (or multiple vertex pools, if we
   // have a lot of vertex) for the polygons within just the bin.  Each
   // EggVertexPool translates directly to an optimal GeomVertexData
-  // structure.
+  // structure.  This may have been done already by prepare_polysets().
   EggVertexPools vertex_pools;
-  egg_bin->rebuild_vertex_pools(vertex_pools, (unsigned int)egg_max_vertices, 
-                                false);
-
-  if (egg_mesh) {
-    // If we're using the mesher, mesh now.
-    egg_bin->mesh_triangles(render_state->_flat_shaded ? EggGroupNode::T_flat_shaded : 0);
+  PreparedPolysets::iterator ppi = _prepared_polysets.find(egg_bin);
+  if (ppi != _prepared_polysets.end()) {
+    vertex_pools.swap((*ppi).second);
+    _prepared_polysets.erase(ppi);
 
   } else {
-    // If we're not using the mesher, at least triangulate any
-    // higher-order polygons we might have.
-    egg_bin->triangulate_polygons(EggGroupNode::T_polygon | EggGroupNode::T_convex);
+    egg_bin->rebuild_vertex_pools(vertex_pools, (unsigned int)egg_max_vertices, 
+                                  false);
+    prepare_polyset(egg_bin, render_state);
   }
 
-  // Now that we've meshed, apply the per-prim attributes onto the
-  // vertices, so we can copy them to the GeomVertexData.
-  egg_bin->apply_first_attribute(false);
-  egg_bin->post_apply_flat_attribute(false);
-
   //egg_bin->write(cerr, 0);
 
   PT(GeomNode) geom_node;
@@ -405,6 +397,7 @@ make_polyset(EggBin *egg_bin, PandaNode *parent, const LMatrix4d *transform,
     // types of primitives that reference this vertex pool.
     UniquePrimitives unique_primitives;
     Primitives primitives;
+    EggGroupNode::const_iterator ci;
     for (ci = egg_bin->begin(); ci != egg_bin->end(); ++ci) {
       EggPrimitive *egg_prim;
       DCAST_INTO_V(egg_prim, (*ci));
@@ -1619,6 +1612,188 @@ make_texture_stage(const EggTexture *egg_tex) {
   return TextureStagePool::get_stage(stage);
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: EggLoader::prepare_polysets
+//       Access: Private
+//  Description: Walks through all of the polysets created by the
+//               binner, and rebuilds their vertex pools, meshes and
+//               triangulates them in advance of make_polyset().
+//
+//               Once each polyset has its own vertex pools, the
+//               meshing of one polyset no longer touches any data
+//               shared with another, so if egg-load-threads is
+//               greater than 1, this work is spread across that many
+//               threads.
+////////////////////////////////////////////////////////////////////
+void EggLoader::
+prepare_polysets() {
+  _prepared_polysets.clear();
+
+  int num_threads = egg_load_threads;
+  if (num_threads <= 1 || !Thread::is_threading_supported()) {
+    // Never mind; make_polyset() will do the work as it goes.
+    return;
+  }
+
+  PreparePolysetsJob job;
+  job._loader = this;
+  job._next_bin = 0;
+  collect_polysets(_data, job._bins);
+  if (job._bins.size() <= 1) {
+    return;
+  }
+
+  // The vertex pools must be rebuilt on this thread, since the
+  // original vertices may be shared between several bins.  Each bin
+  // gets its own entry in the map now, so that the threads need not
+  // modify the map itself.
+  pvector<EggBin *>::const_iterator bi;
+  for (bi = job._bins.begin(); bi != job._bins.end(); ++bi) {
+    EggBin *egg_bin = (*bi);
+    egg_bin->rebuild_vertex_pools(_prepared_polysets[egg_bin],
+                                  (unsigned int)egg_max_vertices, false);
+  }
+
+  num_threads = min(num_threads, (int)job._bins.size());
+  pvector< PT(Thread) > threads;
+  threads.reserve(num_threads - 1);
+  for (int i = 1; i < num_threads; ++i) {
+    PT(Thread) thread = 
+      new GenericThread("egg-load", "egg-load", 
+                        &prepare_polysets_thread_main, &job);
+    if (thread->start(TP_normal, true)) {
+      threads.push_back(thread);
+    }
+  }
+
+  // This thread takes its share of the work too.
+  prepare_polysets_thread_main(&job);
+
+  pvector< PT(Thread) >::iterator ti;
+  for (ti = threads.begin(); ti != threads.end(); ++ti) {
+    (*ti)->join();
+  }
+
+  if (egg2pg_cat.is_debug()) {
+    egg2pg_cat.debug()
+      << "Prepared " << job._bins.size() << " polysets using "
+      << threads.size() + 1 << " threads.\n";
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: EggLoader::collect_polysets
+//       Access: Private
+//  Description: Recursively fills the vector with the polyset bins
+//               at this node and below that make_polyset() will
+//               eventually convert.
+////////////////////////////////////////////////////////////////////
+void EggLoader::
+collect_polysets(EggNode *egg_node, pvector<EggBin *> &bins) {
+  if (egg_node->is_of_type(EggBin::get_class_type())) {
+    EggBin *egg_bin = DCAST(EggBin, egg_node);
+    if (egg_bin->get_bin_number() == EggBinner::BN_polyset &&
+        !egg_bin->empty()) {
+      const EggRenderState *render_state = get_polyset_render_state(egg_bin);
+      if (render_state != (EggRenderState *)NULL &&
+          !(render_state->_hidden && egg_suppress_hidden)) {
+        bins.push_back(egg_bin);
+      }
+      return;
+    }
+  }
+
+  if (egg_node->is_of_type(EggGroupNode::get_class_type())) {
+    EggGroupNode *egg_group = DCAST(EggGroupNode, egg_node);
+    EggGroupNode::const_iterator ci;
+    for (ci = egg_group->begin(); ci != egg_group->end(); ++ci) {
+      collect_polysets(*ci, bins);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: EggLoader::prepare_polyset
+//       Access: Private
+//  Description: Meshes or triangulates the primitives of the
+//               indicated polyset, and applies the per-primitive
+//               attributes to the vertices, so that they are ready
+//               to be copied to a GeomVertexData.  The bin's vertex
+//               pools must already have been rebuilt.
+//
+//               This may be called from a thread other than the main
+//               loading thread.
+////////////////////////////////////////////////////////////////////
+void EggLoader::
+prepare_polyset(EggBin *egg_bin, const EggRenderState *render_state) {
+  if (egg_mesh && egg_mesh_vertex_cache) {
+    // Rather than building triangle strips, sort the triangles into
+    // an order that suits the vertex cache.
+    egg_bin->optimize_vertex_cache(0);
+
+  } else if (egg_mesh) {
+    // If we're using the mesher, mesh now.
+    egg_bin->mesh_triangles(render_state->_flat_shaded ? EggGroupNode::T_flat_shaded : 0);
+
+  } else {
+    // If we're not using the mesher, at least triangulate any
+    // higher-order polygons we might have.
+    egg_bin->triangulate_polygons(EggGroupNode::T_polygon | EggGroupNode::T_convex);
+  }
+
+  // Now that we've meshed, apply the per-prim attributes onto the
+  // vertices, so we can copy them to the GeomVertexData.
+  egg_bin->apply_first_attribute(false);
+  egg_bin->post_apply_flat_attribute(false);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: EggLoader::get_polyset_render_state
+//       Access: Private, Static
+//  Description: Returns the EggRenderState shared by all of the
+//               primitives in the indicated polyset, or NULL if the
+//               bin has no primitives.
+////////////////////////////////////////////////////////////////////
+const EggRenderState *EggLoader::
+get_polyset_render_state(EggBin *egg_bin) {
+  // We know that all of the primitives in the bin have the same
+  // render state, so we can get that information from the first
+  // primitive.
+  EggGroupNode::const_iterator ci = egg_bin->begin();
+  nassertr(ci != egg_bin->end(), NULL);
+  EggPrimitive *first_prim;
+  DCAST_INTO_R(first_prim, (*ci), NULL);
+  const EggRenderState *render_state;
+  DCAST_INTO_R(render_state, first_prim->get_user_data(EggRenderState::get_class_type()), NULL);
+  return render_state;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: EggLoader::prepare_polysets_thread_main
+//       Access: Private, Static
+//  Description: The body of each thread started by
+//               prepare_polysets().  Takes bins from the shared job
+//               one at a time until they are all done.
+////////////////////////////////////////////////////////////////////
+void EggLoader::
+prepare_polysets_thread_main(void *user_data) {
+  PreparePolysetsJob *job = (PreparePolysetsJob *)user_data;
+
+  while (true) {
+    EggBin *egg_bin;
+    {
+      MutexHolder holder(job->_lock);
+      if (job->_next_bin >= job->_bins.size()) {
+        return;
+      }
+      egg_bin = job->_bins[job->_next_bin];
+      ++job->_next_bin;
+    }
+
+    job->_loader->prepare_polyset(egg_bin, get_polyset_render_state(egg_bin));
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: EggLoader::separate_switches
 //       Access: Private
@@ -38,6 +38,7 @@
 #include "geomVertexData.h"
 #include "geomPrimitive.h"
 #include "bamCacheRecord.h"
+#include "pmutex.h"
 
 class EggNode;
 class EggBin;
@@ -126,6 +127,12 @@ private:
   Texture::WrapMode convert_wrap_mode(EggTexture::WrapMode wrap_mode) const;
   PT(TextureStage) make_texture_stage(const EggTexture *egg_tex);
 
+  void prepare_polysets();
+  void collect_polysets(EggNode *egg_node, pvector<EggBin *> &bins);
+  void prepare_polyset(EggBin *egg_bin, const EggRenderState *render_state);
+  static const EggRenderState *get_polyset_render_state(EggBin *egg_bin);
+  static void prepare_polysets_thread_main(void *user_data);
+
   void separate_switches(EggNode *egg_node);
   void emulate_bface(EggNode *egg_node);
 
@@ -256,6 +263,21 @@ private:
 
   DeferredNodes _deferred_nodes;
 
+  // This records the vertex pools of each polyset that has already
+  // been meshed by prepare_polysets(), so that make_polyset() doesn't
+  // need to do it again.
+  typedef pmap<EggBin *, EggVertexPools> PreparedPolysets;
+  PreparedPolysets _prepared_polysets;
+
+  // This is shared by the threads that are running prepare_polysets().
+  class PreparePolysetsJob {
+  public:
+    EggLoader *_loader;
+    pvector<EggBin *> _bins;
+    size_t _next_bin;
+    Mutex _lock;
+  };
+
 public:
   PT(PandaNode) _root;
   PT(EggData) _data;
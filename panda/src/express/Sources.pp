@@ -14,9 +14,11 @@
     checksumHashGenerator.I checksumHashGenerator.h circBuffer.I \
     circBuffer.h \
     compress_string.h \
+    compressionCodec.h \
     config_express.h \
     copy_stream.h \
-    datagram.I datagram.h datagramGenerator.I \
+    datagram.I datagram.h datagramBufferPool.I datagramBufferPool.h \
+    datagramGenerator.I \
     datagramGenerator.h \
     datagramIterator.I datagramIterator.h datagramSink.I datagramSink.h \
     dcast.T dcast.h \
@@ -27,7 +29,9 @@
     hashGeneratorBase.I hashGeneratorBase.h \
     hashVal.I hashVal.h \
     indirectLess.I indirectLess.h \
+    lzCompressor.h \
     memoryInfo.I memoryInfo.h \
+    memoryStream.I memoryStream.h memoryStreamBuf.h \
     memoryUsage.I memoryUsage.h \
     memoryUsagePointerCounts.I memoryUsagePointerCounts.h \
     memoryUsagePointers.I memoryUsagePointers.h \
@@ -56,6 +60,7 @@
     referenceCount.I referenceCount.h \
     subStream.I subStream.h subStreamBuf.h \
     subfileInfo.h subfileInfo.I \
+    streamCodec.h streamCodecLZ.h streamCodecZlib.h \
     streamReader_ext.h \
     temporaryFile.h temporaryFile.I \
     threadSafePointerTo.I threadSafePointerTo.h \
@@ -70,6 +75,7 @@
     virtualFileMountMultifile.I \
     virtualFileMountRamdisk.h virtualFileMountRamdisk.I \
     virtualFileMountSystem.h virtualFileMountSystem.I \
+    virtualFileReadCache.h virtualFileReadCache.I \
     virtualFileSimple.h virtualFileSimple.I \
     virtualFileSystem.h virtualFileSystem.I \
     virtualFileSystem_ext.h \
@@ -79,21 +85,25 @@
     weakPointerToVoid.I weakPointerToVoid.h \
     weakReferenceList.I weakReferenceList.h \
     windowsRegistry.h \
+    workerThreadGroup.h workerThreadGroup.I \
     zStream.I zStream.h zStreamBuf.h
 
   #define INCLUDED_SOURCES  \
     buffer.cxx checksumHashGenerator.cxx \
     compress_string.cxx \
+    compressionCodec.cxx \
     config_express.cxx \
     copy_stream.cxx \
-    datagram.cxx datagramGenerator.cxx \
+    datagram.cxx datagramBufferPool.cxx datagramGenerator.cxx \
     datagramIterator.cxx \
     datagramSink.cxx dcast.cxx \
     encrypt_string.cxx \
     error_utils.cxx \
     fileReference.cxx \
     hashGeneratorBase.cxx hashVal.cxx \
-    memoryInfo.cxx memoryUsage.cxx memoryUsagePointerCounts.cxx \
+    lzCompressor.cxx \
+    memoryInfo.cxx memoryStream.cxx memoryStreamBuf.cxx \
+    memoryUsage.cxx memoryUsagePointerCounts.cxx \
     memoryUsagePointers_ext.cxx \
     memoryUsagePointers.cxx multifile.cxx \
     namable.cxx \
@@ -115,6 +125,7 @@
     ramfile_ext.cxx \
     ramfile.cxx \
     referenceCount.cxx \
+    streamCodec.cxx streamCodecLZ.cxx streamCodecZlib.cxx \
     streamReader_ext.cxx \
     subStream.cxx subStreamBuf.cxx \
     subfileInfo.cxx \
@@ -129,6 +140,7 @@
     virtualFileMountMultifile.cxx \
     virtualFileMountRamdisk.cxx \
     virtualFileMountSystem.cxx \
+    virtualFileReadCache.cxx \
     virtualFileSimple.cxx virtualFileSystem.cxx \
     virtualFileSystem_ext.cxx \
     weakPointerCallback.cxx \
@@ -137,6 +149,7 @@
     weakPointerToVoid.cxx \
     weakReferenceList.cxx \
     windowsRegistry.cxx \
+    workerThreadGroup.cxx \
     zStream.cxx zStreamBuf.cxx
 
   #define INSTALL_HEADERS  \
@@ -145,9 +158,11 @@
     checksumHashGenerator.I checksumHashGenerator.h circBuffer.I \
     circBuffer.h \
     compress_string.h \
+    compressionCodec.h \
     config_express.h \
     copy_stream.h \
-    datagram.I datagram.h datagramGenerator.I \
+    datagram.I datagram.h datagramBufferPool.I datagramBufferPool.h \
+    datagramGenerator.I \
     datagramGenerator.h \
     datagramIterator.I datagramIterator.h datagramSink.I datagramSink.h \
     dcast.T dcast.h \
@@ -157,7 +172,9 @@
     hashGeneratorBase.I hashGeneratorBase.h \
     hashVal.I hashVal.h \
     indirectLess.I indirectLess.h \
+    lzCompressor.h \
     memoryInfo.I memoryInfo.h \
+    memoryStream.I memoryStream.h memoryStreamBuf.h \
     memoryUsage.I memoryUsage.h \
     memoryUsagePointerCounts.I memoryUsagePointerCounts.h \
     memoryUsagePointers.I memoryUsagePointers.h \
@@ -185,6 +202,7 @@
     referenceCount.I referenceCount.h \
     subStream.I subStream.h subStreamBuf.h \
     subfileInfo.h subfileInfo.I \
+    streamCodec.h streamCodecLZ.h streamCodecZlib.h \
     temporaryFile.h temporaryFile.I \
     threadSafePointerTo.I threadSafePointerTo.h \
     threadSafePointerToBase.I threadSafePointerToBase.h \
@@ -198,6 +216,7 @@
     virtualFileMountMultifile.I \
     virtualFileMountRamdisk.h virtualFileMountRamdisk.I \
     virtualFileMountSystem.h virtualFileMountSystem.I \
+    virtualFileReadCache.h virtualFileReadCache.I \
     virtualFileSimple.h virtualFileSimple.I \
     virtualFileSystem.h virtualFileSystem.I \
     weakPointerCallback.I weakPointerCallback.h \
@@ -206,6 +225,7 @@
     weakPointerToVoid.I weakPointerToVoid.h \
     weakReferenceList.I weakReferenceList.h \
     windowsRegistry.h \
+    workerThreadGroup.h workerThreadGroup.I \
     zStream.I zStream.h zStreamBuf.h
 
   #define IGATESCAN all
@@ -271,3 +291,67 @@
 
 #end test_bin_target
 #endif
+
+
+#begin test_bin_target
+  #define TARGET test_multifile_flush
+  #define LOCAL_LIBS $[LOCAL_LIBS] p3express
+  #define OTHER_LIBS p3dtoolutil:c p3dtool:m p3prc:c p3dtoolconfig:m p3pystub
+
+  #define SOURCES \
+    test_multifile_flush.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define TARGET test_compression_codecs
+  #define LOCAL_LIBS $[LOCAL_LIBS] p3express
+  #define OTHER_LIBS p3dtoolutil:c p3dtool:m p3prc:c p3dtoolconfig:m p3pystub
+
+  #define SOURCES \
+    test_compression_codecs.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define TARGET test_multifile_lookup
+  #define LOCAL_LIBS $[LOCAL_LIBS] p3express
+  #define OTHER_LIBS p3dtoolutil:c p3dtool:m p3prc:c p3dtoolconfig:m p3pystub
+
+  #define SOURCES \
+    test_multifile_lookup.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define TARGET test_vfs_prefetch
+  #define LOCAL_LIBS $[LOCAL_LIBS] p3express
+  #define OTHER_LIBS p3dtoolutil:c p3dtool:m p3prc:c p3dtoolconfig:m p3pystub
+
+  #define SOURCES \
+    test_vfs_prefetch.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define TARGET test_multifile_dedup
+  #define LOCAL_LIBS $[LOCAL_LIBS] p3express
+  #define OTHER_LIBS p3dtoolutil:c p3dtool:m p3prc:c p3dtoolconfig:m p3pystub
+
+  #define SOURCES \
+    test_multifile_dedup.cxx
+
+#end test_bin_target
+
+#if $[HAVE_OPENSSL]
+#begin test_bin_target
+  #define TARGET test_patchfile_build
+  #define USE_PACKAGES openssl
+  #define LOCAL_LIBS $[LOCAL_LIBS] p3express
+  #define OTHER_LIBS p3dtoolutil:c p3dtool:m p3prc:c p3dtoolconfig:m p3pystub
+
+  #define SOURCES \
+    test_patchfile_build.cxx
+
+#end test_bin_target
+#endif
@@ -23,16 +23,19 @@
 //     Function: compress_string
 //       Access: Published
 //  Description: Compress the indicated source string at the given
-//               compression level (1 through 9).  Returns the
-//               compressed string.
+//               compression level (1 through 9), with the indicated
+//               codec.  Returns the compressed string.
+//
+//               decompress_string() recognizes the codec by itself.
 ////////////////////////////////////////////////////////////////////
 string
-compress_string(const string &source, int compression_level) {
+compress_string(const string &source, int compression_level,
+                CompressionCodec codec) {
   ostringstream dest;
 
   {
     OCompressStream compress;
-    compress.open(&dest, false, compression_level);
+    compress.open(&dest, false, compression_level, codec);
     compress.write(source.data(), source.length());
 
     if (compress.fail()) {
@@ -76,7 +79,8 @@ decompress_string(const string &source) {
 //               failure.
 ////////////////////////////////////////////////////////////////////
 EXPCL_PANDAEXPRESS bool 
-compress_file(const Filename &source, const Filename &dest, int compression_level) {
+compress_file(const Filename &source, const Filename &dest, int compression_level,
+              CompressionCodec codec) {
   VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
   Filename source_filename = source;
   if (!source_filename.is_binary_or_text()) {
@@ -97,7 +101,8 @@ compress_file(const Filename &source, const Filename &dest, int compression_leve
     return false;
   }
     
-  bool result = compress_stream(*source_stream, *dest_stream, compression_level);
+  bool result = compress_stream(*source_stream, *dest_stream, compression_level,
+                                codec);
   vfs->close_read_file(source_stream);
   vfs->close_write_file(dest_stream);
   return result;
@@ -155,9 +160,10 @@ decompress_file(const Filename &source, const Filename &dest) {
 //               success, or false on failure.
 ////////////////////////////////////////////////////////////////////
 bool
-compress_stream(istream &source, ostream &dest, int compression_level) {
+compress_stream(istream &source, ostream &dest, int compression_level,
+                CompressionCodec codec) {
   OCompressStream compress;
-  compress.open(&dest, false, compression_level);
+  compress.open(&dest, false, compression_level, codec);
     
   static const size_t buffer_size = 4096;
   char buffer[buffer_size];
@@ -20,22 +20,26 @@
 #ifdef HAVE_ZLIB
 
 #include "filename.h"
+#include "compressionCodec.h"
 
 BEGIN_PUBLISH
 
 EXPCL_PANDAEXPRESS string
-compress_string(const string &source, int compression_level);
+compress_string(const string &source, int compression_level,
+                CompressionCodec codec = CC_zlib);
 
 EXPCL_PANDAEXPRESS string
 decompress_string(const string &source);
 
 EXPCL_PANDAEXPRESS bool
-compress_file(const Filename &source, const Filename &dest, int compression_level);
+compress_file(const Filename &source, const Filename &dest, int compression_level,
+              CompressionCodec codec = CC_zlib);
 EXPCL_PANDAEXPRESS bool
 decompress_file(const Filename &source, const Filename &dest);
 
 EXPCL_PANDAEXPRESS bool
-compress_stream(istream &source, ostream &dest, int compression_level);
+compress_stream(istream &source, ostream &dest, int compression_level,
+                CompressionCodec codec = CC_zlib);
 EXPCL_PANDAEXPRESS bool
 decompress_stream(istream &source, ostream &dest);
 
@@ -0,0 +1,86 @@
+// Filename: compressionCodec.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "compressionCodec.h"
+#include "config_express.h"
+#include "configDeclaration.h"
+
+////////////////////////////////////////////////////////////////////
+//     Function: parse_compression_codec_string
+//  Description: Returns the CompressionCodec corresponding to the
+//               indicated name, or CC_invalid if the name is not
+//               recognized.
+////////////////////////////////////////////////////////////////////
+CompressionCodec
+parse_compression_codec_string(const string &str) {
+  string name = ConfigDeclaration::downcase(str);
+  if (name == "zlib") {
+    return CC_zlib;
+  } else if (name == "lz") {
+    return CC_lz;
+  }
+
+  return CC_invalid;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: format_compression_codec
+//  Description: Returns the name of the indicated CompressionCodec,
+//               as understood by parse_compression_codec_string().
+////////////////////////////////////////////////////////////////////
+string
+format_compression_codec(CompressionCodec codec) {
+  ostringstream strm;
+  strm << codec;
+  return strm.str();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CompressionCodec output operator
+//  Description:
+////////////////////////////////////////////////////////////////////
+ostream &
+operator << (ostream &out, CompressionCodec codec) {
+  switch (codec) {
+  case CC_zlib:
+    return out << "zlib";
+
+  case CC_lz:
+    return out << "lz";
+
+  case CC_invalid:
+    return out << "invalid";
+  }
+
+  express_cat->error()
+    << "Invalid compression codec: " << (int)codec << "\n";
+  nassertr(false, out);
+  return out;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: CompressionCodec input operator
+//  Description:
+////////////////////////////////////////////////////////////////////
+istream &
+operator >> (istream &in, CompressionCodec &codec) {
+  string word;
+  in >> word;
+  codec = parse_compression_codec_string(word);
+  if (codec == CC_invalid) {
+    express_cat->error()
+      << "Invalid compression codec string: " << word << "\n";
+  }
+  return in;
+}
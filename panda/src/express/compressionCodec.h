@@ -0,0 +1,48 @@
+// Filename: compressionCodec.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef COMPRESSIONCODEC_H
+#define COMPRESSIONCODEC_H
+
+#include "pandabase.h"
+
+BEGIN_PUBLISH
+
+enum CompressionCodec {
+  // The standard zlib deflate format.  This compresses well, and is
+  // understood by every version of Panda and by most other tools.
+  CC_zlib,
+
+  // A series of blocks compressed by LZCompressor, in the LZ4 block
+  // format, wrapped in Panda's own stream framing; see
+  // StreamCodecLZ.  This doesn't compress quite as well as zlib, but
+  // it decompresses several times faster.  Streams in this format
+  // can only be read by a version of Panda that knows about it.
+  CC_lz,
+
+  // CC_invalid is not a codec at all.  It is returned by
+  // parse_compression_codec_string() for a string it doesn't
+  // recognize.
+  CC_invalid,
+};
+
+EXPCL_PANDAEXPRESS CompressionCodec parse_compression_codec_string(const string &str);
+EXPCL_PANDAEXPRESS string format_compression_codec(CompressionCodec codec);
+
+END_PUBLISH
+
+EXPCL_PANDAEXPRESS ostream &operator << (ostream &out, CompressionCodec codec);
+EXPCL_PANDAEXPRESS istream &operator >> (istream &in, CompressionCodec &codec);
+
+#endif
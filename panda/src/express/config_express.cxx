@@ -57,6 +57,27 @@ ConfigVariableInt patchfile_buffer_size
 ConfigVariableInt patchfile_zone_size
 ("patchfile-zone-size", 10000);
 
+ConfigVariableBool patchfile_rolling_hash
+("patchfile-rolling-hash", false,
+ PRC_DESC("Set this true to make Patchfile::build() use the rolling-hash "
+          "algorithm by default, which is much faster and uses much less "
+          "memory on large files than the traditional footprint "
+          "algorithm, but may produce slightly larger patches.  Patches "
+          "built either way are applied the same way."));
+
+ConfigVariableInt patchfile_block_length
+("patchfile-block-length", 32,
+ PRC_DESC("The size of the blocks into which the original file is "
+          "divided by the rolling-hash patch algorithm.  See "
+          "Patchfile::set_block_length()."));
+
+ConfigVariableInt patchfile_build_threads
+("patchfile-build-threads", 0,
+ PRC_DESC("Specifies the default number of threads Patchfile::build() "
+          "will use to search for matches with the rolling-hash "
+          "algorithm.  The patch does not depend on this setting.  Set "
+          "this to 0 or 1 to do all of the work in the calling thread."));
+
 ConfigVariableBool keep_temporary_files
 ("keep-temporary-files", false,
  PRC_DESC("Set this true to keep around the temporary files from "
@@ -73,6 +94,32 @@ ConfigVariableBool multifile_always_binary
           "or extracted in either binary or text mode, according to the "
           "set_binary() or set_text() flag on the Filename."));
 
+ConfigVariableInt multifile_compression_threads
+("multifile-compression-threads", 0,
+ PRC_DESC("Specifies the default number of threads a Multifile will use "
+          "to compress and encrypt its new subfiles when it is flushed or "
+          "repacked.  The subfiles are still written in the same order, so "
+          "the result does not depend on this setting.  This requires a "
+          "Panda built with true threading support.  Set this to 0 or 1 to "
+          "do all of the work on the calling thread."));
+
+ConfigVariableBool multifile_mmap
+("multifile-mmap", true,
+ PRC_DESC("Set this true to map a Multifile that is opened for reading "
+          "from disk into memory, so that its uncompressed, unencrypted "
+          "subfiles may be read directly from memory by any number of "
+          "threads at once, rather than taking turns on the single file "
+          "stream.  Set it false if the Multifile may be modified on disk "
+          "by another process while it is open."));
+
+ConfigVariableBool multifile_deduplicate
+("multifile-deduplicate", false,
+ PRC_DESC("Set this true to make a Multifile store the data of a new "
+          "subfile only once if its contents are identical to another "
+          "subfile's.  The index entries of both subfiles then refer to "
+          "the same data, which older versions of Panda can still read.  "
+          "This is the default for Multifile::set_deduplicate()."));
+
 ConfigVariableBool collect_tcp
 ("collect-tcp", false,
  PRC_DESC("Set this true to enable accumulation of several small consecutive "
@@ -190,6 +237,22 @@ get_verify_dcast() {
   return *verify_dcast;
 }
 
+int
+get_datagram_buffer_pool_bytes() {
+  static ConfigVariableInt *datagram_buffer_pool_bytes = NULL;
+
+  if (datagram_buffer_pool_bytes == (ConfigVariableInt *)NULL) {
+    datagram_buffer_pool_bytes = new ConfigVariableInt
+      ("datagram-buffer-pool-bytes", 1048576,
+       PRC_DESC("The number of bytes of unused Datagram arrays that are kept "
+                "in each size class of the DatagramBufferPool, to be reused "
+                "by the next Datagrams built or received.  Set this to 0 to "
+                "allocate a new array for every Datagram."));
+  }
+
+  return *datagram_buffer_pool_bytes;
+}
+
 // Returns the configure object for accessing config variables from a
 // scripting language.
 DConfig &
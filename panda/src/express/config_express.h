@@ -47,14 +47,21 @@ EXPCL_PANDAEXPRESS bool get_use_high_res_clock();
 EXPCL_PANDAEXPRESS bool get_paranoid_clock();
 EXPCL_PANDAEXPRESS bool get_paranoid_inheritance();
 EXPCL_PANDAEXPRESS bool get_verify_dcast();
+EXPCL_PANDAEXPRESS int get_datagram_buffer_pool_bytes();
 
 extern ConfigVariableInt patchfile_window_size;
 extern ConfigVariableInt patchfile_increment_size;
 extern ConfigVariableInt patchfile_buffer_size;
 extern ConfigVariableInt patchfile_zone_size;
+extern ConfigVariableBool patchfile_rolling_hash;
+extern ConfigVariableInt patchfile_block_length;
+extern ConfigVariableInt patchfile_build_threads;
 
 extern ConfigVariableBool keep_temporary_files;
 extern ConfigVariableBool multifile_always_binary;
+extern ConfigVariableInt multifile_compression_threads;
+extern ConfigVariableBool multifile_mmap;
+extern ConfigVariableBool multifile_deduplicate;
 
 extern EXPCL_PANDAEXPRESS ConfigVariableBool collect_tcp;
 extern EXPCL_PANDAEXPRESS ConfigVariableDouble collect_tcp_interval;
@@ -29,6 +29,7 @@ TypeHandle Datagram::_type_handle;
 ////////////////////////////////////////////////////////////////////
 Datagram::
 ~Datagram() {
+  DatagramBufferPool::release_buffer(_data);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -39,7 +40,7 @@ Datagram::
 ////////////////////////////////////////////////////////////////////
 void Datagram::
 clear() {
-  _data.clear();
+  DatagramBufferPool::release_buffer(_data);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -111,16 +112,7 @@ void Datagram::
 pad_bytes(size_t size) {
   nassertv((int)size >= 0);
 
-  if (_data == (uchar *)NULL) {
-    // Create a new array.
-    _data = PTA_uchar::empty_array(0);
-
-  } else if (_data.get_ref_count() != 1) {
-    // Copy on write.
-    PTA_uchar new_data = PTA_uchar::empty_array(0);
-    new_data.v() = _data.v();
-    _data = new_data;
-  }
+  make_unique(size);
 
   // Now append the data.
 
@@ -144,16 +136,7 @@ void Datagram::
 append_data(const void *data, size_t size) {
   nassertv((int)size >= 0);
 
-  if (_data == (uchar *)NULL) {
-    // Create a new array.
-    _data = PTA_uchar::empty_array(0);
-
-  } else if (_data.get_ref_count() != 1) {
-    // Copy on write.
-    PTA_uchar new_data = PTA_uchar::empty_array(0);
-    new_data.v() = _data.v();
-    _data = new_data;
-  }
+  make_unique(size);
 
   // Now append the data.
 
@@ -178,11 +161,34 @@ void Datagram::
 assign(const void *data, size_t size) {
   nassertv((int)size >= 0);
   
-  _data = PTA_uchar::empty_array(0);
+  DatagramBufferPool::release_buffer(_data);
+  _data = DatagramBufferPool::get_buffer(size);
   _data.v().insert(_data.v().end(), (const unsigned char *)data,
                    (const unsigned char *)data + size);
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: Datagram::make_unique
+//       Access: Private
+//  Description: Ensures that _data is an array of our own, not shared
+//               with any other Datagram or PTA, in preparation for
+//               appending extra_size more bytes to it.  A new array is
+//               taken from the DatagramBufferPool if necessary.
+////////////////////////////////////////////////////////////////////
+void Datagram::
+make_unique(size_t extra_size) {
+  if (_data == (uchar *)NULL) {
+    // Create a new array.
+    _data = DatagramBufferPool::get_buffer(extra_size);
+
+  } else if (_data.get_ref_count() != 1) {
+    // Copy on write.
+    PTA_uchar new_data = DatagramBufferPool::get_buffer(_data.size() + extra_size);
+    new_data.v().insert(new_data.v().end(), _data.begin(), _data.end());
+    _data = new_data;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function : Datagram::output
 //       Access : Public
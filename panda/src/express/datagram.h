@@ -22,6 +22,7 @@
 #include "littleEndian.h"
 #include "bigEndian.h"
 #include "pta_uchar.h"
+#include "datagramBufferPool.h"
 
 ////////////////////////////////////////////////////////////////////
 //       Class : Datagram
@@ -47,6 +48,7 @@ PUBLISHED:
   INLINE Datagram(const string &data);
   INLINE Datagram(const Datagram &copy);
   INLINE void operator = (const Datagram &copy);
+  INLINE void swap(Datagram &other);
 
   virtual ~Datagram();
 
@@ -110,6 +112,8 @@ PUBLISHED:
   void write(ostream &out, unsigned int indent=0) const;
 
 private:
+  void make_unique(size_t extra_size);
+
   PTA_uchar _data;
   bool _stdfloat_double;
 
@@ -0,0 +1,187 @@
+// Filename: datagramBufferPool.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "datagramBufferPool.h"
+#include "config_express.h"
+
+const size_t DatagramBufferPool::_class_sizes[DatagramBufferPool::num_size_classes] = {
+  64, 256, 1024, 4096, 16384, 65536
+};
+
+AtomicAdjust::Integer DatagramBufferPool::_num_allocated = 0;
+AtomicAdjust::Integer DatagramBufferPool::_num_reused = 0;
+AtomicAdjust::Integer DatagramBufferPool::_num_released = 0;
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramBufferPool::get_buffer
+//       Access: Public, Static
+//  Description: Returns an empty array with room for at least size
+//               bytes, taken from the pool if possible.
+////////////////////////////////////////////////////////////////////
+PTA_uchar DatagramBufferPool::
+get_buffer(size_t size) {
+  if (get_datagram_buffer_pool_bytes() <= 0) {
+    AtomicAdjust::inc(_num_allocated);
+    return PTA_uchar::empty_array(0);
+  }
+
+  int ci = get_size_class(size);
+  if (ci >= 0) {
+    SizeClass &sc = get_size_classes()[ci];
+    PTA_uchar data;
+    sc._lock.acquire();
+    if (!sc._buffers.empty()) {
+      data = sc._buffers.back();
+      sc._buffers.pop_back();
+    }
+    sc._lock.release();
+
+    if (!data.is_null()) {
+      AtomicAdjust::inc(_num_reused);
+      return data;
+    }
+  }
+
+  // We reserve the whole size class up front, so that the array can
+  // go back into the same class when it is released.
+  AtomicAdjust::inc(_num_allocated);
+  PTA_uchar data = PTA_uchar::empty_array(0);
+  data.v().reserve(ci >= 0 ? _class_sizes[ci] : size);
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramBufferPool::release_buffer
+//       Access: Public, Static
+//  Description: Clears the indicated PTA.  If it held the last
+//               reference to its array, the array is kept in the pool
+//               for the next call to get_buffer(), if there is room.
+////////////////////////////////////////////////////////////////////
+void DatagramBufferPool::
+release_buffer(PTA_uchar &data) {
+  if (data.get_ref_count() == 1 && get_datagram_buffer_pool_bytes() > 0) {
+    // File the array under the largest class it can hold.  Arrays
+    // much bigger than the largest class are not worth keeping.
+    size_t capacity = data.v().capacity();
+    int ci = num_size_classes - 1;
+    while (ci >= 0 && _class_sizes[ci] > capacity) {
+      --ci;
+    }
+    if (ci >= 0 && capacity <= _class_sizes[num_size_classes - 1] * 2) {
+      SizeClass &sc = get_size_classes()[ci];
+      sc._lock.acquire();
+      if ((sc._buffers.size() + 1) * _class_sizes[ci] <=
+          (size_t)get_datagram_buffer_pool_bytes()) {
+        data.v().clear();
+        sc._buffers.push_back(data);
+        AtomicAdjust::inc(_num_released);
+      }
+      sc._lock.release();
+    }
+  }
+
+  data.clear();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramBufferPool::clear_pool
+//       Access: Published, Static
+//  Description: Frees all of the arrays held in the pool.
+////////////////////////////////////////////////////////////////////
+void DatagramBufferPool::
+clear_pool() {
+  SizeClass *classes = get_size_classes();
+  for (int ci = 0; ci < num_size_classes; ++ci) {
+    pvector<PTA_uchar> buffers;
+    classes[ci]._lock.acquire();
+    buffers.swap(classes[ci]._buffers);
+    classes[ci]._lock.release();
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramBufferPool::reset_counts
+//       Access: Published, Static
+//  Description: Resets the counts returned by get_num_allocated() and
+//               its kin to zero.
+////////////////////////////////////////////////////////////////////
+void DatagramBufferPool::
+reset_counts() {
+  AtomicAdjust::set(_num_allocated, 0);
+  AtomicAdjust::set(_num_reused, 0);
+  AtomicAdjust::set(_num_released, 0);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramBufferPool::write
+//       Access: Published, Static
+//  Description: Writes the number of arrays held in each size class,
+//               and the counts of arrays allocated and reused.
+////////////////////////////////////////////////////////////////////
+void DatagramBufferPool::
+write(ostream &out) {
+  SizeClass *classes = get_size_classes();
+  for (int ci = 0; ci < num_size_classes; ++ci) {
+    classes[ci]._lock.acquire();
+    size_t num_buffers = classes[ci]._buffers.size();
+    classes[ci]._lock.release();
+
+    out << _class_sizes[ci] << " bytes: " << num_buffers << " arrays\n";
+  }
+  out << get_num_allocated() << " allocated, "
+      << get_num_reused() << " reused, "
+      << get_num_released() << " released\n";
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramBufferPool::get_size_class
+//       Access: Private, Static
+//  Description: Returns the index of the smallest size class that
+//               holds at least size bytes, or -1 if size is bigger
+//               than all of them.
+////////////////////////////////////////////////////////////////////
+int DatagramBufferPool::
+get_size_class(size_t size) {
+  for (int ci = 0; ci < num_size_classes; ++ci) {
+    if (size <= _class_sizes[ci]) {
+      return ci;
+    }
+  }
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramBufferPool::get_size_classes
+//       Access: Private, Static
+//  Description: Returns the array of size classes, creating it the
+//               first time it is needed.  Datagrams may be created
+//               during static init, so we can't rely on a static
+//               array having been constructed.
+////////////////////////////////////////////////////////////////////
+DatagramBufferPool::SizeClass *DatagramBufferPool::
+get_size_classes() {
+  static AtomicAdjust::Pointer classes = NULL;
+  SizeClass *result = (SizeClass *)AtomicAdjust::get_ptr(classes);
+  if (result == (SizeClass *)NULL) {
+    SizeClass *new_classes = new SizeClass[num_size_classes];
+    result = (SizeClass *)AtomicAdjust::compare_and_exchange_ptr(classes, (void *)NULL, (void *)new_classes);
+    if (result == (SizeClass *)NULL) {
+      result = new_classes;
+    } else {
+      // Another thread got there first.
+      delete[] new_classes;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,76 @@
+// Filename: datagramBufferPool.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef DATAGRAMBUFFERPOOL_H
+#define DATAGRAMBUFFERPOOL_H
+
+#include "pandabase.h"
+
+#include "pta_uchar.h"
+#include "pvector.h"
+#include "mutexImpl.h"
+#include "atomicAdjust.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : DatagramBufferPool
+// Description : Keeps the arrays of Datagrams that are no longer in
+//               use, sorted into a handful of size classes, so that
+//               the next Datagram of about the same size may take
+//               one over instead of allocating its own.  A program
+//               that sends or receives a steady stream of messages
+//               thus allocates no memory for them once the pool has
+//               filled up.
+//
+//               An array is returned to the pool only when the
+//               Datagram that releases it holds the last reference
+//               to it; arrays shared with other Datagrams or PTA's
+//               are left alone.  The amount of memory held by each
+//               size class is limited by datagram-buffer-pool-bytes.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS DatagramBufferPool {
+public:
+  static PTA_uchar get_buffer(size_t size);
+  static void release_buffer(PTA_uchar &data);
+
+PUBLISHED:
+  static void clear_pool();
+
+  INLINE static int get_num_allocated();
+  INLINE static int get_num_reused();
+  INLINE static int get_num_released();
+  static void reset_counts();
+
+  static void write(ostream &out);
+
+private:
+  static int get_size_class(size_t size);
+
+  enum { num_size_classes = 6 };
+  static const size_t _class_sizes[num_size_classes];
+
+  class SizeClass {
+  public:
+    MutexImpl _lock;
+    pvector<PTA_uchar> _buffers;
+  };
+  static SizeClass *get_size_classes();
+
+  static AtomicAdjust::Integer _num_allocated;
+  static AtomicAdjust::Integer _num_reused;
+  static AtomicAdjust::Integer _num_released;
+};
+
+#include "datagramBufferPool.I"
+
+#endif
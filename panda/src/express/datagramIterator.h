@@ -80,6 +80,9 @@ PUBLISHED:
   void output(ostream &out) const;
   void write(ostream &out, unsigned int indent=0) const;
 
+public:
+  INLINE const void *get_remaining_data() const;
+
 private:
   const Datagram *_datagram;
   size_t _current_index;
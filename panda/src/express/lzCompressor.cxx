@@ -0,0 +1,263 @@
+// Filename: lzCompressor.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "lzCompressor.h"
+#include "pnotify.h"
+
+#include <string.h>
+
+// The last few bytes of a block are always written as literals, so
+// that the decompressor may copy matches a word at a time without
+// checking for the end of the block.
+static const size_t last_literals = 5;
+static const size_t match_limit = 12;
+
+////////////////////////////////////////////////////////////////////
+//     Function: read_uint32
+//  Description: Reads four bytes of possibly-unaligned data, for
+//               comparing and hashing.
+////////////////////////////////////////////////////////////////////
+static INLINE PN_uint32
+read_uint32(const unsigned char *p) {
+  PN_uint32 value;
+  memcpy(&value, p, 4);
+  return value;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: hash_uint32
+//  Description: Maps four bytes onto a slot in the hash table.
+////////////////////////////////////////////////////////////////////
+static INLINE PN_uint32
+hash_uint32(PN_uint32 value, int bits) {
+  return (value * 2654435761U) >> (32 - bits);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: write_length
+//  Description: Writes the extra bytes of a literal or match length
+//               that didn't fit in its four bits of the token.
+////////////////////////////////////////////////////////////////////
+static INLINE unsigned char *
+write_length(unsigned char *op, size_t length) {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = (unsigned char)length;
+  return op;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: LZCompressor::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+LZCompressor::
+LZCompressor() {
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: LZCompressor::get_max_compressed_size
+//       Access: Public, Static
+//  Description: Returns the largest number of bytes that compress()
+//               might produce for a block of the indicated length.
+//               This happens when the data can't be compressed at
+//               all.
+////////////////////////////////////////////////////////////////////
+size_t LZCompressor::
+get_max_compressed_size(size_t source_length) {
+  return source_length + source_length / 255 + 16;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: LZCompressor::compress
+//       Access: Public
+//  Description: Compresses the indicated block of data, which may be
+//               no longer than max_block_size, into dest, which must
+//               have room for get_max_compressed_size() bytes.
+//               Returns the number of bytes written to dest.
+////////////////////////////////////////////////////////////////////
+size_t LZCompressor::
+compress(const unsigned char *source, size_t source_length,
+         unsigned char *dest) {
+  nassertr(source_length <= max_block_size, 0);
+
+  const unsigned char *ip = source;
+  const unsigned char *anchor = source;
+  const unsigned char *iend = source + source_length;
+  unsigned char *op = dest;
+
+  if (source_length > match_limit) {
+    const unsigned char *mflimit = iend - match_limit;
+    const unsigned char *matchlimit = iend - last_literals;
+    memset(_table, 0, sizeof(_table));
+
+    // Table entries are stored as offsets plus one, so that zero
+    // means empty.
+    while (ip < mflimit) {
+      PN_uint32 sequence = read_uint32(ip);
+      PN_uint32 h = hash_uint32(sequence, hash_bits);
+      PN_uint32 entry = _table[h];
+      _table[h] = (PN_uint32)(ip - source) + 1;
+
+      if (entry == 0 || read_uint32(source + entry - 1) != sequence) {
+        // No match here.  Skip ahead faster and faster the longer
+        // we go without finding one, so that incompressible data
+        // doesn't slow us down much.
+        ip += 1 + ((ip - anchor) >> 6);
+        continue;
+      }
+
+      // Extend the match backwards over the pending literals.
+      const unsigned char *ref = source + entry - 1;
+      while (ip > anchor && ref > source && ip[-1] == ref[-1]) {
+        --ip;
+        --ref;
+      }
+
+      // And forwards as far as it goes.
+      const unsigned char *mp = ip + min_match;
+      const unsigned char *rp = ref + min_match;
+      while (mp < matchlimit && *mp == *rp) {
+        ++mp;
+        ++rp;
+      }
+
+      size_t literal_length = ip - anchor;
+      size_t match_length = (mp - ip) - min_match;
+      unsigned char *token = op++;
+      *token = (unsigned char)((min(literal_length, (size_t)15) << 4) |
+                               min(match_length, (size_t)15));
+      if (literal_length >= 15) {
+        op = write_length(op, literal_length - 15);
+      }
+      memcpy(op, anchor, literal_length);
+      op += literal_length;
+
+      size_t offset = ip - ref;
+      *op++ = (unsigned char)(offset & 0xff);
+      *op++ = (unsigned char)(offset >> 8);
+      if (match_length >= 15) {
+        op = write_length(op, match_length - 15);
+      }
+
+      ip = mp;
+      anchor = ip;
+
+      // Also record the position just before the end of the match,
+      // which often starts the next one.
+      if (ip < mflimit) {
+        _table[hash_uint32(read_uint32(ip - 2), hash_bits)] =
+          (PN_uint32)(ip - 2 - source) + 1;
+      }
+    }
+  }
+
+  // Everything left over is written as literals.
+  size_t literal_length = iend - anchor;
+  *op++ = (unsigned char)(min(literal_length, (size_t)15) << 4);
+  if (literal_length >= 15) {
+    op = write_length(op, literal_length - 15);
+  }
+  memcpy(op, anchor, literal_length);
+  op += literal_length;
+
+  return op - dest;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: LZCompressor::decompress
+//       Access: Public, Static
+//  Description: Decompresses a block that was written by compress()
+//               into dest, which has room for dest_length bytes.
+//               Returns the number of bytes written to dest, or
+//               (size_t)-1 if the block is corrupt or doesn't fit.
+////////////////////////////////////////////////////////////////////
+size_t LZCompressor::
+decompress(const unsigned char *source, size_t source_length,
+           unsigned char *dest, size_t dest_length) {
+  const unsigned char *ip = source;
+  const unsigned char *iend = source + source_length;
+  unsigned char *op = dest;
+  unsigned char *oend = dest + dest_length;
+
+  while (ip < iend) {
+    unsigned int token = *ip++;
+
+    size_t literal_length = token >> 4;
+    if (literal_length == 15) {
+      unsigned int b;
+      do {
+        if (ip >= iend) {
+          return (size_t)-1;
+        }
+        b = *ip++;
+        literal_length += b;
+      } while (b == 255);
+    }
+    if (literal_length > (size_t)(iend - ip) ||
+        literal_length > (size_t)(oend - op)) {
+      return (size_t)-1;
+    }
+    memcpy(op, ip, literal_length);
+    op += literal_length;
+    ip += literal_length;
+
+    if (ip >= iend) {
+      // The last sequence has no match.
+      break;
+    }
+
+    if (iend - ip < 2) {
+      return (size_t)-1;
+    }
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dest)) {
+      return (size_t)-1;
+    }
+
+    size_t match_length = token & 15;
+    if (match_length == 15) {
+      unsigned int b;
+      do {
+        if (ip >= iend) {
+          return (size_t)-1;
+        }
+        b = *ip++;
+        match_length += b;
+      } while (b == 255);
+    }
+    match_length += min_match;
+    if (match_length > (size_t)(oend - op)) {
+      return (size_t)-1;
+    }
+
+    const unsigned char *ref = op - offset;
+    if (offset >= match_length) {
+      memcpy(op, ref, match_length);
+      op += match_length;
+    } else {
+      // The match overlaps the bytes it is producing, so it must be
+      // copied a byte at a time.
+      unsigned char *mend = op + match_length;
+      while (op < mend) {
+        *op++ = *ref++;
+      }
+    }
+  }
+
+  return op - dest;
+}
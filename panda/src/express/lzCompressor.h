@@ -0,0 +1,70 @@
+// Filename: lzCompressor.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef LZCOMPRESSOR_H
+#define LZCOMPRESSOR_H
+
+#include "pandabase.h"
+#include "numeric_types.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : LZCompressor
+// Description : A simple, very fast LZ77 compressor, used to
+//               implement CC_lz.  It compresses independent blocks
+//               of at most max_block_size bytes.
+//
+//               Each compressed block is a series of sequences.  A
+//               sequence begins with a token byte, whose upper four
+//               bits give the number of literal bytes and whose lower
+//               four bits give the length of the match, minus
+//               min_match.  A value of 15 in either field is followed
+//               by extra length bytes, each of which is added to the
+//               length, until one less than 255 is seen.  Then come
+//               the literal bytes, and then the match offset, as a
+//               little-endian 16-bit distance back into the output.
+//               The last sequence in a block has only literals.
+//
+//               This is the LZ4 block format, and the compressor
+//               follows its rules for the end of a block (the last
+//               five bytes are always literals, and no match starts
+//               within the last twelve), so any LZ4 block decoder
+//               can read a compressed block.  The stream framing
+//               around the blocks is StreamCodecLZ's, not the LZ4
+//               frame format.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS LZCompressor {
+public:
+  enum {
+    max_block_size = 0x10000,
+    min_match = 4,
+  };
+
+  LZCompressor();
+
+  static size_t get_max_compressed_size(size_t source_length);
+  size_t compress(const unsigned char *source, size_t source_length,
+                  unsigned char *dest);
+  static size_t decompress(const unsigned char *source, size_t source_length,
+                           unsigned char *dest, size_t dest_length);
+
+private:
+  enum {
+    hash_bits = 14,
+    hash_size = 1 << hash_bits,
+  };
+
+  PN_uint32 _table[hash_size];
+};
+
+#endif
@@ -0,0 +1,47 @@
+// Filename: memoryStream.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef MEMORYSTREAM_H
+#define MEMORYSTREAM_H
+
+#include "pandabase.h"
+#include "memoryStreamBuf.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : IMemoryStream
+// Description : An istream object that reads directly from a block
+//               of memory, such as a memory-mapped file, without
+//               copying it.  The memory is owned by the caller and
+//               must remain valid while the stream is in use.
+//
+//               Unlike an ISubStream, this does not share a file
+//               pointer with any other stream, so any number of
+//               IMemoryStreams may be read from different threads at
+//               the same time.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS IMemoryStream : public istream {
+public:
+  INLINE IMemoryStream();
+  INLINE IMemoryStream(const char *data, size_t size);
+
+  INLINE IMemoryStream &open(const char *data, size_t size);
+  INLINE IMemoryStream &close();
+
+private:
+  MemoryStreamBuf _buf;
+};
+
+#include "memoryStream.I"
+
+#endif
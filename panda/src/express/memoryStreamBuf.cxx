@@ -0,0 +1,155 @@
+// Filename: memoryStreamBuf.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "memoryStreamBuf.h"
+
+#ifndef HAVE_STREAMSIZE
+// Some compilers (notably SGI) don't define this for us
+typedef int streamsize;
+#endif /* HAVE_STREAMSIZE */
+
+////////////////////////////////////////////////////////////////////
+//     Function: MemoryStreamBuf::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+MemoryStreamBuf::
+MemoryStreamBuf() {
+  _data = NULL;
+  _size = 0;
+  setg(NULL, NULL, NULL);
+  setp(NULL, NULL);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MemoryStreamBuf::Destructor
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+MemoryStreamBuf::
+~MemoryStreamBuf() {
+  close();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MemoryStreamBuf::open
+//       Access: Public
+//  Description: Starts reading from the indicated block of memory.
+//               The memory is not copied; it must remain valid for
+//               as long as the stream is in use.
+////////////////////////////////////////////////////////////////////
+void MemoryStreamBuf::
+open(const char *data, size_t size) {
+  // The get area is declared in terms of non-const char, but we
+  // never write through it.
+  _data = (char *)data;
+  _size = size;
+  setg(_data, _data, _data + _size);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MemoryStreamBuf::close
+//       Access: Public
+//  Description: Resets the buffer to empty.  The memory itself is
+//               not freed.
+////////////////////////////////////////////////////////////////////
+void MemoryStreamBuf::
+close() {
+  _data = NULL;
+  _size = 0;
+  setg(NULL, NULL, NULL);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MemoryStreamBuf::seekoff
+//       Access: Public, Virtual
+//  Description: Implements seeking within the stream.
+////////////////////////////////////////////////////////////////////
+streampos MemoryStreamBuf::
+seekoff(streamoff off, ios_seekdir dir, ios_openmode which) {
+  if ((which & ios::in) == 0) {
+    return -1;
+  }
+
+  streamoff pos;
+  switch (dir) {
+  case ios::beg:
+    pos = off;
+    break;
+
+  case ios::cur:
+    pos = (streamoff)(gptr() - eback()) + off;
+    break;
+
+  case ios::end:
+    pos = (streamoff)_size + off;
+    break;
+
+  default:
+    return -1;
+  }
+
+  if (pos < 0 || pos > (streamoff)_size) {
+    return -1;
+  }
+
+  setg(_data, _data + (size_t)pos, _data + _size);
+  return pos;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MemoryStreamBuf::seekpos
+//       Access: Public, Virtual
+//  Description: A variant on seekoff() to implement seeking within a
+//               stream.
+//
+//               The MSDN Library claims that it is only necessary to
+//               redefine seekoff(), and not seekpos() as well, as the
+//               default implementation of seekpos() is supposed to
+//               map to seekoff() exactly as I am doing here; but in
+//               fact it must do something else, because seeking
+//               didn't work on Windows until I redefined this
+//               function as well.
+////////////////////////////////////////////////////////////////////
+streampos MemoryStreamBuf::
+seekpos(streampos pos, ios_openmode which) {
+  return seekoff(pos, ios::beg, which);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MemoryStreamBuf::showmanyc
+//       Access: Protected, Virtual
+//  Description: Returns the number of characters remaining in the
+//               stream.
+////////////////////////////////////////////////////////////////////
+streamsize MemoryStreamBuf::
+showmanyc() {
+  return (streamsize)(egptr() - gptr());
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MemoryStreamBuf::underflow
+//       Access: Protected, Virtual
+//  Description: Called by the system istream implementation when its
+//               internal buffer needs more characters.  Since the
+//               entire block of memory is always available in the
+//               buffer, this only happens at the end of the data.
+////////////////////////////////////////////////////////////////////
+int MemoryStreamBuf::
+underflow() {
+  if (gptr() < egptr()) {
+    return (unsigned char)*gptr();
+  }
+  return EOF;
+}
@@ -0,0 +1,47 @@
+// Filename: memoryStreamBuf.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef MEMORYSTREAMBUF_H
+#define MEMORYSTREAMBUF_H
+
+#include "pandabase.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : MemoryStreamBuf
+// Description : The streambuf object that implements IMemoryStream.
+//               It reads directly out of a block of memory owned by
+//               someone else, without copying it into a buffer of
+//               its own.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS MemoryStreamBuf : public streambuf {
+public:
+  MemoryStreamBuf();
+  virtual ~MemoryStreamBuf();
+
+  void open(const char *data, size_t size);
+  void close();
+
+  virtual streampos seekoff(streamoff off, ios_seekdir dir, ios_openmode which);
+  virtual streampos seekpos(streampos pos, ios_openmode which);
+
+protected:
+  virtual streamsize showmanyc();
+  virtual int underflow();
+
+private:
+  char *_data;
+  size_t _size;
+};
+
+#endif
@@ -22,11 +22,25 @@
 #include "encryptStream.h"
 #include "virtualFileSystem.h"
 #include "virtualFile.h"
+#include "memoryStream.h"
+#include "stl_compares.h"
+#include "pset.h"
+#include "workerThreadGroup.h"
 
 #include <algorithm>
 #include <iterator>
 #include <time.h>
 
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 // This sequence of bytes begins each Multifile to identify it as a
 // Multifile.
 const char Multifile::_header[] = "pmf\0\n\r";
@@ -37,8 +51,13 @@ const size_t Multifile::_header_size = 6;
 // an older minor version may still be read.
 const int Multifile::_current_major_ver = 1;
 
-const int Multifile::_current_minor_ver = 1;
+const int Multifile::_current_minor_ver = 2;
 // Bumped to version 1.1 on 6/8/06 to add timestamps.
+// Bumped to version 1.2 on 10/19/26 to add SF_codec_lz.  Only a
+// Multifile that actually contains an LZ-compressed subfile is marked
+// 1.2; the rest are still written as 1.1, so that older versions of
+// Panda can read them.
+const int Multifile::_codec_lz_minor_ver = 2;
 
 // To confirm that the supplied password matches, we write the
 // Mutifile magic header at the beginning of the encrypted stream.
@@ -117,6 +136,10 @@ Multifile() :
   
   _read = (IStreamWrapper *)NULL;
   _write = (ostream *)NULL;
+  _map_base = (char *)NULL;
+  _map_size = 0;
+  _map_data = (const char *)NULL;
+  _map_data_size = 0;
   _offset = 0;
   _owns_stream = false;
   _next_index = 0;
@@ -130,6 +153,9 @@ Multifile() :
   _new_scale_factor = 1;
   _encryption_flag = false;
   _encryption_iteration_count = multifile_encryption_iteration_count;
+  _compression_codec = CC_zlib;
+  _compression_threads = multifile_compression_threads;
+  _deduplicate = multifile_deduplicate;
   _file_major_ver = 0;
   _file_minor_ver = 0;
 
@@ -208,7 +234,20 @@ open_read(const Filename &multifile_name, const streampos &offset) {
   _owns_stream = true;
   _multifile_name = multifile_name;
   _offset = offset;
-  return read_index();
+  if (!read_index()) {
+    return false;
+  }
+
+  if (multifile_mmap) {
+    // If the Multifile lives within a real file on disk (possibly
+    // itself as an uncompressed subfile of another Multifile), map
+    // that range of the file into memory.
+    SubfileInfo info;
+    if (vfile->get_system_info(info)) {
+      map_read_file(info);
+    }
+  }
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -392,6 +431,8 @@ close() {
     }
   }
 
+  unmap_read_file();
+
   _read = (IStreamWrapper *)NULL;
   _write = (ostream *)NULL;
   _offset = 0;
@@ -1237,6 +1278,228 @@ validate_signature_certificate(int n) const {
 }
 #endif // HAVE_OPENSSL
 
+////////////////////////////////////////////////////////////////////
+//       Class : Multifile::PrepareJob
+// Description : This is used by flush() to compress and encrypt the
+//               new subfiles on several worker threads at once,
+//               while the calling thread writes them out to the
+//               Multifile in their proper order.
+//
+//               The workers only run a limited distance ahead of the
+//               writer, so that we don't hold too much of the
+//               prepared data in memory at once.  If the writer
+//               reaches a subfile that nobody has started on yet, it
+//               prepares it itself.
+////////////////////////////////////////////////////////////////////
+class Multifile::PrepareJob {
+public:
+  PrepareJob(Multifile *multifile, const PendingSubfiles &subfiles,
+             const PendingSubfiles &shared_with, int num_threads);
+  ~PrepareJob();
+
+  void wait_for(size_t n);
+  void written(size_t n);
+
+private:
+  bool do_next_job(size_t end);
+  static void thread_main(void *data);
+
+  enum State {
+    S_skip,
+    S_pending,
+    S_busy,
+    S_ready,
+  };
+
+  Multifile *_multifile;
+  PendingSubfiles _subfiles;
+  pvector<State> _states;
+  pvector<streamsize> _sizes;
+
+  size_t _next_job;
+  size_t _next_write;
+  size_t _window;
+  streamsize _queued_size;
+
+  // Protects all of the above.
+  MutexImpl _lock;
+
+  // Serializes the creation of the compression and encryption
+  // streams.
+  MutexImpl _setup_lock;
+
+  // The workers, and the condition on _lock that they and the writer
+  // wait on.  It is notified whenever a subfile is prepared or
+  // written.
+  WorkerThreadGroup _threads;
+
+  // The workers won't start a new subfile while more than this many
+  // bytes of source data are waiting to be written.
+  static const streamsize _max_queued_size = 0x10000000;
+};
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::PrepareJob::Constructor
+//       Access: Public
+//  Description: Starts the indicated number of threads working on
+//               the preparable subfiles in the list.  If num_threads
+//               is 0, nothing is prepared ahead of time, and
+//               write_data() does all of the work as usual.
+//               Subfiles with a non-NULL entry in shared_with will
+//               not be written at all, so they are not prepared.
+////////////////////////////////////////////////////////////////////
+Multifile::PrepareJob::
+PrepareJob(Multifile *multifile, const PendingSubfiles &subfiles,
+           const PendingSubfiles &shared_with, int num_threads) :
+  _multifile(multifile),
+  _subfiles(subfiles),
+  _next_job(0),
+  _next_write(0),
+  _window(num_threads * 2),
+  _queued_size(0),
+  _threads(_lock)
+{
+  _states.reserve(_subfiles.size());
+  _sizes.reserve(_subfiles.size());
+  for (size_t i = 0; i < _subfiles.size(); ++i) {
+    Subfile *subfile = _subfiles[i];
+    streamsize size = 0;
+    if (num_threads > 0 && subfile->is_preparable() &&
+        shared_with[i] == (Subfile *)NULL) {
+      _states.push_back(S_pending);
+      if (!subfile->_source_filename.empty()) {
+        size = max(subfile->_source_filename.get_file_size(), (streamsize)0);
+      }
+    } else {
+      _states.push_back(S_skip);
+    }
+    _sizes.push_back(size);
+  }
+
+  for (int i = 0; i < num_threads; ++i) {
+    if (!_threads.start_thread(&thread_main, this)) {
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::PrepareJob::Destructor
+//       Access: Public
+//  Description: Waits for the worker threads to finish.  Any subfile
+//               that has not been started by this point will not be
+//               prepared.
+////////////////////////////////////////////////////////////////////
+Multifile::PrepareJob::
+~PrepareJob() {
+  _lock.acquire();
+  _next_job = _subfiles.size();
+  _threads.notify_all();
+  _lock.release();
+
+  _threads.join();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::PrepareJob::wait_for
+//       Access: Public
+//  Description: Called by the writing thread before it writes the nth
+//               subfile, to ensure that no other thread is still
+//               working on it.
+////////////////////////////////////////////////////////////////////
+void Multifile::PrepareJob::
+wait_for(size_t n) {
+  nassertv(n < _subfiles.size());
+  _lock.acquire();
+  while (true) {
+    State state = _states[n];
+    if (state == S_pending) {
+      // Nobody has started on it yet; do it ourselves.  The jobs are
+      // handed out in order, so this will get to it soon.
+      do_next_job(n + 1);
+    } else if (state == S_busy) {
+      _threads.wait();
+    } else {
+      break;
+    }
+  }
+  _lock.release();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::PrepareJob::written
+//       Access: Public
+//  Description: Called by the writing thread after it has written
+//               the nth subfile, to allow the workers to move ahead.
+////////////////////////////////////////////////////////////////////
+void Multifile::PrepareJob::
+written(size_t n) {
+  _lock.acquire();
+  _next_write = n + 1;
+  if (_states[n] == S_ready) {
+    _queued_size -= _sizes[n];
+  }
+  _threads.notify_all();
+  _lock.release();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::PrepareJob::do_next_job
+//       Access: Private
+//  Description: Prepares the next pending subfile, if there is one
+//               before the indicated index and within the window.
+//               Returns true if a subfile was prepared, false if
+//               there was nothing to do.
+//
+//               The lock must be held on entry; it is released while
+//               the subfile is being prepared, and held again on
+//               return.
+////////////////////////////////////////////////////////////////////
+bool Multifile::PrepareJob::
+do_next_job(size_t end) {
+  end = min(end, min(_next_write + _window, _subfiles.size()));
+  while (_next_job < end && _states[_next_job] != S_pending) {
+    ++_next_job;
+  }
+  if (_next_job >= end ||
+      (_next_job != _next_write &&
+       _queued_size + _sizes[_next_job] > _max_queued_size)) {
+    return false;
+  }
+
+  size_t n = _next_job;
+  ++_next_job;
+  _states[n] = S_busy;
+  _queued_size += _sizes[n];
+  _lock.release();
+
+  _subfiles[n]->prepare_data(_multifile, _setup_lock);
+
+  _lock.acquire();
+  _states[n] = S_ready;
+  _threads.notify_all();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::PrepareJob::thread_main
+//       Access: Private, Static
+//  Description: The body of each worker thread.  Prepares subfiles
+//               as the window allows, and sleeps while it doesn't,
+//               until there are none left.
+////////////////////////////////////////////////////////////////////
+void Multifile::PrepareJob::
+thread_main(void *data) {
+  PrepareJob *self = (PrepareJob *)data;
+  self->_lock.acquire();
+  while (self->_next_job < self->_subfiles.size()) {
+    if (!self->do_next_job(self->_subfiles.size())) {
+      self->_threads.wait();
+    }
+  }
+  self->_lock.release();
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Multifile::flush
 //       Access: Published
@@ -1265,19 +1528,49 @@ flush() {
   }
 
   bool new_file = (_next_index == (streampos)0);
+
+  // The file only needs the newer minor version if it will contain a
+  // subfile compressed with CC_lz.
+  int minor_ver = new_file ? 1 : _file_minor_ver;
+  if (minor_ver < _codec_lz_minor_ver) {
+    PendingSubfiles::const_iterator ni;
+    for (ni = _new_subfiles.begin(); ni != _new_subfiles.end(); ++ni) {
+      if (((*ni)->_flags & SF_codec_lz) != 0) {
+        minor_ver = _codec_lz_minor_ver;
+        break;
+      }
+    }
+  }
+
   if (new_file) {
     // If we don't have an index yet, we don't have a header.  Write
     // the header.
-    if (!write_header()) {
+    if (!write_header(minor_ver)) {
       return false;
     }
 
   } else {
-    if (_file_minor_ver != _current_minor_ver) {
+    if (_file_minor_ver < 1) {
       // If we *do* have an index already, but this is an old version
       // multifile, we have to completely rewrite it anyway.
       return repack();
     }
+
+    if (minor_ver != _file_minor_ver) {
+      // Mark the file with the new version before we add anything
+      // that requires it.
+      nassertr(_write != (ostream *)NULL, false);
+      _write->seekp(_header_prefix.size() + _header_size + 2);
+      StreamWriter writer(_write, false);
+      writer.add_int16(minor_ver);
+      if (_write->fail()) {
+        express_cat.info()
+          << "Unable to update Multifile " << _multifile_name << ".\n";
+        close();
+        return false;
+      }
+      _file_minor_ver = minor_ver;
+    }
   }
 
   nassertr(_write != (ostream *)NULL, false);
@@ -1297,6 +1590,14 @@ flush() {
     // Add a few more files to the end.  We always add subfiles at the
     // end of the multifile, so go there first.
     sort(_new_subfiles.begin(), _new_subfiles.end(), IndirectLess<Subfile>());
+
+    // Some of the subfiles may not need their data written at all,
+    // because they can share the data of another subfile.  We must
+    // find these before we start writing, since this may read from
+    // the same file.
+    PendingSubfiles shared_with;
+    find_duplicates(shared_with);
+
     if (_last_index != (streampos)0) {
       _write->seekp(0, ios::end);
       if (_write->fail()) {
@@ -1336,9 +1637,28 @@ flush() {
     nassertr(_next_index == _write->tellp(), false);
     _next_index = pad_to_streampos(_next_index);
 
-    // All right, now write out each subfile's data.
-    for (pi = _new_subfiles.begin(); pi != _new_subfiles.end(); ++pi) {
-      Subfile *subfile = (*pi);
+    // All right, now write out each subfile's data.  If we have
+    // been asked to use several threads, they compress the subfiles
+    // ahead of us while we write them.
+    int num_threads = 0;
+    if (_compression_threads > 1 && _new_subfiles.size() > 1 &&
+        WorkerThreadGroup::is_threading_supported()) {
+      num_threads = _compression_threads;
+    }
+    PrepareJob job(this, _new_subfiles, shared_with, num_threads);
+
+    for (size_t i = 0; i < _new_subfiles.size(); ++i) {
+      Subfile *subfile = _new_subfiles[i];
+      job.wait_for(i);
+
+      if (shared_with[i] != (Subfile *)NULL) {
+        // The other subfile's data has already been written (or was
+        // already in the Multifile), so just point to it.
+        subfile->share_data(shared_with[i]);
+        _last_data_byte = max(_last_data_byte, subfile->get_last_byte_pos());
+        job.written(i);
+        continue;
+      }
 
       if (_read != (IStreamWrapper *)NULL) {
         _read->acquire();
@@ -1359,6 +1679,7 @@ flush() {
       if (!subfile->is_cert_special()) {
         _last_data_byte = max(_last_data_byte, subfile->get_last_byte_pos());
       }
+      job.written(i);
       nassertr(_next_index == _write->tellp(), false);
     }
     
@@ -1374,6 +1695,10 @@ flush() {
     _new_subfiles.clear();
   }
 
+  if (_name_index.empty()) {
+    build_name_index();
+  }
+
   // Also update the overall timestamp.
   if (_timestamp_dirty) {
     nassertr(!_write->fail(), false);
@@ -1512,8 +1837,25 @@ get_num_subfiles() const {
 ////////////////////////////////////////////////////////////////////
 int Multifile::
 find_subfile(const string &subfile_name) const {
+  string name = standardize_subfile_name(subfile_name);
+
+  if (!_name_index.empty()) {
+    size_t hash = string_hash::add_hash(0, name);
+    size_t mask = _name_index.size() - 1;
+    size_t si = hash & mask;
+    while (_name_index[si]._index >= 0) {
+      const NameSlot &slot = _name_index[si];
+      if (slot._hash == hash && _subfiles[slot._index]->_name == name) {
+        return slot._index;
+      }
+      si = (si + 1) & mask;
+    }
+    // Not present.
+    return -1;
+  }
+
   Subfile find_subfile;
-  find_subfile._name = standardize_subfile_name(subfile_name);
+  find_subfile._name = name;
   Subfiles::const_iterator fi;
   fi = _subfiles.find(&find_subfile);
   if (fi == _subfiles.end()) {
@@ -1537,6 +1879,11 @@ has_directory(const string &subfile_name) const {
   if (!prefix.empty()) {
     prefix += '/';
   }
+
+  if (!_dir_index.empty() && !prefix.empty()) {
+    return (find_directory(prefix) >= 0);
+  }
+
   Subfile find_subfile;
   find_subfile._name = prefix;
   Subfiles::const_iterator fi;
@@ -1574,10 +1921,22 @@ scan_directory(vector_string &contents, const string &subfile_name) const {
   if (!prefix.empty()) {
     prefix += '/';
   }
-  Subfile find_subfile;
-  find_subfile._name = prefix;
+
   Subfiles::const_iterator fi;
-  fi = _subfiles.upper_bound(&find_subfile);
+  if (!_dir_index.empty() && !prefix.empty()) {
+    // The directory index tells us where the subfiles beneath this
+    // prefix begin, if there are any.
+    int first = find_directory(prefix);
+    if (first < 0) {
+      return true;
+    }
+    fi = _subfiles.begin() + first;
+
+  } else {
+    Subfile find_subfile;
+    find_subfile._name = prefix;
+    fi = _subfiles.upper_bound(&find_subfile);
+  }
 
   string previous = "";
   while (fi != _subfiles.end()) {
@@ -1622,6 +1981,7 @@ remove_subfile(int index) {
   Subfile *subfile = _subfiles[index];
   subfile->_flags |= SF_deleted;
   _removed_subfiles.push_back(subfile);
+  clear_name_index();
   _subfiles.erase(_subfiles.begin() + index);
 
   _timestamp = time(NULL);
@@ -1691,6 +2051,22 @@ is_subfile_compressed(int index) const {
   return (_subfiles[index]->_flags & SF_compressed) != 0;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::get_subfile_compression_codec
+//       Access: Published
+//  Description: Returns the codec with which the indicated subfile
+//               was compressed.  This is only meaningful if
+//               is_subfile_compressed() returns true.
+////////////////////////////////////////////////////////////////////
+CompressionCodec Multifile::
+get_subfile_compression_codec(int index) const {
+  nassertr(index >= 0 && index < (int)_subfiles.size(), CC_invalid);
+  if ((_subfiles[index]->_flags & SF_codec_lz) != 0) {
+    return CC_lz;
+  }
+  return CC_zlib;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Multifile::is_subfile_encrypted
 //       Access: Published
@@ -1721,6 +2097,75 @@ is_subfile_text(int index) const {
   return (_subfiles[index]->_flags & SF_text) != 0;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::get_subfile_shared_with
+//       Access: Published
+//  Description: If the nth subfile shares its data with another
+//               subfile, because their contents were found to be
+//               identical (see set_deduplicate()), returns the index
+//               of the first such subfile.  Returns -1 if the subfile
+//               has its own data.
+////////////////////////////////////////////////////////////////////
+int Multifile::
+get_subfile_shared_with(int index) const {
+  nassertr(index >= 0 && index < (int)_subfiles.size(), -1);
+  const Subfile *subfile = _subfiles[index];
+  if (subfile->_data_start == (streampos)0 || subfile->_data_length == 0) {
+    return -1;
+  }
+  for (int i = 0; i < (int)_subfiles.size(); ++i) {
+    if (i != index && _subfiles[i]->_data_start == subfile->_data_start) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::get_num_shared_subfiles
+//       Access: Published
+//  Description: Returns the number of subfiles that do not have their
+//               own data, but instead refer to the data of another
+//               subfile with identical contents.  See
+//               set_deduplicate().
+////////////////////////////////////////////////////////////////////
+int Multifile::
+get_num_shared_subfiles() const {
+  pset<streampos> starts;
+  int num_shared = 0;
+  Subfiles::const_iterator fi;
+  for (fi = _subfiles.begin(); fi != _subfiles.end(); ++fi) {
+    const Subfile *subfile = (*fi);
+    if (subfile->_data_start != (streampos)0 && subfile->_data_length != 0 &&
+        !starts.insert(subfile->_data_start).second) {
+      ++num_shared;
+    }
+  }
+  return num_shared;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::get_shared_bytes_saved
+//       Access: Published
+//  Description: Returns the number of bytes that would have been
+//               needed to store the data of the subfiles counted by
+//               get_num_shared_subfiles(), had they not been shared.
+////////////////////////////////////////////////////////////////////
+streamsize Multifile::
+get_shared_bytes_saved() const {
+  pset<streampos> starts;
+  streamsize bytes_saved = 0;
+  Subfiles::const_iterator fi;
+  for (fi = _subfiles.begin(); fi != _subfiles.end(); ++fi) {
+    const Subfile *subfile = (*fi);
+    if (subfile->_data_start != (streampos)0 && subfile->_data_length != 0 &&
+        !starts.insert(subfile->_data_start).second) {
+      bytes_saved += subfile->_data_length;
+    }
+  }
+  return bytes_saved;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Multifile::get_index_end
 //       Access: Published
@@ -2159,6 +2604,13 @@ read_subfile(int index, pvector<unsigned char> &result) {
     success = VirtualFile::simple_read_file(in, result);
     close_read_subfile(in);
 
+  } else if (get_mapped_pointer(subfile) != (const char *)NULL) {
+    // The subfile is a plain file, and the Multifile is mapped into
+    // memory; just copy it out.
+    const char *data = get_mapped_pointer(subfile);
+    result.insert(result.end(), (const unsigned char *)data,
+                  (const unsigned char *)data + subfile->_data_length);
+
   } else {
     // But if the subfile is just a plain file, we can just read the
     // data directly from the Multifile, without paying the cost of an
@@ -2198,6 +2650,39 @@ read_subfile(int index, pvector<unsigned char> &result) {
   return true;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::get_subfile_mapped_data
+//       Access: Public
+//  Description: If the indicated subfile is neither compressed nor
+//               encrypted, and the Multifile is mapped into memory
+//               (see is_mapped()), fills in data and size with the
+//               location of the subfile's contents in memory and
+//               returns true.  No data is copied.  Otherwise, returns
+//               false, and the subfile must be read with
+//               read_subfile() or open_read_subfile() instead.
+//
+//               The pointer remains valid until the Multifile is
+//               closed.  Unlike open_read_subfile(), any number of
+//               threads may read mapped data at the same time.
+////////////////////////////////////////////////////////////////////
+bool Multifile::
+get_subfile_mapped_data(int index, const char *&data, size_t &size) const {
+  nassertr(index >= 0 && index < (int)_subfiles.size(), false);
+  const Subfile *subfile = _subfiles[index];
+  if ((subfile->_flags & (SF_encrypted | SF_compressed)) != 0) {
+    return false;
+  }
+
+  const char *pointer = get_mapped_pointer(subfile);
+  if (pointer == (const char *)NULL) {
+    return false;
+  }
+
+  data = pointer;
+  size = subfile->_data_length;
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Multifile::pad_to_streampos
 //       Access: Private
@@ -2236,6 +2721,9 @@ add_new_subfile(Subfile *subfile, int compression_level) {
 #else  // HAVE_ZLIB
     subfile->_flags |= SF_compressed;
     subfile->_compression_level = compression_level;
+    if (_compression_codec == CC_lz) {
+      subfile->_flags |= SF_codec_lz;
+    }
 #endif  // HAVE_ZLIB
   }
 
@@ -2251,6 +2739,7 @@ add_new_subfile(Subfile *subfile, int compression_level) {
     _needs_repack = true;
   }
 
+  clear_name_index();
   pair<Subfiles::iterator, bool> insert_result = _subfiles.insert(subfile);
   if (!insert_result.second) {
     // Hmm, unable to insert.  There must already be a subfile by that
@@ -2290,9 +2779,18 @@ open_read_subfile(Subfile *subfile) {
   // Return an ISubStream object that references into the open
   // Multifile istream.
   nassertr(subfile->_data_start != (streampos)0, NULL);
-  istream *stream = 
-    new ISubStream(_read, _offset + subfile->_data_start,
-                   _offset + subfile->_data_start + (streampos)subfile->_data_length); 
+  istream *stream;
+  const char *data = get_mapped_pointer(subfile);
+  if (data != (const char *)NULL) {
+    // The Multifile is mapped into memory, so we can read the data
+    // straight from there, without sharing the file pointer with the
+    // other readers.
+    stream = new IMemoryStream(data, subfile->_data_length);
+  } else {
+    stream = 
+      new ISubStream(_read, _offset + subfile->_data_start,
+                     _offset + subfile->_data_start + (streampos)subfile->_data_length); 
+  }
   
   if ((subfile->_flags & SF_encrypted) != 0) {
 #ifndef HAVE_OPENSSL
@@ -2344,6 +2842,232 @@ open_read_subfile(Subfile *subfile) {
   return stream;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::map_read_file
+//       Access: Private
+//  Description: Maps the indicated range of a file on disk, which
+//               contains the Multifile just opened for reading, into
+//               memory.  If this fails for any reason, the Multifile
+//               is left unmapped, and will continue to be read
+//               through its stream.
+////////////////////////////////////////////////////////////////////
+void Multifile::
+map_read_file(const SubfileInfo &info) {
+  unmap_read_file();
+  if (info.is_empty() || info.get_size() <= 0) {
+    return;
+  }
+
+  // We map the file from the beginning, since the start of the range
+  // will not in general be aligned to a page boundary.  Make sure the
+  // end of the range fits in a size_t before we add it up.
+  PN_uint64 start64 = (PN_uint64)info.get_start();
+  PN_uint64 size64 = (PN_uint64)info.get_size();
+  PN_uint64 max_size = (PN_uint64)(~(size_t)0);
+  if (size64 > max_size || start64 > max_size - size64) {
+    // Too big to map into this address space.
+    return;
+  }
+  size_t start = (size_t)start64;
+  size_t map_size = (size_t)(start64 + size64);
+
+#ifdef WIN32
+  wstring os_specific = info.get_filename().to_os_specific_w();
+  HANDLE file = CreateFileW(os_specific.c_str(), GENERIC_READ,
+                            FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    return;
+  }
+  void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, map_size);
+  CloseHandle(mapping);
+  if (base == NULL) {
+    if (express_cat.is_debug()) {
+      express_cat.debug()
+        << "Unable to map " << info.get_filename() << " into memory.\n";
+    }
+    return;
+  }
+
+#else
+  string os_specific = info.get_filename().to_os_specific();
+  int fd = ::open(os_specific.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  void *base = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    if (express_cat.is_debug()) {
+      express_cat.debug()
+        << "Unable to map " << info.get_filename() << " into memory.\n";
+    }
+    return;
+  }
+#endif  // WIN32
+
+  _map_base = (char *)base;
+  _map_size = map_size;
+  _map_data = _map_base + start;
+  _map_data_size = (size_t)info.get_size();
+
+  if (express_cat.is_debug()) {
+    express_cat.debug()
+      << "Mapped " << _map_data_size << " bytes of " << info.get_filename()
+      << " for " << _multifile_name << "\n";
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::unmap_read_file
+//       Access: Private
+//  Description: Releases the memory mapping created by
+//               map_read_file(), if any.
+////////////////////////////////////////////////////////////////////
+void Multifile::
+unmap_read_file() {
+  if (_map_base != (char *)NULL) {
+#ifdef WIN32
+    UnmapViewOfFile(_map_base);
+#else
+    munmap(_map_base, _map_size);
+#endif
+  }
+  _map_base = (char *)NULL;
+  _map_size = 0;
+  _map_data = (const char *)NULL;
+  _map_data_size = 0;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::get_mapped_pointer
+//       Access: Private
+//  Description: Returns the address in memory of the indicated
+//               subfile's data, as it is stored within the Multifile,
+//               or NULL if the Multifile is not mapped.
+////////////////////////////////////////////////////////////////////
+const char *Multifile::
+get_mapped_pointer(const Subfile *subfile) const {
+  if (_map_data == (const char *)NULL || subfile->_data_start == (streampos)0) {
+    return NULL;
+  }
+
+  size_t start = (size_t)(_offset + subfile->_data_start);
+  if (start > _map_data_size || 
+      subfile->_data_length > _map_data_size - start) {
+    return NULL;
+  }
+  return _map_data + start;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::build_name_index
+//       Access: Private
+//  Description: Builds the hash tables used by find_subfile(),
+//               has_directory() and scan_directory() from the current,
+//               sorted list of subfiles.
+////////////////////////////////////////////////////////////////////
+void Multifile::
+build_name_index() {
+  clear_name_index();
+  if (_subfiles.empty()) {
+    return;
+  }
+
+  // Keep the tables no more than half full.
+  size_t num_slots = 1;
+  while (num_slots < _subfiles.size() * 2) {
+    num_slots <<= 1;
+  }
+  NameSlot empty_slot;
+  empty_slot._hash = 0;
+  empty_slot._index = -1;
+  _name_index.insert(_name_index.end(), num_slots, empty_slot);
+  size_t mask = num_slots - 1;
+
+  const string *previous = NULL;
+  for (size_t i = 0; i < _subfiles.size(); ++i) {
+    const string &name = _subfiles[i]->_name;
+    size_t hash = string_hash::add_hash(0, name);
+    size_t si = hash & mask;
+    while (_name_index[si]._index >= 0) {
+      si = (si + 1) & mask;
+    }
+    _name_index[si]._hash = hash;
+    _name_index[si]._index = (int)i;
+
+    // Since the names are sorted, all of the names beneath a given
+    // directory are together, and the directories this name shares
+    // with the previous name have already been recorded.  Record the
+    // rest of them, along with this first subfile beneath each one.
+    size_t common = 0;
+    if (previous != (const string *)NULL) {
+      while (common < name.length() && common < previous->length() &&
+             name[common] == (*previous)[common]) {
+        ++common;
+      }
+    }
+    size_t slash = name.find('/', common);
+    while (slash != string::npos) {
+      _dir_names.push_back(name.substr(0, slash + 1));
+      _dir_first.push_back((int)i);
+      slash = name.find('/', slash + 1);
+    }
+    previous = &name;
+  }
+
+  if (_dir_names.empty()) {
+    return;
+  }
+
+  num_slots = 1;
+  while (num_slots < _dir_names.size() * 2) {
+    num_slots <<= 1;
+  }
+  _dir_index.insert(_dir_index.end(), num_slots, empty_slot);
+  mask = num_slots - 1;
+
+  for (size_t di = 0; di < _dir_names.size(); ++di) {
+    size_t hash = string_hash::add_hash(0, _dir_names[di]);
+    size_t si = hash & mask;
+    while (_dir_index[si]._index >= 0) {
+      si = (si + 1) & mask;
+    }
+    _dir_index[si]._hash = hash;
+    _dir_index[si]._index = (int)di;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::find_directory
+//       Access: Private
+//  Description: Looks up the indicated directory prefix, which ends
+//               in a slash, in the directory index, and returns the
+//               index of the first subfile beneath it, or -1 if there
+//               are no subfiles beneath it.  The directory index must
+//               have been built.
+////////////////////////////////////////////////////////////////////
+int Multifile::
+find_directory(const string &prefix) const {
+  nassertr(!_dir_index.empty(), -1);
+  size_t hash = string_hash::add_hash(0, prefix);
+  size_t mask = _dir_index.size() - 1;
+  size_t si = hash & mask;
+  while (_dir_index[si]._index >= 0) {
+    const NameSlot &slot = _dir_index[si];
+    if (slot._hash == hash && _dir_names[slot._index] == prefix) {
+      return _dir_first[slot._index];
+    }
+    si = (si + 1) & mask;
+  }
+  return -1;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Multifile::standardize_subfile_name
 //       Access: Private
@@ -2351,6 +3075,28 @@ open_read_subfile(Subfile *subfile) {
 ////////////////////////////////////////////////////////////////////
 string Multifile::
 standardize_subfile_name(const string &subfile_name) const {
+  // Most names we are given are already in standard form: relative,
+  // with no empty, "." or ".." components.  Check for that before
+  // paying for Filename::standardize().
+  bool is_standard = (!subfile_name.empty() && subfile_name[0] != '/');
+  size_t p = 0;
+  while (is_standard && p <= subfile_name.length()) {
+    size_t slash = subfile_name.find('/', p);
+    if (slash == string::npos) {
+      slash = subfile_name.length();
+    }
+    size_t length = slash - p;
+    if (length == 0 ||
+        (subfile_name[p] == '.' &&
+         (length == 1 || (length == 2 && subfile_name[p + 1] == '.')))) {
+      is_standard = false;
+    }
+    p = slash + 1;
+  }
+  if (is_standard) {
+    return subfile_name;
+  }
+
   Filename name = subfile_name;
   name.standardize();
   if (name.empty() || name == "/") {
@@ -2403,6 +3149,7 @@ clear_subfiles() {
     delete subfile;
   }
   _subfiles.clear();
+  clear_name_index();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -2547,9 +3294,14 @@ read_index() {
       }
       _last_data_byte = max(_last_data_byte, subfile->get_last_byte_pos());
     }
-    streampos curr_pos = normalize_streampos(read->tellg() - _offset);
+    streampos actual_pos = read->tellg() - _offset;
+    streampos curr_pos = normalize_streampos(actual_pos);
     bytes_skipped = index_forward - curr_pos;
-    read->seekg(index_forward + _offset);
+    if (index_forward != actual_pos) {
+      // Seeking discards the stream's read buffer, so don't do it
+      // when the next entry follows immediately, as it usually does.
+      read->seekg(index_forward + _offset);
+    }
     _next_index = index_forward;
     subfile = new Subfile;
     index_forward = subfile->read_index(*read, _next_index, this);
@@ -2582,6 +3334,8 @@ read_index() {
     nassertr(before_size == after_size, true);
   }
 
+  build_name_index();
+
   delete subfile;
   _read->release();
   return true;
@@ -2591,12 +3345,13 @@ read_index() {
 //     Function: Multifile::write_header
 //       Access: Private
 //  Description: Writes just the header part of the Multifile, not the
-//               index.
+//               index, marked with the indicated minor version.
 ////////////////////////////////////////////////////////////////////
 bool Multifile::
-write_header() {
+write_header(int minor_ver) {
+  nassertr(minor_ver >= 1 && minor_ver <= _current_minor_ver, false);
   _file_major_ver = _current_major_ver;
-  _file_minor_ver = _current_minor_ver;
+  _file_minor_ver = minor_ver;
 
   nassertr(_write != (ostream *)NULL, false);
   nassertr(_write->tellp() == (streampos)0, false);
@@ -2604,7 +3359,7 @@ write_header() {
   _write->write(_header, _header_size);
   StreamWriter writer(_write, false);
   writer.add_int16(_current_major_ver);
-  writer.add_int16(_current_minor_ver);
+  writer.add_int16(minor_ver);
   writer.add_uint32(_scale_factor);
 
   if (_record_timestamp) {
@@ -2628,6 +3383,234 @@ write_header() {
   return true;
 }
 
+#ifdef HAVE_OPENSSL
+////////////////////////////////////////////////////////////////////
+//     Function: read_stream_contents
+//  Description: Reads the remainder of the indicated stream into the
+//               string.  Returns true on success, false if the stream
+//               reported an error other than reaching its end.
+////////////////////////////////////////////////////////////////////
+static bool
+read_stream_contents(istream &in, string &data) {
+  static const size_t buffer_size = 4096;
+  char buffer[buffer_size];
+
+  in.read(buffer, buffer_size);
+  size_t count = in.gcount();
+  while (count != 0) {
+    data.append(buffer, count);
+    in.read(buffer, buffer_size);
+    count = in.gcount();
+  }
+  return !in.bad();
+}
+#endif  // HAVE_OPENSSL
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::find_duplicates
+//       Access: Private
+//  Description: Called by flush() to decide which of the subfiles in
+//               _new_subfiles need not have their data written,
+//               because they can share the data of another subfile.
+//               Fills shared_with with one entry for each subfile in
+//               _new_subfiles: either NULL, or the subfile whose data
+//               it should use.  That subfile is always either already
+//               written, or earlier in _new_subfiles.
+//
+//               Subfiles that already shared their data when this
+//               Multifile was read continue to do so across a
+//               repack(), whether or not deduplication is enabled.
+//               If it is enabled, new subfiles are also compared, by
+//               length and then by hash, against each other and
+//               against the subfiles already in the Multifile.
+////////////////////////////////////////////////////////////////////
+void Multifile::
+find_duplicates(PendingSubfiles &shared_with) {
+  shared_with.assign(_new_subfiles.size(), (Subfile *)NULL);
+
+  // First, the subfiles that are being copied from the old file.
+  // These already share data if they have the same data start.
+  typedef pmap<streampos, Subfile *> Starts;
+  Starts starts;
+  for (size_t i = 0; i < _new_subfiles.size(); ++i) {
+    Subfile *subfile = _new_subfiles[i];
+    if (subfile->_source == (istream *)NULL &&
+        subfile->_source_filename.empty() && !subfile->is_cert_special() &&
+        subfile->_data_start != (streampos)0 && subfile->_data_length != 0) {
+      pair<Starts::iterator, bool> result = 
+        starts.insert(Starts::value_type(subfile->_data_start, subfile));
+      if (!result.second) {
+        shared_with[i] = (*result.first).second;
+      }
+    }
+  }
+
+#ifdef HAVE_OPENSSL
+  if (!_deduplicate) {
+    return;
+  }
+
+  // Now group the candidates by the length of their contents, so we
+  // only have to compute the hash of a subfile if there is another of
+  // the same length.  The subfiles already in the Multifile, which
+  // have their data on disk, are listed under index -1, ahead of
+  // the new ones.
+  typedef pvector<pair<int, Subfile *> > Candidates;
+  typedef pmap<streamsize, Candidates> ByLength;
+  ByLength by_length;
+
+  pset<Subfile *> new_subfiles;
+  for (size_t i = 0; i < _new_subfiles.size(); ++i) {
+    Subfile *subfile = _new_subfiles[i];
+    new_subfiles.insert(subfile);
+    if (shared_with[i] == (Subfile *)NULL && !subfile->is_cert_special() &&
+        !subfile->is_data_invalid()) {
+      streamsize length = get_content_length(subfile);
+      if (length > 0) {
+        by_length[length].push_back(Candidates::value_type((int)i, subfile));
+      }
+    }
+  }
+
+  if (_read != (IStreamWrapper *)NULL) {
+    Subfiles::const_iterator fi;
+    for (fi = _subfiles.begin(); fi != _subfiles.end(); ++fi) {
+      Subfile *subfile = (*fi);
+      if (new_subfiles.find(subfile) == new_subfiles.end() &&
+          subfile->_data_start != (streampos)0) {
+        ByLength::iterator li = by_length.find(subfile->_uncompressed_length);
+        if (li != by_length.end()) {
+          Candidates &candidates = (*li).second;
+          candidates.insert(candidates.begin(), Candidates::value_type(-1, subfile));
+        }
+      }
+    }
+  }
+
+  static const int match_flags = SF_compressed | SF_encrypted | SF_text;
+
+  ByLength::iterator li;
+  for (li = by_length.begin(); li != by_length.end(); ++li) {
+    Candidates &candidates = (*li).second;
+    if (candidates.size() < 2) {
+      continue;
+    }
+
+    // Each candidate that is not itself shared may serve as the
+    // source for the ones that follow it.
+    Candidates sources;
+    Candidates::iterator ci;
+    for (ci = candidates.begin(); ci != candidates.end(); ++ci) {
+      int i = (*ci).first;
+      Subfile *subfile = (*ci).second;
+      HashVal hash;
+      if (!get_content_hash(subfile, hash)) {
+        continue;
+      }
+
+      Subfile *source = NULL;
+      Candidates::const_iterator si;
+      for (si = sources.begin(); si != sources.end() && source == NULL; ++si) {
+        Subfile *other = (*si).second;
+        if (other->_hash == hash &&
+            (other->_flags & match_flags) == (subfile->_flags & match_flags)) {
+          source = other;
+        }
+      }
+
+      if (source != (Subfile *)NULL && i >= 0) {
+        shared_with[i] = source;
+      } else {
+        sources.push_back(*ci);
+      }
+    }
+  }
+#endif  // HAVE_OPENSSL
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::get_content_length
+//       Access: Private
+//  Description: Returns the length of the uncompressed contents of
+//               the indicated new subfile, for find_duplicates(), or
+//               -1 if it cannot be determined without reading the
+//               whole thing.
+////////////////////////////////////////////////////////////////////
+streamsize Multifile::
+get_content_length(Subfile *subfile) {
+  if (subfile->_source != (istream *)NULL) {
+    istream *source = subfile->_source;
+    streampos start = source->tellg();
+    if (start < (streampos)0) {
+      return -1;
+    }
+    source->seekg(0, ios::end);
+    streampos end = source->tellg();
+    source->clear();
+    source->seekg(start);
+    if (end < start) {
+      return -1;
+    }
+    return (streamsize)(end - start);
+
+  } else if (!subfile->_source_filename.empty()) {
+    return subfile->_source_filename.get_file_size();
+  }
+
+  // It's being copied from the Multifile itself, during a repack().
+  return subfile->_uncompressed_length;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::get_content_hash
+//       Access: Private
+//  Description: Fills hash with the hash of the uncompressed contents
+//               of the indicated subfile, reading them if necessary,
+//               and returns true on success.  The result is also
+//               saved within the Subfile.
+////////////////////////////////////////////////////////////////////
+bool Multifile::
+get_content_hash(Subfile *subfile, HashVal &hash) {
+#ifdef HAVE_OPENSSL
+  if (!subfile->_has_hash) {
+    // We can't use HashVal::hash_stream() on these streams, since it
+    // seeks to the beginning first, and a decompression stream can't
+    // do that.  So we read the contents into memory, which prepare_data()
+    // would do anyway.
+    string data;
+    if (subfile->_source != (istream *)NULL) {
+      // Read the stream, and then put it back where we found it.
+      istream *source = subfile->_source;
+      streampos start = source->tellg();
+      subfile->_has_hash = read_stream_contents(*source, data);
+      source->clear();
+      source->seekg(start);
+
+    } else if (!subfile->_source_filename.empty()) {
+      pifstream source;
+      subfile->_has_hash = subfile->_source_filename.open_read(source) &&
+        read_stream_contents(source, data);
+
+    } else if (_read != (IStreamWrapper *)NULL) {
+      istream *in = open_read_subfile(subfile);
+      if (in != (istream *)NULL) {
+        subfile->_has_hash = read_stream_contents(*in, data);
+        close_read_subfile(in);
+      }
+    }
+
+    if (subfile->_has_hash) {
+      subfile->_hash.hash_string(data);
+    }
+  }
+
+  hash = subfile->_hash;
+  return subfile->_has_hash;
+#else
+  return false;
+#endif  // HAVE_OPENSSL
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Multifile::check_signatures
 //       Access: Private
@@ -2900,7 +3883,7 @@ write_data(ostream &write, istream *read, streampos fpos,
 
   istream *source = _source;
   pifstream source_file;
-  if (source == (istream *)NULL && !_source_filename.empty()) {
+  if (!_prepared && source == (istream *)NULL && !_source_filename.empty()) {
     // If we have a filename, open it up and read that.
     if (!_source_filename.open_read(source_file)) {
       // Unable to open the source file.
@@ -2914,7 +3897,19 @@ write_data(ostream &write, istream *read, streampos fpos,
     }
   }
 
-  if (source == (istream *)NULL) {
+  if (_prepared) {
+    // The data has already been compressed and/or encrypted by
+    // prepare_data(); we only have to copy it in.
+    if ((_flags & SF_data_invalid) != 0) {
+      express_cat.info()
+        << "Unable to read " << _source_filename << ".\n";
+    }
+    write.write(_prepared_data.data(), _prepared_data.size());
+    _data_length = _prepared_data.size();
+    _prepared = false;
+    _prepared_data = string();
+
+  } else if (source == (istream *)NULL) {
     // We don't have any source data.  Perhaps we're reading from an
     // already-packed Subfile (e.g. during repack()).
     if (read == (istream *)NULL) {
@@ -2940,42 +3935,11 @@ write_data(ostream &write, istream *read, streampos fpos,
   } else {
     // We do have source data.  Copy it in, and also measure its
     // length.
-    ostream *putter = &write;
-    bool delete_putter = false;
-
-#ifndef HAVE_OPENSSL
-    // Without OpenSSL, we can't support encryption.  The flag had
-    // better not be set.
-    nassertr((_flags & SF_encrypted) == 0, fpos);
-
-#else  // HAVE_OPENSSL
-    if ((_flags & SF_encrypted) != 0) {
-      // Write it encrypted.
-      OEncryptStream *encrypt = new OEncryptStream;
-      encrypt->set_iteration_count(multifile->_encryption_iteration_count);
-      encrypt->open(putter, delete_putter, multifile->_encryption_password);
-
-      putter = encrypt;
-      delete_putter = true;
-
-      // Also write the encrypt_header to the beginning of the
-      // encrypted stream, so we can validate the password on
-      // decryption.
-      putter->write(_encrypt_header, _encrypt_header_size);
+    ostream *putter = open_putter(write, multifile);
+    if (putter == (ostream *)NULL) {
+      return fpos;
     }
-#endif  // HAVE_OPENSSL
-
-#ifndef HAVE_ZLIB
-    // Without ZLIB, we can't support compression.  The flag had
-    // better not be set.
-    nassertr((_flags & SF_compressed) == 0, fpos);
-#else  // HAVE_ZLIB
-    if ((_flags & SF_compressed) != 0) {
-      // Write it compressed.
-      putter = new OCompressStream(putter, delete_putter, _compression_level);
-      delete_putter = true;
-    }
-#endif  // HAVE_ZLIB
+    bool delete_putter = (putter != &write);
 
     streampos write_start = fpos;
     _uncompressed_length = 0;
@@ -3090,6 +4054,121 @@ write_data(ostream &write, istream *read, streampos fpos,
   return fpos + (streampos)_data_length;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::Subfile::prepare_data
+//       Access: Public
+//  Description: Reads the source data for a new subfile and
+//               compresses and/or encrypts it into _prepared_data,
+//               so that a later call to write_data() only has to
+//               copy the result into the Multifile.  This is called
+//               by flush() on a worker thread, so it must not touch
+//               the Multifile itself, other than to read its
+//               encryption settings.
+//
+//               The indicated lock is held while the encryption and
+//               compression streams are being created, since those
+//               consult the config system.
+////////////////////////////////////////////////////////////////////
+void Multifile::Subfile::
+prepare_data(Multifile *multifile, MutexImpl &lock) {
+  nassertv(is_preparable() && !_prepared);
+
+  istream *source = _source;
+  pifstream source_file;
+  if (source == (istream *)NULL) {
+    if (!_source_filename.open_read(source_file)) {
+      // Unable to open the source file.  write_data() will report
+      // this.
+      _flags |= SF_data_invalid;
+      _data_length = 0;
+      _uncompressed_length = 0;
+      _prepared = true;
+      return;
+    }
+    source = &source_file;
+  }
+
+  ostringstream data;
+  lock.acquire();
+  ostream *putter = open_putter(data, multifile);
+  lock.release();
+  nassertv(putter != (ostream *)NULL);
+
+  _uncompressed_length = 0;
+  static const size_t buffer_size = 4096;
+  char buffer[buffer_size];
+
+  source->read(buffer, buffer_size);
+  size_t count = source->gcount();
+  while (count != 0) {
+    _uncompressed_length += count;
+    putter->write(buffer, count);
+    source->read(buffer, buffer_size);
+    count = source->gcount();
+  }
+
+  if (putter != &data) {
+    delete putter;
+  }
+
+  _prepared_data = data.str();
+  _prepared = true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::Subfile::open_putter
+//       Access: Public
+//  Description: Returns a new ostream that compresses and/or
+//               encrypts the data written to it, according to the
+//               subfile's flags, before passing it on to the
+//               indicated stream.  If neither is called for, returns
+//               &write itself.  Otherwise, the caller should delete
+//               the returned stream when it is done.
+////////////////////////////////////////////////////////////////////
+ostream *Multifile::Subfile::
+open_putter(ostream &write, Multifile *multifile) {
+  ostream *putter = &write;
+  bool delete_putter = false;
+
+#ifndef HAVE_OPENSSL
+  // Without OpenSSL, we can't support encryption.  The flag had
+  // better not be set.
+  nassertr((_flags & SF_encrypted) == 0, NULL);
+
+#else  // HAVE_OPENSSL
+  if ((_flags & SF_encrypted) != 0) {
+    // Write it encrypted.
+    OEncryptStream *encrypt = new OEncryptStream;
+    encrypt->set_iteration_count(multifile->_encryption_iteration_count);
+    encrypt->open(putter, delete_putter, multifile->_encryption_password);
+
+    putter = encrypt;
+    delete_putter = true;
+
+    // Also write the encrypt_header to the beginning of the
+    // encrypted stream, so we can validate the password on
+    // decryption.
+    putter->write(_encrypt_header, _encrypt_header_size);
+  }
+#endif  // HAVE_OPENSSL
+
+#ifndef HAVE_ZLIB
+  // Without ZLIB, we can't support compression.  The flag had
+  // better not be set.
+  nassertr((_flags & SF_compressed) == 0, NULL);
+#else  // HAVE_ZLIB
+  if ((_flags & SF_compressed) != 0) {
+    // Write it compressed.
+    CompressionCodec codec = ((_flags & SF_codec_lz) != 0) ? CC_lz : CC_zlib;
+    putter = new OCompressStream(putter, delete_putter, _compression_level,
+                                 codec);
+    delete_putter = true;
+  }
+#endif  // HAVE_ZLIB
+
+  return putter;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Multifile::Subfile::rewrite_index_data_start
 //       Access: Public
@@ -3120,6 +4199,42 @@ rewrite_index_data_start(ostream &write, Multifile *multifile) {
   }
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: Multifile::Subfile::share_data
+//       Access: Public
+//  Description: Called by flush() in lieu of write_data(), when this
+//               subfile's contents are the same as those of the
+//               indicated subfile, whose data has already been
+//               written.  Makes this subfile refer to the same data.
+//
+//               The two subfiles must agree on whether they are
+//               compressed and encrypted, so that the index record
+//               already written for this one has the right size.
+////////////////////////////////////////////////////////////////////
+void Multifile::Subfile::
+share_data(const Subfile *other) {
+  nassertv((_flags & (SF_compressed | SF_encrypted)) == 
+           (other->_flags & (SF_compressed | SF_encrypted)));
+
+  _data_start = other->_data_start;
+  _data_length = other->_data_length;
+  _uncompressed_length = other->_uncompressed_length;
+  _flags = (_flags & ~SF_codec_lz) | (other->_flags & SF_codec_lz);
+  _prepared = false;
+  _prepared_data = string();
+
+  // The timestamp is still our own, as in write_data().
+  if (!_source_filename.empty()) {
+    _timestamp = _source_filename.get_timestamp();
+  }
+  if (_timestamp == 0) {
+    _timestamp = time(NULL);
+  }
+
+  _source = (istream *)NULL;
+  _source_filename = Filename();
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Multifile::Subfile::rewrite_index_flags
 //       Access: Public
@@ -20,12 +20,16 @@
 #include "config_express.h"
 #include "streamWrapper.h"
 #include "subStream.h"
+#include "subfileInfo.h"
 #include "filename.h"
 #include "ordered_vector.h"
 #include "indirectLess.h"
 #include "referenceCount.h"
 #include "pvector.h"
 #include "openSSLWrapper.h"
+#include "mutexImpl.h"
+#include "compressionCodec.h"
+#include "hashVal.h"
 
 ////////////////////////////////////////////////////////////////////
 //       Class : Multifile
@@ -55,6 +59,7 @@ PUBLISHED:
   INLINE bool is_read_valid() const;
   INLINE bool is_write_valid() const;
   INLINE bool needs_repack() const;
+  INLINE bool is_mapped() const;
 
   INLINE time_t get_timestamp() const;
 
@@ -76,6 +81,15 @@ PUBLISHED:
   INLINE void set_encryption_iteration_count(int encryption_iteration_count);
   INLINE int get_encryption_iteration_count() const;
 
+  INLINE void set_compression_codec(CompressionCodec codec);
+  INLINE CompressionCodec get_compression_codec() const;
+
+  INLINE void set_compression_threads(int compression_threads);
+  INLINE int get_compression_threads() const;
+
+  INLINE void set_deduplicate(bool deduplicate);
+  INLINE bool get_deduplicate() const;
+
   string add_subfile(const string &subfile_name, const Filename &filename,
                      int compression_level);
   string add_subfile(const string &subfile_name, istream *subfile_data,
@@ -129,8 +143,13 @@ PUBLISHED:
   size_t get_subfile_length(int index) const;
   time_t get_subfile_timestamp(int index) const;
   bool is_subfile_compressed(int index) const;
+  CompressionCodec get_subfile_compression_codec(int index) const;
   bool is_subfile_encrypted(int index) const;
   bool is_subfile_text(int index) const;
+  int get_subfile_shared_with(int index) const;
+
+  int get_num_shared_subfiles() const;
+  streamsize get_shared_bytes_saved() const;
 
   streampos get_index_end() const;
   streampos get_subfile_internal_start(int index) const;
@@ -154,6 +173,7 @@ PUBLISHED:
 public:
   bool read_subfile(int index, string &result);
   bool read_subfile(int index, pvector<unsigned char> &result);
+  bool get_subfile_mapped_data(int index, const char *&data, size_t &size) const;
 
 private:
   enum SubfileFlags {
@@ -164,6 +184,7 @@ private:
     SF_encrypted      = 0x0010,
     SF_signature      = 0x0020,
     SF_text           = 0x0040,
+    SF_codec_lz       = 0x0080,
   };
 
   class Subfile {
@@ -176,8 +197,12 @@ private:
                           Multifile *multifile);
     streampos write_data(ostream &write, istream *read, streampos fpos,
                          Multifile *multifile);
+    INLINE bool is_preparable() const;
+    void prepare_data(Multifile *multifile, MutexImpl &lock);
+    ostream *open_putter(ostream &write, Multifile *multifile);
     void rewrite_index_data_start(ostream &write, Multifile *multifile);
     void rewrite_index_flags(ostream &write);
+    void share_data(const Subfile *other);
     INLINE bool is_deleted() const;
     INLINE bool is_index_invalid() const;
     INLINE bool is_data_invalid() const;
@@ -195,6 +220,16 @@ private:
     Filename _source_filename;
     int _flags;
     int _compression_level;  // Not preserved on disk.
+
+    // The hash of the uncompressed contents, computed by
+    // find_duplicates() only when it is needed.
+    HashVal _hash;
+    bool _has_hash;
+
+    // The compressed and/or encrypted data, if it was prepared ahead
+    // of time by prepare_data().
+    bool _prepared;
+    string _prepared_data;
 #ifdef HAVE_OPENSSL
     EVP_PKEY *_pkey;         // Not preserved on disk.
 #endif
@@ -211,14 +246,44 @@ private:
 
   void clear_subfiles();
   bool read_index();
-  bool write_header();
+  bool write_header(int minor_ver);
+
+  void build_name_index();
+  INLINE void clear_name_index();
+  int find_directory(const string &prefix) const;
+
+  void map_read_file(const SubfileInfo &info);
+  void unmap_read_file();
+  const char *get_mapped_pointer(const Subfile *subfile) const;
+
+  void find_duplicates(pvector<Subfile *> &shared_with);
+  streamsize get_content_length(Subfile *subfile);
+  bool get_content_hash(Subfile *subfile, HashVal &hash);
 
   void check_signatures();
 
+  class PrepareJob;
+
   static INLINE char tohex(unsigned int nibble);
 
   typedef ov_set<Subfile *, IndirectLess<Subfile> > Subfiles;
   Subfiles _subfiles;
+
+  // Open-addressed hash tables over the names in _subfiles, for
+  // find_subfile(), and over the directory prefixes of those names,
+  // for has_directory() and scan_directory().  These are built when
+  // the index has been read or flushed, and are empty while _subfiles
+  // is being modified, in which case we fall back to a binary search.
+  class NameSlot {
+  public:
+    size_t _hash;
+    int _index;
+  };
+  typedef pvector<NameSlot> NameIndex;
+  NameIndex _name_index;
+  NameIndex _dir_index;
+  vector_string _dir_names;
+  pvector<int> _dir_first;
   typedef pvector<Subfile *> PendingSubfiles;
   PendingSubfiles _new_subfiles;
   PendingSubfiles _removed_subfiles;
@@ -231,6 +296,10 @@ private:
 
   streampos _offset;
   IStreamWrapper *_read;
+  char *_map_base;
+  size_t _map_size;
+  const char *_map_data;
+  size_t _map_data_size;
   ostream *_write;
   bool _owns_stream;
   streampos _next_index;
@@ -249,6 +318,9 @@ private:
   string _encryption_algorithm;
   int _encryption_key_length;
   int _encryption_iteration_count;
+  CompressionCodec _compression_codec;
+  int _compression_threads;
+  bool _deduplicate;
 
   pifstream _read_file;
   IStreamWrapper _read_filew;
@@ -265,11 +337,13 @@ private:
   static const size_t _header_size;
   static const int _current_major_ver;
   static const int _current_minor_ver;
+  static const int _codec_lz_minor_ver;
 
   static const char _encrypt_header[];
   static const size_t _encrypt_header_size;
 
   friend class Subfile;
+  friend class PrepareJob;
 };
 
 #include "multifile.I"
@@ -2,8 +2,10 @@
 #include "checksumHashGenerator.cxx"
 #include "config_express.cxx"
 #include "compress_string.cxx"
+#include "compressionCodec.cxx"
 #include "copy_stream.cxx"
 #include "datagram.cxx"
+#include "datagramBufferPool.cxx"
 #include "datagramGenerator.cxx"
 #include "datagramIterator.cxx"
 #include "datagramSink.cxx"
@@ -13,7 +15,10 @@
 #include "fileReference.cxx"
 #include "hashGeneratorBase.cxx"
 #include "hashVal.cxx"
+#include "lzCompressor.cxx"
 #include "memoryInfo.cxx"
+#include "memoryStream.cxx"
+#include "memoryStreamBuf.cxx"
 #include "memoryUsage.cxx"
 #include "memoryUsagePointerCounts.cxx"
 #include "memoryUsagePointers.cxx"
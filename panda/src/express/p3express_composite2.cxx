@@ -4,6 +4,9 @@
 #include "pta_float.cxx"
 #include "ramfile.cxx"
 #include "referenceCount.cxx"
+#include "streamCodec.cxx"
+#include "streamCodecLZ.cxx"
+#include "streamCodecZlib.cxx"
 #include "subfileInfo.cxx"
 #include "subStream.cxx"
 #include "subStreamBuf.cxx"
@@ -23,6 +26,7 @@
 #include "virtualFileMountMultifile.cxx"
 #include "virtualFileMountRamdisk.cxx"
 #include "virtualFileMountSystem.cxx"
+#include "virtualFileReadCache.cxx"
 #include "virtualFileSimple.cxx"
 #include "virtualFileSystem.cxx"
 #include "weakPointerCallback.cxx"
@@ -31,5 +35,6 @@
 #include "weakPointerToVoid.cxx"
 #include "weakReferenceList.cxx"
 #include "windowsRegistry.cxx"
+#include "workerThreadGroup.cxx"
 #include "zStream.cxx"
 #include "zStreamBuf.cxx"
@@ -24,6 +24,8 @@
 #include "multifile.h"
 #include "hashVal.h"
 #include "virtualFileSystem.h"
+#include "mutexImpl.h"
+#include "workerThreadGroup.h"
 
 #include <string.h>  // for strstr
 
@@ -135,6 +137,9 @@ init(PT(Buffer) buffer) {
   _origfile_stream = NULL;
 
   reset_footprint_length();
+  _build_mode = patchfile_rolling_hash ? BM_rolling_hash : BM_footprint;
+  _block_length = max(patchfile_block_length.get_value(), 1);
+  _build_threads = patchfile_build_threads;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -832,6 +837,589 @@ find_longest_match(PN_uint32 new_pos, PN_uint32 &copy_pos, PN_uint16 &copy_lengt
   }
 }
 
+////////////////////////////////////////////////////////////////////
+//       Class : Patchfile::BlockIndex
+// Description : This is used by compute_rolling_hash_patches() to
+//               look up the parts of the original file that match a
+//               given position in the new file.
+//
+//               The original file is divided into consecutive blocks
+//               of _block_length bytes, and each block is entered
+//               into an open-addressed hash table according to its
+//               rolling hash.  Only the first of several identical
+//               blocks is entered.  The new file may then be scanned
+//               one byte at a time, updating the hash as each byte
+//               enters and leaves the window, so that every offset
+//               of the new file is considered at a constant cost.
+//
+//               The hash is a polynomial in the bytes of the block,
+//               modulo 2^32; it is mixed once more before it is used
+//               to choose a slot in the table.
+////////////////////////////////////////////////////////////////////
+class Patchfile::BlockIndex {
+public:
+  BlockIndex(const char *buffer_orig, PN_uint32 length_orig,
+             PN_uint32 block_length);
+  ~BlockIndex();
+
+  PN_uint32 get_block_length() const;
+  PN_uint32 hash_block(const char *buffer) const;
+  PN_uint32 roll_hash(PN_uint32 hash, unsigned char out_byte,
+                      unsigned char in_byte) const;
+  bool find_match(PN_uint32 hash, const char *data, PN_uint32 max_length,
+                  PN_uint32 &orig_pos, PN_uint32 &length) const;
+
+private:
+  PN_uint32 get_slot(PN_uint32 hash) const;
+
+  const char *_buffer_orig;
+  PN_uint32 _length_orig;
+  PN_uint32 _block_length;
+  PN_uint32 _roll_factor;
+  int _shift;
+  PN_uint32 _mask;
+  PN_uint32 *_hashes;
+  PN_uint32 *_positions;
+
+  static const PN_uint32 _prime;
+  static const PN_uint32 _max_blocks;
+  static const int _max_candidates;
+};
+
+const PN_uint32 Patchfile::BlockIndex::_prime = 0x01000193;
+const PN_uint32 Patchfile::BlockIndex::_max_blocks = PN_uint32(1) << 28;
+const int Patchfile::BlockIndex::_max_candidates = 16;
+
+////////////////////////////////////////////////////////////////////
+//     Function: calc_run_length
+//  Description: Returns the number of bytes, up to max_length, at
+//               the start of the two buffers that are the same.
+////////////////////////////////////////////////////////////////////
+static PN_uint32
+calc_run_length(const char *buf1, const char *buf2, PN_uint32 max_length) {
+  static const PN_uint32 chunk = 64;
+  PN_uint32 length = 0;
+  while (max_length - length >= chunk &&
+         memcmp(buf1 + length, buf2 + length, chunk) == 0) {
+    length += chunk;
+  }
+  while (length < max_length && buf1[length] == buf2[length]) {
+    ++length;
+  }
+  return length;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::BlockIndex::Constructor
+//       Access: Public
+//  Description: Indexes each block of the original file.  The
+//               buffer must remain valid for the lifetime of the
+//               BlockIndex.
+////////////////////////////////////////////////////////////////////
+Patchfile::BlockIndex::
+BlockIndex(const char *buffer_orig, PN_uint32 length_orig,
+           PN_uint32 block_length) :
+  _buffer_orig(buffer_orig),
+  _length_orig(length_orig)
+{
+  // Keep the table to a sensible size, even if a very small block
+  // length was requested for a very large file.
+  _block_length = max(block_length, length_orig / _max_blocks + 1);
+  PN_uint32 num_blocks = length_orig / _block_length;
+
+  _roll_factor = 1;
+  for (PN_uint32 i = 1; i < _block_length; ++i) {
+    _roll_factor *= _prime;
+  }
+
+  // Keep the table no more than half full.
+  int bits = 4;
+  while ((PN_uint32(1) << bits) < num_blocks * 2) {
+    ++bits;
+  }
+  _shift = 32 - bits;
+  _mask = (PN_uint32(1) << bits) - 1;
+
+  if (express_cat.is_debug()) {
+    express_cat.debug()
+      << "Indexing " << num_blocks << " blocks of " << _block_length
+      << " bytes in a table of " << (_mask + 1) << " slots\n";
+  }
+
+  _hashes = (PN_uint32 *)PANDA_MALLOC_ARRAY((_mask + 1) * sizeof(PN_uint32));
+  _positions = (PN_uint32 *)PANDA_MALLOC_ARRAY((_mask + 1) * sizeof(PN_uint32));
+  for (PN_uint32 i = 0; i <= _mask; ++i) {
+    _positions[i] = _NULL_VALUE;
+  }
+
+  for (PN_uint32 b = 0; b < num_blocks; ++b) {
+    PN_uint32 pos = b * _block_length;
+    PN_uint32 hash = hash_block(_buffer_orig + pos);
+    PN_uint32 slot = get_slot(hash);
+    bool duplicate = false;
+    while (_positions[slot] != _NULL_VALUE) {
+      if (_hashes[slot] == hash &&
+          memcmp(_buffer_orig + _positions[slot], _buffer_orig + pos,
+                 _block_length) == 0) {
+        // We already have a block just like this one.
+        duplicate = true;
+        break;
+      }
+      slot = (slot + 1) & _mask;
+    }
+    if (!duplicate) {
+      _hashes[slot] = hash;
+      _positions[slot] = pos;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::BlockIndex::Destructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+Patchfile::BlockIndex::
+~BlockIndex() {
+  PANDA_FREE_ARRAY(_hashes);
+  PANDA_FREE_ARRAY(_positions);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::BlockIndex::get_block_length
+//       Access: Public
+//  Description: Returns the length of the indexed blocks.  This may
+//               be larger than the length that was requested, if the
+//               original file is very large.
+////////////////////////////////////////////////////////////////////
+PN_uint32 Patchfile::BlockIndex::
+get_block_length() const {
+  return _block_length;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::BlockIndex::hash_block
+//       Access: Public
+//  Description: Computes the hash of the block_length bytes
+//               beginning at the indicated pointer.
+////////////////////////////////////////////////////////////////////
+PN_uint32 Patchfile::BlockIndex::
+hash_block(const char *buffer) const {
+  PN_uint32 hash = 0;
+  for (PN_uint32 i = 0; i < _block_length; ++i) {
+    hash = hash * _prime + (unsigned char)buffer[i];
+  }
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::BlockIndex::roll_hash
+//       Access: Public
+//  Description: Given the hash of a block, returns the hash of the
+//               block one byte further on, which no longer includes
+//               out_byte, and now ends with in_byte.
+////////////////////////////////////////////////////////////////////
+PN_uint32 Patchfile::BlockIndex::
+roll_hash(PN_uint32 hash, unsigned char out_byte,
+          unsigned char in_byte) const {
+  return (hash - out_byte * _roll_factor) * _prime + in_byte;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::BlockIndex::find_match
+//       Access: Public
+//  Description: Looks for a block of the original file that matches
+//               the block of the new file at the indicated pointer,
+//               whose hash is given.  If there are several, chooses
+//               the one whose match continues the furthest, up to
+//               max_length bytes.  Returns true if a match is found,
+//               filling in its position in the original file and its
+//               length, which is at least block_length.
+////////////////////////////////////////////////////////////////////
+bool Patchfile::BlockIndex::
+find_match(PN_uint32 hash, const char *data, PN_uint32 max_length,
+           PN_uint32 &orig_pos, PN_uint32 &length) const {
+  length = 0;
+  int num_candidates = 0;
+  PN_uint32 slot = get_slot(hash);
+  while (_positions[slot] != _NULL_VALUE && num_candidates < _max_candidates) {
+    if (_hashes[slot] == hash) {
+      PN_uint32 pos = _positions[slot];
+      PN_uint32 run = calc_run_length(data, _buffer_orig + pos,
+                                      min(max_length, _length_orig - pos));
+      if (run >= _block_length && run > length) {
+        orig_pos = pos;
+        length = run;
+      }
+      ++num_candidates;
+    }
+    slot = (slot + 1) & _mask;
+  }
+  return (length != 0);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::BlockIndex::get_slot
+//       Access: Private
+//  Description: Returns the first slot of the table to consider for
+//               the indicated hash.
+////////////////////////////////////////////////////////////////////
+PN_uint32 Patchfile::BlockIndex::
+get_slot(PN_uint32 hash) const {
+  return ((hash * 0x9e3779b1) >> _shift) & _mask;
+}
+
+////////////////////////////////////////////////////////////////////
+//       Class : Patchfile::MatchJob
+// Description : This is used by compute_rolling_hash_patches() to
+//               search a batch of the new file for matches on
+//               several threads at once.
+//
+//               The new file is divided into regions of a fixed
+//               size, and each region is searched independently for
+//               runs of bytes that also appear in the original file.
+//               A match that begins in one region may continue to
+//               the end of the following region, but no further.
+//               Because none of this depends on the number of
+//               threads, or on how the regions are batched, neither
+//               do the matches that are found.
+////////////////////////////////////////////////////////////////////
+class Patchfile::MatchJob {
+public:
+  MatchJob(const BlockIndex &index, const char *buffer_orig,
+           const char *buffer_new, PN_uint32 new_start,
+           PN_uint32 scan_length, PN_uint32 data_length, int num_threads);
+  ~MatchJob();
+
+  void run();
+  size_t get_num_regions() const;
+  const Matches &get_matches(size_t n) const;
+
+  static const PN_uint32 _region_length;
+
+private:
+  bool do_next_region();
+  void scan_region(size_t n);
+  static void thread_main(void *data);
+
+  const BlockIndex &_index;
+  const char *_buffer_orig;
+  const char *_buffer_new;
+  PN_uint32 _new_start;
+  PN_uint32 _scan_length;
+  PN_uint32 _data_length;
+  pvector<Matches> _matches;
+
+  size_t _next_region;
+  size_t _num_done;
+
+  // Protects _next_region and _num_done.
+  MutexImpl _lock;
+  WorkerThreadGroup _threads;
+};
+
+const PN_uint32 Patchfile::MatchJob::_region_length = 0x400000;
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::MatchJob::Constructor
+//       Access: Public
+//  Description: Prepares to search the scan_length bytes of the new
+//               file beginning at new_start, which must be a
+//               multiple of _region_length.  buffer_new holds the
+//               data_length bytes of the new file beginning at
+//               new_start; this must include the region following
+//               the scanned part, if there is one.
+//
+//               Starts num_threads - 1 threads working; the calling
+//               thread joins in when it calls run().
+////////////////////////////////////////////////////////////////////
+Patchfile::MatchJob::
+MatchJob(const BlockIndex &index, const char *buffer_orig,
+         const char *buffer_new, PN_uint32 new_start,
+         PN_uint32 scan_length, PN_uint32 data_length, int num_threads) :
+  _index(index),
+  _buffer_orig(buffer_orig),
+  _buffer_new(buffer_new),
+  _new_start(new_start),
+  _scan_length(scan_length),
+  _data_length(data_length),
+  _next_region(0),
+  _num_done(0),
+  _threads(_lock)
+{
+  size_t num_regions = (scan_length + _region_length - 1) / _region_length;
+  _matches.resize(num_regions);
+
+  int num_workers = min(num_threads, (int)num_regions) - 1;
+  for (int i = 0; i < num_workers; ++i) {
+    if (!_threads.start_thread(&thread_main, this)) {
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::MatchJob::Destructor
+//       Access: Public
+//  Description: Waits for the worker threads to finish.
+////////////////////////////////////////////////////////////////////
+Patchfile::MatchJob::
+~MatchJob() {
+  _lock.acquire();
+  _next_region = _matches.size();
+  _lock.release();
+
+  _threads.join();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::MatchJob::run
+//       Access: Public
+//  Description: Searches regions in the calling thread until there
+//               are none left, then waits for the other threads to
+//               finish theirs.
+////////////////////////////////////////////////////////////////////
+void Patchfile::MatchJob::
+run() {
+  while (do_next_region()) {
+  }
+
+  _lock.acquire();
+  while (_num_done < _matches.size()) {
+    _threads.wait();
+  }
+  _lock.release();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::MatchJob::get_num_regions
+//       Access: Public
+//  Description: Returns the number of regions in the batch.
+////////////////////////////////////////////////////////////////////
+size_t Patchfile::MatchJob::
+get_num_regions() const {
+  return _matches.size();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::MatchJob::get_matches
+//       Access: Public
+//  Description: Returns the matches found in the nth region of the
+//               batch, in order, with positions relative to the
+//               start of each file.  The last of these may extend
+//               into the next region.  This may only be called after
+//               run().
+////////////////////////////////////////////////////////////////////
+const Patchfile::Matches &Patchfile::MatchJob::
+get_matches(size_t n) const {
+  nassertr(n < _matches.size(), _matches[0]);
+  return _matches[n];
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::MatchJob::do_next_region
+//       Access: Private
+//  Description: Searches the next region that nobody has started on
+//               yet.  Returns true if a region was searched, false
+//               if there were none left.
+////////////////////////////////////////////////////////////////////
+bool Patchfile::MatchJob::
+do_next_region() {
+  _lock.acquire();
+  if (_next_region >= _matches.size()) {
+    _lock.release();
+    return false;
+  }
+  size_t n = _next_region;
+  ++_next_region;
+  _lock.release();
+
+  scan_region(n);
+
+  _lock.acquire();
+  ++_num_done;
+  if (_num_done >= _matches.size()) {
+    _threads.notify_all();
+  }
+  _lock.release();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::MatchJob::scan_region
+//       Access: Private
+//  Description: Slides the rolling hash over the nth region of the
+//               batch, and records each match that begins within it.
+//               Each match is extended backwards as far as it will
+//               go, but not into the previous match or the previous
+//               region, and forwards as far as the end of the
+//               following region.
+////////////////////////////////////////////////////////////////////
+void Patchfile::MatchJob::
+scan_region(size_t n) {
+  PN_uint32 block_length = _index.get_block_length();
+  PN_uint32 start = (PN_uint32)n * _region_length;
+  PN_uint32 end = min(start + _region_length, _scan_length);
+  PN_uint32 limit = min(end + _region_length, _data_length);
+  Matches &matches = _matches[n];
+
+  if (limit - start < block_length) {
+    return;
+  }
+
+  PN_uint32 lower = start;
+  PN_uint32 pos = start;
+  PN_uint32 hash = _index.hash_block(_buffer_new + pos);
+  while (true) {
+    PN_uint32 orig_pos, length;
+    if (_index.find_match(hash, _buffer_new + pos, limit - pos, orig_pos, length)) {
+      PN_uint32 back = 0;
+      while (pos - back > lower && orig_pos - back > 0 &&
+             _buffer_new[pos - back - 1] == _buffer_orig[orig_pos - back - 1]) {
+        ++back;
+      }
+      Match match;
+      match._new_pos = _new_start + pos - back;
+      match._orig_pos = orig_pos - back;
+      match._length = length + back;
+      matches.push_back(match);
+
+      pos += length;
+      lower = pos;
+      if (pos >= end || limit - pos < block_length) {
+        return;
+      }
+      hash = _index.hash_block(_buffer_new + pos);
+
+    } else {
+      if (pos + 1 >= end || limit - pos <= block_length) {
+        return;
+      }
+      hash = _index.roll_hash(hash, _buffer_new[pos],
+                              _buffer_new[pos + block_length]);
+      ++pos;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::MatchJob::thread_main
+//       Access: Private, Static
+//  Description: The entry point for each worker thread.
+////////////////////////////////////////////////////////////////////
+void Patchfile::MatchJob::
+thread_main(void *data) {
+  MatchJob *self = (MatchJob *)data;
+  while (self->do_next_region()) {
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: Patchfile::compute_rolling_hash_patches
+//       Access: Private
+//  Description: The BM_rolling_hash equivalent of
+//               compute_file_patches().  The original file is read
+//               into memory and indexed with a BlockIndex; the new
+//               file is then read a batch of regions at a time, and
+//               searched with a MatchJob.
+//
+//               Returns true if successful, false on error.
+////////////////////////////////////////////////////////////////////
+bool Patchfile::
+compute_rolling_hash_patches(ostream &write_stream, PN_uint32 offset_orig,
+                             istream &stream_orig, istream &stream_new) {
+  // The number of regions read from the new file at a time, not
+  // counting the extra region needed to finish the last matches.
+  static const PN_uint32 batch_regions = 16;
+  static const PN_uint32 batch_length = batch_regions * MatchJob::_region_length;
+
+  stream_orig.seekg(0, ios::end);
+  nassertr(stream_orig, false);
+  PN_uint32 length_orig = stream_orig.tellg();
+  if (express_cat.is_debug()) {
+    express_cat.debug()
+      << "Allocating " << length_orig << " bytes to read orig\n";
+  }
+
+  char *buffer_orig = (char *)PANDA_MALLOC_ARRAY(length_orig);
+  stream_orig.seekg(0, ios::beg);
+  stream_orig.read(buffer_orig, length_orig);
+
+  stream_new.seekg(0, ios::end);
+  nassertr(stream_new, false);
+  PN_uint32 length_new = stream_new.tellg();
+
+  BlockIndex index(buffer_orig, length_orig, _block_length);
+
+  PN_uint32 buffer_length = min(length_new, batch_length + MatchJob::_region_length);
+  char *buffer_new = (char *)PANDA_MALLOC_ARRAY(max(buffer_length, (PN_uint32)1));
+
+  // start_pos is the first byte of the new file that has not yet
+  // been covered by an ADD or COPY.
+  PN_uint32 start_pos = 0;
+  for (PN_uint32 batch_start = 0; batch_start < length_new;
+       batch_start += batch_length) {
+    PN_uint32 scan_length = min(batch_length, length_new - batch_start);
+    PN_uint32 data_length = min(buffer_length, length_new - batch_start);
+    stream_new.seekg(batch_start, ios::beg);
+    stream_new.read(buffer_new, data_length);
+    if (stream_new.gcount() != (streamsize)data_length) {
+      express_cat.error()
+        << "Unable to read new file\n";
+      PANDA_FREE_ARRAY(buffer_new);
+      PANDA_FREE_ARRAY(buffer_orig);
+      return false;
+    }
+
+    MatchJob job(index, buffer_orig, buffer_new, batch_start,
+                 scan_length, data_length, _build_threads);
+    job.run();
+
+    // Now walk through the matches in order.  A match that runs off
+    // the end of its region may overlap the first few matches of the
+    // next region; these are trimmed to begin where it ends.
+    for (size_t r = 0; r < job.get_num_regions(); ++r) {
+      const Matches &matches = job.get_matches(r);
+      Matches::const_iterator mi;
+      for (mi = matches.begin(); mi != matches.end(); ++mi) {
+        Match match = (*mi);
+        if (match._new_pos < start_pos) {
+          PN_uint32 overlap = start_pos - match._new_pos;
+          if (overlap >= match._length) {
+            continue;
+          }
+          match._new_pos += overlap;
+          match._orig_pos += overlap;
+          match._length -= overlap;
+        }
+        if (match._length < index.get_block_length()) {
+          // Not worth a COPY; leave it in the ADD.
+          continue;
+        }
+
+        cache_add_and_copy(write_stream, match._new_pos - start_pos,
+                           &buffer_new[start_pos - batch_start],
+                           match._length, match._orig_pos + offset_orig);
+        start_pos = match._new_pos + match._length;
+      }
+    }
+
+    // Anything left over up to the end of this batch must be added
+    // now, while we still have it in memory.
+    PN_uint32 batch_end = batch_start + scan_length;
+    if (start_pos < batch_end) {
+      cache_add_and_copy(write_stream, batch_end - start_pos,
+                         &buffer_new[start_pos - batch_start], 0, 0);
+      start_pos = batch_end;
+    }
+  }
+
+  PANDA_FREE_ARRAY(buffer_new);
+  PANDA_FREE_ARRAY(buffer_orig);
+
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Patchfile::emit_ADD
 //       Access: Private
@@ -1051,6 +1639,11 @@ bool Patchfile::
 compute_file_patches(ostream &write_stream,
                      PN_uint32 offset_orig, PN_uint32 offset_new,
                      istream &stream_orig, istream &stream_new) {
+  if (_build_mode == BM_rolling_hash) {
+    return compute_rolling_hash_patches(write_stream, offset_orig,
+                                        stream_orig, stream_new);
+  }
+
   // read in original file
   stream_orig.seekg(0, ios::end);
   nassertr(stream_orig, false);
@@ -30,6 +30,7 @@
 #include "hashVal.h" // MD5 stuff
 #include "ordered_vector.h"
 #include "streamWrapper.h"
+#include "pvector.h"
 
 #include <algorithm>
 
@@ -44,6 +45,11 @@ PUBLISHED:
   Patchfile(PT(Buffer) buffer);
   ~Patchfile();
 
+  enum BuildMode {
+    BM_footprint,
+    BM_rolling_hash,
+  };
+
   bool build(Filename file_orig, Filename file_new, Filename patch_name);
   int read_header(const Filename &patch_file);
 
@@ -65,6 +71,15 @@ PUBLISHED:
   INLINE int get_footprint_length();
   INLINE void reset_footprint_length();
 
+  INLINE void set_build_mode(BuildMode build_mode);
+  INLINE BuildMode get_build_mode() const;
+
+  INLINE void set_block_length(int length);
+  INLINE int get_block_length() const;
+
+  INLINE void set_build_threads(int build_threads);
+  INLINE int get_build_threads() const;
+
   INLINE bool has_source_hash() const;
   INLINE const HashVal &get_source_hash() const;
   INLINE const HashVal &get_result_hash() const;
@@ -85,6 +100,20 @@ private:
   PN_uint32 calc_match_length(const char* buf1, const char* buf2, PN_uint32 max_length,
     PN_uint32 min_length);
 
+  class Match {
+  public:
+    PN_uint32 _new_pos;
+    PN_uint32 _orig_pos;
+    PN_uint32 _length;
+  };
+  typedef pvector<Match> Matches;
+
+  class BlockIndex;
+  class MatchJob;
+
+  bool compute_rolling_hash_patches(ostream &write_stream, PN_uint32 offset_orig,
+                                    istream &stream_orig, istream &stream_new);
+
   void emit_ADD(ostream &write_stream, PN_uint32 length, const char* buffer);
   void emit_COPY(ostream &write_stream, PN_uint32 length, PN_uint32 COPY_pos);
   void emit_add_and_copy(ostream &write_stream, 
@@ -155,6 +184,9 @@ private:
 
   bool _allow_multifile;
   PN_uint32 _footprint_length;
+  BuildMode _build_mode;
+  PN_uint32 _block_length;
+  int _build_threads;
 
   PN_uint32 *_hash_table;
 
@@ -193,6 +225,9 @@ private:
   static const PN_uint32 _v0_magic_number;
   static const PN_uint32 _magic_number;
   static const PN_uint16 _current_version;
+
+  friend class BlockIndex;
+  friend class MatchJob;
 };
 
 #include "patchfile.I"
@@ -0,0 +1,78 @@
+// Filename: streamCodec.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "streamCodec.h"
+#include "streamCodecZlib.h"
+#include "streamCodecLZ.h"
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodec::Destructor
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+StreamCodec::
+~StreamCodec() {
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodec::make_codec
+//       Access: Public, Static
+//  Description: Returns a newly-allocated StreamCodec for the
+//               indicated format, or NULL if the format is not
+//               available in this build.  The caller must delete
+//               the codec when it is done with it.
+////////////////////////////////////////////////////////////////////
+StreamCodec *StreamCodec::
+make_codec(CompressionCodec codec) {
+  switch (codec) {
+  case CC_zlib:
+#ifdef HAVE_ZLIB
+    return new StreamCodecZlib;
+#else
+    return NULL;
+#endif
+
+  case CC_lz:
+    return new StreamCodecLZ;
+
+  case CC_invalid:
+    break;
+  }
+
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodec::detect_codec
+//       Access: Public, Static
+//  Description: Given the first few bytes of a compressed stream (up
+//               to max_header_size bytes, or fewer if the stream is
+//               shorter than that), returns a newly-allocated
+//               StreamCodec that can read it, or NULL if no codec
+//               recognizes it.
+////////////////////////////////////////////////////////////////////
+StreamCodec *StreamCodec::
+detect_codec(const char *header, size_t size) {
+  for (int ci = 0; ci < (int)CC_invalid; ++ci) {
+    StreamCodec *codec = make_codec((CompressionCodec)ci);
+    if (codec != (StreamCodec *)NULL) {
+      if (codec->matches_header(header, size)) {
+        return codec;
+      }
+      delete codec;
+    }
+  }
+
+  return NULL;
+}
@@ -0,0 +1,67 @@
+// Filename: streamCodec.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef STREAMCODEC_H
+#define STREAMCODEC_H
+
+#include "pandabase.h"
+#include "compressionCodec.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : StreamCodec
+// Description : The abstract interface to one of the compression
+//               formats named by CompressionCodec.  ZStreamBuf
+//               handles the buffering for IDecompressStream and
+//               OCompressStream, and hands the data to a StreamCodec
+//               to be compressed or decompressed.
+//
+//               A StreamCodec is used either for reading or for
+//               writing one stream at a time.  A new codec is added
+//               by giving it a CompressionCodec value, deriving a
+//               class from this one, and creating it in
+//               make_codec().
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS StreamCodec {
+public:
+  virtual ~StreamCodec();
+
+  enum FlushMode {
+    FM_none,    // Compress the data whenever it is convenient.
+    FM_sync,    // Write everything so far, so it can be read back.
+    FM_finish,  // As FM_sync; no more data will follow.
+  };
+
+  enum {
+    // The number of bytes at the start of a stream that
+    // detect_codec() examines.
+    max_header_size = 4
+  };
+
+  virtual CompressionCodec get_codec() const=0;
+
+  virtual bool matches_header(const char *header, size_t size) const=0;
+  virtual bool open_read(istream *source, const char *header, size_t size)=0;
+  virtual size_t read_chars(char *start, size_t length)=0;
+  virtual void close_read()=0;
+
+  virtual bool open_write(ostream *dest, int compression_level)=0;
+  virtual void write_chars(const char *start, size_t length,
+                           FlushMode flush)=0;
+  virtual void close_write()=0;
+
+  static StreamCodec *make_codec(CompressionCodec codec);
+  static StreamCodec *detect_codec(const char *header, size_t size);
+};
+
+#endif
@@ -0,0 +1,322 @@
+// Filename: streamCodecLZ.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "streamCodecLZ.h"
+#include "config_express.h"
+
+// This begins a stream written in the CC_lz format.  The low nibble
+// of the first byte of a zlib stream is always 8, so this can't be
+// mistaken for one.
+static const char lz_magic[] = "plz\001";
+static const size_t lz_magic_size = 4;
+
+// The high bit of a block header indicates that the block is stored
+// without compression.
+static const PN_uint32 lz_stored_bit = 0x80000000U;
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+StreamCodecLZ::
+StreamCodecLZ() {
+  _source = (istream *)NULL;
+  _dest = (ostream *)NULL;
+  _lz = (LZCompressor *)NULL;
+  _pos = 0;
+  _eof = false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::Destructor
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+StreamCodecLZ::
+~StreamCodecLZ() {
+  close_read();
+  close_write();
+  delete _lz;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::get_codec
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+CompressionCodec StreamCodecLZ::
+get_codec() const {
+  return CC_lz;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::matches_header
+//       Access: Public, Virtual
+//  Description: Returns true if the bytes begin with the CC_lz magic
+//               number.
+////////////////////////////////////////////////////////////////////
+bool StreamCodecLZ::
+matches_header(const char *header, size_t size) const {
+  return (size >= lz_magic_size &&
+          memcmp(header, lz_magic, lz_magic_size) == 0);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::open_read
+//       Access: Public, Virtual
+//  Description: Prepares to decompress the source stream.  The
+//               indicated bytes, which have already been read from
+//               the source, must be the magic number.
+////////////////////////////////////////////////////////////////////
+bool StreamCodecLZ::
+open_read(istream *source, const char *header, size_t size) {
+  nassertr(matches_header(header, size) && size == lz_magic_size, false);
+  _source = source;
+  _data.clear();
+  _pos = 0;
+  _eof = false;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::read_chars
+//       Access: Public, Virtual
+//  Description: Copies up to length bytes of uncompressed data into
+//               start, decompressing more blocks as needed.  Returns
+//               the number of bytes produced.
+////////////////////////////////////////////////////////////////////
+size_t StreamCodecLZ::
+read_chars(char *start, size_t length) {
+  nassertr(_source != (istream *)NULL, 0);
+  size_t bytes_read = 0;
+  while (bytes_read < length) {
+    if (_pos >= _data.size()) {
+      if (!read_block()) {
+        break;
+      }
+      continue;
+    }
+
+    size_t count = min(length - bytes_read, _data.size() - _pos);
+    memcpy(start + bytes_read, &_data[_pos], count);
+    _pos += count;
+    bytes_read += count;
+  }
+
+  return bytes_read;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::close_read
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+void StreamCodecLZ::
+close_read() {
+  _source = (istream *)NULL;
+  _data.clear();
+  _block.clear();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::open_write
+//       Access: Public, Virtual
+//  Description: Writes the magic number to the dest stream.  The
+//               compression level is ignored; LZCompressor has only
+//               one setting.
+////////////////////////////////////////////////////////////////////
+bool StreamCodecLZ::
+open_write(ostream *dest, int compression_level) {
+  _dest = dest;
+  if (_lz == (LZCompressor *)NULL) {
+    _lz = new LZCompressor;
+  }
+  _data.clear();
+  _dest->write(lz_magic, lz_magic_size);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::write_chars
+//       Access: Public, Virtual
+//  Description: The data is collected into blocks of
+//               LZCompressor::max_block_size bytes.  Unless flush is
+//               FM_none, a partial block is written out as well.
+////////////////////////////////////////////////////////////////////
+void StreamCodecLZ::
+write_chars(const char *start, size_t length, FlushMode flush) {
+  nassertv(_dest != (ostream *)NULL);
+  while (length != 0) {
+    size_t count = min(length, LZCompressor::max_block_size - _data.size());
+    _data.insert(_data.end(), (const unsigned char *)start,
+                 (const unsigned char *)start + count);
+    start += count;
+    length -= count;
+
+    if (_data.size() >= LZCompressor::max_block_size) {
+      write_block();
+    }
+  }
+
+  if (flush != FM_none) {
+    write_block();
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::close_write
+//       Access: Public, Virtual
+//  Description: Writes the end-of-stream marker.  The caller should
+//               already have written the last data with FM_finish.
+////////////////////////////////////////////////////////////////////
+void StreamCodecLZ::
+close_write() {
+  if (_dest != (ostream *)NULL) {
+    write_block();
+
+    // A zero word marks the end of the stream.
+    static const char end_block[4] = { 0, 0, 0, 0 };
+    _dest->write(end_block, 4);
+    _dest = (ostream *)NULL;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::read_block
+//       Access: Private
+//  Description: Reads and decompresses the next block from the
+//               source stream into _data.  Returns true on success,
+//               or false at the end of the stream or on error.
+////////////////////////////////////////////////////////////////////
+bool StreamCodecLZ::
+read_block() {
+  _data.clear();
+  _pos = 0;
+  if (_eof) {
+    return false;
+  }
+
+  unsigned char header[8];
+  _source->read((char *)header, 4);
+  if (_source->gcount() != 4) {
+    express_cat.warning()
+      << "Unexpected end of compressed stream.\n";
+    _eof = true;
+    return false;
+  }
+  PN_uint32 word = (header[0] | (header[1] << 8) | (header[2] << 16) |
+                    ((PN_uint32)header[3] << 24));
+  if (word == 0) {
+    // This is the end of the stream.
+    _eof = true;
+    return false;
+  }
+
+  if ((word & lz_stored_bit) != 0) {
+    // This block was stored uncompressed.  The writer never writes an
+    // empty block.
+    size_t size = word & ~lz_stored_bit;
+    if (size == 0 || size > LZCompressor::max_block_size) {
+      express_cat.warning()
+        << "Invalid block in compressed stream.\n";
+      _eof = true;
+      return false;
+    }
+    _data.resize(size);
+    _source->read((char *)&_data[0], size);
+    if ((size_t)_source->gcount() != size) {
+      express_cat.warning()
+        << "Unexpected end of compressed stream.\n";
+      _data.resize(_source->gcount());
+      _eof = true;
+    }
+    return !_data.empty();
+  }
+
+  // Otherwise, the compressed length, which we know is nonzero, is
+  // followed by the uncompressed length.
+  size_t compressed_size = word;
+  _source->read((char *)header + 4, 4);
+  size_t size = (header[4] | (header[5] << 8) | (header[6] << 16) |
+                 ((PN_uint32)header[7] << 24));
+  if (_source->gcount() != 4 || size == 0 ||
+      size > LZCompressor::max_block_size ||
+      compressed_size > LZCompressor::get_max_compressed_size(size)) {
+    express_cat.warning()
+      << "Invalid block in compressed stream.\n";
+    _eof = true;
+    return false;
+  }
+
+  _block.resize(compressed_size);
+  _source->read((char *)&_block[0], compressed_size);
+  _data.resize(size);
+  if ((size_t)_source->gcount() != compressed_size ||
+      LZCompressor::decompress(&_block[0], compressed_size,
+                               &_data[0], size) != size) {
+    express_cat.warning()
+      << "Invalid block in compressed stream.\n";
+    _data.clear();
+    _eof = true;
+    return false;
+  }
+  thread_consider_yield();
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecLZ::write_block
+//       Access: Private
+//  Description: Compresses the data in _data, if any, and writes it
+//               to the dest stream as one block.
+////////////////////////////////////////////////////////////////////
+void StreamCodecLZ::
+write_block() {
+  size_t size = _data.size();
+  if (size == 0) {
+    return;
+  }
+
+  _block.resize(LZCompressor::get_max_compressed_size(size));
+  size_t compressed_size = _lz->compress(&_data[0], size, &_block[0]);
+
+  unsigned char header[8];
+  if (compressed_size >= size) {
+    // It didn't get any smaller; store it as it is.
+    PN_uint32 word = (PN_uint32)size | lz_stored_bit;
+    header[0] = (unsigned char)(word);
+    header[1] = (unsigned char)(word >> 8);
+    header[2] = (unsigned char)(word >> 16);
+    header[3] = (unsigned char)(word >> 24);
+    _dest->write((const char *)header, 4);
+    _dest->write((const char *)&_data[0], size);
+
+  } else {
+    header[0] = (unsigned char)(compressed_size);
+    header[1] = (unsigned char)(compressed_size >> 8);
+    header[2] = (unsigned char)(compressed_size >> 16);
+    header[3] = (unsigned char)(compressed_size >> 24);
+    header[4] = (unsigned char)(size);
+    header[5] = (unsigned char)(size >> 8);
+    header[6] = (unsigned char)(size >> 16);
+    header[7] = (unsigned char)(size >> 24);
+    _dest->write((const char *)header, 8);
+    _dest->write((const char *)&_block[0], compressed_size);
+  }
+
+  _data.clear();
+  thread_consider_yield();
+}
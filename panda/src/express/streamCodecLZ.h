@@ -0,0 +1,77 @@
+// Filename: streamCodecLZ.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef STREAMCODECLZ_H
+#define STREAMCODECLZ_H
+
+#include "pandabase.h"
+#include "streamCodec.h"
+#include "lzCompressor.h"
+#include "pvector.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : StreamCodecLZ
+// Description : The StreamCodec for CC_lz.
+//
+//               The stream begins with the four-byte magic number
+//               "plz\001", followed by a series of blocks, each of
+//               at most LZCompressor::max_block_size bytes of
+//               uncompressed data.  Each block begins with a
+//               little-endian 32-bit word.  If the high bit is set,
+//               the remaining bits give the length of the data that
+//               follows, stored without compression.  Otherwise the
+//               word gives the compressed length, and is followed by
+//               a second word giving the uncompressed length, and
+//               then by the data compressed by LZCompressor.  A zero
+//               word ends the stream.
+//
+//               The compressed data in each block is in the LZ4
+//               block format, but this framing is Panda's own; it is
+//               not the LZ4 frame format, and the lz4 tools cannot
+//               read these streams directly.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS StreamCodecLZ : public StreamCodec {
+public:
+  StreamCodecLZ();
+  virtual ~StreamCodecLZ();
+
+  virtual CompressionCodec get_codec() const;
+
+  virtual bool matches_header(const char *header, size_t size) const;
+  virtual bool open_read(istream *source, const char *header, size_t size);
+  virtual size_t read_chars(char *start, size_t length);
+  virtual void close_read();
+
+  virtual bool open_write(ostream *dest, int compression_level);
+  virtual void write_chars(const char *start, size_t length,
+                           FlushMode flush);
+  virtual void close_write();
+
+private:
+  bool read_block();
+  void write_block();
+
+  istream *_source;
+  ostream *_dest;
+
+  // The uncompressed data of the current block, and its compressed
+  // form.
+  LZCompressor *_lz;
+  pvector<unsigned char> _data;
+  pvector<unsigned char> _block;
+  size_t _pos;
+  bool _eof;
+};
+
+#endif
@@ -0,0 +1,343 @@
+// Filename: streamCodecZlib.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "streamCodecZlib.h"
+
+#ifdef HAVE_ZLIB
+
+#include "pnotify.h"
+#include "config_express.h"
+
+#if !defined(USE_MEMORY_NOWRAPPERS)
+// Define functions that hook zlib into panda's memory allocation system.
+static void *
+do_zlib_alloc(voidpf opaque, uInt items, uInt size) {
+  return PANDA_MALLOC_ARRAY(items * size);
+}
+static void
+do_zlib_free(voidpf opaque, voidpf address) {
+  PANDA_FREE_ARRAY(address);
+}
+#endif  //  !USE_MEMORY_NOWRAPPERS
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+StreamCodecZlib::
+StreamCodecZlib() {
+  _source = (istream *)NULL;
+  _dest = (ostream *)NULL;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::Destructor
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+StreamCodecZlib::
+~StreamCodecZlib() {
+  close_read();
+  close_write();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::get_codec
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+CompressionCodec StreamCodecZlib::
+get_codec() const {
+  return CC_zlib;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::matches_header
+//       Access: Public, Virtual
+//  Description: Returns true if the bytes look like the beginning of
+//               a zlib stream: the compression method is deflate,
+//               and the two header bytes are a multiple of 31.
+////////////////////////////////////////////////////////////////////
+bool StreamCodecZlib::
+matches_header(const char *header, size_t size) const {
+  if (size < 2) {
+    return false;
+  }
+  unsigned int cmf = (unsigned char)header[0];
+  unsigned int flg = (unsigned char)header[1];
+  return ((cmf & 0x0f) == Z_DEFLATED && (cmf >> 4) <= 7 &&
+          (cmf * 256 + flg) % 31 == 0);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::open_read
+//       Access: Public, Virtual
+//  Description: Prepares to decompress the source stream.  The
+//               indicated bytes have already been read from the
+//               beginning of the stream; they are decompressed
+//               first.
+////////////////////////////////////////////////////////////////////
+bool StreamCodecZlib::
+open_read(istream *source, const char *header, size_t size) {
+  nassertr(size <= decompress_buffer_size, false);
+  _source = source;
+
+  memcpy(decompress_buffer, header, size);
+  _z_source.next_in = (Bytef *)decompress_buffer;
+  _z_source.avail_in = size;
+  _z_source.next_out = Z_NULL;
+  _z_source.avail_out = 0;
+#ifdef USE_MEMORY_NOWRAPPERS
+  _z_source.zalloc = Z_NULL;
+  _z_source.zfree = Z_NULL;
+#else
+  _z_source.zalloc = (alloc_func)&do_zlib_alloc;
+  _z_source.zfree = (free_func)&do_zlib_free;
+#endif
+  _z_source.opaque = Z_NULL;
+  _z_source.msg = (char *)"no error message";
+
+  int result = inflateInit(&_z_source);
+  thread_consider_yield();
+  if (result < 0) {
+    show_zlib_error("inflateInit", result, _z_source);
+    _source = (istream *)NULL;
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::read_chars
+//       Access: Public, Virtual
+//  Description: Decompresses up to length bytes into start.  Returns
+//               the number of bytes produced, which is less than
+//               length only at the end of the stream or on error.
+////////////////////////////////////////////////////////////////////
+size_t StreamCodecZlib::
+read_chars(char *start, size_t length) {
+  nassertr(_source != (istream *)NULL, 0);
+  _z_source.next_out = (Bytef *)start;
+  _z_source.avail_out = length;
+
+  bool eof = (_source->eof() || _source->fail());
+  int flush = 0;
+
+  while (_z_source.avail_out > 0) {
+    if (_z_source.avail_in == 0 && !eof) {
+      _source->read(decompress_buffer, decompress_buffer_size);
+      size_t read_count = _source->gcount();
+      eof = (read_count == 0 || _source->eof() || _source->fail());
+
+      _z_source.next_in = (Bytef *)decompress_buffer;
+      _z_source.avail_in = read_count;
+    }
+    int result = inflate(&_z_source, flush);
+    thread_consider_yield();
+    size_t bytes_read = length - _z_source.avail_out;
+
+    if (result == Z_STREAM_END) {
+      // Here's the end of the file.
+      return bytes_read;
+
+    } else if (result == Z_BUF_ERROR && flush == 0) {
+      // We might get this if no progress is possible, for instance if
+      // the input stream is truncated.  In this case, tell zlib to
+      // dump everything it's got.
+      flush = Z_FINISH;
+
+    } else if (result < 0) {
+      show_zlib_error("inflate", result, _z_source);
+      return bytes_read;
+    }
+  }
+
+  return length;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::close_read
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+void StreamCodecZlib::
+close_read() {
+  if (_source != (istream *)NULL) {
+    int result = inflateEnd(&_z_source);
+    if (result < 0) {
+      show_zlib_error("inflateEnd", result, _z_source);
+    }
+    thread_consider_yield();
+    _source = (istream *)NULL;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::open_write
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+bool StreamCodecZlib::
+open_write(ostream *dest, int compression_level) {
+  _dest = dest;
+
+  _z_dest.next_in = Z_NULL;
+  _z_dest.avail_in = 0;
+  _z_dest.next_out = Z_NULL;
+  _z_dest.avail_out = 0;
+#ifdef USE_MEMORY_NOWRAPPERS
+  _z_dest.zalloc = Z_NULL;
+  _z_dest.zfree = Z_NULL;
+#else
+  _z_dest.zalloc = (alloc_func)&do_zlib_alloc;
+  _z_dest.zfree = (free_func)&do_zlib_free;
+#endif
+  _z_dest.opaque = Z_NULL;
+  _z_dest.msg = (char *)"no error message";
+
+  int result = deflateInit(&_z_dest, compression_level);
+  thread_consider_yield();
+  if (result < 0) {
+    show_zlib_error("deflateInit", result, _z_dest);
+    _dest = (ostream *)NULL;
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::write_chars
+//       Access: Public, Virtual
+//  Description: Compresses the indicated bytes to the dest stream.
+////////////////////////////////////////////////////////////////////
+void StreamCodecZlib::
+write_chars(const char *start, size_t length, FlushMode flush_mode) {
+  nassertv(_dest != (ostream *)NULL);
+  int flush = 0;
+  if (flush_mode == FM_sync) {
+    flush = Z_SYNC_FLUSH;
+  } else if (flush_mode == FM_finish) {
+    flush = Z_FINISH;
+  }
+
+  static const size_t compress_buffer_size = 4096;
+  char compress_buffer[compress_buffer_size];
+
+  _z_dest.next_in = (Bytef *)(char *)start;
+  _z_dest.avail_in = length;
+
+  _z_dest.next_out = (Bytef *)compress_buffer;
+  _z_dest.avail_out = compress_buffer_size;
+
+  int result = deflate(&_z_dest, flush);
+  if (result < 0 && result != Z_BUF_ERROR) {
+    show_zlib_error("deflate", result, _z_dest);
+  }
+  thread_consider_yield();
+
+  while (_z_dest.avail_in != 0) {
+    if (_z_dest.avail_out != compress_buffer_size) {
+      _dest->write(compress_buffer, compress_buffer_size - _z_dest.avail_out);
+      _z_dest.next_out = (Bytef *)compress_buffer;
+      _z_dest.avail_out = compress_buffer_size;
+    }
+    result = deflate(&_z_dest, flush);
+    if (result < 0) {
+      show_zlib_error("deflate", result, _z_dest);
+    }
+    thread_consider_yield();
+  }
+
+  while (_z_dest.avail_out != compress_buffer_size) {
+    _dest->write(compress_buffer, compress_buffer_size - _z_dest.avail_out);
+    _z_dest.next_out = (Bytef *)compress_buffer;
+    _z_dest.avail_out = compress_buffer_size;
+    result = deflate(&_z_dest, flush);
+    if (result < 0 && result != Z_BUF_ERROR) {
+      show_zlib_error("deflate", result, _z_dest);
+    }
+    thread_consider_yield();
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::close_write
+//       Access: Public, Virtual
+//  Description: Finishes the stream.  The caller should already have
+//               written the last data with FM_finish.
+////////////////////////////////////////////////////////////////////
+void StreamCodecZlib::
+close_write() {
+  if (_dest != (ostream *)NULL) {
+    int result = deflateEnd(&_z_dest);
+    if (result < 0) {
+      show_zlib_error("deflateEnd", result, _z_dest);
+    }
+    thread_consider_yield();
+    _dest = (ostream *)NULL;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamCodecZlib::show_zlib_error
+//       Access: Private
+//  Description: Reports a recent error code returned by zlib.
+////////////////////////////////////////////////////////////////////
+void StreamCodecZlib::
+show_zlib_error(const char *function, int error_code, z_stream &z) {
+  stringstream error_line;
+
+  error_line
+    << "zlib error in " << function << ": ";
+  switch (error_code) {
+  case Z_OK:
+    error_line << "Z_OK";
+    break;
+  case Z_STREAM_END:
+    error_line << "Z_STREAM_END";
+    break;
+  case Z_NEED_DICT:
+    error_line << "Z_NEED_DICT";
+    break;
+  case Z_ERRNO:
+    error_line << "Z_ERRNO";
+    break;
+  case Z_STREAM_ERROR:
+    error_line << "Z_STREAM_ERROR";
+    break;
+  case Z_DATA_ERROR:
+    error_line << "Z_DATA_ERROR";
+    break;
+  case Z_MEM_ERROR:
+    error_line << "Z_MEM_ERROR";
+    break;
+  case Z_BUF_ERROR:
+    error_line << "Z_BUF_ERROR";
+    break;
+  case Z_VERSION_ERROR:
+    error_line << "Z_VERSION_ERROR";
+    break;
+  default:
+    error_line << error_code;
+  }
+  if (z.msg != (char *)NULL) {
+    error_line
+      << " = " << z.msg;
+  }
+
+  express_cat.warning() << error_line.str() << "\n";
+}
+
+#endif  // HAVE_ZLIB
@@ -0,0 +1,75 @@
+// Filename: streamCodecZlib.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef STREAMCODECZLIB_H
+#define STREAMCODECZLIB_H
+
+#include "pandabase.h"
+
+// This module is not compiled if zlib is not available.
+#ifdef HAVE_ZLIB
+
+#include "streamCodec.h"
+
+#include <zlib.h>
+
+////////////////////////////////////////////////////////////////////
+//       Class : StreamCodecZlib
+// Description : The StreamCodec for CC_zlib: the standard zlib
+//               deflate format.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS StreamCodecZlib : public StreamCodec {
+public:
+  StreamCodecZlib();
+  virtual ~StreamCodecZlib();
+
+  virtual CompressionCodec get_codec() const;
+
+  virtual bool matches_header(const char *header, size_t size) const;
+  virtual bool open_read(istream *source, const char *header, size_t size);
+  virtual size_t read_chars(char *start, size_t length);
+  virtual void close_read();
+
+  virtual bool open_write(ostream *dest, int compression_level);
+  virtual void write_chars(const char *start, size_t length,
+                           FlushMode flush);
+  virtual void close_write();
+
+private:
+  void show_zlib_error(const char *function, int error_code, z_stream &z);
+
+  istream *_source;
+  ostream *_dest;
+
+  z_stream _z_source;
+  z_stream _z_dest;
+
+  // We need to store the decompression buffer on the class object,
+  // because zlib might not consume all of the input characters at
+  // each call to inflate().  This isn't a problem on output because
+  // in that case we can afford to wait until it does consume all of
+  // the characters we give it.
+  enum {
+    // It's not clear how large or small this buffer ought to be.  It
+    // doesn't seem to matter much, especially since this is just a
+    // temporary holding area before getting copied into zlib's own
+    // internal buffers.
+    decompress_buffer_size = 128
+  };
+  char decompress_buffer[decompress_buffer_size];
+};
+
+#endif  // HAVE_ZLIB
+
+#endif
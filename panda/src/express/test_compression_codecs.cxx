@@ -0,0 +1,103 @@
+// Filename: test_compression_codecs.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "compress_string.h"
+#include "compressionCodec.h"
+#include "virtualFileSystem.h"
+#include "trueClock.h"
+#include "filename.h"
+
+// This program reads the files named on the command line (for
+// instance, a set of egg, bam and texture files), and compresses all
+// of their contents with each of the available codecs.  It reports
+// the resulting compression ratio, and the compression and
+// decompression speed in megabytes of uncompressed data per second.
+
+static const int min_repeats = 3;
+static const double min_time = 0.5;
+
+static void
+run_codec(const pvector<string> &files, size_t total_size,
+          CompressionCodec codec, int level) {
+  TrueClock *clock = TrueClock::get_global_ptr();
+
+  pvector<string> compressed;
+  size_t compressed_size = 0;
+  double start = clock->get_short_time();
+  for (size_t i = 0; i < files.size(); ++i) {
+    compressed.push_back(compress_string(files[i], level, codec));
+    compressed_size += compressed.back().size();
+  }
+  double compress_time = clock->get_short_time() - start;
+
+  // Decompress several times, to get a measurable time.
+  int repeats = 0;
+  bool ok = true;
+  start = clock->get_short_time();
+  double elapsed = 0.0;
+  while (repeats < min_repeats || elapsed < min_time) {
+    for (size_t i = 0; i < compressed.size(); ++i) {
+      string result = decompress_string(compressed[i]);
+      if (result.size() != files[i].size()) {
+        ok = false;
+      }
+    }
+    ++repeats;
+    elapsed = clock->get_short_time() - start;
+  }
+  double decompress_time = elapsed / repeats;
+
+  double mb = (double)total_size / (1024.0 * 1024.0);
+  cout << codec;
+  if (codec == CC_zlib) {
+    cout << " -" << level;
+  }
+  cout << ": " << 100.0 * compressed_size / max(total_size, (size_t)1) << "% of original, "
+       << "compress " << mb / compress_time << " MB/s, "
+       << "decompress " << mb / decompress_time << " MB/s";
+  if (!ok) {
+    cout << " (MISMATCH)";
+  }
+  cout << "\n";
+}
+
+int
+main(int argc, char *argv[]) {
+  if (argc < 2) {
+    cerr << "test_compression_codecs file [file ...]\n";
+    return 1;
+  }
+
+  VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
+  pvector<string> files;
+  size_t total_size = 0;
+  for (int i = 1; i < argc; ++i) {
+    Filename filename = Filename::binary_filename(Filename::from_os_specific(argv[i]));
+    string data;
+    if (!vfs->read_file(filename, data, true)) {
+      cerr << "Unable to read " << filename << "\n";
+      return 1;
+    }
+    total_size += data.size();
+    files.push_back(data);
+  }
+
+  cout << files.size() << " files, " << total_size << " bytes\n";
+  run_codec(files, total_size, CC_zlib, 1);
+  run_codec(files, total_size, CC_zlib, 6);
+  run_codec(files, total_size, CC_zlib, 9);
+  run_codec(files, total_size, CC_lz, 6);
+  return 0;
+}
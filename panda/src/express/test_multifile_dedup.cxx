@@ -0,0 +1,154 @@
+// Filename: test_multifile_dedup.cxx
+// Created by:  agent (19Oct26)
+//
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "multifile.h"
+#include "pvector.h"
+
+#include <stdlib.h>
+
+// This program builds a Multifile in which many subfiles have the
+// same contents under different names, as happens with shared
+// textures and sounds, once with set_deduplicate() and once without.
+// It reports the resulting file sizes, and checks that the shared
+// data is read back correctly and survives adding more subfiles
+// later and a repack().
+
+static const int num_unique = 20;
+static const int copies = 5;
+
+static string
+make_contents(int i) {
+  string data;
+  unsigned int seed = i + 1;
+  int size = 20000 + i * 1000;
+  data.reserve(size);
+  while ((int)data.size() < size) {
+    seed = seed * 1103515245 + 12345;
+    data += (char)('a' + (seed >> 16) % 16);
+  }
+  return data;
+}
+
+static string
+make_name(int i, int copy) {
+  ostringstream strm;
+  strm << "dir" << copy << "/file" << i << ".dat";
+  return strm.str();
+}
+
+static bool
+add_files(Multifile *mf, int first_copy, int last_copy,
+          pvector<istringstream *> &sources) {
+  for (int copy = first_copy; copy < last_copy; ++copy) {
+    for (int i = 0; i < num_unique; ++i) {
+      sources.push_back(new istringstream(make_contents(i)));
+      // Compress the even-numbered files.
+      int level = (i % 2 == 0) ? 6 : 0;
+      if (mf->add_subfile(make_name(i, copy), sources.back(), level).empty()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool
+check_files(Multifile *mf, int num_copies) {
+  bool ok = (mf->get_num_subfiles() == num_unique * num_copies);
+  for (int copy = 0; copy < num_copies; ++copy) {
+    for (int i = 0; i < num_unique; ++i) {
+      int index = mf->find_subfile(make_name(i, copy));
+      string data;
+      if (index < 0 || !mf->read_subfile(index, data) ||
+          data != make_contents(i)) {
+        cerr << "Wrong contents for " << make_name(i, copy) << "\n";
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+static bool
+build(const Filename &filename, bool deduplicate, streamsize &file_size) {
+  pvector<istringstream *> sources;
+
+  // Write the first three copies of each file, then add two more
+  // copies in a second session, so that those must be matched against
+  // the data already on disk.
+  PT(Multifile) mf = new Multifile;
+  mf->set_deduplicate(deduplicate);
+  bool ok = mf->open_read_write(filename) &&
+    add_files(mf, 0, 3, sources) && mf->flush();
+  mf->close();
+
+  mf = new Multifile;
+  mf->set_deduplicate(deduplicate);
+  ok = ok && mf->open_read_write(filename) &&
+    add_files(mf, 3, copies, sources) && mf->flush();
+  ok = ok && check_files(mf, copies);
+  int num_shared = mf->get_num_shared_subfiles();
+  streamsize bytes_saved = mf->get_shared_bytes_saved();
+
+  // Repacking must keep the data shared.
+  ok = ok && mf->repack() && check_files(mf, copies);
+  if (mf->get_num_shared_subfiles() != num_shared) {
+    cerr << "repack() lost shared data\n";
+    ok = false;
+  }
+  mf->close();
+
+  for (size_t si = 0; si < sources.size(); ++si) {
+    delete sources[si];
+  }
+
+  file_size = filename.get_file_size();
+  cerr << (deduplicate ? "deduplicated: " : "not deduplicated: ")
+       << file_size << " bytes, " << num_shared << " subfiles shared, "
+       << bytes_saved << " bytes saved\n";
+
+#ifdef HAVE_OPENSSL
+  int expect_shared = deduplicate ? num_unique * (copies - 1) : 0;
+#else
+  // Without OpenSSL there is no content hash, so nothing is shared.
+  int expect_shared = 0;
+#endif
+  if (num_shared != expect_shared) {
+    cerr << "Expected " << expect_shared << " shared subfiles\n";
+    ok = false;
+  }
+  return ok;
+}
+
+int
+main(int argc, char *argv[]) {
+  Filename plain = Filename::temporary("", "mfdedup", ".mf");
+  Filename dedup = Filename::temporary("", "mfdedup", ".mf");
+  plain.set_binary();
+  dedup.set_binary();
+
+  streamsize plain_size, dedup_size;
+  bool ok = build(plain, false, plain_size);
+  ok = build(dedup, true, dedup_size) && ok;
+  plain.unlink();
+  dedup.unlink();
+
+  if (!ok) {
+    cerr << "Deduplication test failed!\n";
+    return 1;
+  }
+  return 0;
+}
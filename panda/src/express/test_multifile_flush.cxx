@@ -0,0 +1,121 @@
+// Filename: test_multifile_flush.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "multifile.h"
+#include "trueClock.h"
+#include "pointerTo.h"
+#include "pvector.h"
+
+#include <stdlib.h>
+
+// This program measures the speed of Multifile::flush() on a set of
+// compressible subfiles, first on one thread and then on the
+// indicated number of threads, and checks that both produce exactly
+// the same Multifile.
+
+static const char *const words[] = {
+  "vertex", "polygon", "texture", "normal", "color", "joint",
+  "<Group>", "<Polygon>", "<VertexRef>", "{", "}", "0.0", "1.0",
+  "-0.5", "0.25", "<Transform>", "<Scalar>", "<UV>",
+};
+static const int num_words = sizeof(words) / sizeof(words[0]);
+
+static string
+make_data(size_t size, unsigned int seed) {
+  string data;
+  data.reserve(size + 16);
+  while (data.size() < size) {
+    seed = seed * 1103515245 + 12345;
+    data += words[(seed >> 16) % num_words];
+    data += ((seed >> 8) & 7) == 0 ? '\n' : ' ';
+  }
+  data.resize(size);
+  return data;
+}
+
+static double
+run_flush(const pvector<string> &contents, int num_threads, string &result) {
+  pvector<istringstream *> sources;
+  ostringstream *out = new ostringstream;
+
+  PT(Multifile) mf = new Multifile;
+  mf->open_write(out, false);
+  mf->set_record_timestamp(false);
+  mf->set_compression_threads(num_threads);
+
+  for (size_t i = 0; i < contents.size(); ++i) {
+    istringstream *source = new istringstream(contents[i]);
+    sources.push_back(source);
+    ostringstream name;
+    name << "file" << i << ".egg";
+    mf->add_subfile(name.str(), source, 6);
+  }
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+  mf->flush();
+  double elapsed = clock->get_short_time() - start;
+
+  mf->close();
+  result = out->str();
+  delete out;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    delete sources[i];
+  }
+
+  return elapsed;
+}
+
+int
+main(int argc, char *argv[]) {
+  int num_threads = 4;
+  int num_files = 64;
+  size_t file_size = 1 << 20;
+
+  if (argc > 1) {
+    num_threads = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    num_files = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    file_size = (size_t)atoi(argv[3]) * 1024;
+  }
+  if (argc > 4 || num_threads < 1 || num_files < 1 || file_size == 0) {
+    cerr << "test_multifile_flush [num_threads [num_files [file_size_kb]]]\n";
+    return 1;
+  }
+
+  pvector<string> contents;
+  for (int i = 0; i < num_files; ++i) {
+    contents.push_back(make_data(file_size, i));
+  }
+  double total_mb = (double)num_files * file_size / (1024.0 * 1024.0);
+
+  string serial, threaded;
+  double serial_time = run_flush(contents, 1, serial);
+  cerr << "1 thread: " << total_mb / serial_time << " MB/s ("
+       << serial_time << " s)\n";
+
+  double threaded_time = run_flush(contents, num_threads, threaded);
+  cerr << num_threads << " threads: " << total_mb / threaded_time
+       << " MB/s (" << threaded_time << " s)\n";
+
+  if (serial != threaded) {
+    cerr << "Multifiles differ!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,174 @@
+// Filename: test_multifile_lookup.cxx
+// Created by:  agent (19Oct26)
+//
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "multifile.h"
+#include "virtualFileSystem.h"
+#include "virtualFileMountRamdisk.h"
+#include "trueClock.h"
+#include "pointerTo.h"
+#include "pvector.h"
+
+#include <stdlib.h>
+
+// This program measures how long it takes to open a Multifile with a
+// large number of subfiles, and to look up each of its subfiles by
+// name, both directly within the Multifile and through a
+// VirtualFileSystem with several other mounts layered over it, with
+// and without vfs-path-cache.
+
+static const int num_extra_mounts = 11;
+static const int batch_size = 10000;
+
+static string
+make_name(int i) {
+  // The names are generated in sorted order, so that adding them to
+  // the Multifile is fast.
+  char buffer[64];
+  sprintf(buffer, "models/dir%03d/sub%02d/file%07d.egg",
+          i / 1000, (i / 100) % 10, i);
+  return buffer;
+}
+
+static double
+time_vfs_lookups(VirtualFileSystem &vfs, const pvector<string> &names,
+                 bool path_cache, int &found) {
+  vfs.vfs_path_cache.set_value(path_cache);
+  vfs.vfs_path_cache_size.set_value((int)names.size());
+  vfs.clear_path_cache();
+
+  // Look up each name twice; the second pass is the one that benefits
+  // from the cache.
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+  found = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (size_t i = 0; i < names.size(); ++i) {
+      if (vfs.get_file("/mf/" + names[i], true) != (VirtualFile *)NULL) {
+        ++found;
+      }
+    }
+  }
+  return clock->get_short_time() - start;
+}
+
+int
+main(int argc, char *argv[]) {
+  int num_files = 200000;
+  if (argc > 1) {
+    num_files = atoi(argv[1]);
+  }
+  if (argc > 2 || num_files < 1) {
+    cerr << "test_multifile_lookup [num_files]\n";
+    return 1;
+  }
+
+  Filename filename = Filename::temporary("", "mflookup", ".mf");
+  filename.set_binary();
+
+  {
+    // Build the Multifile.  Each subfile contains only its own name.
+    PT(Multifile) mf = new Multifile;
+    if (!mf->open_write(filename)) {
+      cerr << "Unable to write " << filename << "\n";
+      return 1;
+    }
+    mf->set_record_timestamp(false);
+    for (int first = 0; first < num_files; first += batch_size) {
+      pvector<istringstream *> sources;
+      int last = min(first + batch_size, num_files);
+      for (int i = first; i < last; ++i) {
+        string name = make_name(i);
+        sources.push_back(new istringstream(name));
+        mf->add_subfile(name, sources.back(), 0);
+      }
+      mf->flush();
+      for (size_t si = 0; si < sources.size(); ++si) {
+        delete sources[si];
+      }
+    }
+    mf->close();
+  }
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  PT(Multifile) mf = new Multifile;
+  double start = clock->get_short_time();
+  if (!mf->open_read(filename)) {
+    cerr << "Unable to read " << filename << "\n";
+    filename.unlink();
+    return 1;
+  }
+  double open_time = clock->get_short_time() - start;
+  cerr << num_files << " subfiles, opened in " << open_time << " s\n";
+
+  // Look the names up in a scrambled order.
+  pvector<string> names;
+  for (int i = 0; i < num_files; ++i) {
+    names.push_back(make_name(i));
+  }
+  unsigned int seed = 1;
+  for (int i = num_files - 1; i > 0; --i) {
+    seed = seed * 1103515245 + 12345;
+    swap(names[i], names[(seed >> 8) % (i + 1)]);
+  }
+
+  start = clock->get_short_time();
+  int found = 0;
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (mf->find_subfile(names[i]) >= 0) {
+      ++found;
+    }
+  }
+  double find_time = clock->get_short_time() - start;
+  cerr << "find_subfile: " << find_time * 1.0e9 / num_files << " ns each";
+  if (found != num_files) {
+    cerr << " (found only " << found << ")";
+  }
+  cerr << "\n";
+
+  start = clock->get_short_time();
+  int num_dirs = 0;
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (mf->has_directory(Filename(names[i]).get_dirname())) {
+      ++num_dirs;
+    }
+  }
+  double dir_time = clock->get_short_time() - start;
+  cerr << "has_directory: " << dir_time * 1.0e9 / num_files << " ns each\n";
+
+  VirtualFileSystem vfs;
+  vfs.mount(mf, "/mf", 0);
+  for (int i = 0; i < num_extra_mounts; ++i) {
+    vfs.mount(new VirtualFileMountRamdisk, "/mf", 0);
+  }
+
+  int uncached_found, cached_found;
+  double uncached_time = time_vfs_lookups(vfs, names, false, uncached_found);
+  double cached_time = time_vfs_lookups(vfs, names, true, cached_found);
+  cerr << "get_file with " << num_extra_mounts + 1 << " mounts: "
+       << uncached_time * 1.0e9 / (2 * num_files) << " ns each, "
+       << cached_time * 1.0e9 / (2 * num_files) << " ns each with path cache\n";
+
+  vfs.unmount_all();
+  mf->close();
+  filename.unlink();
+
+  if (found != num_files || num_dirs != num_files ||
+      uncached_found != 2 * num_files || cached_found != 2 * num_files) {
+    cerr << "Lookup failed!\n";
+    return 1;
+  }
+  return 0;
+}
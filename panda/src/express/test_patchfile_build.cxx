@@ -0,0 +1,237 @@
+// Filename: test_patchfile_build.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "patchfile.h"
+#include "hashVal.h"
+#include "trueClock.h"
+#include "filename.h"
+
+#include <stdlib.h>
+
+// This program generates a synthetic original file of the indicated
+// size (1 GB by default), and a new version of it with scattered
+// insertions, deletions, overwrites, and moved blocks.  It then
+// builds a patch between them with the rolling-hash algorithm on one
+// thread and on several, checks that the two patches are identical,
+// and applies one to verify that it reproduces the new file.  On
+// smaller inputs, it also builds a patch with the traditional
+// footprint algorithm for comparison.
+//
+// Usage: test_patchfile_build [size_in_mb [num_threads]]
+
+static unsigned int rand_state = 12345;
+
+static unsigned int
+next_rand() {
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 17;
+  rand_state ^= rand_state << 5;
+  return rand_state;
+}
+
+static void
+append_random(string &data, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    data += (char)(next_rand() >> 24);
+  }
+}
+
+// Fills orig with random data, in which some stretches repeat
+// earlier ones, as happens with shared content in a real file.
+static void
+make_orig(string &orig, size_t size) {
+  orig.reserve(size);
+  while (orig.size() < size) {
+    size_t length = min((size_t)(1000 + next_rand() % 100000), size - orig.size());
+    if (orig.size() > length && next_rand() % 8 == 0) {
+      size_t from = next_rand() % (orig.size() - length);
+      orig.append(orig, from, length);
+    } else {
+      append_random(orig, length);
+    }
+  }
+}
+
+// Writes an edited copy of orig to the indicated stream, a chunk at
+// a time.
+static void
+write_new(ostream &out, const string &orig) {
+  size_t pos = 0;
+  string chunk;
+  while (pos < orig.size()) {
+    size_t length = min((size_t)(next_rand() % 0x200000), orig.size() - pos);
+    out.write(orig.data() + pos, length);
+    pos += length;
+
+    chunk.clear();
+    switch (next_rand() % 4) {
+    case 0:
+      // Insert some new bytes.
+      append_random(chunk, 1 + next_rand() % 4096);
+      break;
+
+    case 1:
+      // Delete some bytes.
+      pos += next_rand() % 4096;
+      break;
+
+    case 2:
+      // Overwrite some bytes.
+      {
+        size_t overwrite = min((size_t)(1 + next_rand() % 2000),
+                               orig.size() - min(pos, orig.size()));
+        append_random(chunk, overwrite);
+        pos += overwrite;
+      }
+      break;
+
+    case 3:
+      // Copy in a block from elsewhere in the file.
+      {
+        size_t block = 1 + next_rand() % 0x100000;
+        if (block < orig.size()) {
+          chunk.assign(orig, next_rand() % (orig.size() - block), block);
+        }
+      }
+      break;
+    }
+    out.write(chunk.data(), chunk.size());
+  }
+}
+
+static bool
+build(const Filename &orig_name, const Filename &new_name,
+      const Filename &patch_name, Patchfile::BuildMode mode, int threads,
+      const char *label) {
+  Patchfile patchfile;
+  patchfile.set_allow_multifile(false);
+  patchfile.set_build_mode(mode);
+  patchfile.set_build_threads(threads);
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+  if (!patchfile.build(orig_name, new_name, patch_name)) {
+    cerr << label << ": build failed\n";
+    return false;
+  }
+  double elapsed = clock->get_short_time() - start;
+  cerr << label << ": " << elapsed << " s, patch is "
+       << patch_name.get_file_size() << " bytes\n";
+  return true;
+}
+
+int
+main(int argc, char *argv[]) {
+  size_t size_mb = 1024;
+  int threads = 4;
+  if (argc > 1) {
+    size_mb = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    threads = atoi(argv[2]);
+  }
+
+  Filename orig_name = Filename::temporary("", "pchorig");
+  Filename new_name = Filename::temporary("", "pchnew");
+  Filename patch1_name = Filename::temporary("", "pch1", ".pch");
+  Filename patchn_name = Filename::temporary("", "pchn", ".pch");
+  Filename result_name = Filename::temporary("", "pchresult");
+  orig_name.set_binary();
+  new_name.set_binary();
+  patch1_name.set_binary();
+  patchn_name.set_binary();
+  result_name.set_binary();
+
+  cerr << "Generating " << size_mb << " MB of input\n";
+  {
+    string orig;
+    make_orig(orig, size_mb << 20);
+
+    pofstream out;
+    if (!orig_name.open_write(out)) {
+      cerr << "Couldn't write " << orig_name << "\n";
+      return 1;
+    }
+    out.write(orig.data(), orig.size());
+    out.close();
+
+    if (!new_name.open_write(out)) {
+      cerr << "Couldn't write " << new_name << "\n";
+      return 1;
+    }
+    write_new(out, orig);
+    out.close();
+  }
+
+  bool ok = build(orig_name, new_name, patch1_name, Patchfile::BM_rolling_hash,
+                  1, "rolling hash, 1 thread");
+
+  ostringstream label;
+  label << "rolling hash, " << threads << " threads";
+  ok = ok && build(orig_name, new_name, patchn_name, Patchfile::BM_rolling_hash,
+                   threads, label.str().c_str());
+
+  if (ok) {
+    HashVal hash1, hashn;
+    hash1.hash_file(patch1_name);
+    hashn.hash_file(patchn_name);
+    if (hash1 != hashn) {
+      cerr << "Patches depend on the number of threads\n";
+      ok = false;
+    }
+  }
+
+  if (ok && size_mb <= 64) {
+    // The footprint algorithm needs four bytes of memory for every
+    // byte of the original file, and much more time.
+    Filename footprint_name = Filename::temporary("", "pchf", ".pch");
+    footprint_name.set_binary();
+    ok = build(orig_name, new_name, footprint_name, Patchfile::BM_footprint,
+               1, "footprint");
+    footprint_name.unlink();
+  }
+
+  if (ok) {
+    TrueClock *clock = TrueClock::get_global_ptr();
+    double start = clock->get_short_time();
+    Patchfile patchfile;
+    if (!patchfile.apply(patchn_name, orig_name, result_name)) {
+      cerr << "apply failed\n";
+      ok = false;
+    } else {
+      cerr << "apply: " << clock->get_short_time() - start << " s\n";
+
+      HashVal new_hash, result_hash;
+      new_hash.hash_file(new_name);
+      result_hash.hash_file(result_name);
+      if (new_hash != result_hash) {
+        cerr << "Patched file does not match\n";
+        ok = false;
+      }
+    }
+  }
+
+  orig_name.unlink();
+  new_name.unlink();
+  patch1_name.unlink();
+  patchn_name.unlink();
+  result_name.unlink();
+
+  if (!ok) {
+    cerr << "Patchfile test failed!\n";
+    return 1;
+  }
+  return 0;
+}
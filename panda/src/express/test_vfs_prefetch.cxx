@@ -0,0 +1,186 @@
+// Filename: test_vfs_prefetch.cxx
+// Created by:  agent (19Oct26)
+//
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "virtualFileSystem.h"
+#include "virtualFileMountRamdisk.h"
+#include "multifile.h"
+#include "trueClock.h"
+#include "pvector.h"
+
+#include <stdlib.h>
+
+// This program writes a set of files to a directory on disk, to a
+// Multifile and to a ramdisk, and mounts all three on a private
+// VirtualFileSystem.  For each of these, it reports how long it takes
+// to read all of the files directly, and again after they have been
+// prefetched, and checks that the prefetched contents are correct.
+
+static string
+make_contents(int i, int size) {
+  string data;
+  data.reserve(size);
+  unsigned int seed = i + 1;
+  while ((int)data.size() < size) {
+    seed = seed * 1103515245 + 12345;
+    // Leave the data somewhat compressible.
+    data += (char)('a' + (seed >> 16) % 8);
+  }
+  return data;
+}
+
+static bool
+read_all(VirtualFileSystem &vfs, const string &dirname,
+         const pvector<string> &contents, double &elapsed) {
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+  bool ok = true;
+  for (size_t i = 0; i < contents.size(); ++i) {
+    ostringstream strm;
+    strm << dirname << "/file" << i << ".dat";
+    string data;
+    if (!vfs.read_file(Filename::binary_filename(strm.str()), data, true) ||
+        data != contents[i]) {
+      ok = false;
+    }
+  }
+  elapsed = clock->get_short_time() - start;
+  return ok;
+}
+
+static bool
+run_mount(VirtualFileSystem &vfs, const string &dirname,
+          const pvector<string> &contents) {
+  int num_files = (int)contents.size();
+  vfs.clear_read_cache();
+  int hits = vfs.get_read_cache_hits();
+  int misses = vfs.get_read_cache_misses();
+
+  double direct_time;
+  bool ok = read_all(vfs, dirname, contents, direct_time);
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+  for (int i = 0; i < num_files; ++i) {
+    ostringstream strm;
+    strm << dirname << "/file" << i << ".dat";
+    vfs.prefetch(Filename::binary_filename(strm.str()), true);
+  }
+  double queue_time = clock->get_short_time() - start;
+  vfs.wait_prefetch();
+  double prefetch_time = clock->get_short_time() - start;
+
+  int prefetch_misses = vfs.get_read_cache_misses() - misses;
+  double cached_time;
+  if (!read_all(vfs, dirname, contents, cached_time)) {
+    ok = false;
+  }
+  hits = vfs.get_read_cache_hits() - hits;
+  misses = vfs.get_read_cache_misses() - misses - prefetch_misses;
+
+  cerr << dirname << ": read " << direct_time * 1000.0 << " ms; "
+       << "prefetch queued in " << queue_time * 1000.0 << " ms, done in "
+       << prefetch_time * 1000.0 << " ms; read after prefetch "
+       << cached_time * 1000.0 << " ms (" << hits << " hits, "
+       << misses << " misses)\n";
+  return ok && hits == num_files && misses == 0;
+}
+
+int
+main(int argc, char *argv[]) {
+  int num_files = 500;
+  int file_size = 65536;
+  if (argc > 1) {
+    num_files = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    file_size = atoi(argv[2]);
+  }
+  if (argc > 3 || num_files < 1 || file_size < 0) {
+    cerr << "test_vfs_prefetch [num_files [file_size]]\n";
+    return 1;
+  }
+
+  pvector<string> contents;
+  for (int i = 0; i < num_files; ++i) {
+    contents.push_back(make_contents(i, file_size));
+  }
+
+  VirtualFileSystem vfs;
+  vfs.vfs_read_cache_size.set_value((PN_int64)num_files * file_size);
+
+  Filename dirname = Filename::temporary("", "vfsprefetch");
+  dirname.mkdir();
+  Filename mf_filename = Filename::temporary("", "vfsprefetch", ".mf");
+  mf_filename.set_binary();
+
+  vfs.mount(new VirtualFileMountRamdisk, "/ram", 0);
+  vfs.mount(dirname, "/sys", 0);
+
+  {
+    PT(Multifile) mf = new Multifile;
+    if (!mf->open_write(mf_filename)) {
+      cerr << "Unable to write " << mf_filename << "\n";
+      return 1;
+    }
+    pvector<istringstream *> sources;
+    for (int i = 0; i < num_files; ++i) {
+      ostringstream strm;
+      strm << "file" << i << ".dat";
+      const string &data = contents[i];
+      vfs.write_file(Filename::binary_filename("/ram/" + strm.str()), data, false);
+      vfs.write_file(Filename::binary_filename("/sys/" + strm.str()), data, false);
+      sources.push_back(new istringstream(data));
+      mf->add_subfile(strm.str(), sources.back(), 6);
+    }
+    mf->close();
+    for (size_t si = 0; si < sources.size(); ++si) {
+      delete sources[si];
+    }
+  }
+  vfs.mount(mf_filename, "/mf", 0);
+
+  bool ok = true;
+  ok = run_mount(vfs, "/sys", contents) && ok;
+  ok = run_mount(vfs, "/mf", contents) && ok;
+  ok = run_mount(vfs, "/ram", contents) && ok;
+
+  // A file that changes after it has been prefetched must not be
+  // served from the cache.
+  Filename changed = Filename::binary_filename(string("/ram/file0.dat"));
+  vfs.prefetch(changed, true);
+  vfs.wait_prefetch();
+  vfs.write_file(changed, string("changed"), false);
+  string data;
+  if (!vfs.read_file(changed, data, true) || data != "changed") {
+    cerr << "Read stale data after modification!\n";
+    ok = false;
+  }
+
+  vfs.unmount_all();
+  for (int i = 0; i < num_files; ++i) {
+    ostringstream strm;
+    strm << "file" << i << ".dat";
+    Filename(dirname, strm.str()).unlink();
+  }
+  dirname.rmdir();
+  mf_filename.unlink();
+
+  if (!ok) {
+    cerr << "Prefetch test failed!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -397,6 +397,27 @@ get_system_info(SubfileInfo &info) {
   return false;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFile::get_mapped_data
+//       Access: Public, Virtual
+//  Description: If the contents of the file are already available in
+//               memory, exactly as they would be returned by
+//               read_file(), fills in data and size with their
+//               location and returns true, without copying anything.
+//               This is currently possible for uncompressed,
+//               unencrypted subfiles of a Multifile that has been
+//               mapped into memory; see Multifile::is_mapped().
+//
+//               The pointer remains valid for as long as the file
+//               remains mounted.  Returns false if the data is not
+//               available this way, in which case the file should be
+//               read normally.
+////////////////////////////////////////////////////////////////////
+bool VirtualFile::
+get_mapped_data(const char *&data, size_t &size) const {
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: VirtualFile::atomic_compare_and_exchange_contents
 //       Access: Public, Virtual
@@ -86,6 +86,7 @@ public:
   bool read_file(string &result, bool auto_unwrap) const;
   virtual bool read_file(pvector<unsigned char> &result, bool auto_unwrap) const;
   virtual bool write_file(const unsigned char *data, size_t data_size, bool auto_wrap);
+  virtual bool get_mapped_data(const char *&data, size_t &size) const;
 
   static bool simple_read_file(istream *stream, pvector<unsigned char> &result);
   static bool simple_read_file(istream *stream, pvector<unsigned char> &result, size_t max_bytes);
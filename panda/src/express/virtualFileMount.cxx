@@ -366,6 +366,20 @@ get_system_info(const Filename &file, SubfileInfo &info) {
   return false;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileMount::get_mapped_data
+//       Access: Public, Virtual
+//  Description: If the contents of the indicated file are already
+//               available in memory, fills in data and size with
+//               their location and returns true, without copying
+//               anything.  Returns false if they are not.  See
+//               VirtualFile::get_mapped_data().
+////////////////////////////////////////////////////////////////////
+bool VirtualFileMount::
+get_mapped_data(const Filename &file, const char *&data, size_t &size) const {
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: VirtualFileMount::atomic_compare_and_exchange_contents
 //       Access: Public, Virtual
@@ -77,6 +77,8 @@ public:
   virtual streamsize get_file_size(const Filename &file) const=0;
   virtual time_t get_timestamp(const Filename &file) const=0;
   virtual bool get_system_info(const Filename &file, SubfileInfo &info);
+  virtual bool get_mapped_data(const Filename &file, const char *&data,
+                               size_t &size) const;
 
   virtual bool scan_directory(vector_string &contents, 
                               const Filename &dir) const=0;
@@ -203,6 +203,24 @@ get_system_info(const Filename &file, SubfileInfo &info) {
   return true;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileMountMultifile::get_mapped_data
+//       Access: Public, Virtual
+//  Description: If the Multifile is mapped into memory and the
+//               indicated subfile is stored uncompressed and
+//               unencrypted, fills in data and size with its location
+//               in memory and returns true.  See
+//               Multifile::get_subfile_mapped_data().
+////////////////////////////////////////////////////////////////////
+bool VirtualFileMountMultifile::
+get_mapped_data(const Filename &file, const char *&data, size_t &size) const {
+  int subfile_index = _multifile->find_subfile(file);
+  if (subfile_index < 0) {
+    return false;
+  }
+  return _multifile->get_subfile_mapped_data(subfile_index, data, size);
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: VirtualFileMountMultifile::scan_directory
 //       Access: Public, Virtual
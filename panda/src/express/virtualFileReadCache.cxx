@@ -0,0 +1,409 @@
+// Filename: virtualFileReadCache.cxx
+// Created by:  agent (19Oct26)
+//
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "virtualFileReadCache.h"
+#include "virtualFileSystem.h"
+#include "virtualFileSimple.h"
+#include "dcast.h"
+
+PT(PStatCollectorForwardBase) VirtualFileReadCache::_hit_collector;
+PT(PStatCollectorForwardBase) VirtualFileReadCache::_miss_collector;
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::Constructor
+//       Access: Public
+//  Description: 
+////////////////////////////////////////////////////////////////////
+VirtualFileReadCache::
+VirtualFileReadCache(VirtualFileSystem *file_system) :
+  _file_system(file_system),
+  _num_threads(0),
+  _num_busy(0),
+  _shutdown(false),
+  _num_bytes(0),
+  _clear_seq(0),
+  _num_hits(0),
+  _num_misses(0),
+  _active(0),
+  _threads(_lock)
+{
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::Destructor
+//       Access: Public
+//  Description: Abandons any pending prefetch requests, and waits for
+//               the worker threads to finish the reads they have
+//               already started.
+////////////////////////////////////////////////////////////////////
+VirtualFileReadCache::
+~VirtualFileReadCache() {
+  _lock.acquire();
+  _shutdown = true;
+  _requests.clear();
+  _threads.notify_all();
+  _lock.release();
+
+  _threads.join();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::prefetch
+//       Access: Public
+//  Description: Queues the indicated file to be read into the cache
+//               by one of the worker threads, and returns
+//               immediately.  If threads are not available, the file
+//               is read before this method returns.
+//
+//               A relative filename is taken relative to the
+//               VirtualFileSystem's current directory at the time of
+//               this call.
+////////////////////////////////////////////////////////////////////
+void VirtualFileReadCache::
+prefetch(const Filename &filename, bool auto_unwrap) {
+  Request request;
+  request._filename = filename;
+  request._filename.make_absolute(_file_system->get_cwd());
+  request._auto_unwrap = auto_unwrap;
+
+  int max_threads = max((int)_file_system->vfs_prefetch_threads, 1);
+
+  _lock.acquire();
+  if (_shutdown) {
+    _lock.release();
+    return;
+  }
+  AtomicAdjust::set(_active, 1);
+  _requests.push_back(request);
+  _threads.notify_all();
+
+  // Start another thread if there is more work queued than there are
+  // idle threads to pick it up.
+  if (_num_threads < max_threads &&
+      (int)_requests.size() > _num_threads - _num_busy) {
+    if (_threads.start_thread(&thread_main, this)) {
+      ++_num_threads;
+
+    } else if (_num_threads == 0) {
+      // We can't start any threads, so do the work here instead.
+      while (!_requests.empty()) {
+        Request next = _requests.front();
+        _requests.pop_front();
+        ++_num_busy;
+        int clear_seq = _clear_seq;
+        _lock.release();
+
+        do_request(next, clear_seq);
+
+        _lock.acquire();
+        --_num_busy;
+      }
+      _threads.notify_all();
+    }
+  }
+  _lock.release();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::wait
+//       Access: Public
+//  Description: Blocks until all of the prefetch requests made so
+//               far have been completed.
+////////////////////////////////////////////////////////////////////
+void VirtualFileReadCache::
+wait() {
+  _lock.acquire();
+  while (!_requests.empty() || _num_busy != 0) {
+    _threads.wait();
+  }
+  _lock.release();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::clear
+//       Access: Public
+//  Description: Empties the cache, and abandons any prefetch
+//               requests that have not yet been started.
+////////////////////////////////////////////////////////////////////
+void VirtualFileReadCache::
+clear() {
+  _lock.acquire();
+  _requests.clear();
+  _entries.clear();
+  _order.clear();
+  _num_bytes = 0;
+  ++_clear_seq;
+  _threads.notify_all();
+  _lock.release();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::fetch
+//       Access: Public
+//  Description: Called by VirtualFileSimple::read_file() and
+//               open_read_file().  If the indicated file has been
+//               prefetched, and its timestamp and size have not
+//               changed since, fills result with its contents and
+//               returns true.  Otherwise, returns false, and the
+//               caller should read the file itself.
+////////////////////////////////////////////////////////////////////
+bool VirtualFileReadCache::
+fetch(const VirtualFileSimple *file, bool do_uncompress,
+      pvector<unsigned char> &result) {
+  if (!AtomicAdjust::get(_active)) {
+    // Nothing has ever been prefetched; don't bother counting.
+    return false;
+  }
+
+  string key = file->get_filename().get_fullpath();
+
+  _lock.acquire();
+  Entries::iterator ei = _entries.find(key);
+  if (ei == _entries.end() || (*ei).second._do_uncompress != do_uncompress) {
+    _lock.release();
+    record_miss();
+    return false;
+  }
+  time_t timestamp = (*ei).second._timestamp;
+  streamsize file_size = (*ei).second._file_size;
+  _lock.release();
+
+  // Make sure the file hasn't changed since we read it.  We do this
+  // without holding the lock, since it may have to go to disk.
+  bool changed = (file->get_timestamp() != timestamp ||
+                  file->get_file_size() != file_size);
+
+  _lock.acquire();
+  ei = _entries.find(key);
+  if (ei == _entries.end()) {
+    // Someone evicted it in the meantime.
+    _lock.release();
+    record_miss();
+    return false;
+  }
+
+  Entry &entry = (*ei).second;
+  if (changed) {
+    _num_bytes -= entry._data.size();
+    _order.erase(entry._oi);
+    _entries.erase(ei);
+    _lock.release();
+    record_miss();
+    return false;
+  }
+
+  result = entry._data;
+  _order.splice(_order.begin(), _order, entry._oi);
+  ++_num_hits;
+  _lock.release();
+
+  if (_hit_collector != (PStatCollectorForwardBase *)NULL) {
+    _hit_collector->add_level(1);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::get_num_bytes
+//       Access: Public
+//  Description: Returns the total size of the file contents currently
+//               held in the cache.
+////////////////////////////////////////////////////////////////////
+size_t VirtualFileReadCache::
+get_num_bytes() const {
+  _lock.acquire();
+  size_t num_bytes = _num_bytes;
+  _lock.release();
+  return num_bytes;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::get_num_pending
+//       Access: Public
+//  Description: Returns the number of prefetch requests that are
+//               queued or in progress.
+////////////////////////////////////////////////////////////////////
+int VirtualFileReadCache::
+get_num_pending() const {
+  _lock.acquire();
+  int num_pending = (int)_requests.size() + _num_busy;
+  _lock.release();
+  return num_pending;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::set_collectors
+//       Access: Public, Static
+//  Description: Specifies the PStats level collectors that are
+//               incremented for each cache hit and miss.  This is
+//               called by a higher-level package that has access to
+//               PStats; either pointer may be NULL.
+////////////////////////////////////////////////////////////////////
+void VirtualFileReadCache::
+set_collectors(PStatCollectorForwardBase *hit_collector,
+               PStatCollectorForwardBase *miss_collector) {
+  _hit_collector = hit_collector;
+  _miss_collector = miss_collector;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::thread_main
+//       Access: Private, Static
+//  Description: The entry point for each worker thread.
+////////////////////////////////////////////////////////////////////
+void VirtualFileReadCache::
+thread_main(void *data) {
+  ((VirtualFileReadCache *)data)->thread_run();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::thread_run
+//       Access: Private
+//  Description: The body of each worker thread.  Processes requests
+//               as they are queued, sleeping while there are none,
+//               until the cache is destroyed.
+////////////////////////////////////////////////////////////////////
+void VirtualFileReadCache::
+thread_run() {
+  _lock.acquire();
+  while (!_shutdown) {
+    if (_requests.empty()) {
+      _threads.wait();
+      continue;
+    }
+
+    Request request = _requests.front();
+    _requests.pop_front();
+    ++_num_busy;
+    int clear_seq = _clear_seq;
+    _lock.release();
+
+    do_request(request, clear_seq);
+
+    _lock.acquire();
+    --_num_busy;
+    if (_requests.empty() && _num_busy == 0) {
+      // Wake up anyone in wait().
+      _threads.notify_all();
+    }
+  }
+  _lock.release();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::do_request
+//       Access: Private
+//  Description: Reads the requested file and stores its contents,
+//               unless it is already in the cache.  clear_seq is the
+//               value of _clear_seq when the request was taken.
+////////////////////////////////////////////////////////////////////
+void VirtualFileReadCache::
+do_request(const Request &request, int clear_seq) {
+  PT(VirtualFile) file = _file_system->get_file(request._filename, false);
+  if (file == (VirtualFile *)NULL ||
+      !file->is_exact_type(VirtualFileSimple::get_class_type()) ||
+      !file->is_regular_file()) {
+    // Only a regular file on one mount can be cached.
+    return;
+  }
+  VirtualFileSimple *simple = DCAST(VirtualFileSimple, file);
+  bool do_uncompress = simple->needs_uncompress(request._auto_unwrap);
+  string key = simple->get_filename().get_fullpath();
+
+  _lock.acquire();
+  Entries::const_iterator ei = _entries.find(key);
+  bool already = (ei != _entries.end() && (*ei).second._do_uncompress == do_uncompress);
+  _lock.release();
+  if (already) {
+    return;
+  }
+
+  time_t timestamp = simple->get_timestamp();
+  streamsize file_size = simple->get_file_size();
+  pvector<unsigned char> data;
+  if (simple->do_read_file(data, do_uncompress)) {
+    store(key, do_uncompress, timestamp, file_size, clear_seq, data);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::store
+//       Access: Private
+//  Description: Adds the indicated file contents to the front of the
+//               cache, evicting the least recently used entries as
+//               necessary to make room.  The data vector is emptied.
+//               Nothing is stored if the cache has been cleared
+//               since clear_seq was recorded.
+////////////////////////////////////////////////////////////////////
+void VirtualFileReadCache::
+store(const string &key, bool do_uncompress, time_t timestamp,
+      streamsize file_size, int clear_seq, pvector<unsigned char> &data) {
+  PN_int64 limit = max(_file_system->vfs_read_cache_size.get_value(), (PN_int64)0);
+  size_t size = data.size();
+  if ((PN_int64)size > limit) {
+    // It would never fit.
+    return;
+  }
+
+  _lock.acquire();
+  if (_shutdown || clear_seq != _clear_seq) {
+    _lock.release();
+    return;
+  }
+
+  Entries::iterator ei = _entries.find(key);
+  if (ei != _entries.end()) {
+    _num_bytes -= (*ei).second._data.size();
+    _order.erase((*ei).second._oi);
+    _entries.erase(ei);
+  }
+
+  while ((PN_int64)(_num_bytes + size) > limit && !_order.empty()) {
+    ei = _entries.find(_order.back());
+    nassertd(ei != _entries.end()) {
+      _order.pop_back();
+      continue;
+    }
+    _num_bytes -= (*ei).second._data.size();
+    _entries.erase(ei);
+    _order.pop_back();
+  }
+
+  _order.push_front(key);
+  Entry &entry = _entries[key];
+  entry._data.swap(data);
+  entry._do_uncompress = do_uncompress;
+  entry._timestamp = timestamp;
+  entry._file_size = file_size;
+  entry._oi = _order.begin();
+  _num_bytes += size;
+  _lock.release();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileReadCache::record_miss
+//       Access: Private
+//  Description: Counts a read that was not satisfied by the cache.
+////////////////////////////////////////////////////////////////////
+void VirtualFileReadCache::
+record_miss() {
+  _lock.acquire();
+  ++_num_misses;
+  _lock.release();
+
+  if (_miss_collector != (PStatCollectorForwardBase *)NULL) {
+    _miss_collector->add_level(1);
+  }
+}
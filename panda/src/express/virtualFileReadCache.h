@@ -0,0 +1,138 @@
+// Filename: virtualFileReadCache.h
+// Created by:  agent (19Oct26)
+//
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef VIRTUALFILEREADCACHE_H
+#define VIRTUALFILEREADCACHE_H
+
+#include "pandabase.h"
+
+#include "filename.h"
+#include "mutexImpl.h"
+#include "workerThreadGroup.h"
+#include "atomicAdjust.h"
+#include "pointerTo.h"
+#include "pStatCollectorForwardBase.h"
+#include "pvector.h"
+#include "pdeque.h"
+#include "plist.h"
+#include "pmap.h"
+
+class VirtualFileSystem;
+class VirtualFileSimple;
+
+////////////////////////////////////////////////////////////////////
+//       Class : VirtualFileReadCache
+// Description : Reads files ahead of time on a small pool of
+//               background threads, on behalf of
+//               VirtualFileSystem::prefetch(), and keeps their
+//               contents in memory until they are read.
+//
+//               The contents are kept in a least-recently-used list
+//               bounded by vfs-read-cache-size bytes.  Only files that
+//               have been prefetched are ever stored here; an ordinary
+//               read that finds nothing is simply a miss.
+//
+//               The worker threads are started as needed, up to
+//               vfs-prefetch-threads, and then sleep until there is
+//               more to read.  They are stopped when the cache is
+//               destroyed.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS VirtualFileReadCache {
+public:
+  VirtualFileReadCache(VirtualFileSystem *file_system);
+  ~VirtualFileReadCache();
+
+  void prefetch(const Filename &filename, bool auto_unwrap);
+  void wait();
+  void clear();
+
+  bool fetch(const VirtualFileSimple *file, bool do_uncompress,
+             pvector<unsigned char> &result);
+
+  size_t get_num_bytes() const;
+  int get_num_pending() const;
+  INLINE int get_num_hits() const;
+  INLINE int get_num_misses() const;
+
+  static void set_collectors(PStatCollectorForwardBase *hit_collector,
+                             PStatCollectorForwardBase *miss_collector);
+
+private:
+  class Request {
+  public:
+    Filename _filename;
+    bool _auto_unwrap;
+  };
+
+  typedef plist<string> Order;
+
+  class Entry {
+  public:
+    pvector<unsigned char> _data;
+    bool _do_uncompress;
+    time_t _timestamp;
+    streamsize _file_size;
+    Order::iterator _oi;
+  };
+
+  static void thread_main(void *data);
+  void thread_run();
+  void do_request(const Request &request, int clear_seq);
+  void store(const string &key, bool do_uncompress, time_t timestamp,
+             streamsize file_size, int clear_seq,
+             pvector<unsigned char> &data);
+  void record_miss();
+
+  VirtualFileSystem *_file_system;
+
+  typedef pdeque<Request> Requests;
+  Requests _requests;
+  int _num_threads;
+  int _num_busy;
+  bool _shutdown;
+
+  // The entries are stored by the full VFS filename; _order lists
+  // those same keys, most recently used first.
+  typedef pmap<string, Entry> Entries;
+  Entries _entries;
+  Order _order;
+  size_t _num_bytes;
+
+  // Incremented by clear(), so that a read that was already in
+  // progress doesn't store its result afterwards.
+  int _clear_seq;
+
+  int _num_hits;
+  int _num_misses;
+
+  // Protects all of the above.
+  mutable MutexImpl _lock;
+
+  // Set once anything has been prefetched.  This is checked by
+  // fetch() without the lock, so that ordinary reads pay nothing
+  // when prefetch is not in use.
+  AtomicAdjust::Integer _active;
+
+  // The worker threads, and the condition they sleep on.  This must
+  // be constructed after _lock.
+  WorkerThreadGroup _threads;
+
+  static PT(PStatCollectorForwardBase) _hit_collector;
+  static PT(PStatCollectorForwardBase) _miss_collector;
+};
+
+#include "virtualFileReadCache.I"
+
+#endif
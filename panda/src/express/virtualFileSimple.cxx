@@ -15,6 +15,8 @@
 #include "virtualFileSimple.h"
 #include "virtualFileMount.h"
 #include "virtualFileList.h"
+#include "virtualFileSystem.h"
+#include "virtualFileReadCache.h"
 
 TypeHandle VirtualFileSimple::_type_handle;
 
@@ -226,7 +228,20 @@ istream *VirtualFileSimple::
 open_read_file(bool auto_unwrap) const {
 
   // Will we be automatically unwrapping a .pz file?
-  bool do_uncompress = (_implicit_pz_file || (auto_unwrap && _local_filename.get_extension() == "pz"));
+  bool do_uncompress = needs_uncompress(auto_unwrap);
+
+  // If the file has been prefetched, serve it from memory.
+  VirtualFileSystem *file_system = _mount->get_file_system();
+  if (file_system != (VirtualFileSystem *)NULL) {
+    pvector<unsigned char> data;
+    if (file_system->get_read_cache()->fetch(this, do_uncompress, data)) {
+      string str;
+      if (!data.empty()) {
+        str.assign((const char *)&data[0], data.size());
+      }
+      return new istringstream(str);
+    }
+  }
 
   Filename local_filename(_local_filename);
   if (do_uncompress) {
@@ -437,15 +452,33 @@ bool VirtualFileSimple::
 read_file(pvector<unsigned char> &result, bool auto_unwrap) const {
 
   // Will we be automatically unwrapping a .pz file?
-  bool do_uncompress = (_implicit_pz_file || (auto_unwrap && _local_filename.get_extension() == "pz"));
+  bool do_uncompress = needs_uncompress(auto_unwrap);
 
-  Filename local_filename(_local_filename);
-  if (do_uncompress) {
-    // .pz files are always binary, of course.
-    local_filename.set_binary();
+  // If the file has been prefetched, serve it from memory.
+  VirtualFileSystem *file_system = _mount->get_file_system();
+  if (file_system != (VirtualFileSystem *)NULL &&
+      file_system->get_read_cache()->fetch(this, do_uncompress, result)) {
+    return true;
   }
 
-  return _mount->read_file(local_filename, do_uncompress, result);
+  return do_read_file(result, do_uncompress);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSimple::get_mapped_data
+//       Access: Public, Virtual
+//  Description: If the contents of the file are already available in
+//               memory, fills in data and size with their location
+//               and returns true.  See VirtualFile::get_mapped_data().
+////////////////////////////////////////////////////////////////////
+bool VirtualFileSimple::
+get_mapped_data(const char *&data, size_t &size) const {
+  if (_implicit_pz_file) {
+    // The data in memory would still be compressed.
+    return false;
+  }
+
+  return _mount->get_mapped_data(_local_filename, data, size);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -504,3 +537,21 @@ scan_local_directory(VirtualFileList *file_list,
   
   return true;
 }
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSimple::do_read_file
+//       Access: Private
+//  Description: The part of read_file() that actually reads the file
+//               from its mount, bypassing the VirtualFileSystem's
+//               read cache.
+////////////////////////////////////////////////////////////////////
+bool VirtualFileSimple::
+do_read_file(pvector<unsigned char> &result, bool do_uncompress) const {
+  Filename local_filename(_local_filename);
+  if (do_uncompress) {
+    // .pz files are always binary, of course.
+    local_filename.set_binary();
+  }
+
+  return _mount->read_file(local_filename, do_uncompress, result);
+}
@@ -36,6 +36,7 @@ public:
 PUBLISHED:
   virtual VirtualFileSystem *get_file_system() const;
   INLINE VirtualFileMount *get_mount() const;
+  INLINE const Filename &get_local_filename() const;
   virtual Filename get_filename() const;
 
   virtual bool has_file() const;
@@ -68,12 +69,16 @@ public:
 
   virtual bool read_file(pvector<unsigned char> &result, bool auto_unwrap) const;
   virtual bool write_file(const unsigned char *data, size_t data_size, bool auto_wrap);
+  virtual bool get_mapped_data(const char *&data, size_t &size) const;
 
 protected:
   virtual bool scan_local_directory(VirtualFileList *file_list, 
                                     const ov_set<string> &mount_points) const;
 
 private:
+  INLINE bool needs_uncompress(bool auto_unwrap) const;
+  bool do_read_file(pvector<unsigned char> &result, bool do_uncompress) const;
+
   VirtualFileMount *_mount;
   Filename _local_filename;
   bool _implicit_pz_file;
@@ -99,6 +104,8 @@ public:
 
 private:
   static TypeHandle _type_handle;
+
+  friend class VirtualFileReadCache;
 };
 
 #include "virtualFileSimple.I"
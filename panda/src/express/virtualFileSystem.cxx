@@ -19,6 +19,7 @@
 #include "virtualFileMountMultifile.h"
 #include "virtualFileMountRamdisk.h"
 #include "virtualFileMountSystem.h"
+#include "virtualFileReadCache.h"
 #include "streamWrapper.h"
 #include "dSearchPath.h"
 #include "dcast.h"
@@ -65,10 +66,38 @@ VirtualFileSystem() :
             "will implicitly retrieve a file named 'dirname/mytex.jpg' "
             "within the multifile /c/files/foo.mf, even if the multifile "
             "has not already been mounted.  This makes all of your multifiles "
-            "act like directories."))
+            "act like directories.")),
+  vfs_path_cache
+  ("vfs-path-cache", true,
+   PRC_DESC("When this is true, the VirtualFileSystem remembers which mount "
+            "each file it has found was found in, so that looking up the "
+            "same file again need not search all of the mounts.  The cache "
+            "is emptied whenever a mount is added or removed.  A file that "
+            "is newly created on disk, in a mount that would take precedence "
+            "over the one the file was previously found in, will not be "
+            "noticed until then; call clear_path_cache() if this matters.")),
+  vfs_path_cache_size
+  ("vfs-path-cache-size", 65536,
+   PRC_DESC("The maximum number of filenames remembered by vfs-path-cache.  "
+            "When it is exceeded, the cache is emptied and starts over.")),
+  vfs_prefetch_threads
+  ("vfs-prefetch-threads", 2,
+   PRC_DESC("The maximum number of background threads that will be "
+            "started to read files requested by "
+            "VirtualFileSystem::prefetch().  The threads exit again when "
+            "there is nothing left to read.")),
+  vfs_read_cache_size
+  ("vfs-read-cache-size", 67108864,
+   PRC_DESC("The maximum number of bytes of file contents that are held in "
+            "memory after being read by VirtualFileSystem::prefetch().  "
+            "When this is exceeded, the least recently read files are "
+            "discarded.  Files that are not prefetched never consume any "
+            "of this memory."))
 {
   _cwd = "/";
   _mount_seq = 0;
+  _path_cache_seq = 0;
+  _read_cache = new VirtualFileReadCache(this);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -78,7 +107,14 @@ VirtualFileSystem() :
 ////////////////////////////////////////////////////////////////////
 VirtualFileSystem::
 ~VirtualFileSystem() {
+  // Let the prefetch threads finish the reads they have started
+  // first, since they may be reading from any of the mounts.
+  _read_cache->clear();
+  _read_cache->wait();
   unmount_all();
+
+  delete _read_cache;
+  _read_cache = NULL;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -217,6 +253,9 @@ mount(VirtualFileMount *mount, const Filename &mount_point, int flags) {
   _lock.acquire();
   bool result = do_mount(mount, mount_point, flags);
   _lock.release();
+
+  // The new mount may hide files that have already been prefetched.
+  _read_cache->clear();
   return result;
 }
 
@@ -262,6 +301,8 @@ unmount(Multifile *multifile) {
   _mounts.erase(wi, _mounts.end());
   ++_mount_seq;
   _lock.release();
+
+  _read_cache->clear();
   return num_removed;
 }
 
@@ -324,6 +365,8 @@ unmount(const Filename &physical_filename) {
   _mounts.erase(wi, _mounts.end());
   ++_mount_seq;
   _lock.release();
+
+  _read_cache->clear();
   return num_removed;
 }
 
@@ -360,6 +403,8 @@ unmount(VirtualFileMount *mount) {
   _mounts.erase(wi, _mounts.end());
   ++_mount_seq;
   _lock.release();
+
+  _read_cache->clear();
   return num_removed;
 }
 
@@ -399,6 +444,8 @@ unmount_point(const Filename &mount_point) {
   _mounts.erase(wi, _mounts.end());
   ++_mount_seq;
   _lock.release();
+
+  _read_cache->clear();
   return num_removed;
 }
 
@@ -425,6 +472,8 @@ unmount_all() {
   _mounts.clear();
   ++_mount_seq;
   _lock.release();
+
+  _read_cache->clear();
   return num_removed;
 }
 
@@ -459,6 +508,20 @@ get_mount(int n) const {
   return result;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSystem::clear_path_cache
+//       Access: Published
+//  Description: Forgets where previously-found files were found.
+//               This is done automatically whenever a mount is added
+//               or removed; see vfs-path-cache.
+////////////////////////////////////////////////////////////////////
+void VirtualFileSystem::
+clear_path_cache() {
+  _lock.acquire();
+  _path_cache.clear();
+  _lock.release();
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: VirtualFileSystem::chdir
 //       Access: Published
@@ -810,6 +873,95 @@ write(ostream &out) const {
 }
 
 
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSystem::prefetch
+//       Access: Published
+//  Description: Asks for the indicated file to be read into memory
+//               in the background, in anticipation of a future call
+//               to read_file() or open_read_file().  This returns
+//               immediately; the file is read by one of up to
+//               vfs-prefetch-threads worker threads.
+//
+//               Once it has been read, the file's contents remain in
+//               memory (subject to vfs-read-cache-size) until they
+//               are evicted by other prefetched files, or until the
+//               file is modified.  Any read of the file in the
+//               meantime, with the same auto_unwrap setting, is
+//               served from memory.
+////////////////////////////////////////////////////////////////////
+void VirtualFileSystem::
+prefetch(const Filename &filename, bool auto_unwrap) const {
+  _read_cache->prefetch(filename, auto_unwrap);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSystem::wait_prefetch
+//       Access: Published
+//  Description: Blocks until all of the files requested by previous
+//               calls to prefetch() have been read.
+////////////////////////////////////////////////////////////////////
+void VirtualFileSystem::
+wait_prefetch() const {
+  _read_cache->wait();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSystem::get_num_pending_prefetches
+//       Access: Published
+//  Description: Returns the number of files requested by prefetch()
+//               that have not yet been read.
+////////////////////////////////////////////////////////////////////
+int VirtualFileSystem::
+get_num_pending_prefetches() const {
+  return _read_cache->get_num_pending();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSystem::clear_read_cache
+//       Access: Published
+//  Description: Discards the contents of all prefetched files, and
+//               any prefetch requests that have not yet been started.
+////////////////////////////////////////////////////////////////////
+void VirtualFileSystem::
+clear_read_cache() {
+  _read_cache->clear();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSystem::get_read_cache_size
+//       Access: Published
+//  Description: Returns the number of bytes of prefetched file
+//               contents currently held in memory.
+////////////////////////////////////////////////////////////////////
+size_t VirtualFileSystem::
+get_read_cache_size() const {
+  return _read_cache->get_num_bytes();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSystem::get_read_cache_hits
+//       Access: Published
+//  Description: Returns the number of file reads that have been
+//               served from prefetched data.  Reads are only counted
+//               once prefetch() has been called at least once.
+////////////////////////////////////////////////////////////////////
+int VirtualFileSystem::
+get_read_cache_hits() const {
+  return _read_cache->get_num_hits();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSystem::get_read_cache_misses
+//       Access: Published
+//  Description: Returns the number of file reads that could not be
+//               served from prefetched data.  Reads are only counted
+//               once prefetch() has been called at least once.
+////////////////////////////////////////////////////////////////////
+int VirtualFileSystem::
+get_read_cache_misses() const {
+  return _read_cache->get_num_misses();
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: VirtualFileSystem::get_global_ptr
 //       Access: Published, Static
@@ -1287,6 +1439,62 @@ do_get_file(const Filename &filename, int open_flags) const {
   pathname.standardize();
   Filename strpath = pathname.get_filename_index(0).get_fullpath().substr(1);
   strpath.set_type(filename.get_type());
+
+  // We only remember plain lookups, not those that create a file or
+  // directory.
+  bool use_cache = vfs_path_cache && (open_flags & ~OF_status_only) == 0;
+  if (use_cache) {
+    if (_path_cache_seq != _mount_seq) {
+      _path_cache.clear();
+      _path_cache_seq = _mount_seq;
+    }
+
+    PathCache::iterator ci = _path_cache.find(strpath.get_fullpath());
+    if (ci != _path_cache.end()) {
+      const PathCacheEntry &entry = (*ci).second;
+      PT(VirtualFile) vfile = 
+        entry._mount->make_virtual_file(entry._local_filename, pathname,
+                                        entry._implicit_pz_file, open_flags);
+      if (vfile->has_file()) {
+        return vfile;
+      }
+
+      // The file has gone away since we found it; look for it again.
+      _path_cache.erase(ci);
+    }
+  }
+
+  PT(VirtualFile) found_file = 
+    do_scan_mounts(filename, pathname, strpath, open_flags);
+
+  if (use_cache && found_file != (VirtualFile *)NULL &&
+      found_file->is_exact_type(VirtualFileSimple::get_class_type()) &&
+      _path_cache_seq == _mount_seq) {
+    VirtualFileSimple *simple = DCAST(VirtualFileSimple, found_file);
+    if (!simple->is_directory()) {
+      if ((int)_path_cache.size() >= vfs_path_cache_size) {
+        _path_cache.clear();
+      }
+      PathCacheEntry &entry = _path_cache[strpath.get_fullpath()];
+      entry._mount = simple->get_mount();
+      entry._local_filename = simple->get_local_filename();
+      entry._implicit_pz_file = simple->is_implicit_pz_file();
+    }
+  }
+
+  return found_file;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VirtualFileSystem::do_scan_mounts
+//       Access: Private
+//  Description: The part of do_get_file() that searches each of the
+//               mounts in turn for the indicated file.  Assumes the
+//               lock is already held.
+////////////////////////////////////////////////////////////////////
+PT(VirtualFile) VirtualFileSystem::
+do_scan_mounts(const Filename &filename, const Filename &pathname,
+               const Filename &strpath, int open_flags) const {
   // Also transparently look for a regular file suffixed .pz.
   Filename strpath_pz = strpath + ".pz";
 
@@ -24,11 +24,14 @@
 #include "dSearchPath.h"
 #include "pointerTo.h"
 #include "config_express.h"
+#include "configVariableInt64.h"
 #include "mutexImpl.h"
 #include "pvector.h"
+#include "pmap.h"
 
 class Multifile;
 class VirtualFileComposite;
+class VirtualFileReadCache;
 
 ////////////////////////////////////////////////////////////////////
 //       Class : VirtualFileSystem
@@ -66,6 +69,8 @@ PUBLISHED:
   PT(VirtualFileMount) get_mount(int n) const;
   MAKE_SEQ(get_mounts, get_num_mounts, get_mount);
 
+  void clear_path_cache();
+
   BLOCKING bool chdir(const Filename &new_directory);
   BLOCKING Filename get_cwd() const;
   BLOCKING bool make_directory(const Filename &filename);
@@ -96,6 +101,14 @@ PUBLISHED:
 
   void write(ostream &out) const;
 
+  void prefetch(const Filename &filename, bool auto_unwrap) const;
+  BLOCKING void wait_prefetch() const;
+  int get_num_pending_prefetches() const;
+  void clear_read_cache();
+  size_t get_read_cache_size() const;
+  int get_read_cache_hits() const;
+  int get_read_cache_misses() const;
+
   static VirtualFileSystem *get_global_ptr();
 
   EXTENSION(BLOCKING PyObject *read_file(const Filename &filename, bool auto_unwrap) const);
@@ -124,6 +137,8 @@ public:
   INLINE bool write_file(const Filename &filename, const unsigned char *data, size_t data_size, bool auto_wrap);
 
   void scan_mount_points(vector_string &names, const Filename &path) const;
+
+  INLINE VirtualFileReadCache *get_read_cache() const;
  
   static void parse_options(const string &options,
                             int &flags, string &password);
@@ -147,11 +162,19 @@ public:
   ConfigVariableBool vfs_case_sensitive;
   ConfigVariableBool vfs_implicit_pz;
   ConfigVariableBool vfs_implicit_mf;
+  ConfigVariableBool vfs_path_cache;
+  ConfigVariableInt vfs_path_cache_size;
+  ConfigVariableInt vfs_prefetch_threads;
+  ConfigVariableInt64 vfs_read_cache_size;
 
 private:
   Filename normalize_mount_point(const Filename &mount_point) const;
   bool do_mount(VirtualFileMount *mount, const Filename &mount_point, int flags);
   PT(VirtualFile) do_get_file(const Filename &filename, int open_flags) const;
+  PT(VirtualFile) do_scan_mounts(const Filename &filename,
+                                 const Filename &pathname,
+                                 const Filename &strpath,
+                                 int open_flags) const;
 
   bool consider_match(PT(VirtualFile) &found_file, VirtualFileComposite *&composite_file,
                       VirtualFileMount *mount, const Filename &local_filename,
@@ -164,8 +187,24 @@ private:
   Mounts _mounts;
   unsigned int _mount_seq;
 
+  // Remembers the mount, and the file within it, in which each
+  // recently-resolved regular file was found, so that get_file()
+  // need not consider every mount again.  This is emptied whenever
+  // the set of mounts changes.
+  class PathCacheEntry {
+  public:
+    VirtualFileMount *_mount;
+    Filename _local_filename;
+    bool _implicit_pz_file;
+  };
+  typedef phash_map<string, PathCacheEntry, string_hash> PathCache;
+  mutable PathCache _path_cache;
+  mutable unsigned int _path_cache_seq;
+
   Filename _cwd;
 
+  VirtualFileReadCache *_read_cache;
+
   static VirtualFileSystem *_global_ptr;
 };
 
@@ -0,0 +1,219 @@
+// Filename: workerThreadGroup.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "workerThreadGroup.h"
+
+#if defined(THREAD_POSIX_IMPL) && defined(MUTEX_SPINLOCK)
+#include <sched.h>
+#endif
+
+////////////////////////////////////////////////////////////////////
+//     Function: WorkerThreadGroup::Constructor
+//       Access: Public
+//  Description: The indicated lock protects the state of the job
+//               that the threads work on.  It must be held around
+//               calls to wait() and notify_all(), and it must
+//               outlive the WorkerThreadGroup.
+////////////////////////////////////////////////////////////////////
+WorkerThreadGroup::
+WorkerThreadGroup(MutexImpl &lock) :
+  _lock(lock)
+{
+#if defined(THREAD_POSIX_IMPL) && !defined(MUTEX_SPINLOCK)
+  pthread_cond_init(&_cvar, NULL);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: WorkerThreadGroup::Destructor
+//       Access: Public
+//  Description: Waits for any threads that have not already been
+//               joined.  The caller should have told them to stop.
+////////////////////////////////////////////////////////////////////
+WorkerThreadGroup::
+~WorkerThreadGroup() {
+  join();
+
+#if defined(THREAD_POSIX_IMPL) && !defined(MUTEX_SPINLOCK)
+  pthread_cond_destroy(&_cvar);
+#elif defined(THREAD_WIN32_IMPL)
+  nassertv(_waiting_events.empty());
+  for (size_t i = 0; i < _free_events.size(); ++i) {
+    CloseHandle(_free_events[i]);
+  }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: WorkerThreadGroup::start_thread
+//       Access: Public
+//  Description: Starts a new thread, which calls thread_main(data)
+//               and exits when it returns.  Returns true if the
+//               thread was started, or false if it could not be (in
+//               which case the caller should do the work itself).
+////////////////////////////////////////////////////////////////////
+bool WorkerThreadGroup::
+start_thread(ThreadMain *thread_main, void *data) {
+#if defined(THREAD_POSIX_IMPL) || defined(THREAD_WIN32_IMPL)
+  StartInfo *info = new StartInfo;
+  info->_thread_main = thread_main;
+  info->_data = data;
+
+#if defined(THREAD_POSIX_IMPL)
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, &posix_thread_main, info) == 0) {
+    _threads.push_back(thread);
+    return true;
+  }
+#else
+  HANDLE thread = CreateThread(NULL, 0, &win32_thread_main, info, 0, NULL);
+  if (thread != NULL) {
+    _threads.push_back(thread);
+    return true;
+  }
+#endif
+
+  delete info;
+#endif  // THREAD_POSIX_IMPL || THREAD_WIN32_IMPL
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: WorkerThreadGroup::join
+//       Access: Public
+//  Description: Waits for all of the threads that have been started
+//               to exit.  The caller must not be holding the lock.
+////////////////////////////////////////////////////////////////////
+void WorkerThreadGroup::
+join() {
+#if defined(THREAD_POSIX_IMPL)
+  for (size_t i = 0; i < _threads.size(); ++i) {
+    pthread_join(_threads[i], NULL);
+  }
+  _threads.clear();
+
+#elif defined(THREAD_WIN32_IMPL)
+  for (size_t i = 0; i < _threads.size(); ++i) {
+    WaitForSingleObject(_threads[i], INFINITE);
+    CloseHandle(_threads[i]);
+  }
+  _threads.clear();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: WorkerThreadGroup::wait
+//       Access: Public
+//  Description: Releases the lock, which must be held by the calling
+//               thread, and sleeps until another thread calls
+//               notify_all(); then reacquires the lock before
+//               returning.
+//
+//               As with any condition variable, this may also return
+//               for no reason, so the caller should check its
+//               condition again in a loop.
+////////////////////////////////////////////////////////////////////
+void WorkerThreadGroup::
+wait() {
+#if defined(THREAD_POSIX_IMPL) && !defined(MUTEX_SPINLOCK)
+  pthread_cond_wait(&_cvar, _lock.get_posix_lock());
+
+#elif defined(THREAD_WIN32_IMPL)
+  HANDLE event;
+  if (_free_events.empty()) {
+    event = CreateEvent(NULL, false, false, NULL);
+    if (event == NULL) {
+      // Fall back to polling.
+      _lock.release();
+      Sleep(1);
+      _lock.acquire();
+      return;
+    }
+  } else {
+    event = _free_events.back();
+    _free_events.pop_back();
+  }
+  _waiting_events.push_back(event);
+  _lock.release();
+
+  WaitForSingleObject(event, INFINITE);
+
+  _lock.acquire();
+  _free_events.push_back(event);
+
+#else
+  // There's no condition variable to go with this kind of lock; just
+  // give the other threads a chance to run.
+  _lock.release();
+#if defined(THREAD_POSIX_IMPL)
+  sched_yield();
+#endif
+  _lock.acquire();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: WorkerThreadGroup::notify_all
+//       Access: Public
+//  Description: Wakes up all of the threads that are sleeping in
+//               wait().  The lock must be held by the calling thread.
+////////////////////////////////////////////////////////////////////
+void WorkerThreadGroup::
+notify_all() {
+#if defined(THREAD_POSIX_IMPL) && !defined(MUTEX_SPINLOCK)
+  pthread_cond_broadcast(&_cvar);
+
+#elif defined(THREAD_WIN32_IMPL)
+  for (size_t i = 0; i < _waiting_events.size(); ++i) {
+    SetEvent(_waiting_events[i]);
+  }
+  _waiting_events.clear();
+#endif
+}
+
+#if defined(THREAD_POSIX_IMPL)
+////////////////////////////////////////////////////////////////////
+//     Function: WorkerThreadGroup::posix_thread_main
+//       Access: Private, Static
+//  Description: The entry point for each thread.
+////////////////////////////////////////////////////////////////////
+void *WorkerThreadGroup::
+posix_thread_main(void *data) {
+  StartInfo *info = (StartInfo *)data;
+  ThreadMain *thread_main = info->_thread_main;
+  void *thread_data = info->_data;
+  delete info;
+
+  (*thread_main)(thread_data);
+  return NULL;
+}
+
+#elif defined(THREAD_WIN32_IMPL)
+////////////////////////////////////////////////////////////////////
+//     Function: WorkerThreadGroup::win32_thread_main
+//       Access: Private, Static
+//  Description: The entry point for each thread.
+////////////////////////////////////////////////////////////////////
+DWORD WINAPI WorkerThreadGroup::
+win32_thread_main(LPVOID data) {
+  StartInfo *info = (StartInfo *)data;
+  ThreadMain *thread_main = info->_thread_main;
+  void *thread_data = info->_data;
+  delete info;
+
+  (*thread_main)(thread_data);
+  return 0;
+}
+#endif
@@ -0,0 +1,95 @@
+// Filename: workerThreadGroup.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef WORKERTHREADGROUP_H
+#define WORKERTHREADGROUP_H
+
+#include "pandabase.h"
+#include "mutexImpl.h"
+#include "pvector.h"
+
+#if defined(THREAD_POSIX_IMPL)
+#include <pthread.h>
+#elif defined(THREAD_WIN32_IMPL)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+////////////////////////////////////////////////////////////////////
+//       Class : WorkerThreadGroup
+// Description : A handful of OS threads working on one job, along
+//               with a condition variable on the job's MutexImpl so
+//               that the threads (and the thread that owns the job)
+//               can sleep until there is something for them to do.
+//
+//               This is for the few classes in this package that do
+//               their work in parallel.  Since express is below
+//               pipeline, they can't use Thread or ConditionVar;
+//               this wraps the OS primitives for them instead.
+//
+//               If the build has no real threads, start_thread()
+//               always fails, and the caller should do the work
+//               itself.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDAEXPRESS WorkerThreadGroup {
+public:
+  typedef void ThreadMain(void *data);
+
+  WorkerThreadGroup(MutexImpl &lock);
+  ~WorkerThreadGroup();
+
+  INLINE static bool is_threading_supported();
+
+  bool start_thread(ThreadMain *thread_main, void *data);
+  INLINE int get_num_threads() const;
+  void join();
+
+  void wait();
+  void notify_all();
+
+private:
+  class StartInfo {
+  public:
+    ThreadMain *_thread_main;
+    void *_data;
+  };
+
+#if defined(THREAD_POSIX_IMPL)
+  static void *posix_thread_main(void *data);
+#elif defined(THREAD_WIN32_IMPL)
+  static DWORD WINAPI win32_thread_main(LPVOID data);
+#endif
+
+  MutexImpl &_lock;
+
+#if defined(THREAD_POSIX_IMPL)
+  pvector<pthread_t> _threads;
+#ifndef MUTEX_SPINLOCK
+  pthread_cond_t _cvar;
+#endif
+#elif defined(THREAD_WIN32_IMPL)
+  pvector<HANDLE> _threads;
+
+  // Each waiting thread sleeps on an event of its own, so that none
+  // of them can consume a wakeup meant for another.  The events are
+  // recycled through _free_events.  Both lists are protected by
+  // _lock.
+  pvector<HANDLE> _waiting_events;
+  pvector<HANDLE> _free_events;
+#endif
+};
+
+#include "workerThreadGroup.I"
+
+#endif
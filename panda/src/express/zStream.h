@@ -21,12 +21,14 @@
 #ifdef HAVE_ZLIB
 
 #include "zStreamBuf.h"
+#include "compressionCodec.h"
 
 ////////////////////////////////////////////////////////////////////
 //       Class : IDecompressStream
 // Description : An input stream object that uses zlib to decompress
 //               (inflate) the input from another source stream
-//               on-the-fly.
+//               on-the-fly.  It also recognizes and decompresses
+//               a stream that was written with CC_lz.
 //
 //               Attach an IDecompressStream to an existing istream that
 //               provides compressed data, and read the corresponding
@@ -62,10 +64,12 @@ class EXPCL_PANDAEXPRESS OCompressStream : public ostream {
 PUBLISHED:
   INLINE OCompressStream();
   INLINE OCompressStream(ostream *dest, bool owns_dest, 
-                           int compression_level = 6);
+                           int compression_level = 6,
+                           CompressionCodec codec = CC_zlib);
 
   INLINE OCompressStream &open(ostream *dest, bool owns_dest, 
-                               int compression_level = 6);
+                               int compression_level = 6,
+                               CompressionCodec codec = CC_zlib);
   INLINE OCompressStream &close();
 
 private:
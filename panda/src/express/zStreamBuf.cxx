@@ -19,18 +19,6 @@
 #include "pnotify.h"
 #include "config_express.h"
 
-#if !defined(USE_MEMORY_NOWRAPPERS)
-// Define functions that hook zlib into panda's memory allocation system.
-static void *
-do_zlib_alloc(voidpf opaque, uInt items, uInt size) {
-  return PANDA_MALLOC_ARRAY(items * size);
-}
-static void 
-do_zlib_free(voidpf opaque, voidpf address) {
-  PANDA_FREE_ARRAY(address);
-}
-#endif  //  !USE_MEMORY_NOWRAPPERS
-
 ////////////////////////////////////////////////////////////////////
 //     Function: ZStreamBuf::Constructor
 //       Access: Public
@@ -43,6 +31,10 @@ ZStreamBuf() {
   _dest = (ostream *)NULL;
   _owns_dest = false;
 
+  _read_codec = (StreamCodec *)NULL;
+  _read_failed = false;
+  _write_codec = (StreamCodec *)NULL;
+
 #ifdef PHAVE_IOSTREAM
   _buffer = (char *)PANDA_MALLOC_ARRAY(4096);
   char *ebuf = _buffer + 4096;
@@ -73,33 +65,15 @@ ZStreamBuf::
 ////////////////////////////////////////////////////////////////////
 //     Function: ZStreamBuf::open_read
 //       Access: Public
-//  Description:
+//  Description: The codec is not chosen until the first characters
+//               are read from the source.
 ////////////////////////////////////////////////////////////////////
 void ZStreamBuf::
 open_read(istream *source, bool owns_source) {
   _source = source;
   _owns_source = owns_source;
-
-  _z_source.next_in = Z_NULL;
-  _z_source.avail_in = 0;
-  _z_source.next_out = Z_NULL;
-  _z_source.avail_out = 0;
-#ifdef USE_MEMORY_NOWRAPPERS
-  _z_source.zalloc = Z_NULL;
-  _z_source.zfree = Z_NULL;
-#else
-  _z_source.zalloc = (alloc_func)&do_zlib_alloc;
-  _z_source.zfree = (free_func)&do_zlib_free;
-#endif
-  _z_source.opaque = Z_NULL;
-  _z_source.msg = (char *)"no error message";
-
-  int result = inflateInit(&_z_source);
-  if (result < 0) {
-    show_zlib_error("inflateInit", result, _z_source);
-    close_read();
-  }
-  thread_consider_yield();
+  _read_codec = (StreamCodec *)NULL;
+  _read_failed = false;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -110,12 +84,11 @@ open_read(istream *source, bool owns_source) {
 void ZStreamBuf::
 close_read() {
   if (_source != (istream *)NULL) {
-
-    int result = inflateEnd(&_z_source);
-    if (result < 0) {
-      show_zlib_error("inflateEnd", result, _z_source);
+    if (_read_codec != (StreamCodec *)NULL) {
+      _read_codec->close_read();
+      delete _read_codec;
+      _read_codec = (StreamCodec *)NULL;
     }
-    thread_consider_yield();
 
     if (_owns_source) {
       delete _source;
@@ -131,30 +104,24 @@ close_read() {
 //  Description:
 ////////////////////////////////////////////////////////////////////
 void ZStreamBuf::
-open_write(ostream *dest, bool owns_dest, int compression_level) {
+open_write(ostream *dest, bool owns_dest, int compression_level,
+           CompressionCodec codec) {
   _dest = dest;
   _owns_dest = owns_dest;
 
-  _z_dest.next_in = Z_NULL;
-  _z_dest.avail_in = 0;
-  _z_dest.next_out = Z_NULL;
-  _z_dest.avail_out = 0;
-#ifdef USE_MEMORY_NOWRAPPERS
-  _z_dest.zalloc = Z_NULL;
-  _z_dest.zfree = Z_NULL;
-#else
-  _z_dest.zalloc = (alloc_func)&do_zlib_alloc;
-  _z_dest.zfree = (free_func)&do_zlib_free;
-#endif
-  _z_dest.opaque = Z_NULL;
-  _z_dest.msg = (char *)"no error message";
+  _write_codec = StreamCodec::make_codec(codec);
+  if (_write_codec == (StreamCodec *)NULL) {
+    express_cat.warning()
+      << "Compression codec " << codec << " is not available.\n";
+    close_write();
+    return;
+  }
 
-  int result = deflateInit(&_z_dest, compression_level);
-  if (result < 0) {
-    show_zlib_error("deflateInit", result, _z_dest);
+  if (!_write_codec->open_write(_dest, compression_level)) {
+    delete _write_codec;
+    _write_codec = (StreamCodec *)NULL;
     close_write();
   }
-  thread_consider_yield();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -166,14 +133,14 @@ void ZStreamBuf::
 close_write() {
   if (_dest != (ostream *)NULL) {
     size_t n = pptr() - pbase();
-    write_chars(pbase(), n, Z_FINISH);
+    write_chars(pbase(), n, StreamCodec::FM_finish);
     pbump(-(int)n);
 
-    int result = deflateEnd(&_z_dest);
-    if (result < 0) {
-      show_zlib_error("deflateEnd", result, _z_dest);
+    if (_write_codec != (StreamCodec *)NULL) {
+      _write_codec->close_write();
+      delete _write_codec;
+      _write_codec = (StreamCodec *)NULL;
     }
-    thread_consider_yield();
 
     if (_owns_dest) {
       delete _dest;
@@ -193,14 +160,14 @@ int ZStreamBuf::
 overflow(int ch) {
   size_t n = pptr() - pbase();
   if (n != 0) {
-    write_chars(pbase(), n, 0);
+    write_chars(pbase(), n, StreamCodec::FM_none);
     pbump(-(int)n);
   }
 
   if (ch != EOF) {
     // Write one more character.
     char c = ch;
-    write_chars(&c, 1, 0);
+    write_chars(&c, 1, StreamCodec::FM_none);
   }
 
   return 0;
@@ -221,7 +188,7 @@ sync() {
 
   if (_dest != (ostream *)NULL) {
     size_t n = pptr() - pbase();
-    write_chars(pbase(), n, Z_SYNC_FLUSH);
+    write_chars(pbase(), n, StreamCodec::FM_sync);
     pbump(-(int)n);
   }
 
@@ -271,140 +238,57 @@ underflow() {
 ////////////////////////////////////////////////////////////////////
 size_t ZStreamBuf::
 read_chars(char *start, size_t length) {
-  _z_source.next_out = (Bytef *)start;
-  _z_source.avail_out = length;
-
-  bool eof = (_source->eof() || _source->fail());
-  int flush = 0;
-
-  while (_z_source.avail_out > 0) {
-    if (_z_source.avail_in == 0 && !eof) {
-      _source->read(decompress_buffer, decompress_buffer_size);
-      size_t read_count = _source->gcount();
-      eof = (read_count == 0 || _source->eof() || _source->fail());
-        
-      _z_source.next_in = (Bytef *)decompress_buffer;
-      _z_source.avail_in = read_count;
-    }
-    int result = inflate(&_z_source, flush);
-    thread_consider_yield();
-    size_t bytes_read = length - _z_source.avail_out;
-
-    if (result == Z_STREAM_END) {
-      // Here's the end of the file.
-      return bytes_read;
-
-    } else if (result == Z_BUF_ERROR && flush == 0) {
-      // We might get this if no progress is possible, for instance if
-      // the input stream is truncated.  In this case, tell zlib to
-      // dump everything it's got.
-      flush = Z_FINISH;
-
-    } else if (result < 0) {
-      show_zlib_error("inflate", result, _z_source);
-      return bytes_read;
+  if (_read_codec == (StreamCodec *)NULL) {
+    if (_read_failed || !detect_read_codec()) {
+      _read_failed = true;
+      return 0;
     }
   }
 
-  return length;
+  return _read_codec->read_chars(start, length);
 }
 
 ////////////////////////////////////////////////////////////////////
 //     Function: ZStreamBuf::write_chars
 //       Access: Private
-//  Description: Sends some characters to the dest stream.  The flush
-//               parameter is passed to deflate().
+//  Description: Sends some characters to the dest stream.
 ////////////////////////////////////////////////////////////////////
 void ZStreamBuf::
-write_chars(const char *start, size_t length, int flush) {
-  static const size_t compress_buffer_size = 4096;
-  char compress_buffer[compress_buffer_size];
-
-  _z_dest.next_in = (Bytef *)(char *)start;
-  _z_dest.avail_in = length;
-
-  _z_dest.next_out = (Bytef *)compress_buffer;
-  _z_dest.avail_out = compress_buffer_size;
-
-  int result = deflate(&_z_dest, flush);
-  if (result < 0 && result != Z_BUF_ERROR) {
-    show_zlib_error("deflate", result, _z_dest);
-  }
-  thread_consider_yield();
-
-  while (_z_dest.avail_in != 0) {
-    if (_z_dest.avail_out != compress_buffer_size) {
-      _dest->write(compress_buffer, compress_buffer_size - _z_dest.avail_out);
-      _z_dest.next_out = (Bytef *)compress_buffer;
-      _z_dest.avail_out = compress_buffer_size;
-    }
-    result = deflate(&_z_dest, flush);
-    if (result < 0) {
-      show_zlib_error("deflate", result, _z_dest);
-    }
-    thread_consider_yield();
-  }
-
-  while (_z_dest.avail_out != compress_buffer_size) {
-    _dest->write(compress_buffer, compress_buffer_size - _z_dest.avail_out);
-    _z_dest.next_out = (Bytef *)compress_buffer;
-    _z_dest.avail_out = compress_buffer_size;
-    result = deflate(&_z_dest, flush);
-    if (result < 0 && result != Z_BUF_ERROR) {
-      show_zlib_error("deflate", result, _z_dest);
-    }
-    thread_consider_yield();
+write_chars(const char *start, size_t length, StreamCodec::FlushMode flush) {
+  if (_write_codec != (StreamCodec *)NULL) {
+    _write_codec->write_chars(start, length, flush);
   }
 }
 
 ////////////////////////////////////////////////////////////////////
-//     Function: ZStreamBuf::show_zlib_error
+//     Function: ZStreamBuf::detect_read_codec
 //       Access: Private
-//  Description: Reports a recent error code returned by zlib.
+//  Description: Reads the first few bytes of the source stream to
+//               determine which codec wrote it, and starts that
+//               codec.  If no codec recognizes the bytes, zlib is
+//               assumed, so that zlib will report the error.  Returns
+//               true on success, false if no codec could be started.
 ////////////////////////////////////////////////////////////////////
-void ZStreamBuf::
-show_zlib_error(const char *function, int error_code, z_stream &z) {
-  stringstream error_line;
-
-  error_line
-    << "zlib error in " << function << ": ";
-  switch (error_code) {
-  case Z_OK:
-    error_line << "Z_OK";
-    break;
-  case Z_STREAM_END:
-    error_line << "Z_STREAM_END";
-    break;
-  case Z_NEED_DICT:
-    error_line << "Z_NEED_DICT";
-    break;
-  case Z_ERRNO:
-    error_line << "Z_ERRNO";
-    break;
-  case Z_STREAM_ERROR:
-    error_line << "Z_STREAM_ERROR";
-    break;
-  case Z_DATA_ERROR:
-    error_line << "Z_DATA_ERROR";
-    break;
-  case Z_MEM_ERROR:
-    error_line << "Z_MEM_ERROR";
-    break;
-  case Z_BUF_ERROR:
-    error_line << "Z_BUF_ERROR";
-    break;
-  case Z_VERSION_ERROR:
-    error_line << "Z_VERSION_ERROR";
-    break;
-  default:
-    error_line << error_code;
-  }
-  if (z.msg != (char *)NULL) {
-    error_line
-      << " = " << z.msg;
+bool ZStreamBuf::
+detect_read_codec() {
+  char header[StreamCodec::max_header_size];
+  _source->read(header, StreamCodec::max_header_size);
+  size_t read_count = _source->gcount();
+
+  _read_codec = StreamCodec::detect_codec(header, read_count);
+  if (_read_codec == (StreamCodec *)NULL) {
+    _read_codec = StreamCodec::make_codec(CC_zlib);
+    if (_read_codec == (StreamCodec *)NULL) {
+      return false;
+    }
   }
 
-  express_cat.warning() << error_line.str() << "\n";
+  if (!_read_codec->open_read(_source, header, read_count)) {
+    delete _read_codec;
+    _read_codec = (StreamCodec *)NULL;
+    return false;
+  }
+  return true;
 }
 
 #endif  // HAVE_ZLIB
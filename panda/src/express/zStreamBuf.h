@@ -20,12 +20,17 @@
 // This module is not compiled if zlib is not available.
 #ifdef HAVE_ZLIB
 
-#include <zlib.h>
+#include "compressionCodec.h"
+#include "streamCodec.h"
 
 ////////////////////////////////////////////////////////////////////
 //       Class : ZStreamBuf
 // Description : The streambuf object that implements
-//               IDecompressStream and OCompressStream.
+//               IDecompressStream and OCompressStream.  It handles
+//               the buffering, and passes the data to a StreamCodec
+//               to be compressed or decompressed.  When reading, the
+//               codec is detected from the first few bytes of the
+//               stream.
 ////////////////////////////////////////////////////////////////////
 class EXPCL_PANDAEXPRESS ZStreamBuf : public streambuf {
 public:
@@ -35,7 +40,8 @@ public:
   void open_read(istream *source, bool owns_source);
   void close_read();
 
-  void open_write(ostream *dest, bool owns_dest, int compression_level);
+  void open_write(ostream *dest, bool owns_dest, int compression_level,
+                  CompressionCodec codec = CC_zlib);
   void close_write();
 
 protected:
@@ -45,8 +51,10 @@ protected:
 
 private:
   size_t read_chars(char *start, size_t length);
-  void write_chars(const char *start, size_t length, int flush);
-  void show_zlib_error(const char *function, int error_code, z_stream &z);
+  void write_chars(const char *start, size_t length,
+                   StreamCodec::FlushMode flush);
+
+  bool detect_read_codec();
 
 private:
   istream *_source;
@@ -55,24 +63,13 @@ private:
   ostream *_dest;
   bool _owns_dest;
 
-  z_stream _z_source;
-  z_stream _z_dest;
-
   char *_buffer;
 
-  // We need to store the decompression buffer on the class object,
-  // because zlib might not consume all of the input characters at
-  // each call to inflate().  This isn't a problem on output because
-  // in that case we can afford to wait until it does consume all of
-  // the characters we give it.
-  enum {
-    // It's not clear how large or small this buffer ought to be.  It
-    // doesn't seem to matter much, especially since this is just a
-    // temporary holding area before getting copied into zlib's own
-    // internal buffers.
-    decompress_buffer_size = 128
-  };
-  char decompress_buffer[decompress_buffer_size];
+  // _read_codec is NULL until we have seen the start of the source
+  // stream.  _read_failed is set if the codec could not be started.
+  StreamCodec *_read_codec;
+  bool _read_failed;
+  StreamCodec *_write_codec;
 };
 
 #endif  // HAVE_ZLIB
@@ -26,6 +26,7 @@
     look_at_src.cxx look_at_src.h \
     linmath_events.h \
     mersenne.h \
+    meshSimplifier.h meshSimplifier.I \
     omniBoundingVolume.I  \
     omniBoundingVolume.h \
     parabola.h parabola_src.I parabola_src.cxx parabola_src.h \
@@ -41,7 +42,8 @@
     stackedPerlinNoise3.h stackedPerlinNoise3.I \
     triangulator.h triangulator.I \
     triangulator3.h triangulator3.I \
-    unionBoundingVolume.h unionBoundingVolume.I
+    unionBoundingVolume.h unionBoundingVolume.I \
+    vertexCacheOptimizer.h vertexCacheOptimizer.I
 
   #define INCLUDED_SOURCES \
     boundingHexahedron.cxx boundingLine.cxx \
@@ -54,6 +56,7 @@
     look_at.cxx \
     linmath_events.cxx \
     mersenne.cxx \
+    meshSimplifier.cxx \
     omniBoundingVolume.cxx \
     parabola.cxx \
     perlinNoise.cxx \
@@ -68,7 +71,8 @@
     stackedPerlinNoise3.cxx \
     triangulator.cxx \
     triangulator3.cxx \
-    unionBoundingVolume.cxx
+    unionBoundingVolume.cxx \
+    vertexCacheOptimizer.cxx
 
   #define INSTALL_HEADERS \
     boundingHexahedron.I boundingHexahedron.h boundingLine.I \
@@ -85,6 +89,7 @@
     look_at_src.I look_at_src.h \
     linmath_events.h \
     mersenne.h \
+    meshSimplifier.h meshSimplifier.I \
     omniBoundingVolume.I omniBoundingVolume.h \
     parabola.h parabola_src.I parabola_src.cxx parabola_src.h \
     perlinNoise.h perlinNoise.I \
@@ -97,7 +102,8 @@
     stackedPerlinNoise3.h stackedPerlinNoise3.I \
     triangulator.h triangulator.I \
     triangulator3.h triangulator3.I \
-    unionBoundingVolume.h unionBoundingVolume.I
+    unionBoundingVolume.h unionBoundingVolume.I \
+    vertexCacheOptimizer.h vertexCacheOptimizer.I
 
 
 
@@ -128,3 +134,13 @@
 
 #end test_bin_target
 
+#begin test_bin_target
+  #define TARGET test_simplify
+  #define LOCAL_LIBS \
+    p3mathutil p3pipeline
+  #define OTHER_LIBS $[OTHER_LIBS] p3pystub
+
+  #define SOURCES \
+    test_simplify.cxx
+
+#end test_bin_target
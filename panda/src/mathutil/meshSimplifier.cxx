@@ -0,0 +1,868 @@
+// Filename: meshSimplifier.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "meshSimplifier.h"
+#include "pmap.h"
+
+#include <algorithm>
+
+// The weight given to the planes that hold the open borders of the
+// mesh in place, relative to the area-weighted planes of the
+// triangles themselves.
+static const double border_weight = 10.0;
+
+// The same, for the planes that keep the seams from sliding sideways
+// across the surface.  A seam that moves is less noticeable than a
+// border that shrinks, which opens a gap.
+static const double seam_weight = 1.0;
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+MeshSimplifier::
+MeshSimplifier() {
+  clear();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::clear
+//       Access: Public
+//  Description: Removes all of the vertices and triangles, so that a
+//               new mesh may be built up.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+clear() {
+  _vertices.clear();
+  _triangles.clear();
+  _queue.clear();
+  _num_live_triangles = 0;
+  _max_cost = 0.0;
+  _prepared = false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::add_vertex
+//       Access: Public
+//  Description: Adds a new vertex to the mesh, and returns its index.
+//               Vertices will only be collapsed onto other vertices
+//               with the same vertex_class.
+////////////////////////////////////////////////////////////////////
+int MeshSimplifier::
+add_vertex(const LPoint3 &pos, int vertex_class) {
+  nassertr(!_prepared, -1);
+  Vertex vertex;
+  vertex._pos = LCAST(double, pos);
+  vertex._class = vertex_class;
+  vertex._locked = false;
+  vertex._border = false;
+  vertex._dead = false;
+  vertex._pos_index = (int)_vertices.size();
+  vertex._next_at_pos = vertex._pos_index;
+  vertex._target = -1;
+  vertex._cost = 0.0;
+  vertex._stamp = 0;
+  _vertices.push_back(vertex);
+  return (int)_vertices.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::add_triangle
+//       Access: Public
+//  Description: Adds a new triangle to the mesh, referencing three
+//               previously-added vertices.  Degenerate triangles are
+//               silently dropped.
+//
+//               The group is not used by the simplification; it is
+//               simply reported again by get_triangles(), so that
+//               triangles from several primitives may be simplified
+//               together and then returned to their own primitives.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+add_triangle(int a, int b, int c, int group) {
+  nassertv(!_prepared);
+  int num_vertices = (int)_vertices.size();
+  nassertv(a >= 0 && a < num_vertices &&
+           b >= 0 && b < num_vertices &&
+           c >= 0 && c < num_vertices);
+  if (a == b || b == c || c == a) {
+    return;
+  }
+
+  Triangle tri;
+  tri._v[0] = a;
+  tri._v[1] = b;
+  tri._v[2] = c;
+  tri._group = group;
+  tri._dead = false;
+  _triangles.push_back(tri);
+  ++_num_live_triangles;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::simplify
+//       Access: Public
+//  Description: Collapses vertices, cheapest first, until no more
+//               than target_triangles remain, or until the next
+//               collapse would introduce an error larger than
+//               max_error (if max_error is greater than zero), or
+//               until no more vertices can be collapsed.
+//
+//               Returns the largest error introduced by any of the
+//               collapses.  This is the root-mean-square distance of
+//               a removed vertex's new position from the planes of
+//               the original triangles around it, so it is in the
+//               same units as the vertex positions.
+//
+//               This may be called repeatedly with successively
+//               smaller targets; the return value is always the
+//               largest error since the mesh was built.
+////////////////////////////////////////////////////////////////////
+double MeshSimplifier::
+simplify(int target_triangles, double max_error) {
+  if (!_prepared) {
+    prepare();
+  }
+
+  double max_cost = max_error * max_error;
+  while (_num_live_triangles > target_triangles && !_queue.empty()) {
+    pop_heap(_queue.begin(), _queue.end());
+    Collapse collapse = _queue.back();
+    _queue.pop_back();
+
+    const Vertex &vertex = _vertices[collapse._vertex];
+    if (vertex._dead || vertex._target < 0 ||
+        collapse._stamp != vertex._stamp) {
+      // This entry has been superseded.
+      continue;
+    }
+    if (max_error > 0.0 && collapse._cost > max_cost) {
+      // Put it back; a later call might allow a bigger error.
+      _queue.push_back(collapse);
+      push_heap(_queue.begin(), _queue.end());
+      break;
+    }
+
+    _max_cost = max(_max_cost, collapse._cost);
+    do_collapse(collapse._vertex);
+  }
+
+  return sqrt(_max_cost);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::get_triangles
+//       Access: Public
+//  Description: Fills indices with the three vertex indices of each
+//               of the remaining triangles, in their original order.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+get_triangles(vector_int &indices) const {
+  indices.clear();
+  indices.reserve(_num_live_triangles * 3);
+  Triangles::const_iterator ti;
+  for (ti = _triangles.begin(); ti != _triangles.end(); ++ti) {
+    const Triangle &tri = (*ti);
+    if (!tri._dead) {
+      indices.push_back(tri._v[0]);
+      indices.push_back(tri._v[1]);
+      indices.push_back(tri._v[2]);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::get_triangles
+//       Access: Public
+//  Description: As above, but also fills groups with the group that
+//               each of the remaining triangles was added with.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+get_triangles(vector_int &indices, vector_int &groups) const {
+  get_triangles(indices);
+  groups.clear();
+  groups.reserve(_num_live_triangles);
+  Triangles::const_iterator ti;
+  for (ti = _triangles.begin(); ti != _triangles.end(); ++ti) {
+    if (!(*ti)._dead) {
+      groups.push_back((*ti)._group);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::prepare
+//       Access: Private
+//  Description: Called once, before the first collapse, to build the
+//               adjacency tables and the quadric of each vertex, and
+//               to find the seam, border and non-manifold vertices.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+prepare() {
+  _prepared = true;
+  int num_vertices = (int)_vertices.size();
+  int num_triangles = (int)_triangles.size();
+
+  // Vertices that share a position lie on a seam in some other
+  // attribute; these are linked together, so that they can be
+  // collapsed together.  The edges are counted by position, rather
+  // than by vertex, so that a seam does not look like an open border.
+  typedef pmap<LPoint3d, int> Positions;
+  Positions positions;
+  int vi;
+  for (vi = 0; vi < num_vertices; ++vi) {
+    Vertex &vertex = _vertices[vi];
+    pair<Positions::iterator, bool> result =
+      positions.insert(Positions::value_type(vertex._pos, vi));
+    int first = (*result.first).second;
+    if (first != vi) {
+      vertex._pos_index = first;
+      vertex._next_at_pos = _vertices[first]._next_at_pos;
+      _vertices[first]._next_at_pos = vi;
+    }
+  }
+
+  // Each edge is recorded by the positions at its ends, and by the
+  // vertices at those positions.  An edge whose two triangles use
+  // different vertices lies along a seam.
+  typedef pair<int, int> Edge;
+  typedef pvector< pair<Edge, Edge> > EdgeRecords;
+  EdgeRecords edges;
+  edges.reserve(num_triangles * 3);
+  int ti;
+  for (ti = 0; ti < num_triangles; ++ti) {
+    const Triangle &tri = _triangles[ti];
+    for (int k = 0; k < 3; ++k) {
+      int a = tri._v[k];
+      int b = tri._v[(k + 1) % 3];
+      int pa = _vertices[a]._pos_index;
+      int pb = _vertices[b]._pos_index;
+      if (pa == pb) {
+        continue;
+      }
+      if (pa > pb) {
+        swap(a, b);
+        swap(pa, pb);
+      }
+      edges.push_back(EdgeRecords::value_type(Edge(pa, pb), Edge(a, b)));
+    }
+  }
+  sort(edges.begin(), edges.end());
+
+  typedef pvector<Edge> Edges;
+  Edges border_edges;
+  Edges seam_edges;
+  EdgeRecords::const_iterator ei = edges.begin();
+  while (ei != edges.end()) {
+    EdgeRecords::const_iterator ej = ei;
+    int count = 0;
+    bool seam = false;
+    while (ej != edges.end() && (*ej).first == (*ei).first) {
+      if ((*ej).second != (*ei).second) {
+        seam = true;
+      }
+      ++ej;
+      ++count;
+    }
+    const Edge &edge = (*ei).first;
+    if (count == 1) {
+      _vertices[edge.first]._border = true;
+      _vertices[edge.second]._border = true;
+      border_edges.push_back(edge);
+    } else if (count > 2) {
+      // A non-manifold edge.  Leave it alone.
+      _vertices[edge.first]._locked = true;
+      _vertices[edge.second]._locked = true;
+    } else if (seam) {
+      seam_edges.push_back(edge);
+    }
+    ei = ej;
+  }
+
+  // The above flags were set on the first vertex at each position;
+  // they apply to all of the others there too.
+  for (vi = 0; vi < num_vertices; ++vi) {
+    Vertex &vertex = _vertices[vi];
+    const Vertex &first = _vertices[vertex._pos_index];
+    vertex._border = vertex._border || first._border;
+    vertex._locked = vertex._locked || first._locked;
+  }
+
+  // Now accumulate the plane of each triangle into its vertices'
+  // quadrics, along with a plane perpendicular to each of its open
+  // edges, to keep the borders from shrinking, and to each of its
+  // seam edges, to keep the seams in place.
+  for (ti = 0; ti < num_triangles; ++ti) {
+    const Triangle &tri = _triangles[ti];
+    const LPoint3d &p0 = _vertices[tri._v[0]]._pos;
+    LVector3d normal = calc_normal(p0, _vertices[tri._v[1]]._pos,
+                                   _vertices[tri._v[2]]._pos);
+    double length = normal.length();
+    if (length == 0.0) {
+      continue;
+    }
+    normal /= length;
+    double area = length * 0.5;
+    double d = -normal.dot(p0);
+
+    for (int k = 0; k < 3; ++k) {
+      Vertex &vertex = _vertices[tri._v[k]];
+      vertex._quadric.add_plane(normal, d, area);
+      vertex._quadric._area += area;
+      vertex._triangles.push_back(ti);
+
+      int a = _vertices[tri._v[k]]._pos_index;
+      int b = _vertices[tri._v[(k + 1) % 3]]._pos_index;
+      Edge edge(min(a, b), max(a, b));
+      double edge_weight = 0.0;
+      if (binary_search(border_edges.begin(), border_edges.end(), edge)) {
+        edge_weight = border_weight;
+      } else if (binary_search(seam_edges.begin(), seam_edges.end(), edge)) {
+        edge_weight = seam_weight;
+      }
+      if (edge_weight != 0.0) {
+        const LPoint3d &pa = _vertices[tri._v[k]]._pos;
+        const LPoint3d &pb = _vertices[tri._v[(k + 1) % 3]]._pos;
+        LVector3d edge_normal = (pb - pa).cross(normal);
+        double edge_length = edge_normal.length();
+        if (edge_length != 0.0) {
+          edge_normal /= edge_length;
+          double edge_d = -edge_normal.dot(pa);
+          double weight = edge_length * edge_length * edge_weight;
+          _vertices[tri._v[k]]._quadric.add_plane(edge_normal, edge_d, weight);
+          _vertices[tri._v[(k + 1) % 3]]._quadric.add_plane(edge_normal, edge_d, weight);
+        }
+      }
+    }
+  }
+
+  _queue.clear();
+  _queue.reserve(num_vertices);
+  for (vi = 0; vi < num_vertices; ++vi) {
+    compute_collapse(vi);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::prune_triangles
+//       Access: Private
+//  Description: Removes the triangles that have since been removed
+//               from the mesh from the vertex's list of triangles.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+prune_triangles(int vi) {
+  Vertex &vertex = _vertices[vi];
+  vector_int::iterator ti, tj;
+  tj = vertex._triangles.begin();
+  for (ti = vertex._triangles.begin(); ti != vertex._triangles.end(); ++ti) {
+    if (!_triangles[*ti]._dead) {
+      (*tj) = (*ti);
+      ++tj;
+    }
+  }
+  vertex._triangles.erase(tj, vertex._triangles.end());
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::get_copies
+//       Access: Private
+//  Description: Fills copies with the vertices at the same position
+//               as the indicated vertex, including itself, that are
+//               still used by any triangles.  If there is more than
+//               one, the vertex is on a seam.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+get_copies(int vi, vector_int &copies) {
+  copies.clear();
+  int ci = vi;
+  do {
+    if (!_vertices[ci]._dead) {
+      prune_triangles(ci);
+      if (!_vertices[ci]._triangles.empty()) {
+        copies.push_back(ci);
+      }
+    }
+    ci = _vertices[ci]._next_at_pos;
+  } while (ci != vi);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::compute_collapse
+//       Access: Private
+//  Description: Finds the cheapest valid collapse of the indicated
+//               vertex onto one of its neighbors, and adds it to the
+//               queue.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+compute_collapse(int vi) {
+  Vertex &vertex = _vertices[vi];
+  ++vertex._stamp;
+  vertex._target = -1;
+  if (vertex._dead || vertex._locked) {
+    return;
+  }
+
+  vector_int &copies = _copies;
+  get_copies(vi, copies);
+  if (copies.size() > 1) {
+    compute_seam_collapse(vi, copies);
+    return;
+  }
+
+  Candidates &candidates = _candidates;
+  candidates.clear();
+  vector_int::const_iterator ti;
+  for (ti = vertex._triangles.begin(); ti != vertex._triangles.end(); ++ti) {
+    const Triangle &tri = _triangles[*ti];
+    for (int k = 0; k < 3; ++k) {
+      int ni = tri._v[k];
+      if (ni == vi) {
+        continue;
+      }
+      Candidates::const_iterator ci;
+      for (ci = candidates.begin(); ci != candidates.end(); ++ci) {
+        if ((*ci).second == ni) {
+          break;
+        }
+      }
+      if (ci != candidates.end()) {
+        continue;
+      }
+
+      const Vertex &target = _vertices[ni];
+      if (target._class != vertex._class) {
+        continue;
+      }
+      if (vertex._border) {
+        // A border vertex may only move along a border edge.
+        int count = 0;
+        vector_int::const_iterator tk;
+        for (tk = vertex._triangles.begin(); tk != vertex._triangles.end(); ++tk) {
+          const Triangle &other = _triangles[*tk];
+          if (other._v[0] == ni || other._v[1] == ni || other._v[2] == ni) {
+            ++count;
+          }
+        }
+        if (count != 1 || !target._border) {
+          continue;
+        }
+      }
+
+      Quadric quadric = vertex._quadric;
+      quadric += target._quadric;
+      double cost = quadric.evaluate(target._pos);
+      if (quadric._area > 0.0) {
+        cost /= quadric._area;
+      }
+      candidates.push_back(Candidates::value_type(max(cost, 0.0), ni));
+    }
+  }
+
+  sort(candidates.begin(), candidates.end());
+  VertexPairs &pairs = _pairs;
+  Candidates::const_iterator ci;
+  for (ci = candidates.begin(); ci != candidates.end(); ++ci) {
+    pairs.clear();
+    pairs.push_back(VertexPairs::value_type(vi, (*ci).second));
+    if (is_valid_collapse(pairs)) {
+      queue_collapse(vi, (*ci).second, (*ci).first);
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::compute_seam_collapse
+//       Access: Private
+//  Description: The version of compute_collapse() for a vertex that
+//               shares its position with the other vertices in
+//               copies.  These may only be collapsed all together,
+//               along the seam, and only where the seam runs straight
+//               through their position: that is, where exactly two
+//               seam edges, and no open border, meet there.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+compute_seam_collapse(int vi, const vector_int &copies) {
+  const Vertex &vertex = _vertices[vi];
+
+  Neighbors &neighbors = _seam_neighbors;
+  neighbors.clear();
+  vector_int::const_iterator ci;
+  for (ci = copies.begin(); ci != copies.end(); ++ci) {
+    const Vertex &copy = _vertices[*ci];
+    if (copy._locked || copy._border) {
+      return;
+    }
+    vector_int::const_iterator ti;
+    for (ti = copy._triangles.begin(); ti != copy._triangles.end(); ++ti) {
+      const Triangle &tri = _triangles[*ti];
+      for (int k = 0; k < 3; ++k) {
+        if (tri._v[k] == (*ci)) {
+          continue;
+        }
+        Neighbor neighbor;
+        neighbor._pos_index = _vertices[tri._v[k]]._pos_index;
+        neighbor._vertex = tri._v[k];
+        neighbor._copy = (*ci);
+        if (neighbor._pos_index == vertex._pos_index) {
+          // A triangle with no area.  Leave it alone.
+          return;
+        }
+        neighbors.push_back(neighbor);
+      }
+    }
+  }
+  sort(neighbors.begin(), neighbors.end());
+
+  // Each triangle around the position contributes one neighbor at
+  // each of its other two positions, so a manifold edge has exactly
+  // two.  The edge is a seam edge if its two triangles use different
+  // vertices at either end.
+  int seam_pos[2];
+  int num_seam_edges = 0;
+  Neighbors::const_iterator ni = neighbors.begin();
+  while (ni != neighbors.end()) {
+    Neighbors::const_iterator nj = ni;
+    int count = 0;
+    bool seam = false;
+    while (nj != neighbors.end() && (*nj)._pos_index == (*ni)._pos_index) {
+      if ((*nj)._copy != (*ni)._copy || (*nj)._vertex != (*ni)._vertex) {
+        seam = true;
+      }
+      ++nj;
+      ++count;
+    }
+    if (count != 2) {
+      // An open border or a non-manifold edge.
+      return;
+    }
+    if (seam) {
+      if (num_seam_edges == 2) {
+        // More than one seam meets here.
+        return;
+      }
+      seam_pos[num_seam_edges] = (*ni)._pos_index;
+      ++num_seam_edges;
+    }
+    ni = nj;
+  }
+  if (num_seam_edges != 2) {
+    // This is the end of a seam.
+    return;
+  }
+
+  Candidates &candidates = _candidates;
+  candidates.clear();
+  VertexPairs &pairs = _pairs;
+  for (int i = 0; i < num_seam_edges; ++i) {
+    if (!get_seam_pairs(copies, seam_pos[i], pairs)) {
+      continue;
+    }
+
+    // The cost is that of moving the whole position, with all of the
+    // triangles around it, onto the other.  Two vertices may be
+    // collapsed onto the same target at the end of a seam.
+    Quadric quadric;
+    VertexPairs::const_iterator pi, pj;
+    for (pi = pairs.begin(); pi != pairs.end(); ++pi) {
+      quadric += _vertices[(*pi).first]._quadric;
+      for (pj = pairs.begin(); pj != pi && (*pj).second != (*pi).second; ++pj) {
+      }
+      if (pj == pi) {
+        quadric += _vertices[(*pi).second]._quadric;
+      }
+    }
+    double cost = quadric.evaluate(_vertices[seam_pos[i]]._pos);
+    if (quadric._area > 0.0) {
+      cost /= quadric._area;
+    }
+    candidates.push_back(Candidates::value_type(max(cost, 0.0), seam_pos[i]));
+  }
+
+  sort(candidates.begin(), candidates.end());
+  Candidates::const_iterator di;
+  for (di = candidates.begin(); di != candidates.end(); ++di) {
+    get_seam_pairs(copies, (*di).second, pairs);
+    if (is_valid_collapse(pairs)) {
+      VertexPairs::const_iterator pi;
+      for (pi = pairs.begin(); pi != pairs.end(); ++pi) {
+        if ((*pi).first == vi) {
+          queue_collapse(vi, (*pi).second, (*di).first);
+          return;
+        }
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::queue_collapse
+//       Access: Private
+//  Description: Records the collapse of the indicated vertex onto the
+//               indicated target as the best one for that vertex,
+//               and adds it to the queue.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+queue_collapse(int vi, int target, double cost) {
+  Vertex &vertex = _vertices[vi];
+  vertex._target = target;
+  vertex._cost = cost;
+
+  Collapse collapse;
+  collapse._cost = cost;
+  collapse._vertex = vi;
+  collapse._stamp = vertex._stamp;
+  _queue.push_back(collapse);
+  push_heap(_queue.begin(), _queue.end());
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::get_seam_pairs
+//       Access: Private
+//  Description: Fills pairs with each of the vertices in copies,
+//               which share a position, and the vertex at the
+//               indicated other position that it shares a triangle
+//               with, which it would be collapsed onto.  Returns
+//               false if any of them is adjacent to none or more than
+//               one of the vertices at that position, or to one of a
+//               different class.
+////////////////////////////////////////////////////////////////////
+bool MeshSimplifier::
+get_seam_pairs(const vector_int &copies, int pos_index,
+               VertexPairs &pairs) const {
+  pairs.clear();
+  vector_int::const_iterator ci;
+  for (ci = copies.begin(); ci != copies.end(); ++ci) {
+    const Vertex &copy = _vertices[*ci];
+    int target = -1;
+    vector_int::const_iterator ti;
+    for (ti = copy._triangles.begin(); ti != copy._triangles.end(); ++ti) {
+      const Triangle &tri = _triangles[*ti];
+      for (int k = 0; k < 3; ++k) {
+        if (_vertices[tri._v[k]]._pos_index == pos_index) {
+          if (target >= 0 && target != tri._v[k]) {
+            return false;
+          }
+          target = tri._v[k];
+        }
+      }
+    }
+    if (target < 0 || _vertices[target]._class != copy._class) {
+      return false;
+    }
+    pairs.push_back(VertexPairs::value_type(*ci, target));
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::is_valid_collapse
+//       Access: Private
+//  Description: Returns true if each of the indicated vertices, which
+//               share a position, may be collapsed onto its target
+//               without folding the mesh over onto itself: that is,
+//               without flipping any of the remaining triangles, and
+//               without joining two parts of the mesh that were not
+//               already joined by the edge being collapsed.
+////////////////////////////////////////////////////////////////////
+bool MeshSimplifier::
+is_valid_collapse(const VertexPairs &pairs) const {
+  nassertr(!pairs.empty(), false);
+  int pos_index = _vertices[pairs[0].first]._pos_index;
+  const LPoint3d &new_pos = _vertices[pairs[0].second]._pos;
+
+  vector_int &neighbors = _neighbors;
+  vector_int &opposite = _opposite;
+  neighbors.clear();
+  opposite.clear();
+  VertexPairs::const_iterator pi;
+  vector_int::const_iterator ti;
+  for (pi = pairs.begin(); pi != pairs.end(); ++pi) {
+    int vi = (*pi).first;
+    int target = (*pi).second;
+    const Vertex &vertex = _vertices[vi];
+    for (ti = vertex._triangles.begin(); ti != vertex._triangles.end(); ++ti) {
+      const Triangle &tri = _triangles[*ti];
+      if (tri._v[0] == target || tri._v[1] == target || tri._v[2] == target) {
+        // This triangle will be removed.
+        for (int k = 0; k < 3; ++k) {
+          if (tri._v[k] != vi && tri._v[k] != target) {
+            opposite.push_back(_vertices[tri._v[k]]._pos_index);
+          }
+        }
+        continue;
+      }
+
+      LPoint3d p[3];
+      LPoint3d q[3];
+      for (int k = 0; k < 3; ++k) {
+        p[k] = _vertices[tri._v[k]]._pos;
+        q[k] = (tri._v[k] == vi) ? new_pos : p[k];
+        if (tri._v[k] != vi) {
+          neighbors.push_back(_vertices[tri._v[k]]._pos_index);
+        }
+      }
+      LVector3d old_normal = calc_normal(p[0], p[1], p[2]);
+      LVector3d new_normal = calc_normal(q[0], q[1], q[2]);
+      if (new_normal.dot(old_normal) <= 0.0 ||
+          new_normal.length_squared() <= old_normal.length_squared() * 1.0e-6) {
+        return false;
+      }
+    }
+  }
+
+  // The link condition: the only positions adjacent to both ends of
+  // the edge may be the ones opposite it.  This is checked by
+  // position, so that the two sides of a seam are not pinched
+  // together either.
+  sort(neighbors.begin(), neighbors.end());
+  neighbors.erase(unique(neighbors.begin(), neighbors.end()), neighbors.end());
+  sort(opposite.begin(), opposite.end());
+  opposite.erase(unique(opposite.begin(), opposite.end()), opposite.end());
+
+  for (pi = pairs.begin(); pi != pairs.end(); ++pi) {
+    int target = (*pi).second;
+    const Vertex &target_vertex = _vertices[target];
+    for (ti = target_vertex._triangles.begin();
+         ti != target_vertex._triangles.end();
+         ++ti) {
+      const Triangle &tri = _triangles[*ti];
+      if (tri._dead ||
+          _vertices[tri._v[0]]._pos_index == pos_index ||
+          _vertices[tri._v[1]]._pos_index == pos_index ||
+          _vertices[tri._v[2]]._pos_index == pos_index) {
+        continue;
+      }
+      for (int k = 0; k < 3; ++k) {
+        int ni = _vertices[tri._v[k]]._pos_index;
+        if (tri._v[k] != target &&
+            binary_search(neighbors.begin(), neighbors.end(), ni) &&
+            !binary_search(opposite.begin(), opposite.end(), ni)) {
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::do_collapse
+//       Access: Private
+//  Description: Collapses the indicated vertex onto the target chosen
+//               by compute_collapse(), along with the other vertices
+//               at its position if it is on a seam, and recomputes
+//               the collapses of all of the vertices whose
+//               neighborhood changed.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+do_collapse(int vi) {
+  int target = _vertices[vi]._target;
+  nassertv(target >= 0);
+
+  VertexPairs &pairs = _pairs;
+  vector_int &copies = _copies;
+  get_copies(vi, copies);
+  if (copies.size() > 1) {
+    bool found = get_seam_pairs(copies, _vertices[target]._pos_index, pairs);
+    nassertv(found);
+  } else {
+    pairs.clear();
+    pairs.push_back(VertexPairs::value_type(vi, target));
+  }
+
+  vector_int &affected = _affected;
+  affected.clear();
+  VertexPairs::const_iterator pi;
+  for (pi = pairs.begin(); pi != pairs.end(); ++pi) {
+    collapse_vertex((*pi).first, (*pi).second);
+  }
+
+  // Whether a vertex on a seam can be collapsed depends on the
+  // neighborhoods of all of the vertices at its position.
+  size_t num_affected = affected.size();
+  for (size_t i = 0; i < num_affected; ++i) {
+    int ai = affected[i];
+    for (int ci = _vertices[ai]._next_at_pos;
+         ci != ai;
+         ci = _vertices[ci]._next_at_pos) {
+      affected.push_back(ci);
+    }
+  }
+  sort(affected.begin(), affected.end());
+  affected.erase(unique(affected.begin(), affected.end()), affected.end());
+
+  vector_int::const_iterator ai;
+  for (ai = affected.begin(); ai != affected.end(); ++ai) {
+    if (!_vertices[*ai]._dead) {
+      compute_collapse(*ai);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: MeshSimplifier::collapse_vertex
+//       Access: Private
+//  Description: Collapses the indicated vertex onto the indicated
+//               target, and adds all of the vertices whose
+//               neighborhood changed to _affected.
+////////////////////////////////////////////////////////////////////
+void MeshSimplifier::
+collapse_vertex(int vi, int target) {
+  Vertex &vertex = _vertices[vi];
+  Vertex &target_vertex = _vertices[target];
+
+  vector_int &affected = _affected;
+  vector_int::const_iterator ti;
+  for (ti = vertex._triangles.begin(); ti != vertex._triangles.end(); ++ti) {
+    Triangle &tri = _triangles[*ti];
+    if (tri._dead) {
+      continue;
+    }
+    for (int k = 0; k < 3; ++k) {
+      affected.push_back(tri._v[k]);
+    }
+
+    if (tri._v[0] == target || tri._v[1] == target || tri._v[2] == target) {
+      tri._dead = true;
+      --_num_live_triangles;
+    } else {
+      for (int k = 0; k < 3; ++k) {
+        if (tri._v[k] == vi) {
+          tri._v[k] = target;
+        }
+      }
+      target_vertex._triangles.push_back(*ti);
+    }
+  }
+
+  target_vertex._quadric += vertex._quadric;
+  vertex._dead = true;
+  vertex._triangles.clear();
+
+  // The neighbors of the target have new triangles, and the target
+  // itself has a new quadric.
+  for (ti = target_vertex._triangles.begin();
+       ti != target_vertex._triangles.end();
+       ++ti) {
+    const Triangle &tri = _triangles[*ti];
+    if (!tri._dead) {
+      for (int k = 0; k < 3; ++k) {
+        affected.push_back(tri._v[k]);
+      }
+    }
+  }
+}
@@ -0,0 +1,182 @@
+// Filename: meshSimplifier.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include "pandabase.h"
+#include "luse.h"
+#include "vector_int.h"
+#include "pvector.h"
+#include "pnotify.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : MeshSimplifier
+// Description : This class reduces the number of triangles in an
+//               indexed triangle mesh, using the quadric error metric
+//               of Garland and Heckbert ("Surface Simplification
+//               Using Quadric Error Metrics", 1997).
+//
+//               Each step collapses one vertex onto one of its
+//               neighbors (a "half-edge" collapse), so the surviving
+//               vertices are always a subset of the original
+//               vertices.  This means that all of the other vertex
+//               attributes (normals, colors, texture coordinates,
+//               joint weights) remain valid without having to be
+//               interpolated.
+//
+//               Vertices that share a position with another vertex
+//               lie on a seam in some other attribute (a UV seam, or
+//               a hard edge in the normals).  All of the vertices at
+//               such a position are collapsed together, each onto
+//               the vertex on its own side of the seam at the next
+//               position along the seam, so the seam stays closed
+//               and keeps its shape.  The ends of a seam, and the
+//               places where seams meet, are never collapsed.
+//
+//               A vertex may also be given a class, and will only be
+//               collapsed onto a vertex of the same class; this is
+//               used to keep vertices with different joint weights
+//               apart.  Vertices on an open border may only slide
+//               along the border.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDA_MATHUTIL MeshSimplifier {
+public:
+  MeshSimplifier();
+
+  void clear();
+  int add_vertex(const LPoint3 &pos, int vertex_class = 0);
+  INLINE void lock_vertex(int n);
+  void add_triangle(int a, int b, int c, int group = 0);
+
+  INLINE int get_num_vertices() const;
+  INLINE int get_num_triangles() const;
+
+  double simplify(int target_triangles, double max_error = 0.0);
+  void get_triangles(vector_int &indices) const;
+  void get_triangles(vector_int &indices, vector_int &groups) const;
+
+private:
+  // The quadric error function, as a symmetric 4x4 matrix, plus the
+  // total area of the planes that have been accumulated into it.
+  class Quadric {
+  public:
+    INLINE Quadric();
+    INLINE void add_plane(const LVector3d &normal, double d, double weight);
+    INLINE void operator += (const Quadric &other);
+    INLINE double evaluate(const LPoint3d &point) const;
+
+    double _a2, _ab, _ac, _ad;
+    double _b2, _bc, _bd;
+    double _c2, _cd;
+    double _d2;
+    double _area;
+  };
+
+  class Vertex {
+  public:
+    LPoint3d _pos;
+    int _class;
+    bool _locked;
+    bool _border;
+    bool _dead;
+
+    // The first vertex with the same position, which stands for the
+    // position as a whole, and the next vertex with the same
+    // position, in a circular list.
+    int _pos_index;
+    int _next_at_pos;
+
+    // The best collapse found for this vertex.  If the vertex is on a
+    // seam, the other vertices at its position collapse along with
+    // it.  _stamp is incremented every time this is recomputed, to
+    // invalidate any older entries in the queue.
+    int _target;
+    double _cost;
+    int _stamp;
+
+    Quadric _quadric;
+    vector_int _triangles;
+  };
+  typedef pvector<Vertex> Vertices;
+
+  class Triangle {
+  public:
+    int _v[3];
+    int _group;
+    bool _dead;
+  };
+  typedef pvector<Triangle> Triangles;
+
+  class Collapse {
+  public:
+    INLINE bool operator < (const Collapse &other) const;
+
+    double _cost;
+    int _vertex;
+    int _stamp;
+  };
+  typedef pvector<Collapse> CollapseQueue;
+  typedef pvector< pair<double, int> > Candidates;
+
+  // One vertex adjacent to one of the vertices at a seam position.
+  class Neighbor {
+  public:
+    INLINE bool operator < (const Neighbor &other) const;
+
+    int _pos_index;
+    int _vertex;
+    int _copy;
+  };
+  typedef pvector<Neighbor> Neighbors;
+
+  // A vertex and the vertex it is to be collapsed onto.
+  typedef pvector< pair<int, int> > VertexPairs;
+
+  void prepare();
+  void prune_triangles(int vi);
+  void get_copies(int vi, vector_int &copies);
+  void compute_collapse(int vi);
+  void compute_seam_collapse(int vi, const vector_int &copies);
+  void queue_collapse(int vi, int target, double cost);
+  bool get_seam_pairs(const vector_int &copies, int pos_index,
+                      VertexPairs &pairs) const;
+  bool is_valid_collapse(const VertexPairs &pairs) const;
+  void do_collapse(int vi);
+  void collapse_vertex(int vi, int target);
+
+  INLINE LVector3d calc_normal(const LPoint3d &p0, const LPoint3d &p1,
+                               const LPoint3d &p2) const;
+
+  Vertices _vertices;
+  Triangles _triangles;
+  int _num_live_triangles;
+  double _max_cost;
+  CollapseQueue _queue;
+  bool _prepared;
+
+  // Scratch space, kept here to avoid reallocating it for every
+  // collapse.
+  Candidates _candidates;
+  vector_int _affected;
+  vector_int _copies;
+  Neighbors _seam_neighbors;
+  VertexPairs _pairs;
+  mutable vector_int _neighbors;
+  mutable vector_int _opposite;
+};
+
+#include "meshSimplifier.I"
+
+#endif
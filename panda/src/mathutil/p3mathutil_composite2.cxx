@@ -2,6 +2,7 @@
 #include "linmath_events.cxx"
 #include "look_at.cxx"
 #include "mersenne.cxx"
+#include "meshSimplifier.cxx"
 #include "perlinNoise.cxx"
 #include "perlinNoise2.cxx"
 #include "perlinNoise3.cxx"
@@ -17,3 +18,4 @@
 #include "stackedPerlinNoise3.cxx"
 #include "triangulator.cxx"
 #include "triangulator3.cxx"
+#include "vertexCacheOptimizer.cxx"
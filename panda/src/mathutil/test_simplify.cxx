@@ -0,0 +1,173 @@
+// Filename: test_simplify.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "meshSimplifier.h"
+#include "trueClock.h"
+#include "cmath.h"
+#include "pmap.h"
+
+// This program first simplifies a flat-shaded cube, whose faces are
+// finely subdivided but do not share any vertices, so that every
+// edge of the cube is a seam in the normals.  The cube must come
+// down to a handful of triangles without losing its shape or opening
+// up along its edges.
+//
+// Then it builds a large, smoothly curved height field and simplifies
+// it to a series of smaller triangle counts, reporting the time taken
+// and the error introduced at each step.
+
+////////////////////////////////////////////////////////////////////
+//     Function: test_hard_cube
+//  Description: Simplifies a cube of six separately-vertexed faces of
+//               size x size quads each.  Returns true if it was
+//               reduced to at most twice the 12 triangles that it
+//               really needs, without moving the surface and with
+//               each edge still shared by exactly two triangles.
+////////////////////////////////////////////////////////////////////
+static bool
+test_hard_cube(int size) {
+  // The origin and the two axes of each face, such that the cross
+  // product of the axes points outward.
+  static const int faces[6][3][3] = {
+    { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+    { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+    { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+    { { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+    { { 0, 0, 0 }, { 0, 1, 0 }, { 1, 0, 0 } },
+    { { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+  };
+
+  MeshSimplifier simplifier;
+  pvector<LPoint3> positions;
+  for (int f = 0; f < 6; ++f) {
+    int first = simplifier.get_num_vertices();
+    for (int j = 0; j <= size; ++j) {
+      for (int i = 0; i <= size; ++i) {
+        LPoint3 pos;
+        for (int c = 0; c < 3; ++c) {
+          pos[c] = faces[f][0][c] * size + faces[f][1][c] * i + faces[f][2][c] * j;
+        }
+        simplifier.add_vertex(pos);
+        positions.push_back(pos);
+      }
+    }
+    for (int j = 0; j < size; ++j) {
+      for (int i = 0; i < size; ++i) {
+        int a = first + j * (size + 1) + i;
+        int b = a + 1;
+        int c = a + size + 1;
+        int d = c + 1;
+        simplifier.add_triangle(a, b, d);
+        simplifier.add_triangle(a, d, c);
+      }
+    }
+  }
+
+  int num_triangles = simplifier.get_num_triangles();
+  double error = simplifier.simplify(0, 0.001);
+  int num_remaining = simplifier.get_num_triangles();
+  nout << "hard-edged cube: " << num_triangles << " triangles reduced to "
+       << num_remaining << ", error " << error << "\n";
+
+  bool ok = true;
+  if (num_remaining > 24) {
+    nout << "  not reduced enough!\n";
+    ok = false;
+  }
+  if (error > 1.0e-6) {
+    nout << "  error too large!\n";
+    ok = false;
+  }
+
+  // Count the uses of each edge by position.  A seam that had been
+  // collapsed on one side only would leave some edges used once.
+  typedef pmap<pair<LPoint3, LPoint3>, int> EdgeCounts;
+  EdgeCounts edge_counts;
+  vector_int indices;
+  simplifier.get_triangles(indices);
+  for (size_t n = 0; n < indices.size(); n += 3) {
+    for (int k = 0; k < 3; ++k) {
+      LPoint3 a = positions[indices[n + k]];
+      LPoint3 b = positions[indices[n + (k + 1) % 3]];
+      if (b < a) {
+        swap(a, b);
+      }
+      ++edge_counts[pair<LPoint3, LPoint3>(a, b)];
+    }
+  }
+  EdgeCounts::const_iterator ei;
+  for (ei = edge_counts.begin(); ei != edge_counts.end(); ++ei) {
+    if ((*ei).second != 2) {
+      nout << "  edge " << (*ei).first.first << " - " << (*ei).first.second
+           << " is used by " << (*ei).second << " triangles!\n";
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+int
+main(int argc, char *argv[]) {
+  int size = 400;
+  if (argc >= 2) {
+    size = atoi(argv[1]);
+  }
+  if (argc > 2 || size <= 0) {
+    nout << "test_simplify [grid-size]\n";
+    exit(1);
+  }
+
+  if (!test_hard_cube(20)) {
+    nout << "Simplification of hard-edged cube failed!\n";
+    return (1);
+  }
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+
+  MeshSimplifier simplifier;
+  int x, y;
+  for (y = 0; y <= size; ++y) {
+    for (x = 0; x <= size; ++x) {
+      PN_stdfloat z = 5.0f * csin(x * 0.05f) * ccos(y * 0.05f);
+      simplifier.add_vertex(LPoint3(x, y, z));
+    }
+  }
+  for (y = 0; y < size; ++y) {
+    for (x = 0; x < size; ++x) {
+      int a = y * (size + 1) + x;
+      int b = a + 1;
+      int c = a + size + 1;
+      int d = c + 1;
+      simplifier.add_triangle(a, b, d);
+      simplifier.add_triangle(a, d, c);
+    }
+  }
+  int num_triangles = simplifier.get_num_triangles();
+  nout << num_triangles << " triangles built in "
+       << clock->get_short_time() - start << " s\n";
+
+  static const double ratios[] = { 0.5, 0.25, 0.1, 0.01 };
+  static const int num_ratios = sizeof(ratios) / sizeof(ratios[0]);
+  for (int i = 0; i < num_ratios; ++i) {
+    start = clock->get_short_time();
+    double error = simplifier.simplify((int)(num_triangles * ratios[i]));
+    nout << "  " << ratios[i] << ": " << simplifier.get_num_triangles()
+         << " triangles, error " << error << ", "
+         << clock->get_short_time() - start << " s\n";
+  }
+
+  return (0);
+}
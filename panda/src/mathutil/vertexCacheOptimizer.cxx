@@ -0,0 +1,406 @@
+// Filename: vertexCacheOptimizer.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "vertexCacheOptimizer.h"
+#include "pvector.h"
+
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////
+//     Function: VertexCacheOptimizer::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+VertexCacheOptimizer::
+VertexCacheOptimizer(int cache_size) :
+  _cache_size(cache_size)
+{
+  nassertv(_cache_size > 3);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VertexCacheOptimizer::compute_triangle_order
+//       Access: Public
+//  Description: Given a list of vertex indices, three per triangle,
+//               fills triangle_order with the triangle numbers in the
+//               order in which they should be drawn.  The indices
+//               themselves are not modified.
+////////////////////////////////////////////////////////////////////
+void VertexCacheOptimizer::
+compute_triangle_order(const vector_int &indices,
+                       vector_int &triangle_order) const {
+  triangle_order.clear();
+  int num_triangles = (int)indices.size() / 3;
+  if (num_triangles == 0) {
+    return;
+  }
+  triangle_order.reserve(num_triangles);
+
+  int num_vertices = 0;
+  vector_int::const_iterator ii;
+  for (ii = indices.begin(); ii != indices.begin() + num_triangles * 3; ++ii) {
+    nassertv((*ii) >= 0);
+    num_vertices = max(num_vertices, (*ii) + 1);
+  }
+
+  // Count the triangles that use each vertex, and build a flat list
+  // of the triangles adjacent to each vertex.  The first
+  // _num_remaining entries of each vertex's portion of this list are
+  // the triangles that have not yet been emitted.
+  Vertices vertices(num_vertices);
+  int vi;
+  for (vi = 0; vi < num_vertices; ++vi) {
+    vertices[vi]._num_remaining = 0;
+  }
+  for (ii = indices.begin(); ii != indices.begin() + num_triangles * 3; ++ii) {
+    ++vertices[*ii]._num_remaining;
+  }
+
+  int offset = 0;
+  for (vi = 0; vi < num_vertices; ++vi) {
+    VertexData &vertex = vertices[vi];
+    vertex._first_triangle = offset;
+    offset += vertex._num_remaining;
+    vertex._score = calc_vertex_score(-1, vertex._num_remaining);
+  }
+
+  vector_int adjacency(num_triangles * 3);
+  vector_int num_filled(num_vertices, 0);
+  int ti;
+  for (ti = 0; ti < num_triangles; ++ti) {
+    for (int k = 0; k < 3; ++k) {
+      int v = indices[ti * 3 + k];
+      adjacency[vertices[v]._first_triangle + num_filled[v]] = ti;
+      ++num_filled[v];
+    }
+  }
+
+  pvector<float> triangle_scores(num_triangles);
+  pvector<bool> emitted(num_triangles, false);
+  int best_triangle = 0;
+  for (ti = 0; ti < num_triangles; ++ti) {
+    triangle_scores[ti] =
+      vertices[indices[ti * 3]]._score +
+      vertices[indices[ti * 3 + 1]]._score +
+      vertices[indices[ti * 3 + 2]]._score;
+    if (triangle_scores[ti] > triangle_scores[best_triangle]) {
+      best_triangle = ti;
+    }
+  }
+
+  vector_int cache, new_cache;
+  cache.reserve(_cache_size + 3);
+  new_cache.reserve(_cache_size + 3);
+  int next_unemitted = 0;
+
+  while ((int)triangle_order.size() < num_triangles) {
+    if (best_triangle < 0) {
+      // None of the triangles touching the cache are left.  Rather
+      // than searching the whole mesh for the best triangle, which
+      // would make us quadratic, just take the next one in the
+      // original order.
+      while (emitted[next_unemitted]) {
+        ++next_unemitted;
+      }
+      best_triangle = next_unemitted;
+    }
+
+    int tri = best_triangle;
+    triangle_order.push_back(tri);
+    emitted[tri] = true;
+
+    // Remove the triangle from its vertices' lists of remaining
+    // triangles, and move its vertices to the front of the cache.
+    new_cache.clear();
+    int k;
+    for (k = 0; k < 3; ++k) {
+      int v = indices[tri * 3 + k];
+      VertexData &vertex = vertices[v];
+      int *adj = &adjacency[vertex._first_triangle];
+      for (int ai = 0; ai < vertex._num_remaining; ++ai) {
+        if (adj[ai] == tri) {
+          adj[ai] = adj[vertex._num_remaining - 1];
+          adj[vertex._num_remaining - 1] = tri;
+          --vertex._num_remaining;
+          break;
+        }
+      }
+
+      if (find(new_cache.begin(), new_cache.end(), v) == new_cache.end()) {
+        new_cache.push_back(v);
+      }
+    }
+    int num_new = (int)new_cache.size();
+    vector_int::const_iterator oi;
+    for (oi = cache.begin(); oi != cache.end(); ++oi) {
+      if (find(new_cache.begin(), new_cache.begin() + num_new, *oi) ==
+          new_cache.begin() + num_new) {
+        new_cache.push_back(*oi);
+      }
+    }
+
+    // Now rescore the vertices whose position in the cache has
+    // changed (including those that just fell out of the cache), and
+    // propagate the change in score to their remaining triangles.
+    best_triangle = -1;
+    float best_score = -1.0f;
+    int num_cached = (int)new_cache.size();
+    for (int ci = 0; ci < num_cached; ++ci) {
+      VertexData &vertex = vertices[new_cache[ci]];
+      int cache_pos = (ci < _cache_size) ? ci : -1;
+      float score = calc_vertex_score(cache_pos, vertex._num_remaining);
+      float delta = score - vertex._score;
+      vertex._score = score;
+
+      const int *adj = &adjacency[vertex._first_triangle];
+      for (int ai = 0; ai < vertex._num_remaining; ++ai) {
+        triangle_scores[adj[ai]] += delta;
+      }
+    }
+
+    // The next triangle is the best one that touches the cache.
+    num_cached = min(num_cached, _cache_size);
+    for (int ci = 0; ci < num_cached; ++ci) {
+      const VertexData &vertex = vertices[new_cache[ci]];
+      const int *adj = &adjacency[vertex._first_triangle];
+      for (int ai = 0; ai < vertex._num_remaining; ++ai) {
+        if (triangle_scores[adj[ai]] > best_score) {
+          best_score = triangle_scores[adj[ai]];
+          best_triangle = adj[ai];
+        }
+      }
+    }
+
+    new_cache.resize(num_cached);
+    cache.swap(new_cache);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VertexCacheOptimizer::optimize
+//       Access: Public
+//  Description: Reorders the triangles of the indicated triangle
+//               list in-place.  The vertices of each triangle are
+//               kept in their original order, so the winding of the
+//               triangles is preserved.
+////////////////////////////////////////////////////////////////////
+void VertexCacheOptimizer::
+optimize(vector_int &indices) const {
+  vector_int triangle_order;
+  compute_triangle_order(indices, triangle_order);
+
+  vector_int new_indices;
+  new_indices.reserve(indices.size());
+  vector_int::const_iterator ti;
+  for (ti = triangle_order.begin(); ti != triangle_order.end(); ++ti) {
+    new_indices.push_back(indices[(*ti) * 3]);
+    new_indices.push_back(indices[(*ti) * 3 + 1]);
+    new_indices.push_back(indices[(*ti) * 3 + 2]);
+  }
+  indices.swap(new_indices);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VertexCacheOptimizer::reorder_vertices
+//       Access: Public, Static
+//  Description: Renumbers the vertices so that they appear in the
+//               same order in which the indices first reference them,
+//               which improves the locality of vertex fetches.  This
+//               should be done after the triangles have been
+//               reordered.
+//
+//               The indices are rewritten in-place, and old_to_new is
+//               filled with the new number of each original vertex.
+//               Vertices that aren't referenced at all are numbered
+//               after all the others.
+////////////////////////////////////////////////////////////////////
+void VertexCacheOptimizer::
+reorder_vertices(vector_int &indices, int num_vertices,
+                 vector_int &old_to_new) {
+  old_to_new.assign(num_vertices, -1);
+  int next_vertex = 0;
+
+  vector_int::iterator ii;
+  for (ii = indices.begin(); ii != indices.end(); ++ii) {
+    nassertv((*ii) >= 0 && (*ii) < num_vertices);
+    int &new_index = old_to_new[*ii];
+    if (new_index < 0) {
+      new_index = next_vertex;
+      ++next_vertex;
+    }
+    (*ii) = new_index;
+  }
+
+  for (ii = old_to_new.begin(); ii != old_to_new.end(); ++ii) {
+    if ((*ii) < 0) {
+      (*ii) = next_vertex;
+      ++next_vertex;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VertexCacheOptimizer::calc_acmr
+//       Access: Public, Static
+//  Description: Returns the average cache miss ratio of the
+//               indicated triangle list: the number of vertices that
+//               would have to be transformed, per triangle, by
+//               hardware with a FIFO vertex cache of the indicated
+//               size.  This ranges from 3.0 in the worst case to
+//               about 0.5 for a very regular mesh.
+////////////////////////////////////////////////////////////////////
+double VertexCacheOptimizer::
+calc_acmr(const vector_int &indices, int cache_size) {
+  int num_triangles = (int)indices.size() / 3;
+  if (num_triangles == 0) {
+    return 0.0;
+  }
+
+  int num_vertices = 0;
+  vector_int::const_iterator ii;
+  for (ii = indices.begin(); ii != indices.end(); ++ii) {
+    num_vertices = max(num_vertices, (*ii) + 1);
+  }
+
+  // Rather than actually maintaining a FIFO, we record the time at
+  // which each vertex entered the cache; it has been pushed out by
+  // the time cache_size more vertices have entered after it.
+  vector_int entered(num_vertices, -1);
+  int num_misses = 0;
+  for (ii = indices.begin(); ii != indices.begin() + num_triangles * 3; ++ii) {
+    int &time = entered[*ii];
+    if (time < 0 || num_misses - time >= cache_size) {
+      time = num_misses;
+      ++num_misses;
+    }
+  }
+
+  return (double)num_misses / (double)num_triangles;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: VertexCacheOptimizer::optimize_overdraw
+//       Access: Public
+//  Description: Reorders a triangle list that has already been sorted
+//               by optimize(), to reduce overdraw, without undoing
+//               much of the vertex cache benefit.  This is the
+//               approach of Sander, Nehab and Barczak ("Fast Triangle
+//               Reordering for Vertex Locality and Reduced Overdraw",
+//               2007): the list is cut into clusters of at least
+//               min_cluster_size triangles, at points where the
+//               simulated cache has to be refilled anyway, and the
+//               clusters are then sorted so that those that face
+//               outwards from the center of the mesh are drawn first.
+//
+//               The vertices array gives the position of each vertex
+//               referenced by the indices.
+////////////////////////////////////////////////////////////////////
+void VertexCacheOptimizer::
+optimize_overdraw(vector_int &indices, const pvector<LPoint3> &vertices,
+                  int min_cluster_size) const {
+  int num_triangles = (int)indices.size() / 3;
+  int num_vertices = (int)vertices.size();
+  if (num_triangles <= min_cluster_size) {
+    return;
+  }
+
+  // First, find the cluster boundaries: places where all three
+  // vertices of a triangle miss the cache.
+  vector_int cluster_starts;
+  vector_int entered(num_vertices, -1);
+  int num_misses = 0;
+  int ti;
+  for (ti = 0; ti < num_triangles; ++ti) {
+    int tri_misses = 0;
+    for (int k = 0; k < 3; ++k) {
+      int v = indices[ti * 3 + k];
+      nassertv(v >= 0 && v < num_vertices);
+      int &time = entered[v];
+      if (time < 0 || num_misses - time >= _cache_size) {
+        time = num_misses;
+        ++num_misses;
+        ++tri_misses;
+      }
+    }
+    if (ti == 0 ||
+        (tri_misses == 3 && ti - cluster_starts.back() >= min_cluster_size)) {
+      cluster_starts.push_back(ti);
+    }
+  }
+  int num_clusters = (int)cluster_starts.size();
+  if (num_clusters < 2) {
+    return;
+  }
+  cluster_starts.push_back(num_triangles);
+
+  // Now compute the area-weighted centroid and normal of each
+  // cluster, and of the mesh as a whole.
+  pvector<LPoint3> centroids(num_clusters);
+  pvector<LVector3> normals(num_clusters);
+  LPoint3 mesh_centroid(0.0f, 0.0f, 0.0f);
+  PN_stdfloat mesh_area = 0.0f;
+  int ci;
+  for (ci = 0; ci < num_clusters; ++ci) {
+    LPoint3 centroid(0.0f, 0.0f, 0.0f);
+    LVector3 normal(0.0f, 0.0f, 0.0f);
+    PN_stdfloat area = 0.0f;
+    for (ti = cluster_starts[ci]; ti < cluster_starts[ci + 1]; ++ti) {
+      const LPoint3 &p0 = vertices[indices[ti * 3]];
+      const LPoint3 &p1 = vertices[indices[ti * 3 + 1]];
+      const LPoint3 &p2 = vertices[indices[ti * 3 + 2]];
+      LVector3 cross_product = (p1 - p0).cross(p2 - p0);
+      PN_stdfloat tri_area = cross_product.length();
+      centroid += (p0 + p1 + p2) * (tri_area / 3.0f);
+      normal += cross_product;
+      area += tri_area;
+    }
+    mesh_centroid += centroid;
+    mesh_area += area;
+    if (area > 0.0f) {
+      centroid /= area;
+    }
+    normal.normalize();
+    centroids[ci] = centroid;
+    normals[ci] = normal;
+  }
+  if (mesh_area > 0.0f) {
+    mesh_centroid /= mesh_area;
+  }
+
+  // Clusters that face away from the center of the mesh are likely
+  // to occlude the others, so they should be drawn first.
+  typedef pvector< pair<PN_stdfloat, int> > ClusterOrder;
+  ClusterOrder order;
+  order.reserve(num_clusters);
+  for (ci = 0; ci < num_clusters; ++ci) {
+    PN_stdfloat dist = (centroids[ci] - mesh_centroid).dot(normals[ci]);
+    order.push_back(ClusterOrder::value_type(-dist, ci));
+  }
+  stable_sort(order.begin(), order.end());
+
+  vector_int new_indices;
+  new_indices.reserve(num_triangles * 3);
+  ClusterOrder::const_iterator oi;
+  for (oi = order.begin(); oi != order.end(); ++oi) {
+    int first = cluster_starts[(*oi).second];
+    int last = cluster_starts[(*oi).second + 1];
+    new_indices.insert(new_indices.end(), indices.begin() + first * 3,
+                       indices.begin() + last * 3);
+  }
+  // Any stray indices beyond the last whole triangle are kept at the
+  // end.
+  new_indices.insert(new_indices.end(), indices.begin() + num_triangles * 3,
+                     indices.end());
+  indices.swap(new_indices);
+}
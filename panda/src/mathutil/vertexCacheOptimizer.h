@@ -0,0 +1,76 @@
+// Filename: vertexCacheOptimizer.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef VERTEXCACHEOPTIMIZER_H
+#define VERTEXCACHEOPTIMIZER_H
+
+#include "pandabase.h"
+#include "vector_int.h"
+#include "pnotify.h"
+#include "cmath.h"
+#include "luse.h"
+#include "pvector.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : VertexCacheOptimizer
+// Description : This class reorders the triangles of an indexed
+//               triangle list so that vertices are reused while they
+//               are still in the post-transform vertex cache.  It is
+//               an implementation of the greedy algorithm described
+//               by Tom Forsyth in "Linear-Speed Vertex Cache
+//               Optimisation" (2006), which runs in time roughly
+//               linear in the number of triangles, and does not
+//               depend on knowing the exact cache size of the
+//               hardware.
+//
+//               It works strictly on integer vertex indices, three
+//               per triangle; it is up to the caller to map its own
+//               vertices and triangles to and from these indices.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDA_MATHUTIL VertexCacheOptimizer {
+public:
+  VertexCacheOptimizer(int cache_size = 32);
+
+  INLINE void set_cache_size(int cache_size);
+  INLINE int get_cache_size() const;
+
+  void compute_triangle_order(const vector_int &indices,
+                              vector_int &triangle_order) const;
+  void optimize(vector_int &indices) const;
+  void optimize_overdraw(vector_int &indices,
+                         const pvector<LPoint3> &vertices,
+                         int min_cluster_size = 64) const;
+
+  static void reorder_vertices(vector_int &indices, int num_vertices,
+                               vector_int &old_to_new);
+  static double calc_acmr(const vector_int &indices, int cache_size);
+
+private:
+  INLINE float calc_vertex_score(int cache_pos, int num_remaining) const;
+
+  int _cache_size;
+
+  // The per-vertex bookkeeping used by compute_triangle_order().
+  class VertexData {
+  public:
+    int _num_remaining;
+    int _first_triangle;
+    float _score;
+  };
+  typedef pvector<VertexData> Vertices;
+};
+
+#include "vertexCacheOptimizer.I"
+
+#endif
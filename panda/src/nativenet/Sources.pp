@@ -19,7 +19,7 @@
     socket_tcp_listen.h time_accumulator.h time_out.h \
     socket_address.h \
     socket_portable.h  time_base.h time_span.h buffered_datagramwriter.h \
-    socket_base.h socket_selector.h \
+    socket_base.h socket_poller.h socket_selector.h \
     socket_udp.h \
     socket_udp_incoming.h time_clock.h \
     membuffer.h membuffer.i socket_fdset.h socket_tcp.h \
@@ -44,7 +44,7 @@
     buffered_datagramreader.h buffered_datagramreader.i \
     socket_address.h \
     socket_portable.h time_base.h time_span.h buffered_datagramwriter.h \
-    socket_base.h socket_selector.h \
+    socket_base.h socket_poller.h socket_selector.h \
     socket_udp.h \
     socket_udp_incoming.h time_clock.h \
     membuffer.h membuffer.i socket_fdset.h socket_tcp.h \
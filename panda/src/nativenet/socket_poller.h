@@ -0,0 +1,360 @@
+// Filename: socket_poller.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef __SOCKET_POLLER_H__
+#define __SOCKET_POLLER_H__
+
+#include "pandabase.h"
+#include "numeric_types.h"
+#include "socket_ip.h"
+#include "socket_fdset.h"
+#include "pvector.h"
+
+#if defined(IS_LINUX)
+#include <sys/epoll.h>
+#define HAVE_SOCKET_POLLER 1
+#endif
+
+#if !defined(WIN32) && !defined(WIN32_VC) && !defined(WIN64_VC)
+#include <poll.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////
+// Class : Socket_Poller
+//
+// Description : Waits for any of a large set of sockets to become
+//               readable, without the FD_SETSIZE limit and the
+//               per-call cost in the number of sockets of
+//               Socket_fdset.  The set of sockets is kept by the
+//               kernel (with epoll on Linux) between calls, rather
+//               than rebuilt for each wait.
+//
+//               Each socket is registered with a pointer that is
+//               reported back when the socket is ready.  Once a
+//               socket has been reported, it is not reported again
+//               until it is rearmed, so that only one thread at a
+//               time will find it ready.
+//
+//               On other platforms, Open() fails, and the caller
+//               should fall back to Socket_fdset.
+/////////////////////////////////////////////////////////////////////
+class Socket_Poller
+{
+public:
+    inline Socket_Poller();
+    inline ~Socket_Poller();
+
+    inline bool Open();
+    inline void Close();
+    inline bool IsOpen() const;
+
+    inline bool Add(const Socket_IP &incon, void *data);
+    inline bool Rearm(const Socket_IP &incon, void *data);
+    inline bool Remove(const Socket_IP &incon);
+
+    inline int WaitForRead(PN_uint32 sleep_time = 0xffffffff);
+    inline int GetNumResults() const;
+    inline void *GetResult(int n) const;
+
+    inline void AddToWaitList(pvector<SOCKET> &sockets) const;
+    static inline int WaitForFdsetRead(Socket_fdset &fdset,
+                                       const pvector<SOCKET> &sockets,
+                                       PN_uint32 sleep_time);
+
+    static inline int WaitForSocketRead(const Socket_IP &incon, PN_uint32 sleep_time);
+    static inline int WaitForSocketWrite(const Socket_IP &incon, PN_uint32 sleep_time);
+
+private:
+    static inline int WaitForSocket(const Socket_IP &incon, bool for_write,
+                                    PN_uint32 sleep_time);
+
+    SOCKET _poll_fd;
+    int _num_results;
+#ifdef HAVE_SOCKET_POLLER
+    enum { max_events = 256 };
+    epoll_event _events[max_events];
+#endif
+};
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::Socket_Poller
+// Description   : The constructor.  Call Open() to begin using the
+//      poller.
+////////////////////////////////////////////////////////////////////
+inline Socket_Poller::Socket_Poller() :
+    _poll_fd(BAD_SOCKET),
+    _num_results(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::~Socket_Poller
+// Description   :
+////////////////////////////////////////////////////////////////////
+inline Socket_Poller::~Socket_Poller()
+{
+    Close();
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::Open
+// Description   : Creates the kernel object that holds the set of
+//      sockets.  Returns true on success, or false if it could not be
+//      created, or if this platform has no such thing.
+////////////////////////////////////////////////////////////////////
+inline bool Socket_Poller::Open()
+{
+    Close();
+#ifdef HAVE_SOCKET_POLLER
+    _poll_fd = epoll_create1(EPOLL_CLOEXEC);
+#endif
+    return (_poll_fd != BAD_SOCKET);
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::Close
+// Description   : Releases the kernel object, forgetting all of the
+//      sockets.
+////////////////////////////////////////////////////////////////////
+inline void Socket_Poller::Close()
+{
+#ifdef HAVE_SOCKET_POLLER
+    if (_poll_fd != BAD_SOCKET)
+        close(_poll_fd);
+#endif
+    _poll_fd = BAD_SOCKET;
+    _num_results = 0;
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::IsOpen
+// Description   : Returns true if Open() has succeeded.
+////////////////////////////////////////////////////////////////////
+inline bool Socket_Poller::IsOpen() const
+{
+    return (_poll_fd != BAD_SOCKET);
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::Add
+// Description   : Adds a socket to the set, ready to be reported the
+//      next time it is readable (or has an error).  The data pointer
+//      is returned by GetResult() when it is.
+////////////////////////////////////////////////////////////////////
+inline bool Socket_Poller::Add(const Socket_IP &incon, void *data)
+{
+#ifdef HAVE_SOCKET_POLLER
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = data;
+    return (epoll_ctl(_poll_fd, EPOLL_CTL_ADD, incon.GetSocket(), &event) == 0);
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::Rearm
+// Description   : Makes a socket that has been reported by
+//      WaitForRead() eligible to be reported again.  This may be
+//      called by any thread, even while another thread is waiting.
+////////////////////////////////////////////////////////////////////
+inline bool Socket_Poller::Rearm(const Socket_IP &incon, void *data)
+{
+#ifdef HAVE_SOCKET_POLLER
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = data;
+    return (epoll_ctl(_poll_fd, EPOLL_CTL_MOD, incon.GetSocket(), &event) == 0);
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::Remove
+// Description   : Removes a socket from the set.  This must be done
+//      before the socket is closed, since the kernel may otherwise
+//      confuse it with a new socket that reuses the descriptor.
+////////////////////////////////////////////////////////////////////
+inline bool Socket_Poller::Remove(const Socket_IP &incon)
+{
+#ifdef HAVE_SOCKET_POLLER
+    // Older kernels insist on a non-NULL event here.
+    epoll_event event;
+    event.events = 0;
+    event.data.ptr = NULL;
+    return (epoll_ctl(_poll_fd, EPOLL_CTL_DEL, incon.GetSocket(), &event) == 0);
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::WaitForRead
+// Description   : Waits up to sleep_time milliseconds for any of the
+//      sockets to become readable, and returns the number of sockets
+//      found, 0 on timeout, or -1 on error.  The sockets found may be
+//      retrieved with GetResult(), until the next call to
+//      WaitForRead(), and are not reported again until they are
+//      rearmed.
+////////////////////////////////////////////////////////////////////
+inline int Socket_Poller::WaitForRead(PN_uint32 sleep_time)
+{
+    _num_results = 0;
+#ifdef HAVE_SOCKET_POLLER
+    int timeout = (sleep_time == 0xffffffff) ? -1 : (int)sleep_time;
+    int retVal = epoll_wait(_poll_fd, _events, max_events, timeout);
+    if (retVal < 0 && errno == EINTR)
+        retVal = 0;
+    if (retVal > 0)
+        _num_results = retVal;
+    return retVal;
+#else
+    return -1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::GetNumResults
+// Description   : Returns the number of sockets found by the last
+//      call to WaitForRead().
+////////////////////////////////////////////////////////////////////
+inline int Socket_Poller::GetNumResults() const
+{
+    return _num_results;
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::GetResult
+// Description   : Returns the data pointer of the nth socket found by
+//      the last call to WaitForRead().
+////////////////////////////////////////////////////////////////////
+inline void *Socket_Poller::GetResult(int n) const
+{
+    assert(n >= 0 && n < _num_results);
+#ifdef HAVE_SOCKET_POLLER
+    return _events[n].data.ptr;
+#else
+    return NULL;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::AddToWaitList
+// Description   : Adds the poller itself to the indicated list, for
+//      WaitForFdsetRead().  It is readable whenever any of its sockets
+//      would be reported by WaitForRead(), so several pollers may be
+//      waited on at once.
+////////////////////////////////////////////////////////////////////
+inline void Socket_Poller::AddToWaitList(pvector<SOCKET> &sockets) const
+{
+    if (_poll_fd != BAD_SOCKET)
+        sockets.push_back(_poll_fd);
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::WaitForFdsetRead
+// Description   : Waits up to sleep_time milliseconds for any of the
+//      sockets in the fdset, or any of the pollers added to the list
+//      by AddToWaitList(), to become readable.  Returns the number
+//      found, 0 on timeout, or -1 on error.  The fdset is cleared.
+//
+//      The poller descriptors are waited on with poll(), not added to
+//      the fdset, since a process with enough sockets to need a
+//      poller may well have given them descriptors of FD_SETSIZE or
+//      more.
+////////////////////////////////////////////////////////////////////
+inline int Socket_Poller::WaitForFdsetRead(Socket_fdset &fdset,
+                                           const pvector<SOCKET> &sockets,
+                                           PN_uint32 sleep_time)
+{
+#if defined(WIN32) || defined(WIN32_VC) || defined(WIN64_VC)
+    // There are no pollers on Windows.
+    assert(sockets.empty());
+    return fdset.WaitForRead(true, sleep_time);
+#else
+    if (sockets.empty())
+        return fdset.WaitForRead(true, sleep_time);
+
+    pvector<pollfd> pfds;
+    for (SOCKET fd = 0; fd <= fdset._maxid; ++fd) {
+        if (FD_ISSET(fd, &fdset._the_set)) {
+            pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            pfds.push_back(pfd);
+        }
+    }
+    for (size_t i = 0; i < sockets.size(); ++i) {
+        pollfd pfd;
+        pfd.fd = sockets[i];
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        pfds.push_back(pfd);
+    }
+    fdset.clear();
+
+    int timeout = (sleep_time == 0xffffffff) ? -1 : (int)sleep_time;
+    return poll(&pfds[0], pfds.size(), timeout);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::WaitForSocketRead
+// Description   : Waits up to sleep_time milliseconds for the one
+//      socket to become readable.  Returns 1 if it is, 0 on timeout,
+//      or -1 on error.  Unlike Socket_fdset, this works for any
+//      socket descriptor, however large.
+////////////////////////////////////////////////////////////////////
+inline int Socket_Poller::WaitForSocketRead(const Socket_IP &incon, PN_uint32 sleep_time)
+{
+    return WaitForSocket(incon, false, sleep_time);
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::WaitForSocketWrite
+// Description   : Waits up to sleep_time milliseconds for the one
+//      socket to become writable.  Returns 1 if it is, 0 on timeout,
+//      or -1 on error.
+////////////////////////////////////////////////////////////////////
+inline int Socket_Poller::WaitForSocketWrite(const Socket_IP &incon, PN_uint32 sleep_time)
+{
+    return WaitForSocket(incon, true, sleep_time);
+}
+
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_Poller::WaitForSocket
+// Description   :
+////////////////////////////////////////////////////////////////////
+inline int Socket_Poller::WaitForSocket(const Socket_IP &incon, bool for_write,
+                                        PN_uint32 sleep_time)
+{
+#if defined(WIN32) || defined(WIN32_VC) || defined(WIN64_VC)
+    // Windows has no limit on the descriptor values in an fd_set.
+    Socket_fdset fdset;
+    fdset.setForSocket(incon);
+    return for_write ? fdset.WaitForWrite(true, sleep_time) : fdset.WaitForRead(true, sleep_time);
+#else
+    pollfd pfd;
+    pfd.fd = incon.GetSocket();
+    pfd.events = for_write ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    int timeout = (sleep_time == 0xffffffff) ? -1 : (int)sleep_time;
+    return poll(&pfd, 1, timeout);
+#endif
+}
+
+#endif //__SOCKET_POLLER_H__
@@ -41,6 +41,7 @@ PUBLISHED:
     inline bool InitNoAddress();
 public:
     inline bool SendTo(const char * data, int len, const Socket_Address & address);
+    inline int SendToMany(const char * const *data, const int *lens, const Socket_Address *addresses, int count);
 PUBLISHED:
     inline bool SendTo(const string &data, const Socket_Address & address);
     inline bool SetToBroadCast();
@@ -149,6 +150,58 @@ inline bool Socket_UDP::SendTo(const char * data, int len, const Socket_Address
     return (DO_SOCKET_WRITE_TO(_socket, data, len, &address.GetAddressInfo()) == len);
 }
 
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_UDP::SendToMany
+// Description     : Send several datasets, each to its own address.
+//      On Linux this is done with as few sendmmsg() calls as
+//      possible.
+//
+// Return type  : int, the number of datasets sent before the first
+//      one that failed.  If this is less than count, data[n] could not
+//      be sent, and GetLastError() tells why; the caller may skip it
+//      and call again with the rest.
+// Argument         : const char * const *data
+// Argument         : const int *lens
+// Argument         : const Socket_Address *addresses
+// Argument         : int count
+////////////////////////////////////////////////////////////////////
+inline int Socket_UDP::SendToMany(const char * const *data, const int *lens, const Socket_Address *addresses, int count)
+{
+    int sent = 0;
+#if defined(IS_LINUX)
+    enum { max_batch = 64 };
+    mmsghdr msgs[max_batch];
+    iovec iovs[max_batch];
+    while (sent < count)
+    {
+        int num = count - sent;
+        if (num > max_batch)
+            num = max_batch;
+        memset(msgs, 0, sizeof(mmsghdr) * num);
+        for (int i = 0; i < num; i++)
+        {
+            iovs[i].iov_base = (void *)data[sent + i];
+            iovs[i].iov_len = lens[sent + i];
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = (void *)&addresses[sent + i].GetAddressInfo();
+            msgs[i].msg_hdr.msg_namelen = sizeof(AddressType);
+        }
+        // If sendmmsg() stops partway, it returns the number sent so
+        // far, and we go around again for the rest; if the next one
+        // really can't be sent, that call returns the error.
+        int val = sendmmsg(_socket, msgs, num, 0);
+        if (val <= 0)
+            break;
+        sent += val;
+    }
+#else
+    while (sent < count && SendTo(data[sent], lens[sent], addresses[sent]))
+        sent++;
+#endif
+    return sent;
+}
+
 ////////////////////////////////////////////////////////////////////
 // Function name : Socket_UDP::SendTo
 // Description     : Send data to specified address
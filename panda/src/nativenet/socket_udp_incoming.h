@@ -19,6 +19,9 @@ PUBLISHED:
     inline bool OpenForInput(const Socket_Address & address);
     inline bool OpenForInputMCast(const Socket_Address & address );
     inline bool GetPacket(char * data, int *max_len, Socket_Address & address);
+public:
+    inline int GetPackets(char * data, int stride, int *lens, Socket_Address *addresses, int max_count);
+PUBLISHED:
     inline bool SendTo(const char * data, int len, const Socket_Address & address);
     inline bool InitNoAddress();
     inline bool SetToBroadCast();
@@ -149,6 +152,113 @@ inline bool Socket_UDP_Incoming::GetPacket(char * data, int *max_len, Socket_Add
     return true;
 }
 
+////////////////////////////////////////////////////////////////////
+// Function name : Socket_UDP_Incoming::GetPackets
+// Description     :  Grabs as many datasets as are waiting on the
+//      listening UDP socket, up to max_count, waiting only for the
+//      first.  The nth dataset is stored at data + n * stride, with
+//      its length and source address in lens[n] and addresses[n].
+//      On Linux this is a single recvmmsg() call.
+//
+//      A dataset larger than stride is truncated by the system; in
+//      that case lens[n] is set to -1, and the caller should discard
+//      it.
+//
+// Return type  : int, the number of datasets read, 0 if there was
+//      nothing to read, or -1 on error
+// Argument         : char * data
+// Argument         : int stride
+// Argument         : int *lens
+// Argument         : Socket_Address *addresses
+// Argument         : int max_count
+////////////////////////////////////////////////////////////////////
+inline int Socket_UDP_Incoming::GetPackets(char * data, int stride, int *lens, Socket_Address *addresses, int max_count)
+{
+#if defined(IS_LINUX)
+    enum { max_batch = 64 };
+    if (max_count > max_batch)
+        max_count = max_batch;
+
+    mmsghdr msgs[max_batch];
+    iovec iovs[max_batch];
+    memset(msgs, 0, sizeof(mmsghdr) * max_count);
+    for (int i = 0; i < max_count; i++)
+    {
+        iovs[i].iov_base = data + i * stride;
+        iovs[i].iov_len = stride;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addresses[i].GetAddressInfo();
+        msgs[i].msg_hdr.msg_namelen = sizeof(AddressType);
+    }
+
+    int val = recvmmsg(_socket, msgs, max_count, MSG_WAITFORONE, NULL);
+    if (val <= 0)
+    {
+        if (val < 0 && GetLastError() != LOCAL_BLOCKING_ERROR)
+            return -1;
+        return 0;
+    }
+    for (int i = 0; i < val; i++)
+    {
+        if ((msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0)
+            lens[i] = -1;
+        else
+            lens[i] = msgs[i].msg_len;
+    }
+    return val;
+
+#elif defined(WIN32) || defined(WIN32_VC) || defined(WIN64_VC)
+    int len = stride;
+    if (!GetPacket(data, &len, addresses[0]))
+    {
+        // Windows reports a truncated dataset as an error, but still
+        // consumes it.
+        if (GetLastError() == WSAEMSGSIZE)
+        {
+            lens[0] = -1;
+            return 1;
+        }
+        return -1;
+    }
+    if (len == 0)
+        return 0;
+    lens[0] = len;
+    return 1;
+
+#else
+    // Wait for the first dataset, then take whatever else is already
+    // waiting, without blocking.
+    int count = 0;
+    while (count < max_count)
+    {
+        iovec iov;
+        iov.iov_base = data + count * stride;
+        iov.iov_len = stride;
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &addresses[count].GetAddressInfo();
+        msg.msg_namelen = sizeof(AddressType);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        int val = recvmsg(_socket, &msg, (count == 0) ? 0 : MSG_DONTWAIT);
+        if (val <= 0)
+        {
+            if (count == 0 && val < 0 && GetLastError() != LOCAL_BLOCKING_ERROR)
+                return -1;
+            break;
+        }
+        if ((msg.msg_flags & MSG_TRUNC) != 0)
+            lens[count] = -1;
+        else
+            lens[count] = val;
+        count++;
+    }
+    return count;
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////
 // Function name : SocketUDP_Outgoing::SendTo
 // Description     : Send data to specified address
@@ -19,6 +19,7 @@
      connectionReader.I connectionReader.h  \
      connectionWriter.h datagramQueue.h \
      datagramTCPHeader.I datagramTCPHeader.h  \
+     lockFreeQueue.h lockFreeQueue.I \
      datagramUDPHeader.I datagramUDPHeader.h  \
      netAddress.h netDatagram.I netDatagram.h  \
      datagramGeneratorNet.I datagramGeneratorNet.h \
@@ -44,6 +45,7 @@
     connectionReader.I connectionReader.h  \
     connectionWriter.h datagramQueue.h \
     datagramTCPHeader.I datagramTCPHeader.h \
+    lockFreeQueue.h lockFreeQueue.I \
     datagramUDPHeader.I datagramUDPHeader.h \
     netAddress.h netDatagram.I \
     netDatagram.h queuedConnectionListener.I \
@@ -87,6 +89,46 @@
 
 #end test_bin_target
 
+#begin test_bin_target
+  #define TARGET test_spam_load
+  #define LOCAL_LIBS p3net p3putil
+  #define OTHER_LIBS $[OTHER_LIBS] p3pystub
+
+  #define SOURCES \
+    test_spam_load.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define TARGET test_udp_batch
+  #define LOCAL_LIBS p3net p3putil
+  #define OTHER_LIBS $[OTHER_LIBS] p3pystub
+
+  #define SOURCES \
+    test_udp_batch.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define TARGET test_queue_contention
+  #define LOCAL_LIBS p3net p3putil
+  #define OTHER_LIBS $[OTHER_LIBS] p3pystub
+
+  #define SOURCES \
+    test_queue_contention.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define TARGET test_datagram_pool
+  #define LOCAL_LIBS p3net p3putil
+  #define OTHER_LIBS $[OTHER_LIBS] p3pystub
+
+  #define SOURCES \
+    test_datagram_pool.cxx
+
+#end test_bin_target
+
 #begin test_bin_target
   #define TARGET test_tcp_client
   #define LOCAL_LIBS p3net
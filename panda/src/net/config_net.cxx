@@ -143,6 +143,29 @@ ConfigVariableEnum<ThreadPriority> net_thread_priority
  PRC_DESC("The default thread priority when creating threaded readers "
           "or writers."));
 
+ConfigVariableBool net_use_epoll
+("net-use-epoll", true,
+ PRC_DESC("Set this true to have each ConnectionReader and "
+          "ConnectionListener wait for its sockets with epoll, where it "
+          "is available, rather than with select().  This is much faster "
+          "with many connections, and is required for more than about "
+          "1000 of them.  Set it false to use select() always."));
+
+ConfigVariableInt net_udp_batch_size
+("net-udp-batch-size", 32,
+ PRC_DESC("The maximum number of UDP datagrams that a ConnectionReader "
+          "reads, or a threaded ConnectionWriter sends, with a single "
+          "system call.  This uses recvmmsg() and sendmmsg() where they "
+          "are available.  Set it to 1 to handle one datagram at a time."));
+
+ConfigVariableInt net_lock_free_queue_size
+("net-lock-free-queue-size", 1024,
+ PRC_DESC("The number of datagrams that the queues of QueuedConnectionReader "
+          "and ConnectionWriter can pass between threads without taking a "
+          "lock.  Beyond this, the queues fall back to a mutex until they "
+          "are drained, up to net-max-response-queue or "
+          "net-max-write-queue.  Set it to 0 to always use the mutex."));
+
 
 ////////////////////////////////////////////////////////////////////
 //     Function: init_libnet
@@ -38,6 +38,9 @@ extern ConfigVariableInt net_max_read_per_epoch;
 extern ConfigVariableInt net_max_write_per_epoch;
 
 extern ConfigVariableEnum<ThreadPriority> net_thread_priority;
+extern ConfigVariableBool net_use_epoll;
+extern ConfigVariableInt net_udp_batch_size;
+extern ConfigVariableInt net_lock_free_queue_size;
 
 extern EXPCL_PANDA_NET void init_libnet();
 
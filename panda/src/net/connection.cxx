@@ -26,6 +26,7 @@
 #include "socket_tcp.h"
 #include "socket_udp.h"
 #include "dcast.h"
+#include "pvector.h"
 
 
 ////////////////////////////////////////////////////////////////////
@@ -474,6 +475,101 @@ send_raw_datagram(const NetDatagram &datagram) {
   return true;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: Connection::send_datagrams
+//       Access: Private
+//  Description: This method is intended only to be called by
+//               ConnectionWriter.  It writes several datagrams to the
+//               socket at once, with or without the Datagram header
+//               according to raw; on a UDP socket, this is done with
+//               as few system calls as possible.  Returns true if all
+//               of them were sent, false otherwise.
+////////////////////////////////////////////////////////////////////
+bool Connection::
+send_datagrams(const NetDatagram *datagrams, int num_datagrams,
+               int tcp_header_size, bool raw) {
+  nassertr(_socket != (Socket_IP *)NULL, false);
+
+  if (num_datagrams == 1 ||
+      !_socket->is_exact_type(Socket_UDP::get_class_type())) {
+    // There's no advantage to sending TCP datagrams together; they
+    // are collected into a single write by do_flush() anyway.
+    bool okflag = true;
+    for (int i = 0; i < num_datagrams; ++i) {
+      if (raw) {
+        okflag = send_raw_datagram(datagrams[i]) && okflag;
+      } else {
+        okflag = send_datagram(datagrams[i], tcp_header_size) && okflag;
+      }
+    }
+    return okflag;
+  }
+
+  Socket_UDP *udp;
+  DCAST_INTO_R(udp, _socket, false);
+
+  pvector<string> data(num_datagrams);
+  pvector<const char *> data_ptrs(num_datagrams);
+  pvector<int> lens(num_datagrams);
+  pvector<Socket_Address> addrs(num_datagrams);
+  for (int i = 0; i < num_datagrams; ++i) {
+    const NetDatagram &datagram = datagrams[i];
+    if (raw) {
+      data[i] = datagram.get_message();
+    } else {
+      DatagramUDPHeader header(datagram);
+      data[i] = header.get_header();
+      data[i] += datagram.get_message();
+
+      if (net_cat.is_debug()) {
+        header.verify_datagram(datagram);
+      }
+    }
+    data_ptrs[i] = data[i].data();
+    lens[i] = data[i].length();
+    addrs[i] = datagram.get_address().get_addr();
+  }
+
+  LightReMutexHolder holder(_write_mutex);
+  int num_sent = 0;
+  int next = 0;
+  while (next < num_datagrams) {
+    int count = udp->SendToMany(&data_ptrs[next], &lens[next], &addrs[next],
+                                num_datagrams - next);
+    num_sent += count;
+    next += count;
+    if (next >= num_datagrams) {
+      break;
+    }
+
+    // data_ptrs[next] could not be sent.
+    if (udp->GetLastError() == LOCAL_BLOCKING_ERROR) {
+#if defined(HAVE_THREADS) && defined(SIMPLE_THREADS)
+      if (udp->Active()) {
+        Thread::force_yield();
+        continue;
+      }
+#endif  // SIMPLE_THREADS
+      // The socket's buffer is full; the rest would fail too.
+      break;
+    }
+
+    // Some other error, perhaps with this datagram's address.  Skip
+    // it, and carry on with the rest.
+    ++next;
+  }
+
+  bool okflag = (num_sent == num_datagrams);
+  if (net_cat.is_spam()) {
+    net_cat.spam()
+      << "Sent " << num_sent << " of " << num_datagrams
+      << (raw ? " raw" : "") << " UDP datagrams to " << (void *)this
+      << ", ok = " << okflag << "\n";
+  }
+
+  return check_send_error(okflag);
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: Connection::do_flush
 //       Access: Private
@@ -20,6 +20,7 @@
 #include "config_net.h"
 #include "lightMutexHolder.h"
 #include "trueClock.h"
+#include "socket_poller.h"
 
 #if defined(WIN32_VC) || defined(WIN64_VC)
 #include <winsock2.h>  // For gethostname()
@@ -275,9 +276,7 @@ open_TCP_client_connection(const NetAddress &address, int timeout_ms) {
     TrueClock *clock = TrueClock::get_global_ptr();
     double start = clock->get_short_time();
     Thread::force_yield();
-    Socket_fdset fset;
-    fset.setForSocket(*socket);
-    int ready = fset.WaitForWrite(true, 0);
+    int ready = Socket_Poller::WaitForSocketWrite(*socket, 0);
     while (ready == 0) {
       double elapsed = clock->get_short_time() - start;
       if (elapsed * 1000.0 > timeout_ms) {
@@ -286,8 +285,7 @@ open_TCP_client_connection(const NetAddress &address, int timeout_ms) {
         break;
       }
       Thread::force_yield();
-      fset.setForSocket(*socket);
-      ready = fset.WaitForWrite(true, 0);
+      ready = Socket_Poller::WaitForSocketWrite(*socket, 0);
     }
   }
 
@@ -432,7 +430,9 @@ wait_for_readers(double timeout) {
   do {
     Socket_fdset fdset;
     fdset.clear();
+    pvector<SOCKET> poll_sockets;
     bool any_threaded = false;
+    bool any_ready = false;
     
     {
       LightMutexHolder holder(_set_mutex);
@@ -443,7 +443,9 @@ wait_for_readers(double timeout) {
         if (reader->is_polling()) {
           // If it's a polling reader, we can wait for its socket.
           // (If it's a threaded reader, we can't do anything here.)
-          reader->accumulate_fdset(fdset);
+          if (reader->accumulate_fdset(fdset, poll_sockets)) {
+            any_ready = true;
+          }
         } else {
           any_threaded = true;
           stop = now;
@@ -452,6 +454,11 @@ wait_for_readers(double timeout) {
       }
     }
 
+    if (any_ready) {
+      // Some reader already knows of a socket with data on it.
+      return true;
+    }
+
     double wait_timeout = get_net_max_block();
     if (!block_forever) { 
       wait_timeout = min(wait_timeout, stop - now);
@@ -469,7 +476,8 @@ wait_for_readers(double timeout) {
     // we won't block the entire process).
     wait_timeout_ms = 0;
 #endif
-    int num_results = fdset.WaitForRead(false, wait_timeout_ms);
+    int num_results = Socket_Poller::WaitForFdsetRead(fdset, poll_sockets,
+                                                      wait_timeout_ms);
     if (num_results != 0) {
       // If we got an answer (or an error), return success.  The
       // caller can then figure out what happened.
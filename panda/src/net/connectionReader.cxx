@@ -40,6 +40,7 @@ SocketInfo(const PT(Connection) &connection) :
 {
   _busy = false;
   _error = false;
+  _registered = false;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -122,6 +123,18 @@ ConnectionReader(ConnectionManager *manager, int num_threads,
   _next_index = 0;
   _num_results = 0;
 
+  // Where possible, we let the kernel keep track of our sockets,
+  // rather than handing the whole list to select() each time.
+  _use_poller = false;
+  if (net_use_epoll) {
+    _use_poller = _poller.Open();
+  }
+  if (net_cat.is_debug()) {
+    net_cat.debug()
+      << "ConnectionReader will wait for sockets with "
+      << (_use_poller ? "epoll" : "select") << ".\n";
+  }
+
   _currently_polling_thread = -1;
 
   string reader_thread_name = thread_name;
@@ -205,7 +218,16 @@ add_connection(Connection *connection) {
     }
   }
 
-  _sockets.push_back(new SocketInfo(connection));
+  SocketInfo *sinfo = new SocketInfo(connection);
+  if (_use_poller) {
+    sinfo->_registered = _poller.Add(*sinfo->get_socket(), sinfo);
+    if (!sinfo->_registered) {
+      net_cat.error()
+        << "Unable to monitor connection " << (void *)connection << "\n";
+      sinfo->_error = true;
+    }
+  }
+  _sockets.push_back(sinfo);
 
   return true;
 }
@@ -235,7 +257,14 @@ remove_connection(Connection *connection) {
     return false;
   }
 
-  _removed_sockets.push_back(*si);
+  SocketInfo *sinfo = (*si);
+  if (sinfo->_registered) {
+    // This must be done now, while the socket is still open.
+    _poller.Remove(*sinfo->get_socket());
+    sinfo->_registered = false;
+  }
+
+  _removed_sockets.push_back(sinfo);
   _sockets.erase(si);
 
   return true;
@@ -441,17 +470,29 @@ flush_read_connection(Connection *connection) {
   // right here in this thread, since we've already removed this
   // connection from the reader.
 
-  Socket_fdset fdset;
-  fdset.clear();
-  fdset.setForSocket(*(sinfo.get_socket()));
-  int num_results = fdset.WaitForRead(true, 0);
+  int num_results = Socket_Poller::WaitForSocketRead(*(sinfo.get_socket()), 0);
   while (num_results != 0) {
     sinfo._busy = true;
     if (!process_incoming_data(&sinfo)) {
       break;
     }
-    fdset.setForSocket(*(sinfo.get_socket()));
-    num_results = fdset.WaitForRead(true, 0);
+    num_results = Socket_Poller::WaitForSocketRead(*(sinfo.get_socket()), 0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: ConnectionReader::receive_datagrams
+//       Access: Protected, Virtual
+//  Description: Called with several datagrams at once when they have
+//               been read together, as from a UDP socket.  The
+//               default implementation passes each one to
+//               receive_datagram() in turn; a subclass may override
+//               this to handle them all at once.
+////////////////////////////////////////////////////////////////////
+void ConnectionReader::
+receive_datagrams(const NetDatagram *datagrams, int num_datagrams) {
+  for (int i = 0; i < num_datagrams; ++i) {
+    receive_datagram(datagrams[i]);
   }
 }
 
@@ -483,6 +524,14 @@ finish_socket(SocketInfo *sinfo) {
   // By marking the SocketInfo nonbusy, we make it available for
   // future polls.
   sinfo->_busy = false;
+
+  if (_use_poller) {
+    // The poller won't report this socket again until we rearm it.
+    LightMutexHolder holder(_sockets_mutex);
+    if (sinfo->_registered && !sinfo->_error) {
+      _poller.Rearm(*sinfo->get_socket(), sinfo);
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -518,75 +567,7 @@ process_incoming_data(SocketInfo *sinfo) {
 ////////////////////////////////////////////////////////////////////
 bool ConnectionReader::
 process_incoming_udp_data(SocketInfo *sinfo) {
-  Socket_UDP *socket;
-  DCAST_INTO_R(socket, sinfo->get_socket(), false);
-  Socket_Address addr;
-
-  // Read as many bytes as we can.
-  char buffer[read_buffer_size];
-  int bytes_read = read_buffer_size;
-
-  bool okflag = socket->GetPacket(buffer, &bytes_read, addr);
-
-  if (!okflag) {
-    finish_socket(sinfo);
-    return false;
-
-  } else if (bytes_read == 0) {
-    // The socket was closed (!).  This shouldn't happen with a UDP
-    // connection.  Oh well.  Report that and return.
-    if (_manager != (ConnectionManager *)NULL) {
-      _manager->connection_reset(sinfo->_connection, 0);
-    }
-    finish_socket(sinfo);
-    return false;
-  }
-
-  // Since we are not running in raw mode, we decode the header to
-  // determine how big the datagram is.  This means we must have read
-  // at least a full header.
-  if (bytes_read < datagram_udp_header_size) {
-    net_cat.error()
-      << "Did not read entire header, discarding UDP datagram.\n";
-    finish_socket(sinfo);
-    return true;
-  }
-  
-  DatagramUDPHeader header(buffer);
-  
-  char *dp = buffer + datagram_udp_header_size;
-  bytes_read -= datagram_udp_header_size;
-  
-  NetDatagram datagram(dp, bytes_read);
-  
-  // Now that we've read all the data, it's time to finish the socket
-  // so another thread can read the next datagram.
-  finish_socket(sinfo);
-  
-  if (_shutdown) {
-    return false;
-  }
-  
-  // And now do whatever we need to do to process the datagram.
-  if (!header.verify_datagram(datagram)) {
-    net_cat.error()
-      << "Ignoring invalid UDP datagram.\n";
-  } else {
-    datagram.set_connection(sinfo->_connection);
-    datagram.set_address(NetAddress(addr));
-
-    if (net_cat.is_spam()) {
-      net_cat.spam()
-        << "Received UDP datagram with " 
-        << datagram_udp_header_size + datagram.get_length() 
-        << " bytes on " << (void *)datagram.get_connection()
-        << " from " << datagram.get_address() << "\n";
-    }
-
-    receive_datagram(datagram);
-  }
-
-  return true;
+  return read_udp_datagrams(sinfo, false);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -733,23 +714,32 @@ process_incoming_tcp_data(SocketInfo *sinfo) {
 ////////////////////////////////////////////////////////////////////
 bool ConnectionReader::
 process_raw_incoming_udp_data(SocketInfo *sinfo) {
-  Socket_UDP *socket;
+  return read_udp_datagrams(sinfo, true);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: ConnectionReader::process_raw_incoming_tcp_data
+//       Access: Protected
+//  Description:
+////////////////////////////////////////////////////////////////////
+bool ConnectionReader::
+process_raw_incoming_tcp_data(SocketInfo *sinfo) {
+  Socket_TCP *socket;
   DCAST_INTO_R(socket, sinfo->get_socket(), false);
-  Socket_Address addr;
 
   // Read as many bytes as we can.
   char buffer[read_buffer_size];
-  int bytes_read = read_buffer_size;
-
-  bool okflag = socket->GetPacket(buffer, &bytes_read, addr);
-
-  if (!okflag) {
-    finish_socket(sinfo);
-    return false;
+  int bytes_read = socket->RecvData(buffer, read_buffer_size);
+#if defined(HAVE_THREADS) && defined(SIMPLE_THREADS)
+  while (bytes_read < 0 && socket->GetLastError() == LOCAL_BLOCKING_ERROR && 
+         socket->Active()) {
+    Thread::force_yield();
+    bytes_read = socket->RecvData(buffer, read_buffer_size);
+  }
+#endif  // SIMPLE_THREADS
 
-  } else if (bytes_read == 0) {
-    // The socket was closed (!).  This shouldn't happen with a UDP
-    // connection.  Oh well.  Report that and return.
+  if (bytes_read <= 0) {
+    // The socket was closed.  Report that and return.
     if (_manager != (ConnectionManager *)NULL) {
       _manager->connection_reset(sinfo->_connection, 0);
     }
@@ -770,11 +760,11 @@ process_raw_incoming_udp_data(SocketInfo *sinfo) {
   }
   
   datagram.set_connection(sinfo->_connection);
-  datagram.set_address(NetAddress(addr));
+  datagram.set_address(NetAddress(socket->GetPeerName()));
 
   if (net_cat.is_spam()) {
     net_cat.spam()
-      << "Received raw UDP datagram with " << datagram.get_length() 
+      << "Received raw TCP datagram with " << datagram.get_length() 
       << " bytes on " << (void *)datagram.get_connection()
       << " from " << datagram.get_address() << "\n";
   }
@@ -785,28 +775,39 @@ process_raw_incoming_udp_data(SocketInfo *sinfo) {
 }
 
 ////////////////////////////////////////////////////////////////////
-//     Function: ConnectionReader::process_raw_incoming_tcp_data
+//     Function: ConnectionReader::read_udp_datagrams
 //       Access: Protected
-//  Description:
+//  Description: Reads as many UDP datagrams as are waiting on the
+//               socket, up to net-udp-batch-size, with as few system
+//               calls as possible, and passes them all to
+//               receive_datagrams() at once.  If raw is true, the
+//               datagrams have no header.
 ////////////////////////////////////////////////////////////////////
 bool ConnectionReader::
-process_raw_incoming_tcp_data(SocketInfo *sinfo) {
-  Socket_TCP *socket;
+read_udp_datagrams(SocketInfo *sinfo, bool raw) {
+  Socket_UDP *socket;
   DCAST_INTO_R(socket, sinfo->get_socket(), false);
 
-  // Read as many bytes as we can.
-  char buffer[read_buffer_size];
-  int bytes_read = socket->RecvData(buffer, read_buffer_size);
-#if defined(HAVE_THREADS) && defined(SIMPLE_THREADS)
-  while (bytes_read < 0 && socket->GetLastError() == LOCAL_BLOCKING_ERROR && 
-         socket->Active()) {
-    Thread::force_yield();
-    bytes_read = socket->RecvData(buffer, read_buffer_size);
+  int max_count = max((int)net_udp_batch_size, 1);
+  if ((int)sinfo->_udp_lengths.size() != max_count) {
+    sinfo->_udp_data.resize(max_count * read_buffer_size);
+    sinfo->_udp_lengths.resize(max_count);
+    sinfo->_udp_addresses.resize(max_count);
   }
-#endif  // SIMPLE_THREADS
 
-  if (bytes_read <= 0) {
-    // The socket was closed.  Report that and return.
+  // Read as many bytes as we can.
+  char *buffer = &sinfo->_udp_data[0];
+  int count = socket->GetPackets(buffer, read_buffer_size,
+                                 &sinfo->_udp_lengths[0],
+                                 &sinfo->_udp_addresses[0], max_count);
+
+  if (count < 0) {
+    finish_socket(sinfo);
+    return false;
+
+  } else if (count == 0) {
+    // The socket was closed (!).  This shouldn't happen with a UDP
+    // connection.  Oh well.  Report that and return.
     if (_manager != (ConnectionManager *)NULL) {
       _manager->connection_reset(sinfo->_connection, 0);
     }
@@ -814,30 +815,68 @@ process_raw_incoming_tcp_data(SocketInfo *sinfo) {
     return false;
   }
 
-  // In raw mode, we simply extract all the bytes and make that a
-  // datagram.
-  NetDatagram datagram(buffer, bytes_read);
-  
+  pvector<NetDatagram> datagrams;
+  datagrams.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    char *dp = buffer + i * read_buffer_size;
+    int bytes_read = sinfo->_udp_lengths[i];
+    if (bytes_read < 0) {
+      net_cat.error()
+        << "UDP datagram larger than " << read_buffer_size
+        << " bytes, discarding.\n";
+      continue;
+    }
+
+    if (raw) {
+      // In raw mode, we simply extract all the bytes and make that a
+      // datagram.
+      datagrams.push_back(NetDatagram(dp, bytes_read));
+
+    } else {
+      // Since we are not running in raw mode, we decode the header to
+      // determine how big the datagram is.  This means we must have
+      // read at least a full header.
+      if (bytes_read < datagram_udp_header_size) {
+        net_cat.error()
+          << "Did not read entire header, discarding UDP datagram.\n";
+        continue;
+      }
+
+      DatagramUDPHeader header(dp);
+      NetDatagram datagram(dp + datagram_udp_header_size,
+                           bytes_read - datagram_udp_header_size);
+      if (!header.verify_datagram(datagram)) {
+        net_cat.error()
+          << "Ignoring invalid UDP datagram.\n";
+        continue;
+      }
+      datagrams.push_back(datagram);
+    }
+
+    NetDatagram &datagram = datagrams.back();
+    datagram.set_connection(sinfo->_connection);
+    datagram.set_address(NetAddress(sinfo->_udp_addresses[i]));
+
+    if (net_cat.is_spam()) {
+      net_cat.spam()
+        << "Received " << (raw ? "raw " : "") << "UDP datagram with "
+        << bytes_read << " bytes on " << (void *)datagram.get_connection()
+        << " from " << datagram.get_address() << "\n";
+    }
+  }
+
   // Now that we've read all the data, it's time to finish the socket
   // so another thread can read the next datagram.
   finish_socket(sinfo);
-  
+
   if (_shutdown) {
     return false;
   }
-  
-  datagram.set_connection(sinfo->_connection);
-  datagram.set_address(NetAddress(socket->GetPeerName()));
 
-  if (net_cat.is_spam()) {
-    net_cat.spam()
-      << "Received raw TCP datagram with " << datagram.get_length() 
-      << " bytes on " << (void *)datagram.get_connection()
-      << " from " << datagram.get_address() << "\n";
+  if (!datagrams.empty()) {
+    receive_datagrams(&datagrams[0], datagrams.size());
   }
 
-  receive_datagram(datagram);
-
   return true;
 }
 
@@ -886,10 +925,19 @@ get_next_available_socket(bool allow_block, int current_thread_index) {
     // First, check the result from the previous select call.  If
     // there are any sockets remaining there, process them first.
     while (!_shutdown && _num_results > 0) {
-      nassertr(_next_index < (int)_selecting_sockets.size(), NULL);
       int i = _next_index;
       _next_index++;
 
+      if (_use_poller) {
+        // The poller reports only the sockets with noise, and each
+        // one only once.
+        _num_results--;
+        SocketInfo *sinfo = (SocketInfo *)_poller.GetResult(i);
+        sinfo->_busy = true;
+        return sinfo;
+      }
+
+      nassertr(i < (int)_selecting_sockets.size(), NULL);
       if (_fdset.IsSetFor(*_selecting_sockets[i]->get_socket())) {
         _num_results--;
         SocketInfo *sinfo = _selecting_sockets[i];
@@ -930,7 +978,11 @@ get_next_available_socket(bool allow_block, int current_thread_index) {
         timeout = 0;
 #endif
 
-        _num_results = _fdset.WaitForRead(false, timeout);
+        if (_use_poller) {
+          _num_results = _poller.WaitForRead(timeout);
+        } else {
+          _num_results = _fdset.WaitForRead(false, timeout);
+        }
       }
 
       if (_num_results == 0 && allow_block) {
@@ -963,27 +1015,47 @@ get_next_available_socket(bool allow_block, int current_thread_index) {
 //       Access: Private
 //  Description: Rebuilds the _fdset and _selecting_sockets arrays
 //               based on the sockets that are currently available for
-//               selecting.
+//               selecting.  If we are using the poller, the kernel
+//               keeps track of the sockets for us, and there is
+//               nothing to rebuild.
 ////////////////////////////////////////////////////////////////////
 void ConnectionReader::
 rebuild_select_list() {
-  _fdset.clear();
-  _selecting_sockets.clear();
-
   LightMutexHolder holder(_sockets_mutex);
-  Sockets::const_iterator si;
-  for (si = _sockets.begin(); si != _sockets.end(); ++si) {
-    SocketInfo *sinfo = (*si);
-    if (!sinfo->_busy && !sinfo->_error) {
-      _fdset.setForSocket(*sinfo->get_socket());
-      _selecting_sockets.push_back(sinfo);
+
+  if (!_use_poller) {
+    _fdset.clear();
+    _selecting_sockets.clear();
+
+    Sockets::const_iterator si;
+    for (si = _sockets.begin(); si != _sockets.end(); ++si) {
+      SocketInfo *sinfo = (*si);
+      if (!sinfo->_busy && !sinfo->_error) {
+        _fdset.setForSocket(*sinfo->get_socket());
+        _selecting_sockets.push_back(sinfo);
+      }
     }
   }
 
   // This is also a fine time to delete the contents of the
   // _removed_sockets list.
+  delete_removed_sockets();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: ConnectionReader::delete_removed_sockets
+//       Access: Private
+//  Description: Deletes the sockets on the _removed_sockets list that
+//               are no longer busy.  This must be called only with
+//               _sockets_mutex held, and only when there are no
+//               results left over from the last poll, since those may
+//               refer to removed sockets.
+////////////////////////////////////////////////////////////////////
+void ConnectionReader::
+delete_removed_sockets() {
   if (!_removed_sockets.empty()) {
     Sockets still_busy_sockets;
+    Sockets::const_iterator si;
     for (si = _removed_sockets.begin(); si != _removed_sockets.end(); ++si) {
       SocketInfo *sinfo = (*si);
       if (sinfo->_busy) {
@@ -1003,9 +1075,21 @@ rebuild_select_list() {
 //               ConnectionListener) to the indicated fdset.  This is
 //               used by ConnectionManager::block() to build an fdset
 //               of all attached readers.
+//
+//               If we are using the poller, the poller itself is
+//               added to poll_sockets instead, to be waited on with
+//               Socket_Poller::WaitForFdsetRead().  Since it will not
+//               report again the sockets it has already found, the
+//               return value is true if some of those have not yet
+//               been read, in which case there is no need to wait.
 ////////////////////////////////////////////////////////////////////
-void ConnectionReader::
-accumulate_fdset(Socket_fdset &fdset) {
+bool ConnectionReader::
+accumulate_fdset(Socket_fdset &fdset, pvector<SOCKET> &poll_sockets) {
+  if (_use_poller) {
+    _poller.AddToWaitList(poll_sockets);
+    return (_num_results > 0);
+  }
+
   LightMutexHolder holder(_sockets_mutex);
   Sockets::const_iterator si;
   for (si = _sockets.begin(); si != _sockets.end(); ++si) {
@@ -1014,4 +1098,5 @@ accumulate_fdset(Socket_fdset &fdset) {
       fdset.setForSocket(*sinfo->get_socket());
     }
   }
+  return false;
 }
@@ -25,11 +25,12 @@
 #include "pvector.h"
 #include "pset.h"
 #include "socket_fdset.h"
+#include "socket_poller.h"
+#include "socket_address.h"
 #include "atomicAdjust.h"
 
 class NetDatagram;
 class ConnectionManager;
-class Socket_Address;
 class Socket_IP;
 
 ////////////////////////////////////////////////////////////////////
@@ -92,6 +93,8 @@ PUBLISHED:
 protected:
   virtual void flush_read_connection(Connection *connection);
   virtual void receive_datagram(const NetDatagram &datagram)=0;
+  virtual void receive_datagrams(const NetDatagram *datagrams,
+                                 int num_datagrams);
 
   class SocketInfo {
   public:
@@ -102,6 +105,12 @@ protected:
     PT(Connection) _connection;
     bool _busy;
     bool _error;
+    bool _registered;
+
+    // These are used to read a batch of UDP datagrams at once.
+    pvector<char> _udp_data;
+    pvector<int> _udp_lengths;
+    pvector<Socket_Address> _udp_addresses;
   };
   typedef pvector<SocketInfo *> Sockets;
 
@@ -113,6 +122,7 @@ protected:
   virtual bool process_incoming_tcp_data(SocketInfo *sinfo);
   virtual bool process_raw_incoming_udp_data(SocketInfo *sinfo);
   virtual bool process_raw_incoming_tcp_data(SocketInfo *sinfo);
+  bool read_udp_datagrams(SocketInfo *sinfo, bool raw);
 
 protected:
   ConnectionManager *_manager;
@@ -133,7 +143,8 @@ private:
                                         int current_thread_index);
 
   void rebuild_select_list();
-  void accumulate_fdset(Socket_fdset &fdset);
+  void delete_removed_sockets();
+  bool accumulate_fdset(Socket_fdset &fdset, pvector<SOCKET> &poll_sockets);
 
 private:
   bool _raw_mode;
@@ -155,7 +166,11 @@ private:
   bool _polling;
 
   // These structures are used to manage selecting for noise on
-  // available sockets.
+  // available sockets.  If _use_poller is true, the sockets are all
+  // registered with _poller, and _fdset and _selecting_sockets are
+  // not used.
+  bool _use_poller;
+  Socket_Poller _poller;
   Socket_fdset _fdset;
   Sockets _selecting_sockets;
   int _next_index;
@@ -383,12 +383,22 @@ void ConnectionWriter::
 thread_run(int thread_index) {
   nassertv(!_immediate);
 
-  NetDatagram datagram;
-  while (_queue.extract(datagram)) {
-    if (_raw_mode) {
-      datagram.get_connection()->send_raw_datagram(datagram);
-    } else {
-      datagram.get_connection()->send_datagram(datagram, _tcp_header_size);
+  // We take as many datagrams from the queue as are waiting, up to
+  // net-udp-batch-size, and send each run of datagrams bound for the
+  // same connection together.
+  pvector<NetDatagram> datagrams;
+  int max_count = max((int)net_udp_batch_size, 1);
+  while (_queue.extract_many(datagrams, max_count)) {
+    size_t i = 0;
+    while (i < datagrams.size()) {
+      Connection *connection = datagrams[i].get_connection();
+      size_t j = i + 1;
+      while (j < datagrams.size() && datagrams[j].get_connection() == connection) {
+        ++j;
+      }
+      connection->send_datagrams(&datagrams[i], j - i, _tcp_header_size,
+                                 _raw_mode);
+      i = j;
     }
     Thread::consider_yield();
   }
@@ -24,10 +24,13 @@
 DatagramQueue::
 DatagramQueue() : 
   _cvlock("DatagramQueue::_cvlock"),
-  _cv(_cvlock) 
+  _extract_cv(_cvlock),
+  _insert_cv(_cvlock),
+  _queue(net_lock_free_queue_size, get_net_max_write_queue())
 {
-  _shutdown = false;
-  _max_queue_size = get_net_max_write_queue();
+  _shutdown = 0;
+  _num_waiting_extract = 0;
+  _num_waiting_insert = 0;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -58,8 +61,9 @@ shutdown() {
   // cause any thread blocking on extract() to return false.
   MutexHolder holder(_cvlock);
 
-  _shutdown = true;
-  _cv.notify_all();
+  AtomicAdjust::set(_shutdown, 1);
+  _extract_cv.notify_all();
+  _insert_cv.notify_all();
 }
 
 
@@ -78,20 +82,27 @@ shutdown() {
 ////////////////////////////////////////////////////////////////////
 bool DatagramQueue::
 insert(const NetDatagram &data, bool block) {
-  MutexHolder holder(_cvlock);
+  if (_queue.push(data)) {
+    wake_extract();
+    return true;
+  }
+  if (!block) {
+    return false;
+  }
 
-  bool enqueue_ok = ((int)_queue.size() < _max_queue_size);
-  if (block) {
-    while (!enqueue_ok && !_shutdown) {
-      _cv.wait();
-      enqueue_ok = ((int)_queue.size() < _max_queue_size);
-    }
+  // The queue is full; wait for room.
+  MutexHolder holder(_cvlock);
+  AtomicAdjust::inc(_num_waiting_insert);
+  bool enqueue_ok = _queue.push(data);
+  while (!enqueue_ok && !_shutdown) {
+    _insert_cv.wait();
+    enqueue_ok = _queue.push(data);
   }
+  AtomicAdjust::dec(_num_waiting_insert);
 
-  if (enqueue_ok) {
-    _queue.push_back(data);
+  if (enqueue_ok && AtomicAdjust::get(_num_waiting_extract) > 0) {
+    _extract_cv.notify();  // Only need to wake up one thread.
   }
-  _cv.notify();  // Only need to wake up one thread.
 
   return enqueue_ok;
 }
@@ -121,22 +132,62 @@ extract(NetDatagram &result) {
   // connection pointer--we're about to go to sleep for a while.
   result.clear();
 
-  MutexHolder holder(_cvlock);
+  if (AtomicAdjust::get(_shutdown)) {
+    return false;
+  }
+  if (!_queue.pop(result)) {
+    // The queue is empty; wait for something to arrive.  We count
+    // ourselves as waiting before we look again, so that a thread
+    // that inserts a datagram after we look is sure to wake us up.
+    MutexHolder holder(_cvlock);
+    AtomicAdjust::inc(_num_waiting_extract);
+    bool got_datagram = false;
+    while (!_shutdown && !(got_datagram = _queue.pop(result))) {
+      _extract_cv.wait();
+    }
+    AtomicAdjust::dec(_num_waiting_extract);
 
-  while (_queue.empty() && !_shutdown) {
-    _cv.wait();
+    if (!got_datagram) {
+      return false;
+    }
   }
 
-  if (_shutdown) {
+  // Wake up any threads waiting to stuff things into the queue.
+  wake_insert();
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramQueue::extract_many
+//       Access: Public
+//  Description: Extracts up to max_count datagrams from the head of
+//               the queue into the result vector, replacing its
+//               previous contents.  Like extract(), this blocks until
+//               at least one datagram is available, but then takes
+//               whatever else is already waiting, so that the caller
+//               may send them all together.
+//
+//               The return value is true if at least one datagram is
+//               extracted, or false if the queue was destroyed while
+//               waiting.
+////////////////////////////////////////////////////////////////////
+bool DatagramQueue::
+extract_many(pvector<NetDatagram> &result, int max_count) {
+  // As in extract(), release any outstanding connection pointers
+  // before we go to sleep.
+  result.clear();
+
+  NetDatagram datagram;
+  if (!extract(datagram)) {
     return false;
   }
+  result.push_back(datagram);
 
-  nassertr(!_queue.empty(), false);
-  result = _queue.front();
-  _queue.pop_front();
-
-  // Wake up any threads waiting to stuff things into the queue.
-  _cv.notify_all();
+  while ((int)result.size() < max_count && _queue.pop(datagram)) {
+    result.push_back(datagram);
+  }
+  wake_insert();
 
   return true;
 }
@@ -155,8 +206,8 @@ extract(NetDatagram &result) {
 ////////////////////////////////////////////////////////////////////
 void DatagramQueue::
 set_max_queue_size(int max_size) {
-  MutexHolder holder(_cvlock);
-  _max_queue_size = max_size;
+  _queue.set_max_size(max_size);
+  wake_insert();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -167,7 +218,7 @@ set_max_queue_size(int max_size) {
 ////////////////////////////////////////////////////////////////////
 int DatagramQueue::
 get_max_queue_size() const {
-  return _max_queue_size;
+  return _queue.get_max_size();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -177,7 +228,33 @@ get_max_queue_size() const {
 ////////////////////////////////////////////////////////////////////
 int DatagramQueue::
 get_current_queue_size() const {
-  MutexHolder holder(_cvlock);
-  int size = _queue.size();
-  return size;
+  return _queue.size();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramQueue::wake_extract
+//       Access: Private
+//  Description: Wakes up one thread waiting in extract(), if there
+//               are any, after a datagram has been inserted.
+////////////////////////////////////////////////////////////////////
+void DatagramQueue::
+wake_extract() {
+  if (AtomicAdjust::get(_num_waiting_extract) > 0) {
+    MutexHolder holder(_cvlock);
+    _extract_cv.notify();
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: DatagramQueue::wake_insert
+//       Access: Private
+//  Description: Wakes up any threads waiting in insert() for room,
+//               after datagrams have been extracted.
+////////////////////////////////////////////////////////////////////
+void DatagramQueue::
+wake_insert() {
+  if (AtomicAdjust::get(_num_waiting_insert) > 0) {
+    MutexHolder holder(_cvlock);
+    _insert_cv.notify_all();
+  }
 }
@@ -20,13 +20,20 @@
 #include "netDatagram.h"
 #include "pmutex.h"
 #include "conditionVarFull.h"
-#include "pdeque.h"
+#include "lockFreeQueue.h"
+#include "atomicAdjust.h"
+#include "pvector.h"
 
 ////////////////////////////////////////////////////////////////////
 //       Class : DatagramQueue
 // Description : A thread-safe, FIFO queue of NetDatagrams.  This is used
 //               by ConnectionWriter for queuing up datagrams for
 //               its various threads to write to sockets.
+//
+//               The queue itself is a LockFreeQueue; the mutex and
+//               condition variables are used only by threads that
+//               must wait for the queue to become nonempty (or
+//               nonfull), and by the threads that wake them.
 ////////////////////////////////////////////////////////////////////
 class EXPCL_PANDA_NET DatagramQueue {
 public:
@@ -36,19 +43,24 @@ public:
 
   bool insert(const NetDatagram &data, bool block = false);
   bool extract(NetDatagram &result);
+  bool extract_many(pvector<NetDatagram> &result, int max_count);
 
   void set_max_queue_size(int max_size);
   int get_max_queue_size() const;
   int get_current_queue_size() const;
 
 private:
+  void wake_extract();
+  void wake_insert();
+
   Mutex _cvlock;
-  ConditionVarFull _cv;  // signaled when queue contents change.
+  ConditionVarFull _extract_cv;  // signaled when the queue gains a datagram.
+  ConditionVarFull _insert_cv;   // signaled when the queue loses one.
 
-  typedef pdeque<NetDatagram> QueueType;
-  QueueType _queue;
-  bool _shutdown;
-  int _max_queue_size;
+  LockFreeQueue<NetDatagram> _queue;
+  AtomicAdjust::Integer _shutdown;
+  AtomicAdjust::Integer _num_waiting_extract;
+  AtomicAdjust::Integer _num_waiting_insert;
 };
 
 #endif
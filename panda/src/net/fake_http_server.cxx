@@ -21,27 +21,60 @@
 #include "netAddress.h"
 #include "connection.h"
 #include "netDatagram.h"
+#include "trueClock.h"
+#include "thread.h"
 #include "pmap.h"
+#include "pdeque.h"
 
 #include <ctype.h>
 
+// This answers GET and HEAD requests, in the order they are received,
+// on connections that are kept open between requests unless the
+// client asks otherwise, so it may be used to exercise persistent
+// connections and pipelining in HTTPClient.  The document returned
+// for any path is the path itself, repeated to fill the number of
+// bytes given by the first component of the path, if it is a number
+// (e.g. /2048/foo.txt), or 1024 bytes otherwise.  Each response is
+// held back for the optional delay, in milliseconds, to simulate a
+// distant server.
+
 QueuedConnectionManager cm;
 QueuedConnectionReader reader(&cm, 10);
-ConnectionWriter writer(&cm, 10);
+
+// The writer sends immediately, in the main thread, so that the
+// responses on each connection go out in order.
+ConnectionWriter writer(&cm, 0);
+
+double response_delay = 0.0;
 
 class ClientState {
 public:
   ClientState(Connection *client);
   void receive_data(const Datagram &data);
   void receive_line(string line);
+  bool send_responses(double now);
 
   Connection *_client;
   string _received;
+
+  string _method;
+  string _path;
+  bool _close;
+
+  class Response {
+  public:
+    double _send_time;
+    string _data;
+    bool _close;
+  };
+  typedef pdeque<Response> Responses;
+  Responses _responses;
 };
 
 ClientState::
 ClientState(Connection *client) {
   _client = client;
+  _close = false;
 }
 
 void ClientState::
@@ -50,15 +83,14 @@ receive_data(const Datagram &data) {
   size_t next = 0;
   size_t newline = _received.find('\n', next);
   while (newline != string::npos) {
-    size_t last = next;
-    next = newline + 1;
-    if (newline > 0 && _received[newline - 1] == '\r') {
-      newline--;
-    }
-    receive_line(_received.substr(last, newline - last));
-    if (next < _received.size() && _received[next] == '\r') {
-      next++;
+    // Several requests may arrive together, so be careful to split
+    // them exactly at each CR-LF.
+    size_t end = newline;
+    if (end > next && _received[end - 1] == '\r') {
+      end--;
     }
+    receive_line(_received.substr(next, end - next));
+    next = newline + 1;
     newline = _received.find('\n', next);
   }
   _received = _received.substr(next);
@@ -66,7 +98,6 @@ receive_data(const Datagram &data) {
 
 void ClientState::
 receive_line(string line) {
-  cerr << "received: " << line << "\n";
   // trim trailing whitespace.
   size_t size = line.size();
   while (size > 0 && isspace(line[size - 1])) {
@@ -76,27 +107,115 @@ receive_line(string line) {
     line = line.substr(0, size);
   }
 
-  /*
-  if (line.empty()) {
-    // Start to honor the request, as if we cared.
+  if (!line.empty()) {
+    if (_method.empty()) {
+      // The request line: "GET /path HTTP/1.1".
+      size_t sp1 = line.find(' ');
+      size_t sp2 = line.rfind(' ');
+      if (sp1 == string::npos || sp2 <= sp1) {
+        _method = "?";
+        _close = true;
+      } else {
+        _method = line.substr(0, sp1);
+        _path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        _close = (line.substr(sp2 + 1) != "HTTP/1.1");
+      }
+    } else {
+      string lower;
+      for (size_t i = 0; i < line.size(); ++i) {
+        lower += tolower(line[i]);
+      }
+      if (lower == "connection: close") {
+        _close = true;
+      }
+    }
+    return;
+  }
+
+  if (_method.empty()) {
+    // A stray blank line between requests.
+    return;
+  }
+
+  // The end of the request header; answer it.
+  ostringstream response;
+  if (_method == "GET" || _method == "HEAD") {
+    size_t size = atoi(_path.c_str() + 1);
+    if (size == 0 && (_path.size() < 2 || _path[1] != '0')) {
+      size = 1024;
+    }
+    string body;
+    while (body.size() < size) {
+      body += _path;
+    }
+    body = body.substr(0, size);
+
+    response << "HTTP/1.1 200 OK\r\n"
+             << "Content-Type: text/plain\r\n"
+             << "Content-Length: " << size << "\r\n";
+    if (_close) {
+      response << "Connection: close\r\n";
+    }
+    response << "\r\n";
+    if (_method == "GET") {
+      response << body;
+    }
+  } else {
+    response << "HTTP/1.1 501 Not Implemented\r\n"
+             << "Content-Length: 0\r\n"
+             << "Connection: close\r\n"
+             << "\r\n";
+    _close = true;
+  }
+
+  // Each response waits its turn behind the ones before it.
+  Response r;
+  r._send_time = TrueClock::get_global_ptr()->get_short_time() + response_delay;
+  if (!_responses.empty()) {
+    r._send_time = max(r._send_time, _responses.back()._send_time);
+  }
+  r._data = response.str();
+  r._close = _close;
+  _responses.push_back(r);
+
+  _method = string();
+  _path = string();
+  _close = false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: ClientState::send_responses
+//  Description: Sends whichever responses are due.  Returns false if
+//               the connection has been closed.
+////////////////////////////////////////////////////////////////////
+bool ClientState::
+send_responses(double now) {
+  while (!_responses.empty() && _responses.front()._send_time <= now) {
     Datagram dg;
-    dg.append_data("HTTP/1.1 200 OK\r\n");
+    dg.append_data(_responses.front()._data);
     writer.send(dg, _client);
-    // Close the connection!
-    cm.close_connection(_client);
+    bool close = _responses.front()._close;
+    _responses.pop_front();
+    if (close) {
+      cm.close_connection(_client);
+      return false;
+    }
   }
-  */
+  return true;
 }
 
 
 int
 main(int argc, char *argv[]) {
-  if (argc != 2) {
-    nout << "fake_http_server port\n";
+  if (argc != 2 && argc != 3) {
+    nout << "fake_http_server port [delay_ms]\n";
     exit(1);
   }
 
   int port = atoi(argv[1]);
+  if (argc == 3) {
+    response_delay = atof(argv[2]) / 1000.0;
+  }
 
   PT(Connection) rendezvous = cm.open_TCP_server_rendezvous(port, 5);
 
@@ -156,6 +275,24 @@ main(int argc, char *argv[]) {
         }
       }
     }
+
+    // Send any responses that are due.
+    double now = TrueClock::get_global_ptr()->get_short_time();
+    Clients::iterator ci = clients.begin();
+    while (ci != clients.end()) {
+      if ((*ci).second.send_responses(now)) {
+        ++ci;
+      } else {
+        Clients::iterator next = ci;
+        ++next;
+        reader.remove_connection((*ci).second._client);
+        clients.erase(ci);
+        ci = next;
+      }
+    }
+
+    // Don't spin the CPU away from the client we are serving.
+    Thread::sleep(0.0005);
   }
 
   return (0);
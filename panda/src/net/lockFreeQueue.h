@@ -0,0 +1,97 @@
+// Filename: lockFreeQueue.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+#include "pandabase.h"
+
+#include "atomicAdjust.h"
+#include "lightMutex.h"
+#include "lightMutexHolder.h"
+#include "pdeque.h"
+#include "pvector.h"
+
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////
+//       Class : LockFreeQueue
+// Description : A thread-safe FIFO queue of things, used by
+//               QueuedReturn and DatagramQueue to pass datagrams
+//               between threads.
+//
+//               Things are normally stored in a fixed-size ring, to
+//               which any number of threads may add things and from
+//               which any number of threads may remove them, without
+//               taking a lock.  If the ring fills up, further things
+//               spill into a deque protected by a mutex, until the
+//               consumers have caught up and emptied it again; this
+//               keeps the order of things added by any one thread.
+//
+//               The total number of things is limited by max_size;
+//               push() fails when the queue holds that many.  A
+//               ring_size of 0 disables the ring, so that every
+//               operation takes the lock.
+////////////////////////////////////////////////////////////////////
+template<class Thing>
+class LockFreeQueue {
+public:
+  LockFreeQueue(int ring_size, int max_size);
+
+  void set_max_size(int max_size);
+  INLINE int get_max_size() const;
+  INLINE int get_ring_size() const;
+
+  INLINE int size() const;
+  INLINE bool empty() const;
+
+  bool push(const Thing &thing);
+  bool push_unique(const Thing &thing);
+  bool pop(Thing &result);
+
+private:
+  bool reserve();
+  bool ring_push(const Thing &thing);
+  bool ring_pop(Thing &result);
+
+  class Cell {
+  public:
+    AtomicAdjust::Integer _sequence;
+    Thing _thing;
+  };
+  typedef pvector<Cell> Cells;
+  Cells _cells;
+  AtomicAdjust::Integer _mask;
+
+  // The producers and the consumers each hammer on their own end of
+  // the ring; keep the two on separate cache lines.
+  char _pad0[64];
+  AtomicAdjust::Integer _head;
+  char _pad1[64];
+  AtomicAdjust::Integer _tail;
+  char _pad2[64];
+
+  AtomicAdjust::Integer _size;
+  AtomicAdjust::Integer _max_size;
+
+  // _spilled is true while _overflow is in use; it is changed only
+  // with _mutex held.
+  AtomicAdjust::Integer _spilled;
+  LightMutex _mutex;
+  pdeque<Thing> _overflow;
+};
+
+#include "lockFreeQueue.I"
+
+#endif
@@ -83,6 +83,25 @@ operator = (const NetDatagram &copy) {
   _address = copy._address;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: NetDatagram::swap
+//       Access: Public
+//  Description: Exchanges the contents of this datagram, including
+//               its connection and address, with the other one.
+////////////////////////////////////////////////////////////////////
+void NetDatagram::
+swap(NetDatagram &other) {
+  Datagram::swap(other);
+
+  PT(Connection) temp_connection = _connection;
+  _connection = other._connection;
+  other._connection = temp_connection;
+
+  NetAddress temp_address = _address;
+  _address = other._address;
+  other._address = temp_address;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: NetDatagram::clear
 //       Access: Public, Virtual
@@ -48,6 +48,7 @@ PUBLISHED:
   NetDatagram(const NetDatagram &copy);
   void operator = (const Datagram &copy);
   void operator = (const NetDatagram &copy);
+  void swap(NetDatagram &other);
 
   virtual void clear();
 
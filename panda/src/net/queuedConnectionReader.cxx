@@ -94,7 +94,11 @@ get_data(Datagram &result) {
   if (!get_thing(nd)) {
     return false;
   }
-  result = nd;
+
+  // Swapping hands over the array without sharing it, so that the
+  // previous contents of result can go back to the DatagramBufferPool
+  // when nd destructs.
+  result.swap(nd);
   return true;
 }
 
@@ -127,6 +131,28 @@ receive_datagram(const NetDatagram &datagram) {
 #endif  // SIMULATE_NETWORK_DELAY
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: QueuedConnectionReader::receive_datagrams
+//       Access: Protected, Virtual
+//  Description: An internal function called by ConnectionReader()
+//               when several datagrams have been read at once.  They
+//               are all queued up together.
+////////////////////////////////////////////////////////////////////
+void QueuedConnectionReader::
+receive_datagrams(const NetDatagram *datagrams, int num_datagrams) {
+#ifdef SIMULATE_NETWORK_DELAY
+  for (int i = 0; i < num_datagrams; ++i) {
+    delay_datagram(datagrams[i]);
+  }
+
+#else  // SIMULATE_NETWORK_DELAY
+  if (enqueue_things(datagrams, num_datagrams) < num_datagrams) {
+    net_cat.error()
+      << "QueuedConnectionReader queue full!\n";
+  }
+#endif  // SIMULATE_NETWORK_DELAY
+}
+
 
 #ifdef SIMULATE_NETWORK_DELAY
 ////////////////////////////////////////////////////////////////////
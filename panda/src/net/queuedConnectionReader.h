@@ -46,6 +46,7 @@ PUBLISHED:
 
 protected:
   virtual void receive_datagram(const NetDatagram &datagram);
+  virtual void receive_datagrams(const NetDatagram *datagrams, int num_datagrams);
 
 #ifdef SIMULATE_NETWORK_DELAY
 PUBLISHED:
@@ -20,10 +20,9 @@
 #include "connectionListener.h"
 #include "connection.h"
 #include "netAddress.h"
-#include "lightMutex.h"
-#include "pdeque.h"
+#include "lockFreeQueue.h"
+#include "atomicAdjust.h"
 #include "config_net.h"
-#include "lightMutexHolder.h"
 
 #include <algorithm>
 
@@ -52,14 +51,15 @@ protected:
   bool get_thing(Thing &thing);
 
   bool enqueue_thing(const Thing &thing);
+  int enqueue_things(const Thing *things, int num_things);
   bool enqueue_unique_thing(const Thing &thing);
 
 private:
-  LightMutex _mutex;
-  pdeque<Thing> _things;
-  bool _available;
-  int _max_queue_size;
-  bool _overflow_flag;
+  LockFreeQueue<Thing> _things;
+
+  // This is set by the threads that enqueue things, and read and
+  // cleared by the client, so it is adjusted atomically.
+  AtomicAdjust::Integer _overflow_flag;
 };
 
 #include "queuedReturn.I"
@@ -0,0 +1,108 @@
+// Filename: test_datagram_pool.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+
+#include "netDatagram.h"
+#include "datagramIterator.h"
+#include "datagramBufferPool.h"
+#include "lockFreeQueue.h"
+#include "load_prc_file.h"
+#include "trueClock.h"
+#include "randomizer.h"
+#include "pvector.h"
+
+// This counts the arrays allocated for Datagrams along the path a
+// message takes through a client, with the DatagramBufferPool
+// disabled and then enabled.  Each message is received (copied out of
+// a socket buffer into a NetDatagram), queued as by a
+// QueuedConnectionReader, handed to a long-lived Datagram as by
+// CConnectionRepository, and read; then a reply is built up field by
+// field, as by a distributed object update, and dropped.
+//
+// Usage: test_datagram_pool [count]
+//
+// The default count is 1000000 messages.
+
+static void
+run_test(bool use_pool, int num_messages) {
+  load_prc_file_data("", use_pool ? "datagram-buffer-pool-bytes 1048576" :
+                     "datagram-buffer-pool-bytes 0");
+  DatagramBufferPool::clear_pool();
+  DatagramBufferPool::reset_counts();
+
+  // Messages of typical sizes, from a position update to a large
+  // generate.
+  Randomizer random(1);
+  pvector<string> messages;
+  for (int i = 0; i < 64; ++i) {
+    int size = (i % 8 == 0) ? 200 + random.random_int(1200) : 16 + random.random_int(48);
+    string message;
+    for (int j = 0; j < size; ++j) {
+      message += (char)random.random_int(256);
+    }
+    messages.push_back(message);
+  }
+
+  LockFreeQueue<NetDatagram> queue(1024, 4096);
+  Datagram repository_dg;
+  size_t total_bytes = 0;
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+
+  for (int i = 0; i < num_messages; ++i) {
+    const string &message = messages[i % messages.size()];
+    {
+      NetDatagram received(message.data(), message.size());
+      queue.push(received);
+    }
+
+    NetDatagram queued;
+    queue.pop(queued);
+    repository_dg.swap(queued);
+
+    DatagramIterator di(repository_dg);
+    total_bytes += di.get_remaining_size();
+
+    Datagram reply;
+    reply.add_uint16(i);
+    reply.add_uint32(i * 3);
+    reply.add_string("setPos");
+    reply.add_float64(i * 0.5);
+    reply.add_float64(i * 0.25);
+    reply.add_float64(0.0);
+  }
+
+  double elapsed = clock->get_short_time() - start;
+  int num_allocated = DatagramBufferPool::get_num_allocated();
+  nout << (use_pool ? "with pool:    " : "without pool: ")
+       << num_allocated << " arrays allocated for "
+       << num_messages * 2 << " datagrams ("
+       << (double)num_allocated / (num_messages * 2) << " per datagram), "
+       << DatagramBufferPool::get_num_reused() << " reused, "
+       << (int)(num_messages / elapsed) << " messages/sec\n";
+}
+
+int
+main(int argc, char *argv[]) {
+  int num_messages = 1000000;
+  if (argc > 1) {
+    num_messages = atoi(argv[1]);
+  }
+
+  run_test(false, num_messages);
+  run_test(true, num_messages);
+  return (0);
+}
@@ -0,0 +1,168 @@
+// Filename: test_queue_contention.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+
+#include "datagramQueue.h"
+#include "netDatagram.h"
+#include "datagramIterator.h"
+#include "config_net.h"
+#include "load_prc_file.h"
+#include "trueClock.h"
+#include "thread.h"
+#include "atomicAdjust.h"
+#include "string_utils.h"
+#include "pvector.h"
+
+// This hammers on a DatagramQueue from several producer threads at
+// once, with one or more consumer threads taking the datagrams off
+// the other end, first with the lock-free ring disabled and then with
+// it enabled (see net-lock-free-queue-size).  Each datagram carries
+// its producer and sequence number; with a single consumer, the test
+// checks that every producer's datagrams arrive complete and in
+// order.  It reports the datagrams per second passed through the
+// queue.
+//
+// Usage: test_queue_contention [opts]
+//
+//   -p producers  The number of producer threads (default 4).
+//   -c consumers  The number of consumer threads (default 1).
+//   -n count      The number of datagrams per producer (default
+//                 500000).
+
+static int num_producers = 4;
+static int num_consumers = 1;
+static int num_per_producer = 500000;
+static AtomicAdjust::Integer num_errors = 0;
+
+class ProducerThread : public Thread {
+public:
+  ProducerThread(DatagramQueue &queue, int index) :
+    Thread("producer", "producer"), _queue(queue), _index(index) { }
+
+  virtual void thread_main() {
+    for (int i = 0; i < num_per_producer; ++i) {
+      NetDatagram datagram;
+      datagram.add_uint16(_index);
+      datagram.add_uint32(i);
+      _queue.insert(datagram, true);
+    }
+  }
+
+private:
+  DatagramQueue &_queue;
+  int _index;
+};
+
+class ConsumerThread : public Thread {
+public:
+  ConsumerThread(DatagramQueue &queue) :
+    Thread("consumer", "consumer"), _queue(queue), _num_received(0),
+    _next(num_producers, 0) { }
+
+  virtual void thread_main() {
+    NetDatagram datagram;
+    while (_queue.extract(datagram)) {
+      DatagramIterator di(datagram);
+      int producer = di.get_uint16();
+      int seq = di.get_uint32();
+      if (num_consumers == 1 && seq != _next[producer]) {
+        AtomicAdjust::inc(num_errors);
+      }
+      _next[producer] = seq + 1;
+      AtomicAdjust::inc(_num_received);
+    }
+  }
+
+  AtomicAdjust::Integer get_num_received() const {
+    return AtomicAdjust::get(_num_received);
+  }
+
+private:
+  DatagramQueue &_queue;
+  AtomicAdjust::Integer _num_received;
+  pvector<int> _next;
+};
+
+static void
+run_test(int ring_size) {
+  load_prc_file_data("", "net-lock-free-queue-size " + format_string(ring_size));
+  DatagramQueue queue;
+  queue.set_max_queue_size(4096);
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+
+  pvector< PT(ConsumerThread) > consumers;
+  for (int i = 0; i < num_consumers; ++i) {
+    PT(ConsumerThread) thread = new ConsumerThread(queue);
+    thread->start(TP_normal, true);
+    consumers.push_back(thread);
+  }
+  pvector< PT(ProducerThread) > producers;
+  for (int i = 0; i < num_producers; ++i) {
+    PT(ProducerThread) thread = new ProducerThread(queue, i);
+    thread->start(TP_normal, true);
+    producers.push_back(thread);
+  }
+  for (int i = 0; i < num_producers; ++i) {
+    producers[i]->join();
+  }
+
+  AtomicAdjust::Integer total = (AtomicAdjust::Integer)num_producers * num_per_producer;
+  AtomicAdjust::Integer num_received = 0;
+  while (num_received < total) {
+    Thread::force_yield();
+    num_received = 0;
+    for (int i = 0; i < num_consumers; ++i) {
+      num_received += consumers[i]->get_num_received();
+    }
+  }
+  double elapsed = clock->get_short_time() - start;
+
+  queue.shutdown();
+  for (int i = 0; i < num_consumers; ++i) {
+    consumers[i]->join();
+  }
+
+  nout << "ring size " << ring_size << ": " << num_producers
+       << " producers, " << num_consumers << " consumers, "
+       << (int)(num_received / elapsed) << " datagrams/sec\n";
+}
+
+int
+main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg == "-p" && i + 1 < argc) {
+      num_producers = atoi(argv[++i]);
+    } else if (arg == "-c" && i + 1 < argc) {
+      num_consumers = atoi(argv[++i]);
+    } else if (arg == "-n" && i + 1 < argc) {
+      num_per_producer = atoi(argv[++i]);
+    } else {
+      nout << "test_queue_contention [-p producers] [-c consumers] [-n count]\n";
+      exit(1);
+    }
+  }
+
+  run_test(0);
+  run_test(1024);
+
+  if (AtomicAdjust::get(num_errors) != 0) {
+    nout << AtomicAdjust::get(num_errors) << " datagrams out of order!\n";
+    return (1);
+  }
+  return (0);
+}
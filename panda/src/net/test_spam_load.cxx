@@ -0,0 +1,227 @@
+// Filename: test_spam_load.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+
+#include "queuedConnectionManager.h"
+#include "queuedConnectionListener.h"
+#include "queuedConnectionReader.h"
+#include "connectionWriter.h"
+#include "netAddress.h"
+#include "connection.h"
+#include "netDatagram.h"
+#include "datagramIterator.h"
+#include "config_net.h"
+#include "load_prc_file.h"
+#include "trueClock.h"
+#include "thread.h"
+
+#include "pvector.h"
+#include <algorithm>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+// This is a load test in the spirit of test_spam_server and
+// test_spam_client, but both ends run in the one process, so that it
+// can open many connections at once.  It connects the indicated
+// numbers of clients to a QueuedConnectionReader in turn; in each
+// round, every client sends the server one small datagram, stamped
+// with the time it was sent, and the server reads them all.  It
+// reports the datagrams per second received by the server, and the
+// median and 99th percentile time from send to receipt.
+//
+// Usage: test_spam_load [opts] [num_connections ...]
+//
+//   -p port      The port to listen on (default 4401).
+//   -t threads   The number of reader threads (default 0, polling).
+//   -d seconds   The time to spend at each number of connections
+//                (default 5).
+//   -s           Wait with select() instead of epoll.
+//
+// The default numbers of connections are 1000, 5000, and 10000.  Each
+// connection uses two descriptors, so the descriptor limit is raised
+// as far as possible; with select(), no more than about 500
+// connections are possible.
+
+typedef pvector< PT(Connection) > Connections;
+typedef pvector<double> Latencies;
+
+static void
+accept_connections(QueuedConnectionListener &listener,
+                   QueuedConnectionReader &reader, int &num_accepted) {
+  listener.poll();
+  while (listener.new_connection_available()) {
+    PT(Connection) rv;
+    NetAddress address;
+    PT(Connection) new_connection;
+    if (listener.get_new_connection(rv, address, new_connection)) {
+      reader.add_connection(new_connection);
+      ++num_accepted;
+    }
+  }
+}
+
+static int
+read_datagrams(QueuedConnectionReader &reader, Latencies &latencies) {
+  TrueClock *clock = TrueClock::get_global_ptr();
+  int num_read = 0;
+  while (reader.data_available()) {
+    NetDatagram datagram;
+    if (reader.get_data(datagram)) {
+      double now = clock->get_short_time();
+      DatagramIterator di(datagram);
+      latencies.push_back(now - di.get_float64());
+      ++num_read;
+    }
+  }
+  return num_read;
+}
+
+int
+main(int argc, char *argv[]) {
+  int port = 4401;
+  int num_threads = 0;
+  double duration = 5.0;
+  pvector<int> counts;
+
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg == "-p" && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (arg == "-t" && i + 1 < argc) {
+      num_threads = atoi(argv[++i]);
+    } else if (arg == "-d" && i + 1 < argc) {
+      duration = atof(argv[++i]);
+    } else if (arg == "-s") {
+      load_prc_file_data("", "net-use-epoll 0");
+    } else if (!arg.empty() && isdigit(arg[0])) {
+      counts.push_back(atoi(arg.c_str()));
+    } else {
+      nout << "test_spam_load [-p port] [-t threads] [-d seconds] [-s] "
+           << "[num_connections ...]\n";
+      exit(1);
+    }
+  }
+  if (counts.empty()) {
+    counts.push_back(1000);
+    counts.push_back(5000);
+    counts.push_back(10000);
+  }
+  sort(counts.begin(), counts.end());
+
+#ifndef WIN32
+  // Each connection needs a descriptor at both ends.
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    nout << "Descriptor limit is " << (long)limit.rlim_cur << "\n";
+  }
+#endif
+
+  QueuedConnectionManager cm;
+  PT(Connection) rendezvous = cm.open_TCP_server_rendezvous(port, 1024);
+  if (rendezvous.is_null()) {
+    nout << "Cannot grab port " << port << ".\n";
+    exit(1);
+  }
+
+  NetAddress host;
+  host.set_host("127.0.0.1", port);
+
+  QueuedConnectionListener listener(&cm, 0);
+  listener.add_connection(rendezvous);
+  QueuedConnectionReader reader(&cm, num_threads);
+  ConnectionWriter writer(&cm, 0);
+
+  nout << "Waiting with " << (net_use_epoll ? "epoll (if available)" : "select")
+       << ", " << num_threads << " reader threads.\n";
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  Connections clients;
+  int num_accepted = 0;
+
+  for (size_t ci = 0; ci < counts.size(); ++ci) {
+    // Add clients until we have the required number.  We keep the
+    // clients from the previous count, rather than closing them, to
+    // go easy on the supply of local ports.
+    int count = counts[ci];
+    while ((int)clients.size() < count) {
+      PT(Connection) c = cm.open_TCP_client_connection(host, 5000);
+      if (c.is_null()) {
+        break;
+      }
+      clients.push_back(c);
+      accept_connections(listener, reader, num_accepted);
+    }
+    while (num_accepted < (int)clients.size()) {
+      accept_connections(listener, reader, num_accepted);
+      Thread::force_yield();
+    }
+    if ((int)clients.size() < count) {
+      nout << "Could only open " << clients.size() << " connections.\n";
+      break;
+    }
+
+    Latencies latencies;
+    int num_sent = 0;
+    int num_received = 0;
+    double start = clock->get_short_time();
+    double now = start;
+    while (now - start < duration) {
+      // One round: each client sends one datagram.
+      Connections::const_iterator ti;
+      for (ti = clients.begin(); ti != clients.end(); ++ti) {
+        NetDatagram datagram;
+        datagram.add_float64(clock->get_short_time());
+        datagram.add_uint32(num_sent);
+        if (writer.send(datagram, (*ti))) {
+          ++num_sent;
+        }
+        if ((num_sent & 0xff) == 0) {
+          num_received += read_datagrams(reader, latencies);
+        }
+      }
+
+      // Now wait for the rest of the round to come in.
+      double round_start = clock->get_short_time();
+      while (num_received < num_sent &&
+             clock->get_short_time() - round_start < 1.0) {
+        int num_read = read_datagrams(reader, latencies);
+        num_received += num_read;
+        if (num_read == 0) {
+          Thread::force_yield();
+        }
+      }
+      now = clock->get_short_time();
+    }
+    double elapsed = now - start;
+
+    sort(latencies.begin(), latencies.end());
+    double median = 0.0, p99 = 0.0;
+    if (!latencies.empty()) {
+      median = latencies[latencies.size() / 2];
+      p99 = latencies[min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    }
+    nout << count << " connections: sent " << num_sent << ", received "
+         << num_received << ", " << (int)(num_received / elapsed)
+         << " datagrams/sec, latency median " << median * 1000.0
+         << " ms, p99 " << p99 * 1000.0 << " ms\n";
+  }
+
+  return (0);
+}
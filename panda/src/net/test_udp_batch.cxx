@@ -0,0 +1,184 @@
+// Filename: test_udp_batch.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+
+#include "queuedConnectionManager.h"
+#include "queuedConnectionReader.h"
+#include "connectionWriter.h"
+#include "netAddress.h"
+#include "connection.h"
+#include "netDatagram.h"
+#include "config_net.h"
+#include "load_prc_file.h"
+#include "trueClock.h"
+#include "thread.h"
+#include "string_utils.h"
+
+#include "pvector.h"
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+// This is a loopback benchmark of the UDP path through
+// ConnectionWriter and QueuedConnectionReader.  For each of the
+// indicated batch sizes in turn (see net-udp-batch-size), a threaded
+// writer sends a stream of small datagrams to a UDP port in the same
+// process, and a threaded reader queues them up for the main thread.
+// It reports the packets per second received, and the CPU time spent
+// by the whole process per packet.
+//
+// Usage: test_udp_batch [opts] [batch_size ...]
+//
+//   -p port      The port to listen on (default 4402).
+//   -n count     The number of datagrams to send for each batch size
+//                (default 1000000).
+//   -s bytes     The size of each datagram (default 64).
+//
+// The default batch sizes are 1 and 32.
+
+static double
+get_cpu_time() {
+#ifndef WIN32
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+    (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static int
+read_datagrams(QueuedConnectionReader &reader) {
+  int num_read = 0;
+  NetDatagram datagram;
+  while (reader.data_available()) {
+    if (reader.get_data(datagram)) {
+      ++num_read;
+    }
+  }
+  return num_read;
+}
+
+int
+main(int argc, char *argv[]) {
+  int port = 4402;
+  int num_packets = 1000000;
+  int packet_size = 64;
+  pvector<int> batch_sizes;
+
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg == "-p" && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (arg == "-n" && i + 1 < argc) {
+      num_packets = atoi(argv[++i]);
+    } else if (arg == "-s" && i + 1 < argc) {
+      packet_size = atoi(argv[++i]);
+    } else if (!arg.empty() && isdigit(arg[0])) {
+      batch_sizes.push_back(atoi(arg.c_str()));
+    } else {
+      nout << "test_udp_batch [-p port] [-n count] [-s bytes] "
+           << "[batch_size ...]\n";
+      exit(1);
+    }
+  }
+  if (batch_sizes.empty()) {
+    batch_sizes.push_back(1);
+    batch_sizes.push_back(32);
+  }
+
+  QueuedConnectionManager cm;
+  PT(Connection) in = cm.open_UDP_connection(port);
+  if (in.is_null()) {
+    nout << "Cannot grab UDP port " << port << ".\n";
+    exit(1);
+  }
+  in->set_recv_buffer_size(4 * 1024 * 1024);
+
+  PT(Connection) out = cm.open_UDP_connection();
+  if (out.is_null()) {
+    nout << "Cannot open outgoing UDP connection.\n";
+    exit(1);
+  }
+
+  NetAddress host;
+  host.set_host("127.0.0.1", port);
+
+  NetDatagram datagram;
+  for (int i = 0; i < packet_size; ++i) {
+    datagram.add_uint8(i & 0xff);
+  }
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+
+  for (size_t bi = 0; bi < batch_sizes.size(); ++bi) {
+    int batch_size = batch_sizes[bi];
+    load_prc_file_data("", "net-udp-batch-size " + format_string(batch_size));
+
+    // The reader and writer are created anew for each batch size,
+    // since the writer threads read net-udp-batch-size only once.
+    int num_sent = 0;
+    int num_received = 0;
+    double start, elapsed, cpu;
+    {
+      QueuedConnectionReader reader(&cm, 1);
+      reader.set_max_queue_size(num_packets);
+      reader.add_connection(in);
+      ConnectionWriter writer(&cm, 1);
+      writer.set_max_queue_size(4096);
+
+      start = clock->get_short_time();
+      double cpu_start = get_cpu_time();
+      while (num_sent < num_packets) {
+        if (writer.send(datagram, out, host, true)) {
+          ++num_sent;
+        }
+        if ((num_sent & 0xff) == 0) {
+          num_received += read_datagrams(reader);
+        }
+      }
+
+      // Give the stragglers a moment to arrive; whatever doesn't
+      // arrive by then was dropped.
+      double wait_start = clock->get_short_time();
+      double last_arrival = wait_start;
+      double now = wait_start;
+      while (num_received < num_sent && now - last_arrival < 0.2) {
+        int num_read = read_datagrams(reader);
+        now = clock->get_short_time();
+        if (num_read != 0) {
+          num_received += num_read;
+          last_arrival = now;
+        } else {
+          Thread::force_yield();
+        }
+      }
+      elapsed = last_arrival - start;
+      cpu = get_cpu_time() - cpu_start;
+
+      reader.remove_connection(in);
+    }
+
+    nout << "batch size " << batch_size << ": sent " << num_sent
+         << ", received " << num_received << ", "
+         << (int)(num_received / elapsed) << " packets/sec, "
+         << cpu * 1000000.0 / max(num_received, 1)
+         << " CPU usec/packet\n";
+  }
+
+  return (0);
+}
@@ -349,3 +349,14 @@
   #define OTHER_LIBS $[OTHER_LIBS] p3pystub
 
 #end test_bin_target
+
+#begin test_bin_target
+  #define TARGET test_optimize
+
+  #define SOURCES \
+    test_optimize.cxx
+
+  #define LOCAL_LIBS $[LOCAL_LIBS] p3pgraph p3mathutil
+  #define OTHER_LIBS $[OTHER_LIBS] p3pystub
+
+#end test_bin_target
@@ -26,6 +26,7 @@
 #include "vector_int.h"
 #include "userVertexTransform.h"
 #include "geomMunger.h"
+#include "geomTriangles.h"
 #include "texture.h"
 #include "texturePeeker.h"
 #include "config_pgraph.h"
@@ -36,6 +37,8 @@ PStatCollector GeomTransformer::_apply_set_color_collector("*:Flatten:apply:set
 PStatCollector GeomTransformer::_apply_scale_color_collector("*:Flatten:apply:scale color");
 PStatCollector GeomTransformer::_apply_texture_color_collector("*:Flatten:apply:texture color");
 PStatCollector GeomTransformer::_apply_set_format_collector("*:Flatten:apply:set format");
+PStatCollector GeomTransformer::_optimize_collector("*:Flatten:optimize geometry");
+PStatCollector GeomTransformer::_simplify_collector("*:Flatten:simplify");
 
 TypeHandle GeomTransformer::NewCollectedData::_type_handle;
 
@@ -47,7 +50,11 @@ TypeHandle GeomTransformer::NewCollectedData::_type_handle;
 GeomTransformer::
 GeomTransformer() :
   // The default value here comes from the Config file.
-  _max_collect_vertices(max_collect_vertices)
+  _max_collect_vertices(max_collect_vertices),
+  _num_optimized_triangles(0),
+  _misses_before(0.0),
+  _misses_after(0.0),
+  _simplify_error(0.0)
 {
 }
 
@@ -58,7 +65,11 @@ GeomTransformer() :
 ////////////////////////////////////////////////////////////////////
 GeomTransformer::
 GeomTransformer(const GeomTransformer &copy) :
-  _max_collect_vertices(copy._max_collect_vertices)
+  _max_collect_vertices(copy._max_collect_vertices),
+  _num_optimized_triangles(0),
+  _misses_before(0.0),
+  _misses_after(0.0),
+  _simplify_error(0.0)
 {
 }
 
@@ -1209,6 +1220,351 @@ finish_collect(bool format_only) {
   return num_adjusted;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: GeomTransformer::optimize_geometry
+//       Access: Public
+//  Description: Reorders the triangles of each GeomTriangles
+//               primitive in the Geom for better use of the
+//               post-transform vertex cache and, if OG_overdraw is
+//               set, for reduced overdraw.  If OG_vertex_order is
+//               set, the Geom is also recorded so that its vertices
+//               may later be renumbered by finish_optimize().
+//
+//               Triangle strips and fans are left alone; call
+//               decompose() first if these should be optimized too.
+//
+//               Returns the number of primitives that were
+//               reordered.  You should follow this up with a call to
+//               finish_optimize(), but you probably don't want to
+//               call this method directly anyway.  Call
+//               SceneGraphReducer::optimize_geometry() instead.
+////////////////////////////////////////////////////////////////////
+int GeomTransformer::
+optimize_geometry(Geom *geom, int optimize_bits,
+                  const VertexCacheOptimizer &optimizer) {
+  PStatTimer timer(_optimize_collector);
+  Thread *current_thread = Thread::get_current_thread();
+
+  CPT(GeomVertexData) vdata = geom->get_vertex_data();
+  if ((optimize_bits & SceneGraphReducer::OG_avoid_dynamic) != 0 &&
+      (vdata->get_usage_hint() != Geom::UH_static ||
+       geom->get_usage_hint() != Geom::UH_static)) {
+    return 0;
+  }
+
+  int cache_size = optimizer.get_cache_size();
+  pvector<LPoint3> positions;
+  int num_changed = 0;
+
+  int num_primitives = geom->get_num_primitives();
+  for (int i = 0; i < num_primitives; ++i) {
+    CPT(GeomPrimitive) prim = geom->get_primitive(i);
+    if (prim->get_primitive_type() != GeomPrimitive::PT_polygons ||
+        prim->is_composite()) {
+      continue;
+    }
+
+    vector_int indices;
+    {
+      GeomPrimitivePipelineReader reader(prim, current_thread);
+      int num_vertices = reader.get_num_vertices();
+      indices.reserve(num_vertices);
+      for (int vi = 0; vi < num_vertices; ++vi) {
+        indices.push_back(reader.get_vertex(vi));
+      }
+    }
+    int num_triangles = (int)indices.size() / 3;
+    if (num_triangles < 2) {
+      continue;
+    }
+
+    _num_optimized_triangles += num_triangles;
+    _misses_before += VertexCacheOptimizer::calc_acmr(indices, cache_size) * num_triangles;
+
+    vector_int orig_indices(indices);
+    if ((optimize_bits & SceneGraphReducer::OG_vertex_cache) != 0) {
+      optimizer.optimize(indices);
+    }
+
+    if ((optimize_bits & SceneGraphReducer::OG_overdraw) != 0) {
+      if (positions.empty()) {
+        GeomVertexReader vertex(vdata, InternalName::get_vertex(),
+                                current_thread);
+        if (vertex.has_column()) {
+          int num_rows = vdata->get_num_rows();
+          positions.reserve(num_rows);
+          for (int ri = 0; ri < num_rows; ++ri) {
+            positions.push_back(LPoint3(vertex.get_data3()));
+          }
+        }
+      }
+      if (!positions.empty()) {
+        optimizer.optimize_overdraw(indices, positions);
+      }
+    }
+
+    _misses_after += VertexCacheOptimizer::calc_acmr(indices, cache_size) * num_triangles;
+
+    if (indices != orig_indices) {
+      PT(GeomPrimitive) new_prim = geom->modify_primitive(i);
+      new_prim->make_indexed();
+      PT(GeomVertexArrayData) vertices = new_prim->modify_vertices();
+      GeomVertexWriter writer(vertices, 0, current_thread);
+      vector_int::const_iterator ii;
+      for (ii = indices.begin(); ii != indices.end(); ++ii) {
+        writer.set_data1i(*ii);
+      }
+      ++num_changed;
+    }
+  }
+
+  if ((optimize_bits & SceneGraphReducer::OG_vertex_order) != 0) {
+    _reorder_assoc[vdata]._geoms.push_back(geom);
+  }
+
+  return num_changed;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: GeomTransformer::optimize_geometry
+//       Access: Public
+//  Description: Calls optimize_geometry() on each of the Geoms of
+//               the indicated GeomNode.  Returns the number of
+//               primitives that were reordered.
+////////////////////////////////////////////////////////////////////
+int GeomTransformer::
+optimize_geometry(GeomNode *node, int optimize_bits,
+                  const VertexCacheOptimizer &optimizer) {
+  int num_changed = 0;
+  int num_geoms = node->get_num_geoms();
+  for (int i = 0; i < num_geoms; ++i) {
+    PT(Geom) geom = node->modify_geom(i);
+    num_changed += optimize_geometry(geom, optimize_bits, optimizer);
+  }
+  return num_changed;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: GeomTransformer::finish_optimize
+//       Access: Public
+//  Description: This should be called after a call to
+//               optimize_geometry() to renumber the vertices of the
+//               recorded GeomVertexDatas in the order in which they
+//               are first referenced, so that the vertex fetches
+//               proceed roughly sequentially through memory.
+//
+//               Also fills in the average cache miss ratio of all of
+//               the triangles examined by optimize_geometry(), before
+//               and after they were reordered; these are both 0 if
+//               no triangles were found.  Returns the number of
+//               triangles examined.
+////////////////////////////////////////////////////////////////////
+int GeomTransformer::
+finish_optimize(double &acmr_before, double &acmr_after) {
+  PStatTimer timer(_optimize_collector);
+
+  VertexDataAssocMap::iterator vi;
+  for (vi = _reorder_assoc.begin(); vi != _reorder_assoc.end(); ++vi) {
+    (*vi).second.reorder_vertices((*vi).first);
+  }
+  _reorder_assoc.clear();
+
+  int num_triangles = _num_optimized_triangles;
+  if (num_triangles != 0) {
+    acmr_before = _misses_before / num_triangles;
+    acmr_after = _misses_after / num_triangles;
+  } else {
+    acmr_before = 0.0;
+    acmr_after = 0.0;
+  }
+
+  _num_optimized_triangles = 0;
+  _misses_before = 0.0;
+  _misses_after = 0.0;
+  return num_triangles;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: GeomTransformer::simplify
+//       Access: Public
+//  Description: Reduces the number of triangles in the polygon
+//               primitives of the Geom, taken together, to
+//               approximately triangle_ratio times their original
+//               count, using a MeshSimplifier.  Triangle strips and fans are
+//               decomposed into triangles first.  If max_error is
+//               greater than zero, the simplification also stops
+//               before any part of the surface would be moved by
+//               more than about that distance.
+//
+//               Vertices are never moved or blended; the remaining
+//               triangles simply reference a subset of the original
+//               vertices.  Vertices that share a position (such as
+//               along a UV seam) are only removed together, along
+//               the seam, so the seam stays closed; and vertices with
+//               different joint assignments are never merged.
+//
+//               Returns the number of triangles removed.  You should
+//               follow this up with a call to finish_simplify(), but
+//               you probably don't want to call this method directly
+//               anyway.  Call SceneGraphReducer::simplify() instead.
+////////////////////////////////////////////////////////////////////
+int GeomTransformer::
+simplify(Geom *geom, PN_stdfloat triangle_ratio, PN_stdfloat max_error) {
+  PStatTimer timer(_simplify_collector);
+  Thread *current_thread = Thread::get_current_thread();
+
+  CPT(GeomVertexData) vdata = geom->get_vertex_data();
+  if (vdata->get_slider_table() != (SliderTable *)NULL) {
+    // We can't tell which vertices are moved by the morph sliders.
+    return 0;
+  }
+
+  GeomVertexReader vertex(vdata, InternalName::get_vertex(), current_thread);
+  if (!vertex.has_column()) {
+    return 0;
+  }
+  int num_rows = vdata->get_num_rows();
+  pvector<LPoint3> positions;
+  positions.reserve(num_rows);
+  int ri;
+  for (ri = 0; ri < num_rows; ++ri) {
+    positions.push_back(LPoint3(vertex.get_data3()));
+  }
+
+  // Assign each vertex a class according to the joints that animate
+  // it, so that we don't collapse vertices that move differently.
+  vector_int classes(num_rows, 0);
+  GeomVertexReader blend(vdata, InternalName::get_transform_blend(),
+                         current_thread);
+  GeomVertexReader index(vdata, InternalName::get_transform_index(),
+                         current_thread);
+  GeomVertexReader weight(vdata, InternalName::get_transform_weight(),
+                          current_thread);
+  if (blend.has_column()) {
+    for (ri = 0; ri < num_rows; ++ri) {
+      classes[ri] = blend.get_data1i();
+    }
+  } else if (index.has_column() && weight.has_column()) {
+    typedef pmap<pair<LVecBase4i, LVecBase4>, int> Influences;
+    Influences influences;
+    for (ri = 0; ri < num_rows; ++ri) {
+      Influences::value_type entry
+        (Influences::key_type(index.get_data4i(), weight.get_data4()),
+         (int)influences.size());
+      classes[ri] = (*influences.insert(entry).first).second;
+    }
+  }
+
+  // All of the triangle primitives of the Geom are simplified
+  // together, in one mesh, so that the edges they share stay closed.
+  // Each triangle is tagged with the primitive it came from, so the
+  // survivors can be put back where they belong.
+  MeshSimplifier simplifier;
+  for (ri = 0; ri < num_rows; ++ri) {
+    simplifier.add_vertex(positions[ri], classes[ri]);
+  }
+
+  typedef pvector< CPT(GeomPrimitive) > Primitives;
+  Primitives prims;
+  vector_int prim_indices;
+  int num_triangles = 0;
+  int num_primitives = geom->get_num_primitives();
+  for (int i = 0; i < num_primitives; ++i) {
+    CPT(GeomPrimitive) prim = geom->get_primitive(i);
+    if (prim->get_primitive_type() != GeomPrimitive::PT_polygons) {
+      continue;
+    }
+    if (prim->is_composite()) {
+      prim = prim->decompose();
+    }
+    if (!prim->is_of_type(GeomTriangles::get_class_type())) {
+      continue;
+    }
+
+    int group = (int)prims.size();
+    GeomPrimitivePipelineReader reader(prim, current_thread);
+    int num_vertices = reader.get_num_vertices();
+    for (int vi = 0; vi + 2 < num_vertices; vi += 3) {
+      simplifier.add_triangle(reader.get_vertex(vi),
+                              reader.get_vertex(vi + 1),
+                              reader.get_vertex(vi + 2), group);
+    }
+    num_triangles += prim->get_num_primitives();
+    prims.push_back(prim);
+    prim_indices.push_back(i);
+  }
+
+  if (prims.empty()) {
+    return 0;
+  }
+
+  int target = (int)(num_triangles * triangle_ratio);
+  double error = simplifier.simplify(target, max_error);
+  _simplify_error = max(_simplify_error, error);
+
+  vector_int indices, groups;
+  simplifier.get_triangles(indices, groups);
+  int num_removed = num_triangles - (int)groups.size();
+
+  pvector< PT(GeomPrimitive) > new_prims;
+  new_prims.reserve(prims.size());
+  Primitives::const_iterator pi;
+  for (pi = prims.begin(); pi != prims.end(); ++pi) {
+    PT(GeomPrimitive) new_prim = (*pi)->make_copy();
+    new_prim->clear_vertices();
+    new_prim->set_index_type((*pi)->get_index_type());
+    new_prims.push_back(new_prim);
+  }
+  for (size_t ti = 0; ti < groups.size(); ++ti) {
+    new_prims[groups[ti]]->add_vertices(indices[ti * 3], indices[ti * 3 + 1],
+                                        indices[ti * 3 + 2]);
+  }
+  for (size_t gi = 0; gi < new_prims.size(); ++gi) {
+    geom->set_primitive(prim_indices[gi], new_prims[gi]);
+  }
+
+  if (num_removed != 0) {
+    register_vertices(geom, true);
+  }
+
+  return num_removed;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: GeomTransformer::simplify
+//       Access: Public
+//  Description: Calls simplify() on each of the Geoms of the
+//               indicated GeomNode.  Returns the number of triangles
+//               removed.
+////////////////////////////////////////////////////////////////////
+int GeomTransformer::
+simplify(GeomNode *node, PN_stdfloat triangle_ratio, PN_stdfloat max_error) {
+  int num_removed = 0;
+  int num_geoms = node->get_num_geoms();
+  for (int i = 0; i < num_geoms; ++i) {
+    PT(Geom) geom = node->modify_geom(i);
+    num_removed += simplify(geom, triangle_ratio, max_error);
+  }
+  return num_removed;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: GeomTransformer::finish_simplify
+//       Access: Public
+//  Description: This should be called after a call to simplify(), to
+//               remove the vertices that are no longer used.  Returns
+//               the largest error introduced by simplify(), in model
+//               units.
+////////////////////////////////////////////////////////////////////
+double GeomTransformer::
+finish_simplify() {
+  finish_apply();
+
+  double error = _simplify_error;
+  _simplify_error = 0.0;
+  return error;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: GeomTransformer::premunge_geom
 //       Access: Public
@@ -1677,3 +2033,108 @@ remove_unused_vertices(const GeomVertexData *vdata) {
     geom->set_vertex_data(new_vdata);
   }
 }
+
+////////////////////////////////////////////////////////////////////
+//     Function: GeomTransformer::VertexDataAssoc::reorder_vertices
+//       Access: Public
+//  Description: Renumbers the rows of the indicated GeomVertexData
+//               in the order in which they are first referenced by
+//               the associated Geoms, and reindexes the Geoms
+//               accordingly.  Vertex data with a TransformBlendTable
+//               or SliderTable is left alone, since those tables
+//               refer to ranges of rows.
+////////////////////////////////////////////////////////////////////
+void GeomTransformer::VertexDataAssoc::
+reorder_vertices(const GeomVertexData *vdata) {
+  if (_geoms.empty() ||
+      vdata->get_transform_blend_table() != (TransformBlendTable *)NULL ||
+      vdata->get_slider_table() != (SliderTable *)NULL) {
+    return;
+  }
+
+  PT(Thread) current_thread = Thread::get_current_thread();
+
+  vector_int indices;
+  GeomList::iterator gi;
+  for (gi = _geoms.begin(); gi != _geoms.end(); ++gi) {
+    Geom *geom = (*gi);
+    if (geom->get_vertex_data() != vdata) {
+      continue;
+    }
+
+    int num_primitives = geom->get_num_primitives();
+    for (int i = 0; i < num_primitives; ++i) {
+      CPT(GeomPrimitive) prim = geom->get_primitive(i);
+
+      GeomPrimitivePipelineReader reader(prim, current_thread);
+      int num_vertices = reader.get_num_vertices();
+      for (int vi = 0; vi < num_vertices; ++vi) {
+        indices.push_back(reader.get_vertex(vi));
+      }
+    }
+  }
+
+  int num_vertices = vdata->get_num_rows();
+  vector_int old_to_new;
+  VertexCacheOptimizer::reorder_vertices(indices, num_vertices, old_to_new);
+
+  int index;
+  for (index = 0; index < num_vertices; ++index) {
+    if (old_to_new[index] != index) {
+      break;
+    }
+  }
+  if (index == num_vertices) {
+    // The vertices are already in order.
+    return;
+  }
+
+  // Recopy the actual vertex data, one array at a time.
+  PT(GeomVertexData) new_vdata = new GeomVertexData(*vdata);
+
+  int num_arrays = vdata->get_num_arrays();
+  nassertv(num_arrays == new_vdata->get_num_arrays());
+
+  GeomVertexDataPipelineReader reader(vdata, current_thread);
+  reader.check_array_readers();
+  GeomVertexDataPipelineWriter writer(new_vdata, true, current_thread);
+  writer.check_array_writers();
+
+  for (int a = 0; a < num_arrays; ++a) {
+    const GeomVertexArrayDataHandle *array_reader = reader.get_array_reader(a);
+    GeomVertexArrayDataHandle *array_writer = writer.get_array_writer(a);
+
+    int stride = array_reader->get_array_format()->get_stride();
+    nassertv(stride == array_writer->get_array_format()->get_stride());
+
+    for (index = 0; index < num_vertices; ++index) {
+      array_writer->copy_subdata_from(old_to_new[index] * stride, stride,
+                                      array_reader,
+                                      index * stride, stride);
+    }
+  }
+
+  // Finally, reindex the Geoms.
+  for (gi = _geoms.begin(); gi != _geoms.end(); ++gi) {
+    Geom *geom = (*gi);
+    if (geom->get_vertex_data() != vdata) {
+      continue;
+    }
+
+    int num_primitives = geom->get_num_primitives();
+    for (int i = 0; i < num_primitives; ++i) {
+      PT(GeomPrimitive) prim = geom->modify_primitive(i);
+      prim->make_indexed();
+      PT(GeomVertexArrayData) vertices = prim->modify_vertices();
+      GeomVertexRewriter rewriter(vertices, 0, current_thread);
+
+      while (!rewriter.is_at_end()) {
+        index = rewriter.get_data1i();
+        nassertv(index >= 0 && index < num_vertices);
+        rewriter.set_data1i(old_to_new[index]);
+      }
+    }
+
+    geom->set_vertex_data(new_vdata);
+  }
+}
@@ -20,6 +20,8 @@
 #include "luse.h"
 #include "geom.h"
 #include "geomVertexData.h"
+#include "vertexCacheOptimizer.h"
+#include "meshSimplifier.h"
 
 class GeomNode;
 class RenderState;
@@ -92,6 +94,16 @@ public:
   int collect_vertex_data(GeomNode *node, int collect_bits, bool format_only);
   int finish_collect(bool format_only);
 
+  int optimize_geometry(Geom *geom, int optimize_bits,
+                        const VertexCacheOptimizer &optimizer);
+  int optimize_geometry(GeomNode *node, int optimize_bits,
+                        const VertexCacheOptimizer &optimizer);
+  int finish_optimize(double &acmr_before, double &acmr_after);
+
+  int simplify(Geom *geom, PN_stdfloat triangle_ratio, PN_stdfloat max_error);
+  int simplify(GeomNode *node, PN_stdfloat triangle_ratio, PN_stdfloat max_error);
+  double finish_simplify();
+
   PT(Geom) premunge_geom(const Geom *geom, GeomMunger *munger);
 
 private:
@@ -108,10 +120,23 @@ private:
     bool _might_have_unused;
     GeomList _geoms;
     void remove_unused_vertices(const GeomVertexData *vdata);
+    void reorder_vertices(const GeomVertexData *vdata);
   };
   typedef pmap<CPT(GeomVertexData), VertexDataAssoc> VertexDataAssocMap;
   VertexDataAssocMap _vdata_assoc;
 
+  // The GeomVertexDatas whose rows should be renumbered by
+  // finish_optimize(), along with the running totals used to report
+  // the vertex cache efficiency before and after optimize_geometry().
+  VertexDataAssocMap _reorder_assoc;
+  int _num_optimized_triangles;
+  double _misses_before;
+  double _misses_after;
+
+  // The largest error introduced by simplify() since the last call
+  // to finish_simplify().
+  double _simplify_error;
+
   // Corresponds to a new GeomVertexData created as needed during an
   // apply operation.
   class NewVertexData {
@@ -276,6 +301,8 @@ private:
   static PStatCollector _apply_scale_color_collector;
   static PStatCollector _apply_texture_color_collector;
   static PStatCollector _apply_set_format_collector;
+  static PStatCollector _optimize_collector;
+  static PStatCollector _simplify_collector;
     
 public:
   static void init_type() {
@@ -904,6 +904,7 @@ PUBLISHED:
   int flatten_light();
   int flatten_medium();
   int flatten_strong();
+  int optimize_geometry();
   void apply_texture_colors();
   INLINE int clear_model_nodes();
 
@@ -32,6 +32,8 @@ PStatCollector SceneGraphReducer::_collect_collector("*:Flatten:collect");
 PStatCollector SceneGraphReducer::_make_nonindexed_collector("*:Flatten:make nonindexed");
 PStatCollector SceneGraphReducer::_unify_collector("*:Flatten:unify");
 PStatCollector SceneGraphReducer::_remove_unused_collector("*:Flatten:remove unused vertices");
+PStatCollector SceneGraphReducer::_optimize_collector("*:Flatten:optimize geometry");
+PStatCollector SceneGraphReducer::_simplify_collector("*:Flatten:simplify");
 PStatCollector SceneGraphReducer::_premunge_collector("*:Premunge");
 
 ////////////////////////////////////////////////////////////////////
@@ -235,6 +237,72 @@ remove_unused_vertices(PandaNode *root) {
   Thread::consider_yield();
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: SceneGraphReducer::optimize_geometry
+//       Access: Published
+//  Description: Reorders the triangles and vertices of all of the
+//               Geoms at this level and below to make better use of
+//               the graphics hardware: the triangles are sorted so
+//               that each vertex is reused while it is still in the
+//               post-transform vertex cache, and the vertices are
+//               renumbered so that they are fetched in order.  The
+//               optimize_bits parameter is the union of the bits in
+//               SceneGraphReducer::OptimizeGeometry.
+//
+//               Only independent triangles are reordered; it is best
+//               to call this after unify() (or decompose()), which
+//               converts triangle strips and fans to triangles.
+//
+//               The average cache miss ratio before and after the
+//               operation may be queried afterwards with
+//               get_acmr_before() and get_acmr_after().  Returns the
+//               number of GeomPrimitives reordered.
+////////////////////////////////////////////////////////////////////
+int SceneGraphReducer::
+optimize_geometry(PandaNode *root, int optimize_bits) {
+  nassertr(check_live_flatten(root), 0);
+  PStatTimer timer(_optimize_collector);
+
+  VertexCacheOptimizer optimizer;
+  int num_changed = r_optimize_geometry(root, optimize_bits, optimizer,
+                                        _transformer);
+  _transformer.finish_optimize(_acmr_before, _acmr_after);
+
+  return num_changed;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SceneGraphReducer::simplify
+//       Access: Published
+//  Description: Reduces the number of triangles in all of the Geoms
+//               at this level and below to approximately
+//               triangle_ratio times their original count (for
+//               instance, 0.25 to keep a quarter of the triangles).
+//               If max_error is greater than zero, the
+//               simplification stops early rather than move any part
+//               of the surface by more than about that distance.
+//
+//               The simplification uses the quadric error metric,
+//               and only ever removes vertices, so all of the vertex
+//               attributes remain exact.  UV and normal seams and
+//               joint assignments are preserved.  See
+//               GeomTransformer::simplify().
+//
+//               The error actually introduced may be queried
+//               afterwards with get_simplify_error().  Returns the
+//               number of triangles removed.
+////////////////////////////////////////////////////////////////////
+int SceneGraphReducer::
+simplify(PandaNode *root, PN_stdfloat triangle_ratio, PN_stdfloat max_error) {
+  nassertr(check_live_flatten(root), 0);
+  PStatTimer timer(_simplify_collector);
+
+  int num_removed = r_simplify(root, triangle_ratio, max_error, _transformer);
+  _simplify_error = _transformer.finish_simplify();
+
+  return num_removed;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: SceneGraphReducer::check_live_flatten
 //       Access: Published
@@ -1023,6 +1091,62 @@ r_decompose(PandaNode *node) {
   }
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: SceneGraphReducer::r_optimize_geometry
+//       Access: Private
+//  Description: The recursive implementation of optimize_geometry().
+////////////////////////////////////////////////////////////////////
+int SceneGraphReducer::
+r_optimize_geometry(PandaNode *node, int optimize_bits,
+                    const VertexCacheOptimizer &optimizer,
+                    GeomTransformer &transformer) {
+  int num_changed = 0;
+
+  if (node->is_geom_node()) {
+    GeomNode *geom_node = DCAST(GeomNode, node);
+    num_changed += transformer.optimize_geometry(geom_node, optimize_bits,
+                                                 optimizer);
+  }
+
+  PandaNode::Children children = node->get_children();
+  int num_children = children.get_num_children();
+  for (int i = 0; i < num_children; ++i) {
+    num_changed +=
+      r_optimize_geometry(children.get_child(i), optimize_bits, optimizer,
+                          transformer);
+  }
+
+  Thread::consider_yield();
+  return num_changed;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: SceneGraphReducer::r_simplify
+//       Access: Private
+//  Description: The recursive implementation of simplify().
+////////////////////////////////////////////////////////////////////
+int SceneGraphReducer::
+r_simplify(PandaNode *node, PN_stdfloat triangle_ratio,
+           PN_stdfloat max_error, GeomTransformer &transformer) {
+  int num_removed = 0;
+
+  if (node->is_geom_node()) {
+    GeomNode *geom_node = DCAST(GeomNode, node);
+    num_removed += transformer.simplify(geom_node, triangle_ratio, max_error);
+  }
+
+  PandaNode::Children children = node->get_children();
+  int num_children = children.get_num_children();
+  for (int i = 0; i < num_children; ++i) {
+    num_removed +=
+      r_simplify(children.get_child(i), triangle_ratio, max_error,
+                 transformer);
+  }
+
+  Thread::consider_yield();
+  return num_removed;
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: SceneGraphReducer::r_premunge
 //       Access: Private
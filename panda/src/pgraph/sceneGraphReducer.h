@@ -120,6 +120,26 @@ PUBLISHED:
     MN_avoid_dynamic   = 0x004,
   };
 
+  enum OptimizeGeometry {
+    // If set, the triangles of each GeomTriangles will be reordered
+    // for better use of the post-transform vertex cache.
+    OG_vertex_cache    = 0x001,
+
+    // If set, the rows of each GeomVertexData will be renumbered in
+    // the order in which they are first used, so that vertex fetches
+    // proceed sequentially through memory.
+    OG_vertex_order    = 0x002,
+
+    // If set, clusters of triangles will also be sorted so that the
+    // outward-facing ones are drawn first, to reduce overdraw.  This
+    // costs a little vertex cache efficiency.
+    OG_overdraw        = 0x004,
+
+    // If set, any GeomVertexData or Geom with a usage_hint other than
+    // UH_static will not be modified.
+    OG_avoid_dynamic   = 0x008,
+  };
+
   void set_gsg(GraphicsStateGuardianBase *gsg);
   void clear_gsg();
   INLINE GraphicsStateGuardianBase *get_gsg() const;
@@ -144,6 +164,14 @@ PUBLISHED:
   INLINE int make_nonindexed(PandaNode *root, int nonindexed_bits = ~0);
   void unify(PandaNode *root, bool preserve_order);
   void remove_unused_vertices(PandaNode *root);
+  int optimize_geometry(PandaNode *root,
+                        int optimize_bits = OG_vertex_cache | OG_vertex_order);
+  INLINE double get_acmr_before() const;
+  INLINE double get_acmr_after() const;
+
+  int simplify(PandaNode *root, PN_stdfloat triangle_ratio,
+               PN_stdfloat max_error = 0.0f);
+  INLINE double get_simplify_error() const;
 
   INLINE void premunge(PandaNode *root, const RenderState *initial_state);
   bool check_live_flatten(PandaNode *node);
@@ -184,6 +212,11 @@ protected:
   void r_unify(PandaNode *node, int max_indices, bool preserve_order);
   void r_register_vertices(PandaNode *node, GeomTransformer &transformer);
   void r_decompose(PandaNode *node);
+  int r_optimize_geometry(PandaNode *node, int optimize_bits,
+                          const VertexCacheOptimizer &optimizer,
+                          GeomTransformer &transformer);
+  int r_simplify(PandaNode *node, PN_stdfloat triangle_ratio,
+                 PN_stdfloat max_error, GeomTransformer &transformer);
 
   void r_premunge(PandaNode *node, const RenderState *state);
 
@@ -191,6 +224,9 @@ private:
   PT(GraphicsStateGuardianBase) _gsg;
   PN_stdfloat _combine_radius;
   GeomTransformer _transformer;
+  double _acmr_before;
+  double _acmr_after;
+  double _simplify_error;
 
   static PStatCollector _flatten_collector;
   static PStatCollector _apply_collector;
@@ -200,6 +236,8 @@ private:
   static PStatCollector _make_nonindexed_collector;
   static PStatCollector _unify_collector;
   static PStatCollector _remove_unused_collector;
+  static PStatCollector _optimize_collector;
+  static PStatCollector _simplify_collector;
   static PStatCollector _premunge_collector;
 };
 
@@ -0,0 +1,230 @@
+// Filename: test_optimize.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "config_pgraph.h"
+#include "geomNode.h"
+#include "sceneGraphReducer.h"
+#include "geom.h"
+#include "geomTriangles.h"
+#include "geomVertexData.h"
+#include "geomVertexFormat.h"
+#include "geomVertexReader.h"
+#include "geomVertexWriter.h"
+#include "vertexCacheOptimizer.h"
+#include "randomizer.h"
+#include "trueClock.h"
+#include "pnotify.h"
+
+#include <algorithm>
+
+// This program builds two Geoms that share one large grid of
+// vertices, each with its triangles in random order (as a scanned or
+// decimated mesh would be), and runs
+// SceneGraphReducer::optimize_geometry() on them.  It checks that the
+// same triangles, with the same winding, are drawn before and after,
+// and reports the average cache miss ratio (ACMR) of each.
+
+class Triangle {
+public:
+  bool operator < (const Triangle &other) const {
+    for (int i = 0; i < 3; ++i) {
+      int compare = _v[i].compare_to(other._v[i]);
+      if (compare != 0) {
+        return compare < 0;
+      }
+    }
+    return false;
+  }
+  bool operator == (const Triangle &other) const {
+    return !(*this < other) && !(other < *this);
+  }
+
+  LPoint3 _v[3];
+};
+typedef pvector<Triangle> Triangles;
+
+static PT(GeomNode)
+make_grid(int size) {
+  PT(GeomVertexData) vdata = new GeomVertexData
+    ("grid", GeomVertexFormat::get_v3(), Geom::UH_static);
+  vdata->unclean_set_num_rows((size + 1) * (size + 1));
+  {
+    GeomVertexWriter vertex(vdata, InternalName::get_vertex());
+    for (int y = 0; y <= size; ++y) {
+      for (int x = 0; x <= size; ++x) {
+        vertex.set_data3(x, y, 0.0f);
+      }
+    }
+  }
+
+  vector_int tris;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      int v0 = y * (size + 1) + x;
+      int v1 = v0 + 1;
+      int v2 = v1 + size + 1;
+      int v3 = v0 + size + 1;
+      tris.push_back(v0);
+      tris.push_back(v1);
+      tris.push_back(v2);
+      tris.push_back(v0);
+      tris.push_back(v2);
+      tris.push_back(v3);
+    }
+  }
+
+  // Shuffle the triangles, with a fixed seed so that each run sees
+  // the same input.
+  Randomizer random(1);
+  int num_tris = (int)tris.size() / 3;
+  for (int i = num_tris - 1; i > 0; --i) {
+    int j = random.random_int(i + 1);
+    for (int k = 0; k < 3; ++k) {
+      swap(tris[i * 3 + k], tris[j * 3 + k]);
+    }
+  }
+
+  // Split them between two Geoms, so that the vertex renumbering has
+  // to account for both.
+  PT(GeomNode) node = new GeomNode("grid");
+  int half = num_tris / 2;
+  for (int g = 0; g < 2; ++g) {
+    PT(GeomTriangles) prim = new GeomTriangles(Geom::UH_static);
+    int begin = (g == 0) ? 0 : half;
+    int end = (g == 0) ? half : num_tris;
+    for (int i = begin; i < end; ++i) {
+      prim->add_vertices(tris[i * 3], tris[i * 3 + 1], tris[i * 3 + 2]);
+    }
+    prim->close_primitive();
+
+    PT(Geom) geom = new Geom(vdata);
+    geom->add_primitive(prim);
+    node->add_geom(geom);
+  }
+
+  return node;
+}
+
+// Collects the triangles drawn by the GeomNode, each rotated to
+// begin with its least vertex (so the winding is preserved), and
+// sorted.  Also fills in the index list that reaches the vertex
+// cache, in drawing order.
+static void
+get_triangles(const GeomNode *node, Triangles &triangles,
+              vector_int &indices) {
+  triangles.clear();
+  indices.clear();
+  int num_geoms = node->get_num_geoms();
+  for (int gi = 0; gi < num_geoms; ++gi) {
+    const Geom *geom = node->get_geom(gi);
+    GeomVertexReader vertex(geom->get_vertex_data(), InternalName::get_vertex());
+    int num_primitives = geom->get_num_primitives();
+    for (int pi = 0; pi < num_primitives; ++pi) {
+      CPT(GeomPrimitive) prim = geom->get_primitive(pi)->decompose();
+      int num_vertices = prim->get_num_vertices();
+      for (int vi = 0; vi + 2 < num_vertices; vi += 3) {
+        Triangle tri;
+        for (int k = 0; k < 3; ++k) {
+          int index = prim->get_vertex(vi + k);
+          indices.push_back(index);
+          vertex.set_row(index);
+          tri._v[k] = vertex.get_data3();
+        }
+        int first = 0;
+        for (int k = 1; k < 3; ++k) {
+          if (tri._v[k] < tri._v[first]) {
+            first = k;
+          }
+        }
+        Triangle rotated;
+        for (int k = 0; k < 3; ++k) {
+          rotated._v[k] = tri._v[(first + k) % 3];
+        }
+        triangles.push_back(rotated);
+      }
+    }
+  }
+  sort(triangles.begin(), triangles.end());
+}
+
+int
+main(int argc, char *argv[]) {
+  int size = 300;
+  if (argc >= 2) {
+    size = atoi(argv[1]);
+  }
+  if (argc > 2 || size <= 0) {
+    nout << "test_optimize [grid-size]\n\n"
+         << "Builds a grid-size x grid-size grid of quads, as triangles in\n"
+         << "random order, and checks that optimize_geometry() draws the\n"
+         << "same triangles with a lower average cache miss ratio.\n";
+    exit(1);
+  }
+
+  init_libpgraph();
+  TrueClock *clock = TrueClock::get_global_ptr();
+  VertexCacheOptimizer optimizer;
+  int cache_size = optimizer.get_cache_size();
+
+  static const int num_modes = 2;
+  static const int mode_bits[num_modes] = {
+    SceneGraphReducer::OG_vertex_cache | SceneGraphReducer::OG_vertex_order,
+    SceneGraphReducer::OG_vertex_cache | SceneGraphReducer::OG_vertex_order |
+    SceneGraphReducer::OG_overdraw,
+  };
+  static const char *mode_names[num_modes] = {
+    "vertex cache",
+    "vertex cache + overdraw",
+  };
+
+  bool ok = true;
+  for (int mode = 0; mode < num_modes; ++mode) {
+    PT(GeomNode) node = make_grid(size);
+    Triangles before, after;
+    vector_int indices;
+    get_triangles(node, before, indices);
+    double acmr_before = VertexCacheOptimizer::calc_acmr(indices, cache_size);
+
+    SceneGraphReducer gr;
+    double start = clock->get_short_time();
+    int num_changed = gr.optimize_geometry(node, mode_bits[mode]);
+    double elapsed = clock->get_short_time() - start;
+
+    get_triangles(node, after, indices);
+    double acmr_after = VertexCacheOptimizer::calc_acmr(indices, cache_size);
+
+    nout << mode_names[mode] << ": " << before.size() << " triangles, "
+         << num_changed << " primitives reordered in " << elapsed << " s, "
+         << "ACMR (" << cache_size << ") " << acmr_before << " -> "
+         << acmr_after << "\n";
+
+    if (before.size() != after.size() ||
+        !equal(before.begin(), before.end(), after.begin())) {
+      nout << "  optimize_geometry() changed the triangles drawn.\n";
+      ok = false;
+    }
+    if (acmr_after >= acmr_before) {
+      nout << "  optimize_geometry() did not improve the ACMR.\n";
+      ok = false;
+    }
+    if (!IS_THRESHOLD_EQUAL(gr.get_acmr_before(), acmr_before, 1.0e-6) ||
+        !IS_THRESHOLD_EQUAL(gr.get_acmr_after(), acmr_after, 1.0e-6)) {
+      nout << "  optimize_geometry() reported ACMR " << gr.get_acmr_before()
+           << " -> " << gr.get_acmr_after() << ".\n";
+      ok = false;
+    }
+  }
+
+  return ok ? 0 : 1;
+}
@@ -13,6 +13,7 @@
      config_pnmimage.h \
      pfmFile.I pfmFile.h \
      pfmFile_ext.cxx pfmFile_ext.h \
+     pnmBandProcessor.h pnmBandProcessor.I \
      pnmbitio.h \
      pnmBrush.h pnmBrush.I \
      pnmFileType.h pnmFileTypeRegistry.h pnmImage.I  \
@@ -26,6 +27,7 @@
      config_pnmimage.cxx \
      pfmFile.cxx \
      pnm-image-filter.cxx \
+     pnmBandProcessor.cxx \
      pnmbitio.cxx \
      pnmBrush.cxx \
      pnmFileType.cxx  \
@@ -38,6 +40,7 @@
      config_pnmimage.h \
      pfmFile.I pfmFile.h \
      pfmFile_ext.cxx pfmFile_ext.h \
+     pnmBandProcessor.h pnmBandProcessor.I \
      pnmBrush.h pnmBrush.I \
      pnmFileType.h pnmFileTypeRegistry.h pnmImage.I \
      pnmImage.h pnmImageHeader.I pnmImageHeader.h \
@@ -49,3 +52,22 @@
 
 #end lib_target
 
+#begin test_bin_target
+  #define TARGET test_pnmimage_filter
+  #define LOCAL_LIBS \
+    p3pnmimage
+
+  #define SOURCES \
+    test_pnmimage_filter.cxx
+
+#end test_bin_target
+
+#begin test_bin_target
+  #define TARGET test_pnmimage_storage
+  #define LOCAL_LIBS \
+    p3pnmimage
+
+  #define SOURCES \
+    test_pnmimage_storage.cxx
+
+#end test_bin_target
@@ -59,6 +59,15 @@ ConfigVariableDouble pfm_resize_radius
           "always call box_filter() or gaussian_filter() explicitly with "
           "a specific radius."));
 
+ConfigVariableInt pnmimage_filter_threads
+("pnmimage-filter-threads", 0,
+ PRC_DESC("Specifies the number of threads that PNMImage and PfmFile will "
+          "use to perform box_filter(), gaussian_filter(), and "
+          "quick_filter(), each of which divides the image into bands "
+          "of rows to be filtered independently.  This requires a Panda "
+          "built with true threading support.  Set this to 0 or 1 to do "
+          "all of the filtering on the calling thread."));
+
 ////////////////////////////////////////////////////////////////////
 //     Function: init_libpnmimage
 //  Description: Initializes the library.  This must be called at
@@ -1,6 +1,7 @@
 #include "config_pnmimage.cxx"
 #include "pfmFile.cxx"
 #include "pnm-image-filter.cxx"
+#include "pnmBandProcessor.cxx"
 #include "pnmbitio.cxx"
 #include "pnmBrush.cxx"
 #include "pnmFileType.cxx"
@@ -318,60 +318,11 @@ load(const PNMImage &pnmimage) {
   int num_channels = pnmimage.get_num_channels();
 
   clear(pnmimage.get_x_size(), pnmimage.get_y_size(), num_channels);
-  switch (num_channels) {
-  case 1:
-    {
-      for (int yi = 0; yi < pnmimage.get_y_size(); ++yi) {
-        for (int xi = 0; xi < pnmimage.get_x_size(); ++xi) {
-          _table[yi * _x_size + xi] = pnmimage.get_gray(xi, yi);
-        }
-      }
-    }
-    break;
-
-  case 2:
-    {
-      for (int yi = 0; yi < pnmimage.get_y_size(); ++yi) {
-        for (int xi = 0; xi < pnmimage.get_x_size(); ++xi) {
-          PN_float32 *point = &_table[(yi * _x_size + xi) * _num_channels];
-          point[0] = pnmimage.get_gray(xi, yi);
-          point[1] = pnmimage.get_alpha(xi, yi);
-        }
-      }
-    }
-    break;
-
-  case 3:
-    {
-      for (int yi = 0; yi < pnmimage.get_y_size(); ++yi) {
-        for (int xi = 0; xi < pnmimage.get_x_size(); ++xi) {
-          PN_float32 *point = &_table[(yi * _x_size + xi) * _num_channels];
-          LRGBColord xel = pnmimage.get_xel(xi, yi);
-          point[0] = xel[0];
-          point[1] = xel[1];
-          point[2] = xel[2];
-        }
-      }
-    }
-    break;
-
-  case 4:
-    {
-      for (int yi = 0; yi < pnmimage.get_y_size(); ++yi) {
-        for (int xi = 0; xi < pnmimage.get_x_size(); ++xi) {
-          PN_float32 *point = &_table[(yi * _x_size + xi) * _num_channels];
-          LRGBColord xel = pnmimage.get_xel(xi, yi);
-          point[0] = xel[0];
-          point[1] = xel[1];
-          point[2] = xel[2];
-          point[3] = pnmimage.get_alpha(xi, yi);
-        }
-      }
+  if (_x_size > 0) {
+    // The PNMImage rows are laid out just like ours.
+    for (int yi = 0; yi < _y_size; ++yi) {
+      pnmimage.get_float_row(yi, &_table[yi * _x_size * _num_channels]);
     }
-    break;
-
-  default:
-    nassertr(false, false);
   }
   return true;
 }
@@ -381,7 +332,9 @@ load(const PNMImage &pnmimage) {
 //     Function: PfmFile::store
 //       Access: Published
 //  Description: Copies the data to the indicated PNMImage, converting
-//               to RGB values.
+//               to RGB values.  If the PNMImage has a floating-point
+//               storage type, it keeps it, and the values are stored
+//               without clamping.
 ////////////////////////////////////////////////////////////////////
 bool PfmFile::
 store(PNMImage &pnmimage) const {
@@ -392,54 +345,10 @@ store(PNMImage &pnmimage) const {
 
   int num_channels = get_num_channels();
   pnmimage.clear(get_x_size(), get_y_size(), num_channels, PGM_MAXMAXVAL);
-  switch (num_channels) {
-  case 1:
-    {
-      for (int yi = 0; yi < get_y_size(); ++yi) {
-        for (int xi = 0; xi < get_x_size(); ++xi) {
-          pnmimage.set_gray(xi, yi, _table[yi * _x_size + xi]);
-        }
-      }
-    }
-    break;
-
-  case 2:
-    {
-      for (int yi = 0; yi < get_y_size(); ++yi) {
-        for (int xi = 0; xi < get_x_size(); ++xi) {
-          const LPoint2f &point = get_point2(xi, yi);
-          pnmimage.set_gray(xi, yi, point[0]);
-          pnmimage.set_alpha(xi, yi, point[1]);
-        }
-      }
-    }
-    break;
-
-  case 3:
-    {
-      for (int yi = 0; yi < get_y_size(); ++yi) {
-        for (int xi = 0; xi < get_x_size(); ++xi) {
-          const LPoint3f &point = get_point3(xi, yi);
-          pnmimage.set_xel(xi, yi, point[0], point[1], point[2]);
-        }
-      }
-    }
-    break;
-
-  case 4:
-    {
-      for (int yi = 0; yi < get_y_size(); ++yi) {
-        for (int xi = 0; xi < get_x_size(); ++xi) {
-          const LPoint4f &point = get_point4(xi, yi);
-          pnmimage.set_xel(xi, yi, point[0], point[1], point[2]);
-          pnmimage.set_alpha(xi, yi, point[3]);
-        }
-      }
+  if (_x_size > 0) {
+    for (int yi = 0; yi < _y_size; ++yi) {
+      pnmimage.set_float_row(yi, &_table[yi * _x_size * _num_channels]);
     }
-    break;
-
-  default:
-    nassertr(false, false);
   }
   return true;
 }
@@ -27,10 +27,19 @@
 // The image is filtered first along one axis, then along the other.  This
 // decreases the complexity of the convolution operation: it is faster to
 // convolve twice with a one-dimensional kernel than once with a two-
-// dimensional kernel.  In the interim, a temporary matrix of type StoreType
-// (a numeric type, described below) is built which contains the results
-// from the first convolution.  The entire process is then repeated for
-// each channel in the image.
+// dimensional kernel.  The weights of each one-dimensional kernel depend
+// only on the sizes of the images, so they are computed just once per axis,
+// into a FilterKernel.
+
+// All of the channels of a pixel are filtered together, stored side by side
+// in rows of StoreType (a numeric type, described below), so that the same
+// weight is applied to each channel in a tight inner loop.  The destination
+// image is divided into horizontal bands, each of which is filtered
+// independently of the others; if pnmimage-filter-threads is greater than
+// 1, the bands are shared out among that many threads.
+// PNMBandProcessor instead filters an image from top to bottom on one
+// thread, keeping only the source rows the kernel currently spans, so that
+// neither image need be held in memory at once.
 
 #include "pandabase.h"
 #include <math.h>
@@ -38,6 +47,13 @@
 
 #include "pnmImage.h"
 #include "pfmFile.h"
+#include "pnmBandProcessor.h"
+#include "config_pnmimage.h"
+#include "pvector.h"
+#include "pmutex.h"
+#include "mutexHolder.h"
+#include "thread.h"
+#include "genericThread.h"
 
 // WorkType is an abstraction that allows the filtering process to be
 // recompiled to use either floating-point or integer arithmetic.  On SGI
@@ -95,80 +111,18 @@ static const WorkType filter_max = 255;
 
 
 
-// filter_row() filters a single row by convolving with a one-dimensional
-// kernel filter.  The kernel is defined by an array of weights in filter[],
-// where the ith element of filter corresponds to abs(d * scale), if scale>1.0,
-// and abs(d), if scale<=1.0, where d is the offset from the center and varies
+// filter_sparse_row() filters a single row by convolving with a
+// one-dimensional kernel filter, while also accepting an array of weight
+// values per element, to support scaling a sparse array (as in a PfmFile).
+// The kernel is defined by an array of weights in filter[], where the ith
+// element of filter corresponds to abs(d * scale), if scale>1.0, and
+// abs(d), if scale<=1.0, where d is the offset from the center and varies
 // from -filter_width to filter_width.
 
 // Note that filter_width is not necessarily the length of the array; it is
 // the radius of interest of the filter function.  The array may need to be
 // larger (by a factor of scale), to adequately cover all the values.
 
-static void
-filter_row(StoreType dest[], int dest_len,
-           const StoreType source[], int source_len,
-           double scale,                    //  == dest_len / source_len
-           const WorkType filter[],
-           double filter_width) {
-  // If we are expanding the row (scale > 1.0), we need to look at a
-  // fractional granularity.  Hence, we scale our filter index by
-  // scale.  If we are compressing (scale < 1.0), we don't need to
-  // fiddle with the filter index, so we leave it at one.
-
-  double iscale;
-  if (scale < 1.0) {
-    iscale = 1.0;
-    filter_width /= scale;
-  } else {
-    iscale = scale;
-  }
-
-  for (int dest_x = 0; dest_x < dest_len; dest_x++) {
-    // The additional offset of 0.5 keeps the pixel centered.
-    double center = (dest_x + 0.5) / scale - 0.5;
-
-    // left and right are the starting and ending ranges of the radius of
-    // interest of the filter function.  We need to apply the filter to each
-    // value in this range.
-    int left = max((int)cfloor(center - filter_width), 0);
-    int right = min((int)cceil(center + filter_width), source_len - 1);
-
-    // right_center is the point just to the right of the center.  This
-    // allows us to flip the sign of the offset when we cross the center point.
-    int right_center = (int)cceil(center);
-
-    WorkType net_weight = 0;
-    WorkType net_value = 0;
-
-    int index, source_x;
-
-    // This loop is broken into two pieces--the left of center and the right
-    // of center--so we don't have to incur the overhead of calling fabs()
-    // each time through the loop.
-    for (source_x = left; source_x < right_center; source_x++) {
-      index = (int)(iscale * (center - source_x) + 0.5);
-      net_value += filter[index] * source[source_x];
-      net_weight += filter[index];
-    }
-
-    for (; source_x <= right; source_x++) {
-      index = (int)(iscale * (source_x - center) + 0.5);
-      net_value += filter[index] * source[source_x];
-      net_weight += filter[index];
-    }
-
-    if (net_weight > 0) {
-      dest[dest_x] = (StoreType)(net_value / net_weight);
-    } else {
-      dest[dest_x] = 0;
-    }
-  }
-  Thread::consider_yield();
-}
-
-// As above, but we also accept an array of weight values per
-// element, to support scaling a sparse array (as in a PfmFile).
 static void
 filter_sparse_row(StoreType dest[], StoreType dest_weight[], int dest_len,
                   const StoreType source[], const StoreType source_weight[], int source_len,
@@ -291,7 +245,11 @@ gaussian_filter_impl(double scale, double width,
 
   double sigma = width/2;
   filter_width = 3.0 * sigma;
-  int actual_width = (int)cceil((filter_width + 1) * fscale);
+
+  // As in box_filter_impl(), we need one more element than this, since
+  // the offset of a source value from the center rounds up to the
+  // next index.
+  int actual_width = (int)cceil((filter_width + 1) * fscale) + 1;
 
   // G(x, y) = (1/(2 pi sigma^2)) * exp( - (x^2 + y^2) / (2 sigma^2))
 
@@ -312,216 +270,653 @@ gaussian_filter_impl(double scale, double width,
 }
 
 
-// We have a function, defined in pnm-image-filter-core.cxx, that will scale
-// an image in both X and Y directions for a particular channel, by setting
-// up the temporary matrix appropriately and calling the above functions.
 
-// What we really need is a series of such functions, one for each channel,
-// and also one to scale by X first, and one to scale by Y first.  This sounds
-// a lot like a C++ template: we want to compile the same function several
-// times to work on slightly different sorts of things each time.  However,
-// the things we want to vary are the particular member functions of PNMImage
-// that we call (e.g. Red(), Green(), etc.), and we can't declare a template
-// of member functions, only of types.
+////////////////////////////////////////////////////////////////////
+//       Class : FilterKernel
+// Description : The result of applying a filter function along one
+//               axis of the image, for a particular pair of source
+//               and destination sizes: for each destination index,
+//               the first source index that contributes to it, and
+//               the weight of each contributing source value.  This
+//               is the same for every row (or column) of the image,
+//               so it is computed just once.
+////////////////////////////////////////////////////////////////////
+class FilterKernel {
+public:
+  void make(int dest_len, int source_len, double width,
+            FilterFunction *make_filter);
 
-// It's doable using templates.  It would involve the declaration of
-// lots of silly little functor objects.  This is much more compact
-// and no more difficult to read.
+  INLINE int get_num_weights(int dest_x) const {
+    return _start[dest_x + 1] - _start[dest_x];
+  }
+  INLINE const WorkType *get_weights(int dest_x) const {
+    return &_weights[0] + _start[dest_x];
+  }
 
-// The function in pnm-image-filter-core.cxx uses macros to access the member
-// functions of PNMImage.  Hence, we only need to redefine those macros
-// with each instance of the function to cause each instance to operate on
-// the correct member.
+  pvector<int> _left;
+  pvector<int> _start;
+  pvector<WorkType> _weights;
+  pvector<WorkType> _net_weight;
+};
 
+////////////////////////////////////////////////////////////////////
+//     Function: FilterKernel::make
+//       Access: Public
+//  Description: Builds the kernel to filter a row of source_len
+//               values into a row of dest_len values.
+////////////////////////////////////////////////////////////////////
+void FilterKernel::
+make(int dest_len, int source_len, double width,
+     FilterFunction *make_filter) {
+  double scale = (double)dest_len / (double)source_len;
 
-// These instances scale by X first, then by Y.
+  WorkType *filter;
+  double filter_width;
+  make_filter(scale, width, filter, filter_width);
 
-#define FUNCTION_NAME filter_red_xy
-#define IMAGETYPE PNMImage
-#define ASIZE get_x_size
-#define BSIZE get_y_size
-#define GETVAL(a, b, channel) get_red(a, b)
-#define SETVAL(a, b, channel, v) set_red(a, b, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+  // If we are expanding the row (scale > 1.0), we need to look at a
+  // fractional granularity.  Hence, we scale our filter index by
+  // scale.  If we are compressing (scale < 1.0), we don't need to
+  // fiddle with the filter index, so we leave it at one.
 
-#define FUNCTION_NAME filter_green_xy
-#define IMAGETYPE PNMImage
-#define ASIZE get_x_size
-#define BSIZE get_y_size
-#define GETVAL(a, b, channel) get_green(a, b)
-#define SETVAL(a, b, channel, v) set_green(a, b, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+  double iscale;
+  if (scale < 1.0) {
+    iscale = 1.0;
+    filter_width /= scale;
+  } else {
+    iscale = scale;
+  }
 
-#define FUNCTION_NAME filter_blue_xy
-#define IMAGETYPE PNMImage
-#define ASIZE get_x_size
-#define BSIZE get_y_size
-#define GETVAL(a, b, channel) get_blue(a, b)
-#define SETVAL(a, b, channel, v) set_blue(a, b, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+  _left.clear();
+  _start.clear();
+  _weights.clear();
+  _net_weight.clear();
+  _left.reserve(dest_len);
+  _start.reserve(dest_len + 1);
+  _net_weight.reserve(dest_len);
 
-#define FUNCTION_NAME filter_gray_xy
-#define IMAGETYPE PNMImage
-#define ASIZE get_x_size
-#define BSIZE get_y_size
-#define GETVAL(a, b, channel) get_bright(a, b)
-#define SETVAL(a, b, channel, v) set_xel(a, b, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+  for (int dest_x = 0; dest_x < dest_len; dest_x++) {
+    // The additional offset of 0.5 keeps the pixel centered.
+    double center = (dest_x + 0.5) / scale - 0.5;
 
-#define FUNCTION_NAME filter_alpha_xy
-#define IMAGETYPE PNMImage
-#define ASIZE get_x_size
-#define BSIZE get_y_size
-#define GETVAL(a, b, channel) get_alpha(a, b)
-#define SETVAL(a, b, channel, v) set_alpha(a, b, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+    // left and right are the starting and ending ranges of the radius of
+    // interest of the filter function.  We need to apply the filter to each
+    // value in this range.
+    int left = max((int)cfloor(center - filter_width), 0);
+    int right = min((int)cceil(center + filter_width), source_len - 1);
 
+    // right_center is the point just to the right of the center.  This
+    // allows us to flip the sign of the offset when we cross the center point.
+    int right_center = (int)cceil(center);
 
-// These instances scale by Y first, then by X.
+    _left.push_back(left);
+    _start.push_back((int)_weights.size());
 
-#define FUNCTION_NAME filter_red_yx
-#define IMAGETYPE PNMImage
-#define ASIZE get_y_size
-#define BSIZE get_x_size
-#define GETVAL(a, b, channel) get_red(b, a)
-#define SETVAL(a, b, channel, v) set_red(b, a, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+    // The weights are recorded, and summed, in order from left to
+    // right; the rows are later filtered in the same order, so the
+    // results don't depend on how the image was divided up.
+    WorkType net_weight = 0;
 
-#define FUNCTION_NAME filter_green_yx
-#define IMAGETYPE PNMImage
-#define ASIZE get_y_size
-#define BSIZE get_x_size
-#define GETVAL(a, b, channel) get_green(b, a)
-#define SETVAL(a, b, channel, v) set_green(b, a, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+    int index, source_x;
+    for (source_x = left; source_x < right_center; source_x++) {
+      index = (int)(iscale * (center - source_x) + 0.5);
+      _weights.push_back(filter[index]);
+      net_weight += filter[index];
+    }
 
-#define FUNCTION_NAME filter_blue_yx
-#define IMAGETYPE PNMImage
-#define ASIZE get_y_size
-#define BSIZE get_x_size
-#define GETVAL(a, b, channel) get_blue(b, a)
-#define SETVAL(a, b, channel, v) set_blue(b, a, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+    for (; source_x <= right; source_x++) {
+      index = (int)(iscale * (source_x - center) + 0.5);
+      _weights.push_back(filter[index]);
+      net_weight += filter[index];
+    }
 
-#define FUNCTION_NAME filter_gray_yx
-#define IMAGETYPE PNMImage
-#define ASIZE get_y_size
-#define BSIZE get_x_size
-#define GETVAL(a, b, channel) get_bright(b, a)
-#define SETVAL(a, b, channel, v) set_xel(b, a, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+    _net_weight.push_back(net_weight);
+  }
+  _start.push_back((int)_weights.size());
 
-#define FUNCTION_NAME filter_alpha_yx
-#define IMAGETYPE PNMImage
-#define ASIZE get_y_size
-#define BSIZE get_x_size
-#define GETVAL(a, b, channel) get_alpha(b, a)
-#define SETVAL(a, b, channel, v) set_alpha(b, a, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+  // Make sure get_weights() is always valid, even for an empty kernel.
+  _weights.push_back(0);
 
+  PANDA_FREE_ARRAY(filter);
+}
 
-// filter_image pulls everything together, and filters one image into
-// another.  Both images can be the same with no ill effects.
+// filter_line() filters a single row of interleaved pixels, of
+// num_channels values each, along its length.  All of the channels of
+// each pixel are accumulated together, which gives the compiler a
+// fixed-size inner loop it can unroll.
+
+template<int num_channels>
 static void
-filter_image(PNMImage &dest, const PNMImage &source,
+filter_line(StoreType dest[], const StoreType source[],
+            const FilterKernel &kernel) {
+  int dest_len = (int)kernel._left.size();
+  for (int dest_x = 0; dest_x < dest_len; dest_x++) {
+    const WorkType *weight = kernel.get_weights(dest_x);
+    const WorkType *weight_end = weight + kernel.get_num_weights(dest_x);
+    const StoreType *value = source + kernel._left[dest_x] * num_channels;
+
+    WorkType net_value[num_channels];
+    int c;
+    for (c = 0; c < num_channels; ++c) {
+      net_value[c] = 0;
+    }
+    for (; weight < weight_end; ++weight) {
+      for (c = 0; c < num_channels; ++c) {
+        net_value[c] += (*weight) * value[c];
+      }
+      value += num_channels;
+    }
+
+    WorkType net_weight = kernel._net_weight[dest_x];
+    StoreType *result = dest + dest_x * num_channels;
+    for (c = 0; c < num_channels; ++c) {
+      if (net_weight > 0) {
+        result[c] = (StoreType)(net_value[c] / net_weight);
+      } else {
+        result[c] = 0;
+      }
+    }
+  }
+}
+
+static void
+filter_line(StoreType dest[], const StoreType source[],
+            const FilterKernel &kernel, int num_channels) {
+  switch (num_channels) {
+  case 1:
+    filter_line<1>(dest, source, kernel);
+    break;
+
+  case 2:
+    filter_line<2>(dest, source, kernel);
+    break;
+
+  case 3:
+    filter_line<3>(dest, source, kernel);
+    break;
+
+  case 4:
+    filter_line<4>(dest, source, kernel);
+    break;
+
+  default:
+    nassertv(false);
+  }
+}
+
+// filter_across() filters along the other axis: it computes one row of
+// the result as the weighted sum of the corresponding elements of
+// several rows.  Accumulating a whole row at a time keeps the inner
+// loop contiguous in memory.
+
+static void
+filter_across(StoreType dest[], int length, StoreType *const lines[],
+              const WorkType weights[], int num_weights,
+              WorkType net_weight) {
+  int i;
+  if (!(net_weight > 0)) {
+    for (i = 0; i < length; ++i) {
+      dest[i] = 0;
+    }
+    return;
+  }
+
+  for (i = 0; i < length; ++i) {
+    dest[i] = 0;
+  }
+  for (int k = 0; k < num_weights; ++k) {
+    WorkType weight = weights[k];
+    const StoreType *line = lines[k];
+    for (i = 0; i < length; ++i) {
+      dest[i] += weight * line[i];
+    }
+  }
+  for (i = 0; i < length; ++i) {
+    dest[i] = (StoreType)(dest[i] / net_weight);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//       Class : BandJob
+// Description : The destination image is divided into horizontal
+//               bands of rows, which are handed out one at a time
+//               to the threads working on the image.  Each kind of
+//               filter operation defines do_band().
+////////////////////////////////////////////////////////////////////
+class BandJob {
+public:
+  virtual ~BandJob() {}
+  virtual void do_band(int y_begin, int y_end)=0;
+
+  void run(int y_begin, int y_end, int band_rows);
+
+private:
+  static void thread_main(void *user_data);
+
+  int _y_end;
+  int _band_rows;
+  int _next_y;
+  Mutex _lock;
+};
+
+////////////////////////////////////////////////////////////////////
+//     Function: BandJob::run
+//       Access: Public
+//  Description: Calls do_band() on each band of band_rows rows in
+//               the range [y_begin, y_end), using up to
+//               pnmimage-filter-threads threads, and returns when all
+//               of them are done.
+////////////////////////////////////////////////////////////////////
+void BandJob::
+run(int y_begin, int y_end, int band_rows) {
+  _y_end = y_end;
+  _band_rows = max(band_rows, 1);
+  _next_y = y_begin;
+
+  int num_bands = (y_end - y_begin + _band_rows - 1) / _band_rows;
+  int num_threads = min((int)pnmimage_filter_threads, num_bands);
+  pvector< PT(Thread) > threads;
+  if (num_threads > 1 && Thread::is_threading_supported()) {
+    threads.reserve(num_threads - 1);
+    for (int i = 1; i < num_threads; ++i) {
+      PT(Thread) thread =
+        new GenericThread("pnm-filter", "pnm-filter", &thread_main, this);
+      if (thread->start(TP_normal, true)) {
+        threads.push_back(thread);
+      }
+    }
+  }
+
+  // This thread takes its share of the work too.
+  thread_main(this);
+
+  pvector< PT(Thread) >::iterator ti;
+  for (ti = threads.begin(); ti != threads.end(); ++ti) {
+    (*ti)->join();
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BandJob::thread_main
+//       Access: Private, Static
+//  Description: The body of each thread started by run().  Takes
+//               bands from the job one at a time until they are all
+//               done.
+////////////////////////////////////////////////////////////////////
+void BandJob::
+thread_main(void *user_data) {
+  BandJob *job = (BandJob *)user_data;
+
+  while (true) {
+    int y_begin;
+    {
+      MutexHolder holder(job->_lock);
+      if (job->_next_y >= job->_y_end) {
+        return;
+      }
+      y_begin = job->_next_y;
+      job->_next_y = min(y_begin + job->_band_rows, job->_y_end);
+    }
+
+    job->do_band(y_begin, min(y_begin + job->_band_rows, job->_y_end));
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//       Class : FilterJob
+// Description : Filters the source image into the destination image
+//               with a separable kernel, a band at a time.  The
+//               subclasses read rows of the source image into, and
+//               write rows of the destination image from, arrays of
+//               num_channels interleaved values per pixel.
+////////////////////////////////////////////////////////////////////
+class FilterJob : public BandJob {
+public:
+  void filter(int source_x_size, int source_y_size,
+              int dest_x_size, int dest_y_size, int num_channels,
+              double width, FilterFunction *make_filter);
+  void filter_in_order(int source_x_size, int source_y_size,
+                       int dest_x_size, int dest_y_size, int num_channels,
+                       double width, FilterFunction *make_filter);
+
+  virtual void get_source_row(int y, StoreType row[]) const=0;
+  virtual void set_dest_row(int y, const StoreType row[])=0;
+  virtual bool is_aborted() const { return false; }
+
+  virtual void do_band(int y_begin, int y_end);
+
+protected:
+  int _num_channels;
+
+private:
+  void make_kernels(int source_x_size, int source_y_size,
+                    int dest_x_size, int dest_y_size, int num_channels,
+                    double width, FilterFunction *make_filter);
+
+  int _source_x_size;
+  int _dest_x_size;
+  bool _x_first;
+  FilterKernel _x_kernel;
+  FilterKernel _y_kernel;
+};
+
+////////////////////////////////////////////////////////////////////
+//     Function: FilterJob::filter
+//       Access: Public
+//  Description: Filters the entire image.
+////////////////////////////////////////////////////////////////////
+void FilterJob::
+filter(int source_x_size, int source_y_size,
+       int dest_x_size, int dest_y_size, int num_channels,
+       double width, FilterFunction *make_filter) {
+  make_kernels(source_x_size, source_y_size, dest_x_size, dest_y_size,
+               num_channels, width, make_filter);
+
+  // Neighboring bands share some of their source rows, which (when
+  // we filter horizontally first) are filtered again for each band.
+  // We make the bands tall enough, relative to the height of the
+  // kernel, that this is only a small fraction of the work.
+  int max_weights = 1;
+  for (int y = 0; y < dest_y_size; ++y) {
+    max_weights = max(max_weights, _y_kernel.get_num_weights(y));
+  }
+  double scale = (double)dest_y_size / (double)source_y_size;
+  int band_rows = max(32, (int)(8 * max_weights * scale));
+
+  run(0, dest_y_size, band_rows);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: FilterJob::filter_in_order
+//       Access: Public
+//  Description: Filters the entire image on the current thread,
+//               producing the destination rows in order from the
+//               top, and asking for each source row just once, also
+//               in order.  Only as many source rows as the vertical
+//               kernel spans are kept in memory at a time, so the
+//               source and destination need not be held in memory at
+//               all.  The result is identical to that of filter().
+////////////////////////////////////////////////////////////////////
+void FilterJob::
+filter_in_order(int source_x_size, int source_y_size,
+                int dest_x_size, int dest_y_size, int num_channels,
+                double width, FilterFunction *make_filter) {
+  make_kernels(source_x_size, source_y_size, dest_x_size, dest_y_size,
+               num_channels, width, make_filter);
+
+  // The span of source rows for each destination row only moves
+  // forward, so we can keep the rows we have read in a ring, large
+  // enough to hold the rows that are still needed at any one time.
+  int window_rows = 1;
+  int source_end = 0;
+  int y;
+  for (y = 0; y < dest_y_size; ++y) {
+    source_end = max(source_end, _y_kernel._left[y] + _y_kernel.get_num_weights(y));
+    window_rows = max(window_rows, source_end - _y_kernel._left[y]);
+  }
+
+  int dest_length = _dest_x_size * _num_channels;
+  int source_length = _source_x_size * _num_channels;
+  int line_length = _x_first ? dest_length : source_length;
+
+  // As in do_band(), the extra line at the end of the buffer holds
+  // the intermediate result when we filter vertically first.
+  pvector<StoreType> buffer((size_t)(window_rows + 1) * line_length);
+  StoreType *across = &buffer[0] + (size_t)window_rows * line_length;
+  pvector<StoreType *> lines(window_rows);
+  pvector<StoreType> source_row(source_length);
+  pvector<StoreType> dest_row(dest_length);
+
+  int next_source = 0;
+  for (y = 0; y < dest_y_size && !is_aborted(); ++y) {
+    int left = _y_kernel._left[y];
+    int num_weights = _y_kernel.get_num_weights(y);
+
+    // Read in the source rows we don't have yet.  Any that no
+    // destination row uses must still be read, but needn't be
+    // filtered.
+    for (; next_source < left + num_weights; ++next_source) {
+      StoreType *line = &buffer[0] + (size_t)(next_source % window_rows) * line_length;
+      if (!_x_first) {
+        get_source_row(next_source, line);
+      } else if (next_source < left) {
+        get_source_row(next_source, &source_row[0]);
+      } else {
+        get_source_row(next_source, &source_row[0]);
+        filter_line(line, &source_row[0], _x_kernel, _num_channels);
+      }
+    }
+
+    for (int i = 0; i < num_weights; ++i) {
+      lines[i] = &buffer[0] + (size_t)((left + i) % window_rows) * line_length;
+    }
+
+    if (_x_first) {
+      filter_across(&dest_row[0], dest_length, &lines[0],
+                    _y_kernel.get_weights(y), num_weights,
+                    _y_kernel._net_weight[y]);
+    } else {
+      filter_across(across, source_length, &lines[0],
+                    _y_kernel.get_weights(y), num_weights,
+                    _y_kernel._net_weight[y]);
+      filter_line(&dest_row[0], across, _x_kernel, _num_channels);
+    }
+    set_dest_row(y, &dest_row[0]);
+    Thread::consider_yield();
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: FilterJob::make_kernels
+//       Access: Private
+//  Description: Computes the kernels for filter() and
+//               filter_in_order().
+////////////////////////////////////////////////////////////////////
+void FilterJob::
+make_kernels(int source_x_size, int source_y_size,
+             int dest_x_size, int dest_y_size, int num_channels,
              double width, FilterFunction *make_filter) {
+  _source_x_size = source_x_size;
+  _dest_x_size = dest_x_size;
+  _num_channels = num_channels;
 
   // We want to scale by the smallest destination axis first, for a
   // slight performance gain.
+  _x_first = (dest_x_size <= dest_y_size);
 
-  // In the PNMImage case (unlike the PfmFile case), the channel
-  // parameter is not used.  We *could* use it to avoid the
-  // replication of quite so many functions, but we replicate them
-  // anyway, for another tiny performance gain.
+  _x_kernel.make(dest_x_size, source_x_size, width, make_filter);
+  _y_kernel.make(dest_y_size, source_y_size, width, make_filter);
+}
 
-  if (dest.get_x_size() <= dest.get_y_size()) {
-    if (dest.is_grayscale() || source.is_grayscale()) {
-      filter_gray_xy(dest, source, width, make_filter, 0);
+////////////////////////////////////////////////////////////////////
+//     Function: FilterJob::do_band
+//       Access: Public, Virtual
+//  Description: Filters the rows [y_begin, y_end) of the destination
+//               image.
+////////////////////////////////////////////////////////////////////
+void FilterJob::
+do_band(int y_begin, int y_end) {
+  // First, determine the range of source rows that contribute to
+  // this band, and read them in, filtering them horizontally now if
+  // we are to do that first.
+  int source_begin = _y_kernel._left[y_begin];
+  int source_end = source_begin;
+  int y;
+  for (y = y_begin; y < y_end; ++y) {
+    source_end = max(source_end, _y_kernel._left[y] + _y_kernel.get_num_weights(y));
+  }
+  int num_source_rows = source_end - source_begin;
+
+  int dest_length = _dest_x_size * _num_channels;
+  int source_length = _source_x_size * _num_channels;
+  int line_length = _x_first ? dest_length : source_length;
+
+  pvector<StoreType> buffer((size_t)(num_source_rows + 1) * line_length);
+  pvector<StoreType *> lines(num_source_rows + 1);
+  for (int i = 0; i <= num_source_rows; ++i) {
+    lines[i] = &buffer[0] + (size_t)i * line_length;
+  }
+
+  if (_x_first) {
+    pvector<StoreType> source_row(source_length);
+    for (int i = 0; i < num_source_rows; ++i) {
+      get_source_row(source_begin + i, &source_row[0]);
+      filter_line(lines[i], &source_row[0], _x_kernel, _num_channels);
+    }
+  } else {
+    for (int i = 0; i < num_source_rows; ++i) {
+      get_source_row(source_begin + i, lines[i]);
+    }
+  }
+
+  // Now produce each destination row from the rows we have read.  The
+  // extra line at the end of the buffer holds the intermediate result
+  // when we filter vertically first.
+  pvector<StoreType> dest_row(dest_length);
+  StoreType *across = lines[num_source_rows];
+  for (y = y_begin; y < y_end; ++y) {
+    StoreType *const *first_line = &lines[0] + (_y_kernel._left[y] - source_begin);
+    if (_x_first) {
+      filter_across(&dest_row[0], dest_length, first_line,
+                    _y_kernel.get_weights(y), _y_kernel.get_num_weights(y),
+                    _y_kernel._net_weight[y]);
     } else {
-      filter_red_xy(dest, source, width, make_filter, 0);
-      filter_green_xy(dest, source, width, make_filter, 0);
-      filter_blue_xy(dest, source, width, make_filter, 0);
+      filter_across(across, source_length, first_line,
+                    _y_kernel.get_weights(y), _y_kernel.get_num_weights(y),
+                    _y_kernel._net_weight[y]);
+      filter_line(&dest_row[0], across, _x_kernel, _num_channels);
     }
+    set_dest_row(y, &dest_row[0]);
+    Thread::consider_yield();
+  }
+}
 
-    if (dest.has_alpha() && source.has_alpha()) {
-      filter_alpha_xy(dest, source, width, make_filter, 0);
+////////////////////////////////////////////////////////////////////
+//       Class : PNMImageFilterJob
+// Description : Filters the color channels of a PNMImage, or just its
+//               brightness if either image is grayscale, along with
+//               its alpha channel if both images have one.
+////////////////////////////////////////////////////////////////////
+class PNMImageFilterJob : public FilterJob {
+public:
+  PNMImageFilterJob(PNMImage &dest, const PNMImage &source);
+
+  virtual void get_source_row(int y, StoreType row[]) const;
+  virtual void set_dest_row(int y, const StoreType row[]);
+
+  PNMImage &_dest;
+  const PNMImage &_source;
+  bool _gray;
+  bool _alpha;
+};
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImageFilterJob::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+PNMImageFilterJob::
+PNMImageFilterJob(PNMImage &dest, const PNMImage &source) :
+  _dest(dest),
+  _source(source)
+{
+  _gray = (dest.is_grayscale() || source.is_grayscale());
+  _alpha = (dest.has_alpha() && source.has_alpha());
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImageFilterJob::get_source_row
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+void PNMImageFilterJob::
+get_source_row(int y, StoreType row[]) const {
+  int x_size = _source.get_x_size();
+  if (_source.get_storage_type() != PNMImage::ST_integer &&
+      _source.get_num_channels() == _num_channels && x_size > 0) {
+    // The source image already stores just the values we want, in
+    // the same order, so we can read them a row at a time.
+    pvector<PN_float32> values(x_size * _num_channels);
+    _source.get_float_row(y, &values[0]);
+    for (size_t i = 0; i < values.size(); ++i) {
+      row[i] = (StoreType)(source_max * values[i]);
     }
+    return;
+  }
 
-  } else {
-    if (dest.is_grayscale() || source.is_grayscale()) {
-      filter_gray_yx(dest, source, width, make_filter, 0);
+  for (int x = 0; x < x_size; ++x) {
+    if (_gray) {
+      *row++ = (StoreType)(source_max * _source.get_bright(x, y));
     } else {
-      filter_red_yx(dest, source, width, make_filter, 0);
-      filter_green_yx(dest, source, width, make_filter, 0);
-      filter_blue_yx(dest, source, width, make_filter, 0);
+      *row++ = (StoreType)(source_max * _source.get_red(x, y));
+      *row++ = (StoreType)(source_max * _source.get_green(x, y));
+      *row++ = (StoreType)(source_max * _source.get_blue(x, y));
     }
+    if (_alpha) {
+      *row++ = (StoreType)(source_max * _source.get_alpha(x, y));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImageFilterJob::set_dest_row
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+void PNMImageFilterJob::
+set_dest_row(int y, const StoreType row[]) {
+  int x_size = _dest.get_x_size();
+  if (_dest.get_storage_type() != PNMImage::ST_integer &&
+      _dest.get_num_channels() == _num_channels && x_size > 0) {
+    pvector<PN_float32> values(x_size * _num_channels);
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = (PN_float32)((double)row[i] / (double)source_max);
+    }
+    _dest.set_float_row(y, &values[0]);
+    return;
+  }
 
-    if (dest.has_alpha() && source.has_alpha()) {
-      filter_alpha_yx(dest, source, width, make_filter, 0);
+  for (int x = 0; x < x_size; ++x) {
+    if (_gray) {
+      _dest.set_xel(x, y, (double)row[0] / (double)source_max);
+      ++row;
+    } else {
+      _dest.set_xel(x, y, (double)row[0] / (double)source_max,
+                    (double)row[1] / (double)source_max,
+                    (double)row[2] / (double)source_max);
+      row += 3;
+    }
+    if (_alpha) {
+      _dest.set_alpha(x, y, (double)row[0] / (double)source_max);
+      ++row;
     }
   }
 }
 
+// filter_image pulls everything together, and filters one image into
+// another.  Both images can be the same with no ill effects.
+static void
+filter_image(PNMImage &dest, const PNMImage &source,
+             double width, FilterFunction *make_filter) {
+  if (!dest.is_valid() || !source.is_valid()) {
+    return;
+  }
+
+  if (&dest == &source) {
+    // The bands of the destination are written while the source is
+    // still being read, so we need a separate copy of the source.
+    PNMImage copy(source);
+    filter_image(dest, copy, width, make_filter);
+    return;
+  }
+
+  PNMImageFilterJob job(dest, source);
+  int num_channels = (job._gray ? 1 : 3) + (job._alpha ? 1 : 0);
+  job.filter(source.get_x_size(), source.get_y_size(),
+             dest.get_x_size(), dest.get_y_size(), num_channels,
+             width, make_filter);
+}
+
 
 
 ////////////////////////////////////////////////////////////////////
@@ -552,38 +947,181 @@ gaussian_filter_from(double width, const PNMImage &copy) {
   filter_image(*this, copy, width, &gaussian_filter_impl);
 }
 
+////////////////////////////////////////////////////////////////////
+//       Class : StreamFilterJob
+// Description : Filters an image for a PNMBandProcessor, which reads
+//               the source image and writes the destination image a
+//               band of rows at a time.  The rows are passed through
+//               the processor's bands, which it refills and flushes
+//               as the filter moves down the image.
+////////////////////////////////////////////////////////////////////
+class StreamFilterJob : public PNMImageFilterJob {
+public:
+  StreamFilterJob(PNMBandProcessor *processor);
+
+  void copy_rows();
+
+  virtual void get_source_row(int y, StoreType row[]) const;
+  virtual void set_dest_row(int y, const StoreType row[]);
+  virtual bool is_aborted() const;
+
+  PNMBandProcessor *_processor;
+};
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamFilterJob::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+StreamFilterJob::
+StreamFilterJob(PNMBandProcessor *processor) :
+  PNMImageFilterJob(processor->_dest_band, processor->_source_band),
+  _processor(processor)
+{
+  _num_channels = (_gray ? 1 : 3) + (_alpha ? 1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamFilterJob::copy_rows
+//       Access: Public
+//  Description: Copies each row of the source image to the
+//               destination, unfiltered, converting it as necessary.
+//               The images must be the same size.
+////////////////////////////////////////////////////////////////////
+void StreamFilterJob::
+copy_rows() {
+  int x_size = _source.get_x_size();
+  pvector<StoreType> row(x_size * _num_channels);
+  for (int y = 0; y < _processor->_dest_y_size && !is_aborted(); ++y) {
+    get_source_row(y, &row[0]);
+    set_dest_row(y, &row[0]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamFilterJob::get_source_row
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+void StreamFilterJob::
+get_source_row(int y, StoreType row[]) const {
+  PNMImageFilterJob::get_source_row(_processor->get_source_band_row(y), row);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamFilterJob::set_dest_row
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+void StreamFilterJob::
+set_dest_row(int y, const StoreType row[]) {
+  PNMImageFilterJob::set_dest_row(_processor->get_dest_band_row(y), row);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: StreamFilterJob::is_aborted
+//       Access: Public, Virtual
+//  Description: Returns true if the processor has failed to read or
+//               write a band, so there is no point in continuing.
+////////////////////////////////////////////////////////////////////
+bool StreamFilterJob::
+is_aborted() const {
+  return _processor->_failed;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::filter_rows
+//       Access: Private
+//  Description: Filters or copies all of the rows of the source image
+//               into the destination image, in order, through the
+//               bands.
+////////////////////////////////////////////////////////////////////
+void PNMBandProcessor::
+filter_rows() {
+  StreamFilterJob job(this);
+  int num_channels = (job._gray ? 1 : 3) + (job._alpha ? 1 : 0);
+
+  switch (_filter_type) {
+  case FT_none:
+    job.copy_rows();
+    break;
+
+  case FT_box:
+    job.filter_in_order(_source_band.get_x_size(), _source_y_size,
+                        _dest_band.get_x_size(), _dest_y_size,
+                        num_channels, _filter_width, &box_filter_impl);
+    break;
+
+  case FT_gaussian:
+    job.filter_in_order(_source_band.get_x_size(), _source_y_size,
+                        _dest_band.get_x_size(), _dest_y_size,
+                        num_channels, _filter_width, &gaussian_filter_impl);
+    break;
+  }
+}
+
 // Now we do it again, this time for PfmFile.  In this case we also
 // need to support the sparse variants, since PfmFiles can be
-// incomplete.  However, we don't need to have a different function
-// for each channel.
+// incomplete; these still filter one channel at a time, with the
+// function defined in pnm-image-filter-sparse-core.cxx.
 
-#define FUNCTION_NAME filter_pfm_xy
-#define IMAGETYPE PfmFile
-#define ASIZE get_x_size
-#define BSIZE get_y_size
-#define GETVAL(a, b, channel) get_channel(a, b, channel)
-#define SETVAL(a, b, channel, v) set_channel(a, b, channel, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+////////////////////////////////////////////////////////////////////
+//       Class : PfmFileFilterJob
+// Description : Filters the channels that a pair of PfmFiles have in
+//               common.
+////////////////////////////////////////////////////////////////////
+class PfmFileFilterJob : public FilterJob {
+public:
+  PfmFileFilterJob(PfmFile &dest, const PfmFile &source);
 
-#define FUNCTION_NAME filter_pfm_yx
-#define IMAGETYPE PfmFile
-#define ASIZE get_y_size
-#define BSIZE get_x_size
-#define GETVAL(a, b, channel) get_channel(b, a, channel)
-#define SETVAL(a, b, channel, v) set_channel(b, a, channel, v)
-#include "pnm-image-filter-core.cxx"
-#undef SETVAL
-#undef GETVAL
-#undef BSIZE
-#undef ASIZE
-#undef IMAGETYPE
-#undef FUNCTION_NAME
+  virtual void get_source_row(int y, StoreType row[]) const;
+  virtual void set_dest_row(int y, const StoreType row[]);
+
+  PfmFile &_dest;
+  const PfmFile &_source;
+};
+
+////////////////////////////////////////////////////////////////////
+//     Function: PfmFileFilterJob::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+PfmFileFilterJob::
+PfmFileFilterJob(PfmFile &dest, const PfmFile &source) :
+  _dest(dest),
+  _source(source)
+{
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PfmFileFilterJob::get_source_row
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+void PfmFileFilterJob::
+get_source_row(int y, StoreType row[]) const {
+  int x_size = _source.get_x_size();
+  for (int x = 0; x < x_size; ++x) {
+    for (int ci = 0; ci < _num_channels; ++ci) {
+      *row++ = (StoreType)(source_max * _source.get_channel(x, y, ci));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PfmFileFilterJob::set_dest_row
+//       Access: Public, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+void PfmFileFilterJob::
+set_dest_row(int y, const StoreType row[]) {
+  int x_size = _dest.get_x_size();
+  for (int x = 0; x < x_size; ++x) {
+    for (int ci = 0; ci < _num_channels; ++ci) {
+      _dest.set_channel(x, y, ci, (double)(*row++) / (double)source_max);
+    }
+  }
+}
 
 
 #define FUNCTION_NAME filter_pfm_sparse_xy
@@ -619,6 +1157,7 @@ gaussian_filter_from(double width, const PNMImage &copy) {
 #undef FUNCTION_NAME
 
 
+
 // filter_image pulls everything together, and filters one image into
 // another.  Both images can be the same with no ill effects.
 static void
@@ -639,17 +1178,21 @@ filter_image(PfmFile &dest, const PfmFile &source,
       }
     }
   } else {
-    // We can use the slightly faster fully-specified variant.
-    if (dest.get_x_size() <= dest.get_y_size()) {
-      for (int ci = 0; ci < num_channels; ++ci) {
-        filter_pfm_xy(dest, source, width, make_filter, ci);
-      }
-      
-    } else {
-      for (int ci = 0; ci < num_channels; ++ci) {
-        filter_pfm_yx(dest, source, width, make_filter, ci);
-      }
+    // We can use the faster fully-specified variant.
+    if (!dest.is_valid() || !source.is_valid()) {
+      return;
+    }
+
+    if (&dest == &source) {
+      PfmFile copy(source);
+      filter_image(dest, copy, width, make_filter);
+      return;
     }
+
+    PfmFileFilterJob job(dest, source);
+    job.filter(source.get_x_size(), source.get_y_size(),
+               dest.get_x_size(), dest.get_y_size(), num_channels,
+               width, make_filter);
   }
 }
 
@@ -684,94 +1227,179 @@ gaussian_filter_from(double width, const PfmFile &copy) {
 }
 
 
+
 //
 // The following functions are support for quick_box_filter().
 //
 
+// The box is accumulated from the integer component values of the
+// source image, or from its floating-point values if as_float is true
+// (in which case the result is in the range 0..1, not 0..maxval).
+template<bool as_float>
 INLINE void
 box_filter_xel(const PNMImage &image,
                int x, int y, double x_contrib, double y_contrib,
-               double &red, double &grn, double &blu, double &alpha,
-               double &pixel_count) {
+               LColord &color, double &pixel_count) {
   double contrib = x_contrib * y_contrib;
-  red += image.get_red_val(x, y) * contrib;
-  grn += image.get_green_val(x, y) * contrib;
-  blu += image.get_blue_val(x, y) * contrib;
-  if (image.has_alpha()) {
-    alpha += image.get_alpha_val(x, y) * contrib;
+  if (as_float) {
+    color[0] += image.get_red(x, y) * contrib;
+    color[1] += image.get_green(x, y) * contrib;
+    color[2] += image.get_blue(x, y) * contrib;
+    if (image.has_alpha()) {
+      color[3] += image.get_alpha(x, y) * contrib;
+    }
+  } else {
+    color[0] += image.get_red_val(x, y) * contrib;
+    color[1] += image.get_green_val(x, y) * contrib;
+    color[2] += image.get_blue_val(x, y) * contrib;
+    if (image.has_alpha()) {
+      color[3] += image.get_alpha_val(x, y) * contrib;
+    }
   }
 
   pixel_count += contrib;
 }
 
 
+template<bool as_float>
 INLINE void
 box_filter_line(const PNMImage &image,
                 double x0, int y, double x1, double y_contrib,
-                double &red, double &grn, double &blu, double &alpha,
-                double &pixel_count) {
+                LColord &color, double &pixel_count) {
   int x = (int)x0;
   // Get the first (partial) xel
-  box_filter_xel(image, x, y, (double)(x+1)-x0, y_contrib,
-                 red, grn, blu, alpha, pixel_count);
+  box_filter_xel<as_float>(image, x, y, (double)(x+1)-x0, y_contrib,
+                           color, pixel_count);
 
   int x_last = (int)x1;
   if (x < x_last) {
     x++;
     while (x < x_last) {
       // Get each consecutive (complete) xel
-      box_filter_xel(image, x, y, 1.0, y_contrib,
-                     red, grn, blu, alpha, pixel_count);
+      box_filter_xel<as_float>(image, x, y, 1.0, y_contrib,
+                               color, pixel_count);
       x++;
     }
 
     // Get the final (partial) xel
     double x_contrib = x1 - (double)x_last;
     if (x_contrib > 0.0001) {
-      box_filter_xel(image, x, y, x_contrib, y_contrib,
-                     red, grn, blu, alpha, pixel_count);
+      box_filter_xel<as_float>(image, x, y, x_contrib, y_contrib,
+                               color, pixel_count);
     }
   }
 }
 
+template<bool as_float>
 static void
 box_filter_region(const PNMImage &image,
                   double x0, double y0, double x1, double y1,
-                  xel &result, xelval &alpha_result) {
-  double red = 0.0, grn = 0.0, blu = 0.0, alpha = 0.0;
+                  LColord &result) {
+  LColord color(0.0, 0.0, 0.0, 0.0);
   double pixel_count = 0.0;
 
   assert(y0 >=0 && y1 >=0);
 
   int y = (int)y0;
   // Get the first (partial) row
-  box_filter_line(image, x0, y, x1, (double)(y+1)-y0,
-                  red, grn, blu, alpha, pixel_count);
+  box_filter_line<as_float>(image, x0, y, x1, (double)(y+1)-y0,
+                            color, pixel_count);
 
   int y_last = (int)y1;
   if (y < y_last) {
     y++;
     while (y < y_last) {
       // Get each consecutive (complete) row
-      box_filter_line(image, x0, y, x1, 1.0,
-                      red, grn, blu, alpha, pixel_count);
+      box_filter_line<as_float>(image, x0, y, x1, 1.0,
+                                color, pixel_count);
       y++;
     }
 
     // Get the final (partial) row
     double y_contrib = y1 - (double)y_last;
     if (y_contrib > 0.0001) {
-      box_filter_line(image, x0, y, x1, y_contrib,
-                      red, grn, blu, alpha, pixel_count);
+      box_filter_line<as_float>(image, x0, y, x1, y_contrib,
+                                color, pixel_count);
     }
   }
 
-  PPM_ASSIGN(result,
-             (xelval)(red / pixel_count + 0.5),
-             (xelval)(grn / pixel_count + 0.5),
-             (xelval)(blu / pixel_count + 0.5));
+  result.set(color[0] / pixel_count, color[1] / pixel_count,
+             color[2] / pixel_count, color[3] / pixel_count);
+}
+
+////////////////////////////////////////////////////////////////////
+//       Class : QuickFilterJob
+// Description : Computes a band of rows of quick_filter_from().
+//               Each destination pixel depends only on its own box
+//               of source pixels, so the bands are independent.
+////////////////////////////////////////////////////////////////////
+class QuickFilterJob : public BandJob {
+public:
+  virtual void do_band(int y_begin, int y_end);
+
+  PNMImage *_dest;
+  const PNMImage *_from;
+  int _to_xoff, _to_yoff;
+  int _to_x_begin, _to_x_end;
+  double _x_scale, _y_scale;
+};
+
+////////////////////////////////////////////////////////////////////
+//     Function: QuickFilterJob::do_band
+//       Access: Public, Virtual
+//  Description: Filters the rows [y_begin, y_end), in the
+//               coordinates of the unbordered destination image.
+////////////////////////////////////////////////////////////////////
+void QuickFilterJob::
+do_band(int y_begin, int y_end) {
+  double from_x0, from_x1, from_y0, from_y1;
+  int to_x, to_y;
+
+  bool has_alpha = _dest->has_alpha();
+
+  // If either image stores floating-point values, the box is averaged
+  // and stored in floating point, rather than in integer values.
+  bool as_float = (_dest->get_storage_type() != PNMImage::ST_integer ||
+                   _from->get_storage_type() != PNMImage::ST_integer);
 
-  alpha_result = (xelval)(alpha / pixel_count + 0.5);
+  from_y0 = y_begin * _y_scale;
+  for (to_y = y_begin; to_y < y_end; to_y++) {
+    from_y1 = (to_y+1) * _y_scale;
+
+    from_x0 = _to_x_begin * _x_scale;
+    for (to_x = _to_x_begin; to_x < _to_x_end; to_x++) {
+      from_x1 = (to_x+1) * _x_scale;
+
+      // Now the box from (from_x0, from_y0) - (from_x1, from_y1)
+      // but not including (from_x1, from_y1) maps to the pixel (to_x, to_y).
+      LColord result;
+      if (as_float) {
+        box_filter_region<true>(*_from,
+                                from_x0, from_y0, from_x1, from_y1, result);
+        _dest->set_xel(_to_xoff+to_x, _to_yoff+to_y,
+                       result[0], result[1], result[2]);
+        if (has_alpha) {
+          _dest->set_alpha(_to_xoff+to_x, _to_yoff+to_y, result[3]);
+        }
+
+      } else {
+        box_filter_region<false>(*_from,
+                                 from_x0, from_y0, from_x1, from_y1, result);
+        PPM_ASSIGN((*_dest)[_to_yoff + to_y][_to_xoff + to_x],
+                   (xelval)(result[0] + 0.5),
+                   (xelval)(result[1] + 0.5),
+                   (xelval)(result[2] + 0.5));
+        if (has_alpha) {
+          _dest->set_alpha_val(_to_xoff+to_x, _to_yoff+to_y,
+                               (xelval)(result[3] + 0.5));
+        }
+      }
+
+      from_x0 = from_x1;
+    }
+    from_y0 = from_y1;
+    Thread::consider_yield();
+  }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -794,41 +1422,15 @@ quick_filter_from(const PNMImage &from, int xborder, int yborder) {
   int to_xs = get_x_size() - xborder;
   int to_ys = get_y_size() - yborder;
 
-  int to_xoff = xborder / 2;
-  int to_yoff = yborder / 2;
-
-  double from_x0, from_x1, from_y0, from_y1;
-  int to_x, to_y;
-
-  double x_scale = (double)from_xs / (double)to_xs;
-  double y_scale = (double)from_ys / (double)to_ys;
-
-  from_y0 = max(0, -to_yoff) * y_scale;
-  for (to_y = max(0, -to_yoff);
-       to_y < min(to_ys, get_y_size()-to_yoff);
-       to_y++) {
-    from_y1 = (to_y+1) * y_scale;
-
-    from_x0 = max(0, -to_xoff) * x_scale;
-    for (to_x = max(0, -to_xoff);
-         to_x < min(to_xs, get_x_size()-to_xoff);
-         to_x++) {
-      from_x1 = (to_x+1) * x_scale;
-
-      // Now the box from (from_x0, from_y0) - (from_x1, from_y1)
-      // but not including (from_x1, from_y1) maps to the pixel (to_x, to_y).
-      xelval alpha_result;
-      box_filter_region(from,
-                        from_x0, from_y0, from_x1, from_y1,
-                        (*this)[to_yoff + to_y][to_xoff + to_x],
-                        alpha_result);
-      if (has_alpha()) {
-        set_alpha_val(to_xoff+to_x, to_yoff+to_y, alpha_result);
-      }
-
-      from_x0 = from_x1;
-    }
-    from_y0 = from_y1;
-    Thread::consider_yield();
-  }
+  QuickFilterJob job;
+  job._dest = this;
+  job._from = &from;
+  job._to_xoff = xborder / 2;
+  job._to_yoff = yborder / 2;
+  job._to_x_begin = max(0, -job._to_xoff);
+  job._to_x_end = min(to_xs, get_x_size()-job._to_xoff);
+  job._x_scale = (double)from_xs / (double)to_xs;
+  job._y_scale = (double)from_ys / (double)to_ys;
+
+  job.run(max(0, -job._to_yoff), min(to_ys, get_y_size()-job._to_yoff), 32);
 }
@@ -0,0 +1,357 @@
+// Filename: pnmBandProcessor.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pnmBandProcessor.h"
+#include "pnmImageHeader.h"
+#include "pnmReader.h"
+#include "pnmWriter.h"
+#include "pnmFileType.h"
+#include "config_pnmimage.h"
+#include "thread.h"
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::Constructor
+//       Access: Published
+//  Description:
+////////////////////////////////////////////////////////////////////
+PNMBandProcessor::
+PNMBandProcessor() {
+  _band_rows = 64;
+  _has_size = false;
+  _x_size = 0;
+  _y_size = 0;
+  _filter_type = FT_none;
+  _filter_width = 1.0;
+  _num_channels = 0;
+  _maxval = 0;
+
+  _reader = NULL;
+  _writer = NULL;
+  _read_streaming = false;
+  _write_streaming = false;
+  _failed = false;
+  _source_band_y = 0;
+  _source_rows_read = 0;
+  _source_y_size = 0;
+  _dest_band_y = 0;
+  _dest_y_size = 0;
+  _fill_alpha = false;
+  _fill_gray = false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::Destructor
+//       Access: Published, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+PNMBandProcessor::
+~PNMBandProcessor() {
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::process
+//       Access: Published
+//  Description: Reads the indicated source image, a band at a time,
+//               and writes the resized and converted result to the
+//               indicated destination file.  If the types are NULL,
+//               they are deduced from the filenames.  Returns true on
+//               success, false on failure.
+////////////////////////////////////////////////////////////////////
+bool PNMBandProcessor::
+process(const Filename &source_filename, const Filename &dest_filename,
+        PNMFileType *source_type, PNMFileType *dest_type) {
+  PNMImageHeader header;
+  PNMReader *reader = header.make_reader(source_filename, source_type);
+  if (reader == (PNMReader *)NULL) {
+    return false;
+  }
+
+  PNMWriter *writer = header.make_writer(dest_filename, dest_type);
+  if (writer == (PNMWriter *)NULL) {
+    delete reader;
+    return false;
+  }
+
+  return process(reader, writer);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::process
+//       Access: Public
+//  Description: Reads the image from the indicated PNMReader, a band
+//               at a time, and writes the resized and converted
+//               result to the indicated PNMWriter.  Both objects are
+//               deleted when the operation is done, whether
+//               successful or not.  Returns true on success, false on
+//               failure.
+////////////////////////////////////////////////////////////////////
+bool PNMBandProcessor::
+process(PNMReader *reader, PNMWriter *writer) {
+  _read_streaming = false;
+  _write_streaming = false;
+
+  if (reader == (PNMReader *)NULL || writer == (PNMWriter *)NULL ||
+      !reader->is_valid() || !writer->is_valid()) {
+    delete reader;
+    delete writer;
+    return false;
+  }
+
+  // If the reader can't give us the image a row at a time, we have
+  // no choice but to read the whole thing now.
+  _read_streaming = reader->supports_read_row() && !reader->is_floating_point();
+  if (_read_streaming) {
+    reader->prepare_read();
+    _source_band.clear(reader->get_x_size(),
+                       min(_band_rows, reader->get_y_size()),
+                       reader->get_num_channels(), reader->get_maxval(),
+                       reader->get_type());
+    _source_band.set_comment(reader->get_comment());
+    _source_y_size = reader->get_y_size();
+    _source_rows_read = 0;
+    _reader = reader;
+
+  } else {
+    pnmimage_cat.info()
+      << "Cannot read " << reader->get_type()->get_name()
+      << " files a band at a time; reading the whole image.\n";
+    if (!_source_band.read(reader)) {
+      delete writer;
+      return false;
+    }
+    _source_y_size = _source_band.get_y_size();
+    _source_rows_read = _source_y_size;
+    _reader = NULL;
+  }
+  _source_band_y = 0;
+
+  int source_x_size = _source_band.get_x_size();
+  int x_size = _has_size ? _x_size : source_x_size;
+  int y_size = _has_size ? _y_size : _source_y_size;
+  int num_channels = (_num_channels != 0) ? _num_channels : _source_band.get_num_channels();
+  xelval maxval = (_maxval != 0) ? _maxval : _source_band.get_maxval();
+
+  _writer = writer;
+  _failed = false;
+
+  if (_filter_type == FT_none &&
+      (x_size != source_x_size || y_size != _source_y_size)) {
+    pnmimage_cat.error()
+      << "A filter is required to resize an image from "
+      << source_x_size << " x " << _source_y_size << " to "
+      << x_size << " x " << y_size << ".\n";
+    _failed = true;
+
+  } else if (x_size <= 0 || y_size <= 0) {
+    _failed = true;
+  }
+
+  // Also set up the writer, and write out its header if it is to be
+  // written a band at a time.
+  _write_streaming = writer->supports_write_row() && writer->supports_integer();
+  writer->set_x_size(x_size);
+  writer->set_y_size(y_size);
+  writer->set_num_channels(num_channels);
+  writer->set_maxval(maxval);
+  writer->set_comment(_source_band.get_comment());
+
+  _dest_y_size = y_size;
+  _dest_band.clear(x_size, min(_band_rows, y_size), num_channels, maxval);
+  _fill_alpha = (_dest_band.has_alpha() && !_source_band.has_alpha());
+  _fill_gray = (_dest_band.is_grayscale() && !writer->supports_grayscale());
+
+  if (!_failed) {
+    if (_write_streaming) {
+      if (!writer->write_header()) {
+        _failed = true;
+      }
+    } else {
+      pnmimage_cat.info()
+        << "Cannot write " << writer->get_type()->get_name()
+        << " files a band at a time; holding the whole image.\n";
+      _dest_image.clear(x_size, y_size, num_channels, maxval);
+      _dest_image.set_comment(_source_band.get_comment());
+    }
+  }
+
+  if (!_failed) {
+    start_dest_band(0);
+    filter_rows();
+    flush_dest_band();
+  }
+
+  bool success = !_failed;
+  delete _reader;
+  _reader = NULL;
+  _writer = NULL;
+
+  if (_write_streaming || !success) {
+    // Deleting the writer flushes the last of the image.
+    delete writer;
+  } else {
+    success = _dest_image.write(writer);
+  }
+
+  _source_band.clear();
+  _dest_band.clear();
+  _dest_image.clear();
+  return success;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::process_band
+//       Access: Protected, Virtual
+//  Description: Called with each band of the result in turn, just
+//               before it is written.  The band holds the rows of the
+//               image beginning at row y, and may be modified in
+//               place.  The default implementation does nothing.
+////////////////////////////////////////////////////////////////////
+void PNMBandProcessor::
+process_band(PNMImage &, int) {
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::get_source_band_row
+//       Access: Private
+//  Description: Returns the row of _source_band that holds row y of
+//               the source image, reading further bands as needed.
+//               The rows must be requested in increasing order.
+////////////////////////////////////////////////////////////////////
+int PNMBandProcessor::
+get_source_band_row(int y) {
+  nassertr(y >= _source_band_y && y < _source_y_size, 0);
+  while (y >= _source_rows_read) {
+    if (_failed || !read_source_band()) {
+      _failed = true;
+      return 0;
+    }
+  }
+  return y - _source_band_y;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::get_dest_band_row
+//       Access: Private
+//  Description: Returns the row of _dest_band that will hold row y of
+//               the result, writing out the current band first if y
+//               is past it.  The rows must be requested in
+//               increasing order.
+////////////////////////////////////////////////////////////////////
+int PNMBandProcessor::
+get_dest_band_row(int y) {
+  nassertr(y >= _dest_band_y && y < _dest_y_size, 0);
+  if (y >= _dest_band_y + _dest_band.get_y_size()) {
+    if (!flush_dest_band()) {
+      _failed = true;
+    }
+    start_dest_band(_dest_band_y + _dest_band.get_y_size());
+  }
+  return y - _dest_band_y;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::read_source_band
+//       Access: Private
+//  Description: Reads the next band of rows from the source image
+//               into _source_band, replacing the previous band.
+//               Returns true on success, false on failure.
+////////////////////////////////////////////////////////////////////
+bool PNMBandProcessor::
+read_source_band() {
+  nassertr(_reader != (PNMReader *)NULL, false);
+
+  _source_band_y = _source_rows_read;
+  int x_size = _source_band.get_x_size();
+  int num_rows = min(_source_band.get_y_size(), _source_y_size - _source_band_y);
+  xel *array = _source_band.get_array();
+  xelval *alpha = _source_band.get_alpha_array();
+
+  for (int yi = 0; yi < num_rows; ++yi) {
+    if (!_reader->read_row(array + yi * x_size,
+                           alpha != (xelval *)NULL ? alpha + yi * x_size : NULL,
+                           x_size, _source_y_size)) {
+      pnmimage_cat.error()
+        << "Image is truncated after " << _source_rows_read << " rows.\n";
+      return false;
+    }
+    ++_source_rows_read;
+  }
+  Thread::consider_yield();
+  return (num_rows > 0);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::start_dest_band
+//       Access: Private
+//  Description: Prepares _dest_band to receive the band of the
+//               result beginning at row y.
+////////////////////////////////////////////////////////////////////
+void PNMBandProcessor::
+start_dest_band(int y) {
+  _dest_band_y = y;
+  int num_rows = min(_band_rows, _dest_y_size - y);
+  if (num_rows != _dest_band.get_y_size()) {
+    // The last band may be shorter than the rest.
+    _dest_band.clear(_dest_band.get_x_size(), num_rows,
+                     _dest_band.get_num_channels(), _dest_band.get_maxval());
+  }
+  if (_fill_alpha) {
+    _dest_band.alpha_fill(1.0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMBandProcessor::flush_dest_band
+//       Access: Private
+//  Description: Passes the completed _dest_band to process_band(),
+//               and then on to the writer.  Returns true on success,
+//               false on failure.
+////////////////////////////////////////////////////////////////////
+bool PNMBandProcessor::
+flush_dest_band() {
+  if (_failed) {
+    return false;
+  }
+
+  process_band(_dest_band, _dest_band_y);
+
+  if (!_write_streaming) {
+    _dest_image.copy_sub_image(_dest_band, 0, _dest_band_y);
+    return true;
+  }
+
+  int x_size = _dest_band.get_x_size();
+  int num_rows = _dest_band.get_y_size();
+  if (_fill_gray) {
+    // Copy the gray values to all channels to help out the writer.
+    for (int yi = 0; yi < num_rows; ++yi) {
+      for (int xi = 0; xi < x_size; ++xi) {
+        _dest_band.set_xel_val(xi, yi, _dest_band.get_gray_val(xi, yi));
+      }
+    }
+  }
+
+  xel *array = _dest_band.get_array();
+  xelval *alpha = _dest_band.get_alpha_array();
+  for (int yi = 0; yi < num_rows; ++yi) {
+    if (!_writer->write_row(array + yi * x_size,
+                            alpha != (xelval *)NULL ? alpha + yi * x_size : NULL)) {
+      pnmimage_cat.error()
+        << "Unable to write row " << _dest_band_y + yi << ".\n";
+      return false;
+    }
+  }
+  Thread::consider_yield();
+  return true;
+}
@@ -0,0 +1,143 @@
+// Filename: pnmBandProcessor.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef PNMBANDPROCESSOR_H
+#define PNMBANDPROCESSOR_H
+
+#include "pandabase.h"
+
+#include "pnmImage.h"
+#include "filename.h"
+
+class PNMReader;
+class PNMWriter;
+class PNMFileType;
+
+////////////////////////////////////////////////////////////////////
+//       Class : PNMBandProcessor
+// Description : Copies an image file to another image file, resizing
+//               it with a filter and converting it to a different
+//               number of channels or maxval along the way, without
+//               ever holding the whole image in memory.
+//
+//               The source image is read a horizontal band of rows at
+//               a time, and the result is written out a band at a
+//               time as it is completed, so that only a few bands of
+//               each image, and the rows that the filter needs to
+//               look at, are in memory at once.  This makes it
+//               possible to process images much larger than would fit
+//               in a PNMImage.
+//
+//               This requires a file type whose reader supports
+//               read_row() and whose writer supports write_row(); PNM,
+//               PNG, SGI, JPG, and TIFF files can all be read this
+//               way, and PNM, PNG, and SGI files can be written.  For
+//               other types, the whole image is quietly held in
+//               memory instead.
+//
+//               Subclasses may override process_band() to modify each
+//               band of the result before it is written.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDA_PNMIMAGE PNMBandProcessor {
+PUBLISHED:
+  enum FilterType {
+    FT_none,
+    FT_box,
+    FT_gaussian,
+  };
+
+  PNMBandProcessor();
+  virtual ~PNMBandProcessor();
+
+  INLINE void set_band_rows(int band_rows);
+  INLINE int get_band_rows() const;
+
+  INLINE void set_size(int x_size, int y_size);
+  INLINE void clear_size();
+  INLINE bool has_size() const;
+  INLINE int get_x_size() const;
+  INLINE int get_y_size() const;
+
+  INLINE void set_filter(FilterType filter_type, double width = 1.0);
+  INLINE FilterType get_filter_type() const;
+  INLINE double get_filter_width() const;
+
+  INLINE void set_num_channels(int num_channels);
+  INLINE int get_num_channels() const;
+  INLINE void set_maxval(xelval maxval);
+  INLINE xelval get_maxval() const;
+
+  BLOCKING bool process(const Filename &source_filename,
+                        const Filename &dest_filename,
+                        PNMFileType *source_type = NULL,
+                        PNMFileType *dest_type = NULL);
+
+  INLINE bool was_read_streaming() const;
+  INLINE bool was_write_streaming() const;
+
+public:
+  bool process(PNMReader *reader, PNMWriter *writer);
+
+protected:
+  virtual void process_band(PNMImage &band, int y);
+
+private:
+  int get_source_band_row(int y);
+  int get_dest_band_row(int y);
+  bool read_source_band();
+  void start_dest_band(int y);
+  bool flush_dest_band();
+  void filter_rows();
+
+private:
+  int _band_rows;
+  bool _has_size;
+  int _x_size, _y_size;
+  FilterType _filter_type;
+  double _filter_width;
+  int _num_channels;
+  xelval _maxval;
+
+  // The following are used only while process() is running.
+  PNMReader *_reader;
+  PNMWriter *_writer;
+  bool _read_streaming;
+  bool _write_streaming;
+  bool _failed;
+
+  // The rows of the source image that are currently in memory, and
+  // the first of them.
+  PNMImage _source_band;
+  int _source_band_y;
+  int _source_rows_read;
+  int _source_y_size;
+
+  // The rows of the result that have not yet been written, and the
+  // first of them.
+  PNMImage _dest_band;
+  int _dest_band_y;
+  int _dest_y_size;
+  bool _fill_alpha;
+  bool _fill_gray;
+
+  // If the writer can't take the result a row at a time, the bands
+  // are collected here.
+  PNMImage _dest_image;
+
+  friend class StreamFilterJob;
+};
+
+#include "pnmBandProcessor.I"
+
+#endif
@@ -22,6 +22,16 @@
 #include "stackedPerlinNoise2.h"
 #include <algorithm>
 
+// The component of an LColord that applies to each value of a pixel
+// of a floating-point image with 1, 2, 3, or 4 channels.  The gray
+// value of a grayscale image corresponds to blue, as in get_gray().
+static const int float_color_components[4][4] = {
+  { 2, 0, 0, 0 },
+  { 2, 3, 0, 0 },
+  { 0, 1, 2, 0 },
+  { 0, 1, 2, 3 },
+};
+
 ////////////////////////////////////////////////////////////////////
 //     Function: PNMImage::Constructor
 //       Access: Published
@@ -29,8 +39,11 @@
 ////////////////////////////////////////////////////////////////////
 PNMImage::
 PNMImage(const Filename &filename, PNMFileType *type) {
+  _storage_type = ST_integer;
   _array = NULL;
   _alpha = NULL;
+  _float_array = NULL;
+  _half_array = NULL;
   _has_read_size = false;
 
   bool result = read(filename, type);
@@ -44,7 +57,8 @@ PNMImage(const Filename &filename, PNMFileType *type) {
 //     Function: PNMImage::clear
 //       Access: Published
 //  Description: Frees all memory allocated for the image, and clears
-//               all its parameters (size, color, type, etc).
+//               all its parameters (size, color, type, etc).  The
+//               storage type is not changed.
 ////////////////////////////////////////////////////////////////////
 void PNMImage::
 clear() {
@@ -56,6 +70,14 @@ clear() {
     PANDA_FREE_ARRAY(_alpha);
     _alpha = (xelval *)NULL;
   }
+  if (_float_array != (PN_float32 *)NULL) {
+    PANDA_FREE_ARRAY(_float_array);
+    _float_array = (PN_float32 *)NULL;
+  }
+  if (_half_array != (PN_uint16 *)NULL) {
+    PANDA_FREE_ARRAY(_half_array);
+    _half_array = (PN_uint16 *)NULL;
+  }
   _x_size = 0;
   _y_size = 0;
   _num_channels = 0;
@@ -85,6 +107,18 @@ clear(int x_size, int y_size, int num_channels,
   _type = type;
   _has_read_size = false;
 
+  if (_storage_type != ST_integer) {
+    allocate_float_array();
+    if (_storage_type == ST_float32) {
+      memset(_float_array, 0, sizeof(PN_float32) * _y_size * _x_size * _num_channels);
+    } else {
+      // A half-float zero is all zero bits, too.
+      memset(_half_array, 0, sizeof(PN_uint16) * _y_size * _x_size * _num_channels);
+    }
+    setup_rc();
+    return;
+  }
+
   if (has_alpha()) {
     allocate_alpha();
     memset(_alpha, 0, sizeof(xelval) * _y_size * _x_size);
@@ -99,14 +133,25 @@ clear(int x_size, int y_size, int num_channels,
 ////////////////////////////////////////////////////////////////////
 //     Function: PNMImage::copy_from
 //       Access: Published
-//  Description: Makes this image become a copy of the other image.
+//  Description: Makes this image become a copy of the other image,
+//               including its storage type.
 ////////////////////////////////////////////////////////////////////
 void PNMImage::
 copy_from(const PNMImage &copy) {
   clear();
+  _storage_type = copy._storage_type;
   copy_header_from(copy);
 
   if (copy.is_valid()) {
+    size_t num_values = (size_t)_y_size * _x_size * _num_channels;
+    if (_storage_type == ST_float32) {
+      memcpy(_float_array, copy._float_array, sizeof(PN_float32) * num_values);
+      return;
+    }
+    if (_storage_type == ST_float16) {
+      memcpy(_half_array, copy._half_array, sizeof(PN_uint16) * num_values);
+      return;
+    }
     if (has_alpha()) {
       memcpy(_alpha, copy._alpha, sizeof(xelval) * _y_size * _x_size);
     }
@@ -160,6 +205,12 @@ copy_header_from(const PNMImageHeader &header) {
   clear();
   PNMImageHeader::operator = (header);
 
+  if (_storage_type != ST_integer) {
+    allocate_float_array();
+    setup_rc();
+    return;
+  }
+
   if (has_alpha()) {
     allocate_alpha();
   }
@@ -172,7 +223,8 @@ copy_header_from(const PNMImageHeader &header) {
 //     Function: PNMImage::take_from
 //       Access: Published
 //  Description: Move the contents of the other image into this one,
-//               and empty the other image.
+//               and empty the other image.  This image takes on the
+//               storage type of the other image.
 ////////////////////////////////////////////////////////////////////
 void PNMImage::
 take_from(PNMImage &orig) {
@@ -180,12 +232,17 @@ take_from(PNMImage &orig) {
   PNMImageHeader::operator = (orig);
   setup_rc();
 
+  _storage_type = orig._storage_type;
   if (has_alpha()) {
     _alpha = orig._alpha;
     orig._alpha = NULL;
   }
   _array = orig._array;
   orig._array = NULL;
+  _float_array = orig._float_array;
+  orig._float_array = NULL;
+  _half_array = orig._half_array;
+  orig._half_array = NULL;
 
   orig.clear();
 }
@@ -283,6 +340,10 @@ read(istream &data, const string &filename, PNMFileType *type,
 //
 //               The PNMReader is always deleted upon completion,
 //               whether successful or not.
+//
+//               The image keeps its storage type; if it is a
+//               floating-point type, the integer data read from the
+//               file is converted once it has all been read.
 ////////////////////////////////////////////////////////////////////
 bool PNMImage::
 read(PNMReader *reader) {
@@ -290,14 +351,18 @@ read(PNMReader *reader) {
   int read_x_size = _read_x_size;
   int read_y_size = _read_y_size;
 
+  StorageType storage_type = _storage_type;
   clear();
+  _storage_type = ST_integer;
 
   if (reader == NULL) {
+    _storage_type = storage_type;
     return false;
   }
 
   if (!reader->is_valid()) {
     delete reader;
+    _storage_type = storage_type;
     return false;
   }
 
@@ -309,7 +374,9 @@ read(PNMReader *reader) {
   copy_header_from(*reader);
 
   if (reader->is_floating_point()) {
-    // Hmm, it's a floating-point file.  Quietly convert it to integer.
+    // Hmm, it's a floating-point file.  Quietly convert it to integer,
+    // or store it directly if this is a floating-point image.
+    _storage_type = storage_type;
     PfmFile pfm;
     if (!reader->read_pfm(pfm)) {
       delete reader;
@@ -326,6 +393,7 @@ read(PNMReader *reader) {
 
   if (_y_size == 0) {
     clear();
+    _storage_type = storage_type;
     return false;
   }
 
@@ -340,6 +408,7 @@ read(PNMReader *reader) {
     take_from(new_image);
   }
 
+  set_storage_type(storage_type);
   return true;
 }
 
@@ -426,6 +495,13 @@ write(PNMWriter *writer) const {
     return success;
   }
 
+  if (_storage_type != ST_integer) {
+    // The writer wants integer data; convert a copy of the image.
+    PNMImage copy(*this);
+    copy.set_storage_type(ST_integer);
+    return copy.write(writer);
+  }
+
   if (is_grayscale() && !writer->supports_grayscale()) {
     // Copy the gray values to all channels to help out the writer.
     for (int y = 0; y < get_y_size(); y++) {
@@ -443,6 +519,51 @@ write(PNMWriter *writer) const {
 
 
 
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImage::set_storage_type
+//       Access: Published
+//  Description: Changes the way the pixel values are stored in
+//               memory, converting the image if it has already been
+//               read or initialized.  The default, ST_integer,
+//               stores each component as an integer in the range
+//               0..maxval.  ST_float32 and ST_float16 store linear
+//               floating-point values instead, so that a sequence of
+//               filters, blends, and arithmetic operations works on
+//               the values directly, without rounding them to maxval
+//               after each step.  The values are not clamped to 0..1
+//               until they are converted back to integers, for
+//               instance to write the image to a file.
+//
+//               The storage type is kept by clear() and read(), so
+//               it may be set on an empty image before reading.  The
+//               operator [] and get_array() methods are valid only
+//               for an ST_integer image.
+////////////////////////////////////////////////////////////////////
+void PNMImage::
+set_storage_type(StorageType storage_type) {
+  if (storage_type == _storage_type) {
+    return;
+  }
+  if (!is_valid()) {
+    _storage_type = storage_type;
+    return;
+  }
+
+  PNMImage result;
+  result._storage_type = storage_type;
+  result.copy_header_from(*this);
+
+  if (_x_size > 0) {
+    pvector<PN_float32> row(_x_size * _num_channels);
+    for (int y = 0; y < _y_size; ++y) {
+      get_float_row(y, &row[0]);
+      result.set_float_row(y, &row[0]);
+    }
+  }
+
+  take_from(result);
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: PNMImage::set_color_type
 //       Access: Published
@@ -460,6 +581,11 @@ set_color_type(PNMImage::ColorType color_type) {
     return;
   }
 
+  if (_storage_type != ST_integer) {
+    convert_float_channels((int)color_type, _default_rc, _default_gc, _default_bc);
+    return;
+  }
+
   if (!is_grayscale() && is_grayscale(color_type)) {
     // convert to grayscale from color
     for (int y = 0; y < get_y_size(); y++) {
@@ -509,6 +635,11 @@ make_grayscale(double rc, double gc, double bc) {
     return;
   }
 
+  if (_storage_type != ST_integer) {
+    convert_float_channels(has_alpha() ? 2 : 1, rc, gc, bc);
+    return;
+  }
+
   for (int y = 0; y < get_y_size(); y++) {
     for (int x = 0; x < get_x_size(); x++) {
       set_gray(x, y, min(get_bright(x, y, rc, gc, bc), 1.0));
@@ -526,6 +657,21 @@ make_grayscale(double rc, double gc, double bc) {
 ////////////////////////////////////////////////////////////////////
 void PNMImage::
 reverse_rows() {
+  if (_storage_type != ST_integer) {
+    // Swap the rows of values in place.
+    size_t row_size = get_float_value_size() * _x_size * _num_channels;
+    char *data = get_float_data();
+    pvector<char> temp(row_size);
+    for (int y = 0; y < _y_size / 2; y++) {
+      char *row1 = data + y * row_size;
+      char *row2 = data + (_y_size - 1 - y) * row_size;
+      memcpy(&temp[0], row1, row_size);
+      memcpy(row1, row2, row_size);
+      memcpy(row2, &temp[0], row_size);
+    }
+    return;
+  }
+
   if (_array != NULL) {
     xel *new_array = (xel *)PANDA_MALLOC_ARRAY(_x_size * _y_size * sizeof(xel));
     for (int y = 0; y < _y_size; y++) {
@@ -560,6 +706,36 @@ reverse_rows() {
 ////////////////////////////////////////////////////////////////////
 void PNMImage::
 flip(bool flip_x, bool flip_y, bool transpose) {
+  if (_storage_type != ST_integer) {
+    // Copy each pixel's values to their new place in a new array.
+    size_t pixel_size = get_float_value_size() * _num_channels;
+    char *data = get_float_data();
+    char *new_data = (char *)PANDA_MALLOC_ARRAY(_x_size * _y_size * pixel_size);
+    for (int yi = 0; yi < _y_size; ++yi) {
+      int source_yi = !flip_y ? yi : _y_size - 1 - yi;
+      for (int xi = 0; xi < _x_size; ++xi) {
+        int source_xi = !flip_x ? xi : _x_size - 1 - xi;
+        int new_index = transpose ? (xi * _y_size + yi) : (yi * _x_size + xi);
+        memcpy(new_data + new_index * pixel_size,
+               data + (source_yi * _x_size + source_xi) * pixel_size,
+               pixel_size);
+      }
+    }
+    PANDA_FREE_ARRAY(data);
+    if (_storage_type == ST_float32) {
+      _float_array = (PN_float32 *)new_data;
+    } else {
+      _half_array = (PN_uint16 *)new_data;
+    }
+
+    if (transpose) {
+      int t = _x_size;
+      _x_size = _y_size;
+      _y_size = t;
+    }
+    return;
+  }
+
   if (transpose) {
     // Transposed case.  X becomes Y, Y becomes X.
     if (_array != NULL) {
@@ -643,6 +819,13 @@ void PNMImage::
 set_maxval(xelval maxval) {
   nassertv(maxval > 0);
 
+  if (_storage_type != ST_integer) {
+    // The stored values don't depend on maxval, which only affects
+    // their conversion to and from integers.
+    _maxval = maxval;
+    return;
+  }
+
   if (maxval != _maxval) {
     double ratio = (double)maxval / (double)_maxval;
 
@@ -781,7 +964,7 @@ set_pixel(int x, int y, const PixelSpec &pixel) {
   xel p;
   PPM_ASSIGN(p, pixel._red, pixel._green, pixel._blue);
   set_xel_val(x, y, p);
-  if (_alpha != NULL) {
+  if (has_alpha()) {
     set_alpha_val(x, y, pixel._alpha);
   }
 }
@@ -843,6 +1026,7 @@ blend(int x, int y, double r, double g, double b, double alpha) {
 ////////////////////////////////////////////////////////////////////
 void PNMImage::
 set_array(xel *array) {
+  nassertv(_storage_type == ST_integer);
   if (_array != (xel *)NULL) {
     PANDA_FREE_ARRAY(_array);
   }
@@ -863,12 +1047,111 @@ set_array(xel *array) {
 ////////////////////////////////////////////////////////////////////
 void PNMImage::
 set_alpha_array(xelval *alpha) {
+  nassertv(_storage_type == ST_integer);
   if (_alpha != (xelval *)NULL) {
     PANDA_FREE_ARRAY(_alpha);
   }
   _alpha = alpha;
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImage::get_float_row
+//       Access: Public
+//  Description: Fills the indicated array, which must have room for
+//               get_x_size() * get_num_channels() values, with the
+//               pixels of the nth row of the image: the gray or red,
+//               green, and blue values of each pixel, followed by its
+//               alpha value if the image has an alpha channel.  The
+//               values are in the range 0..1 for an ST_integer
+//               image.
+////////////////////////////////////////////////////////////////////
+void PNMImage::
+get_float_row(int y, PN_float32 *row) const {
+  nassertv(y >= 0 && y < _y_size);
+  size_t row_size = (size_t)_x_size * _num_channels;
+
+  switch (_storage_type) {
+  case ST_float32:
+    memcpy(row, _float_array + y * row_size, row_size * sizeof(PN_float32));
+    break;
+
+  case ST_float16:
+    {
+      const PN_uint16 *source = _half_array + y * row_size;
+      for (size_t i = 0; i < row_size; ++i) {
+        row[i] = half_to_float(source[i]);
+      }
+    }
+    break;
+
+  case ST_integer:
+    {
+      const xel *source = _array + y * _x_size;
+      const xelval *alpha = has_alpha() ? _alpha + y * _x_size : NULL;
+      double maxval = (double)get_maxval();
+      for (int x = 0; x < _x_size; ++x) {
+        if (_num_channels >= 3) {
+          *row++ = (PN_float32)(PPM_GETR(source[x]) / maxval);
+          *row++ = (PN_float32)(PPM_GETG(source[x]) / maxval);
+        }
+        *row++ = (PN_float32)(PPM_GETB(source[x]) / maxval);
+        if (alpha != NULL) {
+          *row++ = (PN_float32)(alpha[x] / maxval);
+        }
+      }
+    }
+    break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImage::set_float_row
+//       Access: Public
+//  Description: Replaces the nth row of the image with the pixels in
+//               the indicated array, in the same format returned by
+//               get_float_row().  The values are scaled to maxval
+//               and clamped for an ST_integer image.
+////////////////////////////////////////////////////////////////////
+void PNMImage::
+set_float_row(int y, const PN_float32 *row) {
+  nassertv(y >= 0 && y < _y_size);
+  size_t row_size = (size_t)_x_size * _num_channels;
+
+  switch (_storage_type) {
+  case ST_float32:
+    memcpy(_float_array + y * row_size, row, row_size * sizeof(PN_float32));
+    break;
+
+  case ST_float16:
+    {
+      PN_uint16 *dest = _half_array + y * row_size;
+      for (size_t i = 0; i < row_size; ++i) {
+        dest[i] = float_to_half(row[i]);
+      }
+    }
+    break;
+
+  case ST_integer:
+    {
+      xel *dest = _array + y * _x_size;
+      xelval *alpha = has_alpha() ? _alpha + y * _x_size : NULL;
+      for (int x = 0; x < _x_size; ++x) {
+        if (_num_channels >= 3) {
+          PPM_ASSIGN(dest[x], to_val(row[0]), to_val(row[1]), to_val(row[2]));
+          row += 3;
+        } else {
+          xelval gray = to_val(*row++);
+          PPM_ASSIGN(dest[x], gray, gray, gray);
+        }
+        if (alpha != NULL) {
+          alpha[x] = to_val(*row++);
+        }
+      }
+    }
+    break;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: PNMImage::copy_sub_image
 //       Access: Published
@@ -887,7 +1170,22 @@ copy_sub_image(const PNMImage &copy, int xto, int yto,
   setup_sub_image(copy, xto, yto, xfrom, yfrom, x_size, y_size,
                   xmin, ymin, xmax, ymax);
 
-  if (get_maxval() == copy.get_maxval()) {
+  if (_storage_type != ST_integer && _storage_type == copy._storage_type &&
+      _num_channels == copy._num_channels) {
+    // The simplest case: the values can be copied a row at a time.
+    if (xmin < xmax) {
+      size_t pixel_size = get_float_value_size() * _num_channels;
+      char *data = get_float_data();
+      const char *copy_data = copy.get_float_data();
+      for (int y = ymin; y < ymax; y++) {
+        memcpy(data + ((size_t)y * _x_size + xmin) * pixel_size,
+               copy_data + ((size_t)(y - ymin + yfrom) * copy._x_size + xfrom) * pixel_size,
+               (xmax - xmin) * pixel_size);
+      }
+    }
+
+  } else if (_storage_type == ST_integer && copy._storage_type == ST_integer &&
+             get_maxval() == copy.get_maxval()) {
     // The simple case: no pixel value rescaling is required.
     int x, y;
     for (y = ymin; y < ymax; y++) {
@@ -905,7 +1203,8 @@ copy_sub_image(const PNMImage &copy, int xto, int yto,
     }
 
   } else {
-    // The harder case: rescale pixel values according to maxval.
+    // The harder case: rescale pixel values according to maxval, or
+    // convert to or from floating-point values.
     int x, y;
     for (y = ymin; y < ymax; y++) {
       for (x = xmin; x < xmax; x++) {
@@ -990,7 +1289,7 @@ add_sub_image(const PNMImage &copy, int xto, int yto,
   if (has_alpha() && copy.has_alpha()) {
     for (y = ymin; y < ymax; y++) {
       for (x = xmin; x < xmax; x++) {
-        set_alpha(x, y, get_alpha(x, y) + copy.get_alpha(x, y) * pixel_scale);
+        set_alpha(x, y, get_alpha(x, y) + copy.get_alpha(x - xmin + xfrom, y - ymin + yfrom) * pixel_scale);
       }
     }
   }
@@ -998,7 +1297,7 @@ add_sub_image(const PNMImage &copy, int xto, int yto,
   for (y = ymin; y < ymax; y++) {
     for (x = xmin; x < xmax; x++) {
       LRGBColord rgb1 = get_xel(x, y);
-      LRGBColord rgb2 = copy.get_xel(x, y);
+      LRGBColord rgb2 = copy.get_xel(x - xmin + xfrom, y - ymin + yfrom);
       set_xel(x, y, 
               rgb1[0] + rgb2[0] * pixel_scale,
               rgb1[1] + rgb2[1] * pixel_scale,
@@ -1028,7 +1327,7 @@ mult_sub_image(const PNMImage &copy, int xto, int yto,
   if (has_alpha() && copy.has_alpha()) {
     for (y = ymin; y < ymax; y++) {
       for (x = xmin; x < xmax; x++) {
-        set_alpha(x, y, get_alpha(x, y) * copy.get_alpha(x, y) * pixel_scale);
+        set_alpha(x, y, get_alpha(x, y) * copy.get_alpha(x - xmin + xfrom, y - ymin + yfrom) * pixel_scale);
       }
     }
   }
@@ -1036,7 +1335,7 @@ mult_sub_image(const PNMImage &copy, int xto, int yto,
   for (y = ymin; y < ymax; y++) {
     for (x = xmin; x < xmax; x++) {
       LRGBColord rgb1 = get_xel(x, y);
-      LRGBColord rgb2 = copy.get_xel(x, y);
+      LRGBColord rgb2 = copy.get_xel(x - xmin + xfrom, y - ymin + yfrom);
       set_xel(x, y, 
               rgb1[0] * rgb2[0] * pixel_scale,
               rgb1[1] * rgb2[1] * pixel_scale,
@@ -1067,7 +1366,8 @@ darken_sub_image(const PNMImage &copy, int xto, int yto,
   setup_sub_image(copy, xto, yto, xfrom, yfrom, x_size, y_size,
                   xmin, ymin, xmax, ymax);
 
-  if (get_maxval() == copy.get_maxval() && pixel_scale == 1.0) {
+  if (_storage_type == ST_integer && copy._storage_type == ST_integer &&
+      get_maxval() == copy.get_maxval() && pixel_scale == 1.0) {
     // The simple case: no pixel value rescaling is required.
     int x, y;
     for (y = ymin; y < ymax; y++) {
@@ -1137,7 +1437,8 @@ lighten_sub_image(const PNMImage &copy, int xto, int yto,
   setup_sub_image(copy, xto, yto, xfrom, yfrom, x_size, y_size,
                   xmin, ymin, xmax, ymax);
 
-  if (get_maxval() == copy.get_maxval() && pixel_scale == 1.0) {
+  if (_storage_type == ST_integer && copy._storage_type == ST_integer &&
+      get_maxval() == copy.get_maxval() && pixel_scale == 1.0) {
     // The simple case: no pixel value rescaling is required.
     int x, y;
     for (y = ymin; y < ymax; y++) {
@@ -1313,7 +1614,9 @@ threshold(const PNMImage &select_image, int channel, double threshold,
     nassertv(get_x_size() <= lt.get_x_size() && get_y_size() <= lt.get_y_size());
     nassertv(get_x_size() <= ge.get_x_size() && get_y_size() <= ge.get_y_size());
 
-    if (get_maxval() == lt.get_maxval() && get_maxval() == ge.get_maxval()) {
+    if (_storage_type == ST_integer && lt._storage_type == ST_integer &&
+        ge._storage_type == ST_integer &&
+        get_maxval() == lt.get_maxval() && get_maxval() == ge.get_maxval()) {
       // Simple case: the maxvals are all equal.  Copy by integer value.
       int x, y;
 
@@ -1548,7 +1851,8 @@ copy_channel(const PNMImage &copy, int xto, int yto, int cto,
   setup_sub_image(copy, xto, yto, xfrom, yfrom, x_size, y_size,
                   xmin, ymin, xmax, ymax);
 
-  if (get_maxval() == copy.get_maxval()) {
+  if (_storage_type == ST_integer && copy._storage_type == ST_integer &&
+      get_maxval() == copy.get_maxval()) {
     // The simple case: no pixel value rescaling is required.
     int x, y;
     for (y = ymin; y < ymax; y++) {
@@ -1685,9 +1989,11 @@ render_spot(const LColord &fg, const LColord &bg,
 void PNMImage::
 expand_border(int left, int right, int bottom, int top,
               const LColord &color) {
-  PNMImage new_image(get_x_size() + left + right,
-                     get_y_size() + bottom + top,
-                     get_num_channels(), get_maxval(), get_type());
+  PNMImage new_image;
+  new_image.set_storage_type(_storage_type);
+  new_image.clear(get_x_size() + left + right,
+                  get_y_size() + bottom + top,
+                  get_num_channels(), get_maxval(), get_type());
   new_image.fill(color[0], color[1], color[2]);
   if (has_alpha()) {
     new_image.alpha_fill(color[3]);
@@ -1732,6 +2038,13 @@ unfiltered_stretch_from(const PNMImage &copy) {
 ////////////////////////////////////////////////////////////////////
 void PNMImage::
 make_histogram(PNMImage::Histogram &histogram) {
+  if (_storage_type != ST_integer) {
+    PNMImage copy(*this);
+    copy.set_storage_type(ST_integer);
+    copy.make_histogram(histogram);
+    return;
+  }
+
   HistMap hist_map;
   PixelCount pixels;
 
@@ -1929,6 +2242,119 @@ setup_rc() {
   }
 }
 
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImage::allocate_float_array
+//       Access: Private
+//  Description: Allocates the internal memory for the pixels of a
+//               floating-point image, including alpha.
+////////////////////////////////////////////////////////////////////
+void PNMImage::
+allocate_float_array() {
+  size_t num_values = (size_t)_x_size * _y_size * _num_channels;
+  if (_storage_type == ST_float32) {
+    _float_array = (PN_float32 *)PANDA_MALLOC_ARRAY(num_values * sizeof(PN_float32));
+  } else {
+    _half_array = (PN_uint16 *)PANDA_MALLOC_ARRAY(num_values * sizeof(PN_uint16));
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImage::get_compatible
+//       Access: Private
+//  Description: Returns the other image, if its pixel values are
+//               stored in the same layout as this image's, so that
+//               the arithmetic operators may combine the two arrays
+//               value by value.  Otherwise, converts a copy of the
+//               other image into temp, and returns temp.
+////////////////////////////////////////////////////////////////////
+const PNMImage &PNMImage::
+get_compatible(const PNMImage &other, PNMImage &temp) const {
+  if (_storage_type == ST_integer) {
+    if (other._storage_type == ST_integer) {
+      return other;
+    }
+    temp = other;
+    temp.set_storage_type(ST_integer);
+    return temp;
+  }
+
+  if (other._storage_type != ST_integer &&
+      other._num_channels == _num_channels) {
+    return other;
+  }
+  temp = other;
+  temp.set_storage_type(ST_float32);
+  temp.set_num_channels(_num_channels);
+  return temp;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImage::fill_float
+//       Access: Private
+//  Description: Implements fill() for a floating-point image.
+////////////////////////////////////////////////////////////////////
+void PNMImage::
+fill_float(double red, double green, double blue) {
+  for (int y = 0; y < _y_size; y++) {
+    for (int x = 0; x < _x_size; x++) {
+      set_xel(x, y, red, green, blue);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImage::alpha_fill_float
+//       Access: Private
+//  Description: Implements alpha_fill() for a floating-point image.
+////////////////////////////////////////////////////////////////////
+void PNMImage::
+alpha_fill_float(double alpha) {
+  if (is_valid()) {
+    if (!has_alpha()) {
+      add_alpha();
+    }
+
+    for (int y = 0; y < _y_size; y++) {
+      for (int x = 0; x < _x_size; x++) {
+        set_alpha(x, y, alpha);
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMImage::convert_float_channels
+//       Access: Private
+//  Description: Changes the number of channels of a floating-point
+//               image, which stores only the channels it has, and so
+//               must be reallocated.  If the image becomes grayscale,
+//               the gray level is computed with the indicated
+//               weights.  A new alpha channel is initialized to zero.
+////////////////////////////////////////////////////////////////////
+void PNMImage::
+convert_float_channels(int num_channels, double rc, double gc, double bc) {
+  PNMImage result;
+  result._storage_type = _storage_type;
+  result.clear(_x_size, _y_size, num_channels, _maxval, _type);
+  result._comment = _comment;
+
+  bool copy_alpha = (has_alpha() && result.has_alpha());
+  for (int y = 0; y < _y_size; y++) {
+    for (int x = 0; x < _x_size; x++) {
+      if (result.is_grayscale()) {
+        result.set_gray(x, y, get_bright(x, y, rc, gc, bc));
+      } else {
+        result.set_xel(x, y, get_xel(x, y));
+      }
+      if (copy_alpha) {
+        result.set_alpha(x, y, get_alpha(x, y));
+      }
+    }
+  }
+
+  take_from(result);
+}
+
 ////////////////////////////////////////////////////////////////////
 //     Function: PNMImage::do_fill_distance
 //       Access: Private
@@ -2035,6 +2461,14 @@ operator ~ () const {
   PNMImage target (*this);
   size_t array_size = _x_size * _y_size;
 
+  if (_storage_type != ST_integer) {
+    size_t num_values = array_size * _num_channels;
+    for (size_t i = 0; i < num_values; ++i) {
+      target.set_float_value(i, 1.0 - get_float_value(i));
+    }
+    return target;
+  }
+
   if (_array != NULL && _alpha != NULL) {
     for (size_t i = 0; i < array_size; ++i) {
       target._array[i].r = _maxval - _array[i].r;
@@ -2066,9 +2500,30 @@ operator ~ () const {
 void PNMImage::
 operator += (const PNMImage &other) {
   nassertv(_x_size == other._x_size && _y_size == other._y_size);
-  nassertv(_maxval == other._maxval && _maxval == other._maxval);
+  PNMImage temp;
+  const PNMImage &source = get_compatible(other, temp);
+  if (&source != &other) {
+    (*this) += source;
+    return;
+  }
   size_t array_size = _x_size * _y_size;
 
+  if (_storage_type != ST_integer) {
+    size_t num_values = array_size * _num_channels;
+    if (_storage_type == ST_float32 && other._storage_type == ST_float32) {
+      for (size_t i = 0; i < num_values; ++i) {
+        _float_array[i] += other._float_array[i];
+      }
+    } else {
+      for (size_t i = 0; i < num_values; ++i) {
+        set_float_value(i, get_float_value(i) + other.get_float_value(i));
+      }
+    }
+    return;
+  }
+
+  nassertv(_maxval == other._maxval && _maxval == other._maxval);
+
   if (_array != NULL && _alpha != NULL) {
     for (size_t i = 0; i < array_size; ++i) {
       _array[i].r = clamp_val(_array[i].r + other._array[i].r);
@@ -2097,6 +2552,27 @@ operator += (const PNMImage &other) {
 void PNMImage::
 operator += (const LColord &other) {
   size_t array_size = _x_size * _y_size;
+
+  if (_storage_type != ST_integer) {
+    const int *component = float_color_components[_num_channels - 1];
+    PN_float32 factor[4];
+    for (int c = 0; c < _num_channels; ++c) {
+      factor[c] = (PN_float32)other[component[c]];
+    }
+    size_t i = 0;
+    for (size_t p = 0; p < array_size; ++p) {
+      for (int c = 0; c < _num_channels; ++c) {
+        if (_storage_type == ST_float32) {
+          _float_array[i] += factor[c];
+        } else {
+          set_float_value(i, get_float_value(i) + factor[c]);
+        }
+        ++i;
+      }
+    }
+    return;
+  }
+
   // Note: don't use to_val here because it clamps values below 0
   int add_r = (int)(other.get_x() * get_maxval() + 0.5);
   int add_g = (int)(other.get_y() * get_maxval() + 0.5);
@@ -2133,9 +2609,30 @@ operator += (const LColord &other) {
 void PNMImage::
 operator -= (const PNMImage &other) {
   nassertv(_x_size == other._x_size && _y_size == other._y_size);
-  nassertv(_maxval == other._maxval && _maxval == other._maxval);
+  PNMImage temp;
+  const PNMImage &source = get_compatible(other, temp);
+  if (&source != &other) {
+    (*this) -= source;
+    return;
+  }
   size_t array_size = _x_size * _y_size;
 
+  if (_storage_type != ST_integer) {
+    size_t num_values = array_size * _num_channels;
+    if (_storage_type == ST_float32 && other._storage_type == ST_float32) {
+      for (size_t i = 0; i < num_values; ++i) {
+        _float_array[i] -= other._float_array[i];
+      }
+    } else {
+      for (size_t i = 0; i < num_values; ++i) {
+        set_float_value(i, get_float_value(i) - other.get_float_value(i));
+      }
+    }
+    return;
+  }
+
+  nassertv(_maxval == other._maxval && _maxval == other._maxval);
+
   if (_array != NULL && _alpha != NULL) {
     for (size_t i = 0; i < array_size; ++i) {
       _array[i].r = clamp_val(_array[i].r - other._array[i].r);
@@ -2179,8 +2676,28 @@ operator -= (const LColord &other) {
 void PNMImage::
 operator *= (const PNMImage &other) {
   nassertv(_x_size == other._x_size && _y_size == other._y_size);
+  PNMImage temp;
+  const PNMImage &source = get_compatible(other, temp);
+  if (&source != &other) {
+    (*this) *= source;
+    return;
+  }
   size_t array_size = _x_size * _y_size;
 
+  if (_storage_type != ST_integer) {
+    size_t num_values = array_size * _num_channels;
+    if (_storage_type == ST_float32 && other._storage_type == ST_float32) {
+      for (size_t i = 0; i < num_values; ++i) {
+        _float_array[i] *= other._float_array[i];
+      }
+    } else {
+      for (size_t i = 0; i < num_values; ++i) {
+        set_float_value(i, get_float_value(i) * other.get_float_value(i));
+      }
+    }
+    return;
+  }
+
   if (_array != NULL && _alpha != NULL) {
     for (size_t i = 0; i < array_size; ++i) {
       _array[i].r = to_val(from_val(_array[i].r) * other.from_val(other._array[i].r));
@@ -2211,6 +2728,21 @@ void PNMImage::
 operator *= (double multiplier) {
   size_t array_size = _x_size * _y_size;
 
+  if (_storage_type != ST_integer) {
+    size_t num_values = array_size * _num_channels;
+    if (_storage_type == ST_float32) {
+      PN_float32 factor = (PN_float32)multiplier;
+      for (size_t i = 0; i < num_values; ++i) {
+        _float_array[i] *= factor;
+      }
+    } else {
+      for (size_t i = 0; i < num_values; ++i) {
+        set_float_value(i, get_float_value(i) * multiplier);
+      }
+    }
+    return;
+  }
+
   if (_array != NULL && _alpha != NULL) {
     for (size_t i = 0; i < array_size; ++i) {
       _array[i].r = clamp_val(_array[i].r * multiplier);
@@ -2241,6 +2773,26 @@ void PNMImage::
 operator *= (const LColord &other) {
   size_t array_size = _x_size * _y_size;
 
+  if (_storage_type != ST_integer) {
+    const int *component = float_color_components[_num_channels - 1];
+    PN_float32 factor[4];
+    for (int c = 0; c < _num_channels; ++c) {
+      factor[c] = (PN_float32)other[component[c]];
+    }
+    size_t i = 0;
+    for (size_t p = 0; p < array_size; ++p) {
+      for (int c = 0; c < _num_channels; ++c) {
+        if (_storage_type == ST_float32) {
+          _float_array[i] *= factor[c];
+        } else {
+          set_float_value(i, get_float_value(i) * factor[c]);
+        }
+        ++i;
+      }
+    }
+    return;
+  }
+
   if (_array != NULL && _alpha != NULL) {
     for (size_t i = 0; i < array_size; ++i) {
       _array[i].r = clamp_val(_array[i].r * other[0]);
@@ -53,9 +53,22 @@ class StackedPerlinNoise2;
 //
 //               Files can be specified by filename, or by an iostream
 //               pointer.  The filename "-" refers to stdin or stdout.
+//
+//               Normally the xels are stored as integers in the range
+//               0..maxval, but see set_storage_type(): the image may
+//               instead hold linear 32-bit or 16-bit floating-point
+//               values, in which case the double-precision accessors
+//               and the image operations work on those values
+//               directly, without rounding them to maxval each time.
 ////////////////////////////////////////////////////////////////////
 class EXPCL_PANDA_PNMIMAGE PNMImage : public PNMImageHeader {
 PUBLISHED:
+  enum StorageType {
+    ST_integer,     // xels of xelvals, in the range 0..maxval
+    ST_float32,     // 32-bit floats, in the nominal range 0..1
+    ST_float16,     // 16-bit "half" floats, in the nominal range 0..1
+  };
+
   INLINE PNMImage();
   PNMImage(const Filename &filename, PNMFileType *type = NULL);
   INLINE PNMImage(int x_size, int y_size, int num_channels = 3,
@@ -107,6 +120,9 @@ PUBLISHED:
 
   INLINE bool is_valid() const;
 
+  void set_storage_type(StorageType storage_type);
+  INLINE StorageType get_storage_type() const;
+
   INLINE void set_num_channels(int num_channels);
   void set_color_type(ColorType color_type);
 
@@ -124,9 +140,10 @@ PUBLISHED:
   // The *_val() functions return or set the color values in the range
   // [0..get_maxval()].  This range may be different for different
   // images!  Use the corresponding functions (without _val()) to work
-  // in the normalized range [0..1].
+  // in the normalized range [0..1].  In a floating-point image, these
+  // convert to and from the stored values.
 
-  INLINE const xel &get_xel_val(int x, int y) const;
+  INLINE xel get_xel_val(int x, int y) const;
   INLINE void set_xel_val(int x, int y, const xel &value);
   INLINE void set_xel_val(int x, int y, xelval r, xelval g, xelval b);
   INLINE void set_xel_val(int x, int y, xelval gray);
@@ -151,7 +168,8 @@ PUBLISHED:
 
   // The corresponding get_xel(), set_xel(), get_red(), etc. functions
   // automatically scale their values by get_maxval() into the range
-  // [0..1].
+  // [0..1].  In a floating-point image, they read and write the stored
+  // values directly, and the values are not clamped to [0..1].
 
   INLINE LRGBColord get_xel(int x, int y) const;
   INLINE void set_xel(int x, int y, const LRGBColord &value);
@@ -277,9 +295,38 @@ public:
   void set_array(xel *array);
   void set_alpha_array(xelval *alpha);
 
+  // These access the image a row at a time, as get_num_channels()
+  // floats per pixel: gray or red, green, blue, followed by alpha if
+  // the image has it.  They work for any storage type, but copy the
+  // data directly when it is ST_float32.
+  void get_float_row(int y, PN_float32 *row) const;
+  void set_float_row(int y, const PN_float32 *row);
+
+  INLINE PN_float32 *get_float_array();
+  INLINE const PN_float32 *get_float_array() const;
+  INLINE PN_uint16 *get_half_array();
+  INLINE const PN_uint16 *get_half_array() const;
+
+  INLINE static PN_uint16 float_to_half(PN_float32 value);
+  INLINE static PN_float32 half_to_float(PN_uint16 value);
+
 private:
   INLINE void allocate_array();
   INLINE void allocate_alpha();
+  void allocate_float_array();
+
+  INLINE int get_color_component(int c) const;
+  INLINE int get_alpha_component() const;
+  INLINE size_t get_float_value_size() const;
+  INLINE char *get_float_data() const;
+  INLINE double get_float_value(size_t index) const;
+  INLINE void set_float_value(size_t index, double value);
+  INLINE double get_float_channel(int x, int y, int component) const;
+  INLINE void set_float_channel(int x, int y, int component, double value);
+  const PNMImage &get_compatible(const PNMImage &other, PNMImage &temp) const;
+  void fill_float(double red, double green, double blue);
+  void alpha_fill_float(double alpha);
+  void convert_float_channels(int num_channels, double rc, double gc, double bc);
 
   INLINE xel *row(int row) const;
   INLINE xelval *alpha_row(int row) const;
@@ -313,8 +360,14 @@ PUBLISHED:
   void operator *= (const LColord &other);
 
 private:
+  StorageType _storage_type;
   xel *_array;
   xelval *_alpha;
+
+  // Used instead of _array and _alpha when _storage_type is not
+  // ST_integer, with get_num_channels() values per pixel.
+  PN_float32 *_float_array;
+  PN_uint16 *_half_array;
   double _default_rc, _default_gc, _default_bc;
 
   int _read_x_size, _read_y_size;
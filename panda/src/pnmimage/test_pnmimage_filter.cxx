@@ -0,0 +1,190 @@
+// Filename: test_pnmimage_filter.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "pnmImage.h"
+#include "config_pnmimage.h"
+#include "trueClock.h"
+
+#include <stdlib.h>
+
+// This program times the PNMImage filters--quick_filter_from() to
+// resize an image, and box_filter_from() and gaussian_filter_from() to
+// resize and to blur one--on synthetic RGBA images of several sizes,
+// using one thread and then more, up to the indicated number.  It
+// checks that every thread count produces exactly the same image.
+//
+// Usage: test_pnmimage_filter [max_threads [size ...]]
+
+static unsigned int rand_state = 12345;
+
+static unsigned int
+next_rand() {
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 17;
+  rand_state ^= rand_state << 5;
+  return rand_state;
+}
+
+// Fills the image with smooth gradients plus a little noise, so that
+// the filters have something to do.
+static void
+make_image(PNMImage &image, int size) {
+  image.clear(size, size, 4);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      double noise = (next_rand() >> 24) / 1024.0;
+      image.set_xel_a(x, y, (double)x / size * 0.75 + noise,
+                      (double)y / size * 0.75 + noise,
+                      (double)((x ^ y) & 0xff) / 340.0 + noise,
+                      1.0 - (double)(x + y) / (size * 2));
+    }
+  }
+}
+
+static bool
+same_image(const PNMImage &a, const PNMImage &b) {
+  if (a.get_x_size() != b.get_x_size() || a.get_y_size() != b.get_y_size()) {
+    return false;
+  }
+  for (int y = 0; y < a.get_y_size(); ++y) {
+    for (int x = 0; x < a.get_x_size(); ++x) {
+      if (!PPM_EQUAL(a.get_xel_val(x, y), b.get_xel_val(x, y)) ||
+          a.get_alpha_val(x, y) != b.get_alpha_val(x, y)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+enum Operation {
+  O_quick_reduce,
+  O_quick_enlarge,
+  O_box_reduce,
+  O_gaussian_reduce,
+  O_gaussian_enlarge,
+  O_box_blur,
+  O_gaussian_blur,
+  O_num_operations,
+};
+
+static const char *const operation_names[O_num_operations] = {
+  "quick_filter 1/2",
+  "quick_filter x2",
+  "box_filter 1/2",
+  "gaussian_filter 1/2",
+  "gaussian_filter x2",
+  "box_filter blur 4",
+  "gaussian_filter blur 4",
+};
+
+static void
+perform(Operation op, PNMImage &dest, const PNMImage &source) {
+  int size = source.get_x_size();
+  switch (op) {
+  case O_quick_reduce:
+    dest.clear(size / 2, size / 2, 4);
+    dest.quick_filter_from(source);
+    break;
+
+  case O_quick_enlarge:
+    dest.clear(size * 2, size * 2, 4);
+    dest.quick_filter_from(source);
+    break;
+
+  case O_box_reduce:
+    dest.clear(size / 2, size / 2, 4);
+    dest.box_filter_from(1.0, source);
+    break;
+
+  case O_gaussian_reduce:
+    dest.clear(size / 2, size / 2, 4);
+    dest.gaussian_filter_from(1.0, source);
+    break;
+
+  case O_gaussian_enlarge:
+    dest.clear(size * 2, size * 2, 4);
+    dest.gaussian_filter_from(1.0, source);
+    break;
+
+  case O_box_blur:
+    dest = source;
+    dest.box_filter(4.0);
+    break;
+
+  case O_gaussian_blur:
+    dest = source;
+    dest.gaussian_filter(4.0);
+    break;
+
+  default:
+    break;
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  int max_threads = 4;
+  if (argc > 1) {
+    max_threads = atoi(argv[1]);
+  }
+  pvector<int> sizes;
+  for (int i = 2; i < argc; ++i) {
+    sizes.push_back(atoi(argv[i]));
+  }
+  if (sizes.empty()) {
+    sizes.push_back(256);
+    sizes.push_back(1024);
+    sizes.push_back(2048);
+  }
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  bool ok = true;
+
+  for (size_t si = 0; si < sizes.size(); ++si) {
+    PNMImage source;
+    make_image(source, sizes[si]);
+
+    for (int op = 0; op < O_num_operations; ++op) {
+      PNMImage reference;
+      cerr << sizes[si] << "x" << sizes[si] << " "
+           << operation_names[op] << ":";
+
+      for (int threads = 1; threads <= max_threads; threads *= 2) {
+        pnmimage_filter_threads.set_value(threads);
+
+        PNMImage dest;
+        double start = clock->get_short_time();
+        perform((Operation)op, dest, source);
+        double elapsed = clock->get_short_time() - start;
+        cerr << "  " << threads << "t " << elapsed * 1000.0 << " ms";
+
+        if (threads == 1) {
+          reference = dest;
+        } else if (!same_image(reference, dest)) {
+          cerr << " (differs!)";
+          ok = false;
+        }
+      }
+      cerr << "\n";
+    }
+  }
+
+  if (!ok) {
+    cerr << "Filter results depend on the number of threads!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,329 @@
+// Filename: test_pnmimage_storage.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "pnmImage.h"
+#include "trueClock.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+// This program checks the floating-point storage types of PNMImage
+// against the integer storage: that the half-float conversions are
+// exact and correctly rounded, that images survive the conversions
+// between storage types, and that the filters, blends, and other
+// operations produce the same images within rounding.  Then it times
+// each of those operations on a synthetic RGBA image with each
+// storage type.
+//
+// Usage: test_pnmimage_storage [size]
+
+static unsigned int rand_state = 12345;
+
+static unsigned int
+next_rand() {
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 17;
+  rand_state ^= rand_state << 5;
+  return rand_state;
+}
+
+static const char *const storage_names[3] = {
+  "integer",
+  "float32",
+  "float16",
+};
+
+// Fills the image with smooth gradients plus a little noise.
+static void
+make_image(PNMImage &image, int size, PNMImage::StorageType storage_type) {
+  image.clear();
+  image.set_storage_type(storage_type);
+  image.clear(size, size, 4);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      double noise = (next_rand() >> 24) / 1024.0;
+      image.set_xel_a(x, y, (double)x / size * 0.75 + noise,
+                      (double)y / size * 0.75 + noise,
+                      (double)((x ^ y) & 0xff) / 340.0 + noise,
+                      1.0 - (double)(x + y) / (size * 2));
+    }
+  }
+}
+
+// Returns the largest difference between the component values of the
+// two images, after converting both to integers.
+static int
+max_difference(const PNMImage &a, const PNMImage &b) {
+  if (a.get_x_size() != b.get_x_size() || a.get_y_size() != b.get_y_size() ||
+      a.get_num_channels() != b.get_num_channels()) {
+    return 65536;
+  }
+  PNMImage ia(a), ib(b);
+  ia.set_storage_type(PNMImage::ST_integer);
+  ib.set_storage_type(PNMImage::ST_integer);
+
+  int result = 0;
+  for (int y = 0; y < ia.get_y_size(); ++y) {
+    for (int x = 0; x < ia.get_x_size(); ++x) {
+      for (int c = 0; c < ia.get_num_channels(); ++c) {
+        result = max(result, abs((int)ia.get_channel_val(x, y, c) -
+                                 (int)ib.get_channel_val(x, y, c)));
+      }
+    }
+  }
+  return result;
+}
+
+static bool
+test_half() {
+  bool ok = true;
+
+  // Every half value must survive the round trip.
+  for (int h = 0; h < 0x10000; ++h) {
+    PN_float32 f = PNMImage::half_to_float((PN_uint16)h);
+    PN_uint16 back = PNMImage::float_to_half(f);
+    if (f != f) {
+      ok = ok && ((back & 0x7c00) == 0x7c00 && (back & 0x3ff) != 0);
+    } else if (back != h) {
+      cerr << "half " << hex << h << " came back as " << back << dec << "\n";
+      ok = false;
+    }
+  }
+
+  // The value halfway between two adjacent halves must round to the
+  // even one, and anything beyond the halfway point to the nearer.
+  for (int h = 0; h < 0x7bff; ++h) {
+    double a = PNMImage::half_to_float((PN_uint16)h);
+    double b = PNMImage::half_to_float((PN_uint16)(h + 1));
+    PN_uint16 even = (h & 1) ? (PN_uint16)(h + 1) : (PN_uint16)h;
+    if (PNMImage::float_to_half((PN_float32)((a + b) / 2.0)) != even ||
+        PNMImage::float_to_half((PN_float32)(a + (b - a) * 0.25)) != h ||
+        PNMImage::float_to_half((PN_float32)(a + (b - a) * 0.75)) != h + 1) {
+      cerr << "half " << hex << h << dec << " rounds incorrectly\n";
+      ok = false;
+    }
+  }
+
+  ok = ok && (PNMImage::float_to_half(65520.0f) == 0x7c00);
+  ok = ok && (PNMImage::float_to_half(-1.0e10f) == 0xfc00);
+  ok = ok && (PNMImage::float_to_half(1.0e-10f) == 0);
+
+  if (!ok) {
+    cerr << "Half-float conversion failed!\n";
+  }
+  return ok;
+}
+
+static bool
+test_conversions(int size) {
+  bool ok = true;
+
+  PNMImage orig;
+  make_image(orig, size, PNMImage::ST_integer);
+  for (int st = PNMImage::ST_float32; st <= PNMImage::ST_float16; ++st) {
+    PNMImage image(orig);
+    image.set_storage_type((PNMImage::StorageType)st);
+    if (max_difference(orig, image) != 0) {
+      cerr << storage_names[st] << " conversion is not exact\n";
+      ok = false;
+    }
+  }
+
+  // Floating-point values are not clamped until they become integers.
+  PNMImage image(2, 1, 4);
+  image.set_storage_type(PNMImage::ST_float32);
+  image.set_xel_a(0, 0, 1.5, -0.25, 0.5, 2.0);
+  image *= 0.5;
+  if (image.get_xel_a(0, 0) != LColord(0.75, -0.125, 0.25, 1.0)) {
+    cerr << "float32 values were clamped: " << image.get_xel_a(0, 0) << "\n";
+    ok = false;
+  }
+  image.set_storage_type(PNMImage::ST_integer);
+  if (image.get_red_val(0, 0) != 191 || image.get_green_val(0, 0) != 0) {
+    cerr << "float32 values were not clamped to integers\n";
+    ok = false;
+  }
+
+  // Rearranging the pixels, and changing the channels.
+  PNMImage flipped(orig);
+  flipped.flip(true, false, true);
+  flipped.make_grayscale();
+  for (int st = PNMImage::ST_float32; st <= PNMImage::ST_float16; ++st) {
+    PNMImage image(orig);
+    image.set_storage_type((PNMImage::StorageType)st);
+    image.flip(true, false, true);
+    image.make_grayscale();
+    if (max_difference(flipped, image) > 1) {
+      cerr << storage_names[st] << " flip and make_grayscale differ\n";
+      ok = false;
+    }
+  }
+
+  if (!ok) {
+    cerr << "Storage conversion failed!\n";
+  }
+  return ok;
+}
+
+enum Operation {
+  O_get_set,
+  O_rows,
+  O_box_blur,
+  O_gaussian_reduce,
+  O_quick_reduce,
+  O_blend_sub_image,
+  O_add_sub_image,
+  O_arithmetic,
+  O_num_operations,
+};
+
+static const char *const operation_names[O_num_operations] = {
+  "get/set_xel_a",
+  "get/set_float_row",
+  "box_filter blur 2",
+  "gaussian_filter 1/2",
+  "quick_filter 1/2",
+  "blend_sub_image",
+  "add_sub_image",
+  "+= and *=",
+};
+
+// The largest difference allowed from the result on the integer
+// image, which rounds after each step.  Even the source images may
+// differ by one, where a value falls just about halfway between two
+// integers.
+static const int tolerance[O_num_operations] = {
+  1, 1, 1, 1, 1, 1, 1, 2,
+};
+
+static void
+perform(Operation op, PNMImage &dest, const PNMImage &source,
+        const PNMImage &overlay) {
+  int size = source.get_x_size();
+  switch (op) {
+  case O_get_set:
+    dest = source;
+    for (int y = 0; y < size; ++y) {
+      for (int x = 0; x < size; ++x) {
+        LColord c = dest.get_xel_a(x, y);
+        dest.set_xel_a(x, y, c[2], c[1], c[0], c[3]);
+      }
+    }
+    break;
+
+  case O_rows:
+    {
+      dest = source;
+      pvector<PN_float32> row(size * 4);
+      for (int y = 0; y < size; ++y) {
+        dest.get_float_row(y, &row[0]);
+        for (int x = 0; x < size; ++x) {
+          swap(row[x * 4], row[x * 4 + 2]);
+        }
+        dest.set_float_row(y, &row[0]);
+      }
+    }
+    break;
+
+  case O_box_blur:
+    dest = source;
+    dest.box_filter(2.0);
+    break;
+
+  case O_gaussian_reduce:
+    dest.clear();
+    dest.set_storage_type(source.get_storage_type());
+    dest.clear(size / 2, size / 2, 4);
+    dest.gaussian_filter_from(1.0, source);
+    break;
+
+  case O_quick_reduce:
+    dest.clear();
+    dest.set_storage_type(source.get_storage_type());
+    dest.clear(size / 2, size / 2, 4);
+    dest.quick_filter_from(source);
+    break;
+
+  case O_blend_sub_image:
+    dest = source;
+    dest.blend_sub_image(overlay, size / 4, size / 4);
+    break;
+
+  case O_add_sub_image:
+    dest = source;
+    dest.add_sub_image(overlay, size / 4, size / 4, 0, 0, -1, -1, 0.25);
+    break;
+
+  case O_arithmetic:
+    dest = source;
+    dest *= 0.5;
+    dest += dest;
+    dest *= LColord(0.5, 0.75, 1.0, 1.0);
+    break;
+
+  default:
+    break;
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  int size = 1024;
+  if (argc > 1) {
+    size = atoi(argv[1]);
+  }
+
+  bool ok = test_half();
+  ok = test_conversions(64) && ok;
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+
+  PNMImage sources[3], overlays[3];
+  for (int st = 0; st < 3; ++st) {
+    // Each storage type gets the same pixels.
+    rand_state = 12345;
+    make_image(sources[st], size, (PNMImage::StorageType)st);
+    make_image(overlays[st], size / 2, (PNMImage::StorageType)st);
+  }
+
+  for (int op = 0; op < O_num_operations; ++op) {
+    cerr << size << "x" << size << " " << operation_names[op] << ":";
+    PNMImage reference;
+    for (int st = 0; st < 3; ++st) {
+      PNMImage dest;
+      double start = clock->get_short_time();
+      perform((Operation)op, dest, sources[st], overlays[st]);
+      double elapsed = clock->get_short_time() - start;
+      cerr << "  " << storage_names[st] << " " << elapsed * 1000.0 << " ms";
+
+      if (st == PNMImage::ST_integer) {
+        reference = dest;
+      } else {
+        int diff = max_difference(reference, dest);
+        if (diff > tolerance[op]) {
+          cerr << " (differs by " << diff << "!)";
+          ok = false;
+        }
+      }
+    }
+    cerr << "\n";
+  }
+
+  if (!ok) {
+    cerr << "Floating-point storage test failed!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -41,3 +41,15 @@
 
 #end lib_target
 
+
+#if $[HAVE_PNG]
+#begin test_bin_target
+  #define TARGET test_pnm_read_row
+  #define LOCAL_LIBS \
+    p3pnmimagetypes p3pnmimage
+
+  #define SOURCES \
+    test_pnm_read_row.cxx
+
+#end test_bin_target
+#endif
@@ -71,9 +71,12 @@ public:
 
     virtual void prepare_read();
     virtual int read_data(xel *array, xelval *alpha);
+    virtual bool supports_read_row() const;
+    virtual bool read_row(xel *array, xelval *alpha, int x_size, int y_size);
 
   private:
     struct jpeg_decompress_struct _cinfo;
+    JSAMPARRAY _buffer;
     struct my_error_mgr {
       struct jpeg_error_mgr pub;
       jmp_buf setjmp_buffer;
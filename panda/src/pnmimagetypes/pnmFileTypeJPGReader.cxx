@@ -256,6 +256,8 @@ PNMFileTypeJPG::Reader::
 Reader(PNMFileType *type, istream *file, bool owns_file, string magic_number) :
   PNMReader(type, file, owns_file)
 {
+  _buffer = NULL;
+
   // Hope we can putback() more than one character.
   for (string::reverse_iterator mi = magic_number.rbegin();
        mi != magic_number.rend();
@@ -366,75 +368,97 @@ read_data(xel *array, xelval *) {
   if (!_is_valid) {
     return 0;
   }
-  JSAMPARRAY buffer;            /* Output row buffer */
-  int row_stride;               /* physical row width in output buffer */
 
-  nassertr(_cinfo.output_components == 1 || _cinfo.output_components == 3, 0);
+  for (int y = 0; y < _y_size; ++y) {
+    if (!read_row(array + y * _x_size, NULL, _x_size, _y_size)) {
+      return y;
+    }
+    Thread::consider_yield();
+  }
 
-  /* We may need to do some setup of our own at this point before reading
-   * the data.  After jpeg_start_decompress() we have the correct scaled
-   * output image dimensions available, as well as the output colormap
-   * if we asked for color quantization.
-   * In this example, we need to make an output work buffer of the right size.
-   */
-  /* JSAMPLEs per row in output buffer */
-  row_stride = _cinfo.output_width * _cinfo.output_components;
-  /* Make a one-row-high sample array that will go away when done with image */
+  return _y_size;
+}
 
-  buffer = (*_cinfo.mem->alloc_sarray)
-                ((j_common_ptr) &_cinfo, JPOOL_IMAGE, row_stride, 1);
+////////////////////////////////////////////////////////////////////
+//     Function: PNMFileTypeJPG::Reader::supports_read_row
+//       Access: Public, Virtual
+//  Description: Returns true if this particular PNMReader is capable
+//               of returning the data one row at a time, via repeated
+//               calls to read_row().  Returns false if the only way
+//               to read from this file is all at once, via
+//               read_data().
+////////////////////////////////////////////////////////////////////
+bool PNMFileTypeJPG::Reader::
+supports_read_row() const {
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMFileTypeJPG::Reader::read_row
+//       Access: Public, Virtual
+//  Description: If supports_read_row(), above, returns true, this
+//               function may be called repeatedly to read the image,
+//               one horizontal row at a time, beginning from the top.
+//               Returns true if the row is successfully read, false
+//               if there is an error or end of file.
+//
+//               Since libjpeg scales the image itself, x_size is
+//               always the same as _x_size.
+////////////////////////////////////////////////////////////////////
+bool PNMFileTypeJPG::Reader::
+read_row(xel *array, xelval *, int, int) {
+  if (!_is_valid || _cinfo.output_scanline >= _cinfo.output_height) {
+    return false;
+  }
 
-  /* Step 6: while (scan lines remain to be read) */
-  /*           jpeg_read_scanlines(...); */
+  nassertr(_cinfo.output_components == 1 || _cinfo.output_components == 3, false);
 
-  /* Here we use the library's state variable cinfo.output_scanline as the
-   * loop counter, so that we don't have to keep track ourselves.
-   */
-  int x = 0;
-  while (_cinfo.output_scanline < _cinfo.output_height) {
-    /* jpeg_read_scanlines expects an array of pointers to scanlines.
-     * Here the array is only one element long, but you could ask for
-     * more than one scanline at a time if that's more convenient.
+  if (_buffer == NULL) {
+    /* We may need to do some setup of our own at this point before
+     * reading the data.  After jpeg_start_decompress() we have the
+     * correct scaled output image dimensions available, so we can
+     * make a one-row-high sample array that will go away when done
+     * with the image.
      */
-    jpeg_read_scanlines(&_cinfo, buffer, 1);
-    /* Assume put_scanline_someplace wants a pointer and sample count. */
-    //put_scanline_someplace(buffer[0], row_stride);
-    JSAMPROW bufptr = buffer[0];
-    for (int i = 0; i < row_stride; i += _cinfo.output_components) {
-      if (_cinfo.output_components == 1) {
-        xelval val = (xelval)bufptr[i];
-        nassertr(x < _x_size * _y_size, 0);
-        PNM_ASSIGN1(array[x], val);
-      } else {
-        xelval red, grn, blu;
-        red = (xelval)bufptr[i];
-        grn = (xelval)bufptr[i+1];
-        blu = (xelval)bufptr[i+2];
-        nassertr(x < _x_size * _y_size, 0);
-        PPM_ASSIGN(array[x], red, grn, blu);
-      }
-      x++;
-    }
-    Thread::consider_yield();
+    int row_stride = _cinfo.output_width * _cinfo.output_components;
+    _buffer = (*_cinfo.mem->alloc_sarray)
+      ((j_common_ptr) &_cinfo, JPOOL_IMAGE, row_stride, 1);
   }
 
-  /* Step 7: Finish decompression */
+  jpeg_read_scanlines(&_cinfo, _buffer, 1);
 
-  jpeg_finish_decompress(&_cinfo);
+  JSAMPROW bufptr = _buffer[0];
+  if (_cinfo.output_components == 1) {
+    for (int x = 0; x < _x_size; ++x) {
+      xelval val = (xelval)bufptr[x];
+      PNM_ASSIGN1(array[x], val);
+    }
+  } else {
+    for (int x = 0; x < _x_size; ++x) {
+      xelval red, grn, blu;
+      red = (xelval)bufptr[0];
+      grn = (xelval)bufptr[1];
+      blu = (xelval)bufptr[2];
+      PPM_ASSIGN(array[x], red, grn, blu);
+      bufptr += 3;
+    }
+  }
 
-  /* We can ignore the return value since suspension is not possible
-   * with the stdio data source.
-   */
+  if (_cinfo.output_scanline >= _cinfo.output_height) {
+    /* Finish decompression. */
+    jpeg_finish_decompress(&_cinfo);
 
-  /* At this point you may want to check to see whether any corrupt-data
-   * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
-   */
-  if (_jerr.pub.num_warnings) {
-    pnmimage_jpg_cat.warning()
-      << "Jpeg data may be corrupt" << endl;
+    /* At this point you may want to check to see whether any
+     * corrupt-data warnings occurred (test whether
+     * jerr.pub.num_warnings is nonzero).
+     */
+    if (_jerr.pub.num_warnings) {
+      pnmimage_jpg_cat.warning()
+        << "Jpeg data may be corrupt" << endl;
+    }
   }
 
-  return _y_size;
+  return true;
 }
 
 #endif  // HAVE_JPEG
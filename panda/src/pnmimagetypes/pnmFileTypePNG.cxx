@@ -195,6 +195,9 @@ Reader(PNMFileType *type, istream *file, bool owns_file, string magic_number) :
   _png = NULL;
   _info = NULL;
   _is_valid = false;
+  _interlaced = false;
+  _row = NULL;
+  _rows_read = 0;
 
   _png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL,
                                 png_error, png_warning);
@@ -227,9 +230,11 @@ Reader(PNMFileType *type, istream *file, bool owns_file, string magic_number) :
   png_uint_32 height;
   int bit_depth;
   int color_type;
+  int interlace_type;
 
   png_get_IHDR(_png, _info, &width, &height,
-               &bit_depth, &color_type, NULL, NULL, NULL);
+               &bit_depth, &color_type, &interlace_type, NULL, NULL);
+  _interlaced = (interlace_type != PNG_INTERLACE_NONE);
 
   pnmimage_png_cat.debug()
     << "width = " << width << " height = " << height << " bit_depth = "
@@ -290,6 +295,11 @@ Reader(PNMFileType *type, istream *file, bool owns_file, string magic_number) :
     }
   }
 
+  if (_interlaced) {
+    // read_data() reads all of the passes at once.
+    png_set_interlace_handling(_png);
+  }
+
   png_read_update_info(_png, _info);
 }
 
@@ -301,6 +311,9 @@ Reader(PNMFileType *type, istream *file, bool owns_file, string magic_number) :
 PNMFileTypePNG::Reader::
 ~Reader() {
   free_png();
+  if (_row != NULL) {
+    PANDA_FREE_ARRAY(_row);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -322,6 +335,12 @@ read_data(xel *array, xelval *alpha_data) {
     return 0;
   }
 
+  if (_x_shift != 0 || _y_shift != 0) {
+    // We have been asked to reduce the image as we read it, which
+    // the base class does a row at a time.
+    return PNMReader::read_data(array, alpha_data);
+  }
+
   if (setjmp(_jmpbuf)) {
     // This is the ANSI C way to handle exceptions.  If setjmp(),
     // above, returns true, it means that libpng detected an exception
@@ -356,69 +375,131 @@ read_data(xel *array, xelval *alpha_data) {
 
   png_read_image(_png, rows);
 
+  for (yi = 0; yi < num_rows; yi++) {
+    unpack_row(rows[yi], array + yi * _x_size,
+               has_alpha() ? alpha_data + yi * _x_size : NULL, _x_size);
+    PANDA_FREE_ARRAY(rows[yi]);
+  }
+
+  PANDA_FREE_ARRAY(rows);
+
+  png_read_end(_png, NULL);
+
+  return _y_size;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMFileTypePNG::Reader::supports_read_row
+//       Access: Public, Virtual
+//  Description: Returns true if this particular PNMReader is capable
+//               of returning the data one row at a time, via repeated
+//               calls to read_row().  Returns false if the only way
+//               to read from this file is all at once, via
+//               read_data().
+//
+//               An interlaced PNG file can only be read all at once.
+////////////////////////////////////////////////////////////////////
+bool PNMFileTypePNG::Reader::
+supports_read_row() const {
+  return !_interlaced;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMFileTypePNG::Reader::read_row
+//       Access: Public, Virtual
+//  Description: If supports_read_row(), above, returns true, this
+//               function may be called repeatedly to read the image,
+//               one horizontal row at a time, beginning from the top.
+//               Returns true if the row is successfully read, false
+//               if there is an error or end of file.
+////////////////////////////////////////////////////////////////////
+bool PNMFileTypePNG::Reader::
+read_row(xel *array, xelval *alpha_data, int x_size, int y_size) {
+  if (!is_valid() || _interlaced || _rows_read >= y_size) {
+    return false;
+  }
+
+  if (setjmp(_jmpbuf)) {
+    // libpng detected an exception while reading the row.
+    free_png();
+    return false;
+  }
+
+  if (_row == NULL) {
+    int row_byte_length = x_size * _num_channels;
+    if (_maxval > 255) {
+      row_byte_length *= 2;
+    }
+    _row = (png_bytep)PANDA_MALLOC_ARRAY(row_byte_length * sizeof(png_byte));
+  }
+
+  png_read_row(_png, _row, NULL);
+  unpack_row(_row, array, alpha_data, x_size);
+
+  ++_rows_read;
+  if (_rows_read == y_size) {
+    png_read_end(_png, NULL);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMFileTypePNG::Reader::unpack_row
+//       Access: Private
+//  Description: Copies one row of x_size pixels, in libpng's format,
+//               into the indicated array and alpha pointers.
+////////////////////////////////////////////////////////////////////
+void PNMFileTypePNG::Reader::
+unpack_row(png_bytep source, xel *array, xelval *alpha_data, int x_size) const {
   bool get_color = !is_grayscale();
   bool get_alpha = has_alpha();
 
-  int pi = 0;
-  for (yi = 0; yi < num_rows; yi++) {
-    png_bytep source = rows[yi];
-    for (int xi = 0; xi < _x_size; xi++) {
-      int red = 0;
-      int green = 0;
-      int blue = 0;
-      int alpha = 0;
-
-      if (_maxval > 255) {
-        if (get_color) {
-          red = (source[0] << 8) | source[1];
-          source += 2;
-
-          green = (source[0] << 8) | source[1];
-          source += 2;
-        }
+  for (int xi = 0; xi < x_size; xi++) {
+    int red = 0;
+    int green = 0;
+    int blue = 0;
+    int alpha = 0;
 
-        blue = (source[0] << 8) | source[1];
+    if (_maxval > 255) {
+      if (get_color) {
+        red = (source[0] << 8) | source[1];
         source += 2;
 
-        if (get_alpha) {
-          alpha = (source[0] << 8) | source[1];
-          source += 2;
-        }
-        
-      } else {
-        if (get_color) {
-          red = *source;
-          source++;
+        green = (source[0] << 8) | source[1];
+        source += 2;
+      }
 
-          green = *source;
-          source++;
-        }
+      blue = (source[0] << 8) | source[1];
+      source += 2;
+
+      if (get_alpha) {
+        alpha = (source[0] << 8) | source[1];
+        source += 2;
+      }
 
-        blue = *source;
+    } else {
+      if (get_color) {
+        red = *source;
         source++;
 
-        if (get_alpha) {
-          alpha = *source;
-          source++;
-        }
+        green = *source;
+        source++;
       }
-      
-      PPM_ASSIGN(array[pi], red, green, blue);
+
+      blue = *source;
+      source++;
+
       if (get_alpha) {
-        alpha_data[pi] = alpha;
+        alpha = *source;
+        source++;
       }
-      pi++;
     }
 
-    nassertr(source <= rows[yi] + row_byte_length, yi);
-    PANDA_FREE_ARRAY(rows[yi]);
+    PPM_ASSIGN(array[xi], red, green, blue);
+    if (get_alpha) {
+      alpha_data[xi] = alpha;
+    }
   }
-
-  PANDA_FREE_ARRAY(rows);
-
-  png_read_end(_png, NULL);
-
-  return _y_size;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -502,6 +583,10 @@ Writer(PNMFileType *type, ostream *file, bool owns_file) :
   _png = NULL;
   _info = NULL;
   _is_valid = false;
+  _png_bit_depth = 8;
+  _val_scale = 1.0;
+  _row = NULL;
+  _rows_written = 0;
 
   _png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL,
                                  png_error, png_warning);
@@ -526,6 +611,9 @@ Writer(PNMFileType *type, ostream *file, bool owns_file) :
 PNMFileTypePNG::Writer::
 ~Writer() {
   free_png();
+  if (_row != NULL) {
+    PANDA_FREE_ARRAY(_row);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -537,9 +625,8 @@ PNMFileTypePNG::Writer::
 //               alpha is ignored.)  Returns the number of rows
 //               correctly write.
 //
-//               Derived classes need not override this if they
-//               instead provide supports_write_row() and write_row(),
-//               below.
+//               Unlike write_row(), this may write a palette image,
+//               since it can examine all of the pixels first.
 ////////////////////////////////////////////////////////////////////
 int PNMFileTypePNG::Writer::
 write_data(xel *array, xelval *alpha_data) {
@@ -555,29 +642,9 @@ write_data(xel *array, xelval *alpha_data) {
     return 0;
   }
 
-  png_set_write_fn(_png, (void *)this, png_write_data, png_flush_data);
-
-  // First, write the header.
-
   int true_bit_depth = pm_maxvaltobits(_maxval);
   int png_bit_depth = make_png_bit_depth(true_bit_depth);
 
-  png_color_8 sig_bit;
-  sig_bit.red = true_bit_depth;
-  sig_bit.green = true_bit_depth;
-  sig_bit.blue = true_bit_depth;
-  sig_bit.gray = true_bit_depth;
-  sig_bit.alpha = true_bit_depth;
-
-  int color_type = 0;
-
-  if (!is_grayscale()) {
-    color_type |= PNG_COLOR_MASK_COLOR;
-  }
-  if (has_alpha()) {
-    color_type |= PNG_COLOR_MASK_ALPHA;
-  }
-
   // Determine if we should make a palettized image out of this.  In
   // order for this to be possible and effective, we must have no more
   // than 256 unique color/alpha combinations for a color image, and
@@ -587,6 +654,7 @@ write_data(xel *array, xelval *alpha_data) {
   HistMap palette_lookup;
   png_color png_palette_table[png_max_palette];
   png_byte png_trans[png_max_palette];
+  bool make_palette = false;
 
   if (png_palette) {
     if (png_bit_depth <= 8) {
@@ -610,36 +678,8 @@ write_data(xel *array, xelval *alpha_data) {
             << "palette bit depth of " << palette_bit_depth
             << " improves on bit depth of " << total_bits 
             << "; making a palette image.\n";
+          make_palette = true;
 
-          color_type = PNG_COLOR_TYPE_PALETTE;
-
-          // Re-sort the palette to put the semitransparent pixels at the
-          // beginning.
-          sort(palette.begin(), palette.end(), LowAlphaCompare());
-        
-          double palette_scale = 255.0 / _maxval;
-
-          int num_alpha = 0;
-          for (int i = 0; i < (int)palette.size(); i++) {
-            png_palette_table[i].red = (int)(palette[i]._red * palette_scale + 0.5);
-            png_palette_table[i].green = (int)(palette[i]._green * palette_scale + 0.5);
-            png_palette_table[i].blue = (int)(palette[i]._blue * palette_scale + 0.5);
-            png_trans[i] = (int)(palette[i]._alpha * palette_scale + 0.5);
-            if (palette[i]._alpha != _maxval) {
-              num_alpha = i + 1;
-            }
-          
-            // Also build a reverse-lookup from color to palette index in
-            // the "histogram" structure.
-            palette_lookup[palette[i]] = i;
-          }
-
-          png_set_PLTE(_png, _info, png_palette_table, palette.size());
-          if (has_alpha()) {
-            pnmimage_png_cat.debug()
-              << "palette contains " << num_alpha << " transparent entries.\n";
-            png_set_tRNS(_png, _info, png_trans, num_alpha, NULL);
-          }
         } else {
           pnmimage_png_cat.debug()
             << "palette bit depth of " << palette_bit_depth
@@ -661,6 +701,271 @@ write_data(xel *array, xelval *alpha_data) {
       << "palette images are not enabled.\n";
   }
 
+  if (!make_palette) {
+    // Write the ordinary image a row at a time.
+    return PNMWriter::write_data(array, alpha_data);
+  }
+
+  png_set_write_fn(_png, (void *)this, png_write_data, png_flush_data);
+
+  // Re-sort the palette to put the semitransparent pixels at the
+  // beginning.
+  sort(palette.begin(), palette.end(), LowAlphaCompare());
+
+  double palette_scale = 255.0 / _maxval;
+
+  int num_alpha = 0;
+  for (int i = 0; i < (int)palette.size(); i++) {
+    png_palette_table[i].red = (int)(palette[i]._red * palette_scale + 0.5);
+    png_palette_table[i].green = (int)(palette[i]._green * palette_scale + 0.5);
+    png_palette_table[i].blue = (int)(palette[i]._blue * palette_scale + 0.5);
+    png_trans[i] = (int)(palette[i]._alpha * palette_scale + 0.5);
+    if (palette[i]._alpha != _maxval) {
+      num_alpha = i + 1;
+    }
+
+    // Also build a reverse-lookup from color to palette index in
+    // the "histogram" structure.
+    palette_lookup[palette[i]] = i;
+  }
+
+  png_set_PLTE(_png, _info, png_palette_table, palette.size());
+  if (has_alpha()) {
+    pnmimage_png_cat.debug()
+      << "palette contains " << num_alpha << " transparent entries.\n";
+    png_set_tRNS(_png, _info, png_trans, num_alpha, NULL);
+  }
+
+  start_png(PNG_COLOR_TYPE_PALETTE);
+
+  bool save_color = !is_grayscale();
+  bool save_alpha = has_alpha();
+
+  int pi = 0;
+  for (int yi = 0; yi < _y_size; yi++) {
+    png_bytep dest = _row;
+
+    for (int xi = 0; xi < _x_size; xi++) {
+      int index;
+
+      if (save_color) {
+        if (save_alpha) {
+          index = palette_lookup[PixelSpec(PPM_GETR(array[pi]), PPM_GETG(array[pi]), PPM_GETB(array[pi]), alpha_data[pi])];
+        } else {
+          index = palette_lookup[PixelSpec(PPM_GETR(array[pi]), PPM_GETG(array[pi]), PPM_GETB(array[pi]))];
+        }
+      } else {
+        if (save_alpha) {
+          index = palette_lookup[PixelSpec(PPM_GETB(array[pi]), alpha_data[pi])];
+        } else {
+          index = palette_lookup[PixelSpec(PPM_GETB(array[pi]))];
+        }
+      }
+
+      *dest++ = index;
+      pi++;
+    }
+
+    png_write_row(_png, _row);
+    Thread::consider_yield();
+  }
+
+  png_write_end(_png, NULL);
+
+  return _y_size;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMFileTypePNG::Writer::supports_write_row
+//       Access: Public, Virtual
+//  Description: Returns true if this particular PNMWriter supports a
+//               streaming interface to writing the data: that is, it
+//               is capable of writing the image one row at a time,
+//               via repeated calls to write_row().  Returns false if
+//               the only way to write from this file is all at once,
+//               via write_data().
+////////////////////////////////////////////////////////////////////
+bool PNMFileTypePNG::Writer::
+supports_write_row() const {
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMFileTypePNG::Writer::write_header
+//       Access: Public, Virtual
+//  Description: If supports_write_row(), above, returns true, this
+//               function may be called to write out the image header
+//               in preparation to writing out the image data one row
+//               at a time.  Returns true if the header is
+//               successfully written, false if there is an error.
+//
+//               An image written this way is never a palette image.
+////////////////////////////////////////////////////////////////////
+bool PNMFileTypePNG::Writer::
+write_header() {
+  if (!is_valid()) {
+    return false;
+  }
+
+  if (setjmp(_jmpbuf)) {
+    // libpng detected an exception while writing the header.
+    free_png();
+    return false;
+  }
+
+  png_set_write_fn(_png, (void *)this, png_write_data, png_flush_data);
+
+  int color_type = 0;
+  if (!is_grayscale()) {
+    color_type |= PNG_COLOR_MASK_COLOR;
+  }
+  if (has_alpha()) {
+    color_type |= PNG_COLOR_MASK_ALPHA;
+  }
+
+  start_png(color_type);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMFileTypePNG::Writer::write_row
+//       Access: Public, Virtual
+//  Description: If supports_write_row(), above, returns true, this
+//               function may be called repeatedly to write the image,
+//               one horizontal row at a time, beginning from the top.
+//               Returns true if the row is successfully written,
+//               false if there is an error.
+//
+//               You must first call write_header() before writing the
+//               individual rows.  It is also important to delete the
+//               PNMWriter class after successfully writing the last
+//               row.  Failing to do this may result in some data not
+//               getting flushed!
+////////////////////////////////////////////////////////////////////
+bool PNMFileTypePNG::Writer::
+write_row(xel *array, xelval *alpha_data) {
+  if (!is_valid() || _row == NULL || _rows_written >= _y_size) {
+    return false;
+  }
+
+  if (setjmp(_jmpbuf)) {
+    // libpng detected an exception while writing the row.
+    free_png();
+    return false;
+  }
+
+  bool save_color = !is_grayscale();
+  bool save_alpha = has_alpha();
+  png_bytep dest = _row;
+
+  if (_val_scale == 1.0) {
+    // No scale needed; we're already a power of 2.
+    if (_png_bit_depth > 8) {
+      for (int xi = 0; xi < _x_size; xi++) {
+        if (save_color) {
+          xelval red = PPM_GETR(array[xi]);
+          *dest++ = (red >> 8) & 0xff;
+          *dest++ = red & 0xff;
+          xelval green = PPM_GETG(array[xi]);
+          *dest++ = (green >> 8) & 0xff;
+          *dest++ = green & 0xff;
+        }
+        xelval blue = PPM_GETB(array[xi]);
+        *dest++ = (blue >> 8) & 0xff;
+        *dest++ = blue & 0xff;
+
+        if (save_alpha) {
+          xelval alpha = alpha_data[xi];
+          *dest++ = (alpha >> 8) & 0xff;
+          *dest++ = alpha & 0xff;
+        }
+      }
+
+    } else {
+      for (int xi = 0; xi < _x_size; xi++) {
+        if (save_color) {
+          *dest++ = PPM_GETR(array[xi]);
+          *dest++ = PPM_GETG(array[xi]);
+        }
+
+        *dest++ = PPM_GETB(array[xi]);
+
+        if (save_alpha) {
+          *dest++ = alpha_data[xi];
+        }
+      }
+    }
+
+  } else {
+    // Here we might need to scale each component to match the png
+    // requirement.
+    if (_png_bit_depth > 8) {
+      for (int xi = 0; xi < _x_size; xi++) {
+        if (save_color) {
+          xelval red = (xelval)(PPM_GETR(array[xi]) * _val_scale + 0.5);
+          *dest++ = (red >> 8) & 0xff;
+          *dest++ = red & 0xff;
+          xelval green = (xelval)(PPM_GETG(array[xi]) * _val_scale + 0.5);
+          *dest++ = (green >> 8) & 0xff;
+          *dest++ = green & 0xff;
+        }
+        xelval blue = (xelval)(PPM_GETB(array[xi]) * _val_scale + 0.5);
+        *dest++ = (blue >> 8) & 0xff;
+        *dest++ = blue & 0xff;
+
+        if (save_alpha) {
+          xelval alpha = (xelval)(alpha_data[xi] * _val_scale + 0.5);
+          *dest++ = (alpha >> 8) & 0xff;
+          *dest++ = alpha & 0xff;
+        }
+      }
+
+    } else {
+      for (int xi = 0; xi < _x_size; xi++) {
+        if (save_color) {
+          *dest++ = (xelval)(PPM_GETR(array[xi]) * _val_scale + 0.5);
+          *dest++ = (xelval)(PPM_GETG(array[xi]) * _val_scale + 0.5);
+        }
+
+        *dest++ = (xelval)(PPM_GETB(array[xi]) * _val_scale + 0.5);
+
+        if (save_alpha) {
+          *dest++ = (xelval)(alpha_data[xi] * _val_scale + 0.5);
+        }
+      }
+    }
+  }
+
+  png_write_row(_png, _row);
+
+  ++_rows_written;
+  if (_rows_written == _y_size) {
+    png_write_end(_png, NULL);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: PNMFileTypePNG::Writer::start_png
+//       Access: Private
+//  Description: Writes the PNG header for an image of the indicated
+//               color type, and sets up the transformations and the
+//               row buffer for writing the rows.  Any palette must
+//               already have been set.  The caller must have called
+//               setjmp() to catch libpng errors.
+////////////////////////////////////////////////////////////////////
+void PNMFileTypePNG::Writer::
+start_png(int color_type) {
+  int true_bit_depth = pm_maxvaltobits(_maxval);
+  int png_bit_depth = make_png_bit_depth(true_bit_depth);
+
+  png_color_8 sig_bit;
+  sig_bit.red = true_bit_depth;
+  sig_bit.green = true_bit_depth;
+  sig_bit.blue = true_bit_depth;
+  sig_bit.gray = true_bit_depth;
+  sig_bit.alpha = true_bit_depth;
+
   pnmimage_png_cat.debug()
     << "width = " << _x_size << " height = " << _y_size
     << " maxval = " << _maxval << " bit_depth = "
@@ -683,25 +988,24 @@ write_data(xel *array, xelval *alpha_data) {
     png_set_packing(_png);
   }
 
-  double val_scale = 1.0;
+  _val_scale = 1.0;
 
   if (color_type != PNG_COLOR_TYPE_PALETTE) {
     if (png_bit_depth != true_bit_depth) {
       png_set_shift(_png, &sig_bit);
     }
     // Since this assumes that _maxval is one less than a power of 2,
-    // we set val_scale to the appropriate factor in case it is not.
+    // we set _val_scale to the appropriate factor in case it is not.
     int png_maxval = (1 << png_bit_depth) - 1;
-    val_scale = (double)png_maxval / (double)_maxval;
+    _val_scale = (double)png_maxval / (double)_maxval;
   }
+  _png_bit_depth = png_bit_depth;
 
   int row_byte_length = _x_size * _num_channels;
   if (png_bit_depth > 8) {
     row_byte_length *= 2;
   }
 
-  int num_rows = _y_size;
-
   if (pnmimage_png_cat.is_debug()) {
     pnmimage_png_cat.debug()
       << "Allocating one row of " << row_byte_length
@@ -710,140 +1014,11 @@ write_data(xel *array, xelval *alpha_data) {
 
   // When writing, we only need to copy the image out one row at a
   // time, because we don't mess around with writing interlaced files.
-  // If we were writing an interlaced file, we'd have to copy the
-  // whole image first.
-
-  png_bytep row = (png_byte *)PANDA_MALLOC_ARRAY(row_byte_length * sizeof(png_byte));
-
-  bool save_color = !is_grayscale();
-  bool save_alpha = has_alpha();
-
-  if (val_scale == 1.0) {
-    // No scale needed; we're already a power of 2.
-    int pi = 0;
-    for (int yi = 0; yi < num_rows; yi++) {
-      png_bytep dest = row;
-
-      if (color_type == PNG_COLOR_TYPE_PALETTE) {
-        for (int xi = 0; xi < _x_size; xi++) {
-          int index;
-
-          if (save_color) {
-            if (save_alpha) {
-              index = palette_lookup[PixelSpec(PPM_GETR(array[pi]), PPM_GETG(array[pi]), PPM_GETB(array[pi]), alpha_data[pi])];
-            } else {
-              index = palette_lookup[PixelSpec(PPM_GETR(array[pi]), PPM_GETG(array[pi]), PPM_GETB(array[pi]))];
-            }
-          } else {
-            if (save_alpha) {
-              index = palette_lookup[PixelSpec(PPM_GETB(array[pi]), alpha_data[pi])];
-            } else {
-              index = palette_lookup[PixelSpec(PPM_GETB(array[pi]))];
-            }
-          }
-
-          *dest++ = index;
-          pi++;
-        }
-
-      } else if (png_bit_depth > 8) {
-        for (int xi = 0; xi < _x_size; xi++) {
-          if (save_color) {
-            xelval red = PPM_GETR(array[pi]);
-            *dest++ = (red >> 8) & 0xff;
-            *dest++ = red & 0xff;
-            xelval green = PPM_GETG(array[pi]);
-            *dest++ = (green >> 8) & 0xff;
-            *dest++ = green & 0xff;
-          }
-          xelval blue = PPM_GETB(array[pi]);
-          *dest++ = (blue >> 8) & 0xff;
-          *dest++ = blue & 0xff;
-
-          if (save_alpha) {
-            xelval alpha = alpha_data[pi];
-            *dest++ = (alpha >> 8) & 0xff;
-            *dest++ = alpha & 0xff;
-          }
-          pi++;
-        }
-
-      } else {
-        for (int xi = 0; xi < _x_size; xi++) {
-          if (save_color) {
-            *dest++ = PPM_GETR(array[pi]);
-            *dest++ = PPM_GETG(array[pi]);
-          }
-
-          *dest++ = PPM_GETB(array[pi]);
-
-          if (save_alpha) {
-            *dest++ = alpha_data[pi];
-          }
-          pi++;
-        }
-      }
-
-      nassertr(dest <= row + row_byte_length, yi);
-      png_write_row(_png, row);
-      Thread::consider_yield();
-    }
-  } else {
-    // Here we might need to scale each component to match the png
-    // requirement.
-    nassertr(color_type != PNG_COLOR_TYPE_PALETTE, 0);
-    int pi = 0;
-    for (int yi = 0; yi < num_rows; yi++) {
-      png_bytep dest = row;
-
-      if (png_bit_depth > 8) {
-        for (int xi = 0; xi < _x_size; xi++) {
-          if (save_color) {
-            xelval red = (xelval)(PPM_GETR(array[pi]) * val_scale + 0.5);
-            *dest++ = (red >> 8) & 0xff;
-            *dest++ = red & 0xff;
-            xelval green = (xelval)(PPM_GETG(array[pi]) * val_scale + 0.5);
-            *dest++ = (green >> 8) & 0xff;
-            *dest++ = green & 0xff;
-          }
-          xelval blue = (xelval)(PPM_GETB(array[pi]) * val_scale + 0.5);
-          *dest++ = (blue >> 8) & 0xff;
-          *dest++ = blue & 0xff;
-
-          if (save_alpha) {
-            xelval alpha = (xelval)(alpha_data[pi] * val_scale + 0.5);
-            *dest++ = (alpha >> 8) & 0xff;
-            *dest++ = alpha & 0xff;
-          }
-          pi++;
-        }
-
-      } else {
-        for (int xi = 0; xi < _x_size; xi++) {
-          if (save_color) {
-            *dest++ = (xelval)(PPM_GETR(array[pi]) * val_scale + 0.5);
-            *dest++ = (xelval)(PPM_GETG(array[pi]) * val_scale + 0.5);
-          }
-
-          *dest++ = (xelval)(PPM_GETB(array[pi]) * val_scale + 0.5);
-
-          if (save_alpha) {
-            *dest++ = (xelval)(alpha_data[pi] * val_scale + 0.5);
-          }
-          pi++;
-        }
-      }
-
-      nassertr(dest <= row + row_byte_length, yi);
-      png_write_row(_png, row);
-      Thread::consider_yield();
-    }
+  if (_row != NULL) {
+    PANDA_FREE_ARRAY(_row);
   }
-  PANDA_FREE_ARRAY(row);
-
-  png_write_end(_png, NULL);
-
-  return _y_size;
+  _row = (png_bytep)PANDA_MALLOC_ARRAY(row_byte_length * sizeof(png_byte));
+  _rows_written = 0;
 }
 
 ////////////////////////////////////////////////////////////////////
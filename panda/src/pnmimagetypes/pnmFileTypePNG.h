@@ -54,9 +54,13 @@ public:
     virtual ~Reader();
 
     virtual int read_data(xel *array, xelval *alpha_data);
+    virtual bool supports_read_row() const;
+    virtual bool read_row(xel *array, xelval *alpha, int x_size, int y_size);
 
   private:
     void free_png();
+    void unpack_row(png_bytep source, xel *array, xelval *alpha_data,
+                    int x_size) const;
     static void png_read_data(png_structp png_ptr, png_bytep data, 
                               png_size_t length);
 
@@ -65,6 +69,11 @@ public:
 
     png_structp _png;
     png_infop _info;
+    bool _interlaced;
+
+    // The buffer for read_row(), and the number of rows it has read.
+    png_bytep _row;
+    int _rows_read;
 
     // We need a jmp_buf to support libpng's fatal error handling, in
     // which the error handler must not immediately leave libpng code,
@@ -78,9 +87,13 @@ public:
     virtual ~Writer();
 
     virtual int write_data(xel *array, xelval *alpha);
+    virtual bool supports_write_row() const;
+    virtual bool write_header();
+    virtual bool write_row(xel *array, xelval *alpha);
 
   private:
     void free_png();
+    void start_png(int color_type);
     static int make_png_bit_depth(int bit_depth);
     static void png_write_data(png_structp png_ptr, png_bytep data, 
                                png_size_t length);
@@ -92,6 +105,12 @@ public:
     png_structp _png;
     png_infop _info;
 
+    // These are filled in by start_png() for write_row().
+    int _png_bit_depth;
+    double _val_scale;
+    png_bytep _row;
+    int _rows_written;
+
     // We need a jmp_buf to support libpng's fatal error handling, in
     // which the error handler must not immediately leave libpng code,
     // but must return to the caller in Panda.
@@ -0,0 +1,550 @@
+// Filename: test_pnm_read_row.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+
+// pnmFileTypePNG.h must come first, for png.h's sake.
+#include "pnmFileTypePNG.h"
+#include "pnmFileTypeJPG.h"
+#include "config_pnmimagetypes.h"
+#include "pnmImage.h"
+#include "pnmReader.h"
+#include "pnmBandProcessor.h"
+#include "pnmFileTypeRegistry.h"
+#include "filename.h"
+#include "pvector.h"
+
+// This program checks the row-at-a-time PNG and JPEG readers against
+// whole-image reads of the same files.  It writes a handful of PNG
+// files of the awkward kinds (paletted with transparency, grayscale
+// with alpha, 16 bits per channel, fewer than 8 bits per pixel, and
+// interlaced) directly with libpng, so that their pixels are known
+// exactly, and a color and a grayscale JPEG.  Each file is then read
+// a row at a time with read_row(), read whole with PNMImage::read(),
+// and copied through PNMBandProcessor, and all of these must agree
+// with the pixels that were written.  JPEG pixels are compared
+// against libjpeg's own decoding of the file instead.
+//
+// Interlaced PNG files can't be read a row at a time; for those, the
+// reader must say so, and PNMBandProcessor must fall back to reading
+// the whole image.
+//
+// Usage: test_pnm_read_row
+
+static const int x_size = 37;
+static const int y_size = 23;
+
+static pvector<Filename> temp_files;
+
+////////////////////////////////////////////////////////////////////
+//     Function: make_temp_filename
+//  Description: Returns a new temporary filename with the indicated
+//               extension, which will be deleted on exit.
+////////////////////////////////////////////////////////////////////
+static Filename
+make_temp_filename(const string &extension) {
+  // Filename::temporary() makes up the same name again until the file
+  // exists, so we number the files ourselves.
+  ostringstream strm;
+  strm << "pnmrow_" << temp_files.size() << "_";
+  Filename filename = Filename::temporary(Filename::get_temp_directory(),
+                                          strm.str(), "." + extension);
+  filename.set_binary();
+  temp_files.push_back(filename);
+  return filename;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: compare_images
+//  Description: Returns true if the two images have the same size,
+//               channels, maxval, and pixels, or reports the first
+//               difference and returns false.
+////////////////////////////////////////////////////////////////////
+static bool
+compare_images(const string &what, const PNMImage &expected,
+               const PNMImage &actual) {
+  if (actual.get_x_size() != expected.get_x_size() ||
+      actual.get_y_size() != expected.get_y_size() ||
+      actual.get_num_channels() != expected.get_num_channels() ||
+      actual.get_maxval() != expected.get_maxval()) {
+    cerr << "  " << what << ": got " << actual.get_x_size() << "x"
+         << actual.get_y_size() << ", " << actual.get_num_channels()
+         << " channels, maxval " << actual.get_maxval() << "; expected "
+         << expected.get_x_size() << "x" << expected.get_y_size() << ", "
+         << expected.get_num_channels() << " channels, maxval "
+         << expected.get_maxval() << "\n";
+    return false;
+  }
+
+  for (int y = 0; y < expected.get_y_size(); ++y) {
+    for (int x = 0; x < expected.get_x_size(); ++x) {
+      bool same =
+        (actual.get_red_val(x, y) == expected.get_red_val(x, y) &&
+         actual.get_green_val(x, y) == expected.get_green_val(x, y) &&
+         actual.get_blue_val(x, y) == expected.get_blue_val(x, y));
+      if (expected.has_alpha() &&
+          actual.get_alpha_val(x, y) != expected.get_alpha_val(x, y)) {
+        same = false;
+      }
+      if (!same) {
+        cerr << "  " << what << ": pixel " << x << ", " << y << " is "
+             << actual.get_xel_val(x, y);
+        if (expected.has_alpha()) {
+          cerr << " alpha " << actual.get_alpha_val(x, y);
+        }
+        cerr << "; expected " << expected.get_xel_val(x, y);
+        if (expected.has_alpha()) {
+          cerr << " alpha " << expected.get_alpha_val(x, y);
+        }
+        cerr << "\n";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: read_rows
+//  Description: Reads the image a row at a time, the way a streaming
+//               client would.  Returns false if the reader can't do
+//               that, or fails.
+////////////////////////////////////////////////////////////////////
+static bool
+read_rows(const Filename &filename, PNMImage &image) {
+  PNMImageHeader header;
+  PNMReader *reader = header.make_reader(filename);
+  if (reader == (PNMReader *)NULL) {
+    return false;
+  }
+  if (!reader->supports_read_row()) {
+    delete reader;
+    return false;
+  }
+
+  reader->prepare_read();
+  image.clear(reader->get_x_size(), reader->get_y_size(),
+              reader->get_num_channels(), reader->get_maxval());
+  int width = image.get_x_size();
+  int height = image.get_y_size();
+  xel *array = image.get_array();
+  xelval *alpha = image.get_alpha_array();
+
+  bool ok = true;
+  for (int y = 0; y < height && ok; ++y) {
+    ok = reader->read_row(array + y * width,
+                          alpha != (xelval *)NULL ? alpha + y * width : NULL,
+                          width, height);
+  }
+
+  // There must be no more rows after the last one.
+  if (ok && reader->read_row(array, alpha, width, height)) {
+    cerr << "  read_row() returned a row past the end\n";
+    ok = false;
+  }
+
+  delete reader;
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: check_file
+//  Description: Reads the file a row at a time, whole, and through
+//               PNMBandProcessor, and compares each against the
+//               expected image.  If streaming is false, the file is
+//               expected not to be readable a row at a time.
+////////////////////////////////////////////////////////////////////
+static bool
+check_file(const string &name, const Filename &filename,
+           const PNMImage &expected, bool streaming) {
+  bool ok = true;
+
+  PNMImage rows;
+  bool read_by_rows = read_rows(filename, rows);
+  if (read_by_rows != streaming) {
+    cerr << "  " << name << ": read_row() "
+         << (read_by_rows ? "succeeded" : "failed")
+         << ", expected it to " << (streaming ? "succeed" : "fail") << "\n";
+    ok = false;
+  } else if (read_by_rows) {
+    ok = compare_images(name + " (read_row)", expected, rows) && ok;
+  }
+
+  PNMImage whole;
+  if (!whole.read(filename)) {
+    cerr << "  " << name << ": could not read whole image\n";
+    ok = false;
+  } else {
+    ok = compare_images(name + " (whole)", expected, whole) && ok;
+  }
+
+  // PNG output is lossless and is written a row at a time, so this
+  // checks only how the source was read.
+  Filename copy_filename = make_temp_filename("png");
+  PNMBandProcessor processor;
+  processor.set_band_rows(4);
+  if (!processor.process(filename, copy_filename)) {
+    cerr << "  " << name << ": PNMBandProcessor failed\n";
+    ok = false;
+  } else {
+    if (processor.was_read_streaming() != streaming) {
+      cerr << "  " << name << ": PNMBandProcessor "
+           << (processor.was_read_streaming() ? "streamed" : "did not stream")
+           << " the source\n";
+      ok = false;
+    }
+    PNMImage copy;
+    if (!copy.read(copy_filename)) {
+      cerr << "  " << name << ": could not read PNMBandProcessor output\n";
+      ok = false;
+    } else {
+      ok = compare_images(name + " (PNMBandProcessor)", expected, copy) && ok;
+    }
+  }
+
+  cerr << name << ": " << (ok ? "ok" : "FAILED") << "\n";
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: write_png
+//  Description: Writes a PNG file directly with libpng.  The rows
+//               are given in libpng's packed format.  Returns true
+//               on success.
+////////////////////////////////////////////////////////////////////
+static bool
+write_png(const Filename &filename, int color_type, int bit_depth,
+          bool interlaced, const pvector<string> &rows,
+          const png_color *palette = NULL, int num_palette = 0,
+          const png_byte *trans = NULL, int num_trans = 0) {
+  string os_filename = filename.to_os_specific();
+  FILE *file = fopen(os_filename.c_str(), "wb");
+  if (file == (FILE *)NULL) {
+    return false;
+  }
+
+  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+                                            NULL, NULL, NULL);
+  png_infop info = png_create_info_struct(png);
+  if (setjmp(png_jmpbuf(png))) {
+    png_destroy_write_struct(&png, &info);
+    fclose(file);
+    return false;
+  }
+
+  png_init_io(png, file);
+  png_set_IHDR(png, info, x_size, y_size, bit_depth, color_type,
+               interlaced ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  if (palette != (const png_color *)NULL) {
+    png_set_PLTE(png, info, palette, num_palette);
+  }
+  if (trans != (const png_byte *)NULL) {
+    png_set_tRNS(png, info, trans, num_trans, NULL);
+  }
+  png_write_info(png, info);
+
+  pvector<png_bytep> row_pointers;
+  for (int y = 0; y < y_size; ++y) {
+    row_pointers.push_back((png_bytep)rows[y].data());
+  }
+  png_write_image(png, &row_pointers[0]);
+  png_write_end(png, NULL);
+
+  png_destroy_write_struct(&png, &info);
+  fclose(file);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: put16
+//  Description: Appends a 16-bit value to the string, most
+//               significant byte first, as PNG wants.
+////////////////////////////////////////////////////////////////////
+static void
+put16(string &row, int value) {
+  row += (char)(value >> 8);
+  row += (char)(value & 0xff);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: test_palette
+//  Description: A 4-bit paletted image, with transparency for some
+//               of its palette entries.  The reader expands this to
+//               8-bit RGBA.
+////////////////////////////////////////////////////////////////////
+static bool
+test_palette() {
+  png_color palette[16];
+  png_byte trans[10];
+  for (int i = 0; i < 16; ++i) {
+    palette[i].red = (png_byte)(i * 17);
+    palette[i].green = (png_byte)(255 - i * 13);
+    palette[i].blue = (png_byte)((i * 71) & 0xff);
+  }
+  for (int i = 0; i < 10; ++i) {
+    trans[i] = (png_byte)(i * 25);
+  }
+
+  PNMImage expected(x_size, y_size, 4, 255);
+  pvector<string> rows;
+  for (int y = 0; y < y_size; ++y) {
+    string row;
+    for (int x = 0; x < x_size; x += 2) {
+      int i0 = (x * 3 + y * 5) & 0xf;
+      int i1 = ((x + 1) * 3 + y * 5) & 0xf;
+      row += (char)((i0 << 4) | (x + 1 < x_size ? i1 : 0));
+    }
+    rows.push_back(row);
+
+    for (int x = 0; x < x_size; ++x) {
+      int i = (x * 3 + y * 5) & 0xf;
+      expected.set_xel_val(x, y, palette[i].red, palette[i].green,
+                           palette[i].blue);
+      expected.set_alpha_val(x, y, i < 10 ? trans[i] : 255);
+    }
+  }
+
+  Filename filename = make_temp_filename("png");
+  if (!write_png(filename, PNG_COLOR_TYPE_PALETTE, 4, false, rows,
+                 palette, 16, trans, 10)) {
+    cerr << "Could not write " << filename << "\n";
+    return false;
+  }
+  return check_file("paletted PNG", filename, expected, true);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: test_gray_alpha
+//  Description: An 8-bit grayscale image with an alpha channel.
+////////////////////////////////////////////////////////////////////
+static bool
+test_gray_alpha() {
+  PNMImage expected(x_size, y_size, 2, 255);
+  pvector<string> rows;
+  for (int y = 0; y < y_size; ++y) {
+    string row;
+    for (int x = 0; x < x_size; ++x) {
+      int gray = (x * 7 + y * 11) & 0xff;
+      int alpha = (255 - x * 5 - y * 3) & 0xff;
+      row += (char)gray;
+      row += (char)alpha;
+      expected.set_gray_val(x, y, gray);
+      expected.set_alpha_val(x, y, alpha);
+    }
+    rows.push_back(row);
+  }
+
+  Filename filename = make_temp_filename("png");
+  if (!write_png(filename, PNG_COLOR_TYPE_GRAY_ALPHA, 8, false, rows)) {
+    cerr << "Could not write " << filename << "\n";
+    return false;
+  }
+  return check_file("grayscale+alpha PNG", filename, expected, true);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: test_16bit
+//  Description: A 16-bit RGB image, with values that differ in both
+//               bytes.
+////////////////////////////////////////////////////////////////////
+static bool
+test_16bit() {
+  PNMImage expected(x_size, y_size, 3, 65535);
+  pvector<string> rows;
+  for (int y = 0; y < y_size; ++y) {
+    string row;
+    for (int x = 0; x < x_size; ++x) {
+      int red = (x * 1771 + y * 37) & 0xffff;
+      int green = (x * 257 + y * 4099) & 0xffff;
+      int blue = (65535 - x * 1000 - y * 900) & 0xffff;
+      put16(row, red);
+      put16(row, green);
+      put16(row, blue);
+      expected.set_xel_val(x, y, red, green, blue);
+    }
+    rows.push_back(row);
+  }
+
+  Filename filename = make_temp_filename("png");
+  if (!write_png(filename, PNG_COLOR_TYPE_RGB, 16, false, rows)) {
+    cerr << "Could not write " << filename << "\n";
+    return false;
+  }
+  return check_file("16-bit PNG", filename, expected, true);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: test_2bit_gray
+//  Description: A 2-bit grayscale image, which libpng unpacks to one
+//               byte per pixel.
+////////////////////////////////////////////////////////////////////
+static bool
+test_2bit_gray() {
+  PNMImage expected(x_size, y_size, 1, 3);
+  pvector<string> rows;
+  for (int y = 0; y < y_size; ++y) {
+    string row((x_size + 3) / 4, '\0');
+    for (int x = 0; x < x_size; ++x) {
+      int gray = (x + y * 3) & 3;
+      row[x / 4] |= (char)(gray << (6 - (x % 4) * 2));
+      expected.set_gray_val(x, y, gray);
+    }
+    rows.push_back(row);
+  }
+
+  Filename filename = make_temp_filename("png");
+  if (!write_png(filename, PNG_COLOR_TYPE_GRAY, 2, false, rows)) {
+    cerr << "Could not write " << filename << "\n";
+    return false;
+  }
+  return check_file("2-bit grayscale PNG", filename, expected, true);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: test_interlaced
+//  Description: An interlaced 8-bit RGBA image, which can't be read a
+//               row at a time.
+////////////////////////////////////////////////////////////////////
+static bool
+test_interlaced() {
+  PNMImage expected(x_size, y_size, 4, 255);
+  pvector<string> rows;
+  for (int y = 0; y < y_size; ++y) {
+    string row;
+    for (int x = 0; x < x_size; ++x) {
+      int red = (x * 7) & 0xff;
+      int green = (y * 11) & 0xff;
+      int blue = ((x ^ y) * 5) & 0xff;
+      int alpha = (x * y) & 0xff;
+      row += (char)red;
+      row += (char)green;
+      row += (char)blue;
+      row += (char)alpha;
+      expected.set_xel_val(x, y, red, green, blue);
+      expected.set_alpha_val(x, y, alpha);
+    }
+    rows.push_back(row);
+  }
+
+  Filename filename = make_temp_filename("png");
+  if (!write_png(filename, PNG_COLOR_TYPE_RGB_ALPHA, 8, true, rows)) {
+    cerr << "Could not write " << filename << "\n";
+    return false;
+  }
+  return check_file("interlaced PNG", filename, expected, false);
+}
+
+#ifdef HAVE_JPEG
+////////////////////////////////////////////////////////////////////
+//     Function: decode_jpeg
+//  Description: Decodes the JPEG file directly with libjpeg, with its
+//               default settings, as an independent reference for
+//               the JPEG reader.  Returns true on success.
+////////////////////////////////////////////////////////////////////
+static bool
+decode_jpeg(const Filename &filename, PNMImage &image) {
+  string os_filename = filename.to_os_specific();
+  FILE *file = fopen(os_filename.c_str(), "rb");
+  if (file == (FILE *)NULL) {
+    return false;
+  }
+
+  struct jpeg_decompress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&cinfo);
+  jpeg_stdio_src(&cinfo, file);
+  jpeg_read_header(&cinfo, TRUE);
+  jpeg_start_decompress(&cinfo);
+
+  int width = cinfo.output_width;
+  int components = cinfo.output_components;
+  image.clear(width, cinfo.output_height, components, 255);
+  pvector<JSAMPLE> row(width * components);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    int y = cinfo.output_scanline;
+    JSAMPROW row_pointer = &row[0];
+    jpeg_read_scanlines(&cinfo, &row_pointer, 1);
+    for (int x = 0; x < width; ++x) {
+      if (components == 1) {
+        image.set_gray_val(x, y, row[x]);
+      } else {
+        image.set_xel_val(x, y, row[x * 3], row[x * 3 + 1], row[x * 3 + 2]);
+      }
+    }
+  }
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  fclose(file);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: test_jpeg
+//  Description: A color or grayscale JPEG, written with the JPEG
+//               writer and compared against libjpeg's decoding.
+////////////////////////////////////////////////////////////////////
+static bool
+test_jpeg(int num_channels) {
+  PNMImage source(x_size, y_size, num_channels, 255);
+  for (int y = 0; y < y_size; ++y) {
+    for (int x = 0; x < x_size; ++x) {
+      source.set_xel_val(x, y, (x * 7) & 0xff, (y * 11) & 0xff,
+                         ((x + y) * 5) & 0xff);
+    }
+  }
+
+  Filename filename = make_temp_filename("jpg");
+  if (!source.write(filename)) {
+    cerr << "Could not write " << filename << "\n";
+    return false;
+  }
+
+  PNMImage expected;
+  if (!decode_jpeg(filename, expected)) {
+    cerr << "Could not decode " << filename << "\n";
+    return false;
+  }
+  return check_file(num_channels == 1 ? "grayscale JPEG" : "color JPEG",
+                    filename, expected, true);
+}
+#endif  // HAVE_JPEG
+
+int
+main(int argc, char *argv[]) {
+  init_libpnmimagetypes();
+
+  bool ok = true;
+  ok = test_palette() && ok;
+  ok = test_gray_alpha() && ok;
+  ok = test_16bit() && ok;
+  ok = test_2bit_gray() && ok;
+  ok = test_interlaced() && ok;
+#ifdef HAVE_JPEG
+  ok = test_jpeg(3) && ok;
+  ok = test_jpeg(1) && ok;
+#endif  // HAVE_JPEG
+
+  for (size_t i = 0; i < temp_files.size(); ++i) {
+    temp_files[i].unlink();
+  }
+
+  if (!ok) {
+    cerr << "Row reading test failed!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -226,6 +226,9 @@ static LevelCollectorProperties level_properties[] = {
   { 1, "Dirty PipelineCyclers",            { 0.2, 0.2, 0.2 },  "", 5000 },
   { 1, "Collision Volumes",                { 1.0, 0.8, 0.5 },  "", 500 },
   { 1, "Collision Tests",                  { 0.5, 0.8, 1.0 },  "", 100 },
+  { 1, "VFS read cache",                   { 0.6, 0.4, 0.9 },  "", 100 },
+  { 1, "VFS read cache:Hits",              { 0.2, 0.8, 0.3 } },
+  { 1, "VFS read cache:Misses",            { 0.9, 0.3, 0.2 } },
   { 0, NULL }
 };
 
@@ -14,6 +14,7 @@
     bam.h \
     bamCache.h bamCache.I \
     bamCacheIndex.h bamCacheIndex.I \
+    bamCacheIndexFile.h bamCacheIndexFile.I \
     bamCacheRecord.h bamCacheRecord.I \
     bamEnums.h \
     bamReader.I bamReader.N bamReader.h bamReaderParam.I \
@@ -79,6 +80,7 @@
     autoTextureScale.cxx \
     bamCache.cxx \
     bamCacheIndex.cxx \
+    bamCacheIndexFile.cxx \
     bamCacheRecord.cxx \
     bamEnums.cxx \
     bamReader.cxx bamReaderParam.cxx \
@@ -127,6 +129,7 @@
     bam.h \
     bamCache.h bamCache.I \
     bamCacheIndex.h bamCacheIndex.I \
+    bamCacheIndexFile.h bamCacheIndexFile.I \
     bamCacheRecord.h bamCacheRecord.I \
     bamEnums.h \
     bamReader.I bamReader.h bamReaderParam.I bamReaderParam.h \
@@ -209,6 +212,17 @@
 
 #end test_bin_target
 
+#begin test_bin_target
+  #define TARGET test_bamCache
+
+  #define SOURCES \
+    test_bamCache.cxx
+
+  #define LOCAL_LIBS $[LOCAL_LIBS] p3putil
+  #define OTHER_LIBS $[OTHER_LIBS] p3pystub
+
+#end test_bin_target
+
 #begin test_bin_target
   #define TARGET test_filename
 
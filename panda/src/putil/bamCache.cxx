@@ -13,18 +13,23 @@
 ////////////////////////////////////////////////////////////////////
 
 #include "bamCache.h"
-#include "bamCacheIndex.h"
 #include "hashVal.h"
 #include "datagramInputFile.h"
 #include "datagramOutputFile.h"
 #include "config_util.h"
 #include "bam.h"
+#include "bamReader.h"
+#include "bamWriter.h"
 #include "typeRegistry.h"
 #include "string_utils.h"
 #include "configVariableInt.h"
 #include "configVariableString.h"
 #include "configVariableFilename.h"
 #include "virtualFileSystem.h"
+#include "configVariableEnum.h"
+#include "zStream.h"
+
+#include <algorithm>
 
 BamCache *BamCache::_global_ptr = NULL;
 
@@ -37,7 +42,7 @@ BamCache::
 BamCache() :
   _active(true),
   _read_only(false),
-  _index(new BamCacheIndex),
+  _index_file(NULL),
   _index_stale_since(0)
 {
   ConfigVariableFilename model_cache_dir
@@ -76,12 +81,26 @@ BamCache() :
     ("model-cache-max-kbytes", 10485760,
      PRC_DESC("This is the maximum size of the model cache, in kilobytes."));
 
+  ConfigVariableInt model_cache_compression
+    ("model-cache-compression", 0,
+     PRC_DESC("If this is nonzero, files written to the model cache are "
+              "compressed at this compression level, with the codec named "
+              "by model-cache-compression-codec.  This makes the cache "
+              "smaller, and may make it faster to load from a slow disk."));
+
+  ConfigVariableEnum<CompressionCodec> model_cache_compression_codec
+    ("model-cache-compression-codec", CC_lz,
+     PRC_DESC("The codec used to compress model cache files when "
+              "model-cache-compression is nonzero: either zlib or lz."));
+
   _cache_models = model_cache_models;
   _cache_textures = model_cache_textures;
   _cache_compressed_textures = model_cache_compressed_textures;
 
   _flush_time = model_cache_flush;
   _max_kbytes = model_cache_max_kbytes;
+  _compression_level = model_cache_compression;
+  _compression_codec = model_cache_compression_codec;
 
   if (!model_cache_dir.empty()) {
     set_root(model_cache_dir);
@@ -96,8 +115,13 @@ BamCache() :
 BamCache::
 ~BamCache() {
   flush_index();
-  delete _index;
-  _index = NULL;
+  set_index_file(NULL);
+
+  IndexFiles::iterator fi;
+  for (fi = _old_index_files.begin(); fi != _old_index_files.end(); ++fi) {
+    delete (*fi);
+  }
+  _old_index_files.clear();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -124,10 +148,8 @@ set_root(const Filename &root) {
     vfs->make_directory_full(_root);
   }
 
-  delete _index;
-  _index = new BamCacheIndex;
   _index_stale_since = 0;
-  read_index();
+  open_index();
   check_cache_size();
 
   nassertv(vfs->is_directory(_root));
@@ -154,29 +176,57 @@ set_root(const Filename &root) {
 //               record->set_data() to record the resulting loaded
 //               object; and finally, you should call store() to write
 //               the cached record to disk.
+//
+//               It is safe to call this from several threads at
+//               once.  The index is consulted without taking any
+//               lock, and the cache file is read directly from the
+//               location recorded there.
 ////////////////////////////////////////////////////////////////////
 PT(BamCacheRecord) BamCache::
 lookup(const Filename &source_filename, const string &cache_extension) {
-  ReMutexHolder holder(_lock);
-  consider_flush_index();
-
   VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
   
   Filename source_pathname(source_filename);
   source_pathname.make_absolute(vfs->get_cwd());
 
+  Filename root;
+  BamCacheIndexFile *index_file = get_index_file();
+  if (index_file != (BamCacheIndexFile *)NULL) {
+    root = index_file->get_root();
+  } else {
+    ReMutexHolder holder(_lock);
+    root = _root;
+  }
+
   Filename rel_pathname(source_pathname);
-  rel_pathname.make_relative_to(_root, false);
+  rel_pathname.make_relative_to(root, false);
   if (rel_pathname.is_local()) {
     // If the source pathname is already within the cache directory,
     // don't cache it further.
     return NULL;
   }
 
+  BamCacheIndexFile::Entry entry;
+  if (index_file != (BamCacheIndexFile *)NULL &&
+      index_file->find_entry(BamCacheIndexFile::make_key(source_pathname), entry) &&
+      entry._cache_filename.get_extension() == cache_extension) {
+    // The index already knows which cache file holds this source
+    // file, so we can go straight to it, without hashing the
+    // filename or walking through possible hash collisions.  If the
+    // file turns out to belong to some other source file after all,
+    // we fall back to the search below.
+    PT(BamCacheRecord) record = 
+      read_record(root, source_pathname, entry._cache_filename, 0);
+    if (record != (BamCacheRecord *)NULL) {
+      add_to_index(record);
+      return record;
+    }
+  }
+
   Filename cache_filename = hash_filename(source_pathname.get_fullpath());
   cache_filename.set_extension(cache_extension);
 
-  return find_and_read_record(source_pathname, cache_filename);
+  return find_and_read_record(root, source_pathname, cache_filename);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -191,23 +241,28 @@ lookup(const Filename &source_filename, const string &cache_extension) {
 bool BamCache::
 store(BamCacheRecord *record) {
   VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
-  ReMutexHolder holder(_lock);
   nassertr(!record->_cache_pathname.empty(), false);
   nassertr(record->has_data(), false);
 
-  if (_read_only) {
-    return false;
-  }
+  {
+    ReMutexHolder holder(_lock);
+    if (_read_only) {
+      return false;
+    }
   
-  consider_flush_index();
+    consider_flush_index();
 
 #ifndef NDEBUG
-  // Ensure that the cache_pathname is within the _root directory tree.
-  Filename rel_pathname(record->_cache_pathname);
-  rel_pathname.make_relative_to(_root, false);
-  nassertr(rel_pathname.is_local(), false);
+    // Ensure that the cache_pathname is within the _root directory tree.
+    Filename rel_pathname(record->_cache_pathname);
+    rel_pathname.make_relative_to(_root, false);
+    nassertr(rel_pathname.is_local(), false);
 #endif  // NDEBUG
+  }
 
+  // The file itself is written without holding the lock; since each
+  // thread writes to its own temporary filename, and the file is
+  // moved into place atomically, this is safe to do in parallel.
   record->_recorded_time = time(NULL);
 
   Filename cache_pathname = Filename::binary_filename(record->_cache_pathname);
@@ -221,10 +276,43 @@ store(BamCacheRecord *record) {
   temp_pathname.set_extension(extension);
   temp_pathname.set_binary();
 
+  int compression_level;
+  CompressionCodec compression_codec;
+  {
+    ReMutexHolder holder(_lock);
+    compression_level = _compression_level;
+    compression_codec = _compression_codec;
+  }
+
+#ifndef HAVE_ZLIB
+  compression_level = 0;
+#else
+  // If the file is to be compressed, we write it through an
+  // OCompressStream, which owns the file stream.  This must outlive
+  // dout.
+  OCompressStream compress;
+#endif
+
   DatagramOutputFile dout;
-  if (!dout.open(temp_pathname)) {
+  bool opened = false;
+  if (compression_level != 0) {
+#ifdef HAVE_ZLIB
+    ostream *raw_out = vfs->open_write_file(temp_pathname, false, true);
+    if (raw_out != (ostream *)NULL) {
+      compress.open(raw_out, true, compression_level, compression_codec);
+      opened = dout.open(compress, temp_pathname);
+    }
+#endif
+  } else {
+    opened = dout.open(temp_pathname);
+  }
+  if (!opened) {
     util_cat.error()
       << "Could not write cache file: " << temp_pathname << "\n";
+    dout.close();
+#ifdef HAVE_ZLIB
+    compress.close();
+#endif
     vfs->delete_file(temp_pathname);
     emergency_read_only();
     return false;
@@ -275,8 +363,19 @@ store(BamCacheRecord *record) {
     // delete any TypedWritables below that haven't been written yet.
   }
 
-  record->_record_size = dout.get_file_pos();
-  dout.close();
+  if (compression_level != 0) {
+    dout.close();
+#ifdef HAVE_ZLIB
+    compress.close();
+#endif
+    PT(VirtualFile) temp_file = vfs->get_file(temp_pathname);
+    if (temp_file != (VirtualFile *)NULL) {
+      record->_record_size = temp_file->get_file_size();
+    }
+  } else {
+    record->_record_size = dout.get_file_pos();
+    dout.close();
+  }
 
   // Now move the file into place.
   if (!vfs->rename_file(temp_pathname, cache_pathname) && vfs->exists(temp_pathname)) {
@@ -292,6 +391,10 @@ store(BamCacheRecord *record) {
 
   add_to_index(record);
 
+  ReMutexHolder holder(_lock);
+  mark_index_stale();
+  check_cache_size();
+
   return true;
 }
 
@@ -306,6 +409,7 @@ store(BamCacheRecord *record) {
 ////////////////////////////////////////////////////////////////////
 void BamCache::
 emergency_read_only() {
+  ReMutexHolder holder(_lock);
   util_cat.error() <<
     "Could not write to the Bam Cache.  Disabling future attempts.\n";
   _read_only = true;
@@ -332,6 +436,11 @@ consider_flush_index() {
 //     Function: BamCache::flush_index
 //       Access: Published
 //  Description: Ensures the index is written to disk.
+//
+//               The index is updated in place, one entry at a time,
+//               as records are stored, and other processes see each
+//               change immediately; this only waits for the pages of
+//               the index that have changed to be written out.
 ////////////////////////////////////////////////////////////////////
 void BamCache::
 flush_index() {
@@ -341,227 +450,172 @@ flush_index() {
     return;
   }
 
-  while (true) {
-    if (_read_only) {
-      return;
-    }
-
-    Filename temp_pathname = Filename::temporary(_root, "index-", ".boo");
-
-    if (!do_write_index(temp_pathname, _index)) {
-      emergency_read_only();
-      return;
-    }
-    
-    // Now atomically write the name of this index file to the index
-    // reference file.
-    VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
-    Filename index_ref_pathname(_root, Filename("index_name.txt"));
-    string old_index = _index_ref_contents;
-    string new_index = temp_pathname.get_basename() + "\n";
-    string orig_index;
-
-    if (vfs->atomic_compare_and_exchange_contents(index_ref_pathname, orig_index, old_index, new_index)) {
-      // We successfully wrote our version of the index, and no other
-      // process beat us to it.  Our index is now the official one.
-      // Remove the old index.
-      vfs->delete_file(_index_pathname);
-      _index_pathname = temp_pathname;
-      _index_ref_contents = new_index;
-      _index_stale_since = 0;
-      return;
-    }
-
-    // Shoot, some other process updated the index while we were
-    // trying to update it, and they beat us to it.  We have to merge,
-    // and try again.
-    vfs->delete_file(temp_pathname);
-    _index_pathname = Filename(_root, Filename(trim(orig_index)));
-    _index_ref_contents = orig_index;
-    read_index();
+  BamCacheIndexFile *index_file = 
+    (BamCacheIndexFile *)AtomicAdjust::get_ptr(_index_file);
+  if (index_file != (BamCacheIndexFile *)NULL && !index_file->flush()) {
+    util_cat.warning()
+      << "Unable to flush " << index_file->get_pathname() << "\n";
   }
-  check_cache_size();
+  _index_stale_since = 0;
 }
 
 ////////////////////////////////////////////////////////////////////
-//     Function: BamCache::read_index
+//     Function: BamCache::open_index
 //       Access: Private
-//  Description: Reads, or re-reads the index file from disk.  If
-//               _index_stale_since is nonzero, the index file is read
-//               and then merged with our current index.
+//  Description: Opens the index file currently named by the index
+//               reference file in the cache directory.  If there is
+//               no such file, or it can't be opened, builds a new one
+//               by scanning the directory.  The lock should already
+//               be held.
 ////////////////////////////////////////////////////////////////////
 void BamCache::
-read_index() {
-  if (!read_index_pathname(_index_pathname, _index_ref_contents)) {
-    // Couldn't read the index ref; rebuild the index.
-    rebuild_index();
-    return;
-  }
+open_index() {
+  VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
+  Filename index_ref_pathname(_root, Filename(BamCacheIndexFile::get_ref_basename()));
 
   while (true) {
-    BamCacheIndex *new_index = do_read_index(_index_pathname);
-    if (new_index != (BamCacheIndex *)NULL) {
-      merge_index(new_index);
+    string ref_contents;
+    if (!vfs->atomic_read_contents(index_ref_pathname, ref_contents)) {
+      // There's no reference file yet.
+      ref_contents = string();
+    }
+
+    string trimmed = trim(ref_contents);
+    if (!trimmed.empty()) {
+      BamCacheIndexFile *index_file = 
+        BamCacheIndexFile::open(Filename(_root, Filename(trimmed)), _root);
+      if (index_file != (BamCacheIndexFile *)NULL) {
+        _index_ref_contents = ref_contents;
+        set_index_file(index_file);
+        return;
+      }
+    }
+
+    if (_read_only) {
+      set_index_file(NULL);
       return;
     }
 
-    // We couldn't read the index.  Maybe it's been removed already.
-    // See if the index_pathname has changed.
-    Filename old_index_pathname = _index_pathname;
-    if (!read_index_pathname(_index_pathname, _index_ref_contents)) {
-      // Couldn't read the index ref; rebuild the index.
-      rebuild_index();
+    // There's no usable index; make a new one.
+    BamCacheIndexFile *index_file = rebuild_index();
+    if (index_file == (BamCacheIndexFile *)NULL) {
+      set_index_file(NULL);
       return;
     }
 
-    if (old_index_pathname == _index_pathname) {
-      // Nope, we just couldn't read it.  Delete it and build a new
-      // one.
-      VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
-      vfs->delete_file(_index_pathname);
-      rebuild_index();
-      flush_index();
+    string orig_contents = ref_contents;
+    if (publish_index(index_file, ref_contents)) {
+      set_index_file(index_file);
+      return;
+    }
+
+    Filename pathname = index_file->get_pathname();
+    delete index_file;
+    vfs->delete_file(pathname);
+
+    if (ref_contents == orig_contents) {
+      // We couldn't write the reference file at all.
+      util_cat.error()
+        << "Could not write " << index_ref_pathname << "\n";
+      emergency_read_only();
+      set_index_file(NULL);
       return;
     }
+
+    // Otherwise, some other process published an index while we were
+    // building ours.  Go back and use theirs instead.
   }
 }
 
 ////////////////////////////////////////////////////////////////////
-//     Function: BamCache::read_index_pathname
+//     Function: BamCache::reopen_index
 //       Access: Private
-//  Description: Atomically reads the current index filename from the
-//               index reference file.  The index filename moves
-//               around as different processes update the index.
+//  Description: Called when the current index file has been marked
+//               as moved, to open the file that replaced it.  The
+//               lock should already be held.
 ////////////////////////////////////////////////////////////////////
-bool BamCache::
-read_index_pathname(Filename &index_pathname, string &index_ref_contents) const {
-  VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
-  index_ref_contents.clear();
-  Filename index_ref_pathname(_root, Filename("index_name.txt"));
-  if (!vfs->atomic_read_contents(index_ref_pathname, index_ref_contents)) {
-    return false;
-  }
-
-  string trimmed = trim(index_ref_contents);
-  if (trimmed.empty()) {
-    index_pathname = Filename();
-  } else {
-    index_pathname = Filename(_root, Filename(trimmed));
+void BamCache::
+reopen_index() {
+  BamCacheIndexFile *index_file = 
+    (BamCacheIndexFile *)AtomicAdjust::get_ptr(_index_file);
+  if (index_file != (BamCacheIndexFile *)NULL && index_file->is_moved()) {
+    open_index();
   }
-  return true;
 }
 
 ////////////////////////////////////////////////////////////////////
-//     Function: BamCache::merge_index
+//     Function: BamCache::grow_index
 //       Access: Private
-//  Description: The supplied index file has been updated by some other
-//               process.  Merge it with our current index.
-//
-//               Ownership of the pointer is transferred with this
-//               call.  The caller should assume that new_index will
-//               be deleted by this method.
+//  Description: Replaces the current index file, which has filled
+//               up, with a larger one, and copies all of its entries
+//               into the new one.  The lock should already be held.
 ////////////////////////////////////////////////////////////////////
 void BamCache::
-merge_index(BamCacheIndex *new_index) {
-  if (_index_stale_since == 0) {
-    // If our index isn't stale, just replace it.
-    delete _index;
-    _index = new_index;
+grow_index() {
+  BamCacheIndexFile *old_file = 
+    (BamCacheIndexFile *)AtomicAdjust::get_ptr(_index_file);
+  if (old_file == (BamCacheIndexFile *)NULL || !old_file->is_full()) {
+    // Another thread already took care of it.
+    return;
+  }
+  if (old_file->is_moved()) {
+    // And another process took care of it.
+    open_index();
     return;
   }
 
-  BamCacheIndex *old_index = _index;
-  old_index->release_records();
-  new_index->release_records();
-  _index = new BamCacheIndex;
-
-  BamCacheIndex::Records::const_iterator ai = old_index->_records.begin();
-  BamCacheIndex::Records::const_iterator bi = new_index->_records.begin();
-  
-  while (ai != old_index->_records.end() && 
-         bi != new_index->_records.end()) {
-    if ((*ai).first < (*bi).first) {
-      // Here is an entry we have in our index, not present in the new
-      // index.
-      PT(BamCacheRecord) record = (*ai).second;
-      Filename cache_pathname(_root, record->get_cache_filename());
-      if (cache_pathname.exists()) {
-        // The file exists; keep it.
-        _index->_records.insert(_index->_records.end(), BamCacheIndex::Records::value_type(record->get_source_pathname(), record));
-      }
-      ++ai;
-
-    } else if ((*bi).first < (*ai).first) {
-      // Here is an entry in the new index, not present in our index.
-      PT(BamCacheRecord) record = (*bi).second;
-      Filename cache_pathname(_root, record->get_cache_filename());
-      if (cache_pathname.exists()) {
-        // The file exists; keep it.
-        _index->_records.insert(_index->_records.end(), BamCacheIndex::Records::value_type(record->get_source_pathname(), record));
-      }
-      ++bi;
-
-    } else {
-      // Here is an entry we have in both.
-      PT(BamCacheRecord) a_record = (*ai).second;
-      PT(BamCacheRecord) b_record = (*bi).second;
-      if (*a_record == *b_record) {
-        // They're the same entry.  It doesn't really matter which one
-        // we keep.
-        _index->_records.insert(_index->_records.end(), BamCacheIndex::Records::value_type(a_record->get_source_pathname(), a_record));
-
-      } else {
-        // They're different.  Just throw them both away, and re-read
-        // the current data from the cache file.
-
-        Filename cache_pathname(_root, a_record->get_cache_filename());
+  BamCacheIndexFile::Entries entries;
+  old_file->get_entries(entries);
 
-        if (cache_pathname.exists()) {
-          PT(BamCacheRecord) record = do_read_record(cache_pathname, false);
-          if (record != (BamCacheRecord *)NULL) {
-            _index->_records.insert(_index->_records.end(), BamCacheIndex::Records::value_type(record->get_source_pathname(), record));
-          }
-        }
-      }
+  // Removed entries are not copied, so if most of the used slots held
+  // removed entries, the new table may be no larger than the old one.
+  BamCacheIndexFile *new_file = make_index_file((int)entries.size());
+  if (new_file == (BamCacheIndexFile *)NULL) {
+    return;
+  }
 
-      ++ai;
-      ++bi;
-    }
+  BamCacheIndexFile::Entries::const_iterator ei;
+  for (ei = entries.begin(); ei != entries.end(); ++ei) {
+    new_file->set_entry(*ei);
   }
 
-  while (ai != old_index->_records.end()) {
-    // Here is an entry we have in our index, not present in the new
-    // index.
-    PT(BamCacheRecord) record = (*ai).second;
-    Filename cache_pathname(_root, record->get_cache_filename());
-    if (cache_pathname.exists()) {
-      // The file exists; keep it.
-      _index->_records.insert(_index->_records.end(), BamCacheIndex::Records::value_type(record->get_source_pathname(), record));
-    }
-    ++ai;
+  string ref_contents = _index_ref_contents;
+  if (!publish_index(new_file, ref_contents)) {
+    // Another process replaced the index first.
+    VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
+    Filename pathname = new_file->get_pathname();
+    delete new_file;
+    vfs->delete_file(pathname);
+    open_index();
+    return;
   }
-   
-  while (bi != new_index->_records.end()) {
-    // Here is an entry in the new index, not present in our index.
-    PT(BamCacheRecord) record = (*bi).second;
-    Filename cache_pathname(_root, record->get_cache_filename());
-    if (cache_pathname.exists()) {
-      // The file exists; keep it.
-      _index->_records.insert(_index->_records.end(), BamCacheIndex::Records::value_type(record->get_source_pathname(), record));
-    }
-    ++bi;
+
+  if (util_cat.is_debug()) {
+    util_cat.debug()
+      << "Moved " << entries.size() << " cache index entries from "
+      << old_file->get_pathname() << " to " << new_file->get_pathname()
+      << "\n";
   }
 
-  _index->process_new_records();
+  // Tell any other processes that still have the old file open to
+  // look for the new one.  They can go on using the old file until
+  // they notice, but anything they add to it in the meantime will be
+  // lost.
+  old_file->set_moved();
+  VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
+  vfs->delete_file(old_file->get_pathname());
+
+  set_index_file(new_file);
 }
 
 ////////////////////////////////////////////////////////////////////
 //     Function: BamCache::rebuild_index
 //       Access: Private
-//  Description: Regenerates the index from scratch by scanning the
-//               directory.
+//  Description: Builds a new index file from scratch by scanning the
+//               directory.  Returns the new file, which has not yet
+//               been published, or NULL on failure.
 ////////////////////////////////////////////////////////////////////
-void BamCache::
+BamCacheIndexFile *BamCache::
 rebuild_index() {
   VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
 
@@ -570,20 +624,18 @@ rebuild_index() {
     util_cat.error()
       << "Unable to read directory " << _root << ", caching disabled.\n";
     set_active(false);
-    return;
+    return NULL;
   }
 
-  delete _index;
-  _index = new BamCacheIndex;
+  typedef pvector< PT(BamCacheRecord) > Records;
+  Records records;
 
   int num_files = contents->get_num_files();
   for (int ci = 0; ci < num_files; ++ci) {
     VirtualFile *file = contents->get_file(ci);
-    Filename filename = file->get_filename();
-    if (filename.get_extension() == "bam" ||
-        filename.get_extension() == "txo") {
-      Filename pathname(_root, filename);
-
+    Filename pathname = file->get_filename();
+    if (pathname.get_extension() == "bam" ||
+        pathname.get_extension() == "txo") {
       PT(BamCacheRecord) record = do_read_record(pathname, false);
       if (record == (BamCacheRecord *)NULL) {
         // Well, it was invalid, so blow it away.
@@ -594,38 +646,155 @@ rebuild_index() {
         file->delete_file();
 
       } else {
-        record->_record_access_time = record->_recorded_time;
-
-        bool inserted = _index->_records.insert(BamCacheIndex::Records::value_type(record->get_source_pathname(), record)).second;
-        if (!inserted) {
-          util_cat.info()
-            << "Multiple cache files defining " << record->get_source_pathname() << "\n";
-          file->delete_file();
-        }
+        // The record may not know its own filename, if it was
+        // written after a hash collision.
+        record->_cache_filename = pathname.get_basename();
+        records.push_back(record);
       }
     }
   }
-  _index->process_new_records();
 
-  _index_stale_since = time(NULL);
-  check_cache_size();
-  flush_index();
+  BamCacheIndexFile *index_file = make_index_file((int)records.size());
+  if (index_file == (BamCacheIndexFile *)NULL) {
+    return NULL;
+  }
+
+  Records::const_iterator ri;
+  for (ri = records.begin(); ri != records.end(); ++ri) {
+    BamCacheRecord *record = (*ri);
+    BamCacheIndexFile::Entry entry;
+    entry._key = BamCacheIndexFile::make_key(record->get_source_pathname());
+    if (index_file->find_entry(entry._key, entry)) {
+      util_cat.info()
+        << "Multiple cache files defining " << record->get_source_pathname() << "\n";
+      vfs->delete_file(Filename(_root, record->get_cache_filename()));
+      continue;
+    }
+
+    entry._cache_filename = record->get_cache_filename();
+    entry._record_size = record->_record_size;
+    entry._recorded_time = record->_recorded_time;
+    entry._access_time = record->_recorded_time;
+    index_file->set_entry(entry);
+  }
+
+  if (util_cat.is_debug()) {
+    util_cat.debug()
+      << "Rebuilt cache index " << index_file->get_pathname() << " with "
+      << records.size() << " entries.\n";
+  }
+
+  return index_file;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCache::make_index_file
+//       Access: Private
+//  Description: Creates a new, empty index file in the cache
+//               directory, with room for at least the indicated
+//               number of entries.  Returns NULL (and puts the cache
+//               into read-only mode) on failure.
+////////////////////////////////////////////////////////////////////
+BamCacheIndexFile *BamCache::
+make_index_file(int min_entries) {
+  Filename ref_basename(BamCacheIndexFile::get_ref_basename());
+  string prefix = ref_basename.get_basename_wo_extension() + "-";
+
+  // Filename::temporary() may, rarely, name a file that someone else
+  // creates before we do.
+  for (int tries = 0; tries < 10; ++tries) {
+    Filename pathname = Filename::temporary(_root, prefix, ".bci");
+    BamCacheIndexFile *index_file = 
+      BamCacheIndexFile::create(pathname, _root, min_entries);
+    if (index_file != (BamCacheIndexFile *)NULL) {
+      return index_file;
+    }
+    if (!pathname.exists()) {
+      break;
+    }
+  }
+
+  util_cat.error()
+    << "Could not create cache index file in " << _root << "\n";
+  emergency_read_only();
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCache::publish_index
+//       Access: Private
+//  Description: Atomically replaces the name in the index reference
+//               file with the name of the indicated index file, as
+//               long as the reference file still contains
+//               ref_contents.  Returns true on success.  If another
+//               process changed the reference file first, returns
+//               false and fills ref_contents with what it wrote.
+////////////////////////////////////////////////////////////////////
+bool BamCache::
+publish_index(BamCacheIndexFile *index_file, string &ref_contents) {
+  VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
+  Filename index_ref_pathname(_root, Filename(BamCacheIndexFile::get_ref_basename()));
+  string new_contents = index_file->get_pathname().get_basename() + "\n";
+  string orig_contents;
+
+  if (vfs->atomic_compare_and_exchange_contents(index_ref_pathname, orig_contents,
+                                                ref_contents, new_contents)) {
+    _index_ref_contents = new_contents;
+    return true;
+  }
+
+  ref_contents = orig_contents;
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCache::set_index_file
+//       Access: Private
+//  Description: Makes the indicated index file (which may be NULL)
+//               the current index.  The previous one is kept until
+//               the BamCache is destroyed, since other threads may
+//               still be looking things up in it.  The lock should
+//               already be held.
+////////////////////////////////////////////////////////////////////
+void BamCache::
+set_index_file(BamCacheIndexFile *index_file) {
+  BamCacheIndexFile *old_file = 
+    (BamCacheIndexFile *)AtomicAdjust::set_ptr(_index_file, index_file);
+  if (old_file != (BamCacheIndexFile *)NULL && old_file != index_file) {
+    _old_index_files.push_back(old_file);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////
 //     Function: BamCache::add_to_index
 //       Access: Private
 //  Description: Updates the index entry for the indicated record.
-//               Note that a copy of the record is made first.
+//               Only the one entry is written; this takes no lock,
+//               unless the index has filled up and must be replaced.
 ////////////////////////////////////////////////////////////////////
 void BamCache::
 add_to_index(const BamCacheRecord *record) {
-  PT(BamCacheRecord) new_record = record->make_copy();
+  BamCacheIndexFile *index_file = get_index_file();
+  if (index_file == (BamCacheIndexFile *)NULL) {
+    return;
+  }
 
-  if (_index->add_record(new_record)) {
-    mark_index_stale();
-    check_cache_size();
+  if (index_file->is_full()) {
+    ReMutexHolder holder(_lock);
+    grow_index();
+    index_file = (BamCacheIndexFile *)AtomicAdjust::get_ptr(_index_file);
+    if (index_file == (BamCacheIndexFile *)NULL) {
+      return;
+    }
   }
+
+  BamCacheIndexFile::Entry entry;
+  entry._key = BamCacheIndexFile::make_key(record->get_source_pathname());
+  entry._cache_filename = record->get_cache_filename();
+  entry._record_size = record->_record_size;
+  entry._recorded_time = record->_recorded_time;
+  entry._access_time = time(NULL);
+  index_file->set_entry(entry);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -636,8 +805,9 @@ add_to_index(const BamCacheRecord *record) {
 ////////////////////////////////////////////////////////////////////
 void BamCache::
 remove_from_index(const Filename &source_pathname) {
-  if (_index->remove_record(source_pathname)) {
-    mark_index_stale();
+  BamCacheIndexFile *index_file = get_index_file();
+  if (index_file != (BamCacheIndexFile *)NULL) {
+    index_file->remove_entry(BamCacheIndexFile::make_key(source_pathname));
   }
 }
 
@@ -645,24 +815,35 @@ remove_from_index(const Filename &source_pathname) {
 //     Function: BamCache::check_cache_size
 //       Access: Private
 //  Description: If the cache size has exceeded its specified size
-//               limit, removes an old file.
+//               limit, removes the least recently used files.  The
+//               lock should already be held.
+//
+//               Finding the oldest files means visiting the whole
+//               index, so a few more files are removed than strictly
+//               necessary, to leave room for the next few files to
+//               be stored.
 ////////////////////////////////////////////////////////////////////
 void BamCache::
 check_cache_size() {
-  if (_index->_cache_size == 0) {
-    // 0 means no limit.
+  BamCacheIndexFile *index_file = 
+    (BamCacheIndexFile *)AtomicAdjust::get_ptr(_index_file);
+  if (index_file == (BamCacheIndexFile *)NULL ||
+      index_file->get_cache_kbytes() <= _max_kbytes) {
     return;
   }
 
-  if (_index->_cache_size / 1024 > _max_kbytes) {
-    while (_index->_cache_size / 1024 > _max_kbytes) {
-      PT(BamCacheRecord) record = _index->evict_old_file();
-      if (record == NULL) {
-        // Never mind; the cache is empty.
-        break;
-      }
-      VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
-      Filename cache_pathname(_root, record->get_cache_filename());
+  BamCacheIndexFile::Entries entries;
+  index_file->get_entries(entries);
+  sort(entries.begin(), entries.end(), BamCacheIndexFile::SortByAccessTime());
+
+  VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
+  int target_kbytes = _max_kbytes - _max_kbytes / 16;
+  BamCacheIndexFile::Entries::const_iterator ei;
+  for (ei = entries.begin(); 
+       ei != entries.end() && index_file->get_cache_kbytes() > target_kbytes;
+       ++ei) {
+    if (index_file->evict_entry(*ei)) {
+      Filename cache_pathname(_root, (*ei)._cache_filename);
       if (util_cat.is_debug()) {
         util_cat.debug()
           << "Deleting " << cache_pathname
@@ -670,109 +851,8 @@ check_cache_size() {
       }
       vfs->delete_file(cache_pathname);
     }
-    mark_index_stale();
   }
-}
-
-////////////////////////////////////////////////////////////////////
-//     Function: BamCache::do_read_index
-//       Access: Private, Static
-//  Description: Reads the index data from the specified filename.
-//               Returns a newly-allocated BamCacheIndex object on
-//               success, or NULL on failure.
-////////////////////////////////////////////////////////////////////
-BamCacheIndex *BamCache::
-do_read_index(const Filename &index_pathname) {
-  if (index_pathname.empty()) {
-    return NULL;
-  }
-
-  DatagramInputFile din;
-  if (!din.open(index_pathname)) {
-    util_cat.debug()
-      << "Could not read index file: " << index_pathname << "\n";
-    return NULL;
-  }
-  
-  string head;
-  if (!din.read_header(head, _bam_header.size())) {
-    util_cat.debug()
-      << index_pathname << " is not an index file.\n";
-    return NULL;
-  }
-  
-  if (head != _bam_header) {
-    util_cat.debug()
-      << index_pathname << " is not an index file.\n";
-    return NULL;
-  }
-  
-  BamReader reader(&din);
-  if (!reader.init()) {
-    return NULL;
-  }
-
-  TypedWritable *object = reader.read_object();
-
-  if (object == (TypedWritable *)NULL) {
-    util_cat.error()
-      << "Cache index " << index_pathname << " is empty.\n";
-    return NULL;
-
-  } else if (!object->is_of_type(BamCacheIndex::get_class_type())) {
-    util_cat.error()
-      << "Cache index " << index_pathname << " contains a "
-      << object->get_type() << ", not a BamCacheIndex.\n";
-    return NULL;
-  }
-
-  BamCacheIndex *index = DCAST(BamCacheIndex, object);
-  if (!reader.resolve()) {
-    util_cat.error()
-      << "Unable to fully resolve cache index file.\n";
-    return NULL;
-  }
-
-  return index;
-}
-
-////////////////////////////////////////////////////////////////////
-//     Function: BamCache::do_write_index
-//       Access: Private, Static
-//  Description: Writes the given index data to the specified filename.
-////////////////////////////////////////////////////////////////////
-bool BamCache::
-do_write_index(const Filename &index_pathname, const BamCacheIndex *index) {
-  VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
-  DatagramOutputFile dout;
-  if (!dout.open(index_pathname)) {
-    util_cat.error()
-      << "Could not write index file: " << index_pathname << "\n";
-    vfs->delete_file(index_pathname);
-    return false;
-  }
-
-  if (!dout.write_header(_bam_header)) {
-    util_cat.error()
-      << "Unable to write to " << index_pathname << "\n";
-    vfs->delete_file(index_pathname);
-    return false;
-  }
-
-  {
-    BamWriter writer(&dout);
-    if (!writer.init()) {
-      vfs->delete_file(index_pathname);
-      return false;
-    }
-    
-    if (!writer.write_object(index)) {
-      vfs->delete_file(index_pathname);
-      return false;
-    }
-  }
-
-  return true;
+  mark_index_stale();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -785,12 +865,13 @@ do_write_index(const Filename &index_pathname, const BamCacheIndex *index) {
 //               filename.
 ////////////////////////////////////////////////////////////////////
 PT(BamCacheRecord) BamCache::
-find_and_read_record(const Filename &source_pathname, 
+find_and_read_record(const Filename &root,
+                     const Filename &source_pathname, 
                      const Filename &cache_filename) {
   int pass = 0;
   while (true) {
     PT(BamCacheRecord) record = 
-      read_record(source_pathname, cache_filename, pass);
+      read_record(root, source_pathname, cache_filename, pass);
     if (record != (BamCacheRecord *)NULL) {
       add_to_index(record);
       return record;
@@ -805,17 +886,27 @@ find_and_read_record(const Filename &source_pathname,
 //  Description: Reads the indicated cache file and returns its
 //               associated record if it can be read and it matches
 //               the source filename.
+//
+//               This is called without holding the lock, so it must
+//               not access the index except through add_to_index()
+//               and remove_from_index().
 ////////////////////////////////////////////////////////////////////
 PT(BamCacheRecord) BamCache::
-read_record(const Filename &source_pathname, 
+read_record(const Filename &root,
+            const Filename &source_pathname, 
             const Filename &cache_filename,
             int pass) {
   VirtualFileSystem *vfs = VirtualFileSystem::get_global_ptr();
-  Filename cache_pathname(_root, cache_filename);
+  Filename cache_pathname(root, cache_filename);
+  Filename actual_cache_filename = cache_filename;
   if (pass != 0) {
     ostringstream strm;
     strm << cache_pathname.get_basename_wo_extension() << "_" << pass;
     cache_pathname.set_basename_wo_extension(strm.str());
+
+    // Record the actual filename we ended up with, so that the index
+    // can lead us directly back to it next time.
+    actual_cache_filename.set_basename_wo_extension(strm.str());
   }
   
   if (!cache_pathname.exists()) {
@@ -825,7 +916,7 @@ read_record(const Filename &source_pathname,
         << "Declaring new cache file " << cache_pathname << " for " << source_pathname << "\n";
     }
     PT(BamCacheRecord) record =
-      new BamCacheRecord(source_pathname, cache_filename);
+      new BamCacheRecord(source_pathname, actual_cache_filename);
     record->_cache_pathname = cache_pathname;
     return record;
   }
@@ -846,7 +937,7 @@ read_record(const Filename &source_pathname,
     remove_from_index(source_pathname);
 
     PT(BamCacheRecord) record =
-      new BamCacheRecord(source_pathname, cache_filename);
+      new BamCacheRecord(source_pathname, actual_cache_filename);
     record->_cache_pathname = cache_pathname;
     return record;
   }
@@ -878,6 +969,11 @@ read_record(const Filename &source_pathname,
 ////////////////////////////////////////////////////////////////////
 PT(BamCacheRecord) BamCache::
 do_read_record(const Filename &cache_pathname, bool read_data) {
+#ifdef HAVE_ZLIB
+  // This must outlive din.
+  IDecompressStream decompress;
+#endif
+
   DatagramInputFile din;
   if (!din.open(cache_pathname)) {
     if (util_cat.is_debug()) {
@@ -886,6 +982,7 @@ do_read_record(const Filename &cache_pathname, bool read_data) {
     }
     return NULL;
   }
+  PT(VirtualFile) vfile = din.get_vfile();
   
   string head;
   if (!din.read_header(head, _bam_header.size())) {
@@ -895,6 +992,21 @@ do_read_record(const Filename &cache_pathname, bool read_data) {
     }
     return NULL;
   }
+
+#ifdef HAVE_ZLIB
+  if (head != _bam_header) {
+    // It might have been compressed; see set_compression_level().
+    // The decompressor recognizes the codec by itself.
+    istream *source = vfile->open_read_file(false);
+    if (source != (istream *)NULL) {
+      decompress.open(source, true);
+      if (!din.open(decompress, cache_pathname) ||
+          !din.read_header(head, _bam_header.size())) {
+        head = string();
+      }
+    }
+  }
+#endif  // HAVE_ZLIB
   
   if (head != _bam_header) {
     if (util_cat.is_debug()) {
@@ -961,10 +1073,14 @@ do_read_record(const Filename &cache_pathname, bool read_data) {
   }
   
   // Also get the total file size.
-  PT(VirtualFile) vfile = din.get_vfile();
-  istream &in = din.get_stream();
-  in.clear();
-  record->_record_size = vfile->get_file_size(&in);
+  if (din.get_vfile() != (VirtualFile *)NULL) {
+    istream &in = din.get_stream();
+    in.clear();
+    record->_record_size = vfile->get_file_size(&in);
+  } else {
+    // We were reading a compressed file.
+    record->_record_size = vfile->get_file_size();
+  }
 
   // And the last access time is now, duh.
   record->_record_access_time = time(NULL);
@@ -17,17 +17,18 @@
 
 #include "pandabase.h"
 #include "bamCacheRecord.h"
+#include "bamCacheIndexFile.h"
 #include "pointerTo.h"
 #include "filename.h"
 #include "pmap.h"
 #include "pvector.h"
 #include "reMutex.h"
 #include "reMutexHolder.h"
+#include "compressionCodec.h"
+#include "atomicAdjust.h"
 
 #include <time.h>
 
-class BamCacheIndex;
-
 ////////////////////////////////////////////////////////////////////
 //       Class : BamCache
 // Description : This class maintains a cache of Bam and/or Txo
@@ -36,13 +37,12 @@ class BamCacheIndex;
 //               that can be stored in bam file format).
 //
 //               This class also maintains a persistent index that
-//               lists all of the cached objects (see BamCacheIndex).
-//               We go through some considerable effort to make sure
-//               this index gets saved correctly to disk, even in the
-//               presence of multiple different processes writing to
-//               the same index, and without relying too heavily on
-//               low-level os-provided file locks (which work poorly
-//               with C++ iostreams).
+//               lists all of the cached objects (see
+//               BamCacheIndexFile).  The index is a memory-mapped
+//               hash table, shared by all of the processes using the
+//               same cache directory, in which each entry is updated
+//               in place on its own.  Looking up an entry takes no
+//               lock, so many threads may consult the cache at once.
 ////////////////////////////////////////////////////////////////////
 class EXPCL_PANDA_PUTIL BamCache {
 PUBLISHED:
@@ -70,6 +70,11 @@ PUBLISHED:
   INLINE void set_cache_max_kbytes(int max_kbytes);
   INLINE int get_cache_max_kbytes() const;
 
+  INLINE void set_compression_level(int compression_level);
+  INLINE int get_compression_level() const;
+  INLINE void set_compression_codec(CompressionCodec codec);
+  INLINE CompressionCodec get_compression_codec() const;
+
   INLINE void set_read_only(bool ro);
   INLINE bool get_read_only() const;
 
@@ -83,11 +88,14 @@ PUBLISHED:
   INLINE static BamCache *get_global_ptr();
 
 private:
-  void read_index();
-  bool read_index_pathname(Filename &index_pathname,
-                           string &index_ref_contents) const;
-  void merge_index(BamCacheIndex *new_index);
-  void rebuild_index();
+  INLINE BamCacheIndexFile *get_index_file();
+  void open_index();
+  void reopen_index();
+  void grow_index();
+  BamCacheIndexFile *rebuild_index();
+  BamCacheIndexFile *make_index_file(int min_entries);
+  bool publish_index(BamCacheIndexFile *index_file, string &ref_contents);
+  void set_index_file(BamCacheIndexFile *index_file);
   INLINE void mark_index_stale();
 
   void add_to_index(const BamCacheRecord *record);
@@ -96,13 +104,12 @@ private:
   void check_cache_size();
 
   void emergency_read_only();
-  
-  static BamCacheIndex *do_read_index(const Filename &index_pathname);
-  static bool do_write_index(const Filename &index_pathname, const BamCacheIndex *index);
 
-  PT(BamCacheRecord) find_and_read_record(const Filename &source_pathname,
+  PT(BamCacheRecord) find_and_read_record(const Filename &root,
+                                          const Filename &source_pathname,
                                           const Filename &cache_filename);
-  PT(BamCacheRecord) read_record(const Filename &source_pathname,
+  PT(BamCacheRecord) read_record(const Filename &root,
+                                 const Filename &source_pathname,
                                  const Filename &cache_filename,
                                  int pass);
   static PT(BamCacheRecord) do_read_record(const Filename &cache_pathname, 
@@ -119,12 +126,19 @@ private:
   Filename _root;
   int _flush_time;
   int _max_kbytes;
+  int _compression_level;
+  CompressionCodec _compression_codec;
   static BamCache *_global_ptr;
 
-  BamCacheIndex *_index;
+  // The current index, which may be read without holding the lock.
+  // Index files that have been replaced are kept in _old_index_files
+  // (and remain mapped) until the BamCache is destroyed, since other
+  // threads may still be reading them.
+  AtomicAdjust::Pointer _index_file;  // BamCacheIndexFile *
+  typedef pvector<BamCacheIndexFile *> IndexFiles;
+  IndexFiles _old_index_files;
   time_t _index_stale_since;
 
-  Filename _index_pathname;
   string _index_ref_contents;
 
   ReMutex _lock;
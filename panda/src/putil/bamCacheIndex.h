@@ -26,13 +26,13 @@
 
 ////////////////////////////////////////////////////////////////////
 //       Class : BamCacheIndex
-// Description : This represents the in-memory index that records the
-//               list of files stored in the BamCache.  Since the
-//               memory is also flushed to disk from time to time,
-//               this class is a TypedWritable object.
-//
-//               For the most part, this class is used only by the
-//               BamCache class.
+// Description : This represents the index that records the list of
+//               files stored in the BamCache, as it was written by
+//               older versions of Panda, which rewrote the whole
+//               index to a bam file from time to time.  The BamCache
+//               now keeps its index in a BamCacheIndexFile instead;
+//               this class remains so that old index files can still
+//               be examined, e.g. by bam-info.
 ////////////////////////////////////////////////////////////////////
 class EXPCL_PANDA_PUTIL BamCacheIndex : public TypedWritable, public LinkedListNode {
 private:
@@ -0,0 +1,626 @@
+// Filename: bamCacheIndexFile.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "bamCacheIndexFile.h"
+#include "config_util.h"
+#include "thread.h"
+
+#include <string.h>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const char BamCacheIndexFile::_magic[4] = { 'p', 'b', 'c', 'i' };
+const PN_uint16 BamCacheIndexFile::_current_version = 1;
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::Constructor
+//       Access: Private
+//  Description: Use create() or open() to make a BamCacheIndexFile.
+////////////////////////////////////////////////////////////////////
+BamCacheIndexFile::
+BamCacheIndexFile(const Filename &pathname, const Filename &root,
+                  char *base, size_t map_size) :
+  _pathname(pathname),
+  _root(root),
+  _base(base),
+  _map_size(map_size)
+{
+  nassertv(sizeof(Header) <= header_size);
+  _slot_mask = (size_t)get_header()->_num_slots - 1;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::Destructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+BamCacheIndexFile::
+~BamCacheIndexFile() {
+  unmap_file(_base, _map_size);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::create
+//       Access: Public, Static
+//  Description: Creates a new, empty index file with the indicated
+//               name, with room for at least min_entries entries
+//               before it fills up.  The file must not already
+//               exist.  Returns the new object, or NULL on failure.
+////////////////////////////////////////////////////////////////////
+BamCacheIndexFile *BamCacheIndexFile::
+create(const Filename &pathname, const Filename &root, int min_entries) {
+  // Leave the table no more than half full to begin with.
+  size_t num_slots = 1024;
+  while (num_slots < (size_t)min_entries * 2) {
+    num_slots <<= 1;
+  }
+
+  size_t map_size = header_size + num_slots * sizeof(Slot);
+  char *base;
+  if (!map_file(pathname, map_size, true, base)) {
+    return NULL;
+  }
+
+  // The file is created filled with zeroes, which is an empty table.
+  Header *header = (Header *)base;
+  memcpy(header->_magic, _magic, sizeof(_magic));
+  header->_version = _current_version;
+  header->_integer_size = sizeof(AtomicAdjust::Integer);
+  header->_num_slots = (PN_uint32)num_slots;
+  header->_slot_size = sizeof(Slot);
+
+  return new BamCacheIndexFile(pathname, root, base, map_size);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::open
+//       Access: Public, Static
+//  Description: Opens an existing index file, which may be in use by
+//               other processes at the same time.  Returns the new
+//               object, or NULL if the file cannot be opened or was
+//               not written with the same layout.
+////////////////////////////////////////////////////////////////////
+BamCacheIndexFile *BamCacheIndexFile::
+open(const Filename &pathname, const Filename &root) {
+  size_t map_size = 0;
+  char *base;
+  if (!map_file(pathname, map_size, false, base)) {
+    return NULL;
+  }
+
+  const Header *header = (const Header *)base;
+  size_t num_slots = 0;
+  if (map_size >= header_size &&
+      memcmp(header->_magic, _magic, sizeof(_magic)) == 0 &&
+      header->_version == _current_version &&
+      header->_integer_size == sizeof(AtomicAdjust::Integer) &&
+      header->_slot_size == sizeof(Slot)) {
+    num_slots = header->_num_slots;
+  }
+
+  if (num_slots == 0 || (num_slots & (num_slots - 1)) != 0 ||
+      map_size != header_size + num_slots * sizeof(Slot)) {
+    if (util_cat.is_debug()) {
+      util_cat.debug()
+        << pathname << " is not a cache index file.\n";
+    }
+    unmap_file(base, map_size);
+    return NULL;
+  }
+
+  return new BamCacheIndexFile(pathname, root, base, map_size);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::make_key
+//       Access: Public, Static
+//  Description: Returns the key under which the entry for the
+//               indicated source pathname is stored: a 64-bit
+//               FNV-1a hash of the full pathname.
+//
+//               Two source files might, rarely, hash to the same key;
+//               the BamCache detects this when it reads the cache
+//               file named by the entry.
+////////////////////////////////////////////////////////////////////
+BamCacheIndexFile::Key BamCacheIndexFile::
+make_key(const Filename &source_pathname) {
+  const string &fullpath = source_pathname.get_fullpath();
+  Key hash = (Key)0xcbf29ce484222325ULL;
+  for (string::const_iterator si = fullpath.begin();
+       si != fullpath.end();
+       ++si) {
+    hash ^= (unsigned char)(*si);
+    hash *= (Key)0x100000001b3ULL;
+  }
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::get_ref_basename
+//       Access: Public, Static
+//  Description: Returns the name of the file, within the cache
+//               directory, that holds the name of the current index
+//               file.  This depends on the word size, since the
+//               layout of the index does.
+////////////////////////////////////////////////////////////////////
+string BamCacheIndexFile::
+get_ref_basename() {
+  ostringstream strm;
+  strm << "index_map" << sizeof(AtomicAdjust::Integer) * 8 << ".txt";
+  return strm.str();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::find_entry
+//       Access: Public
+//  Description: Looks up the entry with the indicated key.  If it is
+//               found, fills in entry and returns true; otherwise,
+//               returns false.
+//
+//               This takes no lock, and may be called from any
+//               number of threads at once.
+////////////////////////////////////////////////////////////////////
+bool BamCacheIndexFile::
+find_entry(Key key, Entry &entry) const {
+  size_t i = (size_t)key & _slot_mask;
+  for (size_t n = 0; n <= _slot_mask; ++n) {
+    const Slot *slot = get_slot(i);
+    while (true) {
+      AtomicAdjust::Integer seq = wait_slot(slot);
+      if (seq == 0) {
+        // We have reached the end of the chain without finding it.
+        return false;
+      }
+      if ((seq & 1) != 0) {
+        // Whoever was writing this slot never finished.  Skip it.
+        break;
+      }
+
+      bool live;
+      if (!read_slot(slot, seq, entry, live)) {
+        // The slot changed while we were reading it.  Try again.
+        continue;
+      }
+      if (entry._key == key) {
+        // An entry is never moved, so the first slot with our key is
+        // the only one that matters, even if it has been removed.
+        return live;
+      }
+      break;
+    }
+    i = (i + 1) & _slot_mask;
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::set_entry
+//       Access: Public
+//  Description: Adds the indicated entry to the index, or replaces
+//               the entry already there with the same key.  Only
+//               that one slot is written.  Returns true on success,
+//               or false if the entry could not be recorded (because
+//               the table is full, or the cache filename is too
+//               long).
+////////////////////////////////////////////////////////////////////
+bool BamCacheIndexFile::
+set_entry(const Entry &entry) {
+  const string &cache_filename = entry._cache_filename.get_fullpath();
+  if (cache_filename.empty() ||
+      cache_filename.length() >= (size_t)max_cache_filename) {
+    return false;
+  }
+
+  Header *header = get_header();
+  size_t i = (size_t)entry._key & _slot_mask;
+  for (size_t n = 0; n <= _slot_mask; ++n) {
+    Slot *slot = get_slot(i);
+    while (true) {
+      AtomicAdjust::Integer seq = wait_slot(slot);
+      if ((seq & 1) != 0) {
+        break;
+      }
+
+      PN_uint32 old_kbytes = 0;
+      if (seq == 0) {
+        // This slot has never been used.  Take it for our key.
+        if (!claim_slot(slot, seq)) {
+          // Someone else got there first; see what they put there.
+          continue;
+        }
+        AtomicAdjust::inc(header->_num_used);
+
+      } else {
+        if (slot->_key != entry._key) {
+          if (AtomicAdjust::get(slot->_seq) != seq) {
+            continue;
+          }
+          break;
+        }
+        if (!claim_slot(slot, seq)) {
+          continue;
+        }
+        if (slot->_live) {
+          old_kbytes = slot->_kbytes;
+        }
+      }
+
+      PN_uint32 kbytes = get_kbytes(entry._record_size);
+      slot->_key = entry._key;
+      slot->_live = 1;
+      slot->_kbytes = kbytes;
+      slot->_record_size = entry._record_size;
+      slot->_recorded_time = entry._recorded_time;
+      slot->_access_time = entry._access_time;
+      memset(slot->_cache_filename, 0, max_cache_filename);
+      memcpy(slot->_cache_filename, cache_filename.data(), cache_filename.length());
+      release_slot(slot, seq);
+
+      if (kbytes != old_kbytes) {
+        AtomicAdjust::add(header->_cache_kbytes,
+                          (AtomicAdjust::Integer)kbytes - (AtomicAdjust::Integer)old_kbytes);
+      }
+      return true;
+    }
+    i = (i + 1) & _slot_mask;
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::remove_entry
+//       Access: Public
+//  Description: Removes the entry with the indicated key, if there is
+//               one.  Returns true if it was removed, false if there
+//               was no such entry.
+////////////////////////////////////////////////////////////////////
+bool BamCacheIndexFile::
+remove_entry(Key key) {
+  return do_remove(key, NULL);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::evict_entry
+//       Access: Public
+//  Description: Removes the indicated entry, which was previously
+//               returned by get_entries(), but only if it has not
+//               been updated since.  Returns true if it was removed,
+//               in which case the caller should delete its cache
+//               file.
+////////////////////////////////////////////////////////////////////
+bool BamCacheIndexFile::
+evict_entry(const Entry &entry) {
+  return do_remove(entry._key, &entry);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::get_entries
+//       Access: Public
+//  Description: Fills the vector with a snapshot of all of the live
+//               entries in the index.  This visits every slot, so it
+//               should be used sparingly.
+////////////////////////////////////////////////////////////////////
+void BamCacheIndexFile::
+get_entries(Entries &entries) const {
+  entries.clear();
+  for (size_t i = 0; i <= _slot_mask; ++i) {
+    const Slot *slot = get_slot(i);
+    Entry entry;
+    bool live;
+    AtomicAdjust::Integer seq = AtomicAdjust::get(slot->_seq);
+    while (seq != 0 && (seq & 1) == 0) {
+      if (read_slot(slot, seq, entry, live)) {
+        if (live) {
+          entries.push_back(entry);
+        }
+        break;
+      }
+      seq = AtomicAdjust::get(slot->_seq);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::flush
+//       Access: Public
+//  Description: Ensures that any changes to the index have been
+//               written to disk.  Only the pages that have changed
+//               are written.  Returns true on success.
+////////////////////////////////////////////////////////////////////
+bool BamCacheIndexFile::
+flush() {
+#ifdef WIN32
+  return FlushViewOfFile(_base, _map_size) != 0;
+#else
+  return msync(_base, _map_size, MS_SYNC) == 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::do_remove
+//       Access: Private
+//  Description: The implementation of remove_entry() and
+//               evict_entry().  If expected is not NULL, the entry is
+//               removed only if it still matches it.
+////////////////////////////////////////////////////////////////////
+bool BamCacheIndexFile::
+do_remove(Key key, const Entry *expected) {
+  Header *header = get_header();
+  size_t i = (size_t)key & _slot_mask;
+  for (size_t n = 0; n <= _slot_mask; ++n) {
+    Slot *slot = get_slot(i);
+    while (true) {
+      AtomicAdjust::Integer seq = wait_slot(slot);
+      if (seq == 0) {
+        return false;
+      }
+      if ((seq & 1) != 0) {
+        break;
+      }
+
+      Entry entry;
+      bool live;
+      if (!read_slot(slot, seq, entry, live)) {
+        continue;
+      }
+      if (entry._key != key) {
+        break;
+      }
+      if (!live) {
+        return false;
+      }
+      if (expected != (const Entry *)NULL &&
+          (entry._access_time != expected->_access_time ||
+           entry._recorded_time != expected->_recorded_time ||
+           entry._cache_filename != expected->_cache_filename)) {
+        // It has been used or replaced since the caller looked at it.
+        return false;
+      }
+      if (!claim_slot(slot, seq)) {
+        continue;
+      }
+
+      PN_uint32 kbytes = slot->_kbytes;
+      slot->_live = 0;
+      slot->_kbytes = 0;
+      release_slot(slot, seq);
+
+      if (kbytes != 0) {
+        AtomicAdjust::add(header->_cache_kbytes, -(AtomicAdjust::Integer)kbytes);
+      }
+      return true;
+    }
+    i = (i + 1) & _slot_mask;
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::read_slot
+//       Access: Private, Static
+//  Description: Copies the contents of the slot, which had the
+//               indicated (even, nonzero) sequence number, into
+//               entry.  Returns true if the copy is consistent, or
+//               false if the slot was modified while it was being
+//               copied, in which case the caller should try again.
+//
+//               live is set false if the entry has been removed, or
+//               if the slot does not contain a sensible filename.
+////////////////////////////////////////////////////////////////////
+bool BamCacheIndexFile::
+read_slot(const Slot *slot, AtomicAdjust::Integer seq,
+          Entry &entry, bool &live) {
+  char cache_filename[max_cache_filename];
+  entry._key = slot->_key;
+  live = (slot->_live != 0);
+  entry._record_size = (streamsize)slot->_record_size;
+  entry._recorded_time = (time_t)slot->_recorded_time;
+  entry._access_time = (time_t)slot->_access_time;
+  memcpy(cache_filename, slot->_cache_filename, max_cache_filename);
+
+  if (AtomicAdjust::get(slot->_seq) != seq) {
+    return false;
+  }
+
+  // The index is shared with other processes, so we don't trust it to
+  // name anything other than a file directly within the cache
+  // directory.
+  size_t length = 0;
+  while (length < (size_t)max_cache_filename && cache_filename[length] != '\0') {
+    char ch = cache_filename[length];
+    if (!isalnum((unsigned char)ch) && ch != '_' && ch != '.' && ch != '-') {
+      live = false;
+    }
+    ++length;
+  }
+  if (length == 0 || length == (size_t)max_cache_filename) {
+    live = false;
+  }
+  if (live) {
+    entry._cache_filename = string(cache_filename, length);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::claim_slot
+//       Access: Private, Static
+//  Description: Attempts to take ownership of the slot, which is
+//               expected to have the indicated (even) sequence
+//               number, so that it may be written.  Returns true on
+//               success, or false if the slot has changed in the
+//               meantime.  On success, the caller must call
+//               release_slot() with the same sequence number.
+////////////////////////////////////////////////////////////////////
+bool BamCacheIndexFile::
+claim_slot(Slot *slot, AtomicAdjust::Integer seq) {
+  return AtomicAdjust::compare_and_exchange(slot->_seq, seq, seq + 1) == seq;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::release_slot
+//       Access: Private, Static
+//  Description: Publishes the changes to a slot claimed by
+//               claim_slot().
+////////////////////////////////////////////////////////////////////
+void BamCacheIndexFile::
+release_slot(Slot *slot, AtomicAdjust::Integer seq) {
+  AtomicAdjust::Integer new_seq = seq + 2;
+  if (new_seq == 0) {
+    // 0 means the slot is unused, so skip over it when the sequence
+    // number wraps around.
+    new_seq = 2;
+  }
+  AtomicAdjust::set(slot->_seq, new_seq);
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::wait_slot
+//       Access: Private, Static
+//  Description: Returns the sequence number of the slot, waiting
+//               briefly for any write in progress to finish.  If the
+//               slot is still being written after that (presumably
+//               because the process writing it has died), the odd
+//               sequence number is returned.
+////////////////////////////////////////////////////////////////////
+AtomicAdjust::Integer BamCacheIndexFile::
+wait_slot(const Slot *slot) {
+  AtomicAdjust::Integer seq = AtomicAdjust::get(slot->_seq);
+  for (int i = 0; (seq & 1) != 0 && i < 1000; ++i) {
+    Thread::force_yield();
+    seq = AtomicAdjust::get(slot->_seq);
+  }
+  return seq;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::map_file
+//       Access: Private, Static
+//  Description: Maps the indicated file into memory for reading and
+//               writing, shared with any other process that maps the
+//               same file.  If create is true, the file is created
+//               (it must not already exist) with map_size bytes of
+//               zeroes; otherwise, the whole existing file is mapped,
+//               and map_size is filled in with its size.  Returns
+//               true on success.
+////////////////////////////////////////////////////////////////////
+bool BamCacheIndexFile::
+map_file(const Filename &pathname, size_t &map_size, bool create,
+         char *&base) {
+  base = (char *)NULL;
+
+#ifdef WIN32
+  wstring os_specific = pathname.to_os_specific_w();
+  HANDLE file = CreateFileW(os_specific.c_str(), GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL, create ? CREATE_NEW : OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  if (!create) {
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 ||
+        (ULONGLONG)file_size.QuadPart != (size_t)file_size.QuadPart) {
+      CloseHandle(file);
+      return false;
+    }
+    map_size = (size_t)file_size.QuadPart;
+  }
+
+  // Creating the mapping extends a new file to the full size, filled
+  // with zeroes.
+  ULONGLONG size = (ULONGLONG)map_size;
+  HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READWRITE,
+                                     (DWORD)(size >> 32), (DWORD)size, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    if (create) {
+      DeleteFileW(os_specific.c_str());
+    }
+    return false;
+  }
+  void *ptr = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, map_size);
+  CloseHandle(mapping);
+  if (ptr == NULL) {
+    if (create) {
+      DeleteFileW(os_specific.c_str());
+    }
+    return false;
+  }
+
+#else
+  string os_specific = pathname.to_os_specific();
+  int flags = create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR;
+  int fd = ::open(os_specific.c_str(), flags, 0666);
+  if (fd < 0) {
+    return false;
+  }
+  if (create) {
+    // Extending the file fills it with zeroes, without actually
+    // writing them out.
+    if (ftruncate(fd, (off_t)map_size) != 0) {
+      ::close(fd);
+      unlink(os_specific.c_str());
+      return false;
+    }
+  } else {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+        (off_t)(size_t)st.st_size != st.st_size) {
+      ::close(fd);
+      return false;
+    }
+    map_size = (size_t)st.st_size;
+  }
+
+  void *ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (ptr == MAP_FAILED) {
+    if (create) {
+      unlink(os_specific.c_str());
+    }
+    return false;
+  }
+#endif  // WIN32
+
+  base = (char *)ptr;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamCacheIndexFile::unmap_file
+//       Access: Private, Static
+//  Description: Releases a mapping made by map_file().
+////////////////////////////////////////////////////////////////////
+void BamCacheIndexFile::
+unmap_file(char *base, size_t map_size) {
+#ifdef WIN32
+  UnmapViewOfFile(base);
+#else
+  munmap(base, map_size);
+#endif
+}
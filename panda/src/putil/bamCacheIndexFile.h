@@ -0,0 +1,178 @@
+// Filename: bamCacheIndexFile.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef BAMCACHEINDEXFILE_H
+#define BAMCACHEINDEXFILE_H
+
+#include "pandabase.h"
+#include "filename.h"
+#include "pvector.h"
+#include "atomicAdjust.h"
+#include "numeric_types.h"
+
+#include <time.h>
+
+////////////////////////////////////////////////////////////////////
+//       Class : BamCacheIndexFile
+// Description : This is the on-disk index of the BamCache: a
+//               fixed-size, open-addressed hash table of cache
+//               entries, keyed on a hash of the source pathname,
+//               which is mapped into memory and shared by every
+//               process that uses the same cache directory.
+//
+//               Each entry is updated in place, on its own.  A
+//               writer claims an entry by atomically making its
+//               sequence number odd, and releases it by making it
+//               even again; readers take no lock at all, and simply
+//               retry if the sequence number changed while they
+//               were copying the entry.  Since there is nothing to
+//               rewrite, flushing the index costs only as much as
+//               the pages that have actually changed.
+//
+//               The table never grows in place.  When it becomes too
+//               full, a new, larger file is written, published in
+//               the cache's index reference file, and the old one is
+//               marked as moved, so that other processes know to
+//               reopen the index.  Any entries written to the old
+//               table in the meantime are lost; this is harmless,
+//               since every entry is checked against the cache file
+//               it names before it is used.
+//
+//               The layout of the file depends on the size of
+//               AtomicAdjust::Integer, so processes with a different
+//               word size keep their own index.
+//
+//               This class is used only by the BamCache.
+////////////////////////////////////////////////////////////////////
+class EXPCL_PANDA_PUTIL BamCacheIndexFile {
+public:
+  typedef PN_uint64 Key;
+
+  class Entry {
+  public:
+    Key _key;
+    Filename _cache_filename;
+    streamsize _record_size;
+    time_t _recorded_time;
+    time_t _access_time;
+  };
+  typedef pvector<Entry> Entries;
+
+  // This class is used to sort Entries by access time, oldest first.
+  class SortByAccessTime {
+  public:
+    INLINE bool operator () (const Entry &a, const Entry &b) const;
+  };
+
+  static BamCacheIndexFile *create(const Filename &pathname,
+                                   const Filename &root, int min_entries);
+  static BamCacheIndexFile *open(const Filename &pathname,
+                                 const Filename &root);
+  ~BamCacheIndexFile();
+
+  INLINE const Filename &get_pathname() const;
+  INLINE const Filename &get_root() const;
+  INLINE int get_num_slots() const;
+  INLINE int get_cache_kbytes() const;
+  INLINE bool is_full() const;
+
+  INLINE bool is_moved() const;
+  INLINE void set_moved();
+
+  static Key make_key(const Filename &source_pathname);
+  static string get_ref_basename();
+
+  bool find_entry(Key key, Entry &entry) const;
+  bool set_entry(const Entry &entry);
+  bool remove_entry(Key key);
+  bool evict_entry(const Entry &entry);
+  void get_entries(Entries &entries) const;
+
+  bool flush();
+
+private:
+  BamCacheIndexFile(const Filename &pathname, const Filename &root,
+                    char *base, size_t map_size);
+
+  // The longest cache filename (relative to the cache root) that can
+  // be recorded in the index; the names generated by the BamCache
+  // are much shorter than this.
+  enum { max_cache_filename = 48 };
+
+  // The slots begin this many bytes into the file, after the Header.
+  enum { header_size = 64 };
+
+  class Header {
+  public:
+    char _magic[4];
+    PN_uint16 _version;
+    PN_uint16 _integer_size;
+    PN_uint32 _num_slots;
+    PN_uint32 _slot_size;
+
+    // The number of slots that have ever been used, including those
+    // whose entries have since been removed.
+    AtomicAdjust::Integer _num_used;
+
+    // The total size of the cache files named in the index, in
+    // kilobytes (each file rounded up).
+    AtomicAdjust::Integer _cache_kbytes;
+
+    // Nonzero when this table has been replaced by a newer file.
+    AtomicAdjust::Integer _moved;
+  };
+
+  class Slot {
+  public:
+    // 0 if the slot has never been used; odd while an entry is being
+    // written; otherwise even.
+    AtomicAdjust::Integer _seq;
+    PN_uint32 _live;
+    PN_uint32 _kbytes;
+    Key _key;
+    PN_int64 _record_size;
+    PN_int64 _recorded_time;
+    PN_int64 _access_time;
+    char _cache_filename[max_cache_filename];
+  };
+
+  INLINE Header *get_header() const;
+  INLINE Slot *get_slot(size_t n) const;
+  INLINE static PN_uint32 get_kbytes(streamsize record_size);
+
+  bool do_remove(Key key, const Entry *expected);
+
+  static bool read_slot(const Slot *slot, AtomicAdjust::Integer seq,
+                        Entry &entry, bool &live);
+  static bool claim_slot(Slot *slot, AtomicAdjust::Integer seq);
+  static void release_slot(Slot *slot, AtomicAdjust::Integer seq);
+  static AtomicAdjust::Integer wait_slot(const Slot *slot);
+
+  static bool map_file(const Filename &pathname, size_t &map_size,
+                       bool create, char *&base);
+  static void unmap_file(char *base, size_t map_size);
+
+  Filename _pathname;
+  Filename _root;
+  char *_base;
+  size_t _map_size;
+  size_t _slot_mask;
+
+  static const char _magic[4];
+  static const PN_uint16 _current_version;
+};
+
+#include "bamCacheIndexFile.I"
+
+#endif
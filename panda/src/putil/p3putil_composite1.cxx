@@ -2,6 +2,7 @@
 #include "autoTextureScale.cxx"
 #include "bamCache.cxx"
 #include "bamCacheIndex.cxx"
+#include "bamCacheIndexFile.cxx"
 #include "bamCacheRecord.cxx"
 #include "bamEnums.cxx"
 #include "bamReader.cxx"
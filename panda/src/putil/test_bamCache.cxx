@@ -0,0 +1,194 @@
+// Filename: test_bamCache.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pandabase.h"
+#include "bamCache.h"
+#include "bamCacheRecord.h"
+#include "config_util.h"
+#include "genericThread.h"
+#include "trueClock.h"
+#include "pvector.h"
+
+#include <algorithm>
+
+// This program fills a BamCache with a large number of (tiny) cache
+// records, and then reports the time it takes to flush the index to
+// disk, and the latency of looking up each record again from one or
+// more threads simultaneously.  Finally, it opens the same cache
+// directory with a second BamCache, which shares the index file, and
+// checks that every record can be found through it too.
+//
+// Each cached object is simply a copy of its own BamCacheRecord, so
+// that this needs nothing beyond putil.
+
+static BamCache *cache = NULL;
+static int num_entries = 100000;
+static int num_threads = 1;
+
+class LookupJob {
+public:
+  int _first;
+  int _misses;
+  pvector<double> _times;
+};
+
+static Filename
+make_source_pathname(int i) {
+  ostringstream strm;
+  strm << "/bamcache_bench/source/model_" << i << ".egg";
+  return Filename(strm.str());
+}
+
+static void
+lookup_main(void *user_data) {
+  LookupJob *job = (LookupJob *)user_data;
+  TrueClock *clock = TrueClock::get_global_ptr();
+
+  for (int i = job->_first; i < num_entries; i += num_threads) {
+    Filename source_pathname = make_source_pathname(i);
+    double start = clock->get_short_time();
+    PT(BamCacheRecord) record = cache->lookup(source_pathname, "bam");
+    job->_times.push_back(clock->get_short_time() - start);
+
+    if (record == (BamCacheRecord *)NULL || !record->has_data()) {
+      ++job->_misses;
+    }
+  }
+}
+
+static double
+time_flush() {
+  TrueClock *clock = TrueClock::get_global_ptr();
+  double start = clock->get_short_time();
+  cache->flush_index();
+  return clock->get_short_time() - start;
+}
+
+int
+main(int argc, char *argv[]) {
+  while (argc >= 3 && argv[1][0] == '-') {
+    if (strcmp(argv[1], "-n") == 0) {
+      num_entries = atoi(argv[2]);
+    } else if (strcmp(argv[1], "-t") == 0) {
+      num_threads = max(atoi(argv[2]), 1);
+    } else {
+      break;
+    }
+    argc -= 2;
+    argv += 2;
+  }
+
+  if (argc != 2) {
+    cerr << "test_bamCache [-n entries] [-t threads] cache_dir\n\n"
+         << "Fills the indicated (scratch) directory with the indicated number\n"
+         << "of model-cache entries, and reports the cost of flushing the\n"
+         << "cache index and of looking up each entry again.\n";
+    return (1);
+  }
+
+  init_libputil();
+  TrueClock *clock = TrueClock::get_global_ptr();
+
+  cache = BamCache::get_global_ptr();
+  cache->set_flush_time(1000000);
+  cache->set_root(Filename::from_os_specific(argv[1]));
+  cache->set_active(true);
+
+  double start = clock->get_short_time();
+  int i;
+  for (i = 0; i < num_entries; ++i) {
+    PT(BamCacheRecord) record = cache->lookup(make_source_pathname(i), "bam");
+    if (record == (BamCacheRecord *)NULL) {
+      cerr << "Cannot cache entries in " << argv[1] << "\n";
+      return (1);
+    }
+    if (!record->has_data()) {
+      PT(BamCacheRecord) data = record->make_copy();
+      record->set_data(data, data);
+      cache->store(record);
+    }
+  }
+  double store_time = clock->get_short_time() - start;
+  cout << "Stored " << num_entries << " entries in " << store_time << " s\n";
+
+  cout << "Initial index flush: " << time_flush() * 1000.0 << " ms\n";
+
+  // Add one more entry and flush again, to measure the steady-state
+  // cost of writing out the index.
+  PT(BamCacheRecord) record = cache->lookup(make_source_pathname(num_entries), "bam");
+  PT(BamCacheRecord) data = record->make_copy();
+  record->set_data(data, data);
+  cache->store(record);
+  cout << "Incremental index flush: " << time_flush() * 1000.0 << " ms\n";
+
+  pvector<LookupJob> jobs(num_threads);
+  pvector< PT(Thread) > threads;
+  start = clock->get_short_time();
+  for (i = 0; i < num_threads; ++i) {
+    jobs[i]._first = i;
+    jobs[i]._misses = 0;
+    PT(Thread) thread = new GenericThread("lookup", "lookup", &lookup_main, &jobs[i]);
+    thread->start(TP_normal, true);
+    threads.push_back(thread);
+  }
+  for (i = 0; i < num_threads; ++i) {
+    threads[i]->join();
+  }
+  double lookup_time = clock->get_short_time() - start;
+
+  pvector<double> times;
+  int misses = 0;
+  for (i = 0; i < num_threads; ++i) {
+    times.insert(times.end(), jobs[i]._times.begin(), jobs[i]._times.end());
+    misses += jobs[i]._misses;
+  }
+  if (times.empty()) {
+    return (0);
+  }
+  sort(times.begin(), times.end());
+
+  double total = 0.0;
+  pvector<double>::const_iterator ti;
+  for (ti = times.begin(); ti != times.end(); ++ti) {
+    total += (*ti);
+  }
+
+  cout << "Looked up " << times.size() << " entries with " << num_threads
+       << " threads in " << lookup_time << " s ("
+       << times.size() / lookup_time << " lookups/s, " << misses
+       << " misses)\n"
+       << "  mean " << total / times.size() * 1000000.0 << " us"
+       << ", p50 " << times[times.size() / 2] * 1000000.0 << " us"
+       << ", p99 " << times[times.size() * 99 / 100] * 1000000.0 << " us\n";
+
+  // A second BamCache on the same directory maps the same index file,
+  // just as another process would.
+  BamCache *other = new BamCache;
+  other->set_root(Filename::from_os_specific(argv[1]));
+  int other_misses = 0;
+  for (i = 0; i < num_entries; ++i) {
+    PT(BamCacheRecord) record = other->lookup(make_source_pathname(i), "bam");
+    if (record == (BamCacheRecord *)NULL || !record->has_data()) {
+      ++other_misses;
+    }
+  }
+  delete other;
+  cout << "Looked up " << num_entries << " entries through a second cache ("
+       << other_misses << " misses)\n";
+
+  if (misses != 0 || other_misses != 0) {
+    return (1);
+  }
+  return (0);
+}
@@ -46,6 +46,15 @@
     bamToEgg.cxx bamToEgg.h
 #end bin_target
 
+#begin bin_target
+  #define TARGET bam-lod
+  #define LOCAL_LIBS \
+    p3progbase
+
+  #define SOURCES \
+    bamLod.cxx bamLod.h
+#end bin_target
+
 #begin bin_target
   #define TARGET pts2bam
   #define LOCAL_LIBS \
@@ -0,0 +1,267 @@
+// Filename: bamLod.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "bamLod.h"
+
+#include "bamFile.h"
+#include "load_egg_file.h"
+#include "lodNode.h"
+#include "sceneGraphReducer.h"
+#include "sceneGraphAnalyzer.h"
+#include "boundingSphere.h"
+#include "trueClock.h"
+#include "string_utils.h"
+#include "pystub.h"
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamLod::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+BamLod::
+BamLod() : WithOutputFile(true, false, true)
+{
+  set_program_description
+    ("This program reads an egg or bam file, generates a series of "
+     "progressively simplified versions of the model, and writes out a "
+     "bam file that contains the original model and each of the simplified "
+     "versions as the levels of a single LODNode.  The time taken to "
+     "generate each level, the number of triangles in it, and the largest "
+     "distance by which it deviates from the original surface are "
+     "reported as it goes.");
+
+  clear_runlines();
+  add_runline("[opts] input.egg|input.bam output.bam");
+  add_runline("[opts] -o output.bam input.egg|input.bam");
+
+  add_option
+    ("o", "filename", 0,
+     "Specify the filename to which the resulting .bam file will be written.  "
+     "If this option is omitted, the last parameter name is taken to be the "
+     "name of the output file.",
+     &BamLod::dispatch_filename, &_got_output_filename, &_output_filename);
+
+  add_option
+    ("r", "ratio[,ratio...]", 0,
+     "Specify the fraction of the original triangles to keep in each of "
+     "the simplified levels, from the most detailed to the least.  The "
+     "default is 0.5,0.25,0.1.",
+     &BamLod::dispatch_vector_string_comma, NULL, &_ratio_strings);
+
+  add_option
+    ("d", "distance[,distance...]", 0,
+     "Specify the distance at which each level, starting with the original "
+     "model, switches out for the next one.  There should be one more "
+     "distance than there are ratios; the last is the distance beyond "
+     "which nothing is drawn.  The default is based on the radius of the "
+     "model, and doubles with each level.",
+     &BamLod::dispatch_vector_string_comma, NULL, &_distance_strings);
+
+  add_option
+    ("e", "error", 0,
+     "Specify the largest distance, in model units, by which any level "
+     "may deviate from the original surface.  A level stops simplifying "
+     "at this error even if it has not reached its triangle ratio.  The "
+     "default is no limit.",
+     &BamLod::dispatch_double, NULL, &_max_error);
+
+  add_option
+    ("opt", "", 0,
+     "Also reorder the triangles and vertices of each level for the "
+     "vertex cache; see NodePath::optimize_geometry().",
+     &BamLod::dispatch_none, &_optimize);
+
+  _max_error = 0.0;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamLod::run
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+void BamLod::
+run() {
+  PT(PandaNode) model = read_model(_input_filename);
+  if (model == (PandaNode *)NULL) {
+    nout << "Unable to read " << _input_filename << "\n";
+    exit(1);
+  }
+
+  if (_distances.empty()) {
+    CPT(BoundingVolume) bounds = model->get_bounds();
+    const BoundingSphere *sphere = bounds->as_bounding_sphere();
+    double radius = 1.0;
+    if (sphere != (const BoundingSphere *)NULL && !sphere->is_empty() &&
+        !sphere->is_infinite()) {
+      radius = sphere->get_radius();
+    }
+    double distance = radius * 4.0;
+    for (size_t i = 0; i <= _ratios.size(); ++i) {
+      _distances.push_back(distance);
+      distance *= 2.0;
+    }
+  }
+
+  SceneGraphAnalyzer analyzer;
+  analyzer.add_node(model);
+  int num_tris = analyzer.get_num_tris();
+  nout << "Level 0: " << num_tris << " triangles, switch out at "
+       << _distances[0] << "\n";
+
+  PT(LODNode) lod = new LODNode(model->get_name());
+  lod->add_child(model);
+  lod->add_switch(_distances[0], 0.0);
+
+  TrueClock *clock = TrueClock::get_global_ptr();
+  for (size_t i = 0; i < _ratios.size(); ++i) {
+    PT(PandaNode) level = model->copy_subgraph();
+
+    double start = clock->get_short_time();
+    SceneGraphReducer gr;
+    gr.simplify(level, _ratios[i], _max_error);
+    if (_optimize) {
+      gr.optimize_geometry(level);
+    }
+    double elapsed = clock->get_short_time() - start;
+
+    analyzer.clear();
+    analyzer.add_node(level);
+    nout << "Level " << i + 1 << ": " << analyzer.get_num_tris()
+         << " triangles (" << (double)analyzer.get_num_tris() / max(num_tris, 1)
+         << " of original), error " << gr.get_simplify_error();
+    if (_optimize) {
+      nout << ", ACMR " << gr.get_acmr_after();
+    }
+    nout << ", " << elapsed << " s, switch out at " << _distances[i + 1]
+         << "\n";
+
+    lod->add_child(level);
+    lod->add_switch(_distances[i + 1], _distances[i]);
+  }
+
+  // This should be guaranteed because we pass false to the
+  // constructor, above.
+  nassertv(has_output_filename());
+
+  Filename filename = get_output_filename();
+  filename.make_dir();
+  nout << "Writing " << filename << "\n";
+  BamFile bam_file;
+  if (!bam_file.open_write(filename)) {
+    nout << "Error in writing.\n";
+    exit(1);
+  }
+
+  if (!bam_file.write_object(lod.p())) {
+    nout << "Error in writing.\n";
+    exit(1);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamLod::handle_args
+//       Access: Protected, Virtual
+//  Description:
+////////////////////////////////////////////////////////////////////
+bool BamLod::
+handle_args(ProgramBase::Args &args) {
+  if (!check_last_arg(args, 1)) {
+    return false;
+  }
+
+  if (args.empty()) {
+    nout << "You must specify the model to read on the command line.\n";
+    return false;
+  }
+
+  if (args.size() > 1) {
+    nout << "Specify only one model on the command line.\n";
+    return false;
+  }
+
+  _input_filename = Filename::from_os_specific(args[0]);
+
+  return get_levels();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamLod::read_model
+//       Access: Private
+//  Description: Reads the indicated egg or bam file, and returns its
+//               top node, or NULL if it cannot be read.
+////////////////////////////////////////////////////////////////////
+PT(PandaNode) BamLod::
+read_model(const Filename &filename) {
+  if (filename.get_extension() == "egg") {
+    return load_egg_file(filename);
+  }
+
+  BamFile bam_file;
+  if (!bam_file.open_read(filename)) {
+    return NULL;
+  }
+  return bam_file.read_node();
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: BamLod::get_levels
+//       Access: Private
+//  Description: Converts the -r and -d parameters to numbers.
+//               Returns true if they are valid, false otherwise.
+////////////////////////////////////////////////////////////////////
+bool BamLod::
+get_levels() {
+  if (_ratio_strings.empty()) {
+    _ratios.push_back(0.5);
+    _ratios.push_back(0.25);
+    _ratios.push_back(0.1);
+  }
+
+  vector_string::const_iterator si;
+  for (si = _ratio_strings.begin(); si != _ratio_strings.end(); ++si) {
+    double ratio;
+    if (!string_to_double(*si, ratio) || ratio <= 0.0 || ratio > 1.0) {
+      nout << "Invalid ratio: " << *si << "\n";
+      return false;
+    }
+    _ratios.push_back(ratio);
+  }
+
+  for (si = _distance_strings.begin(); si != _distance_strings.end(); ++si) {
+    double distance;
+    if (!string_to_double(*si, distance) || distance <= 0.0) {
+      nout << "Invalid distance: " << *si << "\n";
+      return false;
+    }
+    _distances.push_back(distance);
+  }
+
+  if (!_distances.empty() && _distances.size() != _ratios.size() + 1) {
+    nout << "There should be " << _ratios.size() + 1 << " distances for "
+         << _ratios.size() << " simplified levels.\n";
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  // A call to pystub() to force libpystub.so to be linked in.
+  pystub();
+
+  BamLod prog;
+  prog.parse_command_line(argc, argv);
+  prog.run();
+  return 0;
+}
@@ -0,0 +1,56 @@
+// Filename: bamLod.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef BAMLOD_H
+#define BAMLOD_H
+
+#include "pandatoolbase.h"
+
+#include "programBase.h"
+#include "withOutputFile.h"
+#include "filename.h"
+#include "vector_string.h"
+#include "pandaNode.h"
+#include "pvector.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : BamLod
+// Description : This program reads a model, generates a series of
+//               simplified versions of it, and writes out a bam file
+//               with all of them under an LODNode.
+////////////////////////////////////////////////////////////////////
+class BamLod : public ProgramBase, public WithOutputFile {
+public:
+  BamLod();
+
+  void run();
+
+protected:
+  virtual bool handle_args(Args &args);
+
+private:
+  PT(PandaNode) read_model(const Filename &filename);
+  bool get_levels();
+
+  Filename _input_filename;
+  vector_string _ratio_strings;
+  vector_string _distance_strings;
+  double _max_error;
+  bool _optimize;
+
+  pvector<double> _ratios;
+  pvector<double> _distances;
+};
+
+#endif
@@ -37,6 +37,12 @@
     imageTransformColors.cxx imageTransformColors.h imageTransformColors.I
 #end bin_target
 
+#begin bin_target
+  #define TARGET image-stream
+  #define SOURCES \
+    imageStream.cxx imageStream.h
+#end bin_target
+
 #begin bin_target
   #define TARGET image-info
   #define SOURCES \
@@ -0,0 +1,232 @@
+// Filename: imageStream.cxx
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#include "imageStream.h"
+#include "pnmImageHeader.h"
+#include "string_utils.h"
+#include "pystub.h"
+
+////////////////////////////////////////////////////////////////////
+//     Function: ImageStream::Constructor
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+ImageStream::
+ImageStream() : ImageWriter(true) {
+  clear_runlines();
+  add_runline("[opts] inputimage outputimage");
+  add_runline("[opts] -o outputimage inputimage");
+
+  set_program_description
+    ("This program resizes, blurs, or changes the number of channels of "
+     "an image file, like image-resize and image-trans, but it reads and "
+     "writes the image a band of rows at a time, so that it can process "
+     "images much too large to be held in memory.  PNM, PNG, SGI, JPG, and "
+     "TIFF files can be read this way, and PNM, PNG, and SGI files can be "
+     "written this way; other image types are held in memory as usual.");
+
+  add_option
+    ("x", "xsize", 0,
+     "Specify the width of the output image in pixels, or as a percentage "
+     "of the original width (if a trailing percent sign is included).  "
+     "If this is omitted, the ratio is taken from the ysize parameter.",
+     &ImageStream::dispatch_string, &_got_x_size, &_x_size);
+
+  add_option
+    ("y", "ysize", 0,
+     "Specify the height of the output image in pixels, or as a percentage "
+     "of the original height (if a trailing percent sign is included).  "
+     "If this is omitted, the ratio is taken from the xsize parameter.",
+     &ImageStream::dispatch_string, &_got_y_size, &_y_size);
+
+  add_option
+    ("g", "radius", 0,
+     "Use Gaussian filtering to resize or blur the image, with the "
+     "indicated radius.",
+     &ImageStream::dispatch_double, &_use_gaussian_filter, &_gaussian_radius);
+
+  add_option
+    ("b", "radius", 0,
+     "Use box filtering to resize or blur the image, with the indicated "
+     "radius.  This is the default when the image is resized.",
+     &ImageStream::dispatch_double, &_use_box_filter, &_box_radius);
+
+  add_option
+    ("chan", "num", 0,
+     "Specify the number of channels of the output image, 1 through 4.  "
+     "The default is the same as the input image.",
+     &ImageStream::dispatch_int, NULL, &_num_channels);
+
+  add_option
+    ("maxval", "maxval", 0,
+     "Specify the maxval of the output image.  The default is the same "
+     "as the input image.",
+     &ImageStream::dispatch_int, NULL, &_maxval);
+
+  add_option
+    ("rows", "num", 0,
+     "Specify the number of rows of the output image that are held in "
+     "memory at once.  The default is 64.",
+     &ImageStream::dispatch_int, NULL, &_band_rows);
+
+  _gaussian_radius = 1.0;
+  _box_radius = 1.0;
+  _num_channels = 0;
+  _maxval = 0;
+  _band_rows = 64;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: ImageStream::run
+//       Access: Public
+//  Description:
+////////////////////////////////////////////////////////////////////
+void ImageStream::
+run() {
+  PNMImageHeader header;
+  if (!header.read_header(_input_filename)) {
+    nout << "Unable to read image file " << _input_filename << ".\n";
+    exit(1);
+  }
+
+  int orig_x_size = header.get_x_size();
+  int orig_y_size = header.get_y_size();
+  int x_size = orig_x_size;
+  int y_size = orig_y_size;
+
+  if (_got_x_size &&
+      !get_pixel_size("x", _x_size, orig_x_size, x_size)) {
+    exit(1);
+  }
+  if (_got_y_size &&
+      !get_pixel_size("y", _y_size, orig_y_size, y_size)) {
+    exit(1);
+  }
+  if (_got_x_size && !_got_y_size) {
+    y_size = max((int)((double)x_size * orig_y_size / orig_x_size + 0.5), 1);
+  } else if (_got_y_size && !_got_x_size) {
+    x_size = max((int)((double)y_size * orig_x_size / orig_y_size + 0.5), 1);
+  }
+
+  if (_num_channels < 0 || _num_channels > 4) {
+    nout << "Invalid number of channels: " << _num_channels << "\n";
+    exit(1);
+  }
+  if (_maxval < 0 || _maxval > 65535 || _band_rows <= 0) {
+    nout << "Invalid maxval or number of rows.\n";
+    exit(1);
+  }
+
+  PNMBandProcessor processor;
+  processor.set_band_rows(_band_rows);
+  processor.set_num_channels(_num_channels);
+  processor.set_maxval((xelval)_maxval);
+
+  if (x_size != orig_x_size || y_size != orig_y_size) {
+    nout << "Resizing to " << x_size << " x " << y_size << "\n";
+    processor.set_size(x_size, y_size);
+    processor.set_filter(PNMBandProcessor::FT_box, 1.0);
+  }
+  if (_use_gaussian_filter) {
+    processor.set_filter(PNMBandProcessor::FT_gaussian, _gaussian_radius);
+  } else if (_use_box_filter) {
+    processor.set_filter(PNMBandProcessor::FT_box, _box_radius);
+  }
+
+  if (!processor.process(_input_filename, get_output_filename())) {
+    nout << "Unable to write output image to "
+         << get_output_filename() << "\n";
+    exit(1);
+  }
+
+  nout << "Read " << _input_filename
+       << (processor.was_read_streaming() ? " a band at a time" : " all at once")
+       << ", wrote " << get_output_filename()
+       << (processor.was_write_streaming() ? " a band at a time" : " all at once")
+       << ".\n";
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: ImageStream::handle_args
+//       Access: Protected, Virtual
+//  Description: Does something with the additional arguments on the
+//               command line (after all the -options have been
+//               parsed).  Returns true if the arguments are good,
+//               false otherwise.
+////////////////////////////////////////////////////////////////////
+bool ImageStream::
+handle_args(ProgramBase::Args &args) {
+  if (!check_last_arg(args, 1)) {
+    return false;
+  }
+
+  if (args.empty()) {
+    nout << "You must specify the image file to read on the command line.\n";
+    return false;
+  }
+
+  if (args.size() > 1) {
+    nout << "Specify only one image on the command line.\n";
+    return false;
+  }
+
+  // Unlike ImageFilter, we don't read the image here; it is read a
+  // band at a time in run().
+  _input_filename = Filename::from_os_specific(args[0]);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+//     Function: ImageStream::get_pixel_size
+//       Access: Private, Static
+//  Description: Interprets the -x or -y parameters, which may be a
+//               pixel size or a percentage of the original size.
+//               Returns true on success, false on failure.
+////////////////////////////////////////////////////////////////////
+bool ImageStream::
+get_pixel_size(const string &opt, const string &arg, int orig_pixel_size,
+               int &pixel_size) {
+  if (!arg.empty() && arg[arg.length() - 1] == '%') {
+    // A ratio.
+    string str = arg.substr(0, arg.length() - 1);
+    double ratio;
+    if (!string_to_double(str, ratio) || ratio <= 0.0) {
+      nout << "Invalid ratio for -" << opt << ": "
+           << str << "\n";
+      return false;
+    }
+    pixel_size = max((int)(orig_pixel_size * ratio / 100.0 + 0.5), 1);
+
+  } else {
+    // A pixel size.
+    if (!string_to_int(arg, pixel_size) || pixel_size <= 0) {
+      nout << "Invalid pixel size for -" << opt << ": "
+           << arg << "\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+int main(int argc, char *argv[]) {
+  // A call to pystub() to force libpystub.so to be linked in.
+  pystub();
+
+  ImageStream prog;
+  prog.parse_command_line(argc, argv);
+  prog.run();
+  return 0;
+}
@@ -0,0 +1,61 @@
+// Filename: imageStream.h
+// Created by:  agent (19Oct26)
+//
+////////////////////////////////////////////////////////////////////
+//
+// PANDA 3D SOFTWARE
+// Copyright (c) Carnegie Mellon University.  All rights reserved.
+//
+// All use of this software is subject to the terms of the revised BSD
+// license.  You should have received a copy of this license along
+// with this source code in a file named "LICENSE."
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef IMAGESTREAM_H
+#define IMAGESTREAM_H
+
+#include "pandatoolbase.h"
+
+#include "imageWriter.h"
+#include "pnmBandProcessor.h"
+
+////////////////////////////////////////////////////////////////////
+//       Class : ImageStream
+// Description : A program to resize, blur, or convert an image file
+//               that may be too large to fit in memory, by reading
+//               and writing it a band of rows at a time.  See
+//               PNMBandProcessor.
+////////////////////////////////////////////////////////////////////
+class ImageStream : public ImageWriter {
+public:
+  ImageStream();
+
+  void run();
+
+protected:
+  virtual bool handle_args(Args &args);
+
+private:
+  static bool get_pixel_size(const string &opt, const string &arg,
+                             int orig_pixel_size, int &pixel_size);
+
+  Filename _input_filename;
+
+  bool _got_x_size;
+  string _x_size;
+  bool _got_y_size;
+  string _y_size;
+
+  bool _use_gaussian_filter;
+  bool _use_box_filter;
+  double _gaussian_radius;
+  double _box_radius;
+
+  int _num_channels;
+  int _maxval;
+  int _band_rows;
+};
+
+#endif
+